@@ -11,6 +11,8 @@
 #include "ExtMath.h"
 #include "Options.h"
 #include "Logger.h"
+#include "MapRenderer.h"
+#define MEM_SUBSYSTEM MEM_SYS_TEXTURES
 
 #ifndef CC_DISABLE_ANIMATIONS
 static void Animations_Update(int loc, struct Bitmap* bmp, int stride);
@@ -38,15 +40,11 @@ static float L_flameHeat[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
 static RNGState L_rnd;
 static cc_bool  L_rndInited;
 
-static void LavaAnimation_Tick(void) {
-	BitmapCol pixels[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
-	BitmapCol* ptr = pixels;
+static void LavaAnimation_Step(BitmapCol* ptr, int size) {
 	float soupHeat, potHeat, color;
-	int size, mask, shift;
+	int mask, shift;
 	int x, y, i = 0;
-	struct Bitmap bmp;
 
-	size  = min(Atlas2D.TileSize, LIQUID_ANIM_MAX);
 	mask  = size - 1;
 	shift = Math_ilog2(size);
 
@@ -104,9 +102,6 @@ static void LavaAnimation_Tick(void) {
 			ptr++; i++;
 		}
 	}
-
-	Bitmap_Init(bmp, size, size, pixels);
-	Animations_Update(LAVA_TEX_LOC, &bmp, size);
 }
 
 
@@ -119,15 +114,11 @@ static float W_flameHeat[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
 static RNGState W_rnd;
 static cc_bool  W_rndInited;
 
-static void WaterAnimation_Tick(void) {
-	BitmapCol pixels[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
-	BitmapCol* ptr = pixels;
+static void WaterAnimation_Step(BitmapCol* ptr, int size) {
 	float soupHeat, color;
-	int size, mask, shift;
+	int mask, shift;
 	int x, y, i = 0;
-	struct Bitmap bmp;
 
-	size  = min(Atlas2D.TileSize, LIQUID_ANIM_MAX);
 	mask  = size - 1;
 	shift = Math_ilog2(size);
 
@@ -166,9 +157,92 @@ static void WaterAnimation_Tick(void) {
 			ptr++; i++;
 		}
 	}
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Precomputed animation-------------------------------------------------*
+*#########################################################################################################################*/
+/* Simulating the lava/water animations every tick is fairly costly, so instead a loop of frames is precomputed */
+/*  once, with the end of the simulation crossfaded into the start of the loop to avoid a visible jump */
+#ifdef CC_BUILD_LOWMEM
+	#define LIQUID_ANIM_FRAMES 32
+#else
+	#define LIQUID_ANIM_FRAMES 64
+#endif
+typedef void (*LiquidAnim_StepFunc)(BitmapCol* pixels, int size);
+
+struct LiquidAnim {
+	LiquidAnim_StepFunc Step;
+	TextureLoc texLoc;
+	int size, cur;
+	/* Precomputed frames, NULL if couldn't allocate memory for them */
+	BitmapCol* frames;
+};
+static struct LiquidAnim lava_anim  = { LavaAnimation_Step,  LAVA_TEX_LOC  };
+static struct LiquidAnim water_anim = { WaterAnimation_Step, WATER_TEX_LOC };
+
+/* Blends src into dst, where weight is how much of dst is kept */
+static void LiquidAnim_Blend(BitmapCol* dst, const BitmapCol* src, int count, int weight) {
+	int i, inv = LIQUID_ANIM_FRAMES - weight;
+	BitmapCol a, b;
+
+	for (i = 0; i < count; i++) 
+	{
+		a = src[i]; b = dst[i];
+		dst[i] = BitmapCol_Make(
+			(BitmapCol_R(a) * inv + BitmapCol_R(b) * weight) / LIQUID_ANIM_FRAMES,
+			(BitmapCol_G(a) * inv + BitmapCol_G(b) * weight) / LIQUID_ANIM_FRAMES,
+			(BitmapCol_B(a) * inv + BitmapCol_B(b) * weight) / LIQUID_ANIM_FRAMES,
+			(BitmapCol_A(a) * inv + BitmapCol_A(b) * weight) / LIQUID_ANIM_FRAMES);
+	}
+}
+
+static void LiquidAnim_Precompute(struct LiquidAnim* anim, int size) {
+	BitmapCol pixels[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
+	int i, count = size * size;
+
+	Mem_Free(anim->frames);
+	anim->size   = size;
+	anim->cur    = 0;
+	anim->frames = (BitmapCol*)Mem_TryAlloc(LIQUID_ANIM_FRAMES * count, BITMAPCOLOR_SIZE);
+	if (!anim->frames) return;
+
+	for (i = 0; i < LIQUID_ANIM_FRAMES; i++) 
+	{
+		anim->Step(anim->frames + i * count, size);
+	}
 
-	Bitmap_Init(bmp, size, size, pixels);
-	Animations_Update(WATER_TEX_LOC, &bmp, size);
+	/* Frame i = frame (i + FRAMES) faded into frame i, so that the last frame */
+	/*  transitions into the first frame just like the simulation would have */
+	for (i = 0; i < LIQUID_ANIM_FRAMES; i++) 
+	{
+		anim->Step(pixels, size);
+		LiquidAnim_Blend(anim->frames + i * count, pixels, count, i);
+	}
+}
+
+static void LiquidAnim_Tick(struct LiquidAnim* anim) {
+	BitmapCol pixels[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
+	int size = min(Atlas2D.TileSize, LIQUID_ANIM_MAX);
+	struct Bitmap bmp;
+
+	if (size != anim->size) LiquidAnim_Precompute(anim, size);
+
+	if (anim->frames) {
+		Bitmap_Init(bmp, size, size, anim->frames + anim->cur * size * size);
+		anim->cur = (anim->cur + 1) % LIQUID_ANIM_FRAMES;
+	} else {
+		anim->Step(pixels, size);
+		Bitmap_Init(bmp, size, size, pixels);
+	}
+	Animations_Update(anim->texLoc, &bmp, size);
+}
+
+static void LiquidAnim_Free(struct LiquidAnim* anim) {
+	Mem_Free(anim->frames);
+	anim->frames = NULL;
+	anim->size   = 0;
 }
 #endif
 
@@ -249,13 +323,92 @@ static void Animations_ReadDescription(struct Stream* stream, const cc_string* p
 	}
 }
 
+/* Whether each tile has been animated since animations were last uploaded to the 1D atlases */
+static cc_bool anims_dirty[ATLAS1D_MAX_ATLASES];
+static cc_bool anims_anyDirty;
+/* Temp bitmap that nearby animated tiles are combined into, for uploading them all at once */
+static struct Bitmap anims_upload;
+/* Animated tiles further apart than this are uploaded separately, */
+/*  to avoid uploading too many unchanged tiles between them */
+#define ANIMS_MAX_UPLOAD_GAP 4
+
 static void Animations_Update(int texLoc, struct Bitmap* bmp, int stride) {
-	int dstX = Atlas1D_Index(texLoc);
-	int dstY = Atlas1D_RowId(texLoc) * Atlas2D.TileSize;
-	GfxResourceID tex;
+	int x = Atlas2D_TileX(texLoc) * Atlas2D.TileSize;
+	int y = Atlas2D_TileY(texLoc) * Atlas2D.TileSize;
+	int row;
+	if (Atlas2D_TileY(texLoc) >= Atlas2D.RowsCount) return;
+
+	/* Chunk meshes may have merged faces using this tile, if it was uniform before being animated */
+	if (Atlas2D.RowsUniform[texLoc]) {
+		Atlas2D.RowsUniform[texLoc] = false;
+		MapRenderer_Refresh();
+	}
 
-	tex = Atlas1D.TexIds[dstX];
-	if (tex) Gfx_UpdateTexture(tex, 0, dstY, bmp, stride, Gfx.Mipmaps);
+	/* Frame is drawn into the 2D atlas, then later uploaded to the 1D atlas in Animations_Flush */
+	for (row = 0; row < bmp->height; row++) 
+	{
+		Mem_Copy(Bitmap_GetRow(&Atlas2D.Bmp, y + row) + x, bmp->scan0 + row * stride,
+				bmp->width * BITMAPCOLOR_SIZE);
+	}
+	anims_dirty[texLoc] = true;
+	anims_anyDirty      = true;
+}
+
+/* Uploads the given range of tiles in the 2D atlas to their 1D atlas in one go */
+static void Animations_Upload(int beg, int end) {
+	int size = Atlas2D.TileSize, count = end - beg;
+	GfxResourceID tex = Atlas1D.TexIds[Atlas1D_Index(beg)];
+	struct Bitmap tile;
+	int i;
+	/* NOTE: 1D atlas might not have been lazily loaded yet (see Atlas1D_Bind) */
+	if (!tex) return;
+
+	if (count == 1) {
+		tile.scan0  = Bitmap_GetRow(&Atlas2D.Bmp, Atlas2D_TileY(beg) * size) + Atlas2D_TileX(beg) * size;
+		tile.width  = size;
+		tile.height = size;
+		Gfx_UpdateTexture(tex, 0, Atlas1D_RowId(beg) * size, &tile, Atlas2D.Bmp.width, Gfx.Mipmaps);
+		return;
+	}
+
+	if (anims_upload.width != size || anims_upload.height < count * size) {
+		Mem_Free(anims_upload.scan0);
+		Bitmap_Allocate(&anims_upload, size, count * size);
+	}
+
+	for (i = beg; i < end; i++) 
+	{
+		Bitmap_UNSAFE_CopyBlock(Atlas2D_TileX(i) * size, Atlas2D_TileY(i) * size, 0, (i - beg) * size,
+								&Atlas2D.Bmp, &anims_upload, size);
+	}
+
+	Bitmap_Init(tile, size, count * size, anims_upload.scan0);
+	Gfx_UpdateTexture(tex, 0, Atlas1D_RowId(beg) * size, &tile, size, Gfx.Mipmaps);
+}
+
+/* Uploads all the tiles animated this tick, combining nearby tiles in the same 1D atlas into one upload */
+static void Animations_Flush(void) {
+	int tilesCount = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+	int i, beg, end;
+	if (!anims_anyDirty) return;
+
+	for (i = 0; i < tilesCount; ) 
+	{
+		if (!anims_dirty[i]) { i++; continue; }
+		beg = i; end = i + 1;
+
+		for (i = end; i < tilesCount && (i - end) < ANIMS_MAX_UPLOAD_GAP; i++) 
+		{
+			if (Atlas1D_Index(i) != Atlas1D_Index(beg)) break;
+			if (anims_dirty[i]) end = i + 1;
+		}
+
+		Animations_Upload(beg, end);
+		i = end;
+	}
+
+	Mem_Set(anims_dirty, 0, sizeof(anims_dirty));
+	anims_anyDirty = false;
 }
 
 static void Animations_Apply(struct AnimationData* data) {
@@ -296,6 +449,10 @@ static void Animations_Clear(void) {
 	anims_count = 0;
 	anims_bmp.scan0 = NULL;
 	anims_validated = false;
+
+	Mem_Free(anims_upload.scan0);
+	anims_upload.scan0 = NULL;
+	anims_upload.width = 0;
 }
 
 static void Animations_Validate(void) {
@@ -336,15 +493,15 @@ static void Animations_Validate(void) {
 static void Animations_Tick(struct ScheduledTask* task) {
 	int i;
 #ifndef CC_BUILD_WEB
-	if (useLavaAnim)  LavaAnimation_Tick();
-	if (useWaterAnim) WaterAnimation_Tick();
+	if (useLavaAnim)  LiquidAnim_Tick(&lava_anim);
+	if (useWaterAnim) LiquidAnim_Tick(&water_anim);
 #endif
 
-	if (!anims_count) return;
+	if (!anims_count) { Animations_Flush(); return; }
 	if (!anims_bmp.scan0) {
 		Chat_AddRaw("&cCurrent texture pack specifies it uses animations,");
 		Chat_AddRaw("&cbut is missing animations.png");
-		anims_count = 0; return;
+		anims_count = 0; Animations_Flush(); return;
 	}
 
 	/* deferred, because when reading animations.txt, might not have read animations.png yet */
@@ -352,6 +509,7 @@ static void Animations_Tick(struct ScheduledTask* task) {
 	for (i = 0; i < anims_count; i++) {
 		Animations_Apply(&anims_list[i]);
 	}
+	Animations_Flush();
 }
 
 
@@ -395,15 +553,24 @@ static void OnInit(void) {
 	TextureEntry_Register(&water_entry);
 	TextureEntry_Register(&lava_entry);
 
-	ScheduledTask_Add(GAME_DEF_TICKS, Animations_Tick);
+	/* No point catching up on animation frames that would never be seen */
+	ScheduledTask_SetLimits(ScheduledTask_Add(GAME_DEF_TICKS, Animations_Tick), 1, 0);
 	Event_Register_(&TextureEvents.PackChanged, NULL, OnPackChanged);
 }
+
+static void OnFree(void) {
+	Animations_Clear();
+#ifndef CC_BUILD_WEB
+	LiquidAnim_Free(&lava_anim);
+	LiquidAnim_Free(&water_anim);
+#endif
+}
 #else
-static void Animations_Clear(void) { }
 static void OnInit(void) { }
+static void OnFree(void) { }
 #endif
 
 struct IGameComponent Animations_Component = {
-	OnInit,            /* Init  */
-	Animations_Clear  /* Free  */
+	OnInit, /* Init  */
+	OnFree  /* Free  */
 };
@@ -17,15 +17,28 @@
 /* TODO: Refactor maybe to not rely on checking WinInfo.Handle != NULL */
 #include "Window.h"
 #endif
+#define MEM_SUBSYSTEM MEM_SYS_AUDIO
 
 int Audio_SoundsVolume, Audio_MusicVolume;
 const cc_string Sounds_ZipPathMC = String_FromConst("audio/default.zip");
 const cc_string Sounds_ZipPathCC = String_FromConst("audio/classicube.zip");
 static const cc_string audio_dir = String_FromConst("audio");
 
+/* Some backends must reopen the output device whenever the sample rate changes, */
+/*  so sounds played at a different rate are resampled instead of reconfiguring the context */
+#if CC_AUD_BACKEND == CC_AUD_BACKEND_WINMM || defined CC_BUILD_OS2
+	#define SOUNDS_RESAMPLE
+	#define SOUND_MAX_RESAMPLED 2
+/* Cached copy of a sound's data resampled for a playback rate */
+struct ResampledSound { int rate; struct AudioChunk chunk; };
+#endif
+
 struct Sound {
 	int channels, sampleRate;
 	struct AudioChunk chunk;
+#ifdef SOUNDS_RESAMPLE
+	struct ResampledSound resampled[SOUND_MAX_RESAMPLED];
+#endif
 };
 
 
@@ -47,9 +60,14 @@ void Audio_PlayStepSound(cc_uint8 type) { }
 #else
 #define AUDIO_MAX_SOUNDS 10
 
+/* Sounds from the same group started within this interval are merged into one */
+/*  (e.g. when many blocks are placed at once, playing every sound just uses up audio contexts) */
+#define SOUNDS_MIN_INTERVAL_US 40000
+
 struct SoundGroup {
 	int count;
 	struct Sound sounds[AUDIO_MAX_SOUNDS];
+	cc_uint64 lastPlayed; /* Time sound from this group was last played */
 };
 struct Soundboard { struct SoundGroup groups[SOUND_COUNT]; };
 
@@ -153,7 +171,7 @@ static void Soundboard_Load(struct Soundboard* board, const cc_string* boardName
 	} else { group->count++; }
 }
 
-static const struct Sound* Soundboard_PickRandom(struct Soundboard* board, cc_uint8 type) {
+static struct Sound* Soundboard_PickRandom(struct Soundboard* board, cc_uint8 type) {
 	struct SoundGroup* group;
 	int idx;
 
@@ -168,39 +186,61 @@ static const struct Sound* Soundboard_PickRandom(struct Soundboard* board, cc_ui
 }
 
 
-CC_NOINLINE static void Sounds_Fail(cc_result res) {
-	Audio_Warn(res, "playing sounds");
-	Chat_AddRaw("&cDisabling sounds");
-	Audio_SetSounds(0);
+#ifdef SOUNDS_RESAMPLE
+/* Linearly resamples the sound's data so that playing it at the original sample rate */
+/*  sounds the same as playing the original data at the given playback rate */
+static void Sound_Resample(const struct Sound* snd, int rate, struct AudioChunk* dst) {
+	const cc_int16* src = (const cc_int16*)snd->chunk.data;
+	cc_int16* out       = (cc_int16*)dst->data;
+	int channels  = snd->channels;
+	int srcFrames = snd->chunk.size / (2 * channels);
+	int dstFrames = dst->size / (2 * channels);
+	cc_uint32 pos = 0, step = ((cc_uint32)rate << 16) / 100;
+	int i, c, idx, next, frac, a, b;
+
+	for (i = 0; i < dstFrames; i++, pos += step) 
+	{
+		idx  = pos >> 16;
+		frac = (pos & 0xFFFF) >> 1; /* 15 bits, so (b - a) * frac can't overflow */
+		next = min(idx + 1, srcFrames - 1);
+
+		for (c = 0; c < channels; c++) 
+		{
+			a = src[idx  * channels + c];
+			b = src[next * channels + c];
+			*out++ = (cc_int16)(a + (((b - a) * frac) >> 15));
+		}
+	}
 }
 
-static void Sounds_Play(cc_uint8 type, struct Soundboard* board) {
-	const struct Sound* snd;
-	struct AudioData data;
-	cc_result res;
+/* Retrieves the sound's data resampled for the given playback rate, resampling it if necessary */
+static cc_bool Sound_GetResampled(struct Sound* snd, int rate, struct AudioChunk* chunk) {
+	struct ResampledSound* r;
+	cc_uint32 frames;
+	int i;
 
-	if (type == SOUND_NONE || !Audio_SoundsVolume) return;
-	snd = Soundboard_PickRandom(board, type);
-	if (!snd) return;
+	for (i = 0; i < SOUND_MAX_RESAMPLED; i++) 
+	{
+		r = &snd->resampled[i];
+		if (r->rate == rate) { *chunk = r->chunk; return true; }
+		if (r->rate) continue;
 
-	data.chunk      = snd->chunk;
-	data.channels   = snd->channels;
-	data.sampleRate = snd->sampleRate;
-	data.rate       = 100;
-	data.volume     = Audio_SoundsVolume;
+		frames = snd->chunk.size / (2 * snd->channels);
+		frames = (cc_uint32)(((cc_uint64)frames * 100) / rate);
+		if (!frames || Audio_AllocChunks(frames * 2 * snd->channels, &r->chunk, 1)) return false;
 
-	/* https://minecraft.wiki/w/Block_of_Gold#Sounds */
-	/* https://minecraft.wiki/w/Grass#Sounds */
-	if (board == &digBoard) {
-		if (type == SOUND_METAL) data.rate = 120;
-		else data.rate = 80;
-	} else {
-		data.volume /= 2;
-		if (type == SOUND_METAL) data.rate = 140;
+		Sound_Resample(snd, rate, &r->chunk);
+		r->rate = rate;
+		*chunk  = r->chunk; return true;
 	}
-	
-	res = AudioPool_Play(&data);
-	if (res) Sounds_Fail(res);
+	return false;
+}
+#endif
+
+CC_NOINLINE static void Sounds_Fail(cc_result res) {
+	Audio_Warn(res, "playing sounds");
+	Chat_AddRaw("&cDisabling sounds");
+	Audio_SetSounds(0);
 }
 
 static void Audio_PlayBlockSound(void* obj, IVec3 coords, BlockID old, BlockID now) {
@@ -228,7 +268,7 @@ static cc_result Sounds_ExtractZip(const cc_string* path) {
 	struct Stream stream;
 	cc_result res;
 
-	res = Stream_OpenFile(&stream, path);
+	res = Stream_OpenBufferedFile(&stream, path);
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
 	res = Zip_Extract(&stream, SelectZipEntry, ProcessZipEntry,
@@ -281,15 +321,10 @@ static void InitWebSounds(void) {
 #endif
 
 static cc_bool sounds_loaded;
-static void Sounds_Start(void) {
+/* Sounds are only decoded the first time one is played, as this is relatively slow */
+/*  and otherwise delays starting the game even when no block is ever broken or walked on */
+static void Sounds_Load(void) {
 	cc_result res;
-	if (!AudioBackend_Init()) { 
-		AudioBackend_Free(); 
-		Audio_SoundsVolume = 0; 
-		return; 
-	}
-
-	if (sounds_loaded) return;
 	sounds_loaded = true;
 #ifdef CC_BUILD_WEBAUDIO
 	InitWebSounds();
@@ -300,6 +335,56 @@ static void Sounds_Start(void) {
 #endif
 }
 
+static void Sounds_Start(void) {
+	if (!AudioBackend_Init()) { 
+		AudioBackend_Free(); 
+		Audio_SoundsVolume = 0; 
+	}
+}
+
+static void Sounds_Play(cc_uint8 type, struct Soundboard* board) {
+	struct Sound* snd;
+	struct SoundGroup* group;
+	struct AudioData data;
+	cc_uint64 now;
+	cc_result res;
+
+	if (type == SOUND_NONE || !Audio_SoundsVolume) return;
+	if (!sounds_loaded) Sounds_Load();
+	snd = Soundboard_PickRandom(board, type);
+	if (!snd) return;
+
+	/* An identical sound started moments ago is indistinguishable from a new one */
+	group = &board->groups[type == SOUND_METAL ? SOUND_STONE : type];
+	now   = Stopwatch_Measure();
+	if (group->lastPlayed && Stopwatch_ElapsedMicroseconds(group->lastPlayed, now) < SOUNDS_MIN_INTERVAL_US) return;
+	group->lastPlayed = now;
+
+	data.chunk      = snd->chunk;
+	data.channels   = snd->channels;
+	data.sampleRate = snd->sampleRate;
+	data.rate       = 100;
+	data.volume     = Audio_SoundsVolume;
+
+	/* https://minecraft.wiki/w/Block_of_Gold#Sounds */
+	/* https://minecraft.wiki/w/Grass#Sounds */
+	if (board == &digBoard) {
+		if (type == SOUND_METAL) data.rate = 120;
+		else data.rate = 80;
+	} else {
+		data.volume /= 2;
+		if (type == SOUND_METAL) data.rate = 140;
+	}
+
+#ifdef SOUNDS_RESAMPLE
+	/* Always playing at the original rate means audio contexts never need to be reopened */
+	if (data.rate != 100 && Sound_GetResampled(snd, data.rate, &data.chunk)) data.rate = 100;
+#endif
+	
+	res = AudioPool_Play(&data);
+	if (res) Sounds_Fail(res);
+}
+
 static void Sounds_Stop(void) { AudioPool_Close(); }
 
 static void Sounds_Init(void) {
@@ -331,6 +416,9 @@ static void* music_thread;
 static void* music_waitable;
 static volatile cc_bool music_stopping, music_joining;
 static int music_minDelay, music_maxDelay;
+/* How long to wait before checking again whether a music buffer has finished playing */
+/* NOTE: Each buffer holds about a second of audio, so a short delay isn't necessary */
+#define MUSIC_POLL_DELAY 100
 
 static cc_result Music_Buffer(struct AudioChunk* chunk, int maxSamples, struct VorbisState* ctx) {
 	int samples = 0;
@@ -411,7 +499,8 @@ static cc_result Music_PlayOgg(struct Stream* source) {
 		if (res) { music_stopping = true; break; }
 
 		if (inUse >= AUDIO_MAX_BUFFERS) {
-			Thread_Sleep(10); continue;
+			/* Music_Stop signals this, so stopping music is still immediate */
+			Waitable_WaitFor(music_waitable, MUSIC_POLL_DELAY); continue;
 		}
 
 		res = Music_Buffer(&chunks[cur], samplesPerSecond, &vorbis);
@@ -430,7 +519,7 @@ static cc_result Music_PlayOgg(struct Stream* source) {
 		/* Wait until the buffers finished playing */
 		for (;;) {
 			if (Audio_Poll(&music_ctx, &inUse) || inUse == 0) break;
-			Thread_Sleep(10);
+			Waitable_WaitFor(music_waitable, MUSIC_POLL_DELAY);
 		}
 	}
 
@@ -472,7 +561,7 @@ static void Music_RunLoop(void) {
 		path = StringsBuffer_UNSAFE_Get(&files, idx);
 		Platform_Log1("playing music file: %s", &path);
 
-		res = Stream_OpenFile(&stream, &path);
+		res = Stream_OpenBufferedFile(&stream, &path);
 		if (res) { Logger_SysWarn2(res, "opening", &path); break; }
 
 		res = Music_PlayOgg(&stream);
@@ -5,6 +5,7 @@
 #include "Errors.h"
 #include "Utils.h"
 #include "Platform.h"
+#define MEM_SUBSYSTEM MEM_SYS_AUDIO
 
 void Audio_Warn(cc_result res, const char* action) {
 	Logger_Warn(res, action, Audio_DescribeError);
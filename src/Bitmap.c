@@ -1,4 +1,18 @@
 #include "Bitmap.h"
+/* NOTE: Included before Funcs.h, since C++ standard headers may #undef its min/max */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define PNG_SSE2
+	#include <emmintrin.h>
+#elif defined __ARM_NEON && defined __aarch64__
+	#define PNG_NEON
+	#include <arm_neon.h>
+#endif
+/* SIMD row expanders only support 32 bit RGBA or BGRA pixels, with alpha in the upper 8 bits */
+#if (defined PNG_SSE2 || defined PNG_NEON) && BITMAPCOLOR_SIZE == 4 && BITMAPCOLOR_A_SHIFT == 24
+	#if BITMAPCOLOR_R_SHIFT == 0 || BITMAPCOLOR_R_SHIFT == 16
+		#define PNG_SIMD_EXPAND
+	#endif
+#endif
 #include "Platform.h"
 #include "ExtMath.h"
 #include "Deflate.h"
@@ -7,6 +21,7 @@
 #include "Errors.h"
 #include "Utils.h"
 #include "Funcs.h"
+#define MEM_SUBSYSTEM MEM_SYS_TEXTURES
 
 BitmapCol BitmapColor_Offset(BitmapCol color, int rBy, int gBy, int bBy) {
 	int r, g, b;
@@ -48,16 +63,70 @@ void Bitmap_Scale(struct Bitmap* dst, struct Bitmap* src,
 	BitmapCol* dstRow;
 	BitmapCol* srcRow;
 	int x, y, width, height;
+	int sx, sy, xRem, yRem;
 
 	width  = dst->width;
 	height = dst->height;
 
-	for (y = 0; y < height; y++) {
-		srcRow = Bitmap_GetRow(src, srcY + (y * srcHeight / height));
+	/* Steps through source pixels incrementally, which produces exactly */
+	/*  the same results as (x * srcWidth / width) without the divisions */
+	for (y = 0, sy = 0, yRem = 0; y < height; y++) {
+		srcRow = Bitmap_GetRow(src, srcY + sy) + srcX;
 		dstRow = Bitmap_GetRow(dst, y);
 
-		for (x = 0; x < width; x++) {
-			dstRow[x] = srcRow[srcX + (x * srcWidth / width)];
+		for (x = 0, sx = 0, xRem = 0; x < width; x++) {
+			dstRow[x] = srcRow[sx];
+
+			for (xRem += srcWidth; xRem >= width; xRem -= width) sx++;
+		}
+		for (yRem += srcHeight; yRem >= height; yRem -= height) sy++;
+	}
+}
+
+void Bitmap_ScaleFiltered(struct Bitmap* dst, struct Bitmap* src, 
+					int srcX, int srcY, int srcWidth, int srcHeight) {
+	BitmapCol* dstRow;
+	BitmapCol* srcRow;
+	BitmapCol col;
+	int x, y, width, height, xx, yy;
+	int x0, x1, y0, y1, xRem, yRem;
+	cc_uint32 r, g, b, a, alpha, count;
+
+	width  = dst->width;
+	height = dst->height;
+	/* Filtering only matters when downscaling */
+	if (srcWidth <= width && srcHeight <= height) {
+		Bitmap_Scale(dst, src, srcX, srcY, srcWidth, srcHeight); return;
+	}
+
+	for (y = 0, y1 = 0, yRem = 0; y < height; y++) {
+		y0 = y1;
+		for (yRem += srcHeight; yRem >= height; yRem -= height) y1++;
+		dstRow = Bitmap_GetRow(dst, y);
+
+		for (x = 0, x1 = 0, xRem = 0; x < width; x++) {
+			x0 = x1;
+			for (xRem += srcWidth; xRem >= width; xRem -= width) x1++;
+			r = 0; g = 0; b = 0; a = 0;
+
+			/* Box filter, with colours premultiplied by alpha so that */
+			/*  transparent pixels don't bleed into the resulting colour */
+			for (yy = y0; yy < max(y1, y0 + 1); yy++) 
+			{
+				srcRow = Bitmap_GetRow(src, srcY + yy) + srcX;
+
+				for (xx = x0; xx < max(x1, x0 + 1); xx++) 
+				{
+					col    = srcRow[xx];
+					alpha  = BitmapCol_A(col);
+					r += BitmapCol_R(col) * alpha; g += BitmapCol_G(col) * alpha;
+					b += BitmapCol_B(col) * alpha; a += alpha;
+				}
+			}
+
+			count = (max(y1, y0 + 1) - y0) * (max(x1, x0 + 1) - x0);
+			alpha = a ? a : 1; /* avoid divide by 0 below */
+			dstRow[x] = BitmapCol_Make(r / alpha, g / alpha, b / alpha, a / count);
 		}
 	}
 }
@@ -89,10 +158,130 @@ cc_bool Png_Detect(const cc_uint8* data, cc_uint32 len) {
 
 /* 9 Filtering */
 /* 13.9 Filtering */
+#ifdef PNG_SSE2
+/* Sub/Average/Paeth filters depend on the previous pixel, so are mostly processed one pixel at a time */
+/* (only 3 byte RGB and 4 byte RGBA pixels are accelerated, as nearly all PNGs use those) */
+static CC_INLINE __m128i Png_LoadPixel(const cc_uint8* p, int bpp) {
+	cc_uint32 v = p[0] | (p[1] << 8) | (p[2] << 16);
+	if (bpp == 4) v |= (cc_uint32)p[3] << 24;
+	return _mm_cvtsi32_si128((int)v);
+}
+
+static CC_INLINE void Png_StorePixel(cc_uint8* p, int bpp, __m128i value) {
+	cc_uint32 v = (cc_uint32)_mm_cvtsi128_si32(value);
+	p[0] = (cc_uint8)v; p[1] = (cc_uint8)(v >> 8); p[2] = (cc_uint8)(v >> 16);
+	if (bpp == 4) p[3] = (cc_uint8)(v >> 24);
+}
+
+static void Png_ReconstructSub4(cc_uint8* line, cc_uint32 lineLen) {
+	__m128i last = _mm_setzero_si128();
+	__m128i cur;
+	cc_uint32 i = 0;
+
+	/* Prefix sum of 4 pixels at a time, then add on the last pixel from the previous 4 */
+	for (; i + 16 <= lineLen; i += 16) {
+		cur  = _mm_loadu_si128((const __m128i*)(line + i));
+		cur  = _mm_add_epi8(cur, _mm_slli_si128(cur, 4));
+		cur  = _mm_add_epi8(cur, _mm_slli_si128(cur, 8));
+		cur  = _mm_add_epi8(cur, last);
+		_mm_storeu_si128((__m128i*)(line + i), cur);
+		last = _mm_shuffle_epi32(cur, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	for (i = max(i, 4); i < lineLen; i++) { line[i] += line[i - 4]; }
+}
+
+static void Png_ReconstructUp(cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	__m128i cur, above;
+	cc_uint32 i = 0;
+
+	for (; i + 16 <= lineLen; i += 16) {
+		cur   = _mm_loadu_si128((const __m128i*)(line  + i));
+		above = _mm_loadu_si128((const __m128i*)(prior + i));
+		_mm_storeu_si128((__m128i*)(line + i), _mm_add_epi8(cur, above));
+	}
+	for (; i < lineLen; i++) { line[i] += prior[i]; }
+}
+
+static void Png_ReconstructAverage(int bpp, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	__m128i ones = _mm_set1_epi8(1);
+	__m128i a, b, avg, cur = _mm_setzero_si128();
+	cc_uint32 i;
+
+	for (i = 0; i < lineLen; i += bpp) {
+		a   = cur;
+		b   = Png_LoadPixel(prior + i, bpp);
+		cur = Png_LoadPixel(line  + i, bpp);
+
+		/* avg_epu8 rounds up, whereas PNG requires (a + b) >> 1 */
+		avg = _mm_avg_epu8(a, b);
+		avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), ones));
+		cur = _mm_add_epi8(cur, avg);
+		Png_StorePixel(line + i, bpp, cur);
+	}
+}
+
+static CC_INLINE __m128i Png_Abs16(__m128i x) {
+	__m128i neg = _mm_srai_epi16(x, 15);
+	return _mm_sub_epi16(_mm_xor_si128(x, neg), neg);
+}
+
+static CC_INLINE __m128i Png_Select(__m128i cond, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(cond, a), _mm_andnot_si128(cond, b));
+}
+
+static void Png_ReconstructPaeth(int bpp, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i a, b = zero, c, cur = zero;
+	__m128i pa, pb, pc, smallest, nearest;
+	cc_uint32 i;
+
+	/* Computed with 16 bit lanes, since p = a + b - c can be outside 0-255 */
+	for (i = 0; i < lineLen; i += bpp) {
+		a   = cur;
+		c   = b;
+		b   = _mm_unpacklo_epi8(Png_LoadPixel(prior + i, bpp), zero);
+		cur = _mm_unpacklo_epi8(Png_LoadPixel(line  + i, bpp), zero);
+
+		/* p - a = b - c, p - b = a - c, p - c = (a - c) + (b - c) */
+		pa = _mm_sub_epi16(b, c);
+		pb = _mm_sub_epi16(a, c);
+		pc = _mm_add_epi16(pa, pb);
+
+		pa = Png_Abs16(pa);
+		pb = Png_Abs16(pb);
+		pc = Png_Abs16(pc);
+		smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+		/* Ties are broken in order of a, b, c */
+		nearest = Png_Select(_mm_cmpeq_epi16(smallest, pa), a,
+				  Png_Select(_mm_cmpeq_epi16(smallest, pb), b, c));
+		/* Upper 8 bits of each lane are always 0, so adding bytes wraps like the scalar code */
+		cur = _mm_add_epi8(cur, nearest);
+		Png_StorePixel(line + i, bpp, _mm_packus_epi16(cur, cur));
+	}
+}
+#elif defined PNG_NEON
+static void Png_ReconstructUp(cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	cc_uint32 i = 0;
+
+	for (; i + 16 <= lineLen; i += 16) {
+		vst1q_u8(line + i, vaddq_u8(vld1q_u8(line + i), vld1q_u8(prior + i)));
+	}
+	for (; i < lineLen; i++) { line[i] += prior[i]; }
+}
+#endif
+
 static void Png_ReconstructFirst(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8* line, cc_uint32 lineLen) {
 	/* First scanline is a special case, where all values in prior array are 0 */
 	cc_uint32 i, j;
 
+#ifdef PNG_SSE2
+	/* With prior all 0, Paeth always picks the previous pixel, so is identical to Sub */
+	if (bytesPerPixel == 4 && (type == PNG_FILTER_SUB || type == PNG_FILTER_PAETH)) {
+		Png_ReconstructSub4(line, lineLen); return;
+	}
+#endif
+
 	switch (type) {
 	case PNG_FILTER_SUB:
 		for (i = bytesPerPixel, j = 0; i < lineLen; i++, j++) {
@@ -117,6 +306,20 @@ static void Png_ReconstructFirst(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8
 static void Png_Reconstruct(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
 	cc_uint32 i, j;
 
+#ifdef PNG_SSE2
+	if (bytesPerPixel == 3 || bytesPerPixel == 4) {
+		switch (type) {
+		case PNG_FILTER_SUB:
+			if (bytesPerPixel == 3) break;
+			Png_ReconstructSub4(line, lineLen); return;
+		case PNG_FILTER_AVERAGE:
+			Png_ReconstructAverage(bytesPerPixel, line, prior, lineLen); return;
+		case PNG_FILTER_PAETH:
+			Png_ReconstructPaeth(bytesPerPixel, line, prior, lineLen); return;
+		}
+	}
+#endif
+
 	switch (type) {
 	case PNG_FILTER_SUB:
 		for (i = bytesPerPixel, j = 0; i < lineLen; i++, j++) {
@@ -125,9 +328,13 @@ static void Png_Reconstruct(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8* lin
 		return;
 
 	case PNG_FILTER_UP:
+#if defined PNG_SSE2 || defined PNG_NEON
+		Png_ReconstructUp(line, prior, lineLen);
+#else
 		for (i = 0; i < lineLen; i++) {
 			line[i] += prior[i];
 		}
+#endif
 		return;
 
 	case PNG_FILTER_AVERAGE:
@@ -203,15 +410,67 @@ static void Png_Expand_GRAYSCALE_8(int width, BitmapCol* palette, cc_uint8* src,
 	for (; width > 0; width--) { PNG_Do_Grayscale_8(); }
 }
 
+#if defined PNG_SIMD_EXPAND && defined PNG_SSE2
+static CC_INLINE __m128i Png_SwapRB(__m128i v) {
+#if BITMAPCOLOR_R_SHIFT == 16
+	__m128i ga = _mm_and_si128(v, _mm_set1_epi32((int)0xFF00FF00));
+	__m128i rb = _mm_and_si128(v, _mm_set1_epi32(0x00FF00FF));
+	rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+	return _mm_or_si128(ga, rb);
+#else
+	return v;
+#endif
+}
+#endif
+
 static void Png_Expand_RGB_8(int width, BitmapCol* palette, cc_uint8* src, BitmapCol* dst) {
+#if defined PNG_SIMD_EXPAND && defined PNG_SSE2
+	/* 16 bytes are read for every 4 pixels, so the last 2 pixels are always expanded by the scalar loop */
+	int i, simd = width >= 6 ? (width - 2) & ~3 : 0;
+	__m128i v, lo, hi, alpha = _mm_set1_epi32((int)0xFF000000);
+	cc_uint8*  srcBeg = src;
+	BitmapCol* dstBeg = dst;
+#elif defined PNG_SIMD_EXPAND && defined PNG_NEON
+	int i, simd = width & ~15;
+	uint8x16x3_t rgb;
+	uint8x16x4_t rgba;
+	cc_uint8*  srcBeg = src;
+	BitmapCol* dstBeg = dst;
+#endif
 	src += (width - 1) * 3;
 	dst += (width - 1);
+#ifdef PNG_SIMD_EXPAND
+	width -= simd;
+#endif
 
 	for (; width >= 4; width -= 4) {
 		PNG_Do_RGB__8(); PNG_Do_RGB__8(); 
 		PNG_Do_RGB__8(); PNG_Do_RGB__8();
 	}
 	for (; width > 0; width--) { PNG_Do_RGB__8(); }
+
+	/* Still done backwards, and all of the source pixels are read before writing any output pixels */
+#if defined PNG_SIMD_EXPAND && defined PNG_SSE2
+	for (i = simd - 4; i >= 0; i -= 4) {
+		v  = _mm_loadu_si128((const __m128i*)(srcBeg + i * 3));
+		lo = _mm_unpacklo_epi32(v,                    _mm_srli_si128(v, 3));
+		hi = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+
+		v  = _mm_or_si128(_mm_unpacklo_epi64(lo, hi), alpha);
+		_mm_storeu_si128((__m128i*)(dstBeg + i), Png_SwapRB(v));
+	}
+#elif defined PNG_SIMD_EXPAND && defined PNG_NEON
+	rgba.val[3] = vdupq_n_u8(255);
+	for (i = simd - 16; i >= 0; i -= 16) {
+		rgb = vld3q_u8(srcBeg + i * 3);
+	#if BITMAPCOLOR_R_SHIFT == 16
+		rgba.val[0] = rgb.val[2]; rgba.val[1] = rgb.val[1]; rgba.val[2] = rgb.val[0];
+	#else
+		rgba.val[0] = rgb.val[0]; rgba.val[1] = rgb.val[1]; rgba.val[2] = rgb.val[2];
+	#endif
+		vst4q_u8((cc_uint8*)(dstBeg + i), rgba);
+	}
+#endif
 }
 
 static void Png_Expand_INDEXED_1(int width, BitmapCol* palette, cc_uint8* src, BitmapCol* dst) {
@@ -254,6 +513,22 @@ static void Png_Expand_GRAYSCALE_A_8(int width, BitmapCol* palette, cc_uint8* sr
 
 static void Png_Expand_RGB_A_8(int width, BitmapCol* palette, cc_uint8* src, BitmapCol* dst) {
 	/* Processed in forward order */
+#if defined PNG_SIMD_EXPAND && defined PNG_SSE2
+	for (; width >= 4; width -= 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)src);
+		_mm_storeu_si128((__m128i*)dst, Png_SwapRB(v));
+		src += 16; dst += 4;
+	}
+#elif defined PNG_SIMD_EXPAND && defined PNG_NEON
+	for (; width >= 16; width -= 16) {
+		uint8x16x4_t v = vld4q_u8(src);
+	#if BITMAPCOLOR_R_SHIFT == 16
+		uint8x16_t tmp = v.val[0]; v.val[0] = v.val[2]; v.val[2] = tmp;
+	#endif
+		vst4q_u8((cc_uint8*)dst, v);
+		src += 64; dst += 16;
+	}
+#endif
 
 	for (; width >= 4; width -= 4) {
 		PNG_Do_RGB_A__8(); PNG_Do_RGB_A__8();
@@ -329,6 +604,17 @@ static BitmapCol ExpandRGB(cc_uint8 bitsPerSample, int r, int g, int b) {
 	return BitmapCol_Make(r, g, b, 0);
 }
 
+/* Only ever set on the main thread, as worker threads decode their own streams */
+static CC_THREADLOCAL struct Stream* png_decodedStream;
+static CC_THREADLOCAL struct Bitmap  png_decoded;
+
+void Png_SetDecoded(struct Stream* stream, struct Bitmap* bmp) {
+	Mem_Free(png_decoded.scan0);
+	png_decoded.scan0 = NULL;
+	png_decodedStream = stream;
+	if (bmp) png_decoded = *bmp;
+}
+
 cc_result Png_Decode(struct Bitmap* bmp, struct Stream* stream) {
 	cc_uint8 tmp[64];
 	cc_uint32 dataSize, fourCC;
@@ -362,6 +648,12 @@ cc_result Png_Decode(struct Bitmap* bmp, struct Stream* stream) {
 	struct ZLibHeader zlibHeader;
 	cc_uint8* data = NULL;
 
+	/* PNG might have already been decoded (e.g. on a worker thread) */
+	if (stream == png_decodedStream && png_decoded.scan0) {
+		*bmp = png_decoded;
+		png_decoded.scan0 = NULL;
+		return 0;
+	}
 	bmp->width = 0; bmp->height = 0;
 	bmp->scan0 = NULL;
 
@@ -653,13 +945,12 @@ static void Png_EncodeRow(const cc_uint8* cur, const cc_uint8* prior, cc_uint8*
 
 static BitmapCol* DefaultGetRow(struct Bitmap* bmp, int y, void* ctx) { return Bitmap_GetRow(bmp, y); }
 static cc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, cc_uint8* buffer,
-					Png_RowGetter getRow, cc_bool alpha, void* ctx) {
+					struct ZLibState* zlState, Png_RowGetter getRow, cc_bool alpha, void* ctx, cc_bool fast) {
 	cc_uint8 tmp[32];
 	cc_uint8* prevLine = buffer;
 	cc_uint8*  curLine = buffer + (bmp->width * 4) * 1;
 	cc_uint8* bestLine = buffer + (bmp->width * 4) * 2;
 
-	struct ZLibState zlState;
 	struct Stream chunk, zlStream;
 	cc_uint32 stream_end, stream_beg;
 	int y, lineSize;
@@ -692,7 +983,8 @@ static cc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, cc_ui
 	Stream_SetU32_BE(&tmp[0], PNG_FourCC('I','D','A','T'));
 	if ((res = Stream_Write(&chunk, tmp, 4))) return res;
 
-	ZLib_MakeStream(&zlStream, &zlState, &chunk); 
+	ZLib_MakeStream(&zlStream, zlState, &chunk); 
+	if (fast) zlState->Base.Level = DEFLATE_LEVEL_FAST;
 	lineSize = bmp->width * (alpha ? 4 : 3);
 	Mem_Set(prevLine, 0, lineSize);
 
@@ -702,7 +994,14 @@ static cc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, cc_ui
 		cc_uint8* cur  = (y & 1) == 0 ? curLine  : prevLine;
 
 		Png_MakeRow(src, cur, lineSize, alpha);
-		Png_EncodeRow(cur, prev, bestLine, lineSize, alpha);
+
+		if (fast) {
+			/* Up filter usually compresses well enough, and is cheapest to compute */
+			Png_Filter(PNG_FILTER_UP, cur, prev, bestLine + 1, lineSize, alpha ? 4 : 3);
+			bestLine[0] = PNG_FILTER_UP;
+		} else {
+			Png_EncodeRow(cur, prev, bestLine, lineSize, alpha);
+		}
 
 		/* +1 for filter byte */
 		if ((res = Stream_Write(&zlStream, bestLine, lineSize + 1))) return res;
@@ -725,22 +1024,43 @@ static cc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, cc_ui
 	return stream->Seek(stream, stream_end);
 }
 
-cc_result Png_Encode(struct Bitmap* bmp, struct Stream* stream, 
-					Png_RowGetter getRow, cc_bool alpha, void* ctx) {
+static cc_result Png_EncodeWith(struct Bitmap* bmp, struct Stream* stream, 
+					Png_RowGetter getRow, cc_bool alpha, void* ctx, cc_bool fast) {
+	struct ZLibState* zlState;
 	cc_result res;
 	/* Add 1 for scanline filter type byter */
 	cc_uint8* buffer = (cc_uint8*)Mem_TryAlloc(3, bmp->width * 4 + 1);
 	if (!buffer) return ERR_NOT_SUPPORTED;
 
-	res = Png_EncodeCore(bmp, stream, buffer, getRow, alpha, ctx);
+	/* Compressor state is too large to safely put on the stack */
+	zlState = (struct ZLibState*)Mem_TryAlloc(1, sizeof(struct ZLibState));
+	if (!zlState) { Mem_Free(buffer); return ERR_OUT_OF_MEMORY; }
+
+	res = Png_EncodeCore(bmp, stream, buffer, zlState, getRow, alpha, ctx, fast);
+	Mem_Free(zlState);
 	Mem_Free(buffer);
 	return res;
 }
+
+cc_result Png_Encode(struct Bitmap* bmp, struct Stream* stream, 
+					Png_RowGetter getRow, cc_bool alpha, void* ctx) {
+	return Png_EncodeWith(bmp, stream, getRow, alpha, ctx, false);
+}
+
+cc_result Png_EncodeFast(struct Bitmap* bmp, struct Stream* stream, 
+						Png_RowGetter getRow, cc_bool alpha, void* ctx) {
+	return Png_EncodeWith(bmp, stream, getRow, alpha, ctx, true);
+}
 #else
 /* No point including encoding code when can't save screenshots anyways */
 cc_result Png_Encode(struct Bitmap* bmp, struct Stream* stream, 
 					Png_RowGetter getRow, cc_bool alpha, void* ctx) {
 	return ERR_NOT_SUPPORTED;
 }
+
+cc_result Png_EncodeFast(struct Bitmap* bmp, struct Stream* stream, 
+						Png_RowGetter getRow, cc_bool alpha, void* ctx) {
+	return ERR_NOT_SUPPORTED;
+}
 #endif
 
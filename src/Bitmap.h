@@ -119,6 +119,10 @@ void Bitmap_TryAllocate(struct Bitmap* bmp, int width, int height);
 /* The pixels from the region are scaled upwards or downwards depending on destination width and height. */
 CC_API void Bitmap_Scale(struct Bitmap* dst, struct Bitmap* src, 
 						int srcX, int srcY, int srcWidth, int srcHeight);
+/* Same as Bitmap_Scale, but when downscaling the pixels from the region are averaged together. */
+/* NOTE: This is considerably slower than Bitmap_Scale, but looks far less noisy. */
+CC_API void Bitmap_ScaleFiltered(struct Bitmap* dst, struct Bitmap* src, 
+						int srcX, int srcY, int srcWidth, int srcHeight);
 
 #define PNG_SIG_SIZE 8
 #if defined CC_BUILD_LOWMEM
@@ -137,11 +141,19 @@ typedef BitmapCol* (*Png_RowGetter)(struct Bitmap* bmp, int row, void* ctx);
      https://github.com/nothings/stb/blob/master/stb_image.h
 */
 CC_API cc_result Png_Decode(struct Bitmap* bmp, struct Stream* stream);
+/* Makes Png_Decode return the given already decoded bitmap the next time it is called with the given stream */
+/* (e.g. when the PNG in the stream was already decoded on a worker thread). Pass NULL to clear it. */
+/* NOTE: Takes ownership of the bitmap's pixels, which are freed if never returned by Png_Decode */
+void Png_SetDecoded(struct Stream* stream, struct Bitmap* bmp);
 /* Encodes a bitmap in PNG format. */
 /* getRow is optional. Can be used to modify how rows are encoded. (e.g. flip image) */
 /* if alpha is non-zero, RGBA channels are saved, otherwise only RGB channels are. */
 cc_result Png_Encode(struct Bitmap* bmp, struct Stream* stream, 
 						Png_RowGetter getRow, cc_bool alpha, void* ctx);
+/* Same as Png_Encode, but trades larger output for being much faster to encode. */
+/* (i.e. uses the same filter for every row, and fastest DEFLATE compression level) */
+cc_result Png_EncodeFast(struct Bitmap* bmp, struct Stream* stream, 
+						Png_RowGetter getRow, cc_bool alpha, void* ctx);
 
 CC_END_HEADER
 #endif
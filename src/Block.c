@@ -270,6 +270,34 @@ static float GetSpriteBB_MaxY(int size, int tileX, int tileY, const struct Bitma
 	return 0.0f;
 }
 
+struct BlockRenderInfo Block_RenderInfo[BLOCK_COUNT];
+struct BlockPhysInfo   Block_PhysInfo[BLOCK_COUNT];
+
+/* Updates the packed copies of the given block's properties */
+static void Block_CalcInfo(BlockID block) {
+	struct BlockRenderInfo* render = &Block_RenderInfo[block];
+	struct BlockPhysInfo*   phys   = &Block_PhysInfo[block];
+
+	render->draw         = Blocks.Draw[block];
+	render->brightness   = Blocks.Brightness[block];
+	render->lightOffset  = Blocks.LightOffset[block];
+	render->canStretch   = Blocks.CanStretch[block];
+	render->fullOpaque   = Blocks.FullOpaque[block];
+	render->tinted       = Blocks.Tinted[block];
+	render->blocksLight  = Blocks.BlocksLight[block];
+	render->spriteOffset = Blocks.SpriteOffset[block];
+	render->fogCol       = Blocks.FogCol[block];
+	render->padding      = 0;
+
+	phys->minBB           = Blocks.MinBB[block];
+	phys->maxBB           = Blocks.MaxBB[block];
+	phys->collide         = Blocks.Collide[block];
+	phys->extendedCollide = Blocks.ExtendedCollide[block];
+	phys->isLiquid        = Blocks.IsLiquid[block];
+	phys->padding         = 0;
+	phys->speedMultiplier = Blocks.SpeedMultiplier[block];
+}
+
 /* Recalculates bounding box of the given sprite block */
 static void Block_RecalculateBB(BlockID block) {
 	struct Bitmap* bmp = &Atlas2D.Bmp;
@@ -293,6 +321,7 @@ static void Block_RecalculateBB(BlockID block) {
 	Vec3_Add(&Blocks.MinBB[block], &minRaw, &centre);
 	Vec3_Add(&Blocks.MaxBB[block], &maxRaw, &centre);
 	Block_CalcRenderBounds(block);
+	Block_CalcInfo(block);
 }
 
 /* Recalculates bounding boxes of all sprite blocks */
@@ -395,24 +424,63 @@ static void Block_UpdateAllCulling(void) {
 
 	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
 		Block_CalcStretch((BlockID)block);
+		Block_CalcInfo((BlockID)block);
 		for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
 			Block_CalcCulling((BlockID)block, (BlockID)neighbour);
 		}
 	}
 }
 
-/* Updates culling data just for this block */
+/* Blocks whose definitions were changed since culling data was last updated */
+static cc_uint32 dirtyBlocks[BLOCK_COUNT >> 5];
+static int dirtyBlocksCount;
+#define Block_IsDirty(block) ((dirtyBlocks[(block) >> 5] & (1u << ((block) & 0x1F))) != 0)
+
+/* Marks culling data of this block as needing to be updated */
 /* (e.g. whether block can be stretched, visibility with other blocks) */
-static void Block_UpdateCulling(BlockID block) {
-	int neighbour;
-	Block_CalcStretch(block);
-	
-	for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
-		Block_CalcCulling(block, (BlockID)neighbour);
-		Block_CalcCulling((BlockID)neighbour, block);
+static void Block_MarkCullingDirty(BlockID block) {
+	if (Block_IsDirty(block)) return;
+	dirtyBlocks[block >> 5] |= (1u << (block & 0x1F));
+	dirtyBlocksCount++;
+}
+
+static void Block_ClearDirty(void) {
+	int i;
+	for (i = 0; i < Array_Elems(dirtyBlocks); i++) {
+		dirtyBlocks[i] = 0;
+	}
+	dirtyBlocksCount = 0;
+}
+
+void Block_ApplyDefChanges(void) {
+	int block, neighbour;
+	if (!dirtyBlocksCount) return;
+
+	/* Past this point, updating the row and column of each block is slower than just updating everything */
+	if (dirtyBlocksCount >= BLOCK_COUNT / 4) {
+		Block_UpdateAllCulling();
+	} else {
+		for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) 
+		{
+			if (!Block_IsDirty(block)) continue;
+			Block_CalcStretch((BlockID)block);
+			Block_CalcInfo((BlockID)block);
+
+			for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) 
+			{
+				Block_CalcCulling((BlockID)block, (BlockID)neighbour);
+				/* When both blocks are dirty, the neighbour's own row updates this pair */
+				if (!Block_IsDirty(neighbour)) Block_CalcCulling((BlockID)neighbour, (BlockID)block);
+			}
+		}
 	}
+
+	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
+	Block_ClearDirty();
 }
 
+cc_bool Block_IsDefChanged(BlockID block) { return Block_IsDirty(block); }
+
 
 /*########################################################################################################################*
 *---------------------------------------------------------Block-----------------------------------------------------------*
@@ -444,12 +512,12 @@ void Block_DefineCustom(BlockID block, cc_bool checkSprite) {
 	Block_SetCollide(block,  collide);
 	Block_SetDrawType(block, Blocks.Draw[block]);
 	Block_CalcRenderBounds(block);
-	Block_UpdateCulling(block);
+	Block_MarkCullingDirty(block);
 	Block_CalcLightOffset(block);
 
 	Inventory_AddDefault(block);
 	Block_SetCustomDefined(block, true);
-	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
+	Block_CalcInfo(block);
 
 	if (!checkSprite) return; /* TODO eliminate this */
 	/* Update sprite BoundingBox if necessary */
@@ -458,13 +526,12 @@ void Block_DefineCustom(BlockID block, cc_bool checkSprite) {
 
 void Block_UndefineCustom(BlockID block) {
 	Block_ResetProps(block);
-	Block_UpdateCulling(block);
+	Block_MarkCullingDirty(block);
 
 	Inventory_Remove(block);
 	if (block <= BLOCK_MAX_CPE) { Inventory_AddDefault(block); }
 
 	Block_SetCustomDefined(block, false);
-	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
 
 	/* Update sprite BoundingBox if necessary */
 	if (Blocks.Draw[block] == DRAW_SPRITE) Block_RecalculateBB(block);
@@ -504,6 +571,7 @@ void Block_ResetProps(BlockID block) {
 	Block_SetSide(def->sideTexture, block);
 
 	Blocks.ParticleGravity[block] = 5.4f * (def->gravity / 100.0f);
+	Block_CalcInfo(block);
 }
 
 STRING_REF cc_string Block_UNSAFE_GetName(BlockID block) {
@@ -782,8 +850,9 @@ static void OnReset(void) {
 		Block_ResetProps((BlockID)block);
 	}
 
-	Block_UpdateAllCulling();
 	Block_RecalculateAllSpriteBB();
+	Block_UpdateAllCulling();
+	Block_ClearDirty();
 
 	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
 		Blocks.CanPlace[block]  = true;
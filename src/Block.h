@@ -109,6 +109,27 @@ CC_VAR extern struct _BlockLists {
 #define Block_Tint(col, block)\
 if (Blocks.Tinted[block]) col = PackedCol_Tint(col, Blocks.FogCol[block]);
 
+/* Copy of the properties of a block that the mesh builder reads for every block/face, */
+/*  packed together so that they share a cache line instead of being spread across many arrays */
+struct BlockRenderInfo {
+	cc_uint8 draw, brightness, lightOffset, canStretch;
+	cc_bool  fullOpaque, tinted, blocksLight;
+	cc_uint8 spriteOffset;
+	PackedCol fogCol;
+	cc_uint32 padding; /* Pads to 16 bytes */
+};
+/* Copy of the properties of a block that collision detection reads for every block */
+struct BlockPhysInfo {
+	Vec3 minBB, maxBB;
+	cc_uint8 collide, extendedCollide;
+	cc_bool  isLiquid;
+	cc_uint8 padding;
+	float speedMultiplier;
+};
+/* NOTE: Derived from Blocks, and recalculated whenever a block is defined/undefined */
+extern struct BlockRenderInfo Block_RenderInfo[BLOCK_COUNT];
+extern struct BlockPhysInfo   Block_PhysInfo[BLOCK_COUNT];
+
 /* Most blocks which 'stop' light actually stop the light starting at block below */
 /*  except for e.g. upside down slabs which 'stop' the light at same block level */
 /* The difference can be seen by placing a lower and upper slab block on a wall, */
@@ -123,6 +144,13 @@ cc_bool Block_IsCustomDefined(BlockID block);
 void Block_DefineCustom(BlockID block, cc_bool checkSprite);
 /* Resets the given block to default */
 void Block_UndefineCustom(BlockID block);
+/* Updates culling data of all blocks defined/undefined since this was last called, */
+/*  then raises BlockEvents.BlockDefChanged if there were any such blocks */
+/* NOTE: Called once per frame, so e.g. hundreds of blocks defined when joining a server are only handled once */
+void Block_ApplyDefChanges(void);
+/* Returns whether the given block was defined/undefined since Block_ApplyDefChanges was last called */
+/* NOTE: Only meaningful while BlockEvents.BlockDefChanged is being raised */
+cc_bool Block_IsDefChanged(BlockID block);
 /* Resets all the properties of the given block to default */
 void Block_ResetProps(BlockID block);
 
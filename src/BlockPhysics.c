@@ -13,6 +13,8 @@
 #include "Logger.h"
 #include "Vectors.h"
 #include "Chat.h"
+#include "Utils.h"
+#define MEM_SUBSYSTEM MEM_SYS_WORLD
 
 /* Data for a resizable queue, used for liquid physic tick entries. */
 struct TickQueue {
@@ -86,22 +88,133 @@ static cc_uint32 TickQueue_Dequeue(struct TickQueue* queue) {
 }
 
 
+/* Number of slots in a tick wheel, must be a power of two greater than the longest delay + 1 */
+#define TICKWHEEL_SIZE 32
+/* Timing wheel of scheduled physics tick entries, where each slot holds the entries due on a given tick. */
+/* This way each physics tick only has to touch the entries that are actually due. */
+struct TickWheel {
+	struct TickQueue slots[TICKWHEEL_SIZE];
+	cc_uint8* scheduled; /* Bitset of positions with a pending entry, NULL if not allocated yet */
+	int tick; /* Index of the next tick to process */
+};
+
+static void TickWheel_Init(struct TickWheel* wheel) {
+	int i;
+	for (i = 0; i < TICKWHEEL_SIZE; i++) {
+		TickQueue_Init(&wheel->slots[i]);
+	}
+	wheel->scheduled = NULL;
+	wheel->tick      = 0;
+}
+
+static void TickWheel_Clear(struct TickWheel* wheel) {
+	int i;
+	for (i = 0; i < TICKWHEEL_SIZE; i++) {
+		TickQueue_Clear(&wheel->slots[i]);
+	}
+	Mem_Free(wheel->scheduled);
+	wheel->scheduled = NULL;
+	wheel->tick      = 0;
+}
+
+/* Schedules the given position to be processed after the given number of ticks. */
+/* NOTE: Positions that are already scheduled are ignored, as the earlier entry will process them anyways */
+static void TickWheel_Schedule(struct TickWheel* wheel, int index, int delay) {
+	cc_uint8 bit = 1 << (index & 7);
+	/* Bitset is allocated on demand, since most worlds never have any liquid activity */
+	if (!wheel->scheduled) {
+		wheel->scheduled = (cc_uint8*)Mem_TryAllocCleared((World.Volume + 7) >> 3, 1);
+	}
+
+	if (wheel->scheduled) {
+		if (wheel->scheduled[index >> 3] & bit) return;
+		wheel->scheduled[index >> 3] |= bit;
+	}
+	TickQueue_Enqueue(&wheel->slots[(wheel->tick + delay) & (TICKWHEEL_SIZE - 1)], (cc_uint32)index);
+}
+
+/* Returns the slot holding the entries due on the next tick, and advances the wheel */
+static struct TickQueue* TickWheel_NextSlot(struct TickWheel* wheel) {
+	struct TickQueue* slot = &wheel->slots[wheel->tick & (TICKWHEEL_SIZE - 1)];
+	wheel->tick++;
+	return slot;
+}
+
+/* Removes the next entry from the given slot, and returns its position */
+static int TickWheel_Dequeue(struct TickWheel* wheel, struct TickQueue* slot) {
+	int index = (int)TickQueue_Dequeue(slot);
+	if (wheel->scheduled) wheel->scheduled[index >> 3] &= ~(1 << (index & 7));
+	return index;
+}
+
+
 struct Physics_ Physics;
 static RNGState physics_rnd;
 static int physics_tickCount;
 static int physics_maxWaterX, physics_maxWaterY, physics_maxWaterZ;
-static struct TickQueue lavaQ, waterQ;
+static struct TickWheel lavaW, waterW;
+/* Number of blocks with a random tick handler in each chunk, or NULL if not calculated */
+static cc_uint16* physics_tickCounts;
+/* Dimensions of the world physics_tickCounts was calculated for */
+static int physics_countsX, physics_countsY, physics_countsZ;
+
+#define PHYSICS_LAVA_DELAY  30
+#define PHYSICS_WATER_DELAY 5
+
+static void Physics_FreeTickCounts(void) {
+	Mem_Free(physics_tickCounts);
+	physics_tickCounts = NULL;
+}
+
+/* Counts how many randomly tickable blocks are in each chunk of the world */
+static void Physics_CalcTickCounts(void) {
+	int x, y, z, index = 0;
+	BlockRaw block;
+	Physics_FreeTickCounts();
+	if (!World.Blocks) return;
+
+	physics_tickCounts = (cc_uint16*)Mem_TryAllocCleared(World.ChunksCount, 2);
+	if (!physics_tickCounts) return;
+	physics_countsX = World.Width; physics_countsY = World.Height; physics_countsZ = World.Length;
+
+	for (y = 0; y < World.Height; y++) {
+		for (z = 0; z < World.Length; z++) {
+			for (x = 0; x < World.Width; x++, index++) {
+				block = World.Blocks[index];
+				if (!Physics.OnRandomTick[block]) continue;
 
-#define PHYSICS_DELAY_MASK 0xF8000000UL
-#define PHYSICS_POS_MASK   0x07FFFFFFUL
-#define PHYSICS_DELAY_SHIFT 27
-#define PHYSICS_ONE_DELAY   (1U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_LAVA_DELAY (30U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_WATER_DELAY (5U << PHYSICS_DELAY_SHIFT)
+				physics_tickCounts[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)]++;
+			}
+		}
+	}
+}
+
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now) {
+	cc_uint16* count;
+	int tickOld, tickNow;
+	if (!physics_tickCounts) return;
+
+	/* World hasn't finished loading yet (counts are recalculated once it has) */
+	if (World.Width != physics_countsX || World.Height != physics_countsY || World.Length != physics_countsZ) return;
+
+	tickOld = Physics.OnRandomTick[(BlockRaw)old] != NULL;
+	tickNow = Physics.OnRandomTick[(BlockRaw)now] != NULL;
+	if (tickOld == tickNow) return;
+
+	count   = &physics_tickCounts[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+	*count += tickNow - tickOld;
+}
 
 static void Physics_OnNewMapLoaded(void* obj) {
-	TickQueue_Clear(&lavaQ);
-	TickQueue_Clear(&waterQ);
+	Physics_FinishTick();
+	TickWheel_Clear(&lavaW);
+	TickWheel_Clear(&waterW);
+
+	if (Physics.Enabled) {
+		Physics_CalcTickCounts();
+	} else {
+		Physics_FreeTickCounts();
+	}
 
 	physics_maxWaterX = World.MaxX - 2;
 	physics_maxWaterY = World.MaxY - 2;
@@ -144,6 +257,7 @@ void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 	PhysicsHandler handler;
 	int index;
 	if (!Physics.Enabled) return;
+	Physics_FinishTick();
 
 	if (now == BLOCK_AIR && Physics_IsEdgeWater(x, y, z)) {
 		now = BLOCK_STILL_WATER;
@@ -167,6 +281,7 @@ static void Physics_TickRandomBlocks(void) {
 	BlockID block;
 	PhysicsHandler tick;
 	int x, y, z, x2, y2, z2;
+	cc_uint16* counts = physics_tickCounts;
 
 	for (y = 0; y < World.Height; y += CHUNK_SIZE) {
 		y2 = min(y + CHUNK_MAX, World.MaxY);
@@ -175,6 +290,9 @@ static void Physics_TickRandomBlocks(void) {
 			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
 				x2 = min(x + CHUNK_MAX, World.MaxX);
 
+				/* Skip chunks with no randomly tickable blocks (e.g. all air or all stone) */
+				if (counts && !counts[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)]) continue;
+
 				/* Inlined 3 random ticks for this chunk */
 				lo = World_Pack( x,  y,  z);
 				hi = World_Pack(x2, y2, z2);
@@ -224,18 +342,6 @@ static void Physics_DoFalling(int index, BlockID block) {
 	Physics_ActivateNeighbours(x, y, z, start);
 }
 
-static cc_bool Physics_CheckItem(struct TickQueue* queue, int* posIndex) {
-	cc_uint32 item = TickQueue_Dequeue(queue);
-	*posIndex     = (int)(item & PHYSICS_POS_MASK);
-
-	if (item >= PHYSICS_ONE_DELAY) {
-		item -= PHYSICS_ONE_DELAY;
-		TickQueue_Enqueue(queue, item);
-		return false;
-	}
-	return true;
-}
-
 
 static void Physics_HandleSapling(int index, BlockID block) {
 	IVec3 coords[TREE_MAX_COUNT];
@@ -321,8 +427,53 @@ static void Physics_HandleMushroom(int index, BlockID block) {
 }
 
 
+/* Block changes made by the current liquid tick, which have not updated associated state yet */
+struct LiquidChange { cc_uint16 x, y, z; BlockID oldBlock, newBlock; };
+static struct LiquidChange* liquid_changes;
+static int liquid_count, liquid_capacity;
+
+/* Changes a block during a liquid tick, but defers updating associated state (e.g. lighting) */
+/*  until Physics_ApplyLiquidChanges, since liquid ticks may be run on the physics worker thread */
+static void Physics_SetLiquidBlock(int x, int y, int z, BlockID block) {
+	struct LiquidChange* c;
+	BlockID old = World_GetBlock(x, y, z);
+	World_SetBlock(x, y, z, block);
+	Physics_OnBlockUpdated(x, y, z, old, block);
+
+	if (liquid_count == liquid_capacity) {
+		Utils_Resize((void**)&liquid_changes, &liquid_capacity,
+			sizeof(struct LiquidChange), 256, 1024);
+	}
+	c = &liquid_changes[liquid_count++];
+	c->x = x; c->y = y; c->z = z;
+	c->oldBlock = old; c->newBlock = block;
+}
+
+static void Physics_ApplyLiquidChanges(void) {
+	struct LiquidChange* c;
+	int i;
+
+	/* Liquids may change many blocks in one tick, so lighting and chunk updates for them are batched */
+	Game_BeginBlockBatch();
+	for (i = 0; i < liquid_count; i++)
+	{
+		c = &liquid_changes[i];
+		Game_NotifyBlockUpdated(c->x, c->y, c->z, c->oldBlock, c->newBlock);
+	}
+	Game_EndBlockBatch();
+	liquid_count = 0;
+}
+
+static void Physics_FreeLiquidChanges(void) {
+	Mem_Free(liquid_changes);
+	liquid_changes  = NULL;
+	liquid_count    = 0;
+	liquid_capacity = 0;
+}
+
+
 static void Physics_PlaceLava(int index, BlockID block) {
-	TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | index);
+	TickWheel_Schedule(&lavaW, index, PHYSICS_LAVA_DELAY);
 }
 
 static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
@@ -331,11 +482,11 @@ static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
 	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
 		/* Lava spreading into water turns the water solid */
 		if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-			Game_UpdateBlock(x, y, z, BLOCK_STONE);
+			Physics_SetLiquidBlock(x, y, z, BLOCK_STONE);
 		}
 	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
-		TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | posIndex);
-		Game_UpdateBlock(x, y, z, BLOCK_LAVA);
+		TickWheel_Schedule(&lavaW, posIndex, PHYSICS_LAVA_DELAY);
+		Physics_SetLiquidBlock(x, y, z, BLOCK_LAVA);
 	}
 }
 
@@ -351,20 +502,18 @@ static void Physics_ActivateLava(int index, BlockID block) {
 }
 
 static void Physics_TickLava(void) {
-	int i, count = lavaQ.count;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&lavaQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
-			Physics_ActivateLava(index, block);
-		}
+	struct TickQueue* slot = TickWheel_NextSlot(&lavaW);
+	while (slot->count) {
+		int index = TickWheel_Dequeue(&lavaW, slot);
+		BlockID block = World.Blocks[index];
+		if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
+		Physics_ActivateLava(index, block);
 	}
 }
 
 
 static void Physics_PlaceWater(int index, BlockID block) {
-	TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | index);
+	TickWheel_Schedule(&waterW, index, PHYSICS_WATER_DELAY);
 }
 
 static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
@@ -374,7 +523,7 @@ static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
 	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
 		/* Water spreading into lava turns the lava solid */
 		if (block == BLOCK_LAVA || block == BLOCK_STILL_LAVA) {
-			Game_UpdateBlock(x, y, z, BLOCK_STONE);
+			Physics_SetLiquidBlock(x, y, z, BLOCK_STONE);
 		}
 	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
 		/* Sponge check */		
@@ -387,8 +536,8 @@ static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
 			}
 		}
 
-		TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | posIndex);
-		Game_UpdateBlock(x, y, z, BLOCK_WATER);
+		TickWheel_Schedule(&waterW, posIndex, PHYSICS_WATER_DELAY);
+		Physics_SetLiquidBlock(x, y, z, BLOCK_WATER);
 	}
 }
 
@@ -404,16 +553,98 @@ static void Physics_ActivateWater(int index, BlockID block) {
 }
 
 static void Physics_TickWater(void) {
-	int i, count = waterQ.count;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&waterQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
-			Physics_ActivateWater(index, block);
-		}
+	struct TickQueue* slot = TickWheel_NextSlot(&waterW);
+	while (slot->count) {
+		int index = TickWheel_Dequeue(&waterW, slot);
+		BlockID block = World.Blocks[index];
+		if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
+		Physics_ActivateWater(index, block);
+	}
+}
+
+static void Physics_TickLiquids(void) {
+	/*if ((tickCount % 5) == 0) {*/
+	Physics_TickLava();
+	Physics_TickWater();
+	/*}*/
+}
+
+
+#ifdef CC_BUILD_PHYSICSWORKER
+/* Liquid ticks only read and change blocks in the map and the liquid tick wheels, */
+/*  so they are simulated on a worker thread to avoid large floods causing frame drops */
+/* NOTE: While a liquid tick is being simulated, the main thread must not change blocks (see Physics_FinishTick) */
+static void* physics_thread;
+static void* physics_wakeup;
+static void* physics_done;
+static volatile cc_bool physics_finished, physics_quit;
+/* Whether the worker thread is simulating a liquid tick whose changes haven't been applied yet */
+static cc_bool physics_busy;
+
+static void PhysicsWorker_Run(void) {
+	for (;;)
+	{
+		Waitable_Wait(physics_wakeup);
+		if (physics_quit) return;
+
+		Physics_TickLiquids();
+		physics_finished = true;
+		Waitable_Signal(physics_done);
+	}
+}
+
+static void Physics_StartLiquidTick(void) {
+	if (!physics_thread) {
+		physics_wakeup = Waitable_Create("Physics worker wakeup");
+		physics_done   = Waitable_Create("Physics worker done");
+		Thread_Run(&physics_thread, PhysicsWorker_Run, 64 * 1024, "Physics worker");
 	}
+
+	physics_busy     = true;
+	physics_finished = false;
+	Waitable_Signal(physics_wakeup);
+}
+
+/* Waits for the liquid tick to finish without applying its block changes */
+static void Physics_WaitForWorker(void) {
+	if (!physics_busy) return;
+	Waitable_Wait(physics_done);
+	physics_busy = false;
+}
+
+void Physics_Update(void) {
+	if (physics_busy && physics_finished) Physics_FinishTick();
+}
+
+void Physics_FinishTick(void) {
+	if (!physics_busy) return;
+	Physics_WaitForWorker();
+	Physics_ApplyLiquidChanges();
+}
+
+static void Physics_StopWorker(void) {
+	Physics_WaitForWorker();
+	if (!physics_thread) return;
+
+	physics_quit = true;
+	Waitable_Signal(physics_wakeup);
+	Thread_Join(physics_thread);
+
+	Waitable_Free(physics_wakeup);
+	Waitable_Free(physics_done);
+	physics_thread = NULL;
+	physics_quit   = false;
 }
+#else
+static void Physics_StartLiquidTick(void) {
+	Physics_TickLiquids();
+	Physics_ApplyLiquidChanges();
+}
+
+void Physics_Update(void)     { }
+void Physics_FinishTick(void) { }
+static void Physics_StopWorker(void) { }
+#endif
 
 
 static void Physics_PlaceSponge(int index, BlockID block) {
@@ -447,7 +678,7 @@ static void Physics_DeleteSponge(int index, BlockID block) {
 					index = World_Pack(xx, yy, zz);
 					block = World.Blocks[index];
 					if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-						TickQueue_Enqueue(&waterQ, index | PHYSICS_ONE_DELAY);
+						TickWheel_Schedule(&waterW, index, 1);
 					}
 				}
 			}
@@ -492,6 +723,8 @@ static void Physics_HandleTnt(int index, BlockID block) {
 	int dx, dy, dz, xx, yy, zz;
 
 	World_Unpack(index, x, y, z);
+	/* Explosion changes many blocks at once, so only update lighting and chunks once afterwards */
+	Game_BeginBlockBatch();
 	Game_UpdateBlock(x, y, z, BLOCK_AIR);
 	Physics_ActivateNeighbours(x, y, z, index);
 	
@@ -507,18 +740,20 @@ static void Physics_HandleTnt(int index, BlockID block) {
 				block = World.Blocks[index];
 				if (BlocksTNT(block)) continue;
 
-				Game_UpdateBlock(xx, yy, zz, BLOCK_AIR);
+				/* No need to change blocks that are already air */
+				if (block != BLOCK_AIR) Game_UpdateBlock(xx, yy, zz, BLOCK_AIR);
 				Physics_ActivateNeighbours(xx, yy, zz, index);
 			}
 		}
 	}
+	Game_EndBlockBatch();
 }
 
 void Physics_Init(void) {
 	Event_Register_(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
 	Physics.Enabled = Options_GetBool(OPT_BLOCK_PHYSICS, true);
-	TickQueue_Init(&lavaQ);
-	TickQueue_Init(&waterQ);
+	TickWheel_Init(&lavaW);
+	TickWheel_Init(&waterW);
 
 	Physics.OnPlace[BLOCK_SAND]        = Physics_DoFalling;
 	Physics.OnPlace[BLOCK_GRAVEL]      = Physics_DoFalling;
@@ -559,15 +794,20 @@ void Physics_Init(void) {
 
 void Physics_Free(void) {
 	Event_Unregister_(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
+	/* Game may be shutting down, so any changes from the last liquid tick are just discarded */
+	Physics_StopWorker();
+	Physics_FreeLiquidChanges();
+	Physics_FreeTickCounts();
+	TickWheel_Clear(&lavaW);
+	TickWheel_Clear(&waterW);
 }
 
 void Physics_Tick(void) {
 	if (!Physics.Enabled || !World.Blocks) return;
-
-	/*if ((tickCount % 5) == 0) {*/
-	Physics_TickLava();
-	Physics_TickWater();
-	/*}*/
+	/* Random ticks change blocks on the main thread, so the previous liquid tick must be finished first */
+	/* NOTE: Random ticks are not batched, since e.g. grass checks lighting of the blocks above it */
+	Physics_FinishTick();
 	physics_tickCount++;
 	Physics_TickRandomBlocks();
+	Physics_StartLiquidTick();
 }
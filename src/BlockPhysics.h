@@ -25,9 +25,17 @@ CC_VAR extern struct Physics_ {
 
 void Physics_SetEnabled(cc_bool enabled);
 void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now);
+/* Called whenever a block in the world changes, to keep track of chunks with randomly tickable blocks. */
+/* NOTE: Changes made to Physics.OnRandomTick only take effect for these counts on next map load */
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now);
 void Physics_Init(void);
 void Physics_Free(void);
 void Physics_Tick(void);
+/* Applies the block changes from the last liquid tick, if the physics worker thread has finished simulating it */
+void Physics_Update(void);
+/* Waits for the physics worker thread to finish simulating the current liquid tick, then applies its block changes */
+/* NOTE: Must be called before the main thread changes blocks in the world */
+void Physics_FinishTick(void);
 
 CC_END_HEADER
 #endif
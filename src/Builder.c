@@ -13,6 +13,7 @@
 #include "TexturePack.h"
 #include "Game.h"
 #include "Options.h"
+#define MEM_SUBSYSTEM MEM_SYS_CHUNKS
 
 int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 16x16x16 count array. Coordinates range from 0 to 15. */
@@ -20,14 +21,15 @@ int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 18x18x18 chunk array. Coordinates range from -1 to 16. */
 #define Builder_PackChunk(xx, yy, zz) (((yy) + 1) * EXTCHUNK_SIZE_2 + ((zz) + 1) * EXTCHUNK_SIZE + ((xx) + 1))
 
-static BlockID* Builder_Chunk;
-static cc_uint8* Builder_Counts;
-static int* Builder_BitFlags;
-static int Builder_X, Builder_Y, Builder_Z;
-static BlockID Builder_Block;
-static int Builder_ChunkIndex;
-static cc_bool Builder_FullBright;
-static int Builder_ChunkEndX, Builder_ChunkEndZ;
+/* NOTE: Per-chunk state is thread local, as chunks may be meshed on several worker threads at once */
+static CC_THREADLOCAL BlockID* Builder_Chunk;
+static CC_THREADLOCAL cc_uint8* Builder_Counts;
+static CC_THREADLOCAL int* Builder_BitFlags;
+static CC_THREADLOCAL int Builder_X, Builder_Y, Builder_Z;
+static CC_THREADLOCAL BlockID Builder_Block;
+static CC_THREADLOCAL int Builder_ChunkIndex;
+static CC_THREADLOCAL cc_bool Builder_FullBright;
+static CC_THREADLOCAL int Builder_ChunkEndX, Builder_ChunkEndY, Builder_ChunkEndZ;
 static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
 
 static int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
@@ -49,8 +51,8 @@ struct Builder1DPart {
 
 /* Part builder data, for both normal and translucent parts.
 The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
-static struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
-static struct VertexTextured* Builder_Vertices;
+static CC_THREADLOCAL struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
+static CC_THREADLOCAL struct VertexTextured* Builder_Vertices;
 
 static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	int i, count = part->sCount;
@@ -86,6 +88,75 @@ static int Builder_TotalVerticesCount(void) {
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------------Chunk connectivity----------------------------------------------------*
+*#########################################################################################################################*/
+static CC_THREADLOCAL cc_uint16 conn_queue[CHUNK_SIZE_3];
+static CC_THREADLOCAL cc_bool conn_visited[CHUNK_SIZE_3];
+
+#define Connectivity_Visit(index, x, y, z) \
+if (!conn_visited[index] && !Block_RenderInfo[Builder_Chunk[Builder_PackChunk(x, y, z)]].fullOpaque) {\
+	conn_visited[index] = true; conn_queue[tail++] = index;\
+}
+
+/* Flood fills through non-opaque blocks from the given block, and returns which faces of the chunk were reached */
+static int Connectivity_Flood(int start, int maxX, int maxY, int maxZ) {
+	int head = 0, tail = 0, faces = 0;
+	int index, x, y, z;
+
+	conn_visited[start] = true;
+	conn_queue[tail++]  = start;
+
+	while (head < tail) {
+		index = conn_queue[head++];
+		x = index & CHUNK_MASK; z = (index >> 4) & CHUNK_MASK; y = index >> 8;
+
+		if (x == 0)    { faces |= FACE_BIT_XMIN; } else { Connectivity_Visit(index - 1, x - 1, y, z); }
+		if (x == maxX) { faces |= FACE_BIT_XMAX; } else { Connectivity_Visit(index + 1, x + 1, y, z); }
+		if (z == 0)    { faces |= FACE_BIT_ZMIN; } else { Connectivity_Visit(index - CHUNK_SIZE, x, y, z - 1); }
+		if (z == maxZ) { faces |= FACE_BIT_ZMAX; } else { Connectivity_Visit(index + CHUNK_SIZE, x, y, z + 1); }
+		if (y == 0)    { faces |= FACE_BIT_YMIN; } else { Connectivity_Visit(index - CHUNK_SIZE_2, x, y - 1, z); }
+		if (y == maxY) { faces |= FACE_BIT_YMAX; } else { Connectivity_Visit(index + CHUNK_SIZE_2, x, y + 1, z); }
+	}
+	return faces;
+}
+
+static int Connectivity_FacePairs(int faces) {
+	int a, b, flags = 0;
+
+	for (a = 0; a < FACE_COUNT; a++) {
+		if (!(faces & (1 << a))) continue;
+
+		for (b = a + 1; b < FACE_COUNT; b++) {
+			if (faces & (1 << b)) flags |= Chunk_FacesBit(a, b);
+		}
+	}
+	return flags;
+}
+
+/* Calculates which pairs of the chunk's faces can be seen through each other (via non-opaque blocks) */
+static cc_uint16 ComputeConnectivity(int x1, int y1, int z1) {
+	int maxX = min(World.Width,  x1 + CHUNK_SIZE) - x1 - 1;
+	int maxY = min(World.Height, y1 + CHUNK_SIZE) - y1 - 1;
+	int maxZ = min(World.Length, z1 + CHUNK_SIZE) - z1 - 1;
+	int x, y, z, index, flags = 0;
+	Mem_Set(conn_visited, 0, sizeof(conn_visited));
+
+	for (y = 0; y <= maxY; y++) {
+		for (z = 0; z <= maxZ; z++) {
+			for (x = 0; x <= maxX; x++) {
+				index = (y << 8) | (z << 4) | x;
+				if (conn_visited[index] || Block_RenderInfo[Builder_Chunk[Builder_PackChunk(x, y, z)]].fullOpaque) continue;
+
+				flags |= Connectivity_FacePairs(Connectivity_Flood(index, maxX, maxY, maxZ));
+				if (flags == CHUNK_ALL_CONNECTED) return flags;
+			}
+		}
+	}
+	return flags;
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------Base mesh builder----------------------------------------------------*
 *#########################################################################################################################*/
@@ -96,7 +167,7 @@ static void AddSpriteVertices(BlockID block) {
 }
 
 static void AddVertices(BlockID block, Face face) {
-	int baseOffset = (Blocks.Draw[block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	int baseOffset = (Block_RenderInfo[block].draw == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
 	int i = Atlas1D_Index(Block_Tex(block, face));
 	struct Builder1DPart* part = &Builder_Parts[baseOffset + i];
 	part->faces.count[face] += 4;
@@ -154,20 +225,6 @@ static void PrepareChunk(int x1, int y1, int z1) {
 	int cIndex, index, tileIdx;
 	BlockID b;
 	int x, y, z, xx, yy, zz;
-
-#ifdef OCCLUSION
-	int flags = ComputeOcclusion();
-#endif
-#ifdef DEBUG_OCCLUSION
-	FastColour col = new FastColour(60, 60, 60, 255);
-	if (flags & 1) col.R = 255; /* x */
-	if (flags & 4) col.G = 255; /* y */
-	if (flags & 2) col.B = 255; /* z */
-	map.Sunlight = map.Shadowlight = col;
-	map.SunlightXSide = map.ShadowlightXSide = col;
-	map.SunlightZSide = map.ShadowlightZSide = col;
-	map.SunlightYBottom = map.ShadowlightYBottom = col;
-#endif
 	
 	for (y = y1, yy = 0; y < yMax; y++, yy++) {
 		for (z = z1, zz = 0; z < zMax; z++, zz++) {
@@ -175,15 +232,15 @@ static void PrepareChunk(int x1, int y1, int z1) {
 
 			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
 				b = Builder_Chunk[cIndex];
-				if (Blocks.Draw[b] == DRAW_GAS) continue;
+				if (Block_RenderInfo[b].draw == DRAW_GAS) continue;
 				index = Builder_PackCount(xx, yy, zz);
 
 				/* Sprites can't be stretched, nor can then be they hidden by other blocks. */
 				/* Note sprites are drawn using DrawSprite and not with any of the DrawXFace. */
-				if (Blocks.Draw[b] == DRAW_SPRITE) { AddSpriteVertices(b); continue; }
+				if (Block_RenderInfo[b].draw == DRAW_SPRITE) { AddSpriteVertices(b); continue; }
 
 				Builder_X = x; Builder_Y = y; Builder_Z = z;
-				Builder_FullBright = Blocks.Brightness[b];
+				Builder_FullBright = Block_RenderInfo[b].brightness;
 				tileIdx = b * BLOCK_COUNT;
 				/* All of these function calls are inlined as they can be called tens of millions to hundreds of millions of times. */
 
@@ -254,17 +311,18 @@ for (yy = -1; yy < 17; ++yy) {\
 		for (xx = -1; xx < 17; ++xx, ++index, ++cIndex) {\
 \
 			block    = get_block;\
-			allAir   = allAir   && Blocks.Draw[block] == DRAW_GAS;\
-			allSolid = allSolid && Blocks.FullOpaque[block];\
+			allAir   = allAir   && Block_RenderInfo[block].draw == DRAW_GAS;\
+			allSolid = allSolid && Block_RenderInfo[block].fullOpaque;\
+			blockBits |= ChunkInfo_BlockBit(block);\
 			Builder_Chunk[cIndex] = block;\
 		}\
 	}\
 }
 
-static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir, cc_uint32* outBlockBits) {
 	BlockRaw* blocks = World.Blocks;
-	BlockRaw* blocks2;
 	cc_bool allAir = true, allSolid = true;
+	cc_uint32 blockBits = 0;
 	int index, cIndex;
 	BlockID block;
 	int xx, yy, zz, y;
@@ -272,15 +330,15 @@ static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 #ifndef EXTENDED_BLOCKS
 	ReadChunkBody(blocks[index]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World_HasUpperBlocks(x1 - 1, y1 - 1, z1 - 1, x1 + CHUNK_SIZE, y1 + CHUNK_SIZE, z1 + CHUNK_SIZE)) {
 		ReadChunkBody(blocks[index]);
 	} else {
-		blocks2 = World.Blocks2;
-		ReadChunkBody(blocks[index] | (blocks2[index] << 8));
+		ReadChunkBody(World_GetRawBlock(index));
 	}
 #endif
 
-	*outAllAir = allAir;
+	*outAllAir    = allAir;
+	*outBlockBits = blockBits;
 	return allSolid;
 }
 
@@ -304,16 +362,18 @@ for (yy = -1; yy < 17; ++yy) {\
 			if (x >= World.Width) break;\
 \
 			block  = get_block;\
-			allAir = allAir && Blocks.Draw[block] == DRAW_GAS;\
+			allAir = allAir && Block_RenderInfo[block].draw == DRAW_GAS;\
+			blockBits |= ChunkInfo_BlockBit(block);\
 			Builder_Chunk[cIndex] = block;\
 		}\
 	}\
 }
 
-static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir, cc_uint32* outBlockBits) {
 	BlockRaw* blocks = World.Blocks;
-	BlockRaw* blocks2;
 	cc_bool allAir = true;
+	/* Blocks outside the map are treated as air */
+	cc_uint32 blockBits = ChunkInfo_BlockBit(BLOCK_AIR);
 	int index, cIndex;
 	BlockID block;
 	int xx, yy, zz, x, y, z;
@@ -321,15 +381,15 @@ static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 #ifndef EXTENDED_BLOCKS
 	ReadBorderChunkBody(blocks[index]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World_HasUpperBlocks(x1 - 1, y1 - 1, z1 - 1, x1 + CHUNK_SIZE, y1 + CHUNK_SIZE, z1 + CHUNK_SIZE)) {
 		ReadBorderChunkBody(blocks[index]);
 	} else {
-		blocks2 = World.Blocks2;
-		ReadBorderChunkBody(blocks[index] | (blocks2[index] << 8));
+		ReadBorderChunkBody(World_GetRawBlock(index));
 	}
 #endif
 
-	*outAllAir = allAir;
+	*outAllAir    = allAir;
+	*outBlockBits = blockBits;
 	return false;
 }
 
@@ -359,71 +419,109 @@ static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
 	}
 }
 
-void Builder_MakeChunk(struct ChunkInfo* info) {
-#ifdef CC_BUILD_TINYSTACK
-	/* The Saturn build only has 16 kb stack, not large enough */
-	static BlockID chunk[EXTCHUNK_SIZE_3]; 
-	static cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
-	static int bitFlags[1];
-#else
-	BlockID chunk[EXTCHUNK_SIZE_3]; 
-	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
-	int bitFlags[EXTCHUNK_SIZE_3];
-#endif
-
-	cc_bool allAir, allSolid, onBorder;
-	int xMax, yMax, zMax, totalVerts;
-	int cIndex, index;
-	int x, y, z, xx, yy, zz;
-	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
-
-	Builder_Chunk  = chunk;
-	Builder_Counts = counts;
-	Builder_BitFlags = bitFlags;
-	Builder_PrePrepareChunk();
-	
-	onBorder = 
+/* Copies the blocks in and around the given chunk into Builder_Chunk */
+/* NOTE: outBlockBits is set to which blocks were copied (see ChunkInfo_BlockBit) */
+static cc_bool ReadChunk(int x1, int y1, int z1, cc_bool* outAllAir, cc_uint32* outBlockBits) {
+	cc_bool onBorder = 
 		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
 		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
 
+	/* Empty sections (e.g. sky above the map) don't need to be read at all */
+	if (World_GetSectionBlock(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT) == BLOCK_AIR) {
+		*outAllAir    = true; 
+		*outBlockBits = ChunkInfo_BlockBit(BLOCK_AIR);
+		return false;
+	}
+
 	if (onBorder) {
 		/* less optimal case here */
-		Mem_Set(chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
-		allSolid = ReadBorderChunkData(x1, y1, z1, &allAir);
-	} else {
-		allSolid = ReadChunkData(x1, y1, z1, &allAir);
+		Mem_Set(Builder_Chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+		return ReadBorderChunkData(x1, y1, z1, outAllAir, outBlockBits);
 	}
+	return ReadChunkData(x1, y1, z1, outAllAir, outBlockBits);
+}
 
-	info->allAir = allAir;
-	if (allAir || allSolid) return;
-	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
+/* Returns the block that a cell of blocks is collapsed into when meshing at reduced detail */
+/*  (i.e. the topmost opaque block, otherwise the topmost non-sprite block, otherwise air) */
+static BlockID CollapseCell(int x1, int y1, int z1, int x2, int y2, int z2) {
+	BlockID block, top = BLOCK_AIR;
+	cc_bool hasTop = false;
+	int x, y, z, cIndex;
+
+	for (y = y2 - 1; y >= y1; y--) {
+		for (z = z1; z < z2; z++) {
+			cIndex = Builder_PackChunk(x1, y, z);
+
+			for (x = x1; x < x2; x++, cIndex++) {
+				block = Builder_Chunk[cIndex];
+				/* Always preferring opaque blocks ensures faces of adjacent chunks are never wrongly exposed */
+				if (Block_RenderInfo[block].fullOpaque) return block;
+				if (hasTop || Block_RenderInfo[block].draw == DRAW_GAS || Block_RenderInfo[block].draw == DRAW_SPRITE) continue;
+
+				top = block; hasTop = true;
+			}
+		}
+	}
+	return top;
+}
+
+/* Replaces the blocks in each (size x size x size) cell of the chunk with a single block, */
+/*  so that the meshes of far away chunks have much fewer faces */
+/* NOTE: Blocks in the border around the chunk are left unchanged */
+static void CollapseChunk(int x1, int y1, int z1, int size) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE) - x1;
+	int yMax = min(World.Height, y1 + CHUNK_SIZE) - y1;
+	int zMax = min(World.Length, z1 + CHUNK_SIZE) - z1;
+	int x, y, z, xx, yy, zz, x2, y2, z2, cIndex;
+	BlockID block;
+
+	for (yy = 0; yy < yMax; yy += size) {
+		y2 = min(yy + size, yMax);
+		for (zz = 0; zz < zMax; zz += size) {
+			z2 = min(zz + size, zMax);
+			for (xx = 0; xx < xMax; xx += size) {
+				x2    = min(xx + size, xMax);
+				block = CollapseCell(xx, yy, zz, x2, y2, z2);
+
+				for (y = yy; y < y2; y++) {
+					for (z = zz; z < z2; z++) {
+						cIndex = Builder_PackChunk(xx, y, z);
+						for (x = xx; x < x2; x++) Builder_Chunk[cIndex++] = block;
+					}
+				}
+			}
+		}
+	}
+}
 
-	Mem_Set(counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
-	xMax = min(World.Width,  x1 + CHUNK_SIZE);
-	yMax = min(World.Height, y1 + CHUNK_SIZE);
-	zMax = min(World.Length, z1 + CHUNK_SIZE);
+/* Calculates which faces of blocks in the chunk are visible, and returns number of vertices in chunk mesh */
+static int CountChunk(int x1, int y1, int z1, struct ChunkInfo* info) {
+	int totalVerts;
+	Mem_Set(Builder_Counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
 
-	Builder_ChunkEndX = xMax; Builder_ChunkEndZ = zMax;
+	Builder_ChunkEndX = min(World.Width,  x1 + CHUNK_SIZE);
+	Builder_ChunkEndY = min(World.Height, y1 + CHUNK_SIZE);
+	Builder_ChunkEndZ = min(World.Length, z1 + CHUNK_SIZE);
 	PrepareChunk(x1, y1, z1);
 
 	totalVerts = Builder_TotalVerticesCount();
-	if (!totalVerts) return;
+	if (!totalVerts) return 0;
 	
 	OutputChunkPartsMeta(x1, y1, z1, info);
-#ifdef OCCLUSION
-	if (info.NormalParts != null || info.TranslucentParts != null)
-		info.occlusionFlags = (cc_uint8)ComputeOcclusion();
-#endif
+	return totalVerts;
+}
+
+/* Outputs the vertices of all visible block faces in the chunk into Builder_Vertices */
+/* NOTE: Also updates the chunk's bounds to only the blocks that it actually has a mesh for */
+static void RenderChunk(struct ChunkInfo* info, int x1, int y1, int z1) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	int yMax = min(World.Height, y1 + CHUNK_SIZE);
+	int zMax = min(World.Length, z1 + CHUNK_SIZE);
+	int minX = xMax, minY = yMax, minZ = zMax;
+	int maxX = x1,   maxY = y1,   maxZ = z1;
+	int cIndex, index;
+	int x, y, z, xx, yy, zz;
 
-#ifndef CC_BUILD_GL11
-	/* add an extra element to fix crashing on some GPUs */
-	Builder_Vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
-													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
-#else
-	/* NOTE: Relies on assumption vb is ignored by GL11 Gfx_LockVb implementation */
-	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
-													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
-#endif
 	Builder_PostPrepareChunk();
 	/* now render the chunk */
 
@@ -432,18 +530,25 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 			cIndex = Builder_PackChunk(0, yy, zz);
 
 			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				Builder_Block = chunk[cIndex];
-				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
+				Builder_Block = Builder_Chunk[cIndex];
+				if (Block_RenderInfo[Builder_Block].draw == DRAW_GAS) continue;
 
 				index = Builder_PackCount(xx, yy, zz);
 				Builder_ChunkIndex = cIndex;
 				Builder_RenderBlock(index, x, y, z);
+
+				minX = min(minX, x); maxX = max(maxX, x + 1);
+				minY = min(minY, y); maxY = max(maxY, y + 1);
+				minZ = min(minZ, z); maxZ = max(maxZ, z + 1);
 			}
 		}
 	}
+	MapRenderer_SetChunkBounds(info, minX, minY, minZ, maxX, maxY, maxZ);
+}
 
 #ifdef CC_BUILD_GL11
-	cIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
+static void BuildChunkVbs(int x1, int y1, int z1) {
+	int index, cIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
 
 	for (index = 0; index < MapRenderer_1DUsedCount; index++) {
 		int curIdx = cIndex + index * World.ChunksCount;
@@ -451,19 +556,226 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 		BuildPartVbs(&MapRenderer_PartsNormal[curIdx]);
 		BuildPartVbs(&MapRenderer_PartsTranslucent[curIdx]);
 	}
+}
+#endif
+
+#ifdef CC_BUILD_CHUNKARENA
+static struct VertexTextured* meshVertices;
+static int meshCapacity;
+
+#define PackChunkCoord(value, scale) (cc_int16)Math_Floor((value) * (scale) + 0.5f)
+/* Converts vertices into fixed point vertices relative to the chunk origin */
+/* NOTE: dst can be the same as src, since each vertex is read before being overwritten */
+static void PackChunkVertices(void* dst, const struct VertexTextured* src, int count, int x1, int y1, int z1) {
+	struct VertexChunk* v = (struct VertexChunk*)dst;
+	struct VertexTextured cur;
+	int i;
+
+	for (i = 0; i < count; i++, v++)
+	{
+		cur = src[i];
+		v->x   = PackChunkCoord(cur.x - x1, VERTEX_CHUNK_POS_SCALE);
+		v->y   = PackChunkCoord(cur.y - y1, VERTEX_CHUNK_POS_SCALE);
+		v->z   = PackChunkCoord(cur.z - z1, VERTEX_CHUNK_POS_SCALE);
+		v->pad = 0;
+		v->Col = cur.Col;
+		v->U   = PackChunkCoord(cur.U, VERTEX_CHUNK_U_SCALE);
+		v->V   = PackChunkCoord(cur.V, VERTEX_CHUNK_V_SCALE);
+	}
+}
+
+/* Meshes into temp memory first, since the chunk's range in the arena is only allocated when uploading */
+static void ArenaMakeChunk(struct ChunkInfo* info, int x1, int y1, int z1, int totalVerts) {
+	if (totalVerts > meshCapacity) {
+		meshVertices = (struct VertexTextured*)Mem_Realloc(meshVertices, totalVerts,
+												SIZEOF_VERTEX_TEXTURED, "chunk vertices");
+		meshCapacity = totalVerts;
+	}
+
+	Builder_Vertices = meshVertices;
+	RenderChunk(info, x1, y1, z1);
+
+	if (Gfx.SupportsChunkVertices) PackChunkVertices(meshVertices, meshVertices, totalVerts, x1, y1, z1);
+	MapRenderer_UploadChunk(info, meshVertices, totalVerts);
+}
+#endif
+
+void Builder_MakeChunk(struct ChunkInfo* info) {
+#ifdef CC_BUILD_TINYSTACK
+	/* The Saturn build only has 16 kb stack, not large enough */
+	static BlockID chunk[EXTCHUNK_SIZE_3]; 
+	static cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+	static int bitFlags[1];
 #else
+	BlockID chunk[EXTCHUNK_SIZE_3]; 
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+	int bitFlags[EXTCHUNK_SIZE_3];
+#endif
+
+	cc_bool allAir, allSolid;
+	cc_uint32 blockBits;
+	int totalVerts;
+	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+
+	Builder_Chunk  = chunk;
+	Builder_Counts = counts;
+	Builder_BitFlags = bitFlags;
+	Builder_PrePrepareChunk();
+	allSolid = ReadChunk(x1, y1, z1, &allAir, &blockBits);
+
+	info->allAir    = allAir;
+	info->blockBits = blockBits;
+	info->connectivity = allAir ? CHUNK_ALL_CONNECTED : (allSolid ? 0 : ComputeConnectivity(x1, y1, z1));
+	if (allAir || allSolid) return;
+	if (info->lod) CollapseChunk(x1, y1, z1, 1 << info->lod);
+	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
+
+	totalVerts = CountChunk(x1, y1, z1, info);
+	if (!totalVerts) return;
+
+#if defined CC_BUILD_CHUNKARENA
+	ArenaMakeChunk(info, x1, y1, z1, totalVerts);
+#elif !defined CC_BUILD_GL11
+	/* add an extra element to fix crashing on some GPUs */
+	Builder_Vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
+													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+	RenderChunk(info, x1, y1, z1);
 	Gfx_UnlockVb(info->vb);
+#else
+	/* NOTE: Relies on assumption vb is ignored by GL11 Gfx_LockVb implementation */
+	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
+													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+	RenderChunk(info, x1, y1, z1);
+	BuildChunkVbs(x1, y1, z1);
 #endif
 }
 
+#ifdef CC_BUILD_MESHWORKERS
+#define Job_GetCoords(job) x1 = job->info->centreX - 8; y1 = job->info->centreY - 8; z1 = job->info->centreZ - 8;
+
+/* Maximum number of times to read a chunk's blocks again if they were changed while being read */
+/* NOTE: Changed blocks also mark the chunk for rebuilding, so a stale read is never kept for long */
+#define BUILDER_MAX_READ_RETRIES 3
+
+void Builder_ReadJob(struct BuilderJob* job) {
+	cc_bool allAir, allSolid;
+	cc_uint32 blockBits;
+	int x1, y1, z1, retries = 0;
+	cc_uint32 stamp;
+	Job_GetCoords(job);
+	Builder_Chunk = job->chunk;
+
+	/* Blocks may be changed (e.g. by physics or network) while they are being copied */
+	do {
+		stamp    = World_GetVersionStamp(x1 - 1, y1 - 1, z1 - 1, x1 + CHUNK_SIZE, y1 + CHUNK_SIZE, z1 + CHUNK_SIZE);
+		allSolid = ReadChunk(x1, y1, z1, &allAir, &blockBits);
+	} while (stamp != World_GetVersionStamp(x1 - 1, y1 - 1, z1 - 1, x1 + CHUNK_SIZE, y1 + CHUNK_SIZE, z1 + CHUNK_SIZE)
+			&& ++retries < BUILDER_MAX_READ_RETRIES);
+
+	job->info->allAir    = allAir;
+	job->info->blockBits = blockBits;
+	job->info->connectivity = allAir ? CHUNK_ALL_CONNECTED : (allSolid ? 0 : ComputeConnectivity(x1, y1, z1));
+	job->hasMesh      = !allAir && !allSolid;
+	job->verticesCount = 0;
+}
+
+void Builder_QueueLightJob(struct BuilderJob* job) {
+	int x1, y1, z1;
+	if (!job->hasMesh) return;
+
+	Job_GetCoords(job);
+	Lighting.QueueHint(x1 - 1, y1 - 1, z1 - 1);
+}
+
+void Builder_LightJob(struct BuilderJob* job) {
+	int x1, y1, z1;
+	if (!job->hasMesh) return;
+
+	Job_GetCoords(job);
+	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
+}
+
+void Builder_MeshJob(struct BuilderJob* job) {
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+	int bitFlags[EXTCHUNK_SIZE_3];
+	int x1, y1, z1, totalVerts;
+	if (!job->hasMesh) return;
+	Job_GetCoords(job);
+
+	Builder_Chunk  = job->chunk;
+	Builder_Counts = counts;
+	Builder_BitFlags = bitFlags;
+	Builder_PrePrepareChunk();
+	if (job->info->lod) CollapseChunk(x1, y1, z1, 1 << job->info->lod);
+
+	totalVerts = CountChunk(x1, y1, z1, job->info);
+	if (!totalVerts) return;
+
+	/* add an extra element to fix crashing on some GPUs */
+	if (totalVerts + 1 > job->verticesCapacity) {
+		job->vertices = (struct VertexTextured*)Mem_Realloc(job->vertices, totalVerts + 1, 
+												SIZEOF_VERTEX_TEXTURED, "chunk vertices");
+		job->verticesCapacity = totalVerts + 1;
+	}
+
+	Builder_Vertices = job->vertices;
+	RenderChunk(job->info, x1, y1, z1);
+	job->verticesCount = totalVerts;
+
+#if defined CC_BUILD_CHUNKARENA
+	if (Gfx.SupportsChunkVertices) PackChunkVertices(job->vertices, job->vertices, totalVerts, x1, y1, z1);
+#elif !defined CC_BUILD_GL11
+	/* Avoids the main thread having to copy the vertices into the vertex buffer */
+	if (Gfx.SupportsThreadedVbCreation) {
+		job->vb = Gfx_CreateVbFrom(job->vertices, VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+	}
+#endif
+}
+
+void Builder_UploadJob(struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	int count = job->verticesCount;
+#if !defined CC_BUILD_GL11 && !defined CC_BUILD_CHUNKARENA
+	void* data;
+#endif
+	if (!count) return;
+
+#if defined CC_BUILD_CHUNKARENA
+	/* Vertices were already packed by Builder_MeshJob when chunk vertices are supported */
+	MapRenderer_UploadChunk(info, job->vertices, count);
+#elif !defined CC_BUILD_GL11
+	if (job->vb) {
+		Gfx_DeleteVb(&info->vb);
+		info->vb = job->vb;
+		job->vb  = 0;
+		return;
+	}
+
+	data = Gfx_RecreateAndLockVb(&info->vb, VERTEX_FORMAT_TEXTURED, count + 1);
+	Mem_Copy(data, job->vertices, count * SIZEOF_VERTEX_TEXTURED);
+	Gfx_UnlockVb(info->vb);
+#else
+	Builder_Vertices = job->vertices;
+	BuildChunkVbs(info->centreX - 8, info->centreY - 8, info->centreZ - 8);
+#endif
+}
+
+void Builder_FreeJob(struct BuilderJob* job) {
+	Gfx_DeleteVb(&job->vb);
+	Mem_Free(job->vertices);
+	job->vertices = NULL;
+	job->verticesCapacity = 0;
+}
+#endif
+
 static cc_bool Builder_OccludedLiquid(int chunkIndex) {
 	chunkIndex += EXTCHUNK_SIZE_2; /* Checking y above */
 	return
-		Blocks.FullOpaque[Builder_Chunk[chunkIndex]]
-		&& Blocks.Draw[Builder_Chunk[chunkIndex - EXTCHUNK_SIZE]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex - 1]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex + 1]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex + EXTCHUNK_SIZE]] != DRAW_GAS;
+		Block_RenderInfo[Builder_Chunk[chunkIndex]].fullOpaque
+		&& Block_RenderInfo[Builder_Chunk[chunkIndex - EXTCHUNK_SIZE]].draw != DRAW_GAS
+		&& Block_RenderInfo[Builder_Chunk[chunkIndex - 1]].draw != DRAW_GAS
+		&& Block_RenderInfo[Builder_Chunk[chunkIndex + 1]].draw != DRAW_GAS
+		&& Block_RenderInfo[Builder_Chunk[chunkIndex + EXTCHUNK_SIZE]].draw != DRAW_GAS;
 }
 
 static void DefaultPrePrepateChunk(void) {
@@ -481,7 +793,7 @@ static void DefaultPostStretchChunk(void) {
 	}
 }
 
-static RNGState spriteRng;
+static CC_THREADLOCAL RNGState spriteRng;
 static void Builder_DrawSprite(int x, int y, int z) {
 	struct Builder1DPart* part;
 	struct VertexTextured* v;
@@ -505,7 +817,7 @@ static void Builder_DrawSprite(int x, int y, int z) {
 	v1  = Atlas1D_RowId(loc) * Atlas1D.InvTileSize;
 	v2  = v1 + Atlas1D.InvTileSize * UV2_Scale;
 
-	offsetType = Blocks.SpriteOffset[Builder_Block];
+	offsetType = Block_RenderInfo[Builder_Block].spriteOffset;
 	if (offsetType >= 6 && offsetType <= 7) {
 		Random_Seed(&spriteRng, (x + 1217 * z) & 0x7fffffff);
 		valX = Random_Range(&spriteRng, -3, 3 + 1) / 16.0f;
@@ -517,7 +829,7 @@ static void Builder_DrawSprite(int x, int y, int z) {
 		if (offsetType == 7) { y1 -= valY; y2 -= valY; }
 	}
 	
-	bright = Blocks.Brightness[Builder_Block];
+	bright = Block_RenderInfo[Builder_Block].brightness;
 	part   = &Builder_Parts[Atlas1D_Index(loc)];
 	color  = bright ? PACKEDCOL_WHITE : Lighting.Color_Sprite_Fast(x, y, z);
 	Block_Tint(color, Builder_Block);
@@ -558,7 +870,7 @@ static void Builder_DrawSprite(int x, int y, int z) {
 *--------------------------------------------------Normal mesh builder----------------------------------------------------*
 *#########################################################################################################################*/
 static PackedCol Normal_LightColor(int x, int y, int z, Face face, BlockID block) {
-	int offset = (Blocks.LightOffset[block] >> face) & 1;
+	int offset = (Block_RenderInfo[block].lightOffset >> face) & 1;
 
 	switch (face) {
 	case FACE_XMIN:
@@ -594,7 +906,7 @@ static int NormalBuilder_StretchXLiquid(int countIndex, int x, int y, int z, int
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
-	stretchTile = (Blocks.CanStretch[block] & (1 << FACE_YMAX)) != 0;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << FACE_YMAX)) != 0;
 
 	while (x < Builder_ChunkEndX && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(chunkIndex)) {
 		Builder_Counts[countIndex] = 0;
@@ -612,7 +924,7 @@ static int NormalBuilder_StretchX(int countIndex, int x, int y, int z, int chunk
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
-	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << face)) != 0;
 
 	while (x < Builder_ChunkEndX && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, face)) {
 		Builder_Counts[countIndex] = 0;
@@ -630,7 +942,7 @@ static int NormalBuilder_StretchZ(int countIndex, int x, int y, int z, int chunk
 	z++;
 	chunkIndex += EXTCHUNK_SIZE;
 	countIndex += CHUNK_SIZE * FACE_COUNT;
-	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << face)) != 0;
 
 	while (z < Builder_ChunkEndZ && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, face)) {
 		Builder_Counts[countIndex] = 0;
@@ -659,7 +971,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	PackedCol col;
 	int offset;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
+	if (Block_RenderInfo[Builder_Block].draw == DRAW_SPRITE) {
 		Builder_DrawSprite(x, y, z); return;
 	}
 
@@ -673,9 +985,9 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	fullBright = Blocks.Brightness[Builder_Block];
-	baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	lightFlags = Blocks.LightOffset[Builder_Block];
+	fullBright = Block_RenderInfo[Builder_Block].brightness;
+	baseOffset = (Block_RenderInfo[Builder_Block].draw == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	lightFlags = Block_RenderInfo[Builder_Block].lightOffset;
 
 	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.y = 1.0f - Drawer.MinBB.y;
 	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.y = 1.0f - Drawer.MaxBB.y;
@@ -684,8 +996,8 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	Drawer.X1 = x + min.x; Drawer.Y1 = y + min.y; Drawer.Z1 = z + min.z;
 	Drawer.X2 = x + max.x; Drawer.Y2 = y + max.y; Drawer.Z2 = z + max.z;
 
-	Drawer.Tinted  = Blocks.Tinted[Builder_Block];
-	Drawer.TintCol = Blocks.FogCol[Builder_Block];
+	Drawer.Tinted  = Block_RenderInfo[Builder_Block].tinted;
+	Drawer.TintCol = Block_RenderInfo[Builder_Block].fogCol;
 
 	if (count_XMin) {
 		loc    = Block_Tex(Builder_Block, FACE_XMIN);
@@ -765,16 +1077,204 @@ static void NormalBuilder_SetActive(void) {
 }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------Greedy mesh builder----------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of rows that the face starting at each block was merged across */
+/* NOTE: Only valid for block faces where Builder_Counts is non-zero */
+static CC_THREADLOCAL cc_uint8 Greedy_Rows[CHUNK_SIZE_3 * FACE_COUNT];
+
+static cc_bool Greedy_CanStretch(BlockID initial, int countIndex, int chunkIndex, int x, int y, int z, Face face) {
+	/* Faces already merged into a face from an earlier row have a count of 0 */
+	return Builder_Counts[countIndex] && Normal_CanStretch(initial, chunkIndex, x, y, z, face);
+}
+
+/* Whether faces of the given block can be merged with the faces in the next rows */
+/* (i.e. along Z axis for top/bottom faces, and along Y axis for side faces) */
+static cc_bool Greedy_CanMergeRows(BlockID block, Face face) {
+	Vec3 min = Blocks.MinBB[block], max = Blocks.MaxBB[block];
+	/* 1D atlases only repeat tiles horizontally, so merged faces stretch the tile vertically instead */
+	if (!Atlas2D.RowsUniform[Block_Tex(block, face)]) return false;
+
+	if (face >= FACE_YMIN) return min.z == 0.0f && max.z == 1.0f;
+	return min.y == 0.0f && max.y == 1.0f;
+}
+
+/* Merges the faces in following rows that exactly match the given row of faces */
+static void Greedy_MergeRows(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face, int count, cc_bool liquid) {
+	int spanX, spanZ, spanChunk, spanCount;
+	int rowY, rowZ, rowChunk, rowCount;
+	int i, rows, maxRows, cx, cz, cIndex, index;
+	if (!Greedy_CanMergeRows(block, face)) { Greedy_Rows[countIndex] = 1; return; }
+
+	if (face <= FACE_XMAX) {
+		spanX = 0; spanZ = 1; spanChunk = EXTCHUNK_SIZE; spanCount = CHUNK_SIZE * FACE_COUNT;
+	} else {
+		spanX = 1; spanZ = 0; spanChunk = 1;             spanCount = FACE_COUNT;
+	}
+
+	if (face >= FACE_YMIN) {
+		rowY = 0; rowZ = 1; rowChunk = EXTCHUNK_SIZE;   rowCount = CHUNK_SIZE   * FACE_COUNT;
+		maxRows = Builder_ChunkEndZ - z;
+	} else {
+		rowY = 1; rowZ = 0; rowChunk = EXTCHUNK_SIZE_2; rowCount = CHUNK_SIZE_2 * FACE_COUNT;
+		maxRows = Builder_ChunkEndY - y;
+	}
+
+	for (rows = 1; rows < maxRows; rows++) {
+		cx     = x; cz = z + rows * rowZ;
+		cIndex = chunkIndex + rows * rowChunk;
+		index  = countIndex + rows * rowCount;
+
+		for (i = 0; i < count; i++, cx += spanX, cz += spanZ, cIndex += spanChunk, index += spanCount) {
+			if (!Greedy_CanStretch(block, index, cIndex, cx, y + rows * rowY, cz, face)) break;
+			if (liquid && Builder_OccludedLiquid(cIndex)) break;
+		}
+		if (i < count) break;
+
+		/* Mark the faces in this row as already drawn */
+		index = countIndex + rows * rowCount;
+		for (i = 0; i < count; i++, index += spanCount) {
+			Builder_Counts[index] = 0;
+		}
+	}
+
+	Greedy_Rows[countIndex] = rows;
+}
+
+static int GreedyBuilder_StretchXLiquid(int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
+	int count = 1; cc_bool stretchTile;
+	int startIndex = countIndex, startChunk = chunkIndex, startX = x;
+	if (Builder_OccludedLiquid(chunkIndex)) return 0;
+	
+	x++;
+	chunkIndex++;
+	countIndex += FACE_COUNT;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << FACE_YMAX)) != 0;
+
+	while (x < Builder_ChunkEndX && stretchTile && Greedy_CanStretch(block, countIndex, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(chunkIndex)) {
+		Builder_Counts[countIndex] = 0;
+		count++;
+		x++;
+		chunkIndex++;
+		countIndex += FACE_COUNT;
+	}
+
+	Greedy_MergeRows(startIndex, startX, y, z, startChunk, block, FACE_YMAX, count, true);
+	AddVertices(block, FACE_YMAX);
+	return count;
+}
+
+static int GreedyBuilder_StretchX(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	int count = 1; cc_bool stretchTile;
+	int startIndex = countIndex, startChunk = chunkIndex, startX = x;
+	x++;
+	chunkIndex++;
+	countIndex += FACE_COUNT;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << face)) != 0;
+
+	while (x < Builder_ChunkEndX && stretchTile && Greedy_CanStretch(block, countIndex, chunkIndex, x, y, z, face)) {
+		Builder_Counts[countIndex] = 0;
+		count++;
+		x++;
+		chunkIndex++;
+		countIndex += FACE_COUNT;
+	}
+
+	Greedy_MergeRows(startIndex, startX, y, z, startChunk, block, face, count, false);
+	AddVertices(block, face);
+	return count;
+}
+
+static int GreedyBuilder_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	int count = 1; cc_bool stretchTile;
+	int startIndex = countIndex, startChunk = chunkIndex, startZ = z;
+	z++;
+	chunkIndex += EXTCHUNK_SIZE;
+	countIndex += CHUNK_SIZE * FACE_COUNT;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << face)) != 0;
+
+	while (z < Builder_ChunkEndZ && stretchTile && Greedy_CanStretch(block, countIndex, chunkIndex, x, y, z, face)) {
+		Builder_Counts[countIndex] = 0;
+		count++;
+		z++;
+		chunkIndex += EXTCHUNK_SIZE;
+		countIndex += CHUNK_SIZE * FACE_COUNT;
+	}
+
+	Greedy_MergeRows(startIndex, x, y, startZ, startChunk, block, face, count, false);
+	AddVertices(block, face);
+	return count;
+}
+
+typedef void (*Greedy_DrawFace)(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+static const Greedy_DrawFace greedy_drawFaces[FACE_COUNT] = {
+	Drawer_XMin, Drawer_XMax, Drawer_ZMin, Drawer_ZMax, Drawer_YMin, Drawer_YMax
+};
+
+static void GreedyBuilder_RenderBlock(int index, int x, int y, int z) {
+	struct Builder1DPart* part;
+	int baseOffset, count, rows, face;
+	cc_bool fullBright;
+	TextureLoc loc;
+	PackedCol col;
+	Vec3 min, max;
+
+	if (Block_RenderInfo[Builder_Block].draw == DRAW_SPRITE) {
+		Builder_DrawSprite(x, y, z); return;
+	}
+
+	fullBright = Block_RenderInfo[Builder_Block].brightness;
+	baseOffset = (Block_RenderInfo[Builder_Block].draw == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+
+	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.y = 1.0f - Drawer.MinBB.y;
+	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.y = 1.0f - Drawer.MaxBB.y;
+	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
+
+	Drawer.Tinted  = Block_RenderInfo[Builder_Block].tinted;
+	Drawer.TintCol = Block_RenderInfo[Builder_Block].fogCol;
+
+	for (face = 0; face < FACE_COUNT; face++) 
+	{
+		count = Builder_Counts[index + face];
+		if (!count) continue;
+		rows  = Greedy_Rows[index + face] - 1;
+
+		Drawer.X1 = x + min.x; Drawer.Y1 = y + min.y; Drawer.Z1 = z + min.z;
+		Drawer.X2 = x + max.x; Drawer.Y2 = y + max.y; Drawer.Z2 = z + max.z;
+		if (face >= FACE_YMIN) { Drawer.Z2 += rows; } else { Drawer.Y2 += rows; }
+
+		loc  = Block_Tex(Builder_Block, face);
+		part = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		col  = fullBright ? PACKEDCOL_WHITE : Normal_LightColor(x, y, z, (Face)face, Builder_Block);
+		greedy_drawFaces[face](count, col, loc, &part->faces.vertices[face]);
+	}
+}
+
+static void GreedyBuilder_SetActive(void) {
+	Builder_SetDefault();
+	Builder_StretchXLiquid = GreedyBuilder_StretchXLiquid;
+	Builder_StretchX       = GreedyBuilder_StretchX;
+	Builder_StretchZ       = GreedyBuilder_StretchZ;
+	Builder_RenderBlock    = GreedyBuilder_RenderBlock;
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------Advanced mesh builder---------------------------------------------------*
 *#########################################################################################################################*/
 #ifdef CC_BUILD_ADVLIGHTING
-static Vec3 adv_minBB, adv_maxBB;
-static int adv_initBitFlags, adv_baseOffset;
-static int* adv_bitFlags;
-static float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
-static PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
-static cc_bool adv_tinted;
+static CC_THREADLOCAL Vec3 adv_minBB, adv_maxBB;
+static CC_THREADLOCAL int adv_initBitFlags, adv_baseOffset;
+static CC_THREADLOCAL int* adv_bitFlags;
+static CC_THREADLOCAL float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
+static CC_THREADLOCAL PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
+static CC_THREADLOCAL cc_bool adv_tinted;
+/* Cached Adv_Lit results for each cell of the chunk currently being built */
+/* NOTE: Each cell is sampled by up to 9 neighbouring blocks (and once per face of each), */
+/*  so caching avoids most of the IsLit_Fast lookups smooth lighting would otherwise need */
+static CC_THREADLOCAL cc_uint8 adv_litCache[EXTCHUNK_SIZE_3];
+#define ADV_LIT_UNKNOWN 0xFF
 
 enum ADV_MASK {
 	/* z-1 cube points */
@@ -811,7 +1311,7 @@ static int Adv_Lit(int x, int y, int z, int cIndex) {
 
 	flags = 0;
 	block = Builder_Chunk[cIndex];
-	lightFlags = Blocks.LightOffset[block];
+	lightFlags = Block_RenderInfo[block].lightOffset;
 
 	/* TODO using LIGHT_FLAG_SHADES_FROM_BELOW is wrong here, */
 	/*  but still produces less broken results than YMIN/YMAX */
@@ -828,26 +1328,35 @@ static int Adv_Lit(int x, int y, int z, int cIndex) {
 	flags |= Lighting.IsLit_Fast(x, (y + 1) - offset, z) ? LIT_P1 : 0;
 
 	/* If a block is fullbright, it should also look as if that spot is lit */
-	if (Blocks.Brightness[Builder_Chunk[cIndex - 324]]) flags |= LIT_M1;
-	if (Blocks.Brightness[block])                       flags |= LIT_CC;
-	if (Blocks.Brightness[Builder_Chunk[cIndex + 324]]) flags |= LIT_P1;
+	if (Block_RenderInfo[Builder_Chunk[cIndex - 324]].brightness) flags |= LIT_M1;
+	if (Block_RenderInfo[block].brightness)                       flags |= LIT_CC;
+	if (Block_RenderInfo[Builder_Chunk[cIndex + 324]].brightness) flags |= LIT_P1;
 	
 	return flags;
 }
 
+static int Adv_CachedLit(int x, int y, int z, int cIndex) {
+	int flags = adv_litCache[cIndex];
+	if (flags != ADV_LIT_UNKNOWN) return flags;
+
+	flags = Adv_Lit(x, y, z, cIndex);
+	adv_litCache[cIndex] = flags;
+	return flags;
+}
+
 static int Adv_ComputeLightFlags(int x, int y, int z, int cIndex) {
 	if (Builder_FullBright) return (1 << xP1_yP1_zP1) - 1; /* all faces fully bright */
 
 	return
-		Adv_Lit(x - 1, y, z - 1, cIndex - 1 - 18) << xM1_yM1_zM1 |
-		Adv_Lit(x - 1, y, z,     cIndex - 1)      << xM1_yM1_zCC |
-		Adv_Lit(x - 1, y, z + 1, cIndex - 1 + 18) << xM1_yM1_zP1 |
-		Adv_Lit(x,     y, z - 1, cIndex + 0 - 18) << xCC_yM1_zM1 |
-		Adv_Lit(x,     y, z,     cIndex + 0)      << xCC_yM1_zCC |
-		Adv_Lit(x,     y, z + 1, cIndex + 0 + 18) << xCC_yM1_zP1 |
-		Adv_Lit(x + 1, y, z - 1, cIndex + 1 - 18) << xP1_yM1_zM1 |
-		Adv_Lit(x + 1, y, z,     cIndex + 1)      << xP1_yM1_zCC |
-		Adv_Lit(x + 1, y, z + 1, cIndex + 1 + 18) << xP1_yM1_zP1;
+		Adv_CachedLit(x - 1, y, z - 1, cIndex - 1 - 18) << xM1_yM1_zM1 |
+		Adv_CachedLit(x - 1, y, z,     cIndex - 1)      << xM1_yM1_zCC |
+		Adv_CachedLit(x - 1, y, z + 1, cIndex - 1 + 18) << xM1_yM1_zP1 |
+		Adv_CachedLit(x,     y, z - 1, cIndex + 0 - 18) << xCC_yM1_zM1 |
+		Adv_CachedLit(x,     y, z,     cIndex + 0)      << xCC_yM1_zCC |
+		Adv_CachedLit(x,     y, z + 1, cIndex + 0 + 18) << xCC_yM1_zP1 |
+		Adv_CachedLit(x + 1, y, z - 1, cIndex + 1 - 18) << xP1_yM1_zM1 |
+		Adv_CachedLit(x + 1, y, z,     cIndex + 1)      << xP1_yM1_zCC |
+		Adv_CachedLit(x + 1, y, z + 1, cIndex + 1 + 18) << xP1_yM1_zP1;
 }
 
 static int adv_masks[FACE_COUNT] = {
@@ -898,7 +1407,7 @@ static int Adv_StretchXLiquid(int countIndex, int x, int y, int z, int chunkInde
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
-	stretchTile = (Blocks.CanStretch[block] & (1 << FACE_YMAX)) != 0;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << FACE_YMAX)) != 0;
 
 	while (x < Builder_ChunkEndX && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(chunkIndex)) {
 		Builder_Counts[countIndex] = 0;
@@ -919,7 +1428,7 @@ static int Adv_StretchX(int countIndex, int x, int y, int z, int chunkIndex, Blo
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
-	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << face)) != 0;
 
 	while (x < Builder_ChunkEndX && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, face)) {
 		Builder_Counts[countIndex] = 0;
@@ -940,7 +1449,7 @@ static int Adv_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, Blo
 	z++;
 	chunkIndex += EXTCHUNK_SIZE;
 	countIndex += CHUNK_SIZE * FACE_COUNT;
-	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
+	stretchTile = (Block_RenderInfo[block].canStretch & (1 << face)) != 0;
 
 	while (z < Builder_ChunkEndZ && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, face)) {
 		Builder_Counts[countIndex] = 0;
@@ -977,7 +1486,7 @@ static void Adv_DrawXMin(int count) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1019,7 +1528,7 @@ static void Adv_DrawXMax(int count) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1061,7 +1570,7 @@ static void Adv_DrawZMin(int count) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1103,7 +1612,7 @@ static void Adv_DrawZMax(int count) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1145,7 +1654,7 @@ static void Adv_DrawYMin(int count) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1187,7 +1696,7 @@ static void Adv_DrawYMax(int count) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1213,7 +1722,7 @@ static void Adv_RenderBlock(int index, int x, int y, int z) {
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
+	if (Block_RenderInfo[Builder_Block].draw == DRAW_SPRITE) {
 		Builder_DrawSprite(x, y, z); return;
 	}
 
@@ -1227,9 +1736,9 @@ static void Adv_RenderBlock(int index, int x, int y, int z) {
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	Builder_FullBright = Blocks.Brightness[Builder_Block];
-	adv_baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	adv_tinted     = Blocks.Tinted[Builder_Block];
+	Builder_FullBright = Block_RenderInfo[Builder_Block].brightness;
+	adv_baseOffset = (Block_RenderInfo[Builder_Block].draw == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	adv_tinted     = Block_RenderInfo[Builder_Block].tinted;
 
 	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
 	adv_x1 = x + min.x; adv_y1 = y + min.y; adv_z1 = z + min.z;
@@ -1250,6 +1759,7 @@ static void Adv_PrePrepareChunk(void) {
 	int i;
 	DefaultPrePrepateChunk();
 	adv_bitFlags = Builder_BitFlags;
+	Mem_Set(adv_litCache, ADV_LIT_UNKNOWN, sizeof(adv_litCache));
 
 	for (i = 0; i <= 4; i++) {
 		adv_lerp[i]  = PackedCol_Lerp(Env.ShadowCol,   Env.SunCol,   i / 4.0f);
@@ -1282,9 +1792,9 @@ static void AdvBuilder_SetActive(void) { NormalBuilder_SetActive(); }
 
 static cc_bool Modern_IsOccluded(int x, int y, int z) {
 	BlockID block = World_SafeGetBlock(x, y, z);
-	if (Blocks.Brightness[block] > 0) { return false; }
+	if (Block_RenderInfo[block].brightness > 0) { return false; }
 	/* If the block we're pulling colors from is solid, return a darker version of original and increment how many are like this */
-	if (Blocks.FullOpaque[block] || (Blocks.Draw[block] == DRAW_TRANSPARENT && Blocks.BlocksLight[block] && Blocks.LightOffset[block] == 0xFF)) {
+	if (Block_RenderInfo[block].fullOpaque || (Block_RenderInfo[block].draw == DRAW_TRANSPARENT && Block_RenderInfo[block].blocksLight && Block_RenderInfo[block].lightOffset == 0xFF)) {
 		return true;
 	}
 	return false;
@@ -1345,7 +1855,7 @@ static void Modern_DrawXMin(int count, int x, int y, int z) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1378,7 +1888,7 @@ static void Modern_DrawXMax(int count, int x, int y, int z) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1424,7 +1934,7 @@ static void Modern_DrawZMin(int count, int x, int y, int z) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1457,7 +1967,7 @@ static void Modern_DrawZMax(int count, int x, int y, int z) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1503,7 +2013,7 @@ static void Modern_DrawYMin(int count, int x, int y, int z) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1550,7 +2060,7 @@ static void Modern_DrawYMax(int count, int x, int y, int z) {
 	struct VertexTextured* vertices, v;
 
 	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+		tint   = Block_RenderInfo[Builder_Block].fogCol;
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
@@ -1569,7 +2079,7 @@ static void Modern_RenderBlock(int index, int x, int y, int z) {
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
+	if (Block_RenderInfo[Builder_Block].draw == DRAW_SPRITE) {
 		Builder_DrawSprite(x, y, z); return;
 	}
 
@@ -1583,9 +2093,9 @@ static void Modern_RenderBlock(int index, int x, int y, int z) {
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	Builder_FullBright = Blocks.Brightness[Builder_Block];
-	adv_baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	adv_tinted = Blocks.Tinted[Builder_Block];
+	Builder_FullBright = Block_RenderInfo[Builder_Block].brightness;
+	adv_baseOffset = (Block_RenderInfo[Builder_Block].draw == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	adv_tinted = Block_RenderInfo[Builder_Block].tinted;
 
 	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
 	adv_x1 = x + min.x; adv_y1 = y + min.y; adv_z1 = z + min.z;
@@ -1622,7 +2132,7 @@ static void ModernBuilder_SetActive(void) { NormalBuilder_SetActive(); }
 /*########################################################################################################################*
 *---------------------------------------------------Builder interface-----------------------------------------------------*
 *#########################################################################################################################*/
-cc_bool Builder_SmoothLighting;
+cc_bool Builder_SmoothLighting, Builder_GreedyMeshing;
 void Builder_ApplyActive(void) {
 	if (Builder_SmoothLighting) {
 		if (Lighting_Mode != LIGHTING_MODE_CLASSIC) {
@@ -1631,6 +2141,8 @@ void Builder_ApplyActive(void) {
 		else {
 			AdvBuilder_SetActive();
 		}
+	} else if (Builder_GreedyMeshing) {
+		GreedyBuilder_SetActive();
 	} else {
 		NormalBuilder_SetActive();
 	}
@@ -1645,6 +2157,7 @@ static void OnInit(void) {
 	Builder_Offsets[FACE_YMAX] =  EXTCHUNK_SIZE_2;
 
 	if (!Game_ClassicMode) Builder_SmoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
+	Builder_GreedyMeshing = Options_GetBool(OPT_GREEDY_MESHING, false);
 	Builder_ApplyActive();
 }
 
@@ -1653,9 +2166,17 @@ static void OnNewMapLoaded(void) {
 	Builder_EdgeLevel  = max(0, Env.EdgeHeight);
 }
 
+static void OnFree(void) {
+#ifdef CC_BUILD_CHUNKARENA
+	Mem_Free(meshVertices);
+	meshVertices = NULL;
+	meshCapacity = 0;
+#endif
+}
+
 struct IGameComponent Builder_Component = {
 	OnInit, /* Init */
-	NULL, /* Free */
+	OnFree, /* Free */
 	NULL, /* Reset */
 	NULL, /* OnNewMap */
 	OnNewMapLoaded /* OnNewMapLoaded */
@@ -1,6 +1,7 @@
 #ifndef CC_BUILDER_H
 #define CC_BUILDER_H
 #include "Core.h"
+#include "Constants.h"
 CC_BEGIN_HEADER
 
 /* 
@@ -8,6 +9,10 @@ Converts a 16x16x16 chunk into a mesh of vertices
   NormalMeshBuilder:
     Implements a simple chunk mesh builder, where each block face is a single colour
     (whatever lighting engine returns as light colour for given block face at given coordinates)
+  GreedyMeshBuilder:
+    Same as NormalMeshBuilder, but also merges each stretched face with identical faces in the following rows
+    (only for tiles which look the same when stretched vertically, since 1D atlases can't repeat vertically)
+  Far away chunks (ChunkInfo.lod above 0) have each cell of blocks collapsed into one block before meshing
 
 Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 */
@@ -18,11 +23,41 @@ extern struct IGameComponent Builder_Component;
 extern int Builder_SidesLevel, Builder_EdgeLevel;
 /* Whether smooth/advanced lighting mesh builder is used. */
 extern cc_bool Builder_SmoothLighting;
+/* Whether greedy mesh builder is used when smooth lighting is disabled. */
+/* (merges adjacent block faces along two axes instead of just one) */
+extern cc_bool Builder_GreedyMeshing;
 
 /* Builds the mesh of vertices for the given chunk. */
 void Builder_MakeChunk(struct ChunkInfo* info);
 
 void Builder_ApplyActive(void);
 
+#ifdef CC_BUILD_MESHWORKERS
+struct VertexTextured;
+/* State for building the mesh of a chunk, which may be done on a worker thread. */
+/* The chunk is built in stages, some of which must be done on the main thread. */
+struct BuilderJob {
+	struct ChunkInfo* info;
+	cc_bool hasMesh; /* Whether the chunk has any blocks that may need to be meshed */
+	int verticesCount, verticesCapacity;
+	struct VertexTextured* vertices;
+	GfxResourceID vb; /* Vertex buffer already created on the worker thread, if supported */
+	BlockID chunk[EXTCHUNK_SIZE_3];
+};
+
+/* Copies the blocks in and around the job's chunk. (can be called on any thread) */
+void Builder_ReadJob(struct BuilderJob* job);
+/* Queues up calculating lighting needed to mesh the job's chunk on other threads. (must be called on main thread) */
+void Builder_QueueLightJob(struct BuilderJob* job);
+/* Calculates lighting needed to mesh the job's chunk. (must be called on main thread) */
+void Builder_LightJob(struct BuilderJob* job);
+/* Builds the mesh vertices for the job's chunk. (can be called on any thread) */
+void Builder_MeshJob(struct BuilderJob* job);
+/* Uploads the mesh vertices of the job's chunk to the GPU. (must be called on main thread) */
+void Builder_UploadJob(struct BuilderJob* job);
+/* Frees memory allocated for storing the job's mesh vertices. */
+void Builder_FreeJob(struct BuilderJob* job);
+#endif
+
 CC_END_HEADER
 #endif
@@ -132,6 +132,17 @@ static void PerspectiveCamera_UpdateMouse(struct LocalPlayer* p, float delta) {
 	states[i].deltaY = 0;
 }
 
+void Camera_ApplyPendingMovement(void) {
+	int i = Game.CurrentState;
+	/* Smooth camera intentionally lags behind mouse movement, and custom cameras track movement themselves */
+	if (Camera.Smooth || Camera.Active->OnRawMovement != Camera_OnRawMovement) return;
+	if (!states[i].deltaX && !states[i].deltaY) return;
+
+	PerspectiveCamera_UpdateMouseRotation(Entities.CurPlayer, 0.0f);
+	states[i].deltaX = 0;
+	states[i].deltaY = 0;
+}
+
 static void PerspectiveCamera_CalcViewBobbing(struct LocalPlayer* p, float t, float velTiltScale) {
 	struct Entity* e = &p->Base;
 	struct Matrix tiltY, velX;
@@ -84,6 +84,9 @@ void Camera_CheckFocus(void);
 void Camera_UpdateProjection(void);
 void Camera_SetFov(int fov);
 void Camera_KeyLookUpdate(float delta);
+/* Immediately applies mouse movement received so far this frame to the camera's orientation */
+/* NOTE: This way input events handled later in the same frame (e.g. clicks) see the up to date orientation */
+void Camera_ApplyPendingMovement(void);
 
 CC_END_HEADER
 #endif
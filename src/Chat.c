@@ -10,6 +10,7 @@
 #include "Utils.h"
 #include "Options.h"
 #include "Drawer2D.h"
+#include "Platform.h"
  
 static char status[5][STRING_SIZE];
 static char bottom[3][STRING_SIZE];
@@ -52,6 +53,143 @@ static cc_string logPath = String_FromArray(logPathBuffer);
 static struct Stream logStream;
 static int lastLogDay, lastLogMonth, lastLogYear;
 
+/* Chat lines are queued in memory and then written to the log file in batches */
+#define CHATLOG_QUEUE_SIZE (16 * 1024)
+/* Maximum size of a single line after being converted to UTF8 */
+#define CHATLOG_MAX_LINE (DRAWER2D_MAX_TEXT_LENGTH * 3 + 2)
+/* How often queued lines are written out, in milliseconds */
+#define CHATLOG_FLUSH_INTERVAL 1000
+
+static cc_uint8 logQueue[CHATLOG_QUEUE_SIZE];
+static int logQueueLen;
+static cc_result logError;
+
+#ifdef CC_BUILD_CHATLOGWORKER
+static void* log_thread;
+static void* log_wakeup;
+static void* log_fileMutex;  /* Guards logStream */
+static void* log_queueMutex; /* Guards logQueue, logQueueLen and logError */
+static volatile cc_bool log_quit;
+
+#define LogFile_Lock()    Mutex_Lock(log_fileMutex)
+#define LogFile_Unlock()  Mutex_Unlock(log_fileMutex)
+#define LogQueue_Lock()   Mutex_Lock(log_queueMutex)
+#define LogQueue_Unlock() Mutex_Unlock(log_queueMutex)
+#else
+#define LogFile_Lock()
+#define LogFile_Unlock()
+#define LogQueue_Lock()
+#define LogQueue_Unlock()
+#endif
+
+/* Writes all queued lines to the log file */
+static void FlushLogQueue(void) {
+	static cc_uint8 data[CHATLOG_QUEUE_SIZE];
+	cc_result res = 0;
+	int len;
+
+	/* Copying the queue means the main thread can keep queueing lines during the write */
+	LogFile_Lock();
+	LogQueue_Lock();
+	{
+		len = logQueueLen;
+		Mem_Copy(data, logQueue, len);
+		logQueueLen = 0;
+	}
+	LogQueue_Unlock();
+
+	if (len && logStream.meta.file && !logError) {
+		res = Stream_Write(&logStream, data, len);
+	}
+	LogFile_Unlock();
+	if (!res) return;
+
+	LogQueue_Lock();
+	logError = res;
+	LogQueue_Unlock();
+}
+
+#ifdef CC_BUILD_CHATLOGWORKER
+static void LogWorker_Run(void) {
+	for (;;) {
+		Waitable_WaitFor(log_wakeup, CHATLOG_FLUSH_INTERVAL);
+		FlushLogQueue();
+		if (log_quit) return;
+	}
+}
+
+static void LogWorker_Start(void) {
+	if (log_thread) return;
+	Thread_Run(&log_thread, LogWorker_Run, 64 * 1024, "Chat log writer");
+}
+
+static void LogWorker_Stop(void) {
+	if (!log_thread) return;
+	log_quit = true;
+	Waitable_Signal(log_wakeup);
+
+	Thread_Join(log_thread);
+	log_thread = NULL;
+	log_quit   = false;
+}
+#endif
+
+static void QueueLogLine(const cc_string* text) {
+	cc_uint8 line[CHATLOG_MAX_LINE];
+	const char* nl;
+	cc_bool full;
+	int i, len = 0;
+
+	for (i = 0; i < text->length; i++) {
+		len += Convert_CP437ToUtf8(text->buffer[i], line + len);
+	}
+	nl = _NL;
+	while (*nl) { line[len++] = *nl++; }
+
+	LogQueue_Lock();
+	full = logQueueLen + len > CHATLOG_QUEUE_SIZE;
+	LogQueue_Unlock();
+	/* Writing is falling behind, so rather than letting the queue grow, write it out now */
+	if (full) FlushLogQueue();
+
+	LogQueue_Lock();
+	{
+		Mem_Copy(logQueue + logQueueLen, line, len);
+		logQueueLen += len;
+		full = logQueueLen >= CHATLOG_QUEUE_SIZE / 2;
+	}
+	LogQueue_Unlock();
+
+#ifdef CC_BUILD_CHATLOGWORKER
+	if (full) Waitable_Signal(log_wakeup);
+#endif
+}
+
+/* Reports an error that occurred while writing queued lines */
+/* NOTE: Must be called from the main thread, since it adds a message to chat */
+static void CheckLogError(void) {
+	cc_result res;
+	LogQueue_Lock();
+	{
+		res = logError;
+		/* Lines queued since the failed write are discarded */
+		if (res) logQueueLen = 0;
+		logError = 0;
+	}
+	LogQueue_Unlock();
+	if (!res) return;
+
+	Chat_DisableLogging();
+	Logger_SysWarn2(res, "writing to", &logPath);
+}
+
+static void LogQueue_Tick(struct ScheduledTask* task) {
+#ifndef CC_BUILD_CHATLOGWORKER
+	FlushLogQueue();
+#endif
+	CheckLogError();
+}
+
 /* Resets log name to empty and resets last log date */
 static void ResetLogFile(void) {
 	logName.length = 0;
@@ -62,8 +200,14 @@ static void ResetLogFile(void) {
 static void CloseLogFile(void) {
 	cc_result res;
 	if (!logStream.meta.file) return;
+	FlushLogQueue();
 
-	res = logStream.Close(&logStream);
+	LogFile_Lock();
+	{
+		res = logStream.Close(&logStream);
+		logStream.meta.file = 0;
+	}
+	LogFile_Unlock();
 	if (res) { Logger_SysWarn2(res, "closing", &logPath); }
 }
 
@@ -137,7 +281,10 @@ static void OpenChatLog(struct DateTime* now) {
 			String_Format1(&logPath, "%s.txt", &logName);
 		}
 
+		LogFile_Lock();
 		res = Stream_AppendFile(&logStream, &logPath);
+		LogFile_Unlock();
+
 		if (res && res != ReturnCode_FileShareViolation) {
 			Chat_DisableLogging();
 			Logger_SysWarn2(res, "appending to", &logPath);
@@ -145,6 +292,9 @@ static void OpenChatLog(struct DateTime* now) {
 		}
 
 		if (res == ReturnCode_FileShareViolation) continue;
+#ifdef CC_BUILD_CHATLOGWORKER
+		LogWorker_Start();
+#endif
 		return;
 	}
 
@@ -155,8 +305,8 @@ static void OpenChatLog(struct DateTime* now) {
 static void AppendChatLog(const cc_string* text) {
 	cc_string str; char strBuffer[DRAWER2D_MAX_TEXT_LENGTH];
 	struct DateTime now;
-	cc_result res;	
 
+	CheckLogError();
 	if (!logName.length || !Chat_Logging) return;
 	DateTime_CurrentLocal(&now);
 
@@ -172,11 +322,7 @@ static void AppendChatLog(const cc_string* text) {
 	String_InitArray(str, strBuffer);
 	String_Format3(&str, "[%p2:%p2:%p2] ", &now.hour, &now.minute, &now.second);
 	Drawer2D_WithoutColors(&str, text);
-
-	res = Stream_WriteLine(&logStream, &str);
-	if (!res) return;
-	Chat_DisableLogging();
-	Logger_SysWarn2(res, "writing to", &logPath);
+	QueueLogLine(&str);
 }
 
 void Chat_Add1(const char* format, const void* a1) {
@@ -278,6 +424,14 @@ static void OnInit(void) {
 #else
 	Chat_Logging = Options_GetBool(OPT_CHAT_LOGGING, true);
 #endif
+
+#ifdef CC_BUILD_CHATLOGWORKER
+	log_wakeup     = Waitable_Create("Chat log wakeup");
+	log_fileMutex  = Mutex_Create("Chat log file");
+	log_queueMutex = Mutex_Create("Chat log queue");
+#endif
+	/* Flushing more than once to catch up is pointless */
+	ScheduledTask_SetLimits(ScheduledTask_Add(CHATLOG_FLUSH_INTERVAL / 1000.0, LogQueue_Tick), 1, 0);
 }
 
 static void ClearCPEMessages(void) {
@@ -299,6 +453,9 @@ static void OnReset(void) {
 }
 
 static void OnFree(void) {
+#ifdef CC_BUILD_CHATLOGWORKER
+	LogWorker_Stop();
+#endif
 	CloseLogFile();
 	ClearCPEMessages();
 
@@ -17,13 +17,37 @@
 #include "TexturePack.h"
 #include "Options.h"
 #include "Drawer2D.h"
+#include "Platform.h"
 
 #define COMMANDS_PREFIX "/client"
 #define COMMANDS_PREFIX_SPACE "/client "
 static struct ChatCommand* cmds_head;
 static struct ChatCommand* cmds_tail;
 
+/* Hashes of the lowercased names of the first registered commands, in registration order */
+/* NOTE: Stored separately since ChatCommand can't gain new fields without breaking plugins */
+#define COMMANDS_MAX_HASHED 128
+static cc_uint32 cmds_hashes[COMMANDS_MAX_HASHED];
+static int cmds_count;
+
+static cc_uint32 Commands_Hash(const cc_string* name) {
+	cc_uint32 hash = 2166136261UL;
+	char c;
+	int i;
+
+	for (i = 0; i < name->length; i++)
+	{
+		c = name->buffer[i]; Char_MakeLower(c);
+		hash = (hash ^ (cc_uint8)c) * 16777619UL;
+	}
+	return hash;
+}
+
 void Commands_Register(struct ChatCommand* cmd) {
+	cc_string name = String_FromReadonly(cmd->name);
+	if (cmds_count < COMMANDS_MAX_HASHED) cmds_hashes[cmds_count] = Commands_Hash(&name);
+
+	cmds_count++;
 	LinkedList_Append(cmd, cmds_head, cmds_tail);
 }
 
@@ -34,10 +58,14 @@ void Commands_Register(struct ChatCommand* cmd) {
 static struct ChatCommand* Commands_FindMatch(const cc_string* cmdName) {
 	struct ChatCommand* match = NULL;
 	struct ChatCommand* cmd;
+	cc_uint32 hash = Commands_Hash(cmdName);
 	cc_string name;
+	int i = 0;
 
-	for (cmd = cmds_head; cmd; cmd = cmd->next) 
+	for (cmd = cmds_head; cmd; cmd = cmd->next, i++) 
 	{
+		if (i < COMMANDS_MAX_HASHED && cmds_hashes[i] != hash) continue;
+
 		name = String_FromReadonly(cmd->name);
 		if (String_CaselessEquals(&name, cmdName)) return cmd;
 	}
@@ -304,6 +332,65 @@ static struct ChatCommand MotdCommand = {
 	}
 };
 
+#define NETSTATS_MAX_OPCODES 5
+static void NetStatsCommand_Execute(const cc_string* args, int argsCount) {
+	cc_string str; char strBuffer[STRING_SIZE];
+	cc_uint8 opcodes[NETSTATS_MAX_OPCODES];
+	int i, j, count = 0;
+	cc_uint8 opcode;
+
+	if (Server.IsSinglePlayer) {
+		Chat_AddRaw("&eThis command can only be used in multiplayer.");
+		return;
+	}
+	Chat_Add2("&eReceived: &f%i packets/s, %i bytes/s", &NetStats.TotalPackets, &NetStats.TotalBytes);
+	Chat_Add1("&eSend queue: &f%i bytes", &NetStats.SendQueued);
+
+	/* Find the opcodes with the most bytes received, sorted by descending order */
+	for (i = 0; i < 256; i++)
+	{
+		if (!NetStats.Packets[i]) continue;
+
+		for (j = count; j > 0 && NetStats.Bytes[opcodes[j - 1]] < NetStats.Bytes[i]; j--)
+		{
+			if (j < NETSTATS_MAX_OPCODES) opcodes[j] = opcodes[j - 1];
+		}
+		if (j >= NETSTATS_MAX_OPCODES) continue;
+
+		opcodes[j] = (cc_uint8)i;
+		if (count < NETSTATS_MAX_OPCODES) count++;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		opcode = opcodes[i];
+		Chat_Add4("&e  Opcode %b: &f%i packets/s, %i bytes/s, %i us handling", &opcode,
+			&NetStats.Packets[opcode], &NetStats.Bytes[opcode], &NetStats.HandlerTime[opcode]);
+	}
+
+	String_InitArray(str, strBuffer);
+	String_AppendConst(&str, "&ePing:&f");
+	for (i = 0; i < NETSTATS_PING_BUCKETS; i++)
+	{
+		if (i < NETSTATS_PING_BUCKETS - 1) {
+			String_Format2(&str, " <%i ms: %i", &NetStats_PingBucketLimits[i], &NetStats.PingBuckets[i]);
+		} else {
+			String_Format2(&str, " >=%i ms: %i", &NetStats_PingBucketLimits[i - 1], &NetStats.PingBuckets[i]);
+		}
+	}
+	Chat_Add(&str);
+}
+
+static struct ChatCommand NetStatsCommand = {
+	"NetStats", NetStatsCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client netstats",
+		"&eDisplays statistics about the data received from the server.",
+		"&eIncludes packets received per opcode and a ping histogram."
+	}
+};
+
 /*#######################################################################################################################*
 *-------------------------------------------------------PlaceCommand-----------------------------------------------------*
 *########################################################################################################################*/
@@ -370,6 +457,79 @@ static cc_bool drawOp_persist, drawOp_hooked, drawOp_hasMark1;
 static const char* drawOp_name;
 static void (*drawOp_Func)(IVec3 min, IVec3 max);
 
+/* Previous blocks in the region of a draw operation, so that it can be undone later */
+/* NOTE: Blocks are stored as runs of the same block, in the same order they are drawn in */
+struct BlockRun { BlockID block; cc_uint16 count; };
+struct DrawOpUndo { IVec3 min, max; struct BlockRun* runs; int count, capacity; };
+#define DRAWOP_MAX_UNDOS 10
+static struct DrawOpUndo drawOp_undos[DRAWOP_MAX_UNDOS];
+static int drawOp_undosCount;
+/* Undo entry being recorded by the current draw operation, or NULL if none */
+static struct DrawOpUndo* drawOp_curUndo;
+
+static void DrawOpUndo_Free(struct DrawOpUndo* undo) {
+	Mem_Free(undo->runs);
+	undo->runs     = NULL;
+	undo->count    = 0;
+	undo->capacity = 0;
+}
+
+static void DrawOpUndo_FreeAll(void) {
+	int i;
+	for (i = 0; i < drawOp_undosCount; i++) 
+	{
+		DrawOpUndo_Free(&drawOp_undos[i]);
+	}
+	drawOp_undosCount = 0;
+}
+
+static void DrawOpUndo_Begin(IVec3 min, IVec3 max) {
+	/* Forget the oldest undo once the history is full */
+	if (drawOp_undosCount == DRAWOP_MAX_UNDOS) {
+		DrawOpUndo_Free(&drawOp_undos[0]);
+		Mem_Move(&drawOp_undos[0], &drawOp_undos[1], (DRAWOP_MAX_UNDOS - 1) * sizeof(struct DrawOpUndo));
+		drawOp_undosCount--;
+	}
+
+	drawOp_curUndo = &drawOp_undos[drawOp_undosCount++];
+	drawOp_curUndo->min = min;
+	drawOp_curUndo->max = max;
+	drawOp_curUndo->runs     = NULL;
+	drawOp_curUndo->count    = 0;
+	drawOp_curUndo->capacity = 0;
+}
+
+static void DrawOpUndo_Add(BlockID block) {
+	struct DrawOpUndo* undo = drawOp_curUndo;
+	struct BlockRun* run;
+	void* runs;
+	if (!undo) return;
+
+	if (undo->count) {
+		run = &undo->runs[undo->count - 1];
+		if (run->block == block && run->count < 0xFFFF) { run->count++; return; }
+	}
+
+	if (undo->count == undo->capacity) {
+		runs = Mem_TryRealloc(undo->runs, undo->capacity * 2 + 64, sizeof(struct BlockRun));
+		/* Not being able to undo is better than running out of memory */
+		if (!runs) { DrawOpUndo_Free(undo); drawOp_curUndo = NULL; drawOp_undosCount--; return; }
+
+		undo->runs      = (struct BlockRun*)runs;
+		undo->capacity  = undo->capacity * 2 + 64;
+	}
+
+	run = &undo->runs[undo->count++];
+	run->block = block;
+	run->count = 1;
+}
+
+/* Changes the block at the given coordinates as part of the current draw operation */
+static void DrawOpCommand_Update(int x, int y, int z, BlockID block) {
+	DrawOpUndo_Add(World_GetBlock(x, y, z));
+	Game_BulkChangeBlock(x, y, z, block);
+}
+
 static void DrawOpCommand_BlockChanged(void* obj, IVec3 coords, BlockID old, BlockID now);
 static void DrawOpCommand_ResetState(void) {
 	if (drawOp_hooked) {
@@ -400,7 +560,11 @@ static void DrawOpCommand_Execute(void) {
 	if (!World_Contains(min.x, min.y, min.z)) return;
 	if (!World_Contains(max.x, max.y, max.z)) return;
 
+	DrawOpUndo_Begin(min, max);
+	Game_BeginBulkChange();
 	drawOp_Func(min, max);
+	Game_EndBulkChange();
+	drawOp_curUndo = NULL;
 }
 
 static void DrawOpCommand_BlockChanged(void* obj, IVec3 coords, BlockID old, BlockID now) {
@@ -470,7 +634,7 @@ static void CuboidCommand_Draw(IVec3 min, IVec3 max) {
 	for (y = min.y; y <= max.y; y++) {
 		for (z = min.z; z <= max.z; z++) {
 			for (x = min.x; x <= max.x; x++) {
-				Game_ChangeBlock(x, y, z, toPlace);
+				DrawOpCommand_Update(x, y, z, toPlace);
 			}
 		}
 	}
@@ -524,8 +688,7 @@ static void ReplaceCommand_Draw(IVec3 min, IVec3 max) {
 		for (z = min.z; z <= max.z; z++) {
 			for (x = min.x; x <= max.x; x++) {
 				cur = World_GetBlock(x, y, z);
-				if (cur != source) continue;
-				Game_ChangeBlock(x, y, z, toPlace);
+				DrawOpCommand_Update(x, y, z, cur == source ? toPlace : cur);
 			}
 		}
 	}
@@ -572,6 +735,52 @@ static struct ChatCommand ReplaceCommand = {
 };
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------UndoCommand------------------------------------------------------*
+*#########################################################################################################################*/
+static void UndoCommand_Execute(const cc_string* args, int argsCount) {
+	struct DrawOpUndo* undo;
+	struct BlockRun* run;
+	int x, y, z, left;
+
+	if (!drawOp_undosCount) {
+		Chat_AddRaw("&eUndo: &cThere is nothing to undo"); return;
+	}
+	undo = &drawOp_undos[--drawOp_undosCount];
+	run  = undo->runs;
+	left = run->count;
+
+	Game_BeginBulkChange();
+	for (y = undo->min.y; y <= undo->max.y; y++) {
+		for (z = undo->min.z; z <= undo->max.z; z++) {
+			for (x = undo->min.x; x <= undo->max.x; x++) {
+				Game_BulkChangeBlock(x, y, z, run->block);
+
+				if (--left) continue;
+				/* Reached end of this run of blocks */
+				if (++run == undo->runs + undo->count) goto finished;
+				left = run->count;
+			}
+		}
+	}
+
+finished:
+	Game_EndBulkChange();
+	Chat_AddRaw("&eUndo: &fRestored the blocks changed by the last draw operation");
+	DrawOpUndo_Free(undo);
+}
+
+static struct ChatCommand UndoCommand = {
+	"Undo", UndoCommand_Execute,
+	COMMAND_FLAG_SINGLEPLAYER_ONLY,
+	{
+		"&a/client undo",
+		"&eUndoes the last /client cuboid or /client replace.",
+		"&eUp to the last 10 of these can be undone.",
+	}
+};
+
+
 /*########################################################################################################################*
 *------------------------------------------------------TeleportCommand----------------------------------------------------*
 *#########################################################################################################################*/
@@ -792,6 +1001,159 @@ static struct ChatCommand BlockEditCommand = {
 };
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------BenchmarkCommand----------------------------------------------------*
+*#########################################################################################################################*/
+#define BENCHMARK_DEFAULT_FRAMES 600
+static void BenchmarkCommand_Execute(const cc_string* args, int argsCount) {
+	struct Entity* e = &Entities.CurPlayer->Base;
+	struct LocationUpdate update;
+	int frames = BENCHMARK_DEFAULT_FRAMES;
+
+	if (argsCount && (!Convert_ParseInt(&args[0], &frames) || frames <= 0)) {
+		Chat_AddRaw("&e/client benchmark: &cNumber of frames must be a positive integer.");
+		return;
+	}
+
+	/* Always render from the same position and orientation, so results are comparable */
+	LocalPlayer_CalcDefaultSpawn(Entities.CurPlayer, &update);
+	update.yaw = 45.0f;
+	e->VTABLE->SetLocation(e, &update);
+
+	Game_StartBenchmark(frames);
+	Chat_Add1("&e/client benchmark: &fTiming the next %i frames...", &frames);
+}
+
+static struct ChatCommand BenchmarkCommand = {
+	"Benchmark", BenchmarkCommand_Execute,
+	COMMAND_FLAG_SINGLEPLAYER_ONLY,
+	{
+		"&a/client benchmark [frames]",
+		"&eMeasures how long it takes to render frames from the centre of the map.",
+		"&eFor comparable results, use the same map and disable the FPS limit.",
+	}
+};
+
+
+/*########################################################################################################################*
+*------------------------------------------------------ProfileCommand-----------------------------------------------------*
+*#########################################################################################################################*/
+static void ProfileCommand_Dump(void) {
+	static const cc_string path = String_FromConst("profile-history.csv");
+	cc_result res;
+	int frames;
+
+	if (!Game_Profiling) {
+		Chat_AddRaw("&e/client profile: &cNot currently profiling.");
+		return;
+	}
+
+	res = Game_DumpProfileHistory(&path, &frames);
+	if (res) { Logger_SysWarn2(res, "writing", &path); return; }
+	Chat_Add1("&e/client profile: &fWrote times of the last %i frames to profile-history.csv", &frames);
+}
+
+static void ProfileCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string csvPath = String_FromConst("profile.csv");
+	cc_bool csv = argsCount && String_CaselessEqualsConst(&args[0], "csv");
+
+	if (argsCount && String_CaselessEqualsConst(&args[0], "dump")) {
+		ProfileCommand_Dump();
+		return;
+	} else if (argsCount && !csv) {
+		Chat_AddRaw("&e/client profile: &cOnly 'csv' or 'dump' are valid arguments.");
+		return;
+	}
+
+	if (Game_Profiling && !csv) {
+		Game_SetProfiling(false, NULL);
+		Chat_AddRaw("&e/client profile: &fStopped profiling.");
+	} else if (csv) {
+		Game_SetProfiling(true, &csvPath);
+		Chat_AddRaw("&e/client profile: &fProfiling, and writing average times to profile.csv every second.");
+	} else {
+		Game_SetProfiling(true, NULL);
+		Chat_AddRaw("&e/client profile: &fProfiling, average times and a graph of recent frames are shown below the position.");
+	}
+}
+
+static struct ChatCommand ProfileCommand = {
+	"Profile", ProfileCommand_Execute,
+	0,
+	{
+		"&a/client profile [csv/dump]",
+		"&eToggles measuring the CPU and GPU time spent in each stage of a frame.",
+		"&eIf csv is given, the average times are also written every second to profile.csv",
+		"&eIf dump is given, the times of each recent frame are written to profile-history.csv",
+	}
+};
+
+
+#ifdef CC_BUILD_TRACELOG
+/*########################################################################################################################*
+*-------------------------------------------------------TraceCommand------------------------------------------------------*
+*#########################################################################################################################*/
+static void TraceCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string path = String_FromConst("trace.log");
+	cc_result res;
+
+	if (Logger_IsTraceFileOpen()) {
+		res = Logger_CloseTraceFile();
+		if (res) { Logger_SysWarn2(res, "writing", &path); return; }
+		Chat_AddRaw("&e/client trace: &fStopped writing trace events.");
+	} else {
+		res = Logger_OpenTraceFile(&path);
+		if (res) { Logger_SysWarn2(res, "creating", &path); return; }
+		Chat_AddRaw("&e/client trace: &fWriting trace events to trace.log every second.");
+	}
+}
+
+static struct ChatCommand TraceCommand = {
+	"Trace", TraceCommand_Execute,
+	0,
+	{
+		"&a/client trace",
+		"&eToggles writing recorded trace events (e.g. frame times) to trace.log",
+		"&eEvents from the last few seconds are also written to client.log on a crash",
+	}
+};
+#endif
+
+
+#ifdef CC_BUILD_MEMTRACK
+/*########################################################################################################################*
+*------------------------------------------------------MemoryCommand------------------------------------------------------*
+*#########################################################################################################################*/
+static void MemoryCommand_Execute(const cc_string* args, int argsCount) {
+	struct MemUsage usage[MEM_SYS_COUNT + 1];
+	int i, live, peak;
+	Mem_GetUsage(usage);
+
+	live = usage[MEM_SYS_COUNT].live / 1024;
+	peak = usage[MEM_SYS_COUNT].peak / 1024;
+	Chat_Add2("&eMemory: &f%i KB allocated, %i KB at most", &live, &peak);
+
+	for (i = 0; i < MEM_SYS_COUNT; i++)
+	{
+		if (!usage[i].peak) continue;
+		live = usage[i].live / 1024;
+		peak = usage[i].peak / 1024;
+		Chat_Add3("&e  %c: &f%i KB, %i KB at most", Mem_SubsystemNames[i], &live, &peak);
+	}
+}
+
+static struct ChatCommand MemoryCommand = {
+	"Memory", MemoryCommand_Execute,
+	0,
+	{
+		"&a/client memory",
+		"&eShows how much memory is currently allocated by each subsystem,",
+		"&eand the most that each subsystem has had allocated at once.",
+	}
+};
+#endif
+
+
 /*########################################################################################################################*
 *------------------------------------------------------Commands component-------------------------------------------------*
 *#########################################################################################################################*/
@@ -805,17 +1167,34 @@ static void OnInit(void) {
 	Commands_Register(&TeleportCommand);
 	Commands_Register(&ClearDeniedCommand);
 	Commands_Register(&MotdCommand);
+	Commands_Register(&NetStatsCommand);
 	Commands_Register(&PlaceCommand);
 	Commands_Register(&BlockEditCommand);
 	Commands_Register(&CuboidCommand);
 	Commands_Register(&ReplaceCommand);
+	Commands_Register(&UndoCommand);
+	Commands_Register(&BenchmarkCommand);
+	Commands_Register(&ProfileCommand);
+#ifdef CC_BUILD_TRACELOG
+	Commands_Register(&TraceCommand);
+#endif
+#ifdef CC_BUILD_MEMTRACK
+	Commands_Register(&MemoryCommand);
+#endif
 }
 
 static void OnFree(void) {
-	cmds_head = NULL;
+	cmds_head  = NULL;
+	cmds_count = 0;
+	DrawOpUndo_FreeAll();
 }
 
+/* Undoing is only meaningful for the map that was drawn in */
+static void OnNewMap(void) { DrawOpUndo_FreeAll(); }
+
 struct IGameComponent Commands_Component = {
-	OnInit, /* Init  */
-	OnFree  /* Free  */
+	OnInit,  /* Init  */
+	OnFree,  /* Free  */
+	OnNewMap,/* Reset */
+	OnNewMap /* OnNewMap */
 };
@@ -315,7 +315,12 @@ typedef cc_uint8  cc_bool;
 	#define CC_BUILD_WEBAUDIO
 	#define CC_BUILD_NOMUSIC
 	#define CC_BUILD_MINFILES
+	/* Real threads (backed by Web Workers) are only available when compiled with -pthread */
+	#ifdef __EMSCRIPTEN_PTHREADS__
+	#define CC_BUILD_WEBTHREADS
+	#else
 	#define CC_BUILD_COOPTHREADED
+	#endif
 	#undef  CC_BUILD_FREETYPE
 	#undef  CC_BUILD_RESOURCES
 	#undef  CC_BUILD_PLUGINS
@@ -503,6 +508,96 @@ typedef cc_uint8  cc_bool;
 #undef CC_BUILD_PLUGINS
 #endif
 
+/* Chunk meshes can be built on multiple worker threads when the compiler supports thread local variables */
+/* NOTE: 3DS runs its worker threads on the system core or New 3DS extra core (see Platform_3DS.c) */
+#if (!defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_LOWMEM) || defined CC_BUILD_3DS
+	#if _MSC_VER
+		#define CC_BUILD_MESHWORKERS
+		#define CC_THREADLOCAL __declspec(thread)
+	#elif __GNUC__
+		#define CC_BUILD_MESHWORKERS
+		#define CC_THREADLOCAL __thread
+	#endif
+#endif
+/* Trace events are recorded in per-thread ring buffers, which also needs thread local variables */
+#ifdef CC_THREADLOCAL
+	#define CC_BUILD_TRACELOG
+#endif
+/* Data from the server is received on a separate thread when threads are preemptive */
+/* NOTE: WebSockets on the web build can only be used from the main browser thread */
+#if defined CC_BUILD_NETWORKING && !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_WEB
+	#define CC_BUILD_NETTHREAD
+	/* Map data received from the server is also decompressed on worker threads */
+	#define CC_BUILD_MAPWORKERS
+#endif
+/* Embarrassingly parallel map generation stages are run on multiple worker threads, when threads are preemptive */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_LOWMEM
+	#define CC_BUILD_GENWORKERS
+#endif
+/* Files can be memory mapped for reading */
+#if (defined CC_BUILD_POSIX && !defined CC_BUILD_OS2) || defined CC_BUILD_WIN
+	#define CC_BUILD_FILEMAP
+#endif
+/* Files can be replaced by renaming another file over them, and deleted */
+#if defined CC_BUILD_POSIX || defined CC_BUILD_WIN
+	#define CC_BUILD_FILERENAME
+#endif
+/* options.txt is written out on a background worker thread, when threads are preemptive */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && defined CC_BUILD_FILERENAME
+	#define CC_BUILD_OPTIONSWORKER
+#endif
+/* Maps are saved in the background, and compressed on multiple worker threads, when threads are preemptive */
+/* NOTE: Files on the web build can only be accessed from the main browser thread */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_LOWMEM && defined CC_BUILD_FILESYSTEM && !defined CC_BUILD_WEB
+	#define CC_BUILD_SAVEWORKERS
+#endif
+/* Block changes in singleplayer are journalled, and periodically compacted into the map file in the background */
+#if defined CC_BUILD_SAVEWORKERS && defined CC_BUILD_FILERENAME
+	#define CC_BUILD_MAPJOURNAL
+#endif
+/* Texture pack entries are decompressed and decoded on multiple worker threads */
+/* NOTE: Relies on thread local variables (see CC_BUILD_MESHWORKERS), and decoding PNGs needs a large stack */
+#if defined CC_BUILD_MESHWORKERS && !defined CC_BUILD_TINYSTACK && !defined CC_BUILD_SMALLSTACK && !defined CC_BUILD_LOWMEM
+	#define CC_BUILD_ZIPWORKERS
+#endif
+/* Downloaded skins are decoded on a background worker thread, when threads are preemptive */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_TINYSTACK && !defined CC_BUILD_SMALLSTACK
+	#define CC_BUILD_SKINWORKERS
+#endif
+/* Jobs queued by Game_QueueJob are run on a few background worker threads, when threads are preemptive */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_TINYSTACK
+	#define CC_BUILD_JOBWORKERS
+#endif
+/* Chat log lines are written to disc on a background worker thread, when threads are preemptive */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && defined CC_BUILD_FILESYSTEM && !defined CC_BUILD_WEB
+	#define CC_BUILD_CHATLOGWORKER
+#endif
+/* Liquid physics in singleplayer are simulated on a background worker thread, when threads are preemptive */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_TINYSTACK
+	#define CC_BUILD_PHYSICSWORKER
+#endif
+/* Screenshots are encoded and saved on a background worker thread, after being read back from the GPU */
+#if CC_GFX_BACKEND_IS_GL() && !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_WEB && defined CC_BUILD_FILESYSTEM
+	#define CC_BUILD_SCREENSHOTWORKER
+#endif
+#ifndef CC_THREADLOCAL
+#define CC_THREADLOCAL
+#endif
+
+/* Chunk meshes are sub-allocated from a few large vertex buffers when the backend can update part of a buffer */
+#if (CC_GFX_BACKEND_IS_GL() && !defined CC_BUILD_GL11) || CC_GFX_BACKEND == CC_GFX_BACKEND_D3D9
+	#define CC_BUILD_CHUNKARENA
+#endif
+/* Chunk vertex buffers are also kept in system memory, so they can be reuploaded after the device is lost */
+/*  (instead of every chunk having to be rebuilt, which can take several seconds on large maps) */
+#if defined CC_BUILD_CHUNKARENA && CC_GFX_BACKEND == CC_GFX_BACKEND_D3D9
+	#define CC_BUILD_CHUNKSHADOW
+#endif
+/* Vertices drawn only once per frame are appended into one large streaming vertex buffer */
+#if defined CC_BUILD_CHUNKARENA && CC_GFX_BACKEND_IS_GL()
+	#define CC_BUILD_STREAMVB
+#endif
+
 #ifdef CC_BUILD_NETWORKING
 #define CUSTOM_MODELS
 #endif
@@ -152,7 +152,7 @@ enum INFLATE_STATE_ {
 };
 
 /* Insert next byte into the bit buffer */
-#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (cc_uint32)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
+#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (cc_uintptr)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
 /* Retrieves bits from the bit buffer */
 #define Inflate_PeekBits(state, bits) (state->Bits & ((1UL << (bits)) - 1UL))
 /* Consumes/eats up bits from the bit buffer */
@@ -163,6 +163,15 @@ enum INFLATE_STATE_ {
 #define Inflate_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { if (!state->AvailIn) return; Inflate_GetByte(state); }
 /* Ensures there are 'bitsCount' bits */
 #define Inflate_UNSAFE_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { Inflate_GetByte(state); }
+/* Inserts next 4 bytes into the bit buffer at once, if there are less than 32 bits and the bit buffer is 64 bits wide */
+/* NOTE: Does nothing on 32 bit CPUs, where Inflate_UNSAFE_EnsureBits is relied on instead */
+#define Inflate_UNSAFE_Refill(state) \
+if (sizeof(state->Bits) == 8 && state->NumBits < 32) {\
+	state->Bits |= (cc_uintptr)Inflate_GetU32_LE(state->NextIn) << state->NumBits;\
+	state->NextIn += 4; state->AvailIn -= 4; state->NumBits += 32;\
+}
+/* Reads 4 bytes in little endian order (which compilers can usually optimise to one load) */
+#define Inflate_GetU32_LE(data) ((cc_uint32)(data)[0] | ((cc_uint32)(data)[1] << 8) | ((cc_uint32)(data)[2] << 16) | ((cc_uint32)(data)[3] << 24))
 /* Peeks then consumes given bits */
 #define Inflate_ReadBits(state, bitsCount) Inflate_PeekBits(state, bitsCount); Inflate_ConsumeBits(state, bitsCount);
 /* Sets to given result and sets state to DONE */
@@ -312,9 +321,9 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 	Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS);\
 	packed = table.fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
 	if (packed >= 0) {\
-		consumedBits = packed >> INFLATE_FAST_BITS;\
+		consumedBits = packed >> INFLATE_FAST_LEN_SHIFT;\
 		Inflate_ConsumeBits(state, consumedBits);\
-		result = packed & 0x1FF;\
+		result = packed & INFLATE_FAST_VAL_MASK;\
 	} else {\
 		result = Huffman_UNSAFE_Decode_Slow(state, &table);\
 	}\
@@ -358,6 +367,34 @@ void Inflate_Init2(struct InflateState* state, struct Stream* source) {
 	state->Source = source;
 	state->WindowIndex = 0;
 	state->result = 0;
+	state->OutputBase = NULL;
+	state->OutputEnd  = NULL;
+}
+
+static void Inflate_EndOutputBuffer(struct InflateState* s) {
+	cc_uint32 written = (cc_uint32)(s->Output - s->OutputBase);
+	cc_uint32 i;
+
+	/* Window needs to contain the most recent output again */
+	if (written >= INFLATE_WINDOW_SIZE) {
+		Mem_Copy(s->Window, s->Output - INFLATE_WINDOW_SIZE, INFLATE_WINDOW_SIZE);
+		s->WindowIndex = 0;
+	} else {
+		for (i = 0; i < written; i++) 
+		{
+			s->Window[s->WindowIndex] = s->OutputBase[i];
+			s->WindowIndex = (s->WindowIndex + 1) & INFLATE_WINDOW_MASK;
+		}
+	}
+	s->OutputBase = NULL;
+	s->OutputEnd  = NULL;
+}
+
+void Inflate_SetOutputBuffer(struct InflateState* state, cc_uint8* buffer, cc_uint32 size) {
+	if (state->OutputBase) Inflate_EndOutputBuffer(state);
+	state->OutputBase = buffer;
+	state->OutputEnd  = buffer + size;
+	state->Output     = buffer;
 }
 
 static const cc_uint8 fixed_lits[INFLATE_MAX_LITS] = {
@@ -399,6 +436,42 @@ static const cc_uint8 codelens_order[INFLATE_MAX_CODELENS] = {
 	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 
 };
 
+/* Used to copy 8 bytes at once, regardless of alignment */
+struct InflateChunk { cc_uint8 data[8]; };
+
+/* Copies a previous match, where src is 'dist' bytes before dst */
+static CC_INLINE void Inflate_CopyMatch(cc_uint8* dst, cc_uint8* src, cc_uint32 len, cc_uint32 dist) {
+	cc_uint32 i = 0, step;
+
+	/* Output repeats every 'dist' bytes, so for short distances (e.g. runs of the */
+	/*  same byte), copy the first few bytes one at a time and then copy from */
+	/*  further back instead, at the first multiple of 'dist' that is at least 8 */
+	if (dist < 8 && len >= 16) {
+		for (step = dist; step < 8; step += dist) { }
+		for (; i < step; i++) { *dst++ = *src++; }
+		src = dst - step;
+	}
+
+	/* If the source is at least 8 bytes back, each 8 bytes copied never overlaps */
+	/*  with data written during that copy, so can copy 8 bytes at a time */
+	if (dst - src >= 8) {
+		for (; i + 8 <= len; i += 8, src += 8, dst += 8) {
+			*((struct InflateChunk*)dst) = *((struct InflateChunk*)src);
+		}
+	}
+	for (; i < len; i++) { *dst++ = *src++; }
+}
+
+/* Returns the previously output byte 'dist' bytes before the given position in the output buffer */
+/* NOTE: Only used when decompressing directly into an output buffer (see Inflate_SetOutputBuffer) */
+static cc_uint8 Inflate_GetHistory(struct InflateState* s, cc_uint8* cur, cc_uint32 dist) {
+	cc_uint32 written = (cc_uint32)(cur - s->OutputBase);
+	if (dist <= written) return cur[-(int)dist];
+
+	/* Window was last updated when began decompressing into the output buffer */
+	return s->Window[(s->WindowIndex - (dist - written)) & INFLATE_WINDOW_MASK];
+}
+
 static void Inflate_InflateFast(struct InflateState* s) {
 	/* huffman variables */
 	cc_uint32 lit, len, dist;
@@ -417,6 +490,7 @@ static void Inflate_InflateFast(struct InflateState* s) {
 
 #define INFLATE_FAST_COPY_MAX (INFLATE_WINDOW_SIZE - INFLATE_FASTINF_OUT)
 	while (s->AvailOut >= INFLATE_FASTINF_OUT && s->AvailIn >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
+		Inflate_UNSAFE_Refill(s);
 		Huffman_UNSAFE_Decode(s, s->Table.Lits, lit);
 
 		if (lit <= 256) {
@@ -434,6 +508,7 @@ static void Inflate_InflateFast(struct InflateState* s) {
 			Inflate_UNSAFE_EnsureBits(s, bits);
 			len  = len_base[lenIdx] + Inflate_ReadBits(s, bits);
 
+			Inflate_UNSAFE_Refill(s);
 			Huffman_UNSAFE_Decode(s, s->TableDists, distIdx);
 			bits = dist_bits[distIdx];
 			Inflate_UNSAFE_EnsureBits(s, bits);
@@ -443,13 +518,7 @@ static void Inflate_InflateFast(struct InflateState* s) {
 			/* If start and end don't cross a boundary, can avoid masking index */
 			startIdx = (curIdx - dist) & INFLATE_WINDOW_MASK;
 			if (curIdx >= startIdx && (curIdx + len) < INFLATE_WINDOW_SIZE) {
-				cc_uint8* src = &window[startIdx]; 
-				cc_uint8* dst = &window[curIdx];
-
-				for (i = 0; i < (len & ~0x3); i += 4) {
-					*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
-				}
-				for (; i < len; i++) { *dst++ = *src++; }
+				Inflate_CopyMatch(&window[curIdx], &window[startIdx], len, dist);
 			} else {
 				for (i = 0; i < len; i++) {
 					window[(curIdx + i) & INFLATE_WINDOW_MASK] = window[(startIdx + i) & INFLATE_WINDOW_MASK];
@@ -475,6 +544,52 @@ static void Inflate_InflateFast(struct InflateState* s) {
 	}
 }
 
+/* Same as Inflate_InflateFast, but decompresses directly into the output buffer */
+static void Inflate_InflateFastDirect(struct InflateState* s) {
+	/* huffman variables */
+	cc_uint32 lit, len, dist;
+	cc_uint32 bits, lenIdx, distIdx;
+	int packed, consumedBits;
+
+	cc_uint8* out = s->Output;
+	cc_uint32 i;
+
+	while (s->AvailOut >= INFLATE_FASTINF_OUT && s->AvailIn >= INFLATE_FASTINF_IN) {
+		Inflate_UNSAFE_Refill(s);
+		Huffman_UNSAFE_Decode(s, s->Table.Lits, lit);
+
+		if (lit <= 256) {
+			if (lit < 256) {
+				*out++ = (cc_uint8)lit;
+				s->AvailOut--;
+			} else {
+				s->State = Inflate_NextBlockState(s);
+				break;
+			}
+		} else {
+			lenIdx = lit - 257;
+			bits = len_bits[lenIdx];
+			Inflate_UNSAFE_EnsureBits(s, bits);
+			len  = len_base[lenIdx] + Inflate_ReadBits(s, bits);
+
+			Inflate_UNSAFE_Refill(s);
+			Huffman_UNSAFE_Decode(s, s->TableDists, distIdx);
+			bits = dist_bits[distIdx];
+			Inflate_UNSAFE_EnsureBits(s, bits);
+			dist = dist_base[distIdx] + Inflate_ReadBits(s, bits);
+
+			/* Match might start before the output buffer (rare) */
+			if (dist <= (cc_uint32)(out - s->OutputBase)) {
+				Inflate_CopyMatch(out, out - dist, len, dist);
+			} else {
+				for (i = 0; i < len; i++) { out[i] = Inflate_GetHistory(s, out + i, dist); }
+			}
+			out += len; s->AvailOut -= len;
+		}
+	}
+	s->Output = out;
+}
+
 void Inflate_Process(struct InflateState* s) {
 	cc_uint32 len, dist, nlen;
 	cc_uint32 i, bits;
@@ -539,16 +654,21 @@ void Inflate_Process(struct InflateState* s) {
 			/* read bits left in bit buffer (slow way) */
 			while (s->NumBits && s->AvailOut && s->Index) {
 				*s->Output = Inflate_ReadBits(s, 8);
-				s->Window[s->WindowIndex] = *s->Output;
-
-				s->WindowIndex = (s->WindowIndex + 1) & INFLATE_WINDOW_MASK;
+				if (!s->OutputBase) {
+					s->Window[s->WindowIndex] = *s->Output;
+					s->WindowIndex = (s->WindowIndex + 1) & INFLATE_WINDOW_MASK;
+				}
 				s->Output++; s->AvailOut--;	s->Index--;
 			}
 			if (!s->AvailIn || !s->AvailOut) return;
 
 			copyLen = min(s->AvailIn, s->AvailOut);
 			copyLen = min(copyLen, s->Index);
-			if (copyLen > 0) {
+			if (copyLen > 0 && s->OutputBase) {
+				Mem_Copy(s->Output, s->NextIn, copyLen);
+				s->Output += copyLen; s->AvailOut -= copyLen; s->Index -= copyLen;
+				s->NextIn += copyLen; s->AvailIn  -= copyLen;
+			} else if (copyLen > 0) {
 				Mem_Copy(s->Output, s->NextIn, copyLen);
 				windowCopyLen = INFLATE_WINDOW_SIZE - s->WindowIndex;
 				windowCopyLen = min(windowCopyLen, copyLen);
@@ -667,8 +787,10 @@ void Inflate_Process(struct InflateState* s) {
 			if (lit < 256) {
 				if (lit == -1) return;
 				*s->Output = (cc_uint8)lit;
-				s->Window[s->WindowIndex] = (cc_uint8)lit;
 				s->Output++; s->AvailOut--;
+				if (s->OutputBase) break;
+
+				s->Window[s->WindowIndex] = (cc_uint8)lit;
 				s->WindowIndex = (s->WindowIndex + 1) & INFLATE_WINDOW_MASK;
 				break;
 			} else if (lit == 256) {
@@ -710,17 +832,24 @@ void Inflate_Process(struct InflateState* s) {
 			len = s->TmpLit; dist = s->TmpDist;
 			len = min(len, s->AvailOut);
 
-			/* TODO: Should we test outside of the loop, whether a masking will be required or not? */		
-			startIdx = (s->WindowIndex - dist) & INFLATE_WINDOW_MASK;
-			curIdx   = s->WindowIndex;
-			for (i = 0; i < len; i++) {
-				cc_uint8 value = s->Window[(startIdx + i) & INFLATE_WINDOW_MASK];
-				*s->Output = value;
-				s->Window[(curIdx + i) & INFLATE_WINDOW_MASK] = value;
-				s->Output++;
+			if (s->OutputBase) {
+				for (i = 0; i < len; i++) {
+					*s->Output = Inflate_GetHistory(s, s->Output, dist);
+					s->Output++;
+				}
+			} else {
+				/* TODO: Should we test outside of the loop, whether a masking will be required or not? */		
+				startIdx = (s->WindowIndex - dist) & INFLATE_WINDOW_MASK;
+				curIdx   = s->WindowIndex;
+				for (i = 0; i < len; i++) {
+					cc_uint8 value = s->Window[(startIdx + i) & INFLATE_WINDOW_MASK];
+					*s->Output = value;
+					s->Window[(curIdx + i) & INFLATE_WINDOW_MASK] = value;
+					s->Output++;
+				}
+				s->WindowIndex = (curIdx + len) & INFLATE_WINDOW_MASK;
 			}
 
-			s->WindowIndex = (curIdx + len) & INFLATE_WINDOW_MASK;
 			s->TmpLit   -= len;
 			s->AvailOut -= len;
 			if (!s->TmpLit) { s->State = Inflate_NextCompressState(s); }
@@ -728,7 +857,11 @@ void Inflate_Process(struct InflateState* s) {
 		}
 
 		case INFLATE_STATE_FASTCOMPRESSED: {
-			Inflate_InflateFast(s);
+			if (s->OutputBase) {
+				Inflate_InflateFastDirect(s);
+			} else {
+				Inflate_InflateFast(s);
+			}
 			if (s->State == INFLATE_STATE_FASTCOMPRESSED) {
 				s->State = Inflate_NextCompressState(s);
 			}
@@ -751,6 +884,11 @@ static cc_result Inflate_StreamRead(struct Stream* stream, cc_uint8* data, cc_ui
 
 	*modified = 0;
 	state = (struct InflateState*)stream->meta.inflate;
+
+	/* Stop decompressing directly into the output buffer if not reading the rest of it */
+	if (state->OutputBase && (data != state->Output || data + count > state->OutputEnd)) {
+		Inflate_EndOutputBuffer(state);
+	}
 	state->Output   = data;
 	state->AvailOut = count;
 
@@ -792,64 +930,469 @@ void Inflate_MakeStream2(struct Stream* stream, struct InflateState* state, stru
 /*########################################################################################################################*
 *---------------------------------------------------Deflate (compress)----------------------------------------------------*
 *#########################################################################################################################*/
-/* these are copies of len_base and dist_base, with UINT16_MAX instead of 0 for sentinel cutoff */
-static const cc_uint16 deflate_len[30] = {
-	3,4,5,6,7,8,9,10,11,13,
-	15,17,19,23,27,31,35,43,51,59,
-	67,83,99,115,131,163,195,227,258,UInt16_MaxValue
-};
-static const cc_uint16 deflate_dist[31] = {
-	1,2,3,4,5,7,9,13,17,25,
-	33,49,65,97,129,193,257,385,513,769,
-	1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,UInt16_MaxValue
-};
+/* Max number of previous matches explored at each position for DEFLATE_LEVEL_FAST */
+#define DEFLATE_FAST_CHAIN 8
+/* Max number of previous matches explored at each position for DEFLATE_LEVEL_BEST */
+#define DEFLATE_BEST_CHAIN 128
+/* Only explore a quarter as many matches when already found a match this long */
+#define DEFLATE_GOOD_LEN 8
+/* Don't look for a better match at the next position when already found a match this long */
+#define DEFLATE_LAZY_LEN 16
+/* Stop looking for a better match when already found a match this long */
+#define DEFLATE_NICE_LEN 128
+
+/* Lookup table from (length - MIN_MATCH_LEN) to length code (excluding 257 offset) */
+static cc_uint8 deflate_lenCodes[256];
+/* Lookup table from distance to distance code (see Deflate_DistCode) */
+static cc_uint8 deflate_distCodes[512];
+static cc_bool deflate_codesInited;
+
+#define MIN_MATCH_LEN 3
+#define MAX_MATCH_LEN 258
+/* Distances above 256 share a distance code with the other 127 distances around them */
+#define Deflate_DistCode(dist) ((dist) <= 256 ? deflate_distCodes[(dist) - 1] : deflate_distCodes[256 + (((dist) - 1) >> 7)])
+
+static void Deflate_InitCodes(void) {
+	int code, i;
+	if (deflate_codesInited) return;
+
+	for (code = 0; code < 29; code++) {
+		for (i = len_base[code]; i < len_base[code] + (1 << len_bits[code]) && i <= MAX_MATCH_LEN; i++) {
+			deflate_lenCodes[i - MIN_MATCH_LEN] = code;
+		}
+	}
+	for (code = 0; code < 30; code++) {
+		for (i = dist_base[code]; i < dist_base[code] + (1 << dist_bits[code]); i++) {
+			if (i <= 256) { deflate_distCodes[i - 1] = code; continue; }
+			deflate_distCodes[256 + ((i - 1) >> 7)] = code;
+		}
+	}
+	deflate_codesInited = true;
+}
 
 /* Pushes given bits, but does not write them */
-#define Deflate_PushBits(state, value, bits) state->Bits |= (value) << state->NumBits; state->NumBits += (bits);
-/* Pushes bits of the huffman codeword bits for the given literal, but does not write them */
-#define Deflate_PushLit(state, value) Deflate_PushBits(state, state->LitsCodewords[value], state->LitsLens[value])
-/* Pushes given bits (reversing for huffman code), but does not write them */
-#define Deflate_PushHuff(state, value, bits) Deflate_PushBits(state, Huffman_ReverseBits(value, bits), bits)
+#define Deflate_PushBits(state, value, bits) state->Bits |= (cc_uint32)(value) << state->NumBits; state->NumBits += (bits);
 /* Writes given byte to output */
 #define Deflate_WriteByte(state) *state->NextOut++ = state->Bits; state->AvailOut--; state->Bits >>= 8; state->NumBits -= 8;
 /* Flushes bits in buffer to output buffer */
 #define Deflate_FlushBits(state) while (state->NumBits >= 8) { Deflate_WriteByte(state); }
 
-#define MIN_MATCH_LEN 3
-#define MAX_MATCH_LEN 258
+/* Comparing 8 bytes at once is only safe when unaligned reads are allowed */
+#if defined __GNUC__ && defined __BYTE_ORDER__ && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && (defined __x86_64__ || defined __i386__ || defined __aarch64__)
+typedef cc_uint64 __attribute__((aligned(1), may_alias)) Deflate_Word;
+#define DEFLATE_WORD_COMPARE
+#endif
 
 /* Number of bytes that match (are the same) from a and b */
-static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
+static CC_INLINE int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
 	int i = 0;
-	while (i < maxLen && *a == *b) { i++; a++; b++; }
+#ifdef DEFLATE_WORD_COMPARE
+	for (; i + 8 <= maxLen; i += 8) {
+		cc_uint64 diff = *((Deflate_Word*)(a + i)) ^ *((Deflate_Word*)(b + i));
+		/* Lowest set bit is in the first byte that differs */
+		if (diff) return i + (__builtin_ctzll(diff) >> 3);
+	}
+#endif
+	while (i < maxLen && a[i] == b[i]) i++;
 	return i;
 }
 
 /* Hashes 3 bytes of data */
-static cc_uint32 Deflate_Hash(cc_uint8* src) {
-	return (cc_uint32)((src[0] << 8) ^ (src[1] << 4) ^ (src[2])) & DEFLATE_HASH_MASK;
+static CC_INLINE cc_uint32 Deflate_Hash(cc_uint8* src) {
+	cc_uint32 value = (src[0] << 16) | (src[1] << 8) | src[2];
+	return (cc_uint32)(value * 2654435761UL) >> (32 - DEFLATE_HASH_BITS);
 }
 
-/* Writes a literal to state->Output */
-static void Deflate_Lit(struct DeflateState* state, int lit) {
-	Deflate_PushLit(state, lit);
-	Deflate_FlushBits(state);
+/* Inserts the given position into its hash chain, returning the most recent previous position with the same hash */
+static CC_INLINE int Deflate_Insert(struct DeflateState* state, int pos) {
+	cc_uint32 hash = Deflate_Hash(&state->Input[pos]);
+	int prev = state->Head[hash];
+
+	state->Head[hash] = pos;
+	state->Prev[pos]  = prev;
+	return prev;
+}
+
+/* Inserts the positions within a match into the hash chains */
+/* NOTE: The first position of the match must have already been inserted */
+static CC_INLINE void Deflate_InsertMatch(struct DeflateState* state, int pos, int matchLen, int len) {
+	int i, end = min(matchLen, len - (MIN_MATCH_LEN - 1));
+	for (i = 1; i < end; i++) { Deflate_Insert(state, pos + i); }
+}
+
+/* Finds the longest previous match for the data at the given position */
+/* Returns length of the match, or less than MIN_MATCH_LEN if no match was found */
+static int Deflate_FindMatch(struct DeflateState* state, int pos, int prev, int maxLen, int maxDepth, int* matchDist) {
+	int niceLen = min(maxLen, DEFLATE_NICE_LEN);
+	cc_uint8* input = state->Input;
+	cc_uint8* cur   = input + pos;
+	int bestLen = MIN_MATCH_LEN - 1, matchLen, depth;
+
+	for (depth = 0; prev != 0 && depth < maxDepth; depth++) {
+		/* Quickly reject matches that can't be longer than the current best match */
+		if (input[prev + bestLen] == cur[bestLen] && input[prev] == cur[0]) {
+			matchLen = Deflate_MatchLen(input + prev, cur, maxLen);
+
+			if (matchLen > bestLen) { 
+				bestLen    = matchLen;
+				*matchDist = pos - prev;
+				if (matchLen >= niceLen) break;
+			}
+		}
+		prev = state->Prev[prev];
+	}
+	return bestLen;
+}
+
+static CC_INLINE void Deflate_AddLit(struct DeflateState* state, int lit) {
+	cc_uint8* sym = &state->Symbols[state->NumSymbols * 3];
+	sym[0] = 0; sym[1] = 0; sym[2] = lit;
+
+	state->NumSymbols++;
+	state->LitsFreqs[lit]++;
+}
+
+static CC_INLINE void Deflate_AddMatch(struct DeflateState* state, int len, int dist) {
+	cc_uint8* sym = &state->Symbols[state->NumSymbols * 3];
+	sym[0] = dist; sym[1] = dist >> 8; sym[2] = len - MIN_MATCH_LEN;
+
+	state->NumSymbols++;
+	state->LitsFreqs[257 + deflate_lenCodes[len - MIN_MATCH_LEN]]++;
+	state->DistsFreqs[Deflate_DistCode(dist)]++;
+}
+
+/* Greedily uses the longest match at each position */
+static void Deflate_CompressFast(struct DeflateState* state, int pos, int len) {
+	int prev, matchLen, matchDist = 0;
+
+	while (len >= MIN_MATCH_LEN) {
+		prev     = Deflate_Insert(state, pos);
+		matchLen = Deflate_FindMatch(state, pos, prev, min(len, MAX_MATCH_LEN), 
+									DEFLATE_FAST_CHAIN, &matchDist);
+
+		if (matchLen < MIN_MATCH_LEN) {
+			Deflate_AddLit(state, state->Input[pos]);
+			pos++; len--; continue;
+		}
+
+		Deflate_AddMatch(state, matchLen, matchDist);
+		Deflate_InsertMatch(state, pos, matchLen, len);
+		pos += matchLen; len -= matchLen;
+	}
+
+	/* literals for last few bytes */
+	for (; len > 0; pos++, len--) { Deflate_AddLit(state, state->Input[pos]); }
+}
+
+/* Lazy evaluation: Only uses the match at a position if the match at the next position isn't longer */
+/*  (e.g. "abc" followed by "bcdefg", prefers literal 'a' and then the "bcdefg" match) */
+static void Deflate_CompressLazy(struct DeflateState* state, int pos, int len) {
+	int prev, matchLen, matchDist = 0, maxDepth, maxLen;
+	int prevLen = 0, prevDist = 0;
+	cc_bool pending = false; /* whether previous position still needs to be output */
+
+	while (len >= MIN_MATCH_LEN) {
+		prev     = Deflate_Insert(state, pos);
+		matchLen = MIN_MATCH_LEN - 1;
+
+		/* Don't bother searching as hard when already have a good match */
+		if (prevLen < DEFLATE_LAZY_LEN) {
+			maxDepth = prevLen >= DEFLATE_GOOD_LEN ? DEFLATE_BEST_CHAIN / 4 : DEFLATE_BEST_CHAIN;
+			maxLen   = min(len, MAX_MATCH_LEN);
+			matchLen = Deflate_FindMatch(state, pos, prev, maxLen, maxDepth, &matchDist);
+		}
+
+		if (prevLen >= MIN_MATCH_LEN && matchLen <= prevLen) {
+			/* Match at previous position is better, so use that instead */
+			Deflate_AddMatch(state, prevLen, prevDist);
+			/* Previous and current position were already inserted */
+			Deflate_InsertMatch(state, pos, prevLen - 1, len);
+
+			pos += prevLen - 1; len -= prevLen - 1;
+			pending = false;
+			prevLen = 0;
+			continue;
+		}
+
+		if (pending) Deflate_AddLit(state, state->Input[pos - 1]);
+		pending  = true;
+		prevLen  = matchLen;
+		prevDist = matchDist;
+		pos++; len--;
+	}
+
+	if (pending && prevLen >= MIN_MATCH_LEN) {
+		Deflate_AddMatch(state, prevLen, prevDist);
+		pos += prevLen - 1; len -= prevLen - 1;
+	} else if (pending) {
+		Deflate_AddLit(state, state->Input[pos - 1]);
+	}
+
+	/* literals for last few bytes */
+	for (; len > 0; pos++, len--) { Deflate_AddLit(state, state->Input[pos]); }
+}
+
+/* Computes length limited huffman code lengths for the given symbol frequencies */
+/* Based off tdefl_calculate_minimum_redundancy and tdefl_huffman_enforce_max_code_size in miniz */
+static void Deflate_BuildLengths(cc_uint16* freqs, int count, int maxBits, cc_uint8* lens) {
+	cc_uint32 keys[INFLATE_MAX_LITS];
+	cc_uint16 syms[INFLATE_MAX_LITS];
+	int numCodes[32];
+	int root, leaf, next, avail, used, depth;
+	int i, j, n = 0;
+	cc_uint32 total;
+
+	/* Decoders may reject huffman tables with only one codeword */
+	for (i = 0; i < count; i++) { if (freqs[i]) n++; }
+	for (i = 0; i < 2 && n < 2; i++) { if (!freqs[i]) { freqs[i] = 1; n++; } }
+
+	/* Sort used symbols by frequency */
+	n = 0;
+	for (i = 0; i < count; i++) {
+		lens[i] = 0;
+		if (!freqs[i]) continue;
+
+		for (j = n; j > 0 && keys[j - 1] > freqs[i]; j--) {
+			keys[j] = keys[j - 1]; syms[j] = syms[j - 1];
+		}
+		keys[j] = freqs[i]; syms[j] = i; n++;
+	}
+
+	/* Compute optimal code lengths in place (Moffat-Katajainen algorithm) */
+	keys[0] += keys[1];
+	root = 0; leaf = 2;
+	for (next = 1; next < n - 1; next++) {
+		if (leaf >= n || keys[root] < keys[leaf]) {
+			keys[next] = keys[root]; keys[root++] = next;
+		} else {
+			keys[next] = keys[leaf++];
+		}
+
+		if (leaf >= n || (root < next && keys[root] < keys[leaf])) {
+			keys[next] += keys[root]; keys[root++] = next;
+		} else {
+			keys[next] += keys[leaf++];
+		}
+	}
+
+	keys[n - 2] = 0;
+	for (next = n - 3; next >= 0; next--) { keys[next] = keys[keys[next]] + 1; }
+
+	avail = 1; used = 0; depth = 0;
+	root  = n - 2; next = n - 1;
+	while (avail > 0) {
+		while (root >= 0 && (int)keys[root] == depth) { used++; root--; }
+		while (avail > used) { keys[next--] = depth; avail--; }
+		avail = 2 * used; depth++; used = 0;
+	}
+
+	/* Limit code lengths to maxBits, while keeping the code complete */
+	for (i = 0; i < 32; i++) numCodes[i] = 0;
+	for (i = 0; i < n; i++) numCodes[min(keys[i], 31)]++;
+
+	for (i = maxBits + 1; i < 32; i++) numCodes[maxBits] += numCodes[i];
+	total = 0;
+	for (i = maxBits; i > 0; i--) total += (cc_uint32)numCodes[i] << (maxBits - i);
+
+	while (total != (1UL << maxBits)) {
+		numCodes[maxBits]--;
+		for (i = maxBits - 1; i > 0; i--) {
+			if (!numCodes[i]) continue;
+			numCodes[i]--; numCodes[i + 1] += 2; break;
+		}
+		total--;
+	}
+
+	/* Least frequent symbols get the longest codes */
+	j = 0;
+	for (i = maxBits; i > 0; i--) {
+		for (used = numCodes[i]; used > 0; used--) { lens[syms[j++]] = i; }
+	}
+}
+
+/* Constructs a huffman encoding table (for values to codewords) */
+static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
+	int i, j, offset, codeword;
+	struct HuffmanTable table;
+
+	/* NOTE: Can ignore since lens table is always valid */
+	(void)Huffman_Build(&table, lens, count);
+	for (i = 0; i < INFLATE_MAX_BITS; i++) {
+		if (!table.endCodewords[i]) continue;
+		count = table.endCodewords[i] - table.firstCodewords[i];
+
+		for (j = 0; j < count; j++) {
+			offset   = table.values[table.firstOffsets[i] + j];
+			codeword = table.firstCodewords[i] + j;
+			bitlens[offset]   = i;
+			codewords[offset] = Huffman_ReverseBits(codeword, i);
+		}
+	}
+}
+
+/* Run length encodes code lengths, using the repeat symbols 16/17/18 */
+/* Each entry in syms is a code length symbol, followed by its extra bits value */
+static int Deflate_EncodeLens(const cc_uint8* lens, int count, cc_uint8* syms) {
+	int i, run, num = 0;
+
+	for (i = 0; i < count; i += run) {
+		for (run = 1; i + run < count && lens[i + run] == lens[i]; run++) { }
+
+		if (!lens[i] && run >= 11) {
+			run = min(run, 138);
+			syms[num++] = 18; syms[num++] = run - 11;
+		} else if (!lens[i] && run >= 3) {
+			syms[num++] = 17; syms[num++] = run - 3;
+		} else if (run >= 4) {
+			/* Repeat symbol repeats the previous code length, so write the first one normally */
+			run = min(run, 7);
+			syms[num++] = lens[i]; syms[num++] = 0;
+			syms[num++] = 16;      syms[num++] = run - 4;
+		} else {
+			run = 1;
+			syms[num++] = lens[i]; syms[num++] = 0;
+		}
+	}
+	return num;
+}
+
+static const cc_uint8 codelens_extra[INFLATE_MAX_CODELENS] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 2,3,7 };
+
+/* Writes output buffer to destination stream */
+static cc_result Deflate_FlushOutput(struct DeflateState* state) {
+	cc_result res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	state->NextOut  = state->Output;
+	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
 }
 
-/* Writes a length-distance pair to state->Output */
-static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
-	int j;
-	/* TODO: Do we actually need the if (len_bits[j]) ????????? does writing 0 bits matter??? */
+/* Writes the huffman tables for a dynamic huffman block */
+static cc_result Deflate_WriteDynamicHeader(struct DeflateState* state, int numLits, int numDists,
+											cc_uint8* syms, int numSyms, cc_uint8* clLens, int numCodelens) {
+	cc_uint16 clCodewords[INFLATE_MAX_CODELENS];
+	cc_uint8 clBits[INFLATE_MAX_CODELENS];
+	int i, sym;
+	cc_result res;
 
-	for (j = 0; len >= deflate_len[j + 1]; j++);
-	Deflate_PushLit(state, j + 257);
-	if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
+	Deflate_BuildTable(clLens, INFLATE_MAX_CODELENS, clCodewords, clBits);
+	Deflate_PushBits(state, numLits  - 257, 5);
+	Deflate_PushBits(state, numDists - 1,   5);
+	Deflate_PushBits(state, numCodelens - 4, 4);
 	Deflate_FlushBits(state);
 
-	for (j = 0; dist >= deflate_dist[j + 1]; j++);
-	Deflate_PushHuff(state, j, 5);
-	if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
+	for (i = 0; i < numCodelens; i++) {
+		Deflate_PushBits(state, clLens[codelens_order[i]], 3);
+		Deflate_FlushBits(state);
+	}
+
+	for (i = 0; i < numSyms; i += 2) {
+		sym = syms[i];
+		Deflate_PushBits(state, clCodewords[sym], clLens[sym]);
+		Deflate_PushBits(state, syms[i + 1], codelens_extra[sym]);
+		Deflate_FlushBits(state);
+
+		if (state->AvailOut >= 16) continue;
+		if ((res = Deflate_FlushOutput(state))) return res;
+	}
+	return 0;
+}
+
+/* Chooses huffman codes for the symbols in the current block, then writes it to output */
+static cc_result Deflate_WriteBlock(struct DeflateState* state, cc_bool lastBlock) {
+	cc_uint8 lens[INFLATE_MAX_LITS_DISTS];
+	cc_uint8 syms[INFLATE_MAX_LITS_DISTS * 2];
+	cc_uint16 clFreqs[INFLATE_MAX_CODELENS];
+	cc_uint8 clLens[INFLATE_MAX_CODELENS];
+	cc_uint32 fixedBits, dynamicBits;
+	cc_bool dynamic = false;
+	int i, numLits, numDists, numSyms, numCodelens;
+	int len, dist, code;
+	cc_uint8* sym;
+	cc_result res;
+
+	/* End of block symbol */
+	state->LitsFreqs[256]++;
+
+	if (state->Level >= DEFLATE_LEVEL_BEST) {
+		Deflate_BuildLengths(state->LitsFreqs,  INFLATE_MAX_LITS - 2,  15, lens);
+		Deflate_BuildLengths(state->DistsFreqs, INFLATE_MAX_DISTS - 2, 15, lens + INFLATE_MAX_LITS);
+
+		for (numLits  = INFLATE_MAX_LITS  - 2; numLits  > 257 && !lens[numLits - 1]; numLits--) { }
+		for (numDists = INFLATE_MAX_DISTS - 2; numDists > 1   && !lens[INFLATE_MAX_LITS + numDists - 1]; numDists--) { }
+		/* Literal and distance code lengths are written one after another */
+		Mem_Move(lens + numLits, lens + INFLATE_MAX_LITS, numDists);
+		numSyms = Deflate_EncodeLens(lens, numLits + numDists, syms);
+
+		for (i = 0; i < INFLATE_MAX_CODELENS; i++) clFreqs[i] = 0;
+		for (i = 0; i < numSyms; i += 2) clFreqs[syms[i]]++;
+		Deflate_BuildLengths(clFreqs, INFLATE_MAX_CODELENS, 7, clLens);
+
+		for (numCodelens = INFLATE_MAX_CODELENS; numCodelens > 4; numCodelens--) {
+			if (clLens[codelens_order[numCodelens - 1]]) break;
+		}
+
+		/* Compute number of bits for each block type (extra bits are the same for both) */
+		fixedBits   = 0;
+		dynamicBits = 14 + 3 * numCodelens;
+		for (i = 0; i < numSyms; i += 2) {
+			dynamicBits += clLens[syms[i]] + codelens_extra[syms[i]];
+		}
+		for (i = 0; i < numLits; i++) {
+			fixedBits   += state->LitsFreqs[i] * fixed_lits[i];
+			dynamicBits += state->LitsFreqs[i] * lens[i];
+		}
+		for (i = 0; i < numDists; i++) {
+			fixedBits   += state->DistsFreqs[i] * 5;
+			dynamicBits += state->DistsFreqs[i] * lens[numLits + i];
+		}
+		dynamic = dynamicBits < fixedBits;
+	}
+
+	Deflate_PushBits(state, lastBlock, 1);
+	if (dynamic) {
+		Deflate_PushBits(state, 2, 2); /* block type DYNAMIC */
+		if ((res = Deflate_WriteDynamicHeader(state, numLits, numDists, syms, numSyms, clLens, numCodelens))) return res;
+
+		Deflate_BuildTable(lens,           numLits,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(lens + numLits, numDists, state->DistsCodewords, state->DistsLens);
+	} else {
+		Deflate_PushBits(state, 1, 2); /* block type FIXED */
+		Deflate_BuildTable(fixed_lits,  INFLATE_MAX_LITS,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(fixed_dists, INFLATE_MAX_DISTS, state->DistsCodewords, state->DistsLens);
+	}
+	
+	for (i = 0; i < state->NumSymbols; i++) {
+		sym  = &state->Symbols[i * 3];
+		dist = sym[0] | (sym[1] << 8);
+
+		if (!dist) {
+			Deflate_PushBits(state, state->LitsCodewords[sym[2]], state->LitsLens[sym[2]]);
+		} else {
+			len  = sym[2] + MIN_MATCH_LEN;
+			code = deflate_lenCodes[sym[2]];
+			Deflate_PushBits(state, state->LitsCodewords[code + 257], state->LitsLens[code + 257]);
+			Deflate_PushBits(state, len - len_base[code], len_bits[code]);
+			Deflate_FlushBits(state);
+
+			code = Deflate_DistCode(dist);
+			Deflate_PushBits(state, state->DistsCodewords[code], state->DistsLens[code]);
+			Deflate_FlushBits(state);
+			Deflate_PushBits(state, dist - dist_base[code], dist_bits[code]);
+		}
+		Deflate_FlushBits(state);
+
+		/* leave room for a few bytes at end */
+		if (state->AvailOut >= 16) continue;
+		if ((res = Deflate_FlushOutput(state))) return res;
+	}
+
+	Deflate_PushBits(state, state->LitsCodewords[256], state->LitsLens[256]);
 	Deflate_FlushBits(state);
+
+	state->NumSymbols = 0;
+	Mem_Set(state->LitsFreqs,  0, sizeof(state->LitsFreqs));
+	Mem_Set(state->DistsFreqs, 0, sizeof(state->DistsFreqs));
+	return 0;
 }
 
 /* Moves "current block" to "previous block", adjusting state if needed. */
@@ -862,95 +1405,27 @@ static void Deflate_MoveBlock(struct DeflateState* state) {
 	for (i = 0; i < Array_Elems(state->Head); i++) {
 		state->Head[i] = state->Head[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Head[i] - DEFLATE_BLOCK_SIZE);
 	}
-	for (i = 0; i < Array_Elems(state->Prev); i++) {
-		state->Prev[i] = state->Prev[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Prev[i] - DEFLATE_BLOCK_SIZE);
+	/* hash chain links have to move along with the data too */
+	for (i = 0; i < DEFLATE_BLOCK_SIZE; i++) {
+		cc_uint16 prev = state->Prev[i + DEFLATE_BLOCK_SIZE];
+		state->Prev[i] = prev < DEFLATE_BLOCK_SIZE ? 0 : (prev - DEFLATE_BLOCK_SIZE);
 	}
 }
 
 /* Compresses current block of data */
-static cc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
-	cc_uint32 hash, nextHash;
-	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
-	cc_uint16 oldHead;
-	cc_uint8* input;
-	cc_uint8* cur;
+static cc_result Deflate_FlushBlock(struct DeflateState* state, int len, cc_bool lastBlock) {
 	cc_result res;
 
-	if (!state->WroteHeader) {
-		state->WroteHeader = true;
-		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
-	}
-
 	/* Based off descriptions from http://www.gzip.org/algorithm.txt and
 	https://github.com/nothings/stb/blob/master/stb_image_write.h */
-	input = state->Input;
-	cur   = input + DEFLATE_BLOCK_SIZE;
-
-	/* Compress current block of data */
-	/* Use > instead of >=, because also try match at one byte after current */
-	while (len > MIN_MATCH_LEN) {
-		hash   = Deflate_Hash(cur);
-		maxLen = min(len, MAX_MATCH_LEN);
-
-		bestLen = MIN_MATCH_LEN - 1; /* Match must be at least 3 bytes */
-		bestPos = 0;
-
-		/* Find longest match starting at this byte */
-		/* Only explore up to 5 previous matches, to avoid slow performance */
-		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
-		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
-			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
-			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
-			pos = state->Prev[pos];
-		}
-
-		/* Insert this entry into the hash chain */
-		pos = (int)(cur - input);
-		oldHead = state->Head[hash];
-		state->Head[hash] = pos;
-		state->Prev[pos]  = oldHead;
-
-		/* Lazy evaluation: Find longest match starting at next byte */
-		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
-			nextHash = Deflate_Hash(cur + 1);
-			nextPos  = state->Head[nextHash];
-			maxLen   = min(len - 1, MAX_MATCH_LEN);
-
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
-				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
-				if (matchLen > bestLen) { bestPos = 0; break; }
-				nextPos = state->Prev[nextPos];
-			}
-		}
-
-		if (bestPos) {
-			Deflate_LenDist(state, bestLen, pos - bestPos);
-			len -= bestLen; cur += bestLen;
-		} else {
-			Deflate_Lit(state, *cur);
-			len--; cur++;
-		}
-
-		/* leave room for a few bytes and literals at end */
-		if (state->AvailOut >= 20) continue;
-		res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-		state->NextOut  = state->Output;
-		state->AvailOut = DEFLATE_OUT_SIZE;
-		if (res) return res;
-	}
-
-	/* literals for last few bytes */
-	while (len > 0) {
-		Deflate_Lit(state, *cur);
-		len--; cur++;
+	if (state->Level >= DEFLATE_LEVEL_BEST) {
+		Deflate_CompressLazy(state, DEFLATE_BLOCK_SIZE, len);
+	} else {
+		Deflate_CompressFast(state, DEFLATE_BLOCK_SIZE, len);
 	}
 
-	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-	state->NextOut  = state->Output;
-	state->AvailOut = DEFLATE_OUT_SIZE;
+	if ((res = Deflate_WriteBlock(state, lastBlock))) return res;
+	res = Deflate_FlushOutput(state);
 
 	Deflate_MoveBlock(state);
 	return res;
@@ -978,26 +1453,22 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 		data += len;
 
 		if (state->InputPosition == DEFLATE_BUFFER_SIZE) {
-			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
+			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE, false);
 			if (res) return res;
 		}
 	}
 	return 0;
 }
 
-/* Flushes any buffered data, then writes terminating symbol */
+/* Flushes any buffered data as the final block */
 static cc_result Deflate_StreamClose(struct Stream* stream) {
 	struct DeflateState* state;
 	cc_result res;
 
 	state = (struct DeflateState*)stream->meta.inflate;
-	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
+	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE, true);
 	if (res) return res;
 
-	/* Write huffman encoded "literal 256" to terminate symbols */
-	Deflate_PushLit(state, 256);
-	Deflate_FlushBits(state);
-
 	/* In case last byte still has a few extra bits */
 	if (state->NumBits) {
 		while (state->NumBits < 8) { Deflate_PushBits(state, 0, 1); }
@@ -1007,26 +1478,6 @@ static cc_result Deflate_StreamClose(struct Stream* stream) {
 	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
 }
 
-/* Constructs a huffman encoding table (for values to codewords) */
-static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
-	int i, j, offset, codeword;
-	struct HuffmanTable table;
-
-	/* NOTE: Can ignore since lens table is not user controlled */
-	(void)Huffman_Build(&table, lens, count);
-	for (i = 0; i < INFLATE_MAX_BITS; i++) {
-		if (!table.endCodewords[i]) continue;
-		count = table.endCodewords[i] - table.firstCodewords[i];
-
-		for (j = 0; j < count; j++) {
-			offset   = table.values[table.firstOffsets[i] + j];
-			codeword = table.firstCodewords[i] + j;
-			bitlens[offset]   = i;
-			codewords[offset] = Huffman_ReverseBits(codeword, i);
-		}
-	}
-}
-
 void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
 	Stream_Init(stream);
 	stream->meta.inflate = state;
@@ -1041,11 +1492,14 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 	state->NextOut  = state->Output;
 	state->AvailOut = DEFLATE_OUT_SIZE;
 	state->Dest     = underlying;
-	state->WroteHeader = false;
+	state->Level    = DEFLATE_LEVEL_BEST;
+	state->NumSymbols = 0;
 
 	Mem_Set(state->Head, 0, sizeof(state->Head));
 	Mem_Set(state->Prev, 0, sizeof(state->Prev));
-	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
+	Mem_Set(state->LitsFreqs,  0, sizeof(state->LitsFreqs));
+	Mem_Set(state->DistsFreqs, 0, sizeof(state->DistsFreqs));
+	Deflate_InitCodes();
 }
 
 
@@ -1097,9 +1551,321 @@ void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stre
 
 
 /*########################################################################################################################*
-*-----------------------------------------------------ZLib (compress)-----------------------------------------------------*
+*-------------------------------------------------GZip (parallel compress)------------------------------------------------*
 *#########################################################################################################################*/
-static cc_result ZLib_StreamClose(struct Stream* stream) {
+#ifdef CC_BUILD_SAVEWORKERS
+#define GZIP_MAX_WORKERS 4
+/* Allow more chunks than workers, so workers don't have to wait for output to be written */
+#define GZIP_MAX_CHUNKS (GZIP_MAX_WORKERS * 2)
+#define GZIP_CHUNK_SIZE (DEFLATE_BLOCK_SIZE * 16)
+/* Worst case size of a compressed chunk (every byte being a 9 bit fixed huffman literal) */
+#define GZIP_CHUNK_OUT_SIZE (GZIP_CHUNK_SIZE + GZIP_CHUNK_SIZE / 8 + 1024)
+enum GZIP_CHUNK_STATE { GZIP_CHUNK_FREE, GZIP_CHUNK_QUEUED, GZIP_CHUNK_BUSY, GZIP_CHUNK_DONE };
+
+struct GZipChunk {
+	cc_uint8* input;  /* Dictionary (end of previous chunk), followed by data of this chunk */
+	cc_uint8* output; /* Compressed data of this chunk */
+	cc_uint32 dictLen, inputLen, outputLen;
+	int state;
+	cc_result result;
+};
+static struct GZipChunk gzip_chunks[GZIP_MAX_CHUNKS];
+static struct DeflateState* gzip_states[GZIP_MAX_WORKERS];
+static void* gzip_threads[GZIP_MAX_WORKERS];
+static void* gzip_wakeups[GZIP_MAX_WORKERS];
+static void* gzip_mutex;
+static void* gzip_chunkDone;
+static int gzip_workersStarted, gzip_queueHead, gzip_cur;
+static cc_bool gzip_quit, gzip_active;
+static cc_uint32 gzip_crc32, gzip_size;
+
+/* Makes the data preceding the current block usable as history for matches */
+static void Deflate_SetDictionary(struct DeflateState* state, const cc_uint8* data, cc_uint32 len) {
+	int i, beg;
+	len = min(len, DEFLATE_BLOCK_SIZE);
+	beg = DEFLATE_BLOCK_SIZE - len;
+	Mem_Copy(&state->Input[beg], data, len);
+
+	/* Position 0 is used to indicate end of hash chain */
+	for (i = max(beg, 1); i < DEFLATE_BLOCK_SIZE - (MIN_MATCH_LEN - 1); i++) {
+		Deflate_Insert(state, i);
+	}
+}
+
+/* Compresses any buffered data, then pads output to a byte boundary using an empty stored block */
+/* NOTE: Unlike Close, this doesn't mark the end of the DEFLATE data */
+static cc_result Deflate_SyncFlush(struct DeflateState* state) {
+	cc_result res;
+	if (state->InputPosition > DEFLATE_BLOCK_SIZE) {
+		res = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE, false);
+		if (res) return res;
+	}
+
+	Deflate_PushBits(state, 0, 3); /* final block FALSE, block type STORED */
+	if (state->NumBits & 7) { Deflate_PushBits(state, 0, 8 - (state->NumBits & 7)); }
+	Deflate_FlushBits(state);
+
+	/* Length of 0, followed by one's complement of length */
+	Deflate_PushBits(state, 0x0000, 16);
+	Deflate_FlushBits(state);
+	Deflate_PushBits(state, 0xFFFF, 16);
+	Deflate_FlushBits(state);
+	return Deflate_FlushOutput(state);
+}
+
+static cc_result GZipChunk_WriteOutput(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	if (count > s->meta.mem.left) return ERR_END_OF_STREAM;
+	Mem_Copy(s->meta.mem.cur, data, count);
+
+	s->meta.mem.cur  += count;
+	s->meta.mem.left -= count;
+	*modified = count;
+	return 0;
+}
+
+static void GZipChunk_Compress(struct GZipChunk* chunk, struct DeflateState* state) {
+	struct Stream output, comp;
+	cc_result res;
+
+	Stream_Init(&output);
+	output.Write = GZipChunk_WriteOutput;
+	output.meta.mem.cur  = chunk->output;
+	output.meta.mem.left = GZIP_CHUNK_OUT_SIZE;
+
+	Deflate_MakeStream(&comp, state, &output);
+	Deflate_SetDictionary(state, chunk->input, chunk->dictLen);
+
+	res = Stream_Write(&comp, chunk->input + chunk->dictLen, chunk->inputLen);
+	if (!res) res = Deflate_SyncFlush(state);
+
+	chunk->result    = res;
+	chunk->outputLen = GZIP_CHUNK_OUT_SIZE - output.meta.mem.left;
+}
+
+static void GZipWorker_Run(void) {
+	struct GZipChunk* chunk;
+	struct DeflateState* state;
+	void* wakeup;
+	int worker;
+
+	Mutex_Lock(gzip_mutex);
+	worker = gzip_workersStarted++;
+	Mutex_Unlock(gzip_mutex);
+	state  = gzip_states[worker];
+	wakeup = gzip_wakeups[worker];
+
+	for (;;) {
+		Mutex_Lock(gzip_mutex);
+		chunk = &gzip_chunks[gzip_queueHead];
+
+		/* Chunks are queued in order, so the next queued chunk is always at the head */
+		if (chunk->state == GZIP_CHUNK_QUEUED) {
+			chunk->state   = GZIP_CHUNK_BUSY;
+			gzip_queueHead = (gzip_queueHead + 1) % GZIP_MAX_CHUNKS;
+			Mutex_Unlock(gzip_mutex);
+
+			GZipChunk_Compress(chunk, state);
+
+			Mutex_Lock(gzip_mutex);
+			chunk->state = GZIP_CHUNK_DONE;
+			Waitable_Signal(gzip_chunkDone);
+			Mutex_Unlock(gzip_mutex);
+			continue;
+		}
+
+		Mutex_Unlock(gzip_mutex);
+		if (gzip_quit) return;
+		Waitable_Wait(wakeup);
+	}
+}
+
+/* Waits for the given chunk to be compressed, then writes its compressed data */
+static cc_result GZipParallel_WriteChunk(struct GZipChunk* chunk, struct Stream* dst) {
+	int state;
+
+	for (;;) {
+		Mutex_Lock(gzip_mutex);
+		state = chunk->state;
+		Mutex_Unlock(gzip_mutex);
+
+		if (state == GZIP_CHUNK_DONE) break;
+		Waitable_Wait(gzip_chunkDone);
+	}
+
+	chunk->state = GZIP_CHUNK_FREE;
+	if (chunk->result) return chunk->result;
+	return Stream_Write(dst, chunk->output, chunk->outputLen);
+}
+
+/* Queues the chunk currently being filled, then moves onto the next chunk */
+static cc_result GZipParallel_QueueChunk(struct Stream* dst) {
+	struct GZipChunk* chunk = &gzip_chunks[gzip_cur];
+	struct GZipChunk* next;
+	cc_result res = 0;
+	cc_uint32 dictLen;
+	int i;
+
+	Mutex_Lock(gzip_mutex);
+	chunk->state = GZIP_CHUNK_QUEUED;
+	Mutex_Unlock(gzip_mutex);
+	for (i = 0; i < GZIP_MAX_WORKERS; i++) { Waitable_Signal(gzip_wakeups[i]); }
+
+	gzip_cur = (gzip_cur + 1) % GZIP_MAX_CHUNKS;
+	next     = &gzip_chunks[gzip_cur];
+	/* All chunks in use, so have to wait for the oldest to finish */
+	if (next->state != GZIP_CHUNK_FREE) res = GZipParallel_WriteChunk(next, dst);
+
+	/* NOTE: Previous chunk's data is only read by its worker, so this is safe */
+	dictLen = min(chunk->inputLen, DEFLATE_BLOCK_SIZE);
+	Mem_Copy(next->input, chunk->input + chunk->dictLen + chunk->inputLen - dictLen, dictLen);
+	next->dictLen  = dictLen;
+	next->inputLen = 0;
+	return res;
+}
+
+static cc_result GZipParallel_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	struct GZipChunk* chunk;
+	cc_uint32 i, len, crc32 = gzip_crc32;
+	cc_result res;
+
+	for (i = 0; i < count; i++) {
+		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
+	}
+	gzip_crc32 = crc32;
+	gzip_size += count;
+	*modified  = 0;
+
+	while (count) {
+		chunk = &gzip_chunks[gzip_cur];
+		len   = min(count, GZIP_CHUNK_SIZE - chunk->inputLen);
+
+		Mem_Copy(chunk->input + chunk->dictLen + chunk->inputLen, data, len);
+		chunk->inputLen += len;
+		*modified += len;
+		data += len; count -= len;
+
+		if (chunk->inputLen < GZIP_CHUNK_SIZE) break;
+		if ((res = GZipParallel_QueueChunk((struct Stream*)stream->meta.inflate))) return res;
+	}
+	return 0;
+}
+
+static void GZipParallel_Free(void) {
+	int i;
+	gzip_quit = true;
+	
+	for (i = 0; i < GZIP_MAX_WORKERS; i++) {
+		if (gzip_wakeups[i]) Waitable_Signal(gzip_wakeups[i]);
+	}
+	for (i = 0; i < GZIP_MAX_WORKERS; i++) {
+		if (gzip_threads[i]) Thread_Join(gzip_threads[i]);
+		if (gzip_wakeups[i]) Waitable_Free(gzip_wakeups[i]);
+		Mem_Free(gzip_states[i]);
+
+		gzip_threads[i] = NULL;
+		gzip_wakeups[i] = NULL;
+		gzip_states[i]  = NULL;
+	}
+	for (i = 0; i < GZIP_MAX_CHUNKS; i++) {
+		Mem_Free(gzip_chunks[i].input);
+		Mem_Free(gzip_chunks[i].output);
+		gzip_chunks[i].input  = NULL;
+		gzip_chunks[i].output = NULL;
+	}
+
+	if (gzip_mutex)     Mutex_Free(gzip_mutex);
+	if (gzip_chunkDone) Waitable_Free(gzip_chunkDone);
+	gzip_mutex     = NULL;
+	gzip_chunkDone = NULL;
+	gzip_active    = false;
+}
+
+static cc_result GZipParallel_StreamClose(struct Stream* stream) {
+	static const cc_uint8 finalBlock[2] = { 0x03, 0x00 }; /* final block TRUE, block type FIXED, then 'end of block' */
+	struct Stream* dst = (struct Stream*)stream->meta.inflate;
+	cc_uint8 data[8];
+	cc_result res = 0, chunkRes;
+	int i;
+
+	if (gzip_chunks[gzip_cur].inputLen) res = GZipParallel_QueueChunk(dst);
+
+	/* Remaining chunks have to be written in the order they were queued */
+	for (i = 1; i <= GZIP_MAX_CHUNKS; i++) {
+		struct GZipChunk* chunk = &gzip_chunks[(gzip_cur + i) % GZIP_MAX_CHUNKS];
+		if (chunk->state == GZIP_CHUNK_FREE) continue;
+
+		chunkRes = GZipParallel_WriteChunk(chunk, dst);
+		if (!res) res = chunkRes;
+	}
+	GZipParallel_Free();
+	if (res) return res;
+
+	if ((res = Stream_Write(dst, finalBlock, sizeof(finalBlock)))) return res;
+	Stream_SetU32_LE(&data[0], gzip_crc32 ^ 0xFFFFFFFFUL);
+	Stream_SetU32_LE(&data[4], gzip_size);
+	return Stream_Write(dst, data, sizeof(data));
+}
+
+cc_result GZipParallel_MakeStream(struct Stream* stream, struct Stream* underlying) {
+	static const cc_uint8 header[10] = { 0x1F, 0x8B, 0x08 }; /* GZip header */
+	cc_result res;
+	int i;
+	if (gzip_active) return ERR_NOT_SUPPORTED;
+
+	for (i = 0; i < GZIP_MAX_CHUNKS; i++) {
+		gzip_chunks[i].input  = (cc_uint8*)Mem_TryAlloc(DEFLATE_BLOCK_SIZE + GZIP_CHUNK_SIZE, 1);
+		gzip_chunks[i].output = (cc_uint8*)Mem_TryAlloc(GZIP_CHUNK_OUT_SIZE, 1);
+		if (!gzip_chunks[i].input || !gzip_chunks[i].output) goto oom;
+
+		gzip_chunks[i].state    = GZIP_CHUNK_FREE;
+		gzip_chunks[i].dictLen  = 0;
+		gzip_chunks[i].inputLen = 0;
+	}
+	for (i = 0; i < GZIP_MAX_WORKERS; i++) {
+		gzip_states[i] = (struct DeflateState*)Mem_TryAlloc(1, sizeof(struct DeflateState));
+		if (!gzip_states[i]) goto oom;
+	}
+
+	if ((res = Stream_Write(underlying, header, sizeof(header)))) {
+		GZipParallel_Free(); return res;
+	}
+	gzip_active = true;
+	gzip_quit   = false;
+	gzip_crc32  = 0xFFFFFFFFUL;
+	gzip_size   = 0;
+	gzip_cur    = 0;
+	gzip_queueHead      = 0;
+	gzip_workersStarted = 0;
+
+	/* Deflate_MakeStream in the worker threads would otherwise race to initialise these */
+	Deflate_InitCodes();
+	gzip_mutex     = Mutex_Create("GZip workers");
+	gzip_chunkDone = Waitable_Create("GZip chunk done");
+
+	for (i = 0; i < GZIP_MAX_WORKERS; i++) {
+		gzip_wakeups[i] = Waitable_Create("GZip worker wakeup");
+	}
+	for (i = 0; i < GZIP_MAX_WORKERS; i++) {
+		Thread_Run(&gzip_threads[i], GZipWorker_Run, 64 * 1024, "GZip worker");
+	}
+
+	Stream_Init(stream);
+	stream->meta.inflate = underlying;
+	stream->Write = GZipParallel_StreamWrite;
+	stream->Close = GZipParallel_StreamClose;
+	return 0;
+
+oom:
+	GZipParallel_Free();
+	return ERR_OUT_OF_MEMORY;
+}
+#endif
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------ZLib (compress)-----------------------------------------------------*
+*#########################################################################################################################*/
+static cc_result ZLib_StreamClose(struct Stream* stream) {
 	struct ZLibState* state = (struct ZLibState*)stream->meta.inflate;
 	cc_uint8 data[4];
 	cc_result res;
@@ -1159,10 +1925,6 @@ struct ZipState {
 
 	/* Number of entries selected by SelectEntry */
 	int usedEntries;
-	/* Total number of entries in the archive */
-	int totalEntries;
-	/* Offset to central directory entries */
-	cc_uint32 centralDirBeg;
 };
 
 static cc_result Zip_ReadLocalFileHeader(struct ZipState* state, struct ZipEntry* entry) {
@@ -1225,59 +1987,167 @@ static cc_result Zip_ReadLocalFileHeader(struct ZipState* state, struct ZipEntry
 	return res;
 }
 
-static cc_result Zip_ReadCentralDirectory(struct ZipState* state) {
-	struct Stream* stream = state->source;
-	struct ZipEntry* entry;
-	cc_uint8 header[42];
+enum ZipSig {
+	ZIP_SIG_ENDOFCENTRALDIR = 0x06054b50,
+	ZIP_SIG_CENTRALDIR      = 0x02014b50,
+	ZIP_SIG_LOCALFILEHEADER = 0x04034b50
+};
 
-	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
-	int pathLen, extraLen, commentLen;
-	cc_result res;
+/* Size of end of central directory record (excluding signature) */
+#define ZIP_EOCD_SIZE 18
+/* Size of central directory entry header (including signature) */
+#define ZIP_CDIR_SIZE 46
+#define ZIPINDEX_BUCKETS 256
+/* Maximum number of archive indexes kept around after last being used */
+#define ZIPINDEX_MAX_CACHED 4
+/* Central directories larger than this aren't cached (e.g. .jar files with thousands of classes) */
+#define ZIPINDEX_MAX_CACHED_SIZE (64 * 1024)
+
+struct ZipIndexEntry {
+	struct ZipEntry info;
+	cc_uint16 method, nameLen;
+	cc_uint32 nameOffset;
+	/* Index of next entry in the same hash bucket, -1 if none */
+	int next;
+};
 
-	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
-	pathLen = Stream_GetU16_LE(&header[24]);
-	if (pathLen > ZIP_MAXNAMELEN) return ZIP_ERR_FILENAME_LEN;
+/* Parsed central directory of a .zip archive */
+struct ZipIndex {
+	/* Used to identify which archive this index was parsed from */
+	cc_uint32 length; cc_uint8 eocd[ZIP_EOCD_SIZE];
+	int refCount, count;
+	int buckets[ZIPINDEX_BUCKETS];
+	struct ZipIndexEntry* entries;
+	/* Raw central directory data, which entry names point into */
+	char* names;
+};
+static struct ZipIndex* zip_cache[ZIPINDEX_MAX_CACHED];
 
-	/* NOTE: ZIP spec says path uses code page 437 for encoding */
-	path = String_Init(pathBuffer, pathLen, pathLen);
-	if ((res = Stream_Read(stream, (cc_uint8*)pathBuffer, pathLen))) return res;
+/* Case insensitive FNV-1a hash of a .zip entry path */
+static cc_uint32 ZipIndex_Hash(const char* path, int len) {
+	cc_uint32 hash = 2166136261UL;
+	char c;
+	int i;
 
-	/* skip data following central directory entry header */
-	extraLen   = Stream_GetU16_LE(&header[26]);
-	commentLen = Stream_GetU16_LE(&header[28]);
-	if ((res = stream->Skip(stream, extraLen + commentLen))) return res;
+	for (i = 0; i < len; i++) {
+		c = path[i];
+		Char_MakeLower(c);
+		hash = (hash ^ (cc_uint8)c) * 16777619UL;
+	}
+	return hash;
+}
 
-	if (!state->SelectEntry(&path)) return 0;
-	if (state->usedEntries >= state->maxEntries) return ZIP_ERR_TOO_MANY_ENTRIES;
-	entry = &state->entries[state->usedEntries++];
+static void ZipIndex_Release(struct ZipIndex* index) {
+	if (--index->refCount) return;
+	Mem_Free(index);
+}
 
-	entry->CompressedSize    = Stream_GetU32_LE(&header[16]);
-	entry->UncompressedSize  = Stream_GetU32_LE(&header[20]);
-	entry->LocalHeaderOffset = Stream_GetU32_LE(&header[38]);
-	return 0;
+/* Returns a previously parsed index that matches the given archive, or NULL if none */
+static struct ZipIndex* ZipIndex_Find(cc_uint32 length, const cc_uint8* eocd) {
+	struct ZipIndex* index;
+	int i, j;
+
+	for (i = 0; i < ZIPINDEX_MAX_CACHED; i++) 
+	{
+		index = zip_cache[i];
+		if (!index || index->length != length) continue;
+		if (Mem_Equal(index->eocd, eocd, ZIP_EOCD_SIZE)) break;
+	}
+	if (i == ZIPINDEX_MAX_CACHED) return NULL;
+
+	/* Move to front, so most recently used indexes are evicted last */
+	for (j = i; j > 0; j--) { zip_cache[j] = zip_cache[j - 1]; }
+	zip_cache[0] = index;
+	return index;
 }
 
-static cc_result Zip_ReadEndOfCentralDirectory(struct ZipState* state) {
-	struct Stream* stream = state->source;
-	cc_uint8 header[18];
+static void ZipIndex_Cache(struct ZipIndex* index) {
+	int i;
+	if (Stream_GetU32_LE(&index->eocd[8]) > ZIPINDEX_MAX_CACHED_SIZE) return;
 
-	cc_result res;
-	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
+	if (zip_cache[ZIPINDEX_MAX_CACHED - 1]) 
+		ZipIndex_Release(zip_cache[ZIPINDEX_MAX_CACHED - 1]);
+	for (i = ZIPINDEX_MAX_CACHED - 1; i > 0; i--) { zip_cache[i] = zip_cache[i - 1]; }
+
+	zip_cache[0] = index;
+	index->refCount++;
+}
 
-	state->totalEntries  = Stream_GetU16_LE(&header[6]);
-	state->centralDirBeg = Stream_GetU32_LE(&header[12]);
+static cc_result ZipIndex_Parse(struct ZipIndex* index, cc_uint32 dirLen) {
+	cc_uint8* dir = (cc_uint8*)index->names;
+	struct ZipIndexEntry* entry;
+	cc_uint32 offset = 0, entryLen, hash;
+	int i, pathLen;
+
+	for (i = 0; i < ZIPINDEX_BUCKETS; i++) { index->buckets[i] = -1; }
+
+	for (i = 0; i < index->count; i++) {
+		if (dirLen - offset < ZIP_CDIR_SIZE) return ZIP_ERR_INVALID_CENTRAL_DIR;
+		if (Stream_GetU32_LE(dir) != ZIP_SIG_CENTRALDIR) return ZIP_ERR_INVALID_CENTRAL_DIR;
+
+		pathLen  = Stream_GetU16_LE(&dir[28]);
+		/* skip data following central directory entry header */
+		entryLen = ZIP_CDIR_SIZE + pathLen + Stream_GetU16_LE(&dir[30]) + Stream_GetU16_LE(&dir[32]);
+		if (dirLen - offset < entryLen) return ZIP_ERR_INVALID_CENTRAL_DIR;
+
+		entry = &index->entries[i];
+		entry->info.CompressedSize    = Stream_GetU32_LE(&dir[20]);
+		entry->info.UncompressedSize  = Stream_GetU32_LE(&dir[24]);
+		entry->info.LocalHeaderOffset = Stream_GetU32_LE(&dir[42]);
+		entry->method     = Stream_GetU16_LE(&dir[10]);
+		entry->nameLen    = pathLen;
+		entry->nameOffset = offset + ZIP_CDIR_SIZE;
+
+		/* NOTE: ZIP spec says path uses code page 437 for encoding */
+		hash = ZipIndex_Hash(index->names + entry->nameOffset, pathLen) % ZIPINDEX_BUCKETS;
+		entry->next = index->buckets[hash];
+		index->buckets[hash] = i;
+
+		dir    += entryLen;
+		offset += entryLen;
+	}
 	return 0;
 }
 
-enum ZipSig {
-	ZIP_SIG_ENDOFCENTRALDIR = 0x06054b50,
-	ZIP_SIG_CENTRALDIR      = 0x02014b50,
-	ZIP_SIG_LOCALFILEHEADER = 0x04034b50
-};
+static cc_result ZipIndex_Read(struct Stream* source, cc_uint32 length, const cc_uint8* eocd, struct ZipIndex** result) {
+	struct ZipIndex* index;
+	cc_uint32 dirLen, dirBeg;
+	int count;
+	cc_result res;
 
-cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor, 
-						struct ZipEntry* entries, int maxEntries) {
-	struct ZipState state;
+	count  = Stream_GetU16_LE(&eocd[6]);
+	dirLen = Stream_GetU32_LE(&eocd[8]);
+	dirBeg = Stream_GetU32_LE(&eocd[12]);
+	if (dirBeg > length || dirLen > length - dirBeg) return ZIP_ERR_INVALID_CENTRAL_DIR;
+
+	res = source->Seek(source, dirBeg);
+	if (res) return ZIP_ERR_SEEK_CENTRAL_DIR;
+
+	/* Entries and raw central directory data are stored directly after the index */
+	index = (struct ZipIndex*)Mem_TryAlloc(1, sizeof(struct ZipIndex) 
+							+ count * sizeof(struct ZipIndexEntry) + dirLen);
+	if (!index) return ERR_OUT_OF_MEMORY;
+
+	index->length   = length;
+	index->refCount = 1;
+	index->count    = count;
+	index->entries  = (struct ZipIndexEntry*)(index + 1);
+	index->names    = (char*)(index->entries + count);
+	Mem_Copy(index->eocd, eocd, ZIP_EOCD_SIZE);
+
+	/* Read all the central directory entries at once */
+	res = Stream_Read(source, (cc_uint8*)index->names, dirLen);
+	if (!res) res = ZipIndex_Parse(index, dirLen);
+
+	if (res) { Mem_Free(index); return res; }
+	*result = index;
+	return 0;
+}
+
+/* Finds the end of central directory record, then returns the index for the archive */
+/* NOTE: The index is reused from a previous call if the archive appears to be unchanged */
+static cc_result ZipIndex_Get(struct Stream* source, struct ZipIndex** index) {
+	cc_uint8 eocd[ZIP_EOCD_SIZE];
 	cc_uint32 stream_len;
 	cc_uint32 sig = 0;
 	int i, count;
@@ -1295,34 +2165,55 @@ cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_Proce
 		if (sig == ZIP_SIG_ENDOFCENTRALDIR) break;
 	}
 
-	state.source       = source;
-	state.SelectEntry  = selector;
-	state.ProcessEntry = processor;
-	state.entries      = entries;
-	state.maxEntries   = maxEntries;
-
 	if (sig != ZIP_SIG_ENDOFCENTRALDIR) return ZIP_ERR_NO_END_OF_CENTRAL_DIR;
-	res = Zip_ReadEndOfCentralDirectory(&state);
-	if (res) return res;
+	if ((res = Stream_Read(source, eocd, ZIP_EOCD_SIZE))) return res;
 
-	res = source->Seek(source, state.centralDirBeg);
-	if (res) return ZIP_ERR_SEEK_CENTRAL_DIR;
-	state.usedEntries = 0;
+	*index = ZipIndex_Find(stream_len, eocd);
+	if (*index) { (*index)->refCount++; return 0; }
 
-	/* Read all the central directory entries */
-	for (i = 0; i < state.totalEntries; i++) {
-		if ((res = Stream_ReadU32_LE(source, &sig))) return res;
+	res = ZipIndex_Read(source, stream_len, eocd, index);
+	if (!res) ZipIndex_Cache(*index);
+	return res;
+}
 
-		if (sig == ZIP_SIG_CENTRALDIR) {
-			res = Zip_ReadCentralDirectory(&state);
-			if (res) return res;
-		} else if (sig == ZIP_SIG_ENDOFCENTRALDIR) {
-			break;
-		} else {
-			return ZIP_ERR_INVALID_CENTRAL_DIR;
-		}
+/* Finds and then reads all the central directory entries selected by SelectEntry */
+static cc_result Zip_ReadDirectory(struct ZipState* state) {
+	struct ZipIndex* index;
+	struct ZipIndexEntry* e;
+	cc_string path;
+	cc_result res;
+	int i;
+
+	if ((res = ZipIndex_Get(state->source, &index))) return res;
+	state->usedEntries = 0;
+
+	for (i = 0; i < index->count; i++) {
+		e    = &index->entries[i];
+		path = String_Init(index->names + e->nameOffset, e->nameLen, e->nameLen);
+		if (!state->SelectEntry(&path)) continue;
+
+		if (state->usedEntries >= state->maxEntries) { res = ZIP_ERR_TOO_MANY_ENTRIES; break; }
+		state->entries[state->usedEntries++] = e->info;
 	}
 
+	ZipIndex_Release(index);
+	return res;
+}
+
+cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor, 
+						struct ZipEntry* entries, int maxEntries) {
+	struct ZipState state;
+	cc_uint32 sig = 0;
+	cc_result res;
+	int i;
+
+	state.source       = source;
+	state.SelectEntry  = selector;
+	state.ProcessEntry = processor;
+	state.entries      = entries;
+	state.maxEntries   = maxEntries;
+	if ((res = Zip_ReadDirectory(&state))) return res;
+
 	/* Now read the local file header entries */
 	for (i = 0; i < state.usedEntries; i++) {
 		struct ZipEntry* entry = &state.entries[i];
@@ -1337,3 +2228,366 @@ cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_Proce
 	}
 	return 0;
 }
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------ZipArchive--------------------------------------------------------*
+*#########################################################################################################################*/
+cc_result ZipArchive_Open(struct ZipArchive* archive, struct Stream* source) {
+	archive->source = source;
+	archive->index  = NULL;
+	return ZipIndex_Get(source, &archive->index);
+}
+
+void ZipArchive_Close(struct ZipArchive* archive) {
+	if (archive->index) ZipIndex_Release(archive->index);
+	archive->index = NULL;
+}
+
+int ZipArchive_Count(struct ZipArchive* archive) { return archive->index->count; }
+
+cc_string ZipArchive_GetPath(struct ZipArchive* archive, int i) {
+	struct ZipIndexEntry* e = &archive->index->entries[i];
+	return String_Init(archive->index->names + e->nameOffset, e->nameLen, e->nameLen);
+}
+
+const struct ZipEntry* ZipArchive_GetEntry(struct ZipArchive* archive, int i) {
+	return &archive->index->entries[i].info;
+}
+
+int ZipArchive_Find(struct ZipArchive* archive, const cc_string* path) {
+	struct ZipIndex* index = archive->index;
+	cc_uint32 hash = ZipIndex_Hash(path->buffer, path->length) % ZIPINDEX_BUCKETS;
+	cc_string name;
+	int i;
+
+	for (i = index->buckets[hash]; i >= 0; i = index->entries[i].next) 
+	{
+		name = ZipArchive_GetPath(archive, i);
+		if (String_CaselessEquals(&name, path)) return i;
+	}
+	return -1;
+}
+
+/* Stores everything needed to read a compressed entry on demand */
+struct ZipEntryStream { struct InflateState inflate; struct Stream portion; };
+
+static cc_result ZipEntryStream_Close(struct Stream* stream) {
+	Mem_Free(stream->meta.inflate);
+	return 0;
+}
+
+cc_result ZipArchive_OpenEntry(struct ZipArchive* archive, int i, struct Stream* stream) {
+	struct ZipIndexEntry* e = &archive->index->entries[i];
+	struct Stream* source   = archive->source;
+	struct ZipEntryStream* entry;
+	cc_uint8 header[26];
+	cc_uint32 sig = 0;
+	cc_result res;
+
+	res = source->Seek(source, e->info.LocalHeaderOffset);
+	if (res) return ZIP_ERR_SEEK_LOCAL_DIR;
+
+	if ((res = Stream_ReadU32_LE(source, &sig))) return res;
+	if (sig != ZIP_SIG_LOCALFILEHEADER) return ZIP_ERR_INVALID_LOCAL_DIR;
+	if ((res = Stream_Read(source, header, sizeof(header)))) return res;
+
+	/* local file may have extra data before actual data (e.g. ZIP64) */
+	res = source->Skip(source, Stream_GetU16_LE(&header[22]) + Stream_GetU16_LE(&header[24]));
+	if (res) return res;
+
+	if (e->method == 0) {
+		Stream_ReadonlyPortion(stream, source, e->info.UncompressedSize);
+		return 0;
+	} else if (e->method != 8) {
+		return ERR_NOT_SUPPORTED;
+	}
+
+	entry = (struct ZipEntryStream*)Mem_TryAlloc(1, sizeof(struct ZipEntryStream));
+	if (!entry) return ERR_OUT_OF_MEMORY;
+
+	Stream_ReadonlyPortion(&entry->portion, source, e->info.CompressedSize);
+	Inflate_MakeStream2(stream, &entry->inflate, &entry->portion);
+	stream->Close = ZipEntryStream_Close;
+	return 0;
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------ZipReader (parallel)--------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_ZIPWORKERS
+#define ZIP_MAX_WORKERS 4
+#define ZIP_MAX_JOBS    16
+enum ZIP_JOB_STATE { ZIP_JOB_FREE, ZIP_JOB_QUEUED, ZIP_JOB_BUSY, ZIP_JOB_DONE };
+
+struct ZipJob {
+	cc_uint8* data; /* Compressed data of the entry, then decompressed data once done */
+	cc_uint32 dataLen, uncompressedSize;
+	int method, state;
+	void* decoded;
+	cc_result result;
+	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
+};
+static struct ZipJob zip_jobs[ZIP_MAX_JOBS];
+static struct InflateState* zip_states[ZIP_MAX_WORKERS];
+static void* zip_threads[ZIP_MAX_WORKERS];
+static void* zip_wakeups[ZIP_MAX_WORKERS];
+static void* zip_mutex;
+static void* zip_jobDone;
+static int zip_workersStarted, zip_queueHead;
+static cc_bool zip_quit, zip_active;
+static Zip_DecodeEntry zip_decoder;
+
+static void ZipJob_Run(struct ZipJob* job, struct InflateState* inflate) {
+	struct Stream src, comp, data;
+	cc_uint8* output;
+
+	if (job->method == 8) {
+		output = (cc_uint8*)Mem_TryAlloc(max(job->uncompressedSize, 1), 1);
+		if (!output) { job->result = ERR_OUT_OF_MEMORY; return; }
+
+		Stream_ReadonlyMemory(&src, job->data, job->dataLen);
+		Inflate_MakeStream2(&comp, inflate, &src);
+		Inflate_SetOutputBuffer(inflate, output, job->uncompressedSize);
+		job->result = Stream_Read(&comp, output, job->uncompressedSize);
+
+		Mem_Free(job->data);
+		job->data    = output;
+		job->dataLen = job->uncompressedSize;
+		if (job->result) return;
+	}
+
+	Stream_ReadonlyMemory(&data, job->data, job->dataLen);
+	job->decoded = zip_decoder(&job->path, &data);
+}
+
+static void ZipWorker_Run(void) {
+	struct InflateState* inflate;
+	struct ZipJob* job;
+	void* wakeup;
+	int worker;
+
+	Mutex_Lock(zip_mutex);
+	worker = zip_workersStarted++;
+	Mutex_Unlock(zip_mutex);
+	inflate = zip_states[worker];
+	wakeup  = zip_wakeups[worker];
+
+	for (;;) {
+		Mutex_Lock(zip_mutex);
+		job = &zip_jobs[zip_queueHead];
+
+		/* Jobs are queued in order, so the next queued job is always at the head */
+		if (job->state == ZIP_JOB_QUEUED) {
+			job->state    = ZIP_JOB_BUSY;
+			zip_queueHead = (zip_queueHead + 1) % ZIP_MAX_JOBS;
+			Mutex_Unlock(zip_mutex);
+
+			ZipJob_Run(job, inflate);
+
+			Mutex_Lock(zip_mutex);
+			job->state = ZIP_JOB_DONE;
+			Waitable_Signal(zip_jobDone);
+			Mutex_Unlock(zip_mutex);
+			continue;
+		}
+
+		Mutex_Unlock(zip_mutex);
+		if (zip_quit) return;
+		Waitable_Wait(wakeup);
+	}
+}
+
+/* Waits for the given job to finish, then processes its result if processor is non-NULL */
+static cc_result ZipParallel_FinishJob(struct ZipJob* job, Zip_ProcessDecoded processor, Zip_FreeDecoded freeDecoded) {
+	struct Stream data;
+	cc_result res;
+	int state;
+
+	for (;;) {
+		Mutex_Lock(zip_mutex);
+		state = job->state;
+		Mutex_Unlock(zip_mutex);
+
+		if (state == ZIP_JOB_DONE) break;
+		Waitable_Wait(zip_jobDone);
+	}
+
+	res = job->result;
+	if (!res && processor) {
+		Stream_ReadonlyMemory(&data, job->data, job->dataLen);
+		res = processor(&job->path, &data, job->decoded);
+	} else if (job->decoded) {
+		freeDecoded(job->decoded);
+	}
+
+	Mem_Free(job->data);
+	job->data    = NULL;
+	job->decoded = NULL;
+	job->state   = ZIP_JOB_FREE;
+	return res;
+}
+
+/* Reads the local file header and compressed data of the given entry */
+/* NOTE: Job is left unqueued if the entry is skipped */
+static cc_result ZipParallel_ReadEntry(struct ZipState* state, struct ZipEntry* entry, struct ZipJob* job) {
+	struct Stream* stream = state->source;
+	cc_uint8 header[26];
+	cc_string path;
+	cc_uint32 compressedSize, uncompressedSize, sig;
+	int method, pathLen, extraLen;
+	cc_result res;
+
+	res = stream->Seek(stream, entry->LocalHeaderOffset);
+	if (res) return ZIP_ERR_SEEK_LOCAL_DIR;
+
+	if ((res = Stream_ReadU32_LE(stream, &sig))) return res;
+	if (sig != ZIP_SIG_LOCALFILEHEADER) return ZIP_ERR_INVALID_LOCAL_DIR;
+
+	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
+	pathLen  = Stream_GetU16_LE(&header[22]);
+	if (pathLen > ZIP_MAXNAMELEN) return ZIP_ERR_FILENAME_LEN;
+
+	/* NOTE: ZIP spec says path uses code page 437 for encoding */
+	path = String_Init(job->pathBuffer, pathLen, pathLen);
+	if ((res = Stream_Read(stream, (cc_uint8*)job->pathBuffer, pathLen))) return res;
+	if (!state->SelectEntry(&path)) return 0;
+
+	extraLen = Stream_GetU16_LE(&header[24]);
+	/* local file may have extra data before actual data (e.g. ZIP64) */
+	if ((res = stream->Skip(stream, extraLen))) return res;
+
+	method           = Stream_GetU16_LE(&header[4]);
+	compressedSize   = Stream_GetU32_LE(&header[14]);
+	uncompressedSize = Stream_GetU32_LE(&header[18]);
+
+	/* Some .zip files don't set these in local file header */
+	if (!compressedSize)   compressedSize   = entry->CompressedSize;
+	if (!uncompressedSize) uncompressedSize = entry->UncompressedSize;
+
+	if (method == 0) {
+		compressedSize = uncompressedSize;
+	} else if (method != 8) {
+		Platform_Log1("Unsupported.zip entry compression method: %i", &method);
+		return 0;
+	}
+
+	job->data = (cc_uint8*)Mem_TryAlloc(max(compressedSize, 1), 1);
+	if (!job->data) return ERR_OUT_OF_MEMORY;
+
+	if ((res = Stream_Read(stream, job->data, compressedSize))) {
+		Mem_Free(job->data);
+		job->data = NULL;
+		return res;
+	}
+
+	job->path             = path;
+	job->dataLen          = compressedSize;
+	job->uncompressedSize = uncompressedSize;
+	job->method           = method;
+	job->decoded          = NULL;
+	job->result           = 0;
+
+	Mutex_Lock(zip_mutex);
+	job->state = ZIP_JOB_QUEUED;
+	Mutex_Unlock(zip_mutex);
+	return 0;
+}
+
+static void ZipParallel_Free(void) {
+	int i;
+	zip_quit = true;
+
+	for (i = 0; i < ZIP_MAX_WORKERS; i++) {
+		if (zip_wakeups[i]) Waitable_Signal(zip_wakeups[i]);
+	}
+	for (i = 0; i < ZIP_MAX_WORKERS; i++) {
+		if (zip_threads[i]) Thread_Join(zip_threads[i]);
+		if (zip_wakeups[i]) Waitable_Free(zip_wakeups[i]);
+		Mem_Free(zip_states[i]);
+
+		zip_threads[i] = NULL;
+		zip_wakeups[i] = NULL;
+		zip_states[i]  = NULL;
+	}
+
+	if (zip_mutex)   Mutex_Free(zip_mutex);
+	if (zip_jobDone) Waitable_Free(zip_jobDone);
+	zip_mutex   = NULL;
+	zip_jobDone = NULL;
+	zip_active  = false;
+}
+
+static cc_result ZipParallel_Start(void) {
+	int i;
+	for (i = 0; i < ZIP_MAX_WORKERS; i++) {
+		zip_states[i] = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+		if (!zip_states[i]) { ZipParallel_Free(); return ERR_OUT_OF_MEMORY; }
+	}
+	for (i = 0; i < ZIP_MAX_JOBS; i++) {
+		zip_jobs[i].state = ZIP_JOB_FREE;
+	}
+
+	zip_active    = true;
+	zip_quit      = false;
+	zip_queueHead = 0;
+	zip_workersStarted = 0;
+
+	zip_mutex   = Mutex_Create("Zip workers");
+	zip_jobDone = Waitable_Create("Zip job done");
+
+	for (i = 0; i < ZIP_MAX_WORKERS; i++) {
+		zip_wakeups[i] = Waitable_Create("Zip worker wakeup");
+	}
+	for (i = 0; i < ZIP_MAX_WORKERS; i++) {
+		Thread_Run(&zip_threads[i], ZipWorker_Run, 256 * 1024, "Zip worker");
+	}
+	return 0;
+}
+
+cc_result Zip_ExtractParallel(struct Stream* source, Zip_SelectEntry selector, Zip_DecodeEntry decoder,
+						Zip_FreeDecoded freeDecoded, Zip_ProcessDecoded processor, struct ZipEntry* entries, int maxEntries) {
+	struct ZipState state;
+	struct ZipJob* job;
+	cc_result res, jobRes;
+	int i, j, cur = 0;
+	if (zip_active) return ERR_NOT_SUPPORTED;
+
+	state.source       = source;
+	state.SelectEntry  = selector;
+	state.ProcessEntry = NULL;
+	state.entries      = entries;
+	state.maxEntries   = maxEntries;
+	if ((res = Zip_ReadDirectory(&state))) return res;
+
+	zip_decoder = decoder;
+	if ((res = ZipParallel_Start())) return res;
+
+	/* Entries are read from the archive here, decompressed and decoded on the worker threads, */
+	/*  and then processed back here in the same order as Zip_Extract would process them */
+	for (i = 0; i < state.usedEntries; i++) {
+		job = &zip_jobs[cur];
+		/* All jobs in use, so have to wait for the oldest to finish */
+		if (job->state != ZIP_JOB_FREE && (res = ZipParallel_FinishJob(job, processor, freeDecoded))) break;
+
+		if ((res = ZipParallel_ReadEntry(&state, &state.entries[i], job))) break;
+		if (job->state == ZIP_JOB_FREE) continue;
+
+		for (j = 0; j < ZIP_MAX_WORKERS; j++) { Waitable_Signal(zip_wakeups[j]); }
+		cur = (cur + 1) % ZIP_MAX_JOBS;
+	}
+
+	/* Remaining jobs have to be processed in the order they were queued */
+	for (i = 0; i < ZIP_MAX_JOBS; i++) {
+		job = &zip_jobs[(cur + i) % ZIP_MAX_JOBS];
+		if (job->state == ZIP_JOB_FREE) continue;
+
+		jobRes = ZipParallel_FinishJob(job, res ? NULL : processor, freeDecoded);
+		if (!res) res = jobRes;
+	}
+
+	ZipParallel_Free();
+	return res;
+}
+#endif
@@ -30,7 +30,7 @@ cc_result ZLibHeader_Read(struct Stream* s, struct ZLibHeader* header);
 #define INFLATE_MAX_LITS_DISTS (INFLATE_MAX_LITS + INFLATE_MAX_DISTS)
 #define INFLATE_MAX_BITS 16
 
-#define INFLATE_FAST_BITS 9
+#define INFLATE_FAST_BITS 10
 #define INFLATE_FAST_LEN_SHIFT 9
 #define INFLATE_FAST_VAL_MASK  0x1FF
 
@@ -48,12 +48,14 @@ struct HuffmanTable {
 struct InflateState {
 	cc_uint8 State;
 	cc_bool LastBlock; /* Whether the last DEFLATE block has been encounted in the stream */
-	cc_uint32 Bits;    /* Holds bits across byte boundaries */
+	cc_uintptr Bits;   /* Holds bits across byte boundaries (64 bits wide on 64 bit CPUs) */
 	cc_uint32 NumBits; /* Number of bits in Bits buffer */
 
 	cc_uint8* NextIn;   /* Pointer within Input buffer to next byte that can be read */
 	cc_uint32 AvailIn;  /* Max number of bytes that can be read from Input buffer */
 	cc_uint8* Output;   /* Pointer for output data */
+	cc_uint8* OutputBase; /* Start of buffer being decompressed directly into (see Inflate_SetOutputBuffer) */
+	cc_uint8* OutputEnd;  /* End of buffer being decompressed directly into */
 	cc_uint32 AvailOut; /* Max number of bytes that can be written to Output buffer */
 	struct Stream* Source;  /* Source for filling Input buffer */
 
@@ -78,6 +80,12 @@ CC_API void Inflate_Init2(struct InflateState* state, struct Stream* source);
 /* Attempts to decompress as much of the currently pending data as possible. */
 /* NOTE: This is a low level call - usually you treat as a stream via Inflate_MakeStream. */
 void Inflate_Process(struct InflateState* s);
+/* Makes the decompressor use previous output in the given buffer as its LZ77 history, */
+/*  which avoids having to decompress into the window and then copy into the output */
+/* NOTE: Only more efficient when the rest of the buffer will be read through the stream in order */
+/* (e.g. when reading all of the blocks of a map). Otherwise reverts to decompressing into the window */
+/* NOTE: Passing NULL for buffer immediately reverts to decompressing into the window */
+void Inflate_SetOutputBuffer(struct InflateState* state, cc_uint8* buffer, cc_uint32 size);
 /* Deompresses input data read from another stream using DEFLATE. Read only stream. */
 /* NOTE: This only uncompresses pure DEFLATE compressed data. */
 /* If data starts with a GZIP or ZLIB header, use GZipHeader_Read or ZLibHeader_Read to first skip it. */
@@ -87,8 +95,13 @@ CC_API void Inflate_MakeStream2(struct Stream* stream, struct InflateState* stat
 #define DEFLATE_BLOCK_SIZE  16384
 #define DEFLATE_BUFFER_SIZE 32768
 #define DEFLATE_OUT_SIZE 8192
-#define DEFLATE_HASH_SIZE 0x1000UL
-#define DEFLATE_HASH_MASK 0x0FFFUL
+#define DEFLATE_HASH_BITS 13
+#define DEFLATE_HASH_SIZE (1UL << DEFLATE_HASH_BITS)
+/* Greedy matching and fixed huffman codes (fastest) */
+#define DEFLATE_LEVEL_FAST 1
+/* Lazy matching with longer hash chains and dynamic huffman codes (smaller output) */
+#define DEFLATE_LEVEL_BEST 2
+
 struct DeflateState {
 	cc_uint32 Bits;         /* Holds bits across byte boundaries */
 	cc_uint32 NumBits;      /* Number of bits in Bits buffer */
@@ -98,8 +111,12 @@ struct DeflateState {
 	cc_uint32 AvailOut;   /* Max number of bytes that can be written to Output buffer */
 	struct Stream* Dest; /* Destination that Output buffer is written to */
 
-	cc_uint16 LitsCodewords[INFLATE_MAX_LITS]; /* Codewords for each value */
-	cc_uint8 LitsLens[INFLATE_MAX_LITS];       /* Bit lengths of each codeword */
+	cc_uint16 LitsCodewords[INFLATE_MAX_LITS];   /* Codewords for each value */
+	cc_uint8 LitsLens[INFLATE_MAX_LITS];         /* Bit lengths of each codeword */
+	cc_uint16 DistsCodewords[INFLATE_MAX_DISTS]; /* Codewords for each distance code */
+	cc_uint8 DistsLens[INFLATE_MAX_DISTS];       /* Bit lengths of each distance codeword */
+	cc_uint16 LitsFreqs[INFLATE_MAX_LITS];       /* Number of times each value is used in current block */
+	cc_uint16 DistsFreqs[INFLATE_MAX_DISTS];     /* Number of times each distance code is used in current block */
 	
 	cc_uint8 Input[DEFLATE_BUFFER_SIZE];
 	cc_uint8 Output[DEFLATE_OUT_SIZE];
@@ -107,10 +124,13 @@ struct DeflateState {
 	cc_uint16 Prev[DEFLATE_BUFFER_SIZE];
 	/* NOTE: The largest possible value that can get */
 	/*  stored in Head/Prev is <= DEFLATE_BUFFER_SIZE */
-	cc_bool WroteHeader;
+	cc_uint8 Symbols[DEFLATE_BLOCK_SIZE * 3]; /* Literals and matches found in current block */
+	cc_uint32 NumSymbols; /* Number of entries in Symbols */
+	cc_uint8 Level;       /* Compression level, DEFLATE_LEVEL_BEST by default */
 };
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
+/* NOTE: Level can be changed after calling this, but only before writing any data */
 CC_API void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying);
 
 struct GZipState { struct DeflateState Base; cc_uint32 Crc32, Size; };
@@ -119,6 +139,13 @@ struct GZipState { struct DeflateState Base; cc_uint32 Crc32, Size; };
 CC_API  void GZip_MakeStream(      struct Stream* stream, struct GZipState* state, struct Stream* underlying);
 typedef void (*FP_GZip_MakeStream)(struct Stream* stream, struct GZipState* state, struct Stream* underlying);
 
+#ifdef CC_BUILD_SAVEWORKERS
+/* Compresses input data using GZIP on multiple worker threads, then writes compressed output to another stream. Write only stream. */
+/* Input is split into chunks that are compressed independently, with the end of the previous chunk as a preset dictionary. */
+/* NOTE: Only one such stream can be active at once. Close must always be called, as it frees the worker threads. */
+cc_result GZipParallel_MakeStream(struct Stream* stream, struct Stream* underlying);
+#endif
+
 struct ZLibState { struct DeflateState Base; cc_uint32 Adler32; };
 /* Compresses input data using ZLIB, then writes compressed output to another stream. Write only stream. */
 /* ZLIB compression is ZLIB header, followed by DEFLATE compressed data, followed by ZLIB footer. */
@@ -138,5 +165,44 @@ typedef cc_bool (*Zip_SelectEntry)(const cc_string* path);
 cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor,
 						struct ZipEntry* entries, int maxEntries);
 
+struct ZipIndex;
+/* Provides random access to the entries in a .zip archive */
+/* NOTE: The parsed central directory is cached, so reopening an unchanged archive is cheap */
+struct ZipArchive { struct Stream* source; struct ZipIndex* index; };
+
+/* Reads the central directory of a .zip archive. source must be seekable. */
+cc_result ZipArchive_Open(struct ZipArchive* archive, struct Stream* source);
+/* Releases the central directory of the archive. (does NOT close source) */
+void ZipArchive_Close(struct ZipArchive* archive);
+/* Returns the total number of entries in the archive */
+int ZipArchive_Count(struct ZipArchive* archive);
+/* Returns the path of the i'th entry in the archive */
+cc_string ZipArchive_GetPath(struct ZipArchive* archive, int i);
+/* Returns the sizes and offset of the i'th entry in the archive */
+const struct ZipEntry* ZipArchive_GetEntry(struct ZipArchive* archive, int i);
+/* Returns the index of the entry with the given path (case insensitive), or -1 if not found */
+int ZipArchive_Find(struct ZipArchive* archive, const cc_string* path);
+/* Opens a stream that reads the decompressed data of the i'th entry in the archive */
+/* NOTE: The stream MUST be closed afterwards, and reads from source's current position */
+/*  (i.e. only read from one entry stream at a time, and don't seek source while reading) */
+cc_result ZipArchive_OpenEntry(struct ZipArchive* archive, int i, struct Stream* stream);
+
+#ifdef CC_BUILD_ZIPWORKERS
+/* Callback function to decode the decompressed data of a .zip archive entry (e.g. PNG images) */
+/* Returns the decoded data, or NULL if the entry could not be or does not need to be decoded */
+/* NOTE: This is called on worker threads, so must not access game state */
+typedef void* (*Zip_DecodeEntry)(const cc_string* path, struct Stream* data);
+/* Callback function to free decoded data of an entry that is not going to be processed */
+typedef void  (*Zip_FreeDecoded)(void* decoded);
+/* Callback function to process the decompressed data and decoded data of a .zip archive entry */
+/* NOTE: This takes ownership of the decoded data */
+typedef cc_result (*Zip_ProcessDecoded)(const cc_string* path, struct Stream* data, void* decoded);
+
+/* Same as Zip_Extract, except that entries are decompressed and decoded on multiple worker threads */
+/* NOTE: processor is still only called on the calling thread, and in the same order as Zip_Extract */
+cc_result Zip_ExtractParallel(struct Stream* source, Zip_SelectEntry selector, Zip_DecodeEntry decoder,
+						Zip_FreeDecoded freeDecoded, Zip_ProcessDecoded processor, struct ZipEntry* entries, int maxEntries);
+#endif
+
 CC_END_HEADER
 #endif
@@ -2,7 +2,7 @@
 #include "TexturePack.h"
 #include "Constants.h"
 #include "Graphics.h"
-struct _DrawerData Drawer;
+CC_THREADLOCAL struct _DrawerData Drawer;
 
 void Drawer_XMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
 	struct VertexTextured* v = *vertices;
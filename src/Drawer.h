@@ -10,7 +10,12 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 */
 struct VertexTextured;
 
+#ifdef CC_BUILD_MESHWORKERS
+/* NOTE: Each thread has its own state, as chunks can be meshed on multiple threads at once */
+extern CC_THREADLOCAL struct _DrawerData {
+#else
 CC_VAR extern struct _DrawerData {
+#endif
 	/* Whether a colour tinting effect should be applied to all faces. */
 	cc_bool Tinted;
 	/* The colour to multiply colour of faces by (tinting effect). */
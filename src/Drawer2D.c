@@ -1,4 +1,16 @@
 #include "Drawer2D.h"
+/* NOTE: Included before Funcs.h, since C++ standard headers may #undef its min/max */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define DRAWER2D_SSE2
+	#include <emmintrin.h>
+#elif defined __ARM_NEON && defined __aarch64__
+	#define DRAWER2D_NEON
+	#include <arm_neon.h>
+#endif
+/* SIMD fills/blends only support 32 bit pixels, with alpha in the upper 8 bits */
+#if (defined DRAWER2D_SSE2 || defined DRAWER2D_NEON) && BITMAPCOLOR_SIZE == 4 && BITMAPCOLOR_A_SHIFT == 24
+	#define DRAWER2D_SIMD
+#endif
 #include "String.h"
 #include "Graphics.h"
 #include "Funcs.h"
@@ -15,6 +27,7 @@
 #include "Options.h"
 #include "TexturePack.h"
 #include "SystemFonts.h"
+#define MEM_SUBSYSTEM MEM_SYS_UI
 
 struct _Drawer2DData Drawer2D;
 #define Font_IsBitmap(font) (!(font)->handle)
@@ -147,6 +160,36 @@ cc_bool Drawer2D_Clamp(struct Context2D* ctx, int* x, int* y, int* width, int* h
 }
 #define Drawer2D_ClampPixel(p) p = (p < 0 ? 0 : (p > 255 ? 255 : p))
 
+/* Contexts are constantly allocated and then freed straight after (e.g. whenever chat or HUD text changes), */
+/*  so the most recently freed pixels buffer is kept around and reused to avoid allocator churn */
+/* NOTE: Larger buffers are not kept, to avoid permanently tying up memory on consoles */
+#define CONTEXT2D_MAX_SCRATCH (256 * 128)
+static BitmapCol* ctx2D_scratch;
+static int ctx2D_scratchSize;
+static cc_bool ctx2D_scratchInUse;
+
+static BitmapCol* Context2D_AllocPixels(int size) {
+	if (!ctx2D_scratch || ctx2D_scratchInUse || size > ctx2D_scratchSize)
+		return (BitmapCol*)Mem_AllocCleared(size, BITMAPCOLOR_SIZE, "bitmap data");
+
+	ctx2D_scratchInUse = true;
+	Mem_Set(ctx2D_scratch, 0, size * BITMAPCOLOR_SIZE);
+	return ctx2D_scratch;
+}
+
+static void Context2D_FreePixels(BitmapCol* pixels, int size) {
+	if (pixels == ctx2D_scratch) { ctx2D_scratchInUse = false; return; }
+
+	/* Keep around as the new scratch buffer if it is larger */
+	if (!ctx2D_scratchInUse && size > ctx2D_scratchSize && size <= CONTEXT2D_MAX_SCRATCH) {
+		Mem_Free(ctx2D_scratch);
+		ctx2D_scratch     = pixels;
+		ctx2D_scratchSize = size;
+	} else {
+		Mem_Free(pixels);
+	}
+}
+
 void Context2D_Alloc(struct Context2D* ctx, int width, int height) {
 	ctx->width  = width;
 	ctx->height = height;
@@ -163,7 +206,7 @@ void Context2D_Alloc(struct Context2D* ctx, int width, int height) {
 
 	ctx->bmp.width  = width; 
 	ctx->bmp.height = height;
-	ctx->bmp.scan0  = (BitmapCol*)Mem_AllocCleared(width * height, BITMAPCOLOR_SIZE, "bitmap data");
+	ctx->bmp.scan0  = Context2D_AllocPixels(width * height);
 }
 
 void Context2D_Wrap(struct Context2D* ctx, struct Bitmap* bmp) {
@@ -174,10 +217,90 @@ void Context2D_Wrap(struct Context2D* ctx, struct Bitmap* bmp) {
 }
 
 void Context2D_Free(struct Context2D* ctx) {
-	Mem_Free(ctx->bmp.scan0);
+	Context2D_FreePixels(ctx->bmp.scan0, ctx->bmp.width * ctx->bmp.height);
 }
 
 #define BitmapColor_Raw(r, g, b) (BitmapColor_R_Bits(r) | BitmapColor_G_Bits(g) | BitmapColor_B_Bits(b))
+/* Exactly equivalent to value / 255, for values between 0 and 65025 */
+#define Drawer2D_Div255(value) (((value) + 1 + ((value) >> 8)) >> 8)
+
+static void Drawer2D_FillRow(BitmapCol* row, BitmapCol color, int width) {
+	int x = 0;
+#if defined DRAWER2D_SIMD && defined DRAWER2D_SSE2
+	__m128i col4 = _mm_set1_epi32((int)color);
+	for (; x + 4 <= width; x += 4) 
+	{
+		_mm_storeu_si128((__m128i*)(row + x), col4);
+	}
+#elif defined DRAWER2D_SIMD && defined DRAWER2D_NEON
+	uint32x4_t col4 = vdupq_n_u32(color);
+	for (; x + 4 <= width; x += 4) 
+	{
+		vst1q_u32((uint32_t*)(row + x), col4);
+	}
+#endif
+	for (; x < width; x++) { row[x] = color; }
+}
+
+/* Blends the given row with the premultiplied source color, then makes the pixels opaque */
+static void Drawer2D_BlendRow(BitmapCol* dst, BitmapCol color, int inverse, int width) {
+	int R, G, B, x = 0;
+#if defined DRAWER2D_SIMD && defined DRAWER2D_SSE2
+	__m128i zero  = _mm_setzero_si128();
+	__m128i one   = _mm_set1_epi16(1);
+	__m128i inv   = _mm_set1_epi16((short)inverse);
+	__m128i col4  = _mm_set1_epi32((int)color);
+	__m128i alpha = _mm_set1_epi32((int)BITMAPCOLOR_A_MASK);
+	__m128i pix, lo, hi;
+
+	for (; x + 4 <= width; x += 4) 
+	{
+		pix = _mm_loadu_si128((const __m128i*)(dst + x));
+		lo  = _mm_mullo_epi16(_mm_unpacklo_epi8(pix, zero), inv);
+		hi  = _mm_mullo_epi16(_mm_unpackhi_epi8(pix, zero), inv);
+
+		lo  = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+		hi  = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+
+		/* Can't overflow, since color is premultiplied by (255 - inverse) */
+		pix = _mm_add_epi8(_mm_packus_epi16(lo, hi), col4);
+		_mm_storeu_si128((__m128i*)(dst + x), _mm_or_si128(pix, alpha));
+	}
+#elif defined DRAWER2D_SIMD && defined DRAWER2D_NEON
+	uint8x8_t   inv   = vdup_n_u8((cc_uint8)inverse);
+	uint16x8_t  one   = vdupq_n_u16(1);
+	uint8x16_t  col4  = vreinterpretq_u8_u32(vdupq_n_u32(color));
+	uint8x16_t  alpha = vreinterpretq_u8_u32(vdupq_n_u32(BITMAPCOLOR_A_MASK));
+	uint8x16_t  pix;
+	uint16x8_t  lo, hi;
+
+	for (; x + 4 <= width; x += 4) 
+	{
+		pix = vreinterpretq_u8_u32(vld1q_u32((const uint32_t*)(dst + x)));
+		lo  = vmull_u8(vget_low_u8(pix),  inv);
+		hi  = vmull_u8(vget_high_u8(pix), inv);
+
+		lo  = vshrq_n_u16(vaddq_u16(vaddq_u16(lo, one), vshrq_n_u16(lo, 8)), 8);
+		hi  = vshrq_n_u16(vaddq_u16(vaddq_u16(hi, one), vshrq_n_u16(hi, 8)), 8);
+
+		/* Can't overflow, since color is premultiplied by (255 - inverse) */
+		pix = vaddq_u8(vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)), col4);
+		vst1q_u32((uint32_t*)(dst + x), vreinterpretq_u32_u8(vorrq_u8(pix, alpha)));
+	}
+#endif
+
+	for (; x < width; x++) {
+		R = BitmapCol_R(dst[x]) * inverse;
+		G = BitmapCol_G(dst[x]) * inverse;
+		B = BitmapCol_B(dst[x]) * inverse;
+
+		R = BitmapCol_R(color) + Drawer2D_Div255(R);
+		G = BitmapCol_G(color) + Drawer2D_Div255(G);
+		B = BitmapCol_B(color) + Drawer2D_Div255(B);
+		dst[x] = BitmapColor_RGB(R, G, B);
+	}
+}
+
 void Gradient_Noise(struct Context2D* ctx, BitmapCol color, int variation,
 					int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
@@ -217,7 +340,7 @@ void Gradient_Vertical(struct Context2D* ctx, BitmapCol a, BitmapCol b,
 					   int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
 	BitmapCol* row, color;
-	int xx, yy;
+	int yy;
 	float t;
 	if (!Drawer2D_Clamp(ctx, &x, &y, &width, &height)) return;
 
@@ -230,20 +353,17 @@ void Gradient_Vertical(struct Context2D* ctx, BitmapCol a, BitmapCol b,
 			Math_Lerp(BitmapCol_G(a), BitmapCol_G(b), t),
 			Math_Lerp(BitmapCol_B(a), BitmapCol_B(b), t),
 			255);
-
-		for (xx = 0; xx < width; xx++) { row[xx] = color; }
+		Drawer2D_FillRow(row, color, width);
 	}
 }
 
 void Gradient_Blend(struct Context2D* ctx, BitmapCol color, int blend,
 					int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
-	BitmapCol* dst;
-	int R, G, B, xx, yy;
+	int yy;
 	if (!Drawer2D_Clamp(ctx, &x, &y, &width, &height)) return;
 
 	/* Pre compute the alpha blended source color */
-	/* TODO: Avoid shift when multiplying */
 	color = BitmapCol_Make(
 		BitmapCol_R(color) * blend / 255,
 		BitmapCol_G(color) * blend / 255,
@@ -252,16 +372,7 @@ void Gradient_Blend(struct Context2D* ctx, BitmapCol color, int blend,
 	blend = 255 - blend; /* inverse for existing pixels */
 
 	for (yy = 0; yy < height; yy++) {
-		dst = Bitmap_GetRow(bmp, y + yy) + x;
-
-		for (xx = 0; xx < width; xx++, dst++) {
-			/* TODO: Not shift when multiplying */
-			R = BitmapCol_R(color) + (BitmapCol_R(*dst) * blend) / 255;
-			G = BitmapCol_G(color) + (BitmapCol_G(*dst) * blend) / 255;
-			B = BitmapCol_B(color) + (BitmapCol_B(*dst) * blend) / 255;
-
-			*dst = BitmapColor_RGB(R, G, B);
-		}
+		Drawer2D_BlendRow(Bitmap_GetRow(bmp, y + yy) + x, color, blend, width);
 	}
 }
 
@@ -284,13 +395,11 @@ void Context2D_DrawPixels(struct Context2D* ctx, int x, int y, struct Bitmap* sr
 void Context2D_Clear(struct Context2D* ctx, BitmapCol color,
 					int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
-	BitmapCol* row;
-	int xx, yy;
+	int yy;
 	if (!Drawer2D_Clamp(ctx, &x, &y, &width, &height)) return;
 
 	for (yy = 0; yy < height; yy++) {
-		row = Bitmap_GetRow(bmp, y + yy) + x;
-		for (xx = 0; xx < width; xx++) { row[xx] = color; }
+		Drawer2D_FillRow(Bitmap_GetRow(bmp, y + yy) + x, color, width);
 	}
 }
 
@@ -706,6 +815,10 @@ static void OnInit(void) {
 static void OnFree(void) { 
 	FreeFontBitmap();
 	fontBitmap.scan0 = NULL;
+
+	Mem_Free(ctx2D_scratch);
+	ctx2D_scratch     = NULL;
+	ctx2D_scratchSize = 0;
 }
 
 struct IGameComponent Drawer2D_Component = {
@@ -22,6 +22,7 @@
 #include "Errors.h"
 #include "Utils.h"
 #include "EntityRenderers.h"
+#define MEM_SUBSYSTEM MEM_SYS_SKINS
 
 const char* const NameMode_Names[NAME_MODE_COUNT]   = { "None", "Hovered", "All", "AllHovered", "AllUnscaled" };
 const char* const ShadowMode_Names[SHADOW_MODE_COUNT] = { "None", "SnapToBlock", "Circle", "CircleAll" };
@@ -42,7 +43,7 @@ void Entity_Init(struct Entity* e) {
 	e->Flags      = ENTITY_FLAG_HAS_MODELVB;
 	e->uScale     = 1.0f;
 	e->vScale     = 1.0f;
-	e->_skinReqID = 0;
+	e->_skinID = 0;
 	e->SkinRaw[0] = '\0';
 	e->NameRaw[0] = '\0';
 	Entity_SetModel(e, &model);
@@ -205,64 +206,6 @@ cc_bool Entity_TouchesAnyWater(struct Entity* e) {
 /*########################################################################################################################*
 *------------------------------------------------------Entity skins-------------------------------------------------------*
 *#########################################################################################################################*/
-static struct Entity* Entity_FirstOtherWithSameSkinAndFetchedSkin(struct Entity* except) {
-	struct Entity* e;
-	cc_string skin, eSkin;
-	int i;
-
-	skin = String_FromRawArray(except->SkinRaw);
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
-		if (!Entities.List[i] || Entities.List[i] == except) continue;
-
-		e     = Entities.List[i];
-		eSkin = String_FromRawArray(e->SkinRaw);
-		if (e->SkinFetchState && String_Equals(&skin, &eSkin)) return e;
-	}
-	return NULL;
-}
-
-/* Copies skin data from another entity */
-static void Entity_CopySkin(struct Entity* dst, struct Entity* src) {
-	dst->TextureId    = src->TextureId;	
-	dst->SkinType     = src->SkinType;
-	dst->uScale       = src->uScale;
-	dst->vScale       = src->vScale;
-	dst->MobTextureId = src->MobTextureId;
-}
-
-/* Resets skin data for the given entity */
-static void Entity_ResetSkin(struct Entity* e) {
-	e->uScale = 1.0f; e->vScale = 1.0f;
-	e->MobTextureId = 0;
-	e->TextureId    = 0;
-	e->SkinType     = SKIN_64x32;
-}
-
-/* Copies or resets skin data for all entity with same skin */
-static void Entity_SetSkinAll(struct Entity* source, cc_bool reset) {
-	struct Entity* e;
-	cc_string skin, eSkin;
-	int i;
-
-	skin = String_FromRawArray(source->SkinRaw);
-	source->MobTextureId = Utils_IsUrlPrefix(&skin) ? source->TextureId : 0;
-
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
-		if (!Entities.List[i]) continue;
-
-		e     = Entities.List[i];
-		eSkin = String_FromRawArray(e->SkinRaw);
-		if (!String_Equals(&skin, &eSkin)) continue;
-
-		if (reset) {
-			Entity_ResetSkin(e);
-		} else {
-			Entity_CopySkin(e, source);
-		}
-		e->SkinFetchState = SKIN_FETCH_COMPLETED;
-	}
-}
-
 /* Clears hat area from a skin bitmap if it's completely white or black,
    so skins edited with Microsoft Paint or similiar don't have a solid hat */
 static void Entity_ClearHat(struct Bitmap* bmp, cc_uint8 skinType) {
@@ -290,7 +233,7 @@ static void Entity_ClearHat(struct Bitmap* bmp, cc_uint8 skinType) {
 }
 
 /* Ensures skin is a power of two size, resizing if needed. */
-static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
+static cc_result EnsurePow2Skin(struct Bitmap* bmp, float* uScale, float* vScale) {
 	struct Bitmap scaled;
 	cc_uint32 stride;
 	int width, height;
@@ -303,8 +246,8 @@ static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
 	Bitmap_TryAllocate(&scaled, width, height);
 	if (!scaled.scan0) return ERR_OUT_OF_MEMORY;
 
-	e->uScale = (float)bmp->width  / width;
-	e->vScale = (float)bmp->height / height;
+	*uScale = (float)bmp->width  / width;
+	*vScale = (float)bmp->height / height;
 	stride = bmp->width * 4;
 
 	for (y = 0; y < bmp->height; y++) {
@@ -318,27 +261,6 @@ static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
 	return 0;
 }
 
-static cc_result ApplySkin(struct Entity* e, struct Bitmap* bmp, struct Stream* src, cc_string* skin) {
-	cc_result res;
-	if ((res = Png_Decode(bmp, src))) return res;
-
-	Gfx_DeleteTexture(&e->TextureId);
-	Entity_SetSkinAll(e, true);
-	if ((res = EnsurePow2Skin(e, bmp))) return res;
-	e->SkinType = Utils_CalcSkinType(bmp);
-
-	if (!Gfx_CheckTextureSize(bmp->width, bmp->height, 0)) {
-		Chat_Add1("&cSkin %s is too large", skin);
-	} else {
-		if (e->Model->flags & MODEL_FLAG_CLEAR_HAT)
-			Entity_ClearHat(bmp, e->SkinType);
-
-		e->TextureId = Gfx_CreateTexture(bmp, TEXTURE_FLAG_MANAGED, false);
-		Entity_SetSkinAll(e, false);
-	}
-	return 0;
-}
-
 static void LogInvalidSkin(cc_result res, const cc_string* skin, const cc_uint8* data, int size) {
 	cc_string msg; char msgBuffer[256];
 	String_InitArray(msg, msgBuffer);
@@ -352,64 +274,355 @@ static void LogInvalidSkin(cc_result res, const cc_string* skin, const cc_uint8*
 	Logger_WarnFunc(&msg);
 }
 
-static void Entity_CheckSkin(struct Entity* e) {
-	struct Entity* first;
-	struct HttpRequest item;
-	struct Stream mem;
+
+/*########################################################################################################################*
+*-----------------------------------------------------Skin decoding-------------------------------------------------------*
+*#########################################################################################################################*/
+/* A downloaded skin, which is decoded and made ready for creating a texture from */
+/* NOTE: Only created on the main thread, but decoded on the skin worker thread */
+struct SkinJob {
+	struct SkinJob* next;
+	cc_uint8* data;
+	cc_uint32 size;
+	cc_bool clearHat, cancelled, done;
+	cc_uint8 skinType;
+	cc_result res;
+	float uScale, vScale;
 	struct Bitmap bmp;
-	cc_string skin;
-	cc_uint8 flags;
+};
+
+static void SkinJob_Run(struct SkinJob* job) {
+	struct Stream mem;
 	cc_result res;
+	Stream_ReadonlyMemory(&mem, job->data, job->size);
+
+	job->uScale = 1.0f; job->vScale = 1.0f;
+	if ((res = Png_Decode(&job->bmp, &mem)))                          { job->res = res; return; }
+	if ((res = EnsurePow2Skin(&job->bmp, &job->uScale, &job->vScale))) { job->res = res; return; }
+	/* Skin was decoded by the bitmap code, but still belongs to the skin */
+	Mem_Retag(job->bmp.scan0, MEM_SYS_SKINS);
+
+	job->skinType = Utils_CalcSkinType(&job->bmp);
+	if (job->clearHat) Entity_ClearHat(&job->bmp, job->skinType);
+}
+
+static void SkinJob_Free(struct SkinJob* job) {
+	Mem_Free(job->bmp.scan0);
+	Mem_Free(job->data);
+	Mem_Free(job);
+}
+
+#ifdef CC_BUILD_SKINWORKERS
+/* Jobs that are waiting to be decoded, in order of being queued */
+static struct SkinJob* skin_head;
+static struct SkinJob* skin_tail;
+static void* skin_thread;
+static void* skin_mutex;
+static void* skin_wakeup;
+static volatile cc_bool skin_quit;
+
+static void SkinWorker_Run(void) {
+	struct SkinJob* job;
+	cc_bool cancelled;
+
+	for (;;) {
+		Mutex_Lock(skin_mutex);
+		job = skin_head;
+		if (job) {
+			skin_head = job->next;
+			if (!skin_head) skin_tail = NULL;
+		}
+		cancelled = job && job->cancelled;
+		Mutex_Unlock(skin_mutex);
 
-	/* Don't check skin if don't have to */
-	if (!e->Model->usesSkin) return;
-	if (e->SkinFetchState == SKIN_FETCH_COMPLETED) return;
-	skin = String_FromRawArray(e->SkinRaw);
+		if (!job) {
+			if (skin_quit) return;
+			Waitable_Wait(skin_wakeup); continue;
+		}
+		if (!cancelled) SkinJob_Run(job);
 
-	if (!e->SkinFetchState) {
-		first = Entity_FirstOtherWithSameSkinAndFetchedSkin(e);
-		flags = e == &LocalPlayer_Instances[0].Base ? HTTP_FLAG_NOCACHE : 0;
+		Mutex_Lock(skin_mutex);
+		cancelled = job->cancelled;
+		job->done = true;
+		Mutex_Unlock(skin_mutex);
 
-		if (!first) {
-			e->_skinReqID     = Http_AsyncGetSkin(&skin, flags);
-			e->SkinFetchState = SKIN_FETCH_DOWNLOADING;
-		} else {
-			Entity_CopySkin(e, first);
-			e->SkinFetchState = SKIN_FETCH_COMPLETED;
-			return;
-		}
+		/* Main thread no longer cares about the job, so it's up to this thread to free it */
+		if (cancelled) SkinJob_Free(job);
+	}
+}
+
+static void SkinJob_Queue(struct SkinJob* job) {
+	if (!skin_thread) {
+		skin_mutex  = Mutex_Create("Skin jobs");
+		skin_wakeup = Waitable_Create("Skin worker wakeup");
+		Thread_Run(&skin_thread, SkinWorker_Run, 256 * 1024, "Skin decoder");
 	}
 
-	if (!Http_GetResult(e->_skinReqID, &item)) return;
+	Mutex_Lock(skin_mutex);
+	if (skin_tail) { skin_tail->next = job; } else { skin_head = job; }
+	skin_tail = job;
+	Mutex_Unlock(skin_mutex);
+	Waitable_Signal(skin_wakeup);
+}
+
+static cc_bool SkinJob_IsDone(struct SkinJob* job) {
+	cc_bool done;
+	Mutex_Lock(skin_mutex);
+	done = job->done;
+	Mutex_Unlock(skin_mutex);
+	return done;
+}
 
-	if (!item.success) {
-		Entity_SetSkinAll(e, true);
+static void SkinJob_Cancel(struct SkinJob* job) {
+	cc_bool done;
+	Mutex_Lock(skin_mutex);
+	done = job->done;
+	job->cancelled = true;
+	Mutex_Unlock(skin_mutex);
+
+	/* Otherwise the job is freed by the skin worker once it finishes with it */
+	if (done) SkinJob_Free(job);
+}
+
+static void SkinWorker_Stop(void) {
+	if (!skin_thread) return;
+	skin_quit = true;
+	Waitable_Signal(skin_wakeup);
+
+	Thread_Join(skin_thread);
+	Mutex_Free(skin_mutex);
+	Waitable_Free(skin_wakeup);
+	skin_thread = NULL;
+	skin_quit   = false;
+}
+#else
+static void SkinJob_Queue(struct SkinJob* job) {
+	SkinJob_Run(job);
+	job->done = true;
+}
+
+static cc_bool SkinJob_IsDone(struct SkinJob* job) { return job->done; }
+static void SkinJob_Cancel(struct SkinJob* job)    { SkinJob_Free(job); }
+static void SkinWorker_Stop(void) { }
+#endif
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Skin cache--------------------------------------------------------*
+*#########################################################################################################################*/
+#define SKINCACHE_BUCKETS 256
+#define SKINENTRY_DOWNLOADING 1
+#define SKINENTRY_DECODING    2
+#define SKINENTRY_READY       3
+
+/* Skin texture shared by all entities that use the same skin */
+struct SkinCacheEntry {
+	/* Number of entities using this skin, 0 if this entry is unused */
+	int refCount;
+	/* Index of the next entry in either the same hash bucket or the free list, -1 if none */
+	int next;
+	cc_uint32 hash;
+	cc_uint8 state, skinType;
+	cc_bool clearHat;
+	int reqID;
+	struct SkinJob* job;
+	GfxResourceID texID;
+	float uScale, vScale;
+	char skin[STRING_SIZE];
+};
+
+/* Each entity uses at most one entry, so there can't be more entries than entities */
+static struct SkinCacheEntry skin_entries[ENTITIES_MAX_COUNT];
+static int skin_buckets[SKINCACHE_BUCKETS];
+static int skin_free = -1;
+
+static void SkinCache_Init(void) {
+	int i;
+	for (i = 0; i < SKINCACHE_BUCKETS; i++) { skin_buckets[i] = -1; }
+
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) { skin_entries[i].next = i + 1; }
+	skin_entries[ENTITIES_MAX_COUNT - 1].next = -1;
+	skin_free = 0;
+}
+
+static cc_uint32 SkinCache_Hash(const cc_string* skin) {
+	cc_uint32 hash = 2166136261UL;
+	int i;
+	for (i = 0; i < skin->length; i++) {
+		hash = (hash ^ (cc_uint8)skin->buffer[i]) * 16777619UL;
+	}
+	return hash;
+}
+
+/* Returns the index of the entry for the given skin, or -1 if there is none */
+static int SkinCache_Find(const cc_string* skin, cc_uint32 hash) {
+	struct SkinCacheEntry* entry;
+	cc_string name;
+	int i;
+
+	for (i = skin_buckets[hash % SKINCACHE_BUCKETS]; i >= 0; i = entry->next)
+	{
+		entry = &skin_entries[i];
+		if (entry->hash != hash) continue;
+
+		name = String_FromRawArray(entry->skin);
+		if (String_Equals(&name, skin)) return i;
+	}
+	return -1;
+}
+
+/* Adds a reference to the entry for the given skin, creating it and starting to download the skin if needed */
+/* Returns the index of the entry, or -1 if there are no free entries */
+static int SkinCache_Acquire(struct Entity* e, const cc_string* skin) {
+	struct SkinCacheEntry* entry;
+	cc_uint32 hash = SkinCache_Hash(skin);
+	cc_uint8 flags;
+	int i;
+
+	i = SkinCache_Find(skin, hash);
+	if (i >= 0) { skin_entries[i].refCount++; return i; }
+	if (skin_free < 0) return -1;
+
+	i = skin_free;
+	entry     = &skin_entries[i];
+	skin_free = entry->next;
+
+	entry->refCount = 1;
+	entry->hash     = hash;
+	entry->state    = SKINENTRY_DOWNLOADING;
+	entry->skinType = SKIN_64x32;
+	entry->clearHat = (e->Model->flags & MODEL_FLAG_CLEAR_HAT) != 0;
+	entry->job      = NULL;
+	entry->texID    = 0;
+	entry->uScale   = 1.0f;
+	entry->vScale   = 1.0f;
+	String_CopyToRawArray(entry->skin, skin);
+
+	entry->next = skin_buckets[hash % SKINCACHE_BUCKETS];
+	skin_buckets[hash % SKINCACHE_BUCKETS] = i;
+
+	flags = e == &LocalPlayer_Instances[0].Base ? HTTP_FLAG_NOCACHE : HTTP_FLAG_CACHE;
+	entry->reqID = Http_AsyncGetSkin(skin, flags);
+	return i;
+}
+
+/* Removes a reference to the given entry, freeing the entry's texture if no other entities are using it */
+static void SkinCache_Release(int i) {
+	struct SkinCacheEntry* entry = &skin_entries[i];
+	int* link;
+	if (--entry->refCount) return;
+
+	if (entry->state == SKINENTRY_DOWNLOADING) Http_TryCancel(entry->reqID);
+	if (entry->job) SkinJob_Cancel(entry->job);
+	Gfx_DeleteTexture(&entry->texID);
+	entry->job = NULL;
+
+	for (link = &skin_buckets[entry->hash % SKINCACHE_BUCKETS]; *link != i; link = &skin_entries[*link].next) { }
+	*link       = entry->next;
+	entry->next = skin_free;
+	skin_free   = i;
+}
+
+static void SkinCache_CreateTexture(struct SkinCacheEntry* entry, struct SkinJob* job) {
+	cc_string skin = String_FromRawArray(entry->skin);
+
+	if (job->res) {
+		LogInvalidSkin(job->res, &skin, job->data, job->size);
+	} else if (!Gfx_CheckTextureSize(job->bmp.width, job->bmp.height, 0)) {
+		Chat_Add1("&cSkin %s is too large", &skin);
 	} else {
-		Stream_ReadonlyMemory(&mem, item.data, item.size);
+		entry->texID    = Gfx_CreateTexture(&job->bmp, TEXTURE_FLAG_MANAGED | TEXTURE_FLAG_COMPRESSED, false);
+		entry->skinType = job->skinType;
+		entry->uScale   = job->uScale;
+		entry->vScale   = job->vScale;
+	}
+}
+
+/* Checks if the skin has finished downloading or decoding yet */
+static void SkinCache_Update(struct SkinCacheEntry* entry) {
+	struct HttpRequest item;
+	struct SkinJob* job;
+
+	if (entry->state == SKINENTRY_DOWNLOADING) {
+		if (!Http_GetResult(entry->reqID, &item)) return;
+		job = NULL;
+		if (item.success) job = (struct SkinJob*)Mem_TryAllocCleared(1, sizeof(struct SkinJob));
 
-		if ((res = ApplySkin(e, &bmp, &mem, &skin))) {
-			LogInvalidSkin(res, &skin, item.data, item.size);
+		if (!job) {
+			HttpRequest_Free(&item);
+			entry->state = SKINENTRY_READY; return;
 		}
-		Mem_Free(bmp.scan0);
+
+		/* Job takes ownership of the downloaded data */
+		job->data     = item.data;
+		job->size     = item.size;
+		job->clearHat = entry->clearHat;
+		item.data     = NULL;
+		HttpRequest_Free(&item);
+		Mem_Retag(job->data, MEM_SYS_SKINS);
+
+		entry->job   = job;
+		entry->state = SKINENTRY_DECODING;
+		SkinJob_Queue(job);
+	}
+
+	if (entry->state == SKINENTRY_DECODING) {
+		job = entry->job;
+		if (!SkinJob_IsDone(job)) return;
+
+		SkinCache_CreateTexture(entry, job);
+		SkinJob_Free(job);
+		entry->job   = NULL;
+		entry->state = SKINENTRY_READY;
 	}
-	HttpRequest_Free(&item);
 }
 
-/* Returns true if no other entities are sharing this skin texture */
-static cc_bool CanDeleteTexture(struct Entity* except) {
+
+/*########################################################################################################################*
+*------------------------------------------------------Entity skins-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Resets skin data for the given entity */
+static void Entity_ResetSkin(struct Entity* e) {
+	e->uScale = 1.0f; e->vScale = 1.0f;
+	e->MobTextureId = 0;
+	e->TextureId    = 0;
+	e->SkinType     = SKIN_64x32;
+}
+
+static void Entity_CheckSkin(struct Entity* e) {
+	struct SkinCacheEntry* entry;
+	cc_string skin;
 	int i;
-	if (!except->TextureId) return false;
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++)
-	{
-		if (!Entities.List[i] || Entities.List[i] == except)  continue;
-		if (Entities.List[i]->TextureId == except->TextureId) return false;
+	/* Don't check skin if don't have to */
+	if (!e->Model->usesSkin) return;
+	if (e->SkinFetchState == SKIN_FETCH_COMPLETED) return;
+	skin = String_FromRawArray(e->SkinRaw);
+
+	if (!e->SkinFetchState) {
+		i = SkinCache_Acquire(e, &skin);
+		e->SkinFetchState = SKIN_FETCH_DOWNLOADING;
+		e->_skinID        = i + 1;
 	}
-	return true;
+
+	/* Should never happen, but just use default skin in case */
+	if (!e->_skinID) { Entity_ResetSkin(e); e->SkinFetchState = SKIN_FETCH_COMPLETED; return; }
+
+	entry = &skin_entries[e->_skinID - 1];
+	SkinCache_Update(entry);
+	if (entry->state != SKINENTRY_READY) return;
+
+	e->TextureId    = entry->texID;
+	e->MobTextureId = Utils_IsUrlPrefix(&skin) ? entry->texID : 0;
+	e->SkinType     = entry->skinType;
+	e->uScale       = entry->uScale;
+	e->vScale       = entry->vScale;
+	e->SkinFetchState = SKIN_FETCH_COMPLETED;
 }
 
 CC_NOINLINE static void DeleteSkin(struct Entity* e) {
-	if (CanDeleteTexture(e)) Gfx_DeleteTexture(&e->TextureId);
+	if (e->_skinID) SkinCache_Release(e->_skinID - 1);
+	e->_skinID = 0;
 
 	Entity_ResetSkin(e);
 	e->SkinFetchState = 0;
@@ -454,14 +667,48 @@ void Entities_Tick(struct ScheduledTask* task) {
 	}
 }
 
+/* Returns the texture that the given entity's model will be drawn with */
+static GfxResourceID Entities_ModelTexture(struct Entity* e) {
+	struct Model* model = e->Model;
+	GfxResourceID tex   = model->usesHumanSkin ? e->TextureId : e->MobTextureId;
+	return tex ? tex : model->defaultTex->texID;
+}
+
 void Entities_RenderModels(float delta, float t) {
-	int i;
+	static cc_uint16 ids[ENTITIES_MAX_COUNT];
+	static GfxResourceID textures[ENTITIES_MAX_COUNT];
+	struct Entity* e;
+	struct Model* model;
+	GfxResourceID tex;
+	int i, j, id, count = 0;
 	Gfx_SetAlphaTest(true);
-	
+	Game.EntitiesCulled = 0;
+
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++)
 	{
 		if (!Entities.List[i]) continue;
-		Entities.List[i]->VTABLE->RenderModel(Entities.List[i], delta, t);
+		ids[count++] = i;
+		textures[i]  = Entities_ModelTexture(Entities.List[i]);
+	}
+	
+	/* Draw entities grouped by model and texture, so that consecutive entities */
+	/*  (e.g. hundreds of zombies on mob servers) reuse the same bound texture */
+	for (i = 0; i < count; i++)
+	{
+		e     = Entities.List[ids[i]];
+		model = e->Model; tex = textures[ids[i]];
+		e->VTABLE->RenderModel(e, delta, t);
+
+		for (j = i + 1; j < count; j++)
+		{
+			e = Entities.List[ids[j]];
+			if (e->Model != model || textures[ids[j]] != tex) continue;
+			i++;
+
+			/* Move the matching entity up to just after the current group */
+			id = ids[j]; ids[j] = ids[i]; ids[i] = id;
+			e->VTABLE->RenderModel(e, delta, t);
+		}
 	}
 	Gfx_SetAlphaTest(false);
 }
@@ -499,6 +746,23 @@ void Entities_Remove(int id) {
 	}
 }
 
+/* Whether the ray might intersect the given entity's picking bounds, however the entity is rotated */
+/*  (cheaply rejects most entities, before the more expensive rotated box test) */
+static cc_bool Entities_RayNearEntity(Vec3 origin, Vec3 dir, struct Entity* e) {
+	struct AABB* bb = &e->ModelAABB;
+	float x = max(Math_AbsF(bb->Min.x), Math_AbsF(bb->Max.x));
+	float y = max(Math_AbsF(bb->Min.y), Math_AbsF(bb->Max.y));
+	float z = max(Math_AbsF(bb->Min.z), Math_AbsF(bb->Max.z));
+	float radiusSqr = x * x + y * y + z * z;
+	Vec3 delta;
+	float along;
+
+	/* Entities are rotated around their position, so their bounds are always within this sphere */
+	Vec3_Sub(&delta, &e->Position, &origin);
+	along = delta.x * dir.x + delta.y * dir.y + delta.z * dir.z;
+	return Vec3_LengthSquared(&delta) - along * along <= radiusSqr;
+}
+
 int Entities_GetClosest(struct Entity* src) {
 	Vec3 eyePos = Entity_GetEyePosition(src);
 	Vec3 dir    = Vec3_GetDirVector(src->Yaw * MATH_DEG2RAD, src->Pitch * MATH_DEG2RAD);
@@ -512,6 +776,7 @@ int Entities_GetClosest(struct Entity* src) {
 	{
 		struct Entity* e = Entities.List[i];
 		if (!e || e == &Entities.CurPlayer->Base) continue;
+		if (!Entities_RayNearEntity(eyePos, dir, e)) continue;
 		if (!Intersection_RayIntersectsRotatedBox(eyePos, dir, e, &t0, &t1)) continue;
 
 		if (targetID == -1 || t0 < closestDist) {
@@ -1081,16 +1346,29 @@ static void NetPlayer_Tick(struct Entity* e, float delta) {
 	AnimatedComp_Update(e, e->prev.pos, e->next.pos, delta);
 }
 
+/* Squared distance beyond which other players are not drawn (0 for no limit) */
+static float entityDrawDistSqr;
+/* Squared distance beyond which the limbs of other players are no longer animated (0 for no limit) */
+static float entityAnimDistSqr;
+
 static void NetPlayer_RenderModel(struct Entity* e, float delta, float t) {
+	float dist;
 	Vec3_Lerp(&e->Position, &e->prev.pos, &e->next.pos, t);
 	Entity_LerpAngles(e, t);
 
-	AnimatedComp_GetCurrent(e, t);
+	/* Cull before calculating animation, as most players are often offscreen */
 	e->ShouldRender = Model_ShouldRender(e);
+	if (!e->ShouldRender) { Game.EntitiesCulled++; return; }
+
+	dist = Model_RenderDistance(e);
 	/* Original classic only shows players up to 64 blocks away */
-	if (Game_ClassicMode) e->ShouldRender &= Model_RenderDistance(e) <= 64 * 64;
+	if (Game_ClassicMode) e->ShouldRender = dist <= 64 * 64;
+	if (entityDrawDistSqr) e->ShouldRender &= dist <= entityDrawDistSqr;
+	if (!e->ShouldRender) { Game.EntitiesCulled++; return; }
 
-	if (e->ShouldRender) Model_Render(e->Model, e);
+	/* Limbs of far away players are left in their last pose */
+	if (!entityAnimDistSqr || dist <= entityAnimDistSqr) AnimatedComp_GetCurrent(e, t);
+	Model_Render(e->Model, e);
 }
 
 static cc_bool NetPlayer_ShouldRenderName(struct Entity* e) {
@@ -1121,6 +1399,7 @@ void NetPlayer_Init(struct NetPlayer* p) {
 static void Entities_Init(void) {
 	int i;
 	Event_Register_(&GfxEvents.ContextLost, NULL, Entities_ContextLost);
+	SkinCache_Init();
 
 	Entities.NamesMode = Options_GetEnum(OPT_NAMES_MODE, NAME_MODE_HOVERED,
 		NameMode_Names, Array_Elems(NameMode_Names));
@@ -1129,6 +1408,12 @@ static void Entities_Init(void) {
 	Entities.ShadowsMode = Options_GetEnum(OPT_ENTITY_SHADOW, SHADOW_MODE_NONE,
 		ShadowMode_Names, Array_Elems(ShadowMode_Names));
 	if (Game_ClassicMode) Entities.ShadowsMode = SHADOW_MODE_NONE;
+	NetInterp_Delay = Options_GetInt(OPT_INTERP_DELAY, 0, 1000, 100) / 1000.0f;
+
+	entityDrawDistSqr = (float)Options_GetInt(OPT_ENTITY_DRAW_DISTANCE, 0, 8192, 0);
+	entityAnimDistSqr = (float)Options_GetInt(OPT_ENTITY_ANIM_DISTANCE, 0, 8192, 0);
+	entityDrawDistSqr *= entityDrawDistSqr;
+	entityAnimDistSqr *= entityAnimDistSqr;
 
 	for (i = 0; i < Game_NumStates; i++)
 	{
@@ -1150,6 +1435,7 @@ static void Entities_Free(void) {
 		Entities_Remove(i);
 	}
 	sources_head = NULL;
+	SkinWorker_Stop();
 }
 
 struct IGameComponent Entities_Component = {
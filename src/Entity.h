@@ -85,9 +85,9 @@ struct EntityVTABLE {
 	cc_bool (*ShouldRenderName)(struct Entity* e);
 };
 
-/* Skin is still being downloaded asynchronously */
+/* Skin is still being downloaded or decoded asynchronously */
 #define SKIN_FETCH_DOWNLOADING 1
-/* Skin was downloaded or copied from another entity with the same skin. */
+/* Skin was downloaded, or shared with another entity with the same skin. */
 #define SKIN_FETCH_COMPLETED   2
 
 /* true to restrict model scale (needed for local player, giant model collisions are too costly) */
@@ -116,7 +116,7 @@ struct Entity {
 	cc_bool ShouldRender;
 	struct AABB ModelAABB;
 	Vec3 ModelScale, Size;
-	int _skinReqID;
+	int _skinID; /* Index + 1 into skin cache, 0 if none */
 	
 	cc_uint8 SkinType;
 	cc_uint8 SkinFetchState;
@@ -61,15 +61,16 @@ void AnimatedComp_Update(struct Entity* e, Vec3 oldPos, Vec3 newPos, float delta
 	struct AnimatedComp* anim = &e->Anim;
 	float dx = newPos.x - oldPos.x;
 	float dz = newPos.z - oldPos.z;
-	float distance = Math_SqrtF(dx * dx + dz * dz);
+	float distSqr = dx * dx + dz * dz;
 	int i;
 
 	float walkDelta;
 	anim->WalkTimeO = anim->WalkTimeN;
 	anim->SwingO    = anim->SwingN;
 
-	if (distance > 0.05f) {
-		walkDelta = distance * 2 * (float)(20 * delta);
+	/* Most entities are standing still, so avoid the square root for them */
+	if (distSqr > 0.05f * 0.05f) {
+		walkDelta = Math_SqrtF(distSqr) * 2 * (float)(20 * delta);
 		anim->WalkTimeN += walkDelta;
 		anim->SwingN += delta * 3;
 	} else {
@@ -316,67 +317,121 @@ static void InterpComp_AdvanceRotY(struct InterpComp* interp, struct Entity* e)
 (dst).rotX  = (src)->RotX;\
 (dst).rotZ  = (src)->RotZ;
 
-static void NetInterpComp_RemoveOldestPosition(struct NetInterpComp* interp) {
-	int i;
-	interp->PositionsCount--;
-
-	for (i = 0; i < interp->PositionsCount; i++) {
-		interp->Positions[i] = interp->Positions[i + 1];
+float NetInterp_Delay = 0.1f;
+/* Movement is only extrapolated for a short time after the newest state, */
+/*  as the entity may have actually stopped moving (and so no more states are sent) */
+#define NETINTERP_MAX_EXTRAPOLATE 0.1
+/* States received after a longer gap than this likely means the entity was standing still */
+#define NETINTERP_MAX_GAP 0.25
+/* Typical time between states sent by servers */
+#define NETINTERP_STATE_INTERVAL 0.05
+/* Body rotation lags behind head rotation a tiny bit */
+#define NETINTERP_BODY_LAG 0.05
+
+static void NetInterpComp_RemoveOldestStates(struct NetInterpComp* interp, int count) {
+	interp->StatesCount -= count;
+	Mem_Move(&interp->States[0], &interp->States[count], interp->StatesCount * sizeof(struct NetInterpState));
+}
+
+static void NetInterpComp_PushState(struct NetInterpComp* interp, double time, Vec3 pos, struct NetInterpAngles angles) {
+	struct NetInterpState* state;
+	if (interp->StatesCount == Array_Elems(interp->States)) {
+		NetInterpComp_RemoveOldestStates(interp, 1);
 	}
+
+	state = &interp->States[interp->StatesCount++];
+	state->Time   = time;
+	state->Pos    = pos;
+	state->Angles = angles;
 }
 
-static void NetInterpComp_AddPosition(struct NetInterpComp* interp, Vec3 pos) {
-	if (interp->PositionsCount == Array_Elems(interp->Positions)) {
-		NetInterpComp_RemoveOldestPosition(interp);
+/* Adds the last known position and orientation as a state received at the current time */
+static void NetInterpComp_AddState(struct NetInterpComp* interp) {
+	struct NetInterpState* last;
+	
+	if (interp->StatesCount) {
+		last = &interp->States[interp->StatesCount - 1];
+
+		/* Position and orientation may be received in separate packets at the same time */
+		if (last->Time == Game.Time) {
+			last->Pos    = interp->CurPos;
+			last->Angles = interp->CurAngles;
+			return;
+		}
+
+		/* Otherwise would slowly interpolate over the whole time the entity wasn't moving */
+		if (last->Time + NETINTERP_MAX_GAP < Game.Time) {
+			NetInterpComp_PushState(interp, Game.Time - NETINTERP_STATE_INTERVAL, last->Pos, last->Angles);
+		}
 	}
-	interp->Positions[interp->PositionsCount++] = pos;
+	NetInterpComp_PushState(interp, Game.Time, interp->CurPos, interp->CurAngles);
 }
 
-static void NetInterpComp_SetPosition(struct NetInterpComp* interp, struct LocationUpdate* update, struct Entity* e, int mode) {
-	Vec3 lastPos = interp->CurPos;
-	Vec3* curPos = &interp->CurPos;
-	Vec3 midPos;
+/* Calculates the interpolated (or extrapolated) state at the given time */
+static void NetInterpComp_Sample(struct NetInterpComp* interp, double time, struct NetInterpState* dst) {
+	struct NetInterpState* a;
+	struct NetInterpState* b;
+	double extra;
+	float t;
+	int i;
 
-	if (mode == LU_POS_ABSOLUTE_INSTANT || mode == LU_POS_ABSOLUTE_SMOOTH) {
-		*curPos = update->pos;
-	} else {
-		Vec3_AddBy(curPos, &update->pos);
+	if (!interp->StatesCount) {
+		dst->Pos    = interp->CurPos;
+		dst->Angles = interp->CurAngles;
+		return;
 	}
 
-	if (mode == LU_POS_ABSOLUTE_INSTANT) {
-		e->prev.pos = *curPos;
-		e->next.pos = *curPos;
-		interp->PositionsCount = 0;
-	} else {
-		/* Smoother interpolation by also adding midpoint */
-		Vec3_Lerp(&midPos, &lastPos, curPos, 0.5f);
-		NetInterpComp_AddPosition(interp,  midPos);
-		NetInterpComp_AddPosition(interp, *curPos);
+	a = &interp->States[0];
+	if (interp->StatesCount == 1 || time <= a->Time) { *dst = *a; return; }
+
+	for (i = 1; i < interp->StatesCount - 1 && interp->States[i].Time < time; i++) { }
+	a = &interp->States[i - 1];
+	b = &interp->States[i];
+
+	/* Newest state is late, so continue the entity's movement for a bit, */
+	/*  then gradually move it back to the newest state in case it stopped */
+	if (time > b->Time) {
+		extra = time - b->Time;
+		if (extra > NETINTERP_MAX_EXTRAPOLATE) extra = 2 * NETINTERP_MAX_EXTRAPOLATE - extra;
+		if (extra < 0) extra = 0;
+		time = b->Time + extra;
 	}
+	t = (float)((time - a->Time) / (b->Time - a->Time));
+
+	Vec3_Lerp(&dst->Pos, &a->Pos, &b->Pos, t);
+	/* Rotation is not extrapolated, as that looks more wrong than being late */
+	t = min(t, 1.0f);
+
+	dst->Angles.RotX  = Math_LerpAngle(a->Angles.RotX,  b->Angles.RotX,  t);
+	dst->Angles.RotZ  = Math_LerpAngle(a->Angles.RotZ,  b->Angles.RotZ,  t);
+	dst->Angles.Pitch = Math_LerpAngle(a->Angles.Pitch, b->Angles.Pitch, t);
+	dst->Angles.Yaw   = Math_LerpAngle(a->Angles.Yaw,   b->Angles.Yaw,   t);
 }
 
-static void NetInterpComp_RemoveOldestAngles(struct NetInterpComp* interp) {
+static void NetInterpComp_SetPosition(struct NetInterpComp* interp, struct LocationUpdate* update, struct Entity* e, int mode) {
+	Vec3* curPos = &interp->CurPos;
 	int i;
-	interp->AnglesCount--;
 
-	for (i = 0; i < interp->AnglesCount; i++) {
-		interp->Angles[i] = interp->Angles[i + 1];
+	if (mode == LU_POS_ABSOLUTE_INSTANT || mode == LU_POS_ABSOLUTE_SMOOTH) {
+		*curPos = update->pos;
+	} else {
+		Vec3_AddBy(curPos, &update->pos);
 	}
-}
+	if (mode != LU_POS_ABSOLUTE_INSTANT) return;
 
-static void NetInterpComp_AddAngles(struct NetInterpComp* interp, struct NetInterpAngles angles) {
-	if (interp->AnglesCount == Array_Elems(interp->Angles)) {
-		NetInterpComp_RemoveOldestAngles(interp);
+	e->prev.pos = *curPos;
+	e->next.pos = *curPos;
+	for (i = 0; i < interp->StatesCount; i++) 
+	{
+		interp->States[i].Pos = *curPos;
 	}
-	interp->Angles[interp->AnglesCount++] = angles;
 }
 
 void NetInterpComp_SetLocation(struct NetInterpComp* interp, struct LocationUpdate* update, struct Entity* e) {
-	struct NetInterpAngles last = interp->CurAngles;
 	struct NetInterpAngles* cur = &interp->CurAngles;
-	struct NetInterpAngles mid;
 	cc_uint8 flags      = update->flags;
 	cc_bool interpolate = flags & LU_ORI_INTERPOLATE;
+	int i;
 
 	if (flags & LU_HAS_POS) {
 		NetInterpComp_SetPosition(interp, update, e, flags & LU_POS_MODEMASK);
@@ -389,36 +444,37 @@ void NetInterpComp_SetLocation(struct NetInterpComp* interp, struct LocationUpda
 	if (!interpolate) {
 		NetInterpAngles_Copy(e->prev, cur); e->prev.rotY = cur->Yaw;
 		NetInterpAngles_Copy(e->next, cur); e->next.rotY = cur->Yaw;
-		interp->RotYCount = 0; interp->AnglesCount = 0;
-	} else {
-		/* Smoother interpolation by also adding midpoint */
-		mid.RotX  = Math_LerpAngle(last.RotX,  cur->RotX,  0.5f);
-		mid.RotZ  = Math_LerpAngle(last.RotZ,  cur->RotZ,  0.5f);
-		mid.Pitch = Math_LerpAngle(last.Pitch, cur->Pitch, 0.5f);
-		mid.Yaw   = Math_LerpAngle(last.Yaw,   cur->Yaw,   0.5f);
-		NetInterpComp_AddAngles(interp, mid);
-		NetInterpComp_AddAngles(interp, *cur);
-
-		/* Body rotation lags behind head a tiny bit */
-		InterpComp_AddRotY((struct InterpComp*)interp, Math_LerpAngle(last.Yaw, cur->Yaw, 0.33333333f));
-		InterpComp_AddRotY((struct InterpComp*)interp, Math_LerpAngle(last.Yaw, cur->Yaw, 0.66666667f));
-		InterpComp_AddRotY((struct InterpComp*)interp, Math_LerpAngle(last.Yaw, cur->Yaw, 1.00000000f));
+
+		for (i = 0; i < interp->StatesCount; i++) 
+		{
+			interp->States[i].Angles = *cur;
+		}
 	}
+	NetInterpComp_AddState(interp);
 }
 
 void NetInterpComp_AdvanceState(struct NetInterpComp* interp, struct Entity* e) {
+	struct NetInterpState state;
+	double time = Game.Time - NetInterp_Delay;
+	int old;
 	e->prev     = e->next;
 	e->Position = e->prev.pos;
+	if (!interp->StatesCount) return;
 
-	if (interp->PositionsCount) {
-		e->next.pos = interp->Positions[0];
-		NetInterpComp_RemoveOldestPosition(interp);
-	}
-	if (interp->AnglesCount) {
-		NetInterpAngles_Copy(e->next, &interp->Angles[0]);
-		NetInterpComp_RemoveOldestAngles(interp);
+	/* Remove states that are no longer needed to calculate the lagging body rotation */
+	/*  (all at once, instead of shifting the remaining states along once per removed state) */
+	for (old = 0; old < interp->StatesCount - 2; old++) 
+	{
+		if (interp->States[old + 1].Time > time - NETINTERP_BODY_LAG) break;
 	}
-	InterpComp_AdvanceRotY((struct InterpComp*)interp, e);
+	if (old) NetInterpComp_RemoveOldestStates(interp, old);
+
+	NetInterpComp_Sample(interp, time, &state);
+	e->next.pos = state.Pos;
+	NetInterpAngles_Copy(e->next, &state.Angles);
+
+	NetInterpComp_Sample(interp, time - NETINTERP_BODY_LAG, &state);
+	e->next.rotY = state.Angles.Yaw;
 }
 
 
@@ -537,11 +593,11 @@ static cc_bool Collisions_CanSlideThrough(struct AABB* adjFinalBB) {
 			for (x = bbMin.x; x <= bbMax.x; x++) { v.x = (float)x;
 
 				block = World_GetPhysicsBlock(x, y, z);
-				Vec3_Add(&blockBB.Min, &v, &Blocks.MinBB[block]);
-				Vec3_Add(&blockBB.Max, &v, &Blocks.MaxBB[block]);
+				Vec3_Add(&blockBB.Min, &v, &Block_PhysInfo[block].minBB);
+				Vec3_Add(&blockBB.Max, &v, &Block_PhysInfo[block].maxBB);
 
 				if (!AABB_Intersects(&blockBB, adjFinalBB)) continue;
-				if (Blocks.Collide[block] == COLLIDE_SOLID) return false;
+				if (Block_PhysInfo[block].collide == COLLIDE_SOLID) return false;
 			}
 		}
 	}
@@ -651,8 +707,8 @@ static void Collisions_CollideWithReachableBlocks(struct CollisionsComp* comp, i
 		bPos.x = state.x >> 3; bPos.y = state.y >> 4; bPos.z = state.z >> 3;
 		block  = (state.x & 0x7) | (state.y & 0xF) << 3 | (state.z & 0x7) << 7;
 
-		Vec3_Add(&blockBB.Min, &Blocks.MinBB[block], &bPos);
-		Vec3_Add(&blockBB.Max, &Blocks.MaxBB[block], &bPos);
+		Vec3_Add(&blockBB.Min, &Block_PhysInfo[block].minBB, &bPos);
+		Vec3_Add(&blockBB.Max, &Block_PhysInfo[block].maxBB, &bPos);
 		if (!AABB_Intersects(extentBB, &blockBB)) continue;
 
 		/* Recheck time to collide with block (as colliding with blocks modifies this) */
@@ -727,7 +783,7 @@ void PhysicsComp_Init(struct PhysicsComp* comp, struct Entity* entity) {
 	comp->ServerJumpVel = 0.42f;
 }
 
-static cc_bool PhysicsComp_TouchesLiquid(BlockID block) { return Blocks.Collide[block] == COLLIDE_LIQUID; }
+static cc_bool PhysicsComp_TouchesLiquid(BlockID block) { return Block_PhysInfo[block].collide == COLLIDE_LIQUID; }
 void PhysicsComp_UpdateVelocityState(struct PhysicsComp* comp) {
 	struct Entity* entity   = comp->Entity;
 	struct HacksComp* hacks = comp->Hacks;
@@ -805,7 +861,7 @@ void PhysicsComp_DoNormalJump(struct PhysicsComp* comp) {
 	comp->CanLiquidJump = false;
 }
 
-static cc_bool PhysicsComp_TouchesSlipperyIce(BlockID b) { return Blocks.ExtendedCollide[b] == COLLIDE_SLIPPERY_ICE; }
+static cc_bool PhysicsComp_TouchesSlipperyIce(BlockID b) { return Block_PhysInfo[b].extendedCollide == COLLIDE_SLIPPERY_ICE; }
 static cc_bool PhysicsComp_OnIce(struct Entity* e) {
 	struct AABB bounds;
 	int feetX, feetY, feetZ;
@@ -816,7 +872,7 @@ static cc_bool PhysicsComp_OnIce(struct Entity* e) {
 	feetZ = Math_Floor(e->Position.z);
 
 	feetBlock = World_GetPhysicsBlock(feetX, feetY, feetZ);
-	if (Blocks.ExtendedCollide[feetBlock] == COLLIDE_ICE) return true;
+	if (Block_PhysInfo[feetBlock].extendedCollide == COLLIDE_ICE) return true;
 
 	Entity_GetBounds(e, &bounds);
 	bounds.Min.y -= 0.01f; bounds.Max.y = bounds.Min.y;
@@ -895,15 +951,15 @@ static float PhysicsComp_LowestModifier(struct PhysicsComp* comp, struct AABB* b
 				block = World_GetBlock(x, y, z);
 
 				if (block == BLOCK_AIR) continue;
-				collide = Blocks.Collide[block];
+				collide = Block_PhysInfo[block].collide;
 				if (collide == COLLIDE_SOLID && !checkSolid) continue;
 
-				Vec3_Add(&blockBB.Min, &v, &Blocks.MinBB[block]);
-				Vec3_Add(&blockBB.Max, &v, &Blocks.MaxBB[block]);
+				Vec3_Add(&blockBB.Min, &v, &Block_PhysInfo[block].minBB);
+				Vec3_Add(&blockBB.Max, &v, &Block_PhysInfo[block].maxBB);
 				if (!AABB_Intersects(&blockBB, bounds)) continue;
 
-				modifier = min(modifier, Blocks.SpeedMultiplier[block]);
-				if (Blocks.ExtendedCollide[block] == COLLIDE_LIQUID) {
+				modifier = min(modifier, Block_PhysInfo[block].speedMultiplier);
+				if (Block_PhysInfo[block].extendedCollide == COLLIDE_LIQUID) {
 					comp->UseLiquidGravity = true;
 				}
 			}
@@ -91,16 +91,23 @@ void LocalInterpComp_AdvanceState(struct InterpComp* interp, struct Entity* e);
 /* Represents a network orientation state */
 struct NetInterpAngles { float Pitch, Yaw, RotX, RotZ; };
 
+/* Represents a network position and orientation state, and when it was received */
+struct NetInterpState { double Time; Vec3 Pos; struct NetInterpAngles Angles; };
+
 /* Entity component that performs interpolation for network players */
 struct NetInterpComp {
 	InterpComp_Layout
 	/* Last known position and orientation sent by the server */
 	Vec3 CurPos; struct NetInterpAngles CurAngles;
-	/* Interpolated position and orientation state */
-	int PositionsCount, AnglesCount;
-	Vec3 Positions[10]; struct NetInterpAngles Angles[10];
+	/* Received states that are interpolated between, ordered from oldest to newest */
+	int StatesCount;
+	struct NetInterpState States[16];
 };
 
+/* How far behind (in seconds) network entities are shown compared to the newest received state */
+/* NOTE: Larger delays hide more irregular packet arrival, but increase latency */
+extern float NetInterp_Delay;
+
 void NetInterpComp_SetLocation(struct NetInterpComp* interp, struct LocationUpdate* update, struct Entity* e);
 void NetInterpComp_AdvanceState(struct NetInterpComp* interp, struct Entity* e);
 
@@ -11,6 +11,8 @@
 #include "World.h"
 #include "Particle.h"
 #include "Drawer2D.h"
+#include "Options.h"
+#include "Platform.h"
 
 /*########################################################################################################################*
 *------------------------------------------------------Entity Shadow------------------------------------------------------*
@@ -115,17 +117,36 @@ static void EntityShadow_CalcAlpha(float playerY, struct ShadowData* data) {
 	else data->y += 1.0f / 4.0f;
 }
 
-static cc_bool EntityShadow_GetBlocks(struct Entity* e, int x, int y, int z, struct ShadowData* data) {
-	struct ShadowData zeroData = { 0 };
-	struct ShadowData* cur;
-	float posY, topY;
+/* Ground underneath an entity's shadow, sampled from the blocks in one column of the world */
+struct ShadowColumn {
+	BlockID blocks[4]; float tops[4]; int count;
+	/* Top of the block in the same cell as the entity, which only casts a shadow when below the entity */
+	float coverY; cc_bool hasCover, covered;
+};
+
+/* Sampling the world is relatively slow, so columns are cached until the entity */
+/*  moves to another block or the blocks around the entity are changed */
+struct ShadowCache {
+	int x1, z1, x2, z2, y;
+	cc_uint8 mode;
+	cc_uint32 stamp, generation;
+	struct ShadowColumn columns[4];
+};
+/* Slot for every entity, plus one extra for the current player */
+static struct ShadowCache shadow_caches[ENTITIES_MAX_COUNT + 1];
+/* Incremented to invalidate all cached columns (starts at 1 so zeroed caches are invalid) */
+static cc_uint32 shadow_generation = 1;
+
+static cc_bool EntityShadow_IsCovered(float topY, float posY) { return topY >= posY + 0.01f; }
+
+static void EntityShadow_SampleColumn(struct ShadowColumn* col, int x, int y, int z, float posY) {
+	float topY;
 	cc_bool outside;
 	BlockID block; cc_uint8 draw;
-	int i;
+	int i, top = y;
 
-	for (i = 0; i < 4; i++) { data[i] = zeroData; }
-	cur     = data;
-	posY    = e->Position.y;
+	col->count    = 0;
+	col->hasCover = false;
 	outside = !World_ContainsXZ(x, z);
 
 	for (i = 0; y >= 0 && i < 4; y--) 
@@ -143,33 +164,117 @@ static cc_bool EntityShadow_GetBlocks(struct Entity* e, int x, int y, int z, str
 		draw = Blocks.Draw[block];
 		if (draw == DRAW_GAS || draw == DRAW_SPRITE || Blocks.IsLiquid[block]) continue;
 		topY = y + Blocks.MaxBB[block].y;
-		if (topY >= posY + 0.01f) continue;
 
-		cur->block = block; cur->y = topY;
-		EntityShadow_CalcAlpha(posY, cur);
-		i++; cur++;
+		/* Only a block in the entity's own cell can be above the entity */
+		if (y == top) {
+			col->coverY   = topY;
+			col->hasCover = true;
+			col->covered  = EntityShadow_IsCovered(topY, posY);
+			if (col->covered) continue;
+		}
+
+		col->blocks[i] = block; col->tops[i] = topY;
+		i++; col->count = i;
 
 		/* Check if the casted shadow will continue on further down. */
 		if (Blocks.MinBB[block].x == 0.0f && Blocks.MaxBB[block].x == 1.0f &&
-			Blocks.MinBB[block].z == 0.0f && Blocks.MaxBB[block].z == 1.0f) return true;
+			Blocks.MinBB[block].z == 0.0f && Blocks.MaxBB[block].z == 1.0f) return;
 	}
 
 	if (i < 4) {
-		cur->block = Env.EdgeBlock; cur->y = 0.0f;
-		EntityShadow_CalcAlpha(posY, cur);
-		i++; cur++;
+		col->blocks[i] = Env.EdgeBlock; col->tops[i] = 0.0f;
+		col->count = i + 1;
 	}
-	return true;
 }
 
-static void EntityShadow_Draw(struct Entity* e) {
-	struct VertexTextured vertices[128]; /* TODO this is less than maxVertes */
+/* Whether the cached column is still the same for the entity's current height */
+static cc_bool EntityShadow_ColumnValid(struct ShadowColumn* col, float posY) {
+	return !col->hasCover || EntityShadow_IsCovered(col->coverY, posY) == col->covered;
+}
+
+static void EntityShadow_GetBlocks(struct ShadowColumn* col, float posY, struct ShadowData* data) {
+	struct ShadowData zeroData = { 0 };
+	int i;
+
+	for (i = 0; i < 4; i++) 
+	{
+		data[i] = zeroData;
+		if (i >= col->count) continue;
+
+		data[i].block = col->blocks[i];
+		data[i].y     = col->tops[i];
+		EntityShadow_CalcAlpha(posY, &data[i]);
+	}
+}
+
+/* Returns the cached ground underneath the given entity, resampling the world if it is out of date */
+static struct ShadowCache* EntityShadow_GetCache(int id, struct Entity* e, int x1, int z1, int x2, int z2, int y) {
+	struct ShadowCache* cache = &shadow_caches[id];
+	float posY = e->Position.y;
+	cc_uint32 stamp;
+	cc_bool valid;
+	int i;
+
+	/* Ground columns below the entity change whenever a block in them does */
+	stamp = World_GetVersionStamp(x1, 0, z1, x2, y, z2);
+	valid = cache->generation == shadow_generation && cache->stamp == stamp && 
+		cache->mode == Entities.ShadowsMode && cache->y == y &&
+		cache->x1 == x1 && cache->z1 == z1 && cache->x2 == x2 && cache->z2 == z2;
+
+	for (i = 0; valid && i < 4; i++)
+	{
+		valid = EntityShadow_ColumnValid(&cache->columns[i], posY);
+	}
+	if (valid) return cache;
+
+	cache->generation = shadow_generation;
+	cache->stamp = stamp;
+	cache->mode  = Entities.ShadowsMode;
+	cache->y     = y;
+	cache->x1 = x1; cache->z1 = z1; cache->x2 = x2; cache->z2 = z2;
+
+	for (i = 0; i < 4; i++)
+	{
+		cache->columns[i].count    = 0;
+		cache->columns[i].hasCover = false;
+	}
+
+	/* Shadow only overlaps the neighbouring columns when it crosses a block boundary */
+	EntityShadow_SampleColumn(&cache->columns[0], x1, y, z1, posY);
+	if (x1 != x2)
+		EntityShadow_SampleColumn(&cache->columns[1], x2, y, z1, posY);
+	if (z1 != z2)
+		EntityShadow_SampleColumn(&cache->columns[2], x1, y, z2, posY);
+	if (x1 != x2 && z1 != z2) 
+		EntityShadow_SampleColumn(&cache->columns[3], x2, y, z2, posY);
+	return cache;
+}
+
+/* Shadows are drawn in batches, since they all use the same texture */
+#define SHADOWS_MAX_BATCH (16 * SHADOW_MAX_VERTS)
+static struct VertexTextured shadows_vertices[SHADOWS_MAX_BATCH];
+static int shadows_count;
+
+static void FlushShadows(void) {
+	if (!shadows_count) return;
+	if (!shadows_VB)
+		shadows_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, SHADOWS_MAX_BATCH);
+
+	if (!shadows_boundTex) {
+		Gfx_BindTexture(shadows_tex);
+		shadows_boundTex = true;
+	}
+	Gfx_DrawDynamicVb_IndexedTris(shadows_VB, shadows_vertices, shadows_count);
+	shadows_count = 0;
+}
+
+static void EntityShadow_Draw(int id, struct Entity* e) {
 	struct VertexTextured* ptr;
+	struct ShadowCache* cache;
 	struct ShadowData data[4];
 	Vec3 pos;
 	float radius;
-	int y, count;
-	int x1, z1, x2, z2;
+	int y, x1, z1, x2, z2;
 
 	pos = e->Position;
 	if (pos.y < 0.0f) return;
@@ -179,40 +284,43 @@ static void EntityShadow_Draw(struct Entity* e) {
 	shadow_radius  = radius / 16.0f;
 	shadow_uvScale = 16.0f / (radius * 2.0f);
 
-	ptr = vertices;
 	if (Entities.ShadowsMode == SHADOW_MODE_SNAP_TO_BLOCK) {
 		x1 = Math_Floor(pos.x); z1 = Math_Floor(pos.z);
-		if (!EntityShadow_GetBlocks(e, x1, y, z1, data)) return;
-
-		EntityShadow_DrawSquareShadow(&ptr, data[0].y, x1, z1);
+		x2 = x1; z2 = z1;
 	} else {
 		x1 = Math_Floor(pos.x - shadow_radius); z1 = Math_Floor(pos.z - shadow_radius);
 		x2 = Math_Floor(pos.x + shadow_radius); z2 = Math_Floor(pos.z + shadow_radius);
+	}
 
-		if (EntityShadow_GetBlocks(e, x1, y, z1, data) && data[0].alpha > 0) {
+	cache = EntityShadow_GetCache(id, e, x1, z1, x2, z2, y);
+	if (shadows_count + SHADOW_MAX_VERTS > SHADOWS_MAX_BATCH) FlushShadows();
+	ptr = shadows_vertices + shadows_count;
+
+	if (Entities.ShadowsMode == SHADOW_MODE_SNAP_TO_BLOCK) {
+		EntityShadow_GetBlocks(&cache->columns[0], pos.y, data);
+		EntityShadow_DrawSquareShadow(&ptr, data[0].y, x1, z1);
+	} else {
+		EntityShadow_GetBlocks(&cache->columns[0], pos.y, data);
+		if (data[0].alpha > 0) {
 			EntityShadow_DrawCircle(&ptr, e, data, (float)x1, (float)z1);
 		}
-		if (x1 != x2 && EntityShadow_GetBlocks(e, x2, y, z1, data) && data[0].alpha > 0) {
+
+		EntityShadow_GetBlocks(&cache->columns[1], pos.y, data);
+		if (x1 != x2 && data[0].alpha > 0) {
 			EntityShadow_DrawCircle(&ptr, e, data, (float)x2, (float)z1);
 		}
-		if (z1 != z2 && EntityShadow_GetBlocks(e, x1, y, z2, data) && data[0].alpha > 0) {
+
+		EntityShadow_GetBlocks(&cache->columns[2], pos.y, data);
+		if (z1 != z2 && data[0].alpha > 0) {
 			EntityShadow_DrawCircle(&ptr, e, data, (float)x1, (float)z2);
 		}
-		if (x1 != x2 && z1 != z2 && EntityShadow_GetBlocks(e, x2, y, z2, data) && data[0].alpha > 0) {
+
+		EntityShadow_GetBlocks(&cache->columns[3], pos.y, data);
+		if (x1 != x2 && z1 != z2 && data[0].alpha > 0) {
 			EntityShadow_DrawCircle(&ptr, e, data, (float)x2, (float)z2);
 		}
 	}
-
-	if (ptr == vertices) return;
-
-	if (!shadows_boundTex) {
-		Gfx_BindTexture(shadows_tex);
-		shadows_boundTex = true;
-	}
-
-	count = (int)(ptr - vertices);
-	Gfx_SetDynamicVbData(shadows_VB, vertices, count);
-	Gfx_DrawVb_IndexedTris(count);
+	shadows_count = (int)(ptr - shadows_vertices);
 }
 
 
@@ -250,24 +358,23 @@ void EntityShadows_Render(void) {
 	shadows_boundTex = false;
 	if (!shadows_tex) 
 		EntityShadows_MakeTexture();
-	if (!shadows_VB)
-		shadows_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, SHADOW_MAX_VERTS);
 
 	Gfx_SetAlphaArgBlend(true);
 	Gfx_SetDepthWrite(false);
 	Gfx_SetAlphaBlending(true);
 
 	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
-	EntityShadow_Draw(&Entities.CurPlayer->Base);
+	EntityShadow_Draw(ENTITIES_MAX_COUNT, &Entities.CurPlayer->Base);
 
 	if (Entities.ShadowsMode == SHADOW_MODE_CIRCLE_ALL) {	
 		for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
 		{
 			e = Entities.List[i];
 			if (!e || !e->ShouldRender || e == &Entities.CurPlayer->Base) continue;
-			EntityShadow_Draw(e);
+			EntityShadow_Draw(i, e);
 		}
 	}
+	FlushShadows();
 
 	Gfx_SetAlphaArgBlend(false);
 	Gfx_SetDepthWrite(true);
@@ -282,6 +389,72 @@ static GfxResourceID names_VB;
 #define NAME_IS_EMPTY -30000
 #define NAME_OFFSET 3 /* offset of back layer of name above an entity */
 
+/* Name textures are packed into rows of a shared atlas, so that many names can be drawn with one texture */
+#define NAMES_ATLAS_WIDTH  1024
+#define NAMES_ATLAS_HEIGHT 1024
+static GfxResourceID names_atlas;
+static int names_atlasX, names_atlasY, names_rowHeight;
+/* Whether the atlas has already been cleared this frame (to avoid repeatedly clearing it) */
+static cc_bool names_atlasCleared;
+
+static void NameAtlas_Reset(void) {
+	names_atlasX    = 0; names_atlasY = 0;
+	names_rowHeight = 0;
+}
+
+static cc_bool NameAtlas_Create(void) {
+	struct Bitmap bmp;
+	if (Gfx.NoUVSupport) return false;
+	if (Gfx.MaxTexWidth  && Gfx.MaxTexWidth  < NAMES_ATLAS_WIDTH)  return false;
+	if (Gfx.MaxTexHeight && Gfx.MaxTexHeight < NAMES_ATLAS_HEIGHT) return false;
+
+	bmp.scan0 = (BitmapCol*)Mem_TryAllocCleared(NAMES_ATLAS_WIDTH * NAMES_ATLAS_HEIGHT, BITMAPCOLOR_SIZE);
+	if (!bmp.scan0) return false;
+	bmp.width = NAMES_ATLAS_WIDTH; bmp.height = NAMES_ATLAS_HEIGHT;
+
+	names_atlas = Gfx_CreateTexture(&bmp, TEXTURE_FLAG_DYNAMIC | TEXTURE_FLAG_LOWRES, false);
+	Mem_Free(bmp.scan0);
+	NameAtlas_Reset();
+	return names_atlas != 0;
+}
+
+static void NameAtlas_Clear(void);
+/* Attempts to copy the given name texture into the atlas */
+static cc_bool NameAtlas_Add(struct Entity* e, struct Context2D* ctx) {
+	struct Bitmap part;
+	int width = ctx->width, height = ctx->height;
+	if (width > NAMES_ATLAS_WIDTH || height > NAMES_ATLAS_HEIGHT) return false;
+	if (!names_atlas && !NameAtlas_Create()) return false;
+
+	/* Start a new row when this row is full */
+	if (names_atlasX + width > NAMES_ATLAS_WIDTH) {
+		names_atlasX    = 0;
+		names_atlasY   += names_rowHeight;
+		names_rowHeight = 0;
+	}
+
+	/* When the atlas is full, evict all the names in it (at most once per frame though) */
+	if (names_atlasY + height > NAMES_ATLAS_HEIGHT) {
+		if (names_atlasCleared) return false;
+		NameAtlas_Clear();
+	}
+
+	Bitmap_Init(part, width, height, ctx->bmp.scan0);
+	Gfx_UpdateTexture(names_atlas, names_atlasX, names_atlasY, &part, ctx->bmp.width, false);
+
+	e->NameTex.ID     = names_atlas;
+	e->NameTex.width  = width;
+	e->NameTex.height = height;
+	e->NameTex.uv.u1  = (float)names_atlasX / NAMES_ATLAS_WIDTH;
+	e->NameTex.uv.v1  = (float)names_atlasY / NAMES_ATLAS_HEIGHT;
+	e->NameTex.uv.u2  = (float)(names_atlasX + width)  / NAMES_ATLAS_WIDTH;
+	e->NameTex.uv.v2  = (float)(names_atlasY + height) / NAMES_ATLAS_HEIGHT;
+
+	names_atlasX   += width;
+	names_rowHeight = max(names_rowHeight, height);
+	return true;
+}
+
 static void MakeNameTexture(struct Entity* e) {
 	cc_string colorlessName; char colorlessBuffer[STRING_SIZE];
 	BitmapCol shadowColor = BitmapCol_Make(80, 80, 80, 255);
@@ -323,26 +496,41 @@ static void MakeNameTexture(struct Entity* e) {
 			args.text = name;
 			Context2D_DrawText(&ctx, &args, 0, 0);
 		}
-		Context2D_MakeTexture(&e->NameTex, &ctx);
+
+		if (!NameAtlas_Add(e, &ctx)) Context2D_MakeTexture(&e->NameTex, &ctx);
 		Context2D_Free(&ctx);
 	}
 }
 
+/* Names are drawn in batches of consecutive names that use the same texture */
+#define NAMES_MAX_BATCH 64
+static struct VertexTextured names_vertices[NAMES_MAX_BATCH * 4];
+static int names_batchCount;
+static GfxResourceID names_batchTex;
+
+static void FlushNames(void) {
+	if (!names_batchCount) return;
+	if (!names_VB)
+		names_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, NAMES_MAX_BATCH * 4);
+
+	Gfx_BindTexture(names_batchTex);
+	Gfx_DrawDynamicVb_IndexedTris(names_VB, names_vertices, names_batchCount * 4);
+	names_batchCount = 0;
+}
+
 static void DrawName(struct Entity* e) {
-	struct VertexTextured* vertices;
 	struct Model* model;
 	struct Matrix mat, transform;
 	Vec3 pos;
 	float scale;
 	Vec2 size;
 
-	if (!e->VTABLE->ShouldRenderName(e)) return;
-	if (e->NameTex.x == NAME_IS_EMPTY)   return;
-	if (!e->NameTex.ID) MakeNameTexture(e);
-	Gfx_BindTexture(e->NameTex.ID);
-
-	if (!names_VB)
-		names_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, 4);
+	if (!e->NameTex.ID) {
+		/* The atlas may get cleared, so draw any names that are still using it first */
+		FlushNames();
+		MakeNameTexture(e);
+		if (e->NameTex.x == NAME_IS_EMPTY) return;
+	}
 
 	model = e->Model;
 	Model_GetEntityTransform(model, e, &transform);
@@ -359,25 +547,89 @@ static void DrawName(struct Entity* e) {
 		size.x *= scale * 0.2f; size.y *= scale * 0.2f;
 	}
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
-
-	vertices = (struct VertexTextured*)Gfx_LockDynamicVb(names_VB, VERTEX_FORMAT_TEXTURED, 4);
-	Particle_DoRender(&size, &pos, &e->NameTex.uv, PACKEDCOL_WHITE, vertices);
-	Gfx_UnlockDynamicVb(names_VB);
+	if (e->NameTex.ID != names_batchTex || names_batchCount == NAMES_MAX_BATCH) {
+		FlushNames();
+		names_batchTex = e->NameTex.ID;
+	}
 
-	Gfx_DrawVb_IndexedTris(4);
+	Particle_DoRender(&size, &pos, &e->NameTex.uv, PACKEDCOL_WHITE, &names_vertices[names_batchCount * 4]);
+	names_batchCount++;
 }
 
 void EntityNames_Delete(struct Entity* e) {
-	Gfx_DeleteTexture(&e->NameTex.ID);
+	/* Names in the atlas are only freed once the whole atlas is cleared */
+	if (names_atlas && e->NameTex.ID == names_atlas) {
+		e->NameTex.ID = 0;
+	} else {
+		Gfx_DeleteTexture(&e->NameTex.ID);
+	}
 	e->NameTex.x = 0; /* X is used as an 'empty name' flag */
 }
 
+static void NameAtlas_Clear(void) {
+	struct Entity* e;
+	int i;
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	{
+		e = Entities.List[i];
+		if (e && e->NameTex.ID == names_atlas) e->NameTex.ID = 0;
+	}
+
+	NameAtlas_Reset();
+	names_atlasCleared = true;
+}
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------Names rendering-----------------------------------------------------*
 *#########################################################################################################################*/
 static int closestEntityId;
+/* Squared distance beyond which name tags are not drawn (0 for no limit) */
+static float names_maxDistSqr;
+
+struct NameEntry { struct Entity* e; float dist; };
+static struct NameEntry names_list[ENTITIES_MAX_COUNT];
+static int names_count;
+
+static void AddName(struct Entity* e) {
+	float dist;
+	if (!e->VTABLE->ShouldRenderName(e)) return;
+	if (e->NameTex.x == NAME_IS_EMPTY)   return;
+
+	dist = Model_RenderDistance(e);
+	if (names_maxDistSqr && dist > names_maxDistSqr) return;
+
+	names_list[names_count].e    = e;
+	names_list[names_count].dist = dist;
+	names_count++;
+}
+
+/* Draws all the added names from furthest to closest, so that closer names are drawn on top */
+static void DrawNames(void) {
+	struct NameEntry entry;
+	int i, j;
+
+	for (i = 1; i < names_count; i++)
+	{
+		entry = names_list[i];
+		for (j = i - 1; j >= 0 && names_list[j].dist < entry.dist; j--)
+		{
+			names_list[j + 1] = names_list[j];
+		}
+		names_list[j + 1] = entry;
+	}
+
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	names_atlasCleared = false;
+
+	for (i = 0; i < names_count; i++)
+	{
+		DrawName(names_list[i].e);
+	}
+	FlushNames();
+	names_batchTex = 0;
+	names_count    = 0;
+}
 
 void EntityNames_Render(void) {
 	struct LocalPlayer* p = Entities.CurPlayer;
@@ -388,15 +640,18 @@ void EntityNames_Render(void) {
 	closestEntityId = Entities_GetClosest(&p->Base);
 	if (!p->Hacks.CanSeeAllNames || Entities.NamesMode != NAME_MODE_ALL) return;
 
-	Gfx_SetAlphaTest(true);
-	hadFog = Gfx_GetFog();
-	if (hadFog) Gfx_SetFog(false);
-
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
 	{
 		if (!Entities.List[i]) continue;
-		if (i != closestEntityId) DrawName(Entities.List[i]);
+		if (i != closestEntityId) AddName(Entities.List[i]);
 	}
+	if (!names_count) return;
+
+	Gfx_SetAlphaTest(true);
+	hadFog = Gfx_GetFog();
+	if (hadFog) Gfx_SetFog(false);
+
+	DrawNames();
 
 	Gfx_SetAlphaTest(false);
 	if (hadFog) Gfx_SetFog(true);
@@ -406,7 +661,6 @@ void EntityNames_RenderHovered(void) {
 	struct LocalPlayer* p = Entities.CurPlayer;
 	struct Entity* e;
 	cc_bool allNames, hadFog;
-	cc_bool setupState = false;
 	int i;
 
 	if (Entities.NamesMode == NAME_MODE_NONE) return;
@@ -418,21 +672,19 @@ void EntityNames_RenderHovered(void) {
 		e = Entities.List[i];
 		if (!e || e == &p->Base) continue;
 		if (!allNames && i != closestEntityId) continue;
+		AddName(e);
+	}
 
-		/* Only alter the GPU state when actually necessary */
-		if (!setupState) {
-			Gfx_SetAlphaTest(true);
-			Gfx_SetDepthTest(false);
-			Gfx_SetDepthWrite(false);
+	/* Only alter the GPU state when actually necessary */
+	if (!names_count) return;
+	Gfx_SetAlphaTest(true);
+	Gfx_SetDepthTest(false);
+	Gfx_SetDepthWrite(false);
+	hadFog = Gfx_GetFog();
+	if (hadFog) Gfx_SetFog(false);
 
-			setupState = true;
-			hadFog = Gfx_GetFog();
-			if (hadFog) Gfx_SetFog(false);
-		}
-		DrawName(e);
-	}
+	DrawNames();
 
-	if (!setupState) return;
 	Gfx_SetAlphaTest(false);
 	Gfx_SetDepthTest(true);
 	Gfx_SetDepthWrite(true);
@@ -446,6 +698,7 @@ static void DeleteAllNameTextures(void) {
 		if (!Entities.List[i]) continue;
 		EntityNames_Delete(Entities.List[i]);
 	}
+	NameAtlas_Reset();
 }
 
 static void EntityNames_ChatFontChanged(void* obj) {
@@ -462,11 +715,22 @@ static void EntityRenderers_ContextLost(void* obj) {
 	
 	Gfx_DeleteDynamicVb(&names_VB);
 	DeleteAllNameTextures();
+	Gfx_DeleteTexture(&names_atlas);
 }
 
+static void EntityShadows_Invalidate(void* obj) { shadow_generation++; }
+static void EntityShadows_EnvVarChanged(void* obj, int envVar) { shadow_generation++; }
+static void EntityRenderers_OnNewMap(void) { shadow_generation++; }
+
 static void EntityRenderers_Init(void) {
+	names_maxDistSqr = (float)Options_GetInt(OPT_NAMES_DISTANCE, 0, 8192, 0);
+	names_maxDistSqr *= names_maxDistSqr;
+
 	Event_Register_(&GfxEvents.ContextLost,  NULL, EntityRenderers_ContextLost);
 	Event_Register_(&ChatEvents.FontChanged, NULL, EntityNames_ChatFontChanged);
+
+	Event_Register_(&BlockEvents.BlockDefChanged, NULL, EntityShadows_Invalidate);
+	Event_Register_(&WorldEvents.EnvVarChanged,   NULL, EntityShadows_EnvVarChanged);
 }
 
 static void EntityRenderers_Free(void) {
@@ -475,5 +739,7 @@ static void EntityRenderers_Free(void) {
 
 struct IGameComponent EntityRenderers_Component = {
 	EntityRenderers_Init,  /* Init  */
-	EntityRenderers_Free   /* Free  */
+	EntityRenderers_Free,  /* Free  */
+	NULL,                  /* Reset */
+	EntityRenderers_OnNewMap /* OnNewMap */
 };
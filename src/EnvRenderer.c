@@ -19,6 +19,7 @@
 #include "Particle.h"
 #include "Options.h"
 #include "Entity.h"
+#include "Lighting.h"
 
 cc_bool EnvRenderer_Legacy, EnvRenderer_Minimal;
 
@@ -36,6 +37,32 @@ static int CalcNumVertices(int axis1Len, int axis2Len) {
 	return Math_CeilDiv(axis1Len, axisSize) * Math_CeilDiv(axis2Len, axisSize) * 4;
 }
 
+/* Returns the half size of the fixed size meshes that follow the camera (clouds and sky) */
+/* NOTE: One extra tile is needed, as the mesh only moves along with the camera in whole tiles */
+static int CalcCameraExtent(void) {
+	int axisSize = EnvRenderer_AxisSize();
+	int extent   = Utils_AdjViewDist(Game_ViewDistance);
+	return (Math_CeilDiv(extent, axisSize) + 1) * axisSize;
+}
+
+/* Rounds the given coordinate down to the nearest multiple of the tile size */
+static int SnapToTile(float coord) {
+	int axisSize = EnvRenderer_AxisSize();
+	return Math_Floor(coord / axisSize) * axisSize;
+}
+
+/* Loads the view matrix, after first translating by the given amount */
+/* NOTE: Caller must restore the original view matrix after drawing */
+static void LoadTranslatedView(float x, float y, float z) {
+	struct Matrix m = Gfx.View;
+	/* inlined translation matrix multiply */
+	m.row4.x += x * m.row1.x + y * m.row2.x + z * m.row3.x;
+	m.row4.y += x * m.row1.y + y * m.row2.y + z * m.row3.y;
+	m.row4.z += x * m.row1.z + y * m.row2.z + z * m.row3.z;
+	m.row4.w += x * m.row1.w + y * m.row2.w + z * m.row3.w;
+	Gfx_LoadMatrix(MATRIX_VIEW, &m);
+}
+
 
 /*########################################################################################################################*
 *------------------------------------------------------------Fog----------------------------------------------------------*
@@ -135,16 +162,28 @@ static GfxResourceID clouds_vb, clouds_tex;
 static int clouds_vertices;
 
 void EnvRenderer_RenderClouds(void) {
-	float offset;
+	float offset, u, v;
+	int x, z;
 	if (!clouds_vb || Env.CloudsHeight < -2000) return;
 	offset = (float)(Game.Time / 2048.0f * 0.6f * Env.CloudsSpeed);
 
-	Gfx_EnableTextureOffset(offset, 0);
+	/* Mesh is centred on the camera, so shift the texture by the same amount */
+	/*  to keep clouds fixed in world space (clouds texture repeats every 2048 blocks) */
+	x = SnapToTile(Camera.CurrentPos.x);
+	z = SnapToTile(Camera.CurrentPos.z);
+	u = (float)(x & 2047) / 2048.0f;
+	v = (float)(z & 2047) / 2048.0f;
+
+	Gfx_EnableTextureOffset(offset + u, v);
 	Gfx_SetAlphaTest(true);
 	Gfx_BindTexture(clouds_tex);
 	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
 	Gfx_BindVb(clouds_vb);
+
+	LoadTranslatedView((float)x, (float)Env.CloudsHeight, (float)z);
 	Gfx_DrawVb_IndexedTris(clouds_vertices);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+
 	Gfx_SetAlphaTest(false);
 	Gfx_DisableTextureOffset();
 }
@@ -176,23 +215,36 @@ static void DrawCloudsY(int x1, int z1, int x2, int z2, int y, struct VertexText
 	}
 }
 
+/* Clouds mesh is built at y = 0 and centred on the origin, then moved in RenderClouds */
+/* NOTE: Only the view distance, render mode, and cloud colour affect the mesh */
 static void UpdateClouds(void) {
 	struct VertexTextured* data;
 	int extent;
-	int x1, z1, x2, z2;
 	
 	Gfx_DeleteVb(&clouds_vb);
 	if (!World.Loaded || Gfx.LostContext) return;
 	if (EnvRenderer_Minimal) return;
 
-	extent = Utils_AdjViewDist(Game_ViewDistance);
-	x1 = -extent; x2 = World.Width  + extent;
-	z1 = -extent; z2 = World.Length + extent;
-	clouds_vertices = CalcNumVertices(x2 - x1, z2 - z1);
+	extent = CalcCameraExtent();
+	clouds_vertices = CalcNumVertices(extent * 2, extent * 2);
 
 	data = (struct VertexTextured*)Gfx_RecreateAndLockVb(&clouds_vb,
 										VERTEX_FORMAT_TEXTURED, clouds_vertices);
-	DrawCloudsY(x1, z1, x2, z2, Env.CloudsHeight, data);
+	DrawCloudsY(-extent, -extent, extent, extent, 0, data);
+	Gfx_UnlockVb(clouds_vb);
+}
+
+/* Overwrites the contents of the existing clouds mesh (e.g. cloud colour changed) */
+static void RecolorClouds(void) {
+	struct VertexTextured* data;
+	int extent;
+	if (!clouds_vb) { UpdateClouds(); return; }
+
+	extent = CalcCameraExtent();
+	Gfx_BindVb(clouds_vb);
+	data = (struct VertexTextured*)Gfx_LockVb(clouds_vb,
+										VERTEX_FORMAT_TEXTURED, clouds_vertices);
+	DrawCloudsY(-extent, -extent, extent, extent, 0, data);
 	Gfx_UnlockVb(clouds_vb);
 }
 
@@ -204,28 +256,22 @@ static GfxResourceID sky_vb;
 static int sky_vertices;
 
 void EnvRenderer_RenderSky(void) {
-	struct Matrix m;
-	float skyY, normY, dy;
+	float skyY, normY, height;
+	int x, z;
 	if (!sky_vb || EnvRenderer_ShouldRenderSkybox()) return;
 
-	normY = (float)World.Height + 8.0f;
-	skyY  = max(Camera.CurrentPos.y + 8.0f, normY);
+	normY  = (float)World.Height + 8.0f;
+	skyY   = max(Camera.CurrentPos.y + 8.0f, normY);
+	height = (float)(max((World.Height + 2), Env.CloudsHeight) + 6);
+
+	x = SnapToTile(Camera.CurrentPos.x);
+	z = SnapToTile(Camera.CurrentPos.z);
 	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
 	Gfx_BindVb(sky_vb);
 
-	if (skyY == normY) {
-		Gfx_DrawVb_IndexedTris(sky_vertices);
-	} else {
-		m  = Gfx.View;
-		dy = skyY - normY; 
-		/* inlined Y translation matrix multiply */
-		m.row4.x += dy * m.row2.x; m.row4.y += dy * m.row2.y;
-		m.row4.z += dy * m.row2.z; m.row4.w += dy * m.row2.w;
-
-		Gfx_LoadMatrix(MATRIX_VIEW, &m);
-		Gfx_DrawVb_IndexedTris(sky_vertices);
-		Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
-	}
+	LoadTranslatedView((float)x, height + (skyY - normY), (float)z);
+	Gfx_DrawVb_IndexedTris(sky_vertices);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
 }
 
 static void DrawSkyY(int x1, int z1, int x2, int z2, int y, struct VertexColoured* v) {
@@ -248,24 +294,36 @@ static void DrawSkyY(int x1, int z1, int x2, int z2, int y, struct VertexColoure
 	}
 }
 
+/* Sky mesh is built at y = 0 and centred on the origin, then moved in RenderSky */
+/* NOTE: Only the view distance, render mode, and sky colour affect the mesh */
 static void UpdateSky(void) {
 	struct VertexColoured* data;
-	int extent, height;
-	int x1, z1, x2, z2;
+	int extent;
 
 	Gfx_DeleteVb(&sky_vb);
 	if (!World.Loaded || Gfx.LostContext) return;
 	if (EnvRenderer_Minimal) return;
 
-	extent = Utils_AdjViewDist(Game_ViewDistance);
-	x1 = -extent; x2 = World.Width  + extent;
-	z1 = -extent; z2 = World.Length + extent;
-	sky_vertices = CalcNumVertices(x2 - x1, z2 - z1);
+	extent = CalcCameraExtent();
+	sky_vertices = CalcNumVertices(extent * 2, extent * 2);
 
-	data   = (struct VertexColoured*)Gfx_RecreateAndLockVb(&sky_vb,
+	data = (struct VertexColoured*)Gfx_RecreateAndLockVb(&sky_vb,
 										VERTEX_FORMAT_COLOURED, sky_vertices);
-	height = max((World.Height + 2), Env.CloudsHeight) + 6;
-	DrawSkyY(x1, z1, x2, z2, height, data);
+	DrawSkyY(-extent, -extent, extent, extent, 0, data);
+	Gfx_UnlockVb(sky_vb);
+}
+
+/* Overwrites the contents of the existing sky mesh (e.g. sky colour changed) */
+static void RecolorSky(void) {
+	struct VertexColoured* data;
+	int extent;
+	if (!sky_vb) { UpdateSky(); return; }
+
+	extent = CalcCameraExtent();
+	Gfx_BindVb(sky_vb);
+	data = (struct VertexColoured*)Gfx_LockVb(sky_vb,
+										VERTEX_FORMAT_COLOURED, sky_vertices);
+	DrawSkyY(-extent, -extent, extent, extent, 0, data);
 	Gfx_UnlockVb(sky_vb);
 }
 
@@ -307,6 +365,22 @@ static void AllocateSkyboxVB(void) {
 	Gfx_UnlockVb(skybox_vb);
 }
 
+#ifdef ENVRENDERER_SKYBOX_AFTER_MAP
+/* Loads a projection matrix that places everything exactly at the far plane */
+static void LoadFarPlaneProjection(void) {
+	struct Matrix proj = Gfx.Projection;
+	float depth;
+
+	/* Depth at infinity is always just past the far plane, so round it to get */
+	/*  the far plane depth (which is 0 instead of 1 for a reversed depth buffer) */
+	depth = (proj.row3.z / proj.row3.w) >= 0.5f ? 1.0f : 0.0f;
+
+	proj.row1.z = proj.row1.w * depth; proj.row2.z = proj.row2.w * depth;
+	proj.row3.z = proj.row3.w * depth; proj.row4.z = proj.row4.w * depth;
+	Gfx_LoadMatrix(MATRIX_PROJ, &proj);
+}
+#endif
+
 void EnvRenderer_RenderSkybox(void) {
 	struct Matrix m, rotX, rotY, view;
 	float rotTime;
@@ -331,10 +405,16 @@ void EnvRenderer_RenderSkybox(void) {
 	Camera.CurrentPos = pos;
 
 	Gfx_LoadMatrix(MATRIX_VIEW, &m);
+#ifdef ENVRENDERER_SKYBOX_AFTER_MAP
+	LoadFarPlaneProjection();
+#endif
 	Gfx_BindVb(skybox_vb);
 	Gfx_DrawVb_IndexedTris(SKYBOX_COUNT);
 
 	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+#ifdef ENVRENDERER_SKYBOX_AFTER_MAP
+	Gfx_LoadMatrix(MATRIX_PROJ, &Gfx.Projection);
+#endif
 	Gfx_SetDepthWrite(true);
 }
 
@@ -351,16 +431,9 @@ static IVec3 lastPos;
 #define WEATHER_RANGE  (WEATHER_EXTENT * 2 + 1)
 
 #define WEATHER_VERTS_COUNT WEATHER_RANGE * WEATHER_RANGE * WEATHER_VERTS
-#define Weather_Pack(x, z) ((x) * World.Length + (z))
-
-static void InitWeatherHeightmap(void) {
-	int i;
-	Weather_Heightmap = (cc_int16*)Mem_Alloc(World.Width * World.Length, 2, "weather heightmap");
-	
-	for (i = 0; i < World.Width * World.Length; i++) {
-		Weather_Heightmap[i] = Int16_MaxValue;
-	}
-}
+/* NOTE: Same layout as a horizontal layer of World.Blocks, so rows can be calculated in bulk */
+#define Weather_Pack(x, z) ((z) * World.Width + (x))
+#define WEATHER_UNCALCULATED Int16_MaxValue
 
 #define RainCalcBody(get_block)\
 for (y = maxY; y >= 0; y--, i -= World.OneY) {\
@@ -382,7 +455,7 @@ static int CalcRainHeightAt(int x, int maxY, int z, int hIndex) {
 	if (World.IDMask <= 0xFF) {
 		RainCalcBody(World.Blocks[i]);
 	} else {
-		RainCalcBody(World.Blocks[i] | (World.Blocks2[i] << 8));
+		RainCalcBody(World.Blocks[i] | (World_GetUpperBlock(i) << 8));
 	}
 #endif
 
@@ -390,15 +463,90 @@ static int CalcRainHeightAt(int x, int maxY, int z, int hIndex) {
 	return -1;
 }
 
+#define RainCalcRegionBody(get_block, row_empty)\
+for (y = World.MaxY; y >= 0 && left > 0; y--) {\
+	for (z = z1; z <= z2; z++) {\
+		i      = World_Pack(x1, y, z);\
+		hIndex = Weather_Pack(x1, z);\
+		/* Quickly skip over rows of only air (e.g. the sky above the map) */ \
+		if (skipAir && row_empty) continue;\
+\
+		for (x = x1; x <= x2; x++, i++, hIndex++) {\
+			if (Weather_Heightmap[hIndex] != WEATHER_UNCALCULATED) continue;\
+			draw = Blocks.Draw[get_block];\
+\
+			if (!(draw == DRAW_GAS || draw == DRAW_SPRITE)) {\
+				Weather_Heightmap[hIndex] = y;\
+				left--;\
+			}\
+		}\
+	}\
+}
+
+/* Calculates rain height of every column in the given region */
+/* NOTE: Works through the world one horizontal layer at a time from the top, */
+/*  which is much faster than calculating each column one block at a time */
+static void CalcRainHeights(int x1, int z1, int x2, int z2) {
+	int count = x2 - x1 + 1, left = count * (z2 - z1 + 1);
+	int x, y, z, i, hIndex;
+	cc_uint8 draw;
+	/* Rows of air can only be skipped when air is not visible to rain */
+	cc_bool skipAir = Blocks.Draw[BLOCK_AIR] == DRAW_GAS || Blocks.Draw[BLOCK_AIR] == DRAW_SPRITE;
+
+	for (z = z1; z <= z2; z++) {
+		hIndex = Weather_Pack(x1, z);
+		for (x = x1; x <= x2; x++) 
+		{
+			Weather_Heightmap[hIndex++] = WEATHER_UNCALCULATED;
+		}
+	}
+
+#ifndef EXTENDED_BLOCKS
+	RainCalcRegionBody(World.Blocks[i], 
+		ClassicLighting_IsRowEmpty(World.Blocks + i, count));
+#else
+	if (World.IDMask <= 0xFF) {
+		RainCalcRegionBody(World.Blocks[i], 
+			ClassicLighting_IsRowEmpty(World.Blocks + i, count));
+	} else {
+		RainCalcRegionBody(World.Blocks[i] | (World_GetUpperBlock(i) << 8), 
+			ClassicLighting_IsRowEmpty(World.Blocks + i, count) && ClassicLighting_IsUpperRowEmpty(i, count));
+	}
+#endif
+	if (left <= 0) return;
+
+	/* Columns without any blocks that rain stops at */
+	for (z = z1; z <= z2; z++) {
+		hIndex = Weather_Pack(x1, z);
+		for (x = x1; x <= x2; x++, hIndex++) 
+		{
+			if (Weather_Heightmap[hIndex] == WEATHER_UNCALCULATED) Weather_Heightmap[hIndex] = -1;
+		}
+	}
+}
+
+static void InitWeatherHeightmap(void) {
+	cc_uint64 beg;
+	int elapsed;
+
+	Mem_Free(Weather_Heightmap);
+	Weather_Heightmap = NULL;
+	if (!World.Loaded) return;
+
+	Weather_Heightmap = (cc_int16*)Mem_TryAlloc(World.Width * World.Length, 2);
+	if (!Weather_Heightmap) { World_OutOfMemory(); return; }
+
+	beg = Stopwatch_Measure();
+	CalcRainHeights(0, 0, World.Width - 1, World.Length - 1);
+	elapsed = (int)(Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure()) / 1000);
+	Platform_Log1("weather heightmap took: %i", &elapsed);
+}
+
 static float GetRainHeight(int x, int z) {
-	int hIndex, height;
 	int y;
 	if (!World_ContainsXZ(x, z)) return (float)Env.EdgeHeight;
 
-	hIndex = Weather_Pack(x, z);
-	height = Weather_Heightmap[hIndex];
-
-	y = height == Int16_MaxValue ? CalcRainHeightAt(x, World.MaxY, z, hIndex) : height;
+	y = Weather_Heightmap[Weather_Pack(x, z)];
 	return y == -1 ? 0 : y + Blocks.MaxBB[World_GetBlock(x, y, z)].y;
 }
 
@@ -410,9 +558,7 @@ void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID n
 
 	hIndex = Weather_Pack(x, z);
 	height = Weather_Heightmap[hIndex];
-	/* Two cases can be skipped here: */
-	/* a) rain height was not calculated to begin with (height is short.MaxValue) */
-	/* b) changed y is below current calculated rain height */
+	/* Changed y being below current rain height can be skipped */
 	if (y < height) return;
 
 	if (nowBlock) {
@@ -425,6 +571,10 @@ void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID n
 	}
 }
 
+void EnvRenderer_OnRegionChanged(int minX, int minZ, int maxX, int maxZ) {
+	CalcRainHeights(minX, minZ, maxX, maxZ);
+}
+
 static float CalcRainAlphaAt(float x) {
 	/* Wolfram Alpha: fit {0,178},{1,169},{4,147},{9,114},{16,59},{25,9} */
 	float falloff = 0.05f * x * x - 7 * x;
@@ -452,8 +602,7 @@ void EnvRenderer_RenderWeather(float delta) {
 	weather = Env.Weather;
 	if (weather == WEATHER_SUNNY) return;
 
-	if (!Weather_Heightmap) 
-		InitWeatherHeightmap();
+	if (!Weather_Heightmap) return;
 	if (!weather_vb)
 		weather_vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, WEATHER_VERTS_COUNT);
 
@@ -567,6 +716,9 @@ static int sides_vertices, edges_vertices;
 static cc_bool sides_fullBright, edges_fullBright;
 static TextureLoc edges_lastTexLoc, sides_lastTexLoc;
 
+#define Borders_HorOffset(block) (Blocks.RenderMinBB[block].x - Blocks.MinBB[block].x)
+#define Borders_YOffset(block)   (Blocks.RenderMinBB[block].y - Blocks.MinBB[block].y)
+
 static void RenderBorders(BlockID block, GfxResourceID vb, GfxResourceID tex, int count) {
 	if (!vb) return;
 
@@ -590,9 +742,19 @@ void EnvRenderer_RenderMapEdges(void) {
 	/* Do not draw water when player cannot see it */
 	/* Fixes some 'depth bleeding through' issues with 16 bit depth buffers on large maps */
 	int yVisible = min(0, Env_SidesHeight);
+	BlockID block = Env.EdgeBlock;
+	float hor, y;
+
 	if (Camera.CurrentPos.y < yVisible && sides_vb) return;
+	if (Blocks.Draw[block] == DRAW_GAS) return;
+
+	/* Edges mesh is built at y = 0, so edge height and block offsets don't require rebuilding it */
+	hor = Borders_HorOffset(block);
+	y   = (float)Env.EdgeHeight + Borders_YOffset(block);
 
-	RenderBorders(Env.EdgeBlock, edges_vb, edges_tex, edges_vertices);
+	LoadTranslatedView(hor, y, hor);
+	RenderBorders(block, edges_vb, edges_tex, edges_vertices);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
 }
 
 static void MakeBorderTex(GfxResourceID* texId, BlockID block) {
@@ -623,9 +785,6 @@ static void UpdateBorderTextures(void) {
 	MakeBorderTex(&sides_tex, Env.SidesBlock);
 }
 
-#define Borders_HorOffset(block) (Blocks.RenderMinBB[block].x - Blocks.MinBB[block].x)
-#define Borders_YOffset(block)   (Blocks.RenderMinBB[block].y - Blocks.MinBB[block].y)
-
 static void DrawBorderX(int x, int z1, int z2, int y1, int y2, PackedCol color, struct VertexTextured** vertices) {
 	int endZ = z2, endY = y2, startY = y1, axisSize = EnvRenderer_AxisSize();
 	float u2, v2;
@@ -696,12 +855,40 @@ static void DrawBorderY(int x1, int z1, int x2, int z2, float y, PackedCol color
 	*vertices = v;
 }
 
-static void UpdateMapSides(void) {
+static void DrawMapSides(struct VertexTextured* data) {
 	Rect2D rects[4], r;
-	BlockID block;
+	BlockID block = Env.SidesBlock;
 	PackedCol color;
 	int y, y1, y2;
 	int i;
+
+	sides_fullBright = Blocks.Brightness[block];
+	color = sides_fullBright ? PACKEDCOL_WHITE : Env.ShadowCol;
+	Block_Tint(color, block)
+
+	y = Env_SidesHeight;
+	CalcBorderRects(rects);
+	for (i = 0; i < 4; i++) {
+		r = rects[i];
+		DrawBorderY(r.x, r.y, r.x + r.width, r.y + r.height, (float)y, color,
+			0, Borders_YOffset(block), &data);
+	}
+
+	/* Work properly for when ground level is below 0 */
+	y1 = 0; y2 = y;
+	if (y < 0) { y1 = y; y2 = 0; }
+
+	DrawBorderY(0, 0, World.Width, World.Length, 0, color, 0, 0, &data);
+	DrawBorderZ(0, 0, World.Width, y1, y2, color, &data);
+	DrawBorderZ(World.Length, 0, World.Width, y1, y2, color, &data);
+	DrawBorderX(0, 0, World.Length, y1, y2, color, &data);
+	DrawBorderX(World.Width, 0, World.Length, y1, y2, color, &data);
+}
+
+static void UpdateMapSides(void) {
+	Rect2D rects[4], r;
+	BlockID block;
+	int y, i;
 	struct VertexTextured* data;
 
 	Gfx_DeleteVb(&sides_vb);
@@ -723,43 +910,48 @@ static void UpdateMapSides(void) {
 	sides_vertices += 2 * CalcNumVertices(World.Length, Math_AbsI(y)); /* XQuads */
 	data = (struct VertexTextured*)Gfx_RecreateAndLockVb(&sides_vb,
 										VERTEX_FORMAT_TEXTURED, sides_vertices);
+	DrawMapSides(data);
+	Gfx_UnlockVb(sides_vb);
+}
 
-	sides_fullBright = Blocks.Brightness[block];
-	color = sides_fullBright ? PACKEDCOL_WHITE : Env.ShadowCol;
+/* Overwrites the contents of the existing sides mesh (e.g. shadow colour changed) */
+static void RecolorMapSides(void) {
+	struct VertexTextured* data;
+	if (!sides_vb) { UpdateMapSides(); return; }
+
+	Gfx_BindVb(sides_vb);
+	data = (struct VertexTextured*)Gfx_LockVb(sides_vb,
+										VERTEX_FORMAT_TEXTURED, sides_vertices);
+	DrawMapSides(data);
+	Gfx_UnlockVb(sides_vb);
+}
+
+static void DrawMapEdges(struct VertexTextured* data) {
+	Rect2D rects[4], r;
+	BlockID block = Env.EdgeBlock;
+	PackedCol color;
+	int i;
+
+	edges_fullBright = Blocks.Brightness[block];
+	color = edges_fullBright ? PACKEDCOL_WHITE : Env.SunCol;
 	Block_Tint(color, block)
 
+	CalcBorderRects(rects);
 	for (i = 0; i < 4; i++) {
 		r = rects[i];
-		DrawBorderY(r.x, r.y, r.x + r.width, r.y + r.height, (float)y, color,
-			0, Borders_YOffset(block), &data);
+		DrawBorderY(r.x, r.y, r.x + r.width, r.y + r.height, 0, color, 0, 0, &data);
 	}
-
-	/* Work properly for when ground level is below 0 */
-	y1 = 0; y2 = y;
-	if (y < 0) { y1 = y; y2 = 0; }
-
-	DrawBorderY(0, 0, World.Width, World.Length, 0, color, 0, 0, &data);
-	DrawBorderZ(0, 0, World.Width, y1, y2, color, &data);
-	DrawBorderZ(World.Length, 0, World.Width, y1, y2, color, &data);
-	DrawBorderX(0, 0, World.Length, y1, y2, color, &data);
-	DrawBorderX(World.Width, 0, World.Length, y1, y2, color, &data);
-
-	Gfx_UnlockVb(sides_vb);
 }
 
+/* Edges mesh is built at y = 0, then moved in RenderMapEdges */
+/* NOTE: Only the world size, view distance and render mode affect the mesh size */
 static void UpdateMapEdges(void) {
 	Rect2D rects[4], r;
-	BlockID block;
-	PackedCol color;
-	float y;
 	int i;
 	struct VertexTextured* data;
 
 	Gfx_DeleteVb(&edges_vb);
 	if (!World.Loaded || Gfx.LostContext) return;
-	block = Env.EdgeBlock;
-
-	if (Blocks.Draw[block] == DRAW_GAS) return;
 	CalcBorderRects(rects);
 
 	edges_vertices = 0;
@@ -769,17 +961,19 @@ static void UpdateMapEdges(void) {
 	}
 	data = (struct VertexTextured*)Gfx_RecreateAndLockVb(&edges_vb,
 										VERTEX_FORMAT_TEXTURED, edges_vertices);
+	DrawMapEdges(data);
+	Gfx_UnlockVb(edges_vb);
+}
 
-	edges_fullBright = Blocks.Brightness[block];
-	color = edges_fullBright ? PACKEDCOL_WHITE : Env.SunCol;
-	Block_Tint(color, block)
+/* Overwrites the contents of the existing edges mesh (e.g. sun colour or edge block changed) */
+static void RecolorMapEdges(void) {
+	struct VertexTextured* data;
+	if (!edges_vb) { UpdateMapEdges(); return; }
 
-	y = (float)Env.EdgeHeight;
-	for (i = 0; i < 4; i++) {
-		r = rects[i];
-		DrawBorderY(r.x, r.y, r.x + r.width, r.y + r.height, y, color,
-			Borders_HorOffset(block), Borders_YOffset(block), &data);
-	}
+	Gfx_BindVb(edges_vb);
+	data = (struct VertexTextured*)Gfx_LockVb(edges_vb,
+										VERTEX_FORMAT_TEXTURED, edges_vertices);
+	DrawMapEdges(data);
 	Gfx_UnlockVb(edges_vb);
 }
 
@@ -875,28 +1069,25 @@ static void OnTerrainAtlasChanged(void* obj) { UpdateBorderTextures(); }
 static void OnViewDistanceChanged(void* obj) { UpdateAll(); }
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
+	/* NOTE: Clouds/sky/edges heights are applied when rendering, so don't need mesh changes */
 	if (envVar == ENV_VAR_EDGE_BLOCK) {
 		MakeBorderTex(&edges_tex, Env.EdgeBlock);
-		UpdateMapEdges();
+		RecolorMapEdges();
 	} else if (envVar == ENV_VAR_SIDES_BLOCK) {
 		MakeBorderTex(&sides_tex, Env.SidesBlock);
 		UpdateMapSides();
 	} else if (envVar == ENV_VAR_EDGE_HEIGHT || envVar == ENV_VAR_SIDES_OFFSET) {
-		UpdateMapEdges();
 		UpdateMapSides();
 	} else if (envVar == ENV_VAR_SUN_COLOR) {
-		UpdateMapEdges();
+		RecolorMapEdges();
 	} else if (envVar == ENV_VAR_SHADOW_COLOR) {
-		UpdateMapSides();
+		RecolorMapSides();
 	} else if (envVar == ENV_VAR_SKY_COLOR) {
-		UpdateSky();
+		RecolorSky();
 	} else if (envVar == ENV_VAR_FOG_COLOR) {
 		EnvRenderer_UpdateFog();
 	} else if (envVar == ENV_VAR_CLOUDS_COLOR) {
-		UpdateClouds();
-	} else if (envVar == ENV_VAR_CLOUDS_HEIGHT) {
-		UpdateSky();
-		UpdateClouds();
+		RecolorClouds();
 	} else if (envVar == ENV_VAR_SKYBOX_COLOR) {
 		Gfx_DeleteVb(&skybox_vb);
 	}
@@ -949,7 +1140,10 @@ static void OnReset(void) {
 	lastPos = IVec3_MaxValue();
 }
 
-static void OnNewMapLoaded(void) { OnContextRecreated(NULL); }
+static void OnNewMapLoaded(void) {
+	InitWeatherHeightmap();
+	OnContextRecreated(NULL);
+}
 
 struct IGameComponent EnvRenderer_Component = {
 	OnInit,  /* Init  */
@@ -25,13 +25,21 @@ void EnvRenderer_RenderMapSides(void);
 /* Renders flat horizon surrounding map. */
 void EnvRenderer_RenderMapEdges(void);
 /* Renders a skybox around the player. */
+/* NOTE: If ENVRENDERER_SKYBOX_AFTER_MAP is defined, this must be called after the opaque map */
+/*  has been rendered, as the skybox is then drawn at the far plane behind everything else, */
+/*  instead of being drawn over the whole screen before everything else */
 void EnvRenderer_RenderSkybox(void);
+#if CC_GFX_BACKEND_IS_GL() || CC_GFX_BACKEND == CC_GFX_BACKEND_D3D9 || CC_GFX_BACKEND == CC_GFX_BACKEND_D3D11
+#define ENVRENDERER_SKYBOX_AFTER_MAP
+#endif
 /* Whether a skybox should be rendered. */
 cc_bool EnvRenderer_ShouldRenderSkybox(void);
 
 extern cc_int16* Weather_Heightmap;
 /* Called when a block is changed to update internal weather state. */
 void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+/* Called when many blocks in the region are changed at once to update internal weather state. */
+void EnvRenderer_OnRegionChanged(int minX, int minZ, int maxX, int maxZ);
 /* Renders rainfall/snowfall weather. */
 void EnvRenderer_RenderWeather(float delta);
 
@@ -138,5 +138,10 @@ enum CC_ERRORS {
 	SSL_ERR_CONTEXT_DEAD = 0xCCDED070UL, /* Server shutdown the SSL context and it must be recreated */
 	PNG_ERR_16BITSAMPLES = 0xCCDED071UL, /* Image uses 16 bit samples, which is unimplemented */
 	ERR_NO_NETWORKING    = 0xCCDED072UL, /* No working network connection */
+
+	CCR_ERR_IDENTIFIER = 0xCCDED073UL, /* CCR stream bytes #1-#4 aren't "CCRM" */
+	CCR_ERR_VERSION    = 0xCCDED074UL, /* CCR stream version or region size isn't supported */
+	CCR_ERR_DIMENSIONS = 0xCCDED075UL, /* CCR header dimensions don't match those in its metadata */
+	CHUNKED_ERR_SECTION = 0xCCDED076UL, /* Chunked map dimensions or section is invalid */
 };
 #endif
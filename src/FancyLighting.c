@@ -12,6 +12,7 @@
 #include "ExtMath.h"
 #include "Options.h"
 #include "Queue.h"
+#define MEM_SUBSYSTEM MEM_SYS_LIGHTING
 
 struct LightNode {
 	IVec3 coords; /* 12 bytes */
@@ -21,6 +22,8 @@ struct LightNode {
 
 static struct Queue lightQueue;
 static struct Queue unlightQueue;
+/* Light queues used when calculating lighting for chunk columns on worker threads */
+static struct Queue workerQueues[LIGHTING_MAX_WORKERS];
 
 /* Top face, X face, Z face, bottomY face*/
 #define PALETTE_SHADES 4
@@ -46,6 +49,39 @@ static cc_uint8* chunkLightingDataFlags;
 #define CHUNK_ALL_CALCULATED 2
 static LightingChunk* chunkLightingData;
 
+/* The lighting data of each chunk is either: */
+/*  - NULL, when no cell in the chunk has any light */
+/*  - paletted, where each cell is a 4 bit index into a palette of up to 16 light values */
+/*  - a full array of light values, once the chunk needs more than 16 different light values */
+/* Most chunks only ever contain a few different light values, so this halves their memory usage */
+#define LIGHT_PALETTE_SIZE 16
+#define LIGHT_PALETTED_SIZE (LIGHT_PALETTE_SIZE + CHUNK_SIZE_3 / 2)
+/* Number of values in the palette of each chunk's lighting data (0 if a full array) */
+/* NOTE: Values are never removed from a palette, even once no cell uses them anymore */
+static cc_uint8* chunkPaletteCounts;
+
+/* Light update that each chunk was last marked as needing to be rebuilt in */
+/* NOTE: This way each chunk is only checked and refreshed at most once per light update, */
+/*  rather than every time a cell along its boundary changes */
+static cc_uint16* chunkRefreshGens;
+static cc_uint16 lightGeneration;
+
+/* Whether lighting for each column of chunks has been queued/calculated ahead of meshing */
+static cc_uint8* columnStates;
+#define COLUMN_UNQUEUED 0
+#define COLUMN_QUEUED 1
+#define COLUMN_CALCULATED 2
+/* Columns queued to be calculated, and the columns in the current group of them */
+static int* queuedColumns;
+static int* groupColumns;
+static int queuedCount, queuedCapacity, groupCount, groupColor;
+
+struct LightChange { IVec3 coords; BlockID oldBlock, newBlock; };
+/* Block changes made since BeginBatch, which have not had lighting updated yet */
+static struct LightChange* batchChanges;
+static int batchCount, batchCapacity;
+static cc_bool batching;
+
 #define MakePaletteIndex(lampLevel, lavaLevel) ((lampLevel << FANCY_LIGHTING_LAMP_SHIFT) | lavaLevel)
 /* Fill in a palette with values based on the current light colors, shaded by the given shade value and lightened by the given ambientColor */
 static void InitPalette(PackedCol* palette, float shaded, PackedCol ambientColor) {
@@ -102,14 +138,23 @@ static void FreePalettes(void) {
 
 static int chunksCount;
 static void AllocState(void) {
+	int i;
 	ClassicLighting_AllocState();
 	InitPalettes();
 	chunksCount = World.ChunksCount;
 
 	chunkLightingDataFlags = (cc_uint8*)Mem_AllocCleared(chunksCount, sizeof(cc_uint8), "light flags");
 	chunkLightingData = (LightingChunk*)Mem_AllocCleared(chunksCount, sizeof(LightingChunk), "light chunks");
+	chunkPaletteCounts = (cc_uint8*)Mem_AllocCleared(chunksCount, sizeof(cc_uint8), "light palettes");
+	chunkRefreshGens   = (cc_uint16*)Mem_AllocCleared(chunksCount, sizeof(cc_uint16), "light generations");
+	lightGeneration    = 0;
+	columnStates      = (cc_uint8*)Mem_AllocCleared(World.ChunksX * World.ChunksZ, sizeof(cc_uint8), "light columns");
 	Queue_Init(&lightQueue, sizeof(struct LightNode));
 	Queue_Init(&unlightQueue, sizeof(struct LightNode));
+
+	for (i = 0; i < LIGHTING_MAX_WORKERS; i++) {
+		Queue_Init(&workerQueues[i], sizeof(struct LightNode));
+	}
 }
 
 static void FreeState(void) {
@@ -127,10 +172,31 @@ static void FreeState(void) {
 
 	Mem_Free(chunkLightingDataFlags);
 	Mem_Free(chunkLightingData);
+	Mem_Free(chunkPaletteCounts);
+	Mem_Free(chunkRefreshGens);
+	Mem_Free(columnStates);
+	Mem_Free(batchChanges);
+	Mem_Free(queuedColumns);
+	Mem_Free(groupColumns);
 	chunkLightingDataFlags = NULL;
 	chunkLightingData = NULL;
+	chunkPaletteCounts = NULL;
+	chunkRefreshGens   = NULL;
+	columnStates   = NULL;
+	batchChanges   = NULL;
+	batchCount     = 0;
+	batchCapacity  = 0;
+	queuedColumns  = NULL;
+	groupColumns   = NULL;
+	queuedCount    = 0;
+	queuedCapacity = 0;
+	groupColor     = 0;
 	Queue_Clear(&lightQueue);
 	Queue_Clear(&unlightQueue);
+
+	for (i = 0; i < LIGHTING_MAX_WORKERS; i++) {
+		Queue_Clear(&workerQueues[i]);
+	}
 }
 
 /* Converts chunk x/y/z coordinates to the corresponding index in chunks array/list */
@@ -140,9 +206,106 @@ static void FreeState(void) {
 /* Converts global x/y/z coordinates to the corresponding index in a chunk */
 #define GlobalCoordsToChunkCoordsIndex(x, y, z) (LocalCoordsToIndex(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK))
 
+/* Returns the light value of a cell in a chunk. Does NOT check that the chunk has lighting data. */
+static cc_uint8 GetLightValue(int chunkIndex, int localIndex) {
+	LightingChunk data = chunkLightingData[chunkIndex];
+	cc_uint8 index;
+	if (!chunkPaletteCounts[chunkIndex]) return data[localIndex];
+
+	index = data[LIGHT_PALETTE_SIZE + (localIndex >> 1)];
+	index = (localIndex & 1) ? (index >> 4) : (index & 0x0F);
+	return data[index];
+}
+
+/* Converts the paletted lighting data of a chunk into a full array of light values */
+static void ExpandLightingChunk(int chunkIndex) {
+	LightingChunk data = (LightingChunk)Mem_Alloc(CHUNK_SIZE_3, sizeof(cc_uint8), "light chunk");
+	int i;
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		data[i] = GetLightValue(chunkIndex, i);
+	}
+	Mem_Free(chunkLightingData[chunkIndex]);
+
+	chunkLightingData[chunkIndex]  = data;
+	chunkPaletteCounts[chunkIndex] = 0;
+}
+
+/* Sets the light value of a cell in a chunk. Does NOT check that the chunk has lighting data. */
+static void SetLightValue(int chunkIndex, int localIndex, cc_uint8 value) {
+	LightingChunk data = chunkLightingData[chunkIndex];
+	int i, count = chunkPaletteCounts[chunkIndex];
+	cc_uint8* cell;
+	if (!count) { data[localIndex] = value; return; }
+
+	for (i = 0; i < count && data[i] != value; i++) { }
+
+	if (i == count) {
+		if (count == LIGHT_PALETTE_SIZE) {
+			ExpandLightingChunk(chunkIndex);
+			chunkLightingData[chunkIndex][localIndex] = value;
+			return;
+		}
+		data[count] = value;
+		chunkPaletteCounts[chunkIndex]++;
+	}
+
+	cell  = &data[LIGHT_PALETTE_SIZE + (localIndex >> 1)];
+	*cell = (localIndex & 1) ? ((*cell & 0x0F) | (i << 4)) : ((*cell & 0xF0) | i);
+}
+
+/* Starts a new light update, which may mark chunks as needing to be rebuilt */
+static void NextLightGeneration(void) {
+	lightGeneration++;
+	if (lightGeneration) return;
+
+	/* Generation counter wrapped around, so old generations could be mistaken for the current one */
+	Mem_Set(chunkRefreshGens, 0, chunksCount * sizeof(cc_uint16));
+	lightGeneration = 1;
+}
+
+/* Returns whether any block in the chunk next to the given cell could use the cell's light when meshed */
+/*  (i.e. whether any of the blocks in the 3x3 area beside the cell across the chunk boundary are not air) */
+/* NOTE: The 3x3 area is checked since smooth lighting also uses light of diagonally adjacent cells */
+static cc_bool NeighbourUsesCell(int x, int y, int z, int dx, int dy, int dz) {
+	int minX, minY, minZ, maxX, maxY, maxZ;
+	int xx, yy, zz;
+	x += dx; y += dy; z += dz;
+
+	minX = dx ? x : max(0, x - 1); maxX = dx ? x : min(World.MaxX, x + 1);
+	minY = dy ? y : max(0, y - 1); maxY = dy ? y : min(World.MaxY, y + 1);
+	minZ = dz ? z : max(0, z - 1); maxZ = dz ? z : min(World.MaxZ, z + 1);
+
+	for (yy = minY; yy <= maxY; yy++) {
+		for (zz = minZ; zz <= maxZ; zz++) {
+			for (xx = minX; xx <= maxX; xx++) {
+				if (Blocks.Draw[World_GetBlock(xx, yy, zz)] != DRAW_GAS) return true;
+			}
+		}
+	}
+	return false;
+}
+
+/* Marks the chunk next to the given cell as needing to be rebuilt, if its mesh could be affected by the cell's light */
+static void RefreshNeighbour(int x, int y, int z, int dx, int dy, int dz) {
+	int cx = (x + dx) >> CHUNK_SHIFT, cy = (y + dy) >> CHUNK_SHIFT, cz = (z + dz) >> CHUNK_SHIFT;
+	int chunkIndex;
+	if (x + dx < 0 || y + dy < 0 || z + dz < 0) return;
+	if (cx >= World.ChunksX || cy >= World.ChunksY || cz >= World.ChunksZ) return;
+
+	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+	if (chunkRefreshGens[chunkIndex] == lightGeneration) return;
+
+	if (!NeighbourUsesCell(x, y, z, dx, dy, dz)) {
+		Game.ChunkRefreshesSkipped++; return;
+	}
+	chunkRefreshGens[chunkIndex] = lightGeneration;
+	MapRenderer_RefreshChunk(cx, cy, cz);
+}
+
 /* Sets the light level at this cell. Does NOT check that the cell is in bounds. */
 static void SetBrightness(cc_uint8 brightness, int x, int y, int z, cc_bool isLamp, cc_bool refreshChunk) {
-	cc_uint8 clearMask, shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0, prevValue;
+	cc_uint8 clearMask, shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0, prevValue, value;
 	int cx = x >> CHUNK_SHIFT, lx = x & CHUNK_MASK;
 	int cy = y >> CHUNK_SHIFT, ly = y & CHUNK_MASK;
 	int cz = z >> CHUNK_SHIFT, lz = z & CHUNK_MASK;
@@ -150,46 +313,44 @@ static void SetBrightness(cc_uint8 brightness, int x, int y, int z, cc_bool isLa
 	int localIndex = LocalCoordsToIndex(lx, ly, lz);
 
 	if (chunkLightingData[chunkIndex] == NULL) {
-		chunkLightingData[chunkIndex] = (cc_uint8*)Mem_TryAllocCleared(CHUNK_SIZE_3, sizeof(cc_uint8));
+		/* Chunks without lighting data have no light anywhere, so nothing to darken */
+		if (!brightness) return;
+
+		/* Palette starts with just 0 (i.e. no light), which every cell is initially set to */
+		chunkLightingData[chunkIndex] = (LightingChunk)Mem_TryAllocCleared(LIGHT_PALETTED_SIZE, sizeof(cc_uint8));
+		if (!chunkLightingData[chunkIndex]) return;
+		chunkPaletteCounts[chunkIndex] = 1;
 	}
 
 	/* 00001111 if lamp, otherwise 11110000*/
 	clearMask = ~(FANCY_LIGHTING_MAX_LEVEL << shift);
-
-	if (refreshChunk) {
-		prevValue = chunkLightingData[chunkIndex][localIndex];
-
-		chunkLightingData[chunkIndex][localIndex] &= clearMask;
-		chunkLightingData[chunkIndex][localIndex] |= brightness << shift;
-
-		/* There is no reason to refresh current chunk as the builder does that automatically */
-		if (prevValue != chunkLightingData[chunkIndex][localIndex]) {
-			if (lx == CHUNK_MAX) MapRenderer_RefreshChunk(cx + 1, cy, cz);
-			if (lx == 0)         MapRenderer_RefreshChunk(cx - 1, cy, cz);
-			if (ly == CHUNK_MAX) MapRenderer_RefreshChunk(cx, cy + 1, cz);
-			if (ly == 0)         MapRenderer_RefreshChunk(cx, cy - 1, cz);
-			if (lz == CHUNK_MAX) MapRenderer_RefreshChunk(cx, cy, cz + 1);
-			if (lz == 0)         MapRenderer_RefreshChunk(cx, cy, cz - 1);
-		}
-	}
-	else {
-		chunkLightingData[chunkIndex][localIndex] &= clearMask;
-		chunkLightingData[chunkIndex][localIndex] |= brightness << shift;
-	}
+	prevValue = GetLightValue(chunkIndex, localIndex);
+	value     = (prevValue & clearMask) | (brightness << shift);
+
+	if (prevValue == value) return;
+	SetLightValue(chunkIndex, localIndex, value);
+	if (!refreshChunk) return;
+
+	/* There is no reason to refresh current chunk as the builder does that automatically */
+	if (lx == CHUNK_MAX) RefreshNeighbour(x, y, z,  1,  0,  0);
+	if (lx == 0)         RefreshNeighbour(x, y, z, -1,  0,  0);
+	if (ly == CHUNK_MAX) RefreshNeighbour(x, y, z,  0,  1,  0);
+	if (ly == 0)         RefreshNeighbour(x, y, z,  0, -1,  0);
+	if (lz == CHUNK_MAX) RefreshNeighbour(x, y, z,  0,  0,  1);
+	if (lz == 0)         RefreshNeighbour(x, y, z,  0,  0, -1);
 }
 /* Returns the light level at this cell. Does NOT check that the cell is in bounds. */
 static cc_uint8 GetBrightness(int x, int y, int z, cc_bool isLamp) {
 	int cx = x >> CHUNK_SHIFT, lx = x & CHUNK_MASK;
 	int cy = y >> CHUNK_SHIFT, ly = y & CHUNK_MASK;
 	int cz = z >> CHUNK_SHIFT, lz = z & CHUNK_MASK;
-	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz), localIndex;
+	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+	cc_uint8 value;
 
 	if (chunkLightingData[chunkIndex] == NULL) { return 0; }
-	localIndex = LocalCoordsToIndex(lx, ly, lz);
+	value = GetLightValue(chunkIndex, LocalCoordsToIndex(lx, ly, lz));
 
-	return isLamp ?
-		chunkLightingData[chunkIndex][localIndex] >> FANCY_LIGHTING_LAMP_SHIFT :
-		chunkLightingData[chunkIndex][localIndex] & FANCY_LIGHTING_MAX_LEVEL;
+	return isLamp ? value >> FANCY_LIGHTING_LAMP_SHIFT : value & FANCY_LIGHTING_MAX_LEVEL;
 }
 
 
@@ -219,16 +380,16 @@ static cc_bool CanLightPass(BlockID thisBlock, Face face) {
 		CanLightPass(thisBlock, FACE_ ## AXIS ## thisFace) && \
 		CanLightPass(World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z), FACE_ ## AXIS ## thatFace) && \
 		GetBrightness(ln.coords.x, ln.coords.y, ln.coords.z, isLamp) < ln.brightness) { \
-		Queue_Enqueue(&lightQueue, &ln); \
+		Queue_Enqueue(queue, &ln); \
 	} \
 
-static void FlushLightQueue(cc_bool isLamp, cc_bool refreshChunk) {
+static void FlushLightQueue(struct Queue* queue, cc_bool isLamp, cc_bool refreshChunk) {
 	struct LightNode ln;
 	cc_uint8 brightnessHere;
 	BlockID thisBlock;
 
-	while (lightQueue.count > 0) {
-		ln = *(struct LightNode*)(Queue_Dequeue(&lightQueue));
+	while (queue->count > 0) {
+		ln = *(struct LightNode*)(Queue_Dequeue(queue));
 
 		brightnessHere = GetBrightness(ln.coords.x, ln.coords.y, ln.coords.z, isLamp);
 
@@ -269,7 +430,7 @@ cc_uint8 GetBlockBrightness(BlockID curBlock, cc_bool isLamp) {
 #define LightNode_Init(node, X, Y, Z, bright) \
 	node.coords.x = X; node.coords.y = Y; node.coords.z = Z; node.brightness = bright;
 
-static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
+static void CalculateChunkLightingSelf(struct Queue* queue, int chunkIndex, int cx, int cy, int cz) {
 	int x, y, z;
 	/* Block coordinates */
 	int chunkStartX, chunkStartY, chunkStartZ, chunkEndX, chunkEndY, chunkEndZ;
@@ -300,15 +461,15 @@ static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
 
 					if (brightness > 0) {
 						LightNode_Init(entry, x, y, z, brightness);
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(false, false);
+						Queue_Enqueue(queue, &entry);
+						FlushLightQueue(queue, false, false);
 					}
 					else {
 						/* If no lava brightness, it must use lamp brightness */
 						brightness = Blocks.Brightness[curBlock] >> FANCY_LIGHTING_LAMP_SHIFT;
 						LightNode_Init(entry, x, y, z, brightness);
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(true, false);
+						Queue_Enqueue(queue, &entry);
+						FlushLightQueue(queue, true, false);
 					}
 				}
 
@@ -349,7 +510,7 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 				curChunkIndex = ChunkCoordsToIndex(x, y, z);
 
 				if (chunkLightingDataFlags[curChunkIndex] == CHUNK_UNCALCULATED) {
-					CalculateChunkLightingSelf(curChunkIndex, x, y, z);
+					CalculateChunkLightingSelf(&lightQueue, curChunkIndex, x, y, z);
 				}
 			}
 		}
@@ -394,26 +555,23 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 			} \
 		} \
 
-/* Spreads darkness out from this point and relights any necessary areas afterward */
-static void CalcUnlight(int x, int y, int z, cc_uint8 brightness, cc_bool isLamp) {
+/* Spreads darkness out from the cells in the unlight queue, queueing up any areas that need to be relit afterward */
+/* NOTE: The first 'seeds' cells in the queue must be the cells that darkness originally spreads from */
+static void FlushUnlightQueue(int seeds, cc_bool isLamp) {
 	int count = 0;
 	struct LightNode curNode, otherNode;
 	cc_uint8 neighborBrightness, neighborBlockBrightness;
 	IVec3 neighborCoords;
 	BlockID thisBlockTrue, thisBlock;
 
-	SetBrightness(0, x, y, z, isLamp, true);
-	LightNode_Init(curNode, x, y, z, brightness);
-	Queue_Enqueue(&unlightQueue, &curNode);
-
 	while (unlightQueue.count > 0) {
 		curNode = *(struct LightNode*)(Queue_Dequeue(&unlightQueue));
 		neighborCoords = curNode.coords;
 
 		thisBlockTrue = World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z);
-		/* For the original cell in the queue, assume this block is air
+		/* For the original cells in the queue, assume this block is air
 		so that light can unspread "out" of it in the case of a solid blocks. */
-		thisBlock = count == 0 ? BLOCK_AIR : thisBlockTrue;
+		thisBlock = count < seeds ? BLOCK_AIR : thisBlockTrue;
 
 		count++;
 
@@ -434,14 +592,25 @@ static void CalcUnlight(int x, int y, int z, cc_uint8 brightness, cc_bool isLamp
 		neighborCoords.z += 2;
 		Light_TryUnSpreadInto(z, <, World.MaxZ, Z, MIN, MAX)
 	}
+}
 
-	FlushLightQueue(isLamp, true);
+/* Spreads darkness out from this point and relights any necessary areas afterward */
+static void CalcUnlight(int x, int y, int z, cc_uint8 brightness, cc_bool isLamp) {
+	struct LightNode entry;
+
+	SetBrightness(0, x, y, z, isLamp, true);
+	LightNode_Init(entry, x, y, z, brightness);
+	Queue_Enqueue(&unlightQueue, &entry);
+
+	FlushUnlightQueue(1, isLamp);
+	FlushLightQueue(&lightQueue, isLamp, true);
 }
 static void CalcBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBlock, cc_bool isLamp) {
 	cc_uint8 oldBlockLightLevel = GetBlockBrightness(oldBlock, isLamp);
 	cc_uint8 newBlockLightLevel = GetBlockBrightness(newBlock, isLamp);
 	cc_uint8 oldLightLevelHere = GetBrightness(x, y, z, isLamp);
 	struct LightNode entry;
+	NextLightGeneration();
 
 	/* Cell has no lighting and new block doesn't cast light and blocks all light, no change */
 	if (!oldLightLevelHere && !newBlockLightLevel && IsFullOpaque(newBlock)) return;
@@ -451,7 +620,7 @@ static void CalcBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBl
 		/* brighten this spot, recalculate lighting */
 		LightNode_Init(entry, x, y, z, newBlockLightLevel);
 		Queue_Enqueue(&lightQueue, &entry);
-		FlushLightQueue(isLamp, true);
+		FlushLightQueue(&lightQueue, isLamp, true);
 		return;
 	}
 
@@ -460,15 +629,79 @@ static void CalcBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBl
 
 	CalcUnlight(x, y, z, oldLightLevelHere, isLamp);
 }
+
+/* Updates lighting for all of the block changes in the batch at once, */
+/*  with one combined pass of spreading darkness, then one combined pass of spreading light */
+/* NOTE: Follows the same rules as CalcBlockChange for each individual block change */
+static void CalcBatchChange(cc_bool isLamp) {
+	cc_uint8 oldBlockLightLevel, newBlockLightLevel, oldLightLevelHere;
+	struct LightChange* change;
+	struct LightNode entry;
+	int i, x, y, z, seeds = 0;
+	NextLightGeneration();
+
+	for (i = 0; i < batchCount; i++) {
+		change = &batchChanges[i];
+		x = change->coords.x; y = change->coords.y; z = change->coords.z;
+
+		oldBlockLightLevel = GetBlockBrightness(change->oldBlock, isLamp);
+		newBlockLightLevel = GetBlockBrightness(change->newBlock, isLamp);
+		oldLightLevelHere  = GetBrightness(x, y, z, isLamp);
+
+		if (!oldLightLevelHere && !newBlockLightLevel && IsFullOpaque(change->newBlock)) continue;
+
+		if (oldLightLevelHere < newBlockLightLevel) {
+			LightNode_Init(entry, x, y, z, newBlockLightLevel);
+			Queue_Enqueue(&lightQueue, &entry);
+			continue;
+		}
+
+		if (IsFullTransparent(change->oldBlock) && IsFullTransparent(change->newBlock) && !oldBlockLightLevel && !newBlockLightLevel) continue;
+
+		SetBrightness(0, x, y, z, isLamp, true);
+		LightNode_Init(entry, x, y, z, oldLightLevelHere);
+		Queue_Enqueue(&unlightQueue, &entry);
+		seeds++;
+	}
+
+	FlushUnlightQueue(seeds, isLamp);
+	FlushLightQueue(&lightQueue, isLamp, true);
+}
+
 static void OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
+	struct LightChange* change;
 	/* For some reason this is a possible case */
 	if (oldBlock == newBlock) { return; }
 
 	ClassicLighting_OnBlockChanged(x, y, z, oldBlock, newBlock);
 
+	if (batching) {
+		if (batchCount == batchCapacity) {
+			batchCapacity = max(256, batchCapacity * 2);
+			batchChanges  = (struct LightChange*)Mem_Realloc(batchChanges, batchCapacity, 
+															sizeof(struct LightChange), "light changes");
+		}
+
+		change = &batchChanges[batchCount++];
+		change->coords.x = x; change->coords.y = y; change->coords.z = z;
+		change->oldBlock = oldBlock; change->newBlock = newBlock;
+		return;
+	}
+
 	CalcBlockChange(x, y, z, oldBlock, newBlock, false);
 	CalcBlockChange(x, y, z, oldBlock, newBlock, true);
 }
+
+static void BeginBatch(void) { batching = true; }
+
+static void EndBatch(void) {
+	batching = false;
+	if (!batchCount) return;
+
+	CalcBatchChange(false);
+	CalcBatchChange(true);
+	batchCount = 0;
+}
 /* Invalidates/Resets lighting state for all of the blocks in the world */
 /*  (e.g. because a block changed whether it is full bright or not) */
 static void Refresh(void) {
@@ -501,7 +734,7 @@ static PackedCol Color_Core(int x, int y, int z, int paletteFace) {
 		lightData = 0;
 	} else {
 		chunkCoordsIndex = GlobalCoordsToChunkCoordsIndex(x, y, z);
-		lightData = chunkLightingData[chunkIndex][chunkCoordsIndex];
+		lightData = GetLightValue(chunkIndex, chunkCoordsIndex);
 	}
 
 	/* This cell is exposed to sunlight */
@@ -537,16 +770,88 @@ static PackedCol Color_ZSide(int x, int y, int z) {
 
 static void LightHint(int startX, int startY, int startZ) {
 	int cx, cy, cz, chunkIndex;
+	int minX, minY, minZ, maxX, maxY, maxZ;
 	ClassicLighting_LightHint(startX, startY, startZ);
-	/* Add 1 to startX/Z, as coordinates are for the extended chunk (18x18x18) */
-	startX++; startY++; startZ++;
 
-	cx = (startX + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
-	cy = (startY + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
-	cz = (startZ + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
+	/* Meshing a chunk also reads lighting of the blocks just outside of it, */
+	/*  so also calculate lighting for any chunks those blocks are in now. */
+	/* (this way meshing only ever reads lighting state, which means chunks */
+	/*  can be safely meshed at the same time on multiple threads) */
+	minX = max(0, startX - 1) >> CHUNK_SHIFT; maxX = min(World.MaxX, startX + EXTCHUNK_SIZE) >> CHUNK_SHIFT;
+	minY = max(0, startY - 1) >> CHUNK_SHIFT; maxY = min(World.MaxY, startY + EXTCHUNK_SIZE) >> CHUNK_SHIFT;
+	minZ = max(0, startZ - 1) >> CHUNK_SHIFT; maxZ = min(World.MaxZ, startZ + EXTCHUNK_SIZE) >> CHUNK_SHIFT;
+
+	for (cy = minY; cy <= maxY; cy++) {
+		for (cz = minZ; cz <= maxZ; cz++) {
+			for (cx = minX; cx <= maxX; cx++) {
+				chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+				CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+			}
+		}
+	}
+}
 
-	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
-	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+static void QueueHint(int startX, int startY, int startZ) {
+	int cx, cz, column;
+	int minX, minZ, maxX, maxZ;
+
+	/* LightHint calculates all the chunks around the chunks it covers, */
+	/*  so the columns around those chunks also need to be calculated */
+	minX = max(0, (max(0, startX - 1) >> CHUNK_SHIFT) - 1);
+	minZ = max(0, (max(0, startZ - 1) >> CHUNK_SHIFT) - 1);
+	maxX = min(World.ChunksX - 1, (min(World.MaxX, startX + EXTCHUNK_SIZE) >> CHUNK_SHIFT) + 1);
+	maxZ = min(World.ChunksZ - 1, (min(World.MaxZ, startZ + EXTCHUNK_SIZE) >> CHUNK_SHIFT) + 1);
+
+	for (cz = minZ; cz <= maxZ; cz++) {
+		for (cx = minX; cx <= maxX; cx++) {
+			column = cz * World.ChunksX + cx;
+			if (columnStates[column] != COLUMN_UNQUEUED) continue;
+
+			if (queuedCount == queuedCapacity) {
+				queuedCapacity = max(64, queuedCapacity * 2);
+				queuedColumns  = (int*)Mem_Realloc(queuedColumns, queuedCapacity, sizeof(int), "light columns queue");
+				groupColumns   = (int*)Mem_Realloc(groupColumns,  queuedCapacity, sizeof(int), "light columns group");
+			}
+			queuedColumns[queuedCount++] = column;
+			columnStates[column] = COLUMN_QUEUED;
+		}
+	}
+}
+
+/* Light from a chunk can only spread into the chunks directly around it, so the lighting */
+/*  of columns at least 3 chunks apart on the X or Z axis can be calculated at the same time */
+#define ColumnGroup(cx, cz) (((cx) % 3) + ((cz) % 3) * 3)
+#define COLUMN_GROUPS 9
+
+static int NextQueuedGroup(void) {
+	int i, column;
+
+	for (; groupColor < COLUMN_GROUPS; groupColor++) {
+		groupCount = 0;
+		for (i = 0; i < queuedCount; i++) {
+			column = queuedColumns[i];
+			if (ColumnGroup(column % World.ChunksX, column / World.ChunksX) != groupColor) continue;
+			groupColumns[groupCount++] = column;
+		}
+		if (groupCount) { groupColor++; return groupCount; }
+	}
+
+	groupColor  = 0;
+	queuedCount = 0;
+	return 0;
+}
+
+static void CalcQueued(int task, int worker) {
+	int column = groupColumns[task];
+	int cx = column % World.ChunksX, cz = column / World.ChunksX;
+	int cy, chunkIndex;
+
+	for (cy = 0; cy < World.ChunksY; cy++) {
+		chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+		if (chunkLightingDataFlags[chunkIndex] != CHUNK_UNCALCULATED) continue;
+		CalculateChunkLightingSelf(&workerQueues[worker], chunkIndex, cx, cy, cz);
+	}
+	columnStates[column] = COLUMN_CALCULATED;
 }
 
 void FancyLighting_SetActive(void) {
@@ -566,6 +871,13 @@ void FancyLighting_SetActive(void) {
 	Lighting.FreeState  = FreeState;
 	Lighting.AllocState = AllocState;
 	Lighting.LightHint  = LightHint;
+
+	Lighting.BeginBatch = BeginBatch;
+	Lighting.EndBatch   = EndBatch;
+
+	Lighting.QueueHint       = QueueHint;
+	Lighting.NextQueuedGroup = NextQueuedGroup;
+	Lighting.CalcQueued      = CalcQueued;
 }
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
@@ -575,7 +887,7 @@ static void OnEnvVariableChanged(void* obj, int envVar) {
 	if (envVar == ENV_VAR_SUN_COLOR || envVar == ENV_VAR_SHADOW_COLOR || envVar == ENV_VAR_LAVALIGHT_COLOR || envVar == ENV_VAR_LAMPLIGHT_COLOR) {
 		InitPalettes();
 	}
-	if (envVar == ENV_VAR_LAVALIGHT_COLOR || envVar == ENV_VAR_LAMPLIGHT_COLOR) MapRenderer_Refresh();
+	if (envVar == ENV_VAR_LAVALIGHT_COLOR || envVar == ENV_VAR_LAMPLIGHT_COLOR) MapRenderer_RefreshBuiltChunks();
 }
 
 void FancyLighting_OnInit(void) {
@@ -16,21 +16,41 @@
 #include "Chat.h"
 #include "TexturePack.h"
 #include "Utils.h"
+#include "Lighting.h"
+#include "Options.h"
+#include "BlockPhysics.h"
+#include "MapRenderer.h"
+#include "EnvRenderer.h"
+#define MEM_SUBSYSTEM MEM_SYS_WORLD
 
 #ifdef CC_BUILD_FILESYSTEM
 static struct LocationUpdate* spawn_point;
+static const cc_string* import_path;
 static struct MapImporter* imp_head;
 static struct MapImporter* imp_tail;
+static cc_bool MapCache_Load(const cc_string* path, struct Stream* src);
+static void MapCache_Finish(const cc_string* path, cc_result res);
+static void Region_StartLoading(void);
+static cc_result Region_FinishLoading(void);
+#ifdef CC_BUILD_MAPJOURNAL
+static void MapJournal_Open(const cc_string* path);
+static void MapJournal_BeginSave(cc_bool journalled);
+static void MapJournal_FinishSave(const cc_string* path, cc_result res);
+static void MapJournal_Tick(void);
+static void MapJournal_Free(void);
+#endif
 
 
 /*########################################################################################################################*
 *--------------------------------------------------------General----------------------------------------------------------*
 *#########################################################################################################################*/
-static cc_result Map_ReadBlocks(struct Stream* stream) {
+/* NOTE: inflate is the state of the stream when it is a decompressing stream, NULL otherwise */
+static cc_result Map_ReadBlocks(struct Stream* stream, struct InflateState* inflate) {
 	World.Volume = World.Width * World.Length * World.Height;
 	World.Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
 
 	if (!World.Blocks) return ERR_OUT_OF_MEMORY;
+	if (inflate) Inflate_SetOutputBuffer(inflate, World.Blocks, World.Volume);
 	return Stream_Read(stream, World.Blocks, World.Volume);
 }
 
@@ -70,12 +90,21 @@ cc_result Map_LoadFrom(const cc_string* path) {
 	Game_Reset();
 	
 	spawn_point = &update;
-	res = Stream_OpenFile(&stream, path);
+	import_path = path;
+#ifdef CC_BUILD_FILEMAP
+	/* Reading directly from the mapped file avoids a read call (and copy) for every few KB of data */
+	res = Stream_OpenMappedFile(&stream, path);
+	if (res) res = Stream_OpenBufferedFile(&stream, path);
+#else
+	res = Stream_OpenBufferedFile(&stream, path);
+#endif
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
 	imp = MapImporter_Find(path);
 	if (!imp) {
 		res = ERR_NOT_SUPPORTED;
+	} else if (MapCache_Load(path, &stream)) {
+		res = 0;
 	} else if ((res = imp->import(&stream))) {
 		World_Reset();
 	}
@@ -87,6 +116,11 @@ cc_result Map_LoadFrom(const cc_string* path) {
 	World_SetNewMap(World.Blocks, World.Width, World.Height, World.Length);
 	if (!spawn_point) LocalPlayer_CalcDefaultSpawn(Entities.CurPlayer, &update);
 	LocalPlayers_MoveToSpawn(&update);
+	MapCache_Finish(path, res);
+	if (!res) Region_StartLoading();
+#ifdef CC_BUILD_MAPJOURNAL
+	if (!res) MapJournal_Open(path);
+#endif
 
 	relPath = *path;
 	Utils_UNSAFE_GetFilename(&relPath);
@@ -205,7 +239,7 @@ static cc_result Lvl_Load(struct Stream* stream) {
 	spawn_point->pitch = Math_Packed2Deg(header[15]);
 	/* (2) pervisit, perbuild permissions */
 
-	if ((res = Map_ReadBlocks(&compStream))) return res;
+	if ((res = Map_ReadBlocks(&compStream, &state))) return res;
 	blocks = World.Blocks;
 	/* Bulk convert 4 blocks at once */
 	for (i = 0; i < (World.Volume & ~3); i += 4) {
@@ -304,7 +338,7 @@ static cc_result Fcm_Load(struct Stream* stream) {
 		if ((res = Fcm_ReadString(&compStream))) return res; /* Value */
 	}
 
-	return Map_ReadBlocks(&compStream);
+	return Map_ReadBlocks(&compStream, &state);
 }
 
 
@@ -398,27 +432,175 @@ static cc_string NbtTag_String(struct NbtTag* tag) {
 	return String_Empty;
 }
 
-static cc_result Nbt_ReadString(struct Stream* stream, cc_string* str) {
-	cc_uint8 buffer[NBT_STRING_SIZE * 4];
+/* Reading each tag value from the underlying stream one at a time is slow, */
+/*  so data is instead read from the underlying stream in large chunks */
+#define NBT_BUFFER_SIZE 8192
+struct NbtReader {
+	struct Stream* source;
+	struct InflateState* inflate; /* NULL when source is not a decompressing stream */
+	cc_uint8* cur;
+	cc_uint32 left;
+	cc_uint8 buffer[NBT_BUFFER_SIZE];
+};
+
+static void NbtReader_Init(struct NbtReader* r, struct Stream* source, struct InflateState* inflate) {
+	r->source  = source;
+	r->inflate = inflate;
+	r->cur     = r->buffer;
+	r->left    = 0;
+}
+
+/* Reads from the underlying stream until at least count bytes are buffered */
+static cc_result NbtReader_Fill(struct NbtReader* r, cc_uint32 count) {
+	struct Stream* source = r->source;
+	cc_uint32 read;
+	cc_result res;
+
+	Mem_Move(r->buffer, r->cur, r->left);
+	r->cur = r->buffer;
+
+	while (r->left < count) {
+		res = source->Read(source, r->buffer + r->left, NBT_BUFFER_SIZE - r->left, &read);
+		if (res)   return res;
+		if (!read) return ERR_END_OF_STREAM;
+		r->left += read;
+	}
+	return 0;
+}
+
+/* Returns a pointer to the next count bytes of data  */
+/* NOTE: The pointer is only valid until the next NbtReader call */
+static cc_result NbtReader_Take(struct NbtReader* r, cc_uint32 count, cc_uint8** data) {
+	cc_result res;
+	if (r->left < count && (res = NbtReader_Fill(r, count))) return res;
+
+	*data    = r->cur;
+	r->cur  += count;
+	r->left -= count;
+	return 0;
+}
+
+static cc_result NbtReader_Read(struct NbtReader* r, cc_uint8* data, cc_uint32 count) {
+	cc_uint32 copy;
+	cc_uint8* src;
+	cc_result res;
+	if (count <= NBT_BUFFER_SIZE) {
+		if ((res = NbtReader_Take(r, count, &src))) return res;
+		Mem_Copy(data, src, count);
+		return 0;
+	}
+
+	copy = r->left;
+	Mem_Copy(data, r->cur, copy);
+	r->cur  += copy;
+	r->left  = 0;
+
+	/* Large arrays (e.g. map blocks) are read straight into their destination */
+	if (!r->inflate) return Stream_Read(r->source, data + copy, count - copy);
+	Inflate_SetOutputBuffer(r->inflate, data + copy, count - copy);
+	res = Stream_Read(r->source, data + copy, count - copy);
+
+	/* Array might be freed afterwards, so can't keep using it as history */
+	Inflate_SetOutputBuffer(r->inflate, NULL, 0);
+	return res;
+}
+
+static cc_result NbtReader_Skip(struct NbtReader* r, cc_uint32 count) {
+	cc_uint32 skip = min(count, r->left);
+	r->cur  += skip;
+	r->left -= skip;
+
+	if (skip == count) return 0;
+	return r->source->Skip(r->source, count - skip);
+}
+
+static cc_result Nbt_ReadString(struct NbtReader* r, cc_string* str) {
+	cc_uint8* data;
 	int len;
 	cc_result res;
 
-	if ((res = Stream_Read(stream, buffer, 2)))   return res;
-	len = Stream_GetU16_BE(buffer);
+	if ((res = NbtReader_Take(r, 2, &data)))   return res;
+	len = Stream_GetU16_BE(data);
+
+	if (len > NBT_STRING_SIZE * 4) return CW_ERR_STRING_LEN;
+	if ((res = NbtReader_Take(r, len, &data))) return res;
+
+	String_AppendUtf8(str, data, len);
+	return 0;
+}
+
+static cc_result Nbt_SkipTag(struct NbtReader* r, cc_uint8 typeId);
+static cc_result Nbt_SkipList(struct NbtReader* r, cc_uint8 childType, cc_uint32 count) {
+	cc_uint32 i;
+	cc_result res;
 
-	if (len > Array_Elems(buffer)) return CW_ERR_STRING_LEN;
-	if ((res = Stream_Read(stream, buffer, len))) return res;
+	switch (childType) {
+	case NBT_END: return 0;
+	case NBT_I8:  return NbtReader_Skip(r, count);
+	case NBT_I16: return NbtReader_Skip(r, count * 2);
+	case NBT_I32:
+	case NBT_F32: return NbtReader_Skip(r, count * 4);
+	case NBT_I64:
+	case NBT_F64: return NbtReader_Skip(r, count * 8);
+	}
 
-	String_AppendUtf8(str, buffer, len);
+	for (i = 0; i < count; i++) {
+		if ((res = Nbt_SkipTag(r, childType))) return res;
+	}
 	return 0;
 }
 
+/* Skips over a tag's value, without decoding it or calling any callbacks */
+static cc_result Nbt_SkipTag(struct NbtReader* r, cc_uint8 typeId) {
+	cc_uint8* data;
+	cc_uint8 childType;
+	cc_result res;
+
+	switch (typeId) {
+	case NBT_I8:  return NbtReader_Skip(r, 1);
+	case NBT_I16: return NbtReader_Skip(r, 2);
+	case NBT_I32:
+	case NBT_F32: return NbtReader_Skip(r, 4);
+	case NBT_I64:
+	case NBT_F64: return NbtReader_Skip(r, 8);
+
+	case NBT_I8S:
+		if ((res = NbtReader_Take(r, 4, &data))) return res;
+		return NbtReader_Skip(r, Stream_GetU32_BE(data));
+	case NBT_STR:
+		if ((res = NbtReader_Take(r, 2, &data))) return res;
+		return NbtReader_Skip(r, Stream_GetU16_BE(data));
+
+	case NBT_LIST:
+		if ((res = NbtReader_Take(r, 5, &data))) return res;
+		return Nbt_SkipList(r, data[0], Stream_GetU32_BE(&data[1]));
+
+	case NBT_DICT:
+		for (;;) {
+			if ((res = NbtReader_Take(r, 1, &data))) return res;
+			childType = data[0];
+			if (childType == NBT_END) return 0;
+
+			/* Skip over name of the child tag */
+			if ((res = NbtReader_Take(r, 2, &data)))            return res;
+			if ((res = NbtReader_Skip(r, Stream_GetU16_BE(data)))) return res;
+			if ((res = Nbt_SkipTag(r, childType)))              return res;
+		}
+	}
+	return NBT_ERR_UNKNOWN;
+}
+
 typedef void (*Nbt_Callback)(struct NbtTag* tag);
-static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct Stream* stream, 
-							struct NbtTag* parent, Nbt_Callback callback, int listIndex) {
+/* Returns whether the contents of the given list or compound tag should be read */
+/* NOTE: Skipped lists and compounds are never passed to Nbt_Callback */
+typedef cc_bool (*Nbt_Filter)(struct NbtTag* tag);
+struct NbtHandlers { Nbt_Callback callback; Nbt_Filter filter; };
+
+static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct NbtReader* r, 
+							struct NbtTag* parent, const struct NbtHandlers* h, int listIndex) {
 	struct NbtTag tag;
 	cc_uint8 childType;
-	cc_uint8 tmp[5];	
+	cc_uint8* data;
 	cc_result res;
 	cc_uint32 i, count;
 	
@@ -430,62 +612,69 @@ static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct Stream
 	String_InitArray(tag.name, tag._nameBuffer);
 
 	if (readTagName) {
-		res = Nbt_ReadString(stream, &tag.name);
+		res = Nbt_ReadString(r, &tag.name);
 		if (res) return res;
 	}
 
 	switch (typeId) {
 	case NBT_I8:
-		res = stream->ReadU8(stream, &tag.value.u8);
+		if ((res = NbtReader_Take(r, 1, &data))) break;
+		tag.value.u8 = data[0];
 		break;
 	case NBT_I16:
-		res = Stream_Read(stream, tmp, 2);
-		tag.value.u16 = Stream_GetU16_BE(tmp);
+		if ((res = NbtReader_Take(r, 2, &data))) break;
+		tag.value.u16 = Stream_GetU16_BE(data);
 		break;
 	case NBT_I32:
 	case NBT_F32:
-		res = Stream_ReadU32_BE(stream, &tag.value.u32);
+		if ((res = NbtReader_Take(r, 4, &data))) break;
+		tag.value.u32 = Stream_GetU32_BE(data);
 		break;
 	case NBT_I64:
 	case NBT_F64:
-		res = stream->Skip(stream, 8);
+		res = NbtReader_Skip(r, 8);
 		break; /* (8) data */
 
 	case NBT_I8S:
-		if ((res = Stream_ReadU32_BE(stream, &tag.dataSize))) break;
+		if ((res = NbtReader_Take(r, 4, &data))) break;
+		tag.dataSize = Stream_GetU32_BE(data);
 
 		if (NbtTag_IsSmall(&tag)) {
-			res = Stream_Read(stream, tag.value.small, tag.dataSize);
+			res = NbtReader_Read(r, tag.value.small, tag.dataSize);
 		} else {
 			tag.value.big = (cc_uint8*)Mem_TryAlloc(tag.dataSize, 1);
 			if (!tag.value.big) return ERR_OUT_OF_MEMORY;
 
-			res = Stream_Read(stream, tag.value.big, tag.dataSize);
+			res = NbtReader_Read(r, tag.value.big, tag.dataSize);
 			if (res) Mem_Free(tag.value.big);
 		}
 		break;
 	case NBT_STR:
 		String_InitArray(tag.value.str.text, tag.value.str.buffer);
-		res = Nbt_ReadString(stream, &tag.value.str.text);
+		res = Nbt_ReadString(r, &tag.value.str.text);
 		break;
 
 	case NBT_LIST:
-		if ((res = Stream_Read(stream, tmp, 5))) break;
-		childType = tmp[0];
-		count = Stream_GetU32_BE(&tmp[1]);
+		if ((res = NbtReader_Take(r, 5, &data))) break;
+		childType = data[0];
+		count = Stream_GetU32_BE(&data[1]);
+		if (h->filter && !h->filter(&tag)) return Nbt_SkipList(r, childType, count);
 
 		for (i = 0; i < count; i++) {
-			res = Nbt_ReadTag(childType, false, stream, &tag, callback, i);
+			res = Nbt_ReadTag(childType, false, r, &tag, h, i);
 			if (res) break;
 		}
 		break;
 
 	case NBT_DICT:
+		if (h->filter && !h->filter(&tag)) return Nbt_SkipTag(r, NBT_DICT);
+
 		for (;;) {
-			if ((res = stream->ReadU8(stream, &childType))) break;
+			if ((res = NbtReader_Take(r, 1, &data))) break;
+			childType = data[0];
 			if (childType == NBT_END) break;
 
-			res = Nbt_ReadTag(childType, true, stream, &tag, callback, 0);
+			res = Nbt_ReadTag(childType, true, r, &tag, h, 0);
 			if (res) break;
 		}
 		break;
@@ -495,7 +684,7 @@ static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct Stream
 
 	if (res) return res;
 	tag.result = 0;
-	callback(&tag);
+	h->callback(&tag);
 	/* NOTE: callback must set DataBig to NULL, if doesn't want it to be freed */
 	if (!NbtTag_IsSmall(&tag)) Mem_Free(tag.value.big);
 	return tag.result;
@@ -515,18 +704,37 @@ static BlockRaw* Nbt_TakeArray(struct NbtTag* tag, const char* type) {
 	return ptr;
 }
 
-static cc_result Nbt_Read(struct Stream* stream, Nbt_Callback callback) {
+/* Reads the root tag from uncompressed NBT data */
+/* NOTE: inflate is the state of the stream when it is a decompressing stream, NULL otherwise */
+static cc_result Nbt_ReadRoot(struct Stream* stream, struct InflateState* inflate, 
+							const struct NbtHandlers* h) {
+	struct NbtReader* r;
+	cc_uint8* data;
+	cc_result res;
+
+	r = (struct NbtReader*)Mem_TryAlloc(1, sizeof(struct NbtReader));
+	if (!r) return ERR_OUT_OF_MEMORY;
+	NbtReader_Init(r, stream, inflate);
+
+	if ((res = NbtReader_Take(r, 1, &data))) {
+	} else if (data[0] != NBT_DICT) {
+		res = CW_ERR_ROOT_TAG;
+	} else {
+		res = Nbt_ReadTag(NBT_DICT, true, r, NULL, h, 0);
+	}
+
+	Mem_Free(r);
+	return res;
+}
+
+static cc_result Nbt_Read(struct Stream* stream, const struct NbtHandlers* h) {
 	struct Stream compStream;
 	struct InflateState state;
 	cc_result res;
-	cc_uint8 tag;
 
 	Inflate_MakeStream2(&compStream, &state, stream);
 	if ((res = Map_SkipGZipHeader(stream))) return res;
-	if ((res = compStream.ReadU8(&compStream, &tag))) return res;
-
-	if (tag != NBT_DICT) return CW_ERR_ROOT_TAG;
-	return Nbt_ReadTag(NBT_DICT, true, &compStream, NULL, callback, 0);
+	return Nbt_ReadRoot(&compStream, &state, h);
 }
 
 
@@ -871,10 +1079,39 @@ static void Cw_Callback(struct NbtTag* tag) {
 	        0             1         2        3          4   */
 }
 
+/* Skips over compounds that none of the callbacks above make use of */
+/* (e.g. metadata written by other software, which can be quite large) */
+static cc_bool Cw_Filter(struct NbtTag* tag) {
+	struct NbtTag* tmp = tag->parent;
+	int depth = 0;
+	while (tmp) { depth++; tmp = tmp->parent; }
+
+	switch (depth) {
+	case 0: return true;
+	case 1: return IsTag(tag, "MapGenerator") || IsTag(tag, "Spawn") || IsTag(tag, "Metadata");
+	case 2: return IsTag(tag->parent, "Metadata") && IsTag(tag, "CPE");
+	case 3:
+		if (IsTag(tag, "BlockDefinitions")) return Game_AllowCustomBlocks;
+
+		return IsTag(tag, "ClickDistance")    || IsTag(tag, "EnvWeatherType") || IsTag(tag, "EnvColors")
+			|| IsTag(tag, "EnvMapAppearance") || IsTag(tag, "EnvMapAspect");
+	case 4: return IsTag(tag->parent, "EnvColors") || IsTag(tag->parent, "BlockDefinitions");
+	}
+	return false;
+}
+static const struct NbtHandlers cw_handlers = { Cw_Callback, Cw_Filter };
+
 /* Imports a world from a .cw ClassicWorld map file */
 /* Used by ClassiCube/ClassicalSharp */
 static cc_result Cw_Load(struct Stream* stream) {
-	return Nbt_Read(stream, Cw_Callback);
+	return Nbt_Read(stream, &cw_handlers);
+}
+
+static void Cw_ScanCallback(struct NbtTag* tag) { }
+static const struct NbtHandlers cw_scanHandlers = { Cw_ScanCallback, NULL };
+
+cc_result Cw_Scan(struct Stream* stream) {
+	return Nbt_Read(stream, &cw_scanHandlers);
 }
 
 
@@ -1282,7 +1519,7 @@ static cc_result Dat_LoadFormat1(struct Stream* stream) {
 	World.Width  = Stream_GetU16_BE(header +  8);
 	World.Length = Stream_GetU16_BE(header + 10);
 	World.Height = Stream_GetU16_BE(header + 12);
-	return Map_ReadBlocks(stream);
+	return Map_ReadBlocks(stream, NULL);
 }
 
 static cc_result Dat_LoadFormat2(struct Stream* stream) {
@@ -1471,10 +1708,19 @@ static void MCLevel_Callback(struct NbtTag* tag) {
 			0					1				 2 */
 }
 
+/* Skips over compounds and lists that the callbacks above don't use (e.g. Entities, TileEntities) */
+static cc_bool MCLevel_Filter(struct NbtTag* tag) {
+	if (!tag->parent) return true;
+	if (!tag->parent->parent) return IsTag(tag, "Map") || IsTag(tag, "Environment");
+
+	return !tag->parent->parent->parent && IsTag(tag->parent, "Map") && IsTag(tag, "spawn");
+}
+static const struct NbtHandlers mcl_handlers = { MCLevel_Callback, MCLevel_Filter };
+
 /* Imports a world from a .mclevel NBT map file */
 /* Used by Minecraft Indev client */
 static cc_result MCLevel_Load(struct Stream* stream) {
-	cc_result res = Nbt_Read(stream, MCLevel_Callback);
+	cc_result res = Nbt_Read(stream, &mcl_handlers);
 
 	Env.EdgeHeight  = mcl_edgeHeight;
 	Env.SidesOffset = mcl_sidesHeight - mcl_edgeHeight;
@@ -1570,12 +1816,16 @@ static cc_result Cw_WriteBockDef(struct Stream* stream, int b) {
 	return Stream_Write(stream, buffer, (int)(cur - buffer));
 }
 
-cc_result Cw_Save(struct Stream* stream) {
+/* NOTE: The block arrays are left out when blocks is false (e.g. when they are stored elsewhere) */
+static cc_result Cw_WriteMap(struct Stream* stream, cc_bool blocks) {
 	struct LocalPlayer* p = Entities.CurPlayer;
 	cc_uint8 buffer[2048];
 	cc_uint8* cur;
 	cc_result res;
 	int b;
+#ifdef EXTENDED_BLOCKS
+	int i, count;
+#endif
 
 	cur = buffer;
 	cur = Nbt_WriteDict(cur,   "ClassicWorld");
@@ -1600,22 +1850,28 @@ cc_result Cw_Save(struct Stream* stream) {
 		cur  = Nbt_WriteUInt8(cur,  "H", Math_Deg2Packed(p->SpawnYaw));
 		cur  = Nbt_WriteUInt8(cur,  "P", Math_Deg2Packed(p->SpawnPitch));
 	} *cur++ = NBT_END;
+	if (!blocks) goto metadata;
 	cur = Nbt_WriteArray(cur, "BlockArray", World.Volume);
 
 	if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
 	if ((res = Stream_Write(stream, World.Blocks, World.Volume)))  return res;
 
 #ifdef EXTENDED_BLOCKS
-	if (World.Blocks != World.Blocks2) {
+	if (World.IDMask > 0xFF) {
 		cur = buffer;
 		cur = Nbt_WriteArray(cur, "BlockArray2", World.Volume);
-
 		if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
-		if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
+
+		/* Upper blocks may be stored in separate pages */
+		for (i = 0; i < World.Volume; i += WORLD_PAGE_SIZE) {
+			count = min(WORLD_PAGE_SIZE, World.Volume - i);
+			if ((res = Stream_Write(stream, World.Blocks2Pages[i >> WORLD_PAGE_SHIFT], count))) return res;
+		}
 	}
 #endif
-
 	cur = buffer;
+
+metadata:
 	cur = Nbt_WriteDict(cur, "Metadata");
 	cur = Nbt_WriteDict(cur, "CPE");
 	{
@@ -1677,6 +1933,12 @@ cc_result Cw_Save(struct Stream* stream) {
 	return Stream_Write(stream, cw_end, sizeof(cw_end));
 }
 
+cc_result Cw_Save(struct Stream* stream) {
+	cc_result res;
+	if ((res = Region_FinishLoading())) return res;
+	return Cw_WriteMap(stream, true);
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Schematic export------------------------------------------------------*
@@ -1702,6 +1964,7 @@ cc_result Schematic_Save(struct Stream* stream) {
 	cc_uint8 tmp[256], chunk[8192] = { 0 };
 	cc_result res;
 	int i;
+	if ((res = Region_FinishLoading())) return res;
 
 	Mem_Copy(tmp, sc_begin, sizeof(sc_begin));
 	{
@@ -1831,6 +2094,7 @@ cc_result Dat_Save(struct Stream* stream) {
 	cc_uint8 tmp[4];
 	cc_result res;
 	int i, value;
+	if ((res = Region_FinishLoading())) return res;
 
 	if ((res = Stream_Write(stream, header, sizeof(header)))) return res;
 	if ((res = WriteClassDesc(stream, TC_OBJECT, "com.mojang.minecraft.level.Level", 
@@ -1857,26 +2121,1625 @@ cc_result Dat_Save(struct Stream* stream) {
 
 
 /*########################################################################################################################*
-*-------------------------------------------------------Formats component-------------------------------------------------*
+*----------------------------------------------------Background saving----------------------------------------------------*
 *#########################################################################################################################*/
-static struct MapImporter cw_imp    = { ".cw",      Cw_Load };
-static struct MapImporter dat_imp   = { ".dat",     Dat_Load };
-static struct MapImporter lvl_imp   = { ".lvl",     Lvl_Load };
-static struct MapImporter mine_imp  = { ".mine",    Dat_Load };
-static struct MapImporter fcm_imp   = { ".fcm",     Fcm_Load };
-static struct MapImporter mclvl_imp = { ".mclevel", MCLevel_Load };
+#ifdef CC_BUILD_SAVEWORKERS
+/* Exported map data, which is compressed and written to disc on the save thread */
+static cc_uint8* save_data;
+static cc_uint32 save_length, save_capacity;
+static void* save_thread;
+static volatile cc_bool save_finished;
+static cc_result save_result;
+static const char* save_place;
+static cc_string save_path; static char save_pathBuffer[FILENAME_SIZE];
+/* Whether the map is being saved to a temp file to compact its journal */
+static cc_bool save_compacting;
+
+static cc_result SaveSnapshot_Write(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	cc_uint32 capacity;
+	cc_uint8* buffer;
+
+	if (save_length + count > save_capacity) {
+		capacity = max(save_capacity * 2, save_length + count);
+		buffer   = (cc_uint8*)Mem_TryRealloc(save_data, max(capacity, 1024 * 1024), 1);
+		if (!buffer) return ERR_OUT_OF_MEMORY;
+
+		save_data     = buffer;
+		save_capacity = max(capacity, 1024 * 1024);
+	}
 
-static void OnInit(void) {
-	MapImporter_Register(&cw_imp);
-	MapImporter_Register(&dat_imp);
-	MapImporter_Register(&lvl_imp);
-	MapImporter_Register(&mine_imp);
-	MapImporter_Register(&fcm_imp);
-	MapImporter_Register(&mclvl_imp);
+	Mem_Copy(save_data + save_length, data, count);
+	save_length += count;
+	*modified    = count;
+	return 0;
 }
 
-static void OnFree(void) {
-	imp_head = NULL;
+static void SaveWorker_Run(void) {
+	struct Stream stream, compStream;
+	cc_result res;
+
+	res = Stream_CreateFile(&stream, &save_path);
+	if (res) { save_place = "creating"; goto finished; }
+
+	res = GZipParallel_MakeStream(&compStream, &stream);
+	if (res) { 
+		save_place = "compressing";
+	} else {
+		res = Stream_Write(&compStream, save_data, save_length);
+		/* NOTE: Always have to close parallel stream */
+		if (res) { compStream.Close(&compStream); save_place = "compressing"; }
+		else if ((res = compStream.Close(&compStream))) { save_place = "compressing"; }
+	}
+
+	if (res) { 
+		stream.Close(&stream);
+	} else if ((res = stream.Close(&stream))) { 
+		save_place = "closing";
+	}
+
+finished:
+	save_result   = res;
+	save_finished = true;
+}
+
+#ifdef CC_BUILD_MAPJOURNAL
+/* Replaces the map file with the compacted map that was written to a temp file */
+static void SaveWorker_FinishCompact(void) {
+	cc_string path = save_path;
+	cc_filepath src, dst;
+	cc_result res = save_result;
+	save_compacting = false;
+
+	/* Remove the .tmp suffix */
+	path.length -= 4;
+	if (!res) {
+		save_place = "replacing";
+		Platform_EncodePath(&src, &save_path);
+		Platform_EncodePath(&dst, &path);
+		res = File_Rename(&src, &dst);
+	}
+
+	if (res) Logger_SysWarn2(res, save_place, &path);
+	MapJournal_FinishSave(&path, res);
+}
+#endif
+
+/* Waits for the save thread to finish, then reports whether the map was successfully saved */
+static void SaveWorker_Finish(void) {
+	Thread_Join(save_thread);
+	save_thread = NULL;
+
+	Mem_Free(save_data);
+	save_data     = NULL;
+	save_capacity = 0;
+
+#ifdef CC_BUILD_MAPJOURNAL
+	if (save_compacting) { SaveWorker_FinishCompact(); return; }
+#endif
+	if (save_result) {
+		Logger_SysWarn2(save_result, save_place, &save_path);
+	} else {
+		World.LastSave = Game.Time;
+		Chat_Add1("&eSaved map to: %s", &save_path);
+	}
+#ifdef CC_BUILD_MAPJOURNAL
+	MapJournal_FinishSave(&save_path, save_result);
+#endif
+}
+
+static void SaveWorker_Tick(struct ScheduledTask* task) {
+	if (save_thread && save_finished) SaveWorker_Finish();
+#ifdef CC_BUILD_MAPJOURNAL
+	MapJournal_Tick();
+#endif
+}
+
+cc_result Map_SaveInBackground(const cc_string* path, MapExportFunc exporter) {
+	struct Stream snapshot;
+	cc_result res;
+	/* Only one map can be saved at once */
+	if (save_thread) SaveWorker_Finish();
+
+	Stream_Init(&snapshot);
+	snapshot.Write  = SaveSnapshot_Write;
+	save_length     = 0;
+	save_compacting = false;
+#ifdef CC_BUILD_MAPJOURNAL
+	/* Block changes made after the world is exported below still need to be journalled for the saved file */
+	MapJournal_BeginSave(exporter == Cw_Save);
+#endif
+
+	if ((res = exporter(&snapshot))) {
+		Mem_Free(save_data);
+		save_data     = NULL;
+		save_capacity = 0;
+#ifdef CC_BUILD_MAPJOURNAL
+		MapJournal_FinishSave(path, res);
+#endif
+		return res;
+	}
+
+	String_InitArray(save_path, save_pathBuffer);
+	String_Copy(&save_path, path);
+	save_finished = false;
+
+	Thread_Run(&save_thread, SaveWorker_Run, 64 * 1024, "Map save");
+	return 0;
+}
+#endif
+
+
+#ifdef CC_BUILD_MAPJOURNAL
+/*########################################################################################################################*
+*-------------------------------------------------------Map journal-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Fully saving a large map is too slow to do often, so instead block changes to a singleplayer map that */
+/*  was loaded from or saved to a .cw file are appended to a journal file alongside it. When the map is next */
+/*  loaded (e.g. after the game crashed), these changes are then replayed. To stop the journal from growing */
+/*  forever, once large enough the map is saved in the background and the journal is restarted */
+/* NOTE: Replaying changes that are already included in the map file is harmless, */
+/*  since the block changes are replayed in the same order they were originally made */
+/* Journal format:
+	U8[4] "Magic" ("CCJL")
+	U16 "Width", "Height", "Length"
+	-- then for each block change
+	U32 "Index" (see World_Pack)
+	U16 "Block"
+*/
+#define JOURNAL_HEADER_SIZE 10
+#define JOURNAL_ENTRY_SIZE  6
+/* Journal is compacted into the map file once it contains this many block changes */
+#define JOURNAL_COMPACT_ENTRIES (256 * 1024)
+
+static cc_string journal_mapPath; static char journal_mapBuffer[FILENAME_SIZE];
+static cc_bool journal_active, journal_opened;
+static struct Stream journal_stream;
+/* Number of block changes written to the journal file */
+static cc_uint32 journal_entries;
+/* Block changes that have not been written to the journal file yet */
+static cc_uint8 journal_pending[JOURNAL_ENTRY_SIZE * 1024];
+static int journal_pendingLen;
+/* Journal for the map being saved in the background, holding the block changes made since it was exported */
+static cc_uint8* journal_tail;
+static cc_uint32 journal_tailLen, journal_tailCapacity;
+static cc_bool journal_saving;
+
+static void MapJournal_GetPath(cc_string* path, const cc_string* mapPath) {
+	String_Format1(path, "%s.journal", mapPath);
+}
+
+static void MapJournal_WriteHeader(cc_uint8* data) {
+	data[0] = 'C'; data[1] = 'C'; data[2] = 'J'; data[3] = 'L';
+	Stream_SetU16_LE(data + 4, World.Width);
+	Stream_SetU16_LE(data + 6, World.Height);
+	Stream_SetU16_LE(data + 8, World.Length);
+}
+
+static void MapJournal_Close(void) {
+	if (journal_opened) (void)journal_stream.Close(&journal_stream);
+	journal_opened     = false;
+	journal_pendingLen = 0;
+}
+
+static void MapJournal_Fail(cc_result res, const char* place) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	String_InitArray(path, pathBuffer);
+	MapJournal_GetPath(&path, &journal_mapPath);
+
+	Logger_SysWarn2(res, place, &path);
+	MapJournal_Close();
+	journal_active = false;
+}
+
+static void MapJournal_Flush(void) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8 header[JOURNAL_HEADER_SIZE];
+	cc_result res;
+	if (!journal_active || !journal_pendingLen) return;
+
+	if (!journal_opened) {
+		String_InitArray(path, pathBuffer);
+		MapJournal_GetPath(&path, &journal_mapPath);
+
+		if (journal_entries) {
+			res = Stream_AppendFile(&journal_stream, &path);
+			if (res) { MapJournal_Fail(res, "appending to"); return; }
+		} else {
+			res = Stream_CreateFile(&journal_stream, &path);
+			if (res) { MapJournal_Fail(res, "creating"); return; }
+
+			journal_opened = true;
+			MapJournal_WriteHeader(header);
+			res = Stream_Write(&journal_stream, header, JOURNAL_HEADER_SIZE);
+			if (res) { MapJournal_Fail(res, "writing to"); return; }
+		}
+		journal_opened = true;
+	}
+
+	res = Stream_Write(&journal_stream, journal_pending, journal_pendingLen);
+	if (res) { MapJournal_Fail(res, "writing to"); return; }
+
+	journal_entries   += journal_pendingLen / JOURNAL_ENTRY_SIZE;
+	journal_pendingLen = 0;
+}
+
+static void MapJournal_FreeTail(void) {
+	Mem_Free(journal_tail);
+	journal_tail         = NULL;
+	journal_tailLen      = 0;
+	journal_tailCapacity = 0;
+	journal_saving       = false;
+}
+
+static void MapJournal_AddToTail(const cc_uint8* entry) {
+	cc_uint32 capacity;
+	cc_uint8* tail;
+
+	if (journal_tailLen + JOURNAL_ENTRY_SIZE > journal_tailCapacity) {
+		capacity = max(journal_tailCapacity * 2, 64 * 1024);
+		tail     = (cc_uint8*)Mem_TryRealloc(journal_tail, capacity, 1);
+		/* Saved map just won't be journalled then */
+		if (!tail) { MapJournal_FreeTail(); return; }
+
+		journal_tail         = tail;
+		journal_tailCapacity = capacity;
+	}
+
+	Mem_Copy(journal_tail + journal_tailLen, entry, JOURNAL_ENTRY_SIZE);
+	journal_tailLen += JOURNAL_ENTRY_SIZE;
+}
+
+void MapJournal_Add(int x, int y, int z, BlockID block) {
+	cc_uint8* entry;
+	if (!journal_active && !journal_saving) return;
+
+	if (journal_pendingLen == sizeof(journal_pending)) MapJournal_Flush();
+	entry = journal_pending + journal_pendingLen;
+	Stream_SetU32_LE(entry + 0, (cc_uint32)World_Pack(x, y, z));
+	Stream_SetU16_LE(entry + 4, block);
+
+	if (journal_saving) MapJournal_AddToTail(entry);
+	if (journal_active) journal_pendingLen += JOURNAL_ENTRY_SIZE;
+}
+
+/* Applies the block changes in the journal to the world, returning the number of changes applied */
+static cc_uint32 MapJournal_Replay(struct Stream* s) {
+	cc_uint8 data[JOURNAL_ENTRY_SIZE * 1024];
+	cc_uint32 i, len = 0, read, count = 0;
+	cc_uint32 index;
+	BlockID old, block;
+	int x, y, z;
+
+	if (Stream_Read(s, data, JOURNAL_HEADER_SIZE)) return 0;
+	if (data[0] != 'C' || data[1] != 'C' || data[2] != 'J' || data[3] != 'L') return 0;
+	/* Journal is for a different version of the map */
+	if (Stream_GetU16_LE(data + 4) != World.Width)  return 0;
+	if (Stream_GetU16_LE(data + 6) != World.Height) return 0;
+	if (Stream_GetU16_LE(data + 8) != World.Length) return 0;
+
+	for (;;)
+	{
+		if (s->Read(s, data + len, sizeof(data) - len, &read) || !read) break;
+		len += read;
+
+		for (i = 0; i + JOURNAL_ENTRY_SIZE <= len; i += JOURNAL_ENTRY_SIZE)
+		{
+			index = Stream_GetU32_LE(data + i);
+			block = Stream_GetU16_LE(data + i + 4);
+			if (index >= (cc_uint32)World.Volume || block >= BLOCK_COUNT) continue;
+
+			World_Unpack((int)index, x, y, z);
+			old = World_GetBlock(x, y, z);
+			World_SetBlock(x, y, z, block);
+			Physics_OnBlockUpdated(x, y, z, old, block);
+			count++;
+		}
+
+		/* Keep any partially read block change for the next read */
+		len -= i;
+		Mem_Copy(data, data + i, len);
+	}
+	/* NOTE: A partially written block change at the end (e.g. from crashing) is just ignored */
+	return count;
+}
+
+static void MapJournal_Open(const cc_string* path) {
+	static const cc_string cwExt = String_FromConst(".cw");
+	cc_string journalPath; char journalBuffer[FILENAME_SIZE];
+	struct Stream stream;
+	cc_uint32 count;
+	cc_result res;
+	if (!Server.IsSinglePlayer || !String_CaselessEnds(path, &cwExt) || !World.Blocks) return;
+
+	String_InitArray(journal_mapPath, journal_mapBuffer);
+	String_Copy(&journal_mapPath, path);
+	journal_active  = true;
+	journal_entries = 0;
+
+	String_InitArray(journalPath, journalBuffer);
+	MapJournal_GetPath(&journalPath, path);
+	/* No journal just means no changes have been made since the map was saved */
+	if ((res = Stream_OpenBufferedFile(&stream, &journalPath))) return;
+
+	count = MapJournal_Replay(&stream);
+	(void)stream.Close(&stream);
+	if (!count) return;
+
+	/* Lighting and chunk meshes were calculated for the map before the changes were replayed */
+	Lighting.Refresh();
+	MapRenderer_Refresh();
+	if (Weather_Heightmap) EnvRenderer_OnRegionChanged(0, 0, World.MaxX, World.MaxZ);
+
+	journal_entries = count;
+	Chat_Add1("&eRestored %i unsaved block changes", &count);
+}
+
+static void MapJournal_BeginSave(cc_bool journalled) {
+	MapJournal_FreeTail();
+	if (!journalled || !Server.IsSinglePlayer || !World.Blocks) return;
+
+	journal_tail = (cc_uint8*)Mem_TryAlloc(64 * 1024, 1);
+	if (!journal_tail) return;
+	journal_tailCapacity = 64 * 1024;
+	journal_tailLen      = JOURNAL_HEADER_SIZE;
+	journal_saving       = true;
+	MapJournal_WriteHeader(journal_tail);
+}
+
+/* Restarts the journal for the saved map, with just the block changes made after it was exported */
+static void MapJournal_FinishSave(const cc_string* path, cc_result res) {
+	cc_string tmpPath; char tmpBuffer[FILENAME_SIZE];
+	cc_filepath src, dst;
+	if (!journal_saving) return;
+	if (res) { MapJournal_FreeTail(); return; }
+
+	/* Block changes still pending must go to the old journal, which remains valid for the old map file */
+	MapJournal_Flush();
+	MapJournal_Close();
+
+	String_InitArray(journal_mapPath, journal_mapBuffer);
+	String_Copy(&journal_mapPath, path);
+	journal_active  = true;
+	journal_entries = (journal_tailLen - JOURNAL_HEADER_SIZE) / JOURNAL_ENTRY_SIZE;
+
+	/* Written to a separate file first, as otherwise the changes are lost if the game is killed partway through */
+	String_InitArray(tmpPath, tmpBuffer);
+	String_Format1(&tmpPath, "%s.journal.tmp", path);
+	res = Stream_WriteAllTo(&tmpPath, journal_tail, journal_tailLen);
+	MapJournal_FreeTail();
+	if (res) { MapJournal_Fail(res, "creating"); return; }
+
+	Platform_EncodePath(&src, &tmpPath);
+	tmpPath.length = 0;
+	MapJournal_GetPath(&tmpPath, path);
+	Platform_EncodePath(&dst, &tmpPath);
+	if ((res = File_Rename(&src, &dst))) MapJournal_Fail(res, "replacing");
+}
+
+static void MapJournal_Tick(void) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_result res;
+	MapJournal_Flush();
+	if (!journal_active || save_thread || journal_entries < JOURNAL_COMPACT_ENTRIES) return;
+
+	String_InitArray(path, pathBuffer);
+	String_Format1(&path, "%s.tmp", &journal_mapPath);
+	res = Map_SaveInBackground(&path, Cw_Save);
+
+	if (res) { MapJournal_Fail(res, "compacting"); return; }
+	save_compacting = true;
+}
+
+static void MapJournal_OnNewMap(void* obj) {
+	MapJournal_Flush();
+	MapJournal_Close();
+	MapJournal_FreeTail();
+	journal_active = false;
+}
+
+static void MapJournal_Free(void) {
+	MapJournal_OnNewMap(NULL);
+	Event_Unregister_(&WorldEvents.NewMap, NULL, MapJournal_OnNewMap);
+}
+#endif
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Region map format-----------------------------------------------------*
+*#########################################################################################################################*/
+/* The other formats store all the blocks as one compressed array, so the whole array has to be inflated */
+/*  before a map can be shown, and compressed again when saving even if only a few blocks were changed. */
+/* Instead .ccr files split the map into regions of REGION_SIZE x REGION_SIZE x REGION_SIZE blocks that are */
+/*  compressed separately, so that regions near the spawn can be loaded first (with the rest then being */
+/*  loaded by background jobs), and only regions changed since the map was last saved need to be written. */
+/* Changed regions are appended to the end of the existing file before its index is rewritten, */
+/*  with the whole file being rewritten instead once over half of it is taken up by stale regions.
+	U8  "Magic"[4] (CCRM)
+	U16 "Version", "Flags"
+	U16 "Width", "Height", "Length", "RegionSize"
+	U32 "MetadataOffset", "MetadataLength"
+	U32 "Index"[regions * 2] (offset and compressed length of each region, see Region_Index)
+	-- then at the offsets given in the header and index
+	U8* "Metadata" (uncompressed .cw NBT without BlockArray and BlockArray2)
+	U8* "Region" (DEFLATE compressed blocks of the region in y, z, x order, followed by the
+	   upper 8 bits of the blocks when REGION_HAS_BLOCKS2 flag is set)
+	All values are in little endian byte order */
+#define REGION_VERSION     1
+#define REGION_HEADER_SIZE 24
+#define REGION_HAS_BLOCKS2 0x01
+#define REGION_SHIFT 5
+#define REGION_SIZE  (1 << REGION_SHIFT)
+#define Region_Index(rx, ry, rz) (((ry) * region_countZ + (rz)) * region_countX + (rx))
+
+#define REGION_FLAG_DIRTY    0x01 /* Region has been changed since the map was last saved */
+#define REGION_FLAG_UNLOADED 0x02 /* Region has not been loaded from the file yet */
+/* Regions within this many blocks of the spawn are loaded before the map is shown */
+#define REGION_NEAR_DIST  96
+/* Number of regions that each background job loads */
+#define REGION_LOAD_BATCH 64
+/* Max number of background jobs that regions are compressed by in parallel when saving */
+#define REGION_SAVE_JOBS  4
+
+/* Region file the current map was loaded from or last saved to */
+static char region_pathBuffer[FILENAME_SIZE];
+static cc_string region_path = String_FromArray(region_pathBuffer);
+static int region_countX, region_countY, region_countZ, region_count;
+/* Offset and compressed length of each region within the region file */
+static cc_uint32* region_index;
+static cc_uint8*  region_flags;
+static int region_unloaded;
+static cc_bool region_hasUpper;
+static cc_uint32 region_fileEnd, region_metaLen;
+/* Incremented whenever a new map is loaded, so that jobs for the previous map can tell they are stale */
+static cc_uint32 region_mapId;
+#ifdef EXTENDED_BLOCKS
+/* Upper 8 bits of all blocks while the map is still being imported */
+static BlockRaw* region_upper;
+#endif
+
+static void Region_FreeState(void) {
+	Mem_Free(region_index);
+	Mem_Free(region_flags);
+	region_index = NULL;
+	region_flags = NULL;
+
+	region_count       = 0;
+	region_unloaded    = 0;
+	region_fileEnd     = 0;
+	region_metaLen     = 0;
+	region_path.length = 0;
+}
+
+static cc_bool Region_AllocState(void) {
+	region_countX = (World.Width  + REGION_SIZE - 1) >> REGION_SHIFT;
+	region_countY = (World.Height + REGION_SIZE - 1) >> REGION_SHIFT;
+	region_countZ = (World.Length + REGION_SIZE - 1) >> REGION_SHIFT;
+	region_count  = region_countX * region_countY * region_countZ;
+
+	region_index = (cc_uint32*)Mem_TryAllocCleared(region_count, 2 * sizeof(cc_uint32));
+	region_flags = (cc_uint8*)Mem_TryAllocCleared(region_count, 1);
+	if (region_index && region_flags) return true;
+
+	Region_FreeState();
+	return false;
+}
+
+/* Calculates the area of the map covered by the given region (max is exclusive) */
+static void Region_GetBounds(int i, IVec3* min, IVec3* max) {
+	min->x = (i % region_countX) << REGION_SHIFT;
+	min->z = ((i / region_countX) % region_countZ) << REGION_SHIFT;
+	min->y = (i / (region_countX * region_countZ)) << REGION_SHIFT;
+
+	max->x = min(World.Width,  min->x + REGION_SIZE);
+	max->y = min(World.Height, min->y + REGION_SIZE);
+	max->z = min(World.Length, min->z + REGION_SIZE);
+}
+
+static cc_uint32 Region_RawSize(int i, cc_bool upper) {
+	IVec3 min, max;
+	cc_uint32 size;
+	Region_GetBounds(i, &min, &max);
+
+	size = (max.x - min.x) * (max.y - min.y) * (max.z - min.z);
+	return upper ? size * 2 : size;
+}
+
+/* Copies the blocks of the given region out of the world */
+static void Region_Export(int i, cc_uint8* dst, cc_bool upper) {
+	int x, y, z, index, width;
+	cc_uint8* upperDst;
+	IVec3 min, max;
+	Region_GetBounds(i, &min, &max);
+
+	width    = max.x - min.x;
+	upperDst = dst + width * (max.y - min.y) * (max.z - min.z);
+
+	for (y = min.y; y < max.y; y++) {
+		for (z = min.z; z < max.z; z++)
+		{
+			index = World_Pack(min.x, y, z);
+			Mem_Copy(dst, World.Blocks + index, width);
+			dst += width;
+#ifdef EXTENDED_BLOCKS
+			if (!upper) continue;
+			/* Upper blocks may be stored in separate pages */
+			for (x = 0; x < width; x++) { *upperDst++ = World_GetUpperBlock(index + x); }
+#endif
+		}
+	}
+}
+
+/* Copies the blocks of the given region into the world */
+static void Region_Import(int i, const cc_uint8* src, cc_bool upper) {
+	int x, y, z, index, width;
+	const cc_uint8* upperSrc;
+	IVec3 min, max;
+#ifdef EXTENDED_BLOCKS
+	int hi;
+#endif
+	Region_GetBounds(i, &min, &max);
+
+	width    = max.x - min.x;
+	upperSrc = src + width * (max.y - min.y) * (max.z - min.z);
+
+	for (y = min.y; y < max.y; y++) {
+		for (z = min.z; z < max.z; z++)
+		{
+			index = World_Pack(min.x, y, z);
+			Mem_Copy(World.Blocks + index, src, width);
+#ifdef EXTENDED_BLOCKS
+			if (region_upper) {
+				if (upper) Mem_Copy(region_upper + index, upperSrc, width);
+			} else if (upper || World.IDMask > 0xFF) {
+				/* Upper blocks are stored in pages that may not have been allocated yet */
+				for (x = 0; x < width; x++)
+				{
+					hi = upper ? upperSrc[x] : 0;
+					if (!hi && (World.IDMask <= 0xFF || !World_GetUpperBlock(index + x))) continue;
+					World_SetBlock(min.x + x, y, z, src[x] | (hi << 8));
+				}
+			}
+#endif
+			src      += width;
+			upperSrc += width;
+		}
+	}
+}
+
+/* Decompresses the blocks of a region stored at the given offset in the region file */
+static cc_result Region_Inflate(struct Stream* file, struct InflateState* inflate, cc_uint32 offset,
+								cc_uint32 compLen, cc_uint8* dst, cc_uint32 rawLen) {
+	struct Stream portion, compStream;
+	cc_result res;
+	if ((res = file->Seek(file, offset))) return res;
+
+	Stream_ReadonlyPortion(&portion, file, compLen);
+	Inflate_MakeStream2(&compStream, inflate, &portion);
+	Inflate_SetOutputBuffer(inflate, dst, rawLen);
+	return Stream_Read(&compStream, dst, rawLen);
+}
+
+/* Updates everything calculated from the blocks of a region that was loaded after the map was shown */
+static void Region_Refresh(int i) {
+	IVec3 min, max;
+	Region_GetBounds(i, &min, &max);
+	Game_RefreshBlocks(min.x, min.y, min.z, max.x - 1, max.y - 1, max.z - 1);
+}
+
+/* Copies the blocks of a region that was loaded after the map was shown into the world */
+/* NOTE: Any changes made to the region before it was loaded are overwritten */
+static void Region_Apply(int i, const cc_uint8* data) {
+	if (!(region_flags[i] & REGION_FLAG_UNLOADED)) return;
+	Physics_FinishTick();
+
+	Region_Import(i, data, region_hasUpper);
+	region_flags[i] &= ~REGION_FLAG_UNLOADED;
+	region_unloaded--;
+	Region_Refresh(i);
+}
+
+void MapRegions_MarkChanged(int x, int y, int z) {
+	if (!region_flags) return;
+	region_flags[Region_Index(x >> REGION_SHIFT, y >> REGION_SHIFT, z >> REGION_SHIFT)] |= REGION_FLAG_DIRTY;
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Region map loading-----------------------------------------------------*
+*#########################################################################################################################*/
+static cc_result Region_ReadIndex(struct Stream* stream) {
+	cc_uint8 data[4096];
+	cc_uint32 i, count, total = region_count * 2;
+	cc_result res;
+
+	for (i = 0; i < total; i += count)
+	{
+		count = min(total - i, sizeof(data) / 4);
+		if ((res = Stream_Read(stream, data, count * 4))) return res;
+
+		for (count = 0; count < sizeof(data) / 4 && i + count < total; count++)
+		{
+			region_index[i + count] = Stream_GetU32_LE(data + count * 4);
+		}
+	}
+	return 0;
+}
+
+/* Whether the given region is horizontally within REGION_NEAR_DIST blocks of the given position */
+static cc_bool Region_IsNear(int i, int x, int z) {
+	IVec3 min, max;
+	int dx, dz;
+	Region_GetBounds(i, &min, &max);
+
+	dx = x < min.x ? min.x - x : (x >= max.x ? x - max.x + 1 : 0);
+	dz = z < min.z ? min.z - z : (z >= max.z ? z - max.z + 1 : 0);
+	return dx * dx + dz * dz <= REGION_NEAR_DIST * REGION_NEAR_DIST;
+}
+
+/* Loads the regions near the spawn, and marks all the others as needing to be loaded afterwards */
+static cc_result Region_LoadNear(struct Stream* stream) {
+	struct InflateState* inflate;
+	cc_uint8* data;
+	int i, x, z;
+	cc_bool all;
+	cc_result res = 0;
+
+	if (spawn_point->flags & LU_HAS_POS) {
+		x = (int)spawn_point->pos.x; z = (int)spawn_point->pos.z;
+	} else {
+		x = World.Width / 2; z = World.Length / 2;
+	}
+	/* No point loading a small map in the background */
+	all = region_count <= REGION_LOAD_BATCH;
+
+	inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	data    = (cc_uint8*)Mem_TryAlloc(Region_RawSize(0, region_hasUpper), 1);
+	if (!inflate || !data) { res = ERR_OUT_OF_MEMORY; goto cleanup; }
+
+	for (i = 0; i < region_count; i++)
+	{
+		if (!all && !Region_IsNear(i, x, z)) {
+			region_flags[i] = REGION_FLAG_UNLOADED;
+			region_unloaded++; continue;
+		}
+
+		res = Region_Inflate(stream, inflate, region_index[i * 2], region_index[i * 2 + 1],
+							data, Region_RawSize(i, region_hasUpper));
+		if (res) break;
+		Region_Import(i, data, region_hasUpper);
+	}
+
+cleanup:
+	Mem_Free(inflate);
+	Mem_Free(data);
+	return res;
+}
+
+static cc_result Region_Load(struct Stream* stream) {
+	cc_uint8 header[REGION_HEADER_SIZE];
+	int width, height, length, flags;
+	cc_uint32 metaOffset;
+	cc_result res;
+
+	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
+	if (!Mem_Equal(header, "CCRM", 4))                         return CCR_ERR_IDENTIFIER;
+	if (Stream_GetU16_LE(&header[4]) != REGION_VERSION)        return CCR_ERR_VERSION;
+	if (Stream_GetU16_LE(&header[14]) != REGION_SIZE)          return CCR_ERR_VERSION;
+
+	flags  = Stream_GetU16_LE(&header[6]);
+	width  = Stream_GetU16_LE(&header[8]);
+	height = Stream_GetU16_LE(&header[10]);
+	length = Stream_GetU16_LE(&header[12]);
+	metaOffset     = Stream_GetU32_LE(&header[16]);
+	region_metaLen = Stream_GetU32_LE(&header[20]);
+
+	/* Metadata is exactly the same as in .cw files, so just reuse the .cw importer for it */
+	if ((res = stream->Seek(stream, metaOffset)))     return res;
+	if ((res = Nbt_ReadRoot(stream, NULL, &cw_handlers))) return res;
+	if (World.Width != width || World.Height != height || World.Length != length) return CCR_ERR_DIMENSIONS;
+	if (!width || !height || !length) return CCR_ERR_DIMENSIONS;
+
+	World.Volume = width * height * length;
+	World.Blocks = (BlockRaw*)Mem_TryAllocCleared(World.Volume, 1);
+	if (!World.Blocks) return ERR_OUT_OF_MEMORY;
+
+	region_hasUpper = false;
+	if (flags & REGION_HAS_BLOCKS2) {
+#ifdef EXTENDED_BLOCKS
+		region_upper = (BlockRaw*)Mem_TryAllocCleared(World.Volume, 1);
+		if (!region_upper) return ERR_OUT_OF_MEMORY;
+
+		World_SetMapUpper(region_upper);
+		region_hasUpper = true;
+#else
+		return ERR_NOT_SUPPORTED;
+#endif
+	}
+
+	if (!Region_AllocState()) return ERR_OUT_OF_MEMORY;
+	if ((res = stream->Seek(stream, REGION_HEADER_SIZE))) goto failed;
+	if ((res = Region_ReadIndex(stream)))                 goto failed;
+	if ((res = stream->Length(stream, &region_fileEnd)))  goto failed;
+	if ((res = Region_LoadNear(stream)))                  goto failed;
+
+#ifdef EXTENDED_BLOCKS
+	region_upper = NULL;
+#endif
+	String_Copy(&region_path, import_path);
+	return 0;
+
+failed:
+#ifdef EXTENDED_BLOCKS
+	region_upper = NULL;
+#endif
+	Region_FreeState();
+	return res;
+}
+
+struct RegionLoadJob {
+	struct GameJob job;
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_uint32 mapId;
+	cc_bool upper;
+	cc_result res;
+	int count;
+	int regions[REGION_LOAD_BATCH];
+	cc_uint32 offsets[REGION_LOAD_BATCH], lengths[REGION_LOAD_BATCH];
+	/* Offset of each region's blocks within data */
+	cc_uint32 rawOffsets[REGION_LOAD_BATCH + 1];
+	cc_uint8* data;
+};
+
+static void RegionLoadJob_Run(struct GameJob* job) {
+	struct RegionLoadJob* j = (struct RegionLoadJob*)job;
+	struct InflateState* inflate;
+	struct Stream file;
+	int i;
+
+	j->data = (cc_uint8*)Mem_TryAlloc(j->rawOffsets[j->count], 1);
+	inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	if (!j->data || !inflate) { j->res = ERR_OUT_OF_MEMORY; Mem_Free(inflate); return; }
+
+	if (!(j->res = Stream_OpenFile(&file, &j->path))) {
+		for (i = 0; i < j->count && !j->res; i++)
+		{
+			j->res = Region_Inflate(&file, inflate, j->offsets[i], j->lengths[i],
+									j->data + j->rawOffsets[i], j->rawOffsets[i + 1] - j->rawOffsets[i]);
+		}
+		/* No point logging error for closing readonly file */
+		(void)file.Close(&file);
+	}
+	Mem_Free(inflate);
+}
+
+static void RegionLoadJob_Finish(struct GameJob* job) {
+	struct RegionLoadJob* j = (struct RegionLoadJob*)job;
+	int i;
+
+	/* Regions that failed to load are left for Region_FinishLoading to try again */
+	if (job->cancelled || j->mapId != region_mapId) {
+	} else if (j->res) {
+		Logger_SysWarn2(j->res, "loading regions from", &j->path);
+	} else {
+		for (i = 0; i < j->count; i++)
+		{
+			Region_Apply(j->regions[i], j->data + j->rawOffsets[i]);
+		}
+	}
+
+	Mem_Free(j->data);
+	Mem_Free(j);
+}
+
+static int* region_sortKeys;
+static int* region_sortValues;
+static void Region_QuickSort(int left, int right) {
+	int* keys = region_sortKeys; int key;
+	int* values = region_sortValues; int value;
+
+	while (left < right) {
+		int i = left, j = right;
+		int pivot = keys[(i + j) >> 1];
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i]) i++;
+			while (pivot < keys[j]) j--;
+			QuickSort_Swap_KV_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(Region_QuickSort)
+	}
+}
+
+/* Queues up jobs to load the remaining regions of the map, starting with those closest to the player */
+static void Region_StartLoading(void) {
+	Vec3 pos = Entities.CurPlayer->Base.Position;
+	struct RegionLoadJob* job = NULL;
+	int i, n, count = 0, dx, dy, dz;
+	IVec3 min, max;
+	if (!region_unloaded) return;
+
+	region_sortKeys   = (int*)Mem_TryAlloc(region_unloaded, sizeof(int));
+	region_sortValues = (int*)Mem_TryAlloc(region_unloaded, sizeof(int));
+	if (!region_sortKeys || !region_sortValues) goto cleanup;
+
+	for (i = 0; i < region_count; i++)
+	{
+		if (!(region_flags[i] & REGION_FLAG_UNLOADED)) continue;
+		Region_GetBounds(i, &min, &max);
+
+		dx = (min.x + max.x) / 2 - (int)pos.x;
+		dy = (min.y + max.y) / 2 - (int)pos.y;
+		dz = (min.z + max.z) / 2 - (int)pos.z;
+		region_sortKeys[count]   = dx * dx + dy * dy + dz * dz;
+		region_sortValues[count] = i;
+		count++;
+	}
+	Region_QuickSort(0, count - 1);
+
+	for (n = 0; n < count; n++)
+	{
+		if (!job) {
+			job = (struct RegionLoadJob*)Mem_TryAllocCleared(1, sizeof(struct RegionLoadJob));
+			/* Remaining regions are just loaded by Region_FinishLoading then */
+			if (!job) break;
+
+			job->job.Run    = RegionLoadJob_Run;
+			job->job.Finish = RegionLoadJob_Finish;
+			job->mapId = region_mapId;
+			job->upper = region_hasUpper;
+			String_InitArray(job->path, job->pathBuffer);
+			String_Copy(&job->path, &region_path);
+		}
+
+		i = region_sortValues[n];
+		job->regions[job->count] = i;
+		job->offsets[job->count] = region_index[i * 2];
+		job->lengths[job->count] = region_index[i * 2 + 1];
+		job->rawOffsets[job->count + 1] = job->rawOffsets[job->count] + Region_RawSize(i, region_hasUpper);
+		job->count++;
+
+		if (job->count < REGION_LOAD_BATCH && n < count - 1) continue;
+		Game_QueueJob(&job->job);
+		job = NULL;
+	}
+
+cleanup:
+	Mem_Free(region_sortKeys);
+	Mem_Free(region_sortValues);
+	region_sortKeys   = NULL;
+	region_sortValues = NULL;
+}
+
+/* Loads all of the regions of the map that have not been loaded yet */
+static cc_result Region_FinishLoading(void) {
+	struct InflateState* inflate;
+	struct Stream file;
+	cc_uint8* data;
+	cc_result res = 0;
+	int i;
+	if (!region_unloaded) return 0;
+
+	inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	data    = (cc_uint8*)Mem_TryAlloc(Region_RawSize(0, region_hasUpper), 1);
+	if (!inflate || !data) { res = ERR_OUT_OF_MEMORY; goto cleanup; }
+	if ((res = Stream_OpenBufferedFile(&file, &region_path))) goto cleanup;
+
+	for (i = 0; i < region_count; i++)
+	{
+		if (!(region_flags[i] & REGION_FLAG_UNLOADED)) continue;
+
+		res = Region_Inflate(&file, inflate, region_index[i * 2], region_index[i * 2 + 1],
+							data, Region_RawSize(i, region_hasUpper));
+		if (res) break;
+		Region_Apply(i, data);
+	}
+	(void)file.Close(&file);
+
+cleanup:
+	if (res) Logger_SysWarn2(res, "loading regions from", &region_path);
+	Mem_Free(inflate);
+	Mem_Free(data);
+	return res;
+}
+
+static void Region_OnNewMap(void* obj) {
+	Region_FreeState();
+	region_mapId++;
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Region map saving-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Appends data to a growable block of memory, which is at meta.mem.base and meta.mem.length bytes long */
+static cc_result RegionBuffer_Write(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	cc_uint32 capacity;
+	cc_uint8* buffer;
+
+	if (count > s->meta.mem.left) {
+		capacity = max((s->meta.mem.length + s->meta.mem.left) * 2, s->meta.mem.length + count);
+		capacity = max(capacity, 64 * 1024);
+		buffer   = (cc_uint8*)Mem_TryRealloc(s->meta.mem.base, capacity, 1);
+		if (!buffer) return ERR_OUT_OF_MEMORY;
+
+		s->meta.mem.base = buffer;
+		s->meta.mem.left = capacity - s->meta.mem.length;
+	}
+
+	Mem_Copy(s->meta.mem.base + s->meta.mem.length, data, count);
+	s->meta.mem.length += count;
+	s->meta.mem.left   -= count;
+	*modified = count;
+	return 0;
+}
+
+static void RegionBuffer_Init(struct Stream* s) {
+	Stream_Init(s);
+	s->Write = RegionBuffer_Write;
+	s->meta.mem.base   = NULL;
+	s->meta.mem.length = 0;
+	s->meta.mem.left   = 0;
+}
+
+/* Compresses some of the regions being saved */
+struct RegionCompressJob {
+	struct GameJob job;
+	int first;          /* Index of first region within region_save.regions */
+	cc_uint8* raw;      /* Blocks of every region being compressed by this job */
+	struct Stream out;  /* Compressed blocks of every region compressed by this job */
+	cc_result res;
+};
+
+static struct RegionSave {
+	struct GameJob job; /* Writes everything to the file once all the regions have been compressed */
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_filepath tmpPath, dstPath;
+	cc_uint32 mapId;
+	cc_bool active, background, incremental, replace;
+	cc_uint8 header[REGION_HEADER_SIZE];
+	int count;          /* Number of regions in the map */
+	int numSaved;       /* Number of regions being saved */
+	int* regions;       /* Regions being saved */
+	cc_uint32* rawSizes;/* Size of the raw blocks of each region being saved */
+	cc_uint32* lengths; /* Compressed length of each region being saved */
+	cc_uint8* wasDirty; /* Whether each region being saved was changed, to restore if saving fails */
+	cc_uint32* index;   /* Index of the file after saving */
+	cc_uint32 fileEnd;  /* Where the regions are written from */
+	struct Stream meta;
+	int numJobs, jobsLeft;
+	struct RegionCompressJob jobs[REGION_SAVE_JOBS];
+	cc_result res;
+	const char* place;
+} region_save;
+
+static void RegionSave_Free(void) {
+	int i;
+	for (i = 0; i < REGION_SAVE_JOBS; i++)
+	{
+		Mem_Free(region_save.jobs[i].raw);
+		Mem_Free(region_save.jobs[i].out.meta.mem.base);
+		region_save.jobs[i].raw = NULL;
+		region_save.jobs[i].out.meta.mem.base = NULL;
+	}
+
+	Mem_Free(region_save.regions);
+	Mem_Free(region_save.rawSizes);
+	Mem_Free(region_save.lengths);
+	Mem_Free(region_save.wasDirty);
+	Mem_Free(region_save.index);
+	Mem_Free(region_save.meta.meta.mem.base);
+
+	region_save.regions  = NULL;
+	region_save.rawSizes = NULL;
+	region_save.lengths  = NULL;
+	region_save.wasDirty = NULL;
+	region_save.index    = NULL;
+	region_save.meta.meta.mem.base = NULL;
+	region_save.active   = false;
+}
+
+/* Runs the given job immediately on the main thread, or queues it to be run on a worker thread */
+static void Region_RunJob(struct GameJob* job, cc_bool background) {
+	if (background) { Game_QueueJob(job); return; }
+	job->cancelled = false;
+	job->Run(job);
+	job->Finish(job);
+}
+
+static void RegionCompressJob_Run(struct GameJob* job) {
+	struct RegionCompressJob* c = (struct RegionCompressJob*)job;
+	struct DeflateState* state;
+	struct Stream compStream;
+	cc_uint32 start, rawPos = 0;
+	int i;
+
+	state = (struct DeflateState*)Mem_TryAlloc(1, sizeof(struct DeflateState));
+	if (!state) { c->res = ERR_OUT_OF_MEMORY; return; }
+
+	for (i = c->first; i < region_save.numSaved && !c->res; i += region_save.numJobs)
+	{
+		start = c->out.meta.mem.length;
+		Deflate_MakeStream(&compStream, state, &c->out);
+
+		c->res = Stream_Write(&compStream, c->raw + rawPos, region_save.rawSizes[i]);
+		if (!c->res) c->res = compStream.Close(&compStream);
+
+		region_save.lengths[i] = c->out.meta.mem.length - start;
+		rawPos += region_save.rawSizes[i];
+	}
+	Mem_Free(state);
+}
+
+static void RegionCompressJob_Finish(struct GameJob* job) {
+	struct RegionCompressJob* c = (struct RegionCompressJob*)job;
+	/* Still save the map when the game is closed before the job was run */
+	if (job->cancelled) RegionCompressJob_Run(job);
+
+	if (c->res && !region_save.res) {
+		region_save.res   = c->res;
+		region_save.place = "compressing";
+	}
+	Mem_Free(c->raw);
+	c->raw = NULL;
+
+	if (--region_save.jobsLeft) return;
+	Region_RunJob(&region_save.job, region_save.background && !job->cancelled);
+}
+
+static void RegionSave_MakeHeader(cc_uint32 metaOffset) {
+	cc_uint8* header = region_save.header;
+
+	Mem_Copy(header, "CCRM", 4);
+	Stream_SetU16_LE(&header[4],  REGION_VERSION);
+	Stream_SetU32_LE(&header[16], metaOffset);
+	Stream_SetU32_LE(&header[20], region_save.meta.meta.mem.length);
+}
+
+static cc_result RegionSave_WriteIndex(struct Stream* s) {
+	cc_uint8 data[4096];
+	cc_uint32 i, count, total = region_save.count * 2;
+	cc_result res;
+
+	if ((res = Stream_Write(s, region_save.header, REGION_HEADER_SIZE))) return res;
+
+	for (i = 0; i < total; i += count)
+	{
+		for (count = 0; count < sizeof(data) / 4 && i + count < total; count++)
+		{
+			Stream_SetU32_LE(data + count * 4, region_save.index[i + count]);
+		}
+		if ((res = Stream_Write(s, data, count * 4))) return res;
+	}
+	return 0;
+}
+
+static cc_result RegionSave_WriteData(struct Stream* s) {
+	cc_uint32 offset = region_save.fileEnd;
+	cc_uint32 jobOffsets[REGION_SAVE_JOBS] = { 0 };
+	cc_result res;
+	int i, j, r;
+
+	/* Work out where each region ends up before writing anything */
+	for (i = 0; i < region_save.numSaved; i++)
+	{
+		r = region_save.regions[i];
+		region_save.index[r * 2]     = offset;
+		region_save.index[r * 2 + 1] = region_save.lengths[i];
+		offset += region_save.lengths[i];
+	}
+	RegionSave_MakeHeader(offset);
+
+	/* A partially written new file is fine since it replaces the old file afterwards, */
+	/*  whereas the existing file is only changed to use the new regions after they were written */
+	if (!region_save.incremental && (res = RegionSave_WriteIndex(s))) return res;
+	if ((res = s->Seek(s, region_save.fileEnd))) return res;
+
+	for (i = 0; i < region_save.numSaved; i++)
+	{
+		j   = i % region_save.numJobs;
+		res = Stream_Write(s, region_save.jobs[j].out.meta.mem.base + jobOffsets[j], region_save.lengths[i]);
+		if (res) return res;
+		jobOffsets[j] += region_save.lengths[i];
+	}
+
+	res = Stream_Write(s, region_save.meta.meta.mem.base, region_save.meta.meta.mem.length);
+	if (res) return res;
+	region_save.fileEnd = offset + region_save.meta.meta.mem.length;
+
+	if (!region_save.incremental) return 0;
+	if ((res = s->Seek(s, 0))) return res;
+	return RegionSave_WriteIndex(s);
+}
+
+static void RegionSave_Run(struct GameJob* job) {
+	struct Stream stream;
+	cc_result res;
+	if (region_save.res) return;
+
+	if (region_save.incremental) {
+		res = Stream_AppendFile(&stream, &region_save.path);
+		if (res) { region_save.place = "appending to"; goto finished; }
+	} else {
+		res = Stream_CreateFile(&stream, &region_save.path);
+		if (res) { region_save.place = "creating"; goto finished; }
+	}
+
+	res = RegionSave_WriteData(&stream);
+	if (res) {
+		region_save.place = "writing";
+		stream.Close(&stream);
+	} else if ((res = stream.Close(&stream))) {
+		region_save.place = "closing";
+	}
+
+#ifdef CC_BUILD_FILERENAME
+	if (!res && region_save.replace) {
+		res = File_Rename(&region_save.tmpPath, &region_save.dstPath);
+		if (res) region_save.place = "replacing";
+	}
+#endif
+
+finished:
+	region_save.res = res;
+}
+
+static void RegionSave_Finish(struct GameJob* job) {
+	cc_result res;
+	int i, r;
+	if (job->cancelled) RegionSave_Run(job);
+	res = region_save.res;
+
+	/* Remove the .tmp suffix */
+	if (region_save.replace) region_save.path.length -= 4;
+
+	if (region_save.mapId != region_mapId) {
+		/* Map was changed while being saved */
+	} else if (res) {
+		for (i = 0; i < region_save.numSaved; i++)
+		{
+			r = region_save.regions[i];
+			if (region_save.wasDirty[i]) region_flags[r] |= REGION_FLAG_DIRTY;
+		}
+	} else {
+		/* Later saves can then just append the regions changed since */
+		String_Copy(&region_path, &region_save.path);
+		Mem_Free(region_index);
+		region_index       = region_save.index;
+		region_save.index  = NULL;
+		region_fileEnd     = region_save.fileEnd;
+		region_metaLen     = region_save.meta.meta.mem.length;
+		region_hasUpper    = (region_save.header[6] & REGION_HAS_BLOCKS2) != 0;
+	}
+
+	if (res) {
+		Logger_SysWarn2(res, region_save.place, &region_save.path);
+	} else {
+		World.LastSave = Game.Time;
+		Chat_Add1("&eSaved map to: %s", &region_save.path);
+	}
+	RegionSave_Free();
+}
+
+/* Whether only the changed regions need to be appended to the region file the map was loaded from */
+static cc_bool RegionSave_CanAppend(const cc_string* path, cc_bool upper) {
+	cc_uint32 used;
+	int i;
+	if (!region_path.length || !String_Equals(path, &region_path)) return false;
+	if (upper != region_hasUpper) return false;
+
+	used = REGION_HEADER_SIZE + region_count * 8 + region_metaLen;
+	for (i = 0; i < region_count; i++) { used += region_index[i * 2 + 1]; }
+
+	/* Rewrite the whole file once over half of it is stale regions */
+	return region_fileEnd - used <= used;
+}
+
+static cc_result RegionSave_Snapshot(cc_bool upper) {
+	struct RegionCompressJob* c;
+	cc_uint32 rawSize;
+	cc_result res;
+	int i, r, n = 0;
+
+	for (i = 0; i < region_count; i++)
+	{
+		if (!region_save.incremental || (region_flags[i] & REGION_FLAG_DIRTY)) n++;
+	}
+	region_save.count    = region_count;
+	region_save.numSaved = n;
+
+	region_save.regions  = (int*)Mem_TryAlloc(n + 1, sizeof(int));
+	region_save.rawSizes = (cc_uint32*)Mem_TryAlloc(n + 1, sizeof(cc_uint32));
+	region_save.lengths  = (cc_uint32*)Mem_TryAllocCleared(n + 1, sizeof(cc_uint32));
+	region_save.wasDirty = (cc_uint8*)Mem_TryAlloc(n + 1, 1);
+	region_save.index    = (cc_uint32*)Mem_TryAlloc(region_count, 2 * sizeof(cc_uint32));
+	if (!region_save.regions || !region_save.rawSizes || !region_save.lengths) return ERR_OUT_OF_MEMORY;
+	if (!region_save.wasDirty || !region_save.index) return ERR_OUT_OF_MEMORY;
+	Mem_Copy(region_save.index, region_index, region_count * 2 * sizeof(cc_uint32));
+
+	for (i = 0, r = 0; r < region_count; r++)
+	{
+		if (region_save.incremental && !(region_flags[r] & REGION_FLAG_DIRTY)) continue;
+		region_save.regions[i]  = r;
+		region_save.rawSizes[i] = Region_RawSize(r, upper);
+		region_save.wasDirty[i] = region_flags[r] & REGION_FLAG_DIRTY;
+		i++;
+	}
+
+	/* Each job compresses every numJobs'th region */
+	region_save.numJobs = region_save.background ? min(REGION_SAVE_JOBS, max(n, 1)) : 1;
+	for (i = 0; i < region_save.numJobs; i++)
+	{
+		c = &region_save.jobs[i];
+		c->first = i;
+		c->res   = 0;
+		c->job.Run    = RegionCompressJob_Run;
+		c->job.Finish = RegionCompressJob_Finish;
+		RegionBuffer_Init(&c->out);
+
+		for (rawSize = 0, r = i; r < n; r += region_save.numJobs) { rawSize += region_save.rawSizes[r]; }
+		c->raw = (cc_uint8*)Mem_TryAlloc(rawSize + 1, 1);
+		if (!c->raw) return ERR_OUT_OF_MEMORY;
+
+		for (rawSize = 0, r = i; r < n; r += region_save.numJobs)
+		{
+			Region_Export(region_save.regions[r], c->raw + rawSize, upper);
+			rawSize += region_save.rawSizes[r];
+		}
+	}
+
+	RegionBuffer_Init(&region_save.meta);
+	if ((res = Cw_WriteMap(&region_save.meta, false))) return res;
+
+	Mem_Set(region_save.header, 0, REGION_HEADER_SIZE);
+	Stream_SetU16_LE(&region_save.header[6],  upper ? REGION_HAS_BLOCKS2 : 0);
+	Stream_SetU16_LE(&region_save.header[8],  World.Width);
+	Stream_SetU16_LE(&region_save.header[10], World.Height);
+	Stream_SetU16_LE(&region_save.header[12], World.Length);
+	Stream_SetU16_LE(&region_save.header[14], REGION_SIZE);
+
+	/* Block changes made from now on need to be included in the next save */
+	for (i = 0; i < n; i++) { region_flags[region_save.regions[i]] &= ~REGION_FLAG_DIRTY; }
+	return 0;
+}
+
+cc_result Map_SaveRegions(const cc_string* path, cc_bool background) {
+	cc_bool upper = false;
+	cc_string tmpPath; char tmpBuffer[FILENAME_SIZE];
+	cc_result res;
+	int i;
+
+	if (region_save.active) {
+		Chat_AddRaw("&eMap is still being saved, try again shortly");
+		return 0;
+	}
+	if (!World.Blocks) return ERR_NOT_SUPPORTED;
+	if ((res = Region_FinishLoading())) return res;
+#ifdef EXTENDED_BLOCKS
+	upper = World.IDMask > 0xFF;
+#endif
+
+	/* A map that was not loaded from a region file needs to be split into regions first */
+	if (!region_flags && !Region_AllocState()) return ERR_OUT_OF_MEMORY;
+	region_save.incremental = RegionSave_CanAppend(path, upper);
+	region_save.background  = background;
+	region_save.mapId       = region_mapId;
+	region_save.res         = 0;
+	region_save.replace     = false;
+
+	String_InitArray(region_save.path, region_save.pathBuffer);
+	String_Copy(&region_save.path, path);
+
+	if (region_save.incremental) {
+		region_save.fileEnd = region_fileEnd;
+	} else {
+		region_save.fileEnd = REGION_HEADER_SIZE + region_count * 8;
+#ifdef CC_BUILD_FILERENAME
+		/* Written to a separate file first, so that the old file is still intact if saving fails partway */
+		String_InitArray(tmpPath, tmpBuffer);
+		String_Format1(&tmpPath, "%s.tmp", path);
+		Platform_EncodePath(&region_save.tmpPath, &tmpPath);
+		Platform_EncodePath(&region_save.dstPath, path);
+
+		String_Copy(&region_save.path, &tmpPath);
+		region_save.replace = true;
+#endif
+	}
+
+	region_save.active = true;
+	if ((res = RegionSave_Snapshot(upper))) {
+		RegionSave_Free(); return res;
+	}
+
+	region_save.job.Run    = RegionSave_Run;
+	region_save.job.Finish = RegionSave_Finish;
+	region_save.jobsLeft   = region_save.numJobs;
+
+	for (i = 0; i < region_save.numJobs; i++)
+	{
+		Region_RunJob(&region_save.jobs[i].job, background);
+	}
+	return 0;
+}
+
+static void Region_Free(void) {
+	Region_FreeState();
+	Event_Unregister_(&WorldEvents.NewMap, NULL, Region_OnNewMap);
+}
+
+/*########################################################################################################################*
+*-------------------------------------------------Fast-load map cache-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Reloading a large .cw map means inflating and parsing the whole file again, then recalculating */
+/*  the lighting heightmap. So after a .cw map is loaded, a '.cache' file is written next to it, which stores */
+/*  the block arrays uncompressed and the fully calculated heightmap, for reading straight into memory. */
+/* The cache is only used while the .cw file's size and gzip footer (CRC32 and uncompressed size) */
+/*  match those stored in it, and while its UUID matches that of the map's metadata.
+	U8  "Magic"[4] (CCMC)
+	U16 "Version", "ByteOrder" (ByteOrder is 1 in native byte order, as heightmap is stored natively)
+	U8  "Source"[12] (U32 length, then last 8 bytes of the .cw file)
+	U8  "UUID"[16]
+	U16 "Width", "Height", "Length", "Flags"
+	U32 "LightingCRC" (CRC32 of lighting properties of all blocks when heightmap was calculated)
+	U32 "MetadataLength"
+	U8* "Metadata" (uncompressed .cw NBT without BlockArray and BlockArray2)
+	U8* "Blocks"
+	U8* "Blocks2" (only when MAPCACHE_HAS_BLOCKS2 flag is set)
+	I16* "Heightmap" (only when MAPCACHE_HAS_HEIGHTMAP flag is set)
+	All values except for Heightmap are in little endian byte order */
+#define MAPCACHE_VERSION       1
+#define MAPCACHE_HEADER_SIZE   52
+#define MAPCACHE_HAS_BLOCKS2   0x01
+#define MAPCACHE_HAS_HEIGHTMAP 0x02
+
+static cc_uint8 cache_source[12];
+static cc_bool  cache_stale;
+static cc_int16* cache_heightmap;
+
+static void MapCache_GetPath(const cc_string* path, cc_string* cachePath) {
+	String_Format1(cachePath, "%s.cache", path);
+}
+
+static cc_uint32 MapCache_LightingCRC(void) {
+	cc_uint32 crc = Utils_CRC32((const cc_uint8*)Blocks.BlocksLight, sizeof(Blocks.BlocksLight));
+	return crc ^ (Utils_CRC32(Blocks.LightOffset, sizeof(Blocks.LightOffset)) * 31);
+}
+
+/* Reads the size and gzip footer of the .cw file, then seeks back to the start */
+static cc_result MapCache_ReadSource(struct Stream* src) {
+	cc_uint32 length;
+	cc_result res;
+
+	if ((res = src->Length(src, &length))) return res;
+	if (length < 8) return ERR_END_OF_STREAM;
+	Stream_SetU32_LE(cache_source, length);
+
+	if ((res = src->Seek(src, length - 8)))            return res;
+	if ((res = Stream_Read(src, cache_source + 4, 8))) return res;
+	return src->Seek(src, 0);
+}
+
+static cc_result MapCache_Read(struct Stream* s) {
+	cc_uint8 header[MAPCACHE_HEADER_SIZE];
+	cc_uint16 byteOrder = 1;
+	int width, height, length, flags;
+	cc_uint32 metaLength;
+	cc_result res;
+#ifdef EXTENDED_BLOCKS
+	BlockRaw* blocks2;
+#endif
+
+	if ((res = Stream_Read(s, header, sizeof(header)))) return res;
+	if (!Mem_Equal(header, "CCMC", 4))                     return ERR_NOT_SUPPORTED;
+	if (Stream_GetU16_LE(&header[4]) != MAPCACHE_VERSION)  return ERR_NOT_SUPPORTED;
+	if (!Mem_Equal(&header[6], &byteOrder, 2))             return ERR_NOT_SUPPORTED;
+	if (!Mem_Equal(&header[8], cache_source, 12))          return ERR_NOT_SUPPORTED;
+
+	width  = Stream_GetU16_LE(&header[36]);
+	height = Stream_GetU16_LE(&header[38]);
+	length = Stream_GetU16_LE(&header[40]);
+	flags  = Stream_GetU16_LE(&header[42]);
+	metaLength = Stream_GetU32_LE(&header[48]);
+
+	/* Metadata is exactly the same as in .cw files, so just reuse the .cw importer for it */
+	if ((res = Nbt_ReadRoot(s, NULL, &cw_handlers)))          return res;
+	if ((res = s->Seek(s, MAPCACHE_HEADER_SIZE + metaLength))) return res;
+
+	if (World.Width != width || World.Height != height || World.Length != length) return ERR_NOT_SUPPORTED;
+	if (!Mem_Equal(World.Uuid, &header[20], WORLD_UUID_LEN)) return ERR_NOT_SUPPORTED;
+	if ((res = Map_ReadBlocks(s, NULL))) return res;
+
+	if (flags & MAPCACHE_HAS_BLOCKS2) {
+#ifdef EXTENDED_BLOCKS
+		blocks2 = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+		if (!blocks2) return ERR_OUT_OF_MEMORY;
+
+		World_SetMapUpper(blocks2);
+		if ((res = Stream_Read(s, blocks2, World.Volume))) return res;
+#else
+		if ((res = s->Skip(s, World.Volume))) return res;
+#endif
+	}
+
+	/* Heightmap is out of date when lighting properties of blocks have changed since it was calculated */
+	/* (e.g. when map has block definitions, and custom blocks are now disabled in options)  */
+	if (!(flags & MAPCACHE_HAS_HEIGHTMAP))                         return 0;
+	if (Stream_GetU32_LE(&header[44]) != MapCache_LightingCRC()) return 0;
+
+	cache_heightmap = (cc_int16*)Mem_TryAlloc(width * length, 2);
+	if (!cache_heightmap) return 0;
+	return Stream_Read(s, (cc_uint8*)cache_heightmap, width * length * 2);
+}
+
+/* Attempts to load the world from the cache of the given .cw map file */
+static cc_bool MapCache_Load(const cc_string* path, struct Stream* src) {
+	static const cc_string cwExt = String_FromConst(".cw");
+	cc_string cachePath; char cacheBuffer[FILENAME_SIZE];
+	struct Stream stream;
+	cc_result res;
+
+	cache_stale = false;
+	if (!String_CaselessEnds(path, &cwExt))    return false;
+	if (!Options_GetBool(OPT_MAP_CACHE, true)) return false;
+	if (MapCache_ReadSource(src))              return false;
+
+	cache_stale = true;
+	String_InitArray(cachePath, cacheBuffer);
+	MapCache_GetPath(path, &cachePath);
+
+#ifdef CC_BUILD_FILEMAP
+	res = Stream_OpenMappedFile(&stream, &cachePath);
+#else
+	res = Stream_OpenBufferedFile(&stream, &cachePath);
+#endif
+	if (res) return false;
+
+	res = MapCache_Read(&stream);
+	(void)stream.Close(&stream);
+	/* Heightmap is rewritten when it was out of date */
+	if (!res) { cache_stale = !cache_heightmap; return true; }
+
+	/* Undo everything partially loaded from the cache, then load the map normally */
+	if (res != ERR_NOT_SUPPORTED) Logger_SysWarn2(res, "loading", &cachePath);
+	Mem_Free(cache_heightmap);
+	cache_heightmap = NULL;
+
+	Game_Reset();
+	Mem_Set(spawn_point, 0, sizeof(*spawn_point));
+	return false;
+}
+
+static cc_result MapCache_Write(struct Stream* s, cc_int16* heightmap) {
+	cc_uint8 header[MAPCACHE_HEADER_SIZE] = { 0 };
+	cc_uint16 byteOrder = 1;
+	cc_uint32 metaEnd;
+	cc_result res;
+	int flags = 0;
+#ifdef EXTENDED_BLOCKS
+	int i, count;
+#endif
+
+	/* Header is written last, so that a partially written cache is always rejected */
+	if ((res = Stream_Write(s, header, sizeof(header)))) return res;
+	if ((res = Cw_WriteMap(s, false)))                   return res;
+	if ((res = s->Position(s, &metaEnd)))                return res;
+	if ((res = Stream_Write(s, World.Blocks, World.Volume))) return res;
+
+#ifdef EXTENDED_BLOCKS
+	if (World.IDMask > 0xFF) {
+		flags |= MAPCACHE_HAS_BLOCKS2;
+
+		for (i = 0; i < World.Volume; i += WORLD_PAGE_SIZE) {
+			count = min(WORLD_PAGE_SIZE, World.Volume - i);
+			if ((res = Stream_Write(s, World.Blocks2Pages[i >> WORLD_PAGE_SHIFT], count))) return res;
+		}
+	}
+#endif
+
+	if (heightmap) {
+		flags |= MAPCACHE_HAS_HEIGHTMAP;
+		res = Stream_Write(s, (cc_uint8*)heightmap, World.Width * World.Length * 2);
+		if (res) return res;
+	}
+
+	Mem_Copy(header, "CCMC", 4);
+	Stream_SetU16_LE(&header[4], MAPCACHE_VERSION);
+	Mem_Copy(&header[6], &byteOrder, 2);
+	Mem_Copy(&header[8], cache_source, 12);
+	Mem_Copy(&header[20], World.Uuid, WORLD_UUID_LEN);
+
+	Stream_SetU16_LE(&header[36], World.Width);
+	Stream_SetU16_LE(&header[38], World.Height);
+	Stream_SetU16_LE(&header[40], World.Length);
+	Stream_SetU16_LE(&header[42], flags);
+	Stream_SetU32_LE(&header[44], MapCache_LightingCRC());
+	Stream_SetU32_LE(&header[48], metaEnd - MAPCACHE_HEADER_SIZE);
+
+	if ((res = s->Seek(s, 0))) return res;
+	return Stream_Write(s, header, sizeof(header));
+}
+
+static void MapCache_Save(const cc_string* path) {
+	cc_string cachePath; char cacheBuffer[FILENAME_SIZE];
+	cc_int16* heightmap;
+	struct Stream stream;
+	cc_result res;
+
+	String_InitArray(cachePath, cacheBuffer);
+	MapCache_GetPath(path, &cachePath);
+
+	res = Stream_CreateFile(&stream, &cachePath);
+	if (res) { Logger_SysWarn2(res, "creating", &cachePath); return; }
+
+	heightmap = (cc_int16*)Mem_TryAlloc(World.Width * World.Length, 2);
+	if (heightmap && !ClassicLighting_GetHeightmap(heightmap)) {
+		Mem_Free(heightmap);
+		heightmap = NULL;
+	}
+
+	res = MapCache_Write(&stream, heightmap);
+	if (res) Logger_SysWarn2(res, "writing", &cachePath);
+
+	Mem_Free(heightmap);
+	res = stream.Close(&stream);
+	if (res) Logger_SysWarn2(res, "closing", &cachePath);
+}
+
+/* Called after the world has been loaded from the given map file */
+static void MapCache_Finish(const cc_string* path, cc_result res) {
+	if (cache_heightmap) {
+		ClassicLighting_SetHeightmap(cache_heightmap);
+		Mem_Free(cache_heightmap);
+		cache_heightmap = NULL;
+	} else if (cache_stale && !res && World.Blocks) {
+		MapCache_Save(path);
+	}
+	cache_stale = false;
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Formats component-------------------------------------------------*
+*#########################################################################################################################*/
+static struct MapImporter cw_imp    = { ".cw",      Cw_Load };
+static struct MapImporter dat_imp   = { ".dat",     Dat_Load };
+static struct MapImporter lvl_imp   = { ".lvl",     Lvl_Load };
+static struct MapImporter mine_imp  = { ".mine",    Dat_Load };
+static struct MapImporter fcm_imp   = { ".fcm",     Fcm_Load };
+static struct MapImporter mclvl_imp = { ".mclevel", MCLevel_Load };
+static struct MapImporter ccr_imp   = { ".ccr",     Region_Load };
+
+static void OnInit(void) {
+	MapImporter_Register(&cw_imp);
+	MapImporter_Register(&dat_imp);
+	MapImporter_Register(&lvl_imp);
+	MapImporter_Register(&mine_imp);
+	MapImporter_Register(&fcm_imp);
+	MapImporter_Register(&mclvl_imp);
+	MapImporter_Register(&ccr_imp);
+	Event_Register_(&WorldEvents.NewMap, NULL, Region_OnNewMap);
+#ifdef CC_BUILD_SAVEWORKERS
+	ScheduledTask_Add(GAME_DEF_TICKS, SaveWorker_Tick);
+#endif
+#ifdef CC_BUILD_MAPJOURNAL
+	Event_Register_(&WorldEvents.NewMap, NULL, MapJournal_OnNewMap);
+#endif
+}
+
+static void OnFree(void) {
+	imp_head = NULL;
+#ifdef CC_BUILD_SAVEWORKERS
+	/* Make sure map has been completely written to disc before exiting */
+	if (save_thread) Thread_Join(save_thread);
+	Mem_Free(save_data);
+	save_thread = NULL;
+	save_data   = NULL;
+#endif
+#ifdef CC_BUILD_MAPJOURNAL
+	MapJournal_Free();
+#endif
+	Region_Free();
 }
 #else
 /* No point including map format code when can't save/load maps anyways */
@@ -1884,8 +3747,11 @@ struct MapImporter* MapImporter_Find(const cc_string* path) { return NULL; }
 cc_result Map_LoadFrom(const cc_string* path) { return ERR_NOT_SUPPORTED; }
 
 cc_result Cw_Save(struct Stream* stream)  { return ERR_NOT_SUPPORTED; }
+cc_result Cw_Scan(struct Stream* stream)  { return ERR_NOT_SUPPORTED; }
 cc_result Dat_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
 cc_result Schematic_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
+cc_result Map_SaveRegions(const cc_string* path, cc_bool background) { return ERR_NOT_SUPPORTED; }
+void MapRegions_MarkChanged(int x, int y, int z) { }
 
 static void OnInit(void) { }
 static void OnFree(void) { }
@@ -32,6 +32,9 @@ CC_API cc_result Map_LoadFrom(const cc_string* path);
 /* Exports a world to a .cw ClassicWorld map file. */
 /* Compatible with ClassiCube/ClassicalSharp */
 cc_result Cw_Save(struct Stream* stream);
+/* Reads through all the data in a .cw ClassicWorld map file, without actually importing the world */
+/* (e.g. for measuring how long it takes to decompress and parse) */
+cc_result Cw_Scan(struct Stream* stream);
 /* Exports a world to a .schematic Schematic map file */
 /* Used by MCEdit and other tools */
 cc_result Schematic_Save(struct Stream* stream);
@@ -39,5 +42,27 @@ cc_result Schematic_Save(struct Stream* stream);
 /* Used by MineCraft Classic */
 cc_result Dat_Save(struct Stream* stream);
 
+/* Exports a world to a .ccr region map file, where each region of the map is compressed separately */
+/* If the map was loaded from or last saved to the same file, only regions changed since then are written */
+/* NOTE: When background is true, returns before the file has been written (result is shown in chat once finished) */
+cc_result Map_SaveRegions(const cc_string* path, cc_bool background);
+/* Marks the region containing the given block as needing to be written when next saved to a .ccr file */
+/* NOTE: Should be called for every block changed in the world */
+void MapRegions_MarkChanged(int x, int y, int z);
+
+/* Exports a world encoded in a particular map file format */
+typedef cc_result (*MapExportFunc)(struct Stream* stream);
+#ifdef CC_BUILD_SAVEWORKERS
+/* Exports the world into memory, then compresses and writes it to the given file on a background thread */
+/* NOTE: Returns before the file has been written, with the result shown in chat once finished */
+/* NOTE: Changes to the world made after this is called are not included in the saved file */
+cc_result Map_SaveInBackground(const cc_string* path, MapExportFunc exporter);
+#endif
+#ifdef CC_BUILD_MAPJOURNAL
+/* Appends the given block change to the journal of the current singleplayer map, if it has one */
+/* NOTE: Should be called for every block changed in the world */
+void MapJournal_Add(int x, int y, int z, BlockID block);
+#endif
+
 CC_END_HEADER
 #endif
@@ -41,6 +41,12 @@
 #include "SystemFonts.h"
 #include "Formats.h"
 #include "EntityRenderers.h"
+#include "IsometricDrawer.h"
+#include "BlockPhysics.h"
+#include "Errors.h"
+#include "Generator.h"
+#include "Deflate.h"
+#include "LWeb.h"
 
 struct _GameData Game;
 static cc_uint64 frameStart;
@@ -55,6 +61,8 @@ int     Game_FpsLimit, Game_Vertices;
 cc_bool Game_SimpleArmsAnim;
 static cc_bool gameRunning;
 static float gfx_minFrameMs;
+static cc_bool gfx_pendingSleep;
+static int gfx_framesInFlight;
 
 cc_bool Game_ClassicMode, Game_ClassicHacks;
 cc_bool Game_AllowCustomBlocks;
@@ -79,8 +87,10 @@ const char* const FpsLimit_Names[FPS_LIMIT_COUNT] = {
 
 static struct IGameComponent* comps_head;
 static struct IGameComponent* comps_tail;
+static int comps_count;
 void Game_AddComponent(struct IGameComponent* comp) {
 	LinkedList_Append(comp, comps_head, comps_tail);
+	comps_count++;
 }
 
 #define TASKS_DEF_ELEMS 6
@@ -88,11 +98,19 @@ static struct ScheduledTask defaultTasks[TASKS_DEF_ELEMS];
 static int tasksCapacity = TASKS_DEF_ELEMS, tasksCount, entTaskI;
 static struct ScheduledTask* tasks = defaultTasks;
 
+/* Max number of intervals a task can catch up by in one frame, before the extra time is dropped */
+/* This avoids a long burst of back to back ticks (and visible catch-up) after a hitch */
+#define TASKS_DEF_MAX_CATCHUP 10
+
 int ScheduledTask_Add(double interval, ScheduledTaskCallback callback) {
 	struct ScheduledTask task;
 	task.accumulator = 0.0;
 	task.interval    = interval;
 	task.Callback    = callback;
+	/* By default, catching up can't take longer than the interval itself */
+	/*  (otherwise slow tasks end up falling further and further behind) */
+	task.maxCatchup  = TASKS_DEF_MAX_CATCHUP;
+	task.budget      = interval;
 
 	if (tasksCount == tasksCapacity) {
 		Utils_Resize((void**)&tasks, &tasksCapacity,
@@ -103,6 +121,163 @@ int ScheduledTask_Add(double interval, ScheduledTaskCallback callback) {
 	return tasksCount - 1;
 }
 
+void ScheduledTask_SetLimits(int index, int maxCatchup, double budget) {
+	tasks[index].maxCatchup = max(1, maxCatchup);
+	tasks[index].budget     = budget;
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------------Jobs-----------------------------------------------------------*
+*#########################################################################################################################*/
+/* Jobs that have been run, and are waiting to be finished on the main thread */
+static struct GameJob* done_head;
+static struct GameJob* done_tail;
+
+static void Jobs_FinishAll(struct GameJob* job) {
+	struct GameJob* next;
+	/* Finish may free the job */
+	for (; job; job = next)
+	{
+		next = job->next;
+		job->Finish(job);
+	}
+}
+
+#ifdef CC_BUILD_JOBWORKERS
+#define JOB_WORKERS 2
+/* Jobs that are waiting to be run, in order of being queued */
+static struct GameJob* jobs_head;
+static struct GameJob* jobs_tail;
+static void* job_threads[JOB_WORKERS];
+static void* job_mutex;
+static void* job_wakeup;
+static volatile cc_bool jobs_quit;
+
+static void JobWorker_Run(void) {
+	struct GameJob* job;
+	cc_uint64 beg;
+
+	for (;;) {
+		Mutex_Lock(job_mutex);
+		job = jobs_head;
+		if (job) {
+			jobs_head = job->next;
+			if (!jobs_head) jobs_tail = NULL;
+		}
+		Mutex_Unlock(job_mutex);
+
+		if (!job && jobs_quit) {
+			/* Wake up the next worker so that it can quit too */
+			Waitable_Signal(job_wakeup); return;
+		}
+		if (!job) { Waitable_Wait(job_wakeup); continue; }
+		beg = Stopwatch_Measure();
+		job->Run(job);
+		Logger_Trace(TRACE_EVENT_JOB, (cc_uint32)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure()), 0);
+
+		Mutex_Lock(job_mutex);
+		LinkedList_Append(job, done_head, done_tail);
+		Mutex_Unlock(job_mutex);
+	}
+}
+
+void Game_QueueJob(struct GameJob* job) {
+	int i;
+	job->cancelled = false;
+
+	if (!job_mutex) {
+		job_mutex  = Mutex_Create("Game jobs");
+		job_wakeup = Waitable_Create("Job worker wakeup");
+		for (i = 0; i < JOB_WORKERS; i++)
+		{
+			Thread_Run(&job_threads[i], JobWorker_Run, 256 * 1024, "Job worker");
+		}
+	}
+
+	Mutex_Lock(job_mutex);
+	LinkedList_Append(job, jobs_head, jobs_tail);
+	Mutex_Unlock(job_mutex);
+	Waitable_Signal(job_wakeup);
+}
+
+static void Jobs_FinishDone(void) {
+	struct GameJob* job;
+	if (!job_mutex) return;
+
+	Mutex_Lock(job_mutex);
+	job       = done_head;
+	done_head = NULL;
+	done_tail = NULL;
+	Mutex_Unlock(job_mutex);
+	Jobs_FinishAll(job);
+}
+
+static void Jobs_Stop(void) {
+	struct GameJob* job;
+	struct GameJob* cur;
+	int i;
+	if (!job_mutex) return;
+
+	/* Jobs that haven't been started yet are cancelled instead */
+	Mutex_Lock(job_mutex);
+	job       = jobs_head;
+	jobs_head = NULL;
+	jobs_tail = NULL;
+	jobs_quit = true;
+	Mutex_Unlock(job_mutex);
+	Waitable_Signal(job_wakeup);
+
+	for (i = 0; i < JOB_WORKERS; i++)
+	{
+		Thread_Join(job_threads[i]);
+	}
+
+	/* Finishing a job may queue up another job, which then needs to be cancelled too */
+	for (;;)
+	{
+		Jobs_FinishDone();
+		for (cur = job; cur; cur = cur->next)
+		{
+			cur->cancelled = true;
+		}
+		Jobs_FinishAll(job);
+
+		Mutex_Lock(job_mutex);
+		job       = jobs_head;
+		jobs_head = NULL;
+		jobs_tail = NULL;
+		Mutex_Unlock(job_mutex);
+		if (!job) break;
+	}
+
+	Mutex_Free(job_mutex);
+	Waitable_Free(job_wakeup);
+	job_mutex  = NULL;
+	job_wakeup = NULL;
+	jobs_quit  = false;
+}
+#else
+/* Without preemptive threads, jobs are just run immediately */
+void Game_QueueJob(struct GameJob* job) {
+	job->cancelled = false;
+	job->Run(job);
+	LinkedList_Append(job, done_head, done_tail);
+}
+
+static void Jobs_FinishDone(void) {
+	struct GameJob* job = done_head;
+	done_head = NULL;
+	done_tail = NULL;
+	Jobs_FinishAll(job);
+}
+
+static void Jobs_Stop(void) {
+	/* Finishing a job may queue up another job */
+	while (done_head) Jobs_FinishDone();
+}
+#endif
+
 
 void Game_ToggleFullscreen(void) {
 	int state = Window_GetWindowState();
@@ -155,6 +330,8 @@ void Game_CycleViewDistance(void) {
 }
 
 cc_bool Game_ReduceVRAM(void) {
+	/* Dropping far away chunks is much less noticeable than the view distance changing */
+	if (MapRenderer_ReduceMeshMemory()) return true;
 	if (Game_UserViewDistance <= 16) return false;
 	Game_UserViewDistance /= 2;
 	Game_UserViewDistance = max(16, Game_UserViewDistance);
@@ -196,10 +373,17 @@ void Game_Reset(void) {
 	}
 }
 
-void Game_UpdateBlock(int x, int y, int z, BlockID block) {
-	BlockID old = World_GetBlock(x, y, z);
-	World_SetBlock(x, y, z, block);
-
+/* Block changes made since Game_BeginBlockBatch, which have not updated associated state yet */
+/* NOTE: Multiple changes to the same block are merged into a single change */
+struct BlockChange { cc_uint16 x, y, z; BlockID oldBlock, newBlock; };
+#define BATCH_MAX_CHANGES 4096
+#define BATCH_TABLE_SIZE  (BATCH_MAX_CHANGES * 2)
+static struct BlockChange batch_changes[BATCH_MAX_CHANGES];
+/* Hash table of world index to index of change in batch_changes plus 1 (0 for empty slots) */
+static cc_uint16 batch_table[BATCH_TABLE_SIZE];
+static int batch_count, batch_depth;
+
+static void NotifyBlockChanged(int x, int y, int z, BlockID old, BlockID block) {
 	if (Weather_Heightmap) {
 		EnvRenderer_OnBlockChanged(x, y, z, old, block);
 	}
@@ -207,12 +391,165 @@ void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 	MapRenderer_OnBlockChanged(x, y, z, block);
 }
 
+static void ApplyBlockBatch(void) {
+	struct BlockChange* c;
+	int i;
+	if (!batch_count) return;
+
+	Lighting.BeginBatch();
+	for (i = 0; i < batch_count; i++) 
+	{
+		c = &batch_changes[i];
+		/* e.g. block was placed then deleted again */
+		if (c->oldBlock == c->newBlock) continue;
+		NotifyBlockChanged(c->x, c->y, c->z, c->oldBlock, c->newBlock);
+	}
+	Lighting.EndBatch();
+
+	Mem_Set(batch_table, 0, sizeof(batch_table));
+	batch_count = 0;
+}
+
+static void AddBlockChange(int x, int y, int z, BlockID old, BlockID block) {
+	int slot = ((cc_uint32)World_Pack(x, y, z) * 2654435761U) & (BATCH_TABLE_SIZE - 1);
+	struct BlockChange* c;
+
+	for (; batch_table[slot]; slot = (slot + 1) & (BATCH_TABLE_SIZE - 1))
+	{
+		c = &batch_changes[batch_table[slot] - 1];
+		if (c->x != x || c->y != y || c->z != z) continue;
+
+		c->newBlock = block; return;
+	}
+
+	if (batch_count == BATCH_MAX_CHANGES) {
+		ApplyBlockBatch();
+		AddBlockChange(x, y, z, old, block); return;
+	}
+
+	c = &batch_changes[batch_count++];
+	c->x = x; c->y = y; c->z = z;
+	c->oldBlock = old; c->newBlock = block;
+	batch_table[slot] = batch_count;
+}
+
+void Game_BeginBlockBatch(void) { batch_depth++; }
+
+void Game_EndBlockBatch(void) {
+	if (!batch_depth || --batch_depth) return;
+	ApplyBlockBatch();
+}
+
+/* Whether a replay is being played back (see Replay section) */
+static cc_bool replay_active;
+
+void Game_NotifyBlockUpdated(int x, int y, int z, BlockID old, BlockID block) {
+#ifdef CC_BUILD_MAPJOURNAL
+	/* Replays shouldn't permanently change the map they are being played back on */
+	if (!replay_active) MapJournal_Add(x, y, z, block);
+#endif
+	MapRegions_MarkChanged(x, y, z);
+	if (batch_depth) {
+		AddBlockChange(x, y, z, old, block);
+	} else {
+		NotifyBlockChanged(x, y, z, old, block);
+	}
+}
+
+void Game_UpdateBlock(int x, int y, int z, BlockID block) {
+	BlockID old;
+	Physics_FinishTick();
+
+	old = World_GetBlock(x, y, z);
+	World_SetBlock(x, y, z, block);
+	Physics_OnBlockUpdated(x, y, z, old, block);
+	Game_NotifyBlockUpdated(x, y, z, old, block);
+}
+
 void Game_ChangeBlock(int x, int y, int z, BlockID block) {
 	BlockID old = World_GetBlock(x, y, z);
 	Game_UpdateBlock(x, y, z, block);
 	Server.SendBlock(x, y, z, old, block);
 }
 
+/* Bounds of the blocks changed since Game_BeginBulkChange */
+static IVec3 bulk_min, bulk_max;
+static cc_bool bulk_changed, bulk_perBlockLighting;
+
+void Game_BeginBulkChange(void) {
+	bulk_changed = false;
+	/* Only heightmap based lighting can be recalculated for a whole region at once */
+	bulk_perBlockLighting = Lighting.OnBlockChanged != ClassicLighting_OnBlockChanged;
+	if (bulk_perBlockLighting) Lighting.BeginBatch();
+}
+
+void Game_BulkChangeBlock(int x, int y, int z, BlockID block) {
+	BlockID old;
+	Physics_FinishTick();
+
+	old = World_GetBlock(x, y, z);
+	if (old == block) return;
+
+	World_SetBlock(x, y, z, block);
+	Physics_OnBlockUpdated(x, y, z, old, block);
+#ifdef CC_BUILD_MAPJOURNAL
+	if (!replay_active) MapJournal_Add(x, y, z, block);
+#endif
+	MapRegions_MarkChanged(x, y, z);
+	Server.SendBlock(x, y, z, old, block);
+	if (bulk_perBlockLighting) Lighting.OnBlockChanged(x, y, z, old, block);
+
+	if (!bulk_changed) {
+		bulk_min.x = x; bulk_min.y = y; bulk_min.z = z;
+		bulk_max   = bulk_min;
+		bulk_changed = true;
+	} else {
+		bulk_min.x = min(bulk_min.x, x); bulk_max.x = max(bulk_max.x, x);
+		bulk_min.y = min(bulk_min.y, y); bulk_max.y = max(bulk_max.y, y);
+		bulk_min.z = min(bulk_min.z, z); bulk_max.z = max(bulk_max.z, z);
+	}
+}
+
+void Game_EndBulkChange(void) {
+	if (bulk_perBlockLighting) Lighting.EndBatch();
+	if (!bulk_changed) return;
+	bulk_changed = false;
+
+	if (Weather_Heightmap) {
+		EnvRenderer_OnRegionChanged(bulk_min.x, bulk_min.z, bulk_max.x, bulk_max.z);
+	}
+	if (!bulk_perBlockLighting) {
+		ClassicLighting_OnRegionChanged(bulk_min.x, bulk_min.z, bulk_max.x, bulk_max.y, bulk_max.z);
+	}
+	MapRenderer_OnRegionChanged(bulk_min.x, bulk_min.y, bulk_min.z, bulk_max.x, bulk_max.y, bulk_max.z);
+}
+
+void Game_RefreshBlocks(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	int x, y, z;
+	BlockID block;
+	World_RefreshSections(minX, minY, minZ, maxX, maxY, maxZ);
+
+	/* Only heightmap based lighting can be recalculated for a whole region at once */
+	if (Lighting.OnBlockChanged == ClassicLighting_OnBlockChanged) {
+		ClassicLighting_OnRegionChanged(minX, minZ, maxX, maxY, maxZ);
+	} else {
+		Lighting.BeginBatch();
+		for (y = minY; y <= maxY; y++) {
+			for (z = minZ; z <= maxZ; z++) {
+				for (x = minX; x <= maxX; x++)
+				{
+					block = World_GetBlock(x, y, z);
+					if (block != BLOCK_AIR) Lighting.OnBlockChanged(x, y, z, BLOCK_AIR, block);
+				}
+			}
+		}
+		Lighting.EndBatch();
+	}
+
+	if (Weather_Heightmap) EnvRenderer_OnRegionChanged(minX, minZ, maxX, maxZ);
+	MapRenderer_OnRegionChanged(minX, minY, minZ, maxX, maxY, maxZ);
+}
+
 cc_bool Game_CanPick(BlockID block) {
 	if (Blocks.Draw[block] == DRAW_GAS)    return false;
 	if (Blocks.Draw[block] == DRAW_SPRITE) return true;
@@ -296,6 +633,10 @@ static void Game_OnResize(void* obj) {
 
 static void HandleOnNewMap(void* obj) {
 	struct IGameComponent* comp;
+	/* Pending block changes are for the old map */
+	Mem_Set(batch_table, 0, sizeof(batch_table));
+	batch_count = 0;
+
 	for (comp = comps_head; comp; comp = comp->next) {
 		if (comp->OnNewMap) comp->OnNewMap();
 	}
@@ -303,6 +644,8 @@ static void HandleOnNewMap(void* obj) {
 
 static void HandleOnNewMapLoaded(void* obj) {
 	struct IGameComponent* comp;
+	Logger_Trace(TRACE_EVENT_MAP_LOADED, World.Volume, 0);
+
 	for (comp = comps_head; comp; comp = comp->next) {
 		if (comp->OnNewMapLoaded) comp->OnNewMapLoaded();
 	}
@@ -354,6 +697,7 @@ static void LoadOptions(void) {
 
 	Game_ViewDistance     = Options_GetInt(OPT_VIEW_DISTANCE, 8, 4096, DEFAULT_VIEWDIST);
 	Game_UserViewDistance = Game_ViewDistance;
+	Stream_FileBufferSize = Options_GetInt(OPT_FILE_BUFFER_SIZE, 0, 1024, Stream_FileBufferSize / 1024) * 1024;
 	/* TODO: Do we need to support option to skip SSL */
 	/*cc_bool skipSsl = Options_GetBool("skip-ssl-check", false);
 	if (skipSsl) {
@@ -362,7 +706,90 @@ static void LoadOptions(void) {
 	}*/
 }
 
+enum PluginHook { PLUGIN_HOOK_PRETICK, PLUGIN_HOOK_POSTTICK, PLUGIN_HOOK_RENDER };
 #ifdef CC_BUILD_PLUGINS
+#define PLUGINS_MAX_HOOKS 16
+/* Plugins which on average spend longer than this (in microseconds) per frame in hooks are reported in chat */
+#define PLUGIN_SLOW_TIME 4000
+
+static struct PluginHookInfo {
+	const struct PluginHooks* hooks;
+	cc_string name; char _nameBuffer[STRING_SIZE];
+	int time; /* Time spent in the hooks since the last check */
+	cc_bool reported;
+} plugin_hooks[PLUGINS_MAX_HOOKS];
+static int plugin_hooksCount, plugin_frames;
+static float plugin_elapsed;
+
+static void Plugins_AddHooks(const cc_string* path, void* lib) {
+	const struct PluginHooks* hooks = (const struct PluginHooks*)DynamicLib_Get2(lib, "Plugin_Hooks");
+	struct PluginHookInfo* info;
+	cc_string name = *path;
+	if (!hooks) return; /* Hooks are optional */
+
+	if (hooks->version > PLUGIN_HOOKS_VERSION) {
+		Chat_Add1("&cYour game is too outdated to use the hooks of %s plugin! Try updating it.", path);
+		return;
+	} else if (plugin_hooksCount == PLUGINS_MAX_HOOKS) {
+		Chat_Add1("&cToo many plugins with hooks, so ignoring the hooks of %s plugin", path);
+		return;
+	}
+
+	info = &plugin_hooks[plugin_hooksCount++];
+	info->hooks    = hooks;
+	info->time     = 0;
+	info->reported = false;
+
+	Utils_UNSAFE_GetFilename(&name);
+	String_InitArray(info->name, info->_nameBuffer);
+	String_AppendString(&info->name, &name);
+}
+
+static void Plugins_RunHooks(int hook, int pass, float delta) {
+	const struct PluginHooks* hooks;
+	cc_uint64 beg;
+	int i;
+	if (!plugin_hooksCount) return;
+
+	Game_BeginProfile(PROFILE_PLUGINS);
+	for (i = 0; i < plugin_hooksCount; i++)
+	{
+		hooks = plugin_hooks[i].hooks;
+		beg   = Stopwatch_Measure();
+
+		if (hook == PLUGIN_HOOK_PRETICK  && hooks->PreTick)  hooks->PreTick(delta);
+		if (hook == PLUGIN_HOOK_POSTTICK && hooks->PostTick) hooks->PostTick(delta);
+		if (hook == PLUGIN_HOOK_RENDER   && hooks->Render)   hooks->Render(pass, delta);
+		plugin_hooks[i].time += (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+	}
+	Game_EndProfile();
+}
+
+/* Reports any plugins that are noticeably slowing down every frame, once per plugin */
+static void Plugins_CheckTimes(float delta) {
+	struct PluginHookInfo* info;
+	int i, time;
+	if (!plugin_hooksCount) return;
+
+	plugin_frames++;
+	plugin_elapsed += delta;
+	if (plugin_elapsed < 1.0f) return;
+
+	for (i = 0; i < plugin_hooksCount; i++)
+	{
+		info = &plugin_hooks[i];
+		time = info->time / plugin_frames;
+		info->time = 0;
+		if (time < PLUGIN_SLOW_TIME || info->reported) continue;
+
+		time /= 1000;
+		Chat_Add2("&e%s plugin is taking %i ms every frame, which reduces FPS", &info->name, &time);
+		info->reported = true;
+	}
+	plugin_frames  = 0;
+	plugin_elapsed = 0;
+}
+
 static void LoadPlugin(const cc_string* path, void* obj, int isDirectory) {
 	void* lib;
 	void* verSym;  /* EXPORT int Plugin_ApiVersion = GAME_API_VER; */
@@ -394,26 +821,154 @@ static void LoadPlugin(const cc_string* path, void* obj, int isDirectory) {
 	}
 
 	Game_AddComponent((struct IGameComponent*)compSym);
+	Plugins_AddHooks(path, lib);
 }
 
 static void LoadPlugins(void) {
 	static const cc_string dir = String_FromConst("plugins");
 	cc_result res;
 
+	plugin_hooksCount = 0;
 	Utils_EnsureDirectory("plugins");
 	res = Directory_Enum(&dir, NULL, LoadPlugin);
 	if (res) Logger_SysWarn(res, "enumerating plugins directory");
 }
 #else
 static void LoadPlugins(void) { }
+static void Plugins_RunHooks(int hook, int pass, float delta) { }
+static void Plugins_CheckTimes(float delta) { }
 #endif
 
 static void Game_PendingClose(void* obj) { gameRunning = false; }
-static void Game_Load(void) {
+
+/*########################################################################################################################*
+*---------------------------------------------------Dynamic resolution----------------------------------------------------*
+*#########################################################################################################################*/
+/* When frames take longer than the target frame time to render, the 3D scene is rendered at a lower */
+/*  resolution and then stretched across the window (the GUI is always drawn at full resolution) */
+/* NOTE: With VSync, frame times never drop below the target, so the resolution is periodically raised again */
+#if defined CC_BUILD_MOBILE || defined CC_BUILD_WEB
+	#define DYNRES_DEFAULT true
+#else
+	#define DYNRES_DEFAULT false
+#endif
+#define DYNRES_SCALE_STEP 0.05f
+/* Lowest resolution is 50% of the window's width and height */
+#define DYNRES_MAX_LEVEL  10
+/* Frame time targeted when no FPS limit is set */
+#define DYNRES_TARGET_MS  (1000.0f / 60.0f)
+/* Minimum time between resolution changes, so the average frame time can settle */
+#define DYNRES_CHANGE_DELAY 0.5
+#define DYNRES_PROBE_DELAY  5.0
+
+static cc_bool dynres_enabled;
+/* Number of DYNRES_SCALE_STEPs the 3D scene is currently rendered below full resolution */
+static int dynres_level;
+/* Moving average of how long recent frames took to render */
+static float dynres_frameMs;
+static double dynres_lastChange;
+
+static void DynRes_Init(void) {
+	dynres_enabled = Options_GetBool(OPT_DYNAMIC_RESOLUTION, DYNRES_DEFAULT);
+}
+
+/* Whether the 3D scene should be rendered at a lower resolution this frame */
+static cc_bool DynRes_Active(void) {
+	return dynres_level && Gfx.SupportsScaledScene && Game_NumStates == 1;
+}
+
+static void DynRes_SetLevel(int level) {
+	dynres_lastChange = Game.Time;
+	dynres_frameMs    = 0.0f;
+	dynres_level      = level;
+}
+
+/* Adjusts the resolution based on how long the frame that started at the given time took to render */
+static void DynRes_FrameDrawn(cc_uint64 beg) {
+	float frameMs, targetMs;
+	if (!dynres_enabled || !Gfx.SupportsScaledScene) return;
+
+	frameMs  = Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure()) / 1000.0f;
+	targetMs = gfx_minFrameMs ? gfx_minFrameMs : DYNRES_TARGET_MS;
+	dynres_frameMs = dynres_frameMs ? Math_Lerp(dynres_frameMs, frameMs, 0.1f) : frameMs;
+	if (Game.Time - dynres_lastChange < DYNRES_CHANGE_DELAY) return;
+
+	if (dynres_frameMs > targetMs * 1.05f) {
+		if (dynres_level < DYNRES_MAX_LEVEL) DynRes_SetLevel(dynres_level + 1);
+	} else if (dynres_level) {
+		if (dynres_frameMs < targetMs * 0.85f || Game.Time - dynres_lastChange >= DYNRES_PROBE_DELAY) {
+			DynRes_SetLevel(dynres_level - 1);
+		}
+	}
+}
+
+/*########################################################################################################################*
+*------------------------------------------------------Startup trace------------------------------------------------------*
+*#########################################################################################################################*/
+#define TRACE_MAX_NAMES 48
+cc_bool Game_StartupTrace;
+static cc_uint64 trace_start, trace_last;
+static cc_bool trace_firstFrame;
+/* Names of the built in components, in the order they were added (plugins are added after) */
+static const char* comp_names[TRACE_MAX_NAMES];
+
+static void AddNamedComponent(struct IGameComponent* comp, const char* name) {
+	if (comps_count < TRACE_MAX_NAMES) comp_names[comps_count] = name;
+	Game_AddComponent(comp);
+}
+#define Game_AddCoreComponent(name) AddNamedComponent(&name ## _Component, #name)
+
+static void StartupTrace_Begin(void) {
+	if (!Game_StartupTrace) return;
+	trace_start = Stopwatch_Measure();
+	trace_last  = trace_start;
+	trace_firstFrame = true;
+	Platform_LogConst("-- startup trace --");
+}
+
+/* Logs how long was spent since the previous step */
+static void StartupTrace_Step(const char* name) {
+	cc_uint64 now;
+	float ms;
+	if (!Game_StartupTrace) return;
+
+	now = Stopwatch_Measure();
+	ms  = (int)Stopwatch_ElapsedMicroseconds(trace_last, now) / 1000.0f;
+	Platform_Log2("  %c: %f2 ms", name, &ms);
+	trace_last = now;
+}
+
+static void StartupTrace_End(const char* name) {
+	float ms;
+	StartupTrace_Step(name);
+	if (!Game_StartupTrace) return;
+
+	ms = (int)Stopwatch_ElapsedMicroseconds(trace_start, trace_last) / 1000.0f;
+	Platform_Log1("  total: %f2 ms", &ms);
+}
+
+static void InitComponents(void) {
 	struct IGameComponent* comp;
+	const char* name;
+	int i = 0;
+
+	for (comp = comps_head; comp; comp = comp->next, i++) 
+	{
+		if (!comp->Init) continue;
+		comp->Init();
+
+		name = i < TRACE_MAX_NAMES ? comp_names[i] : NULL;
+		StartupTrace_Step(name ? name : "plugin");
+	}
+}
+
+static void Game_Load(void) {
+	StartupTrace_Begin();
 	Game_UpdateDimensions();
+	gfx_framesInFlight = Options_GetInt(OPT_FRAMES_IN_FLIGHT, 0, 3, 1);
 	Game_SetFpsLimit(Options_GetEnum(OPT_FPS_LIMIT, 0, FpsLimit_Names, FPS_LIMIT_COUNT));
 	Gfx_Create();
+	StartupTrace_Step("Gfx_Create");
 	
 	Logger_WarnFunc = Game_WarnFunc;
 	LoadOptions();
@@ -426,49 +981,51 @@ static void Game_Load(void) {
 	Event_Register_(&WindowEvents.Closing,         NULL, Game_PendingClose);
 	Event_Register_(&WindowEvents.InactiveChanged, NULL, HandleInactiveChanged);
 
-	Game_AddComponent(&World_Component);
-	Game_AddComponent(&Textures_Component);
-	Game_AddComponent(&Input_Component);
-	Game_AddComponent(&InputHandler_Component);
-	Game_AddComponent(&Camera_Component);
-	Game_AddComponent(&Gfx_Component);
-	Game_AddComponent(&Blocks_Component);
-	Game_AddComponent(&Drawer2D_Component);
-	Game_AddComponent(&SystemFonts_Component);
-
-	Game_AddComponent(&Chat_Component);
-	Game_AddComponent(&Commands_Component);
-	Game_AddComponent(&Particles_Component);
-	Game_AddComponent(&TabList_Component);
-	Game_AddComponent(&Models_Component);
-	Game_AddComponent(&Entities_Component);
-	Game_AddComponent(&Http_Component);
-	Game_AddComponent(&Lighting_Component);
-
-	Game_AddComponent(&Animations_Component);
-	Game_AddComponent(&Inventory_Component);
-	Game_AddComponent(&Builder_Component);
-	Game_AddComponent(&MapRenderer_Component);
-	Game_AddComponent(&EnvRenderer_Component);
-	Game_AddComponent(&Server_Component);
-	Game_AddComponent(&Protocol_Component);
-
-	Game_AddComponent(&Gui_Component);
-	Game_AddComponent(&Selections_Component);
-	Game_AddComponent(&HeldBlockRenderer_Component);
+	Game_AddCoreComponent(World);
+	Game_AddCoreComponent(Textures);
+	Game_AddCoreComponent(Input);
+	Game_AddCoreComponent(InputHandler);
+	Game_AddCoreComponent(Camera);
+	Game_AddCoreComponent(Gfx);
+	Game_AddCoreComponent(Blocks);
+	Game_AddCoreComponent(Drawer2D);
+	Game_AddCoreComponent(IsometricDrawer);
+	Game_AddCoreComponent(SystemFonts);
+
+	Game_AddCoreComponent(Chat);
+	Game_AddCoreComponent(Commands);
+	Game_AddCoreComponent(Particles);
+	Game_AddCoreComponent(TabList);
+	Game_AddCoreComponent(Models);
+	Game_AddCoreComponent(Entities);
+	Game_AddCoreComponent(Http);
+	Game_AddCoreComponent(Lighting);
+
+	Game_AddCoreComponent(Animations);
+	Game_AddCoreComponent(Inventory);
+	Game_AddCoreComponent(Builder);
+	Game_AddCoreComponent(MapRenderer);
+	Game_AddCoreComponent(EnvRenderer);
+	Game_AddCoreComponent(Server);
+	Game_AddCoreComponent(Protocol);
+
+	Game_AddCoreComponent(Gui);
+	Game_AddCoreComponent(Selections);
+	Game_AddCoreComponent(HeldBlockRenderer);
 	/* Gfx_SetDepthWrite(true) */
-	Game_AddComponent(&SelOutlineRenderer_Component);
-	Game_AddComponent(&Audio_Component);
-	Game_AddComponent(&AxisLinesRenderer_Component);
-	Game_AddComponent(&Formats_Component);
-	Game_AddComponent(&EntityRenderers_Component);
+	Game_AddCoreComponent(SelOutlineRenderer);
+	Game_AddCoreComponent(Audio);
+	Game_AddCoreComponent(AxisLinesRenderer);
+	Game_AddCoreComponent(Formats);
+	Game_AddCoreComponent(EntityRenderers);
 
+	StartupTrace_Step("LoadOptions");
 	LoadPlugins();
-	for (comp = comps_head; comp; comp = comp->next) {
-		if (comp->Init) comp->Init();
-	}
+	StartupTrace_Step("LoadPlugins");
+	InitComponents();
 
 	TexturePack_ExtractCurrent(true);
+	StartupTrace_Step("TexturePack_ExtractCurrent");
 	if (TexturePack_DefaultMissing) {
 		Window_ShowDialog("Missing file",
 			"Both default.zip and classicube.zip are missing,\n try downloading resources first.\n\nClassiCube will still run, but without any textures.");
@@ -477,6 +1034,7 @@ static void Game_Load(void) {
 	entTaskI = ScheduledTask_Add(GAME_DEF_TICKS, Entities_Tick);
 	if (Gfx_WarnIfNecessary()) EnvRenderer_SetMode(EnvRenderer_Minimal | ENV_LEGACY);
 	Server.BeginConnect();
+	StartupTrace_Step("BeginConnect");
 }
 
 void Game_SetFpsLimit(int method) {
@@ -491,6 +1049,8 @@ void Game_SetFpsLimit(int method) {
 	}
 	Gfx_SetVSync(method == FPS_LIMIT_VSYNC);
 	Game_SetMinFrameTime(minFrameTime);
+	/* Unlimited FPS is about maximum throughput rather than minimum latency */
+	Gfx.MaxFramesInFlight = method == FPS_LIMIT_NONE ? 0 : gfx_framesInFlight;
 }
 
 #ifdef CC_BUILD_WEB
@@ -505,6 +1065,579 @@ void Game_SetMinFrameTime(float frameTimeMS) {
 }
 #endif
 
+/* Replays are simulated with a fixed delta, so the same replay always results in the same frames */
+#define REPLAY_FRAME_DELTA (1.0 / 60.0)
+#define REPLAY_DEF_EVENTS 64
+#define REPLAY_RESULTS_FILE "benchmark.json"
+enum ReplayEventType { REPLAY_EVENT_CAMERA, REPLAY_EVENT_BLOCK, REPLAY_EVENT_END };
+
+struct ReplayEvent {
+	int frame, type;
+	Vec3 pos; float yaw, pitch; /* REPLAY_EVENT_CAMERA */
+	IVec3 coords; BlockID block; /* REPLAY_EVENT_BLOCK */
+};
+
+static struct ReplayEvent replay_defEvents[REPLAY_DEF_EVENTS];
+static struct ReplayEvent* replay_events = replay_defEvents;
+static int replay_eventsCount, replay_eventsCapacity = REPLAY_DEF_EVENTS;
+
+static cc_bool replay_counting;
+static int replay_frame, replay_frames, replay_nextEvent;
+static int* replay_frameTimes;
+static cc_uint64 replay_chunkTime;
+static int replay_chunkUpdates;
+
+static cc_bool Replay_ParseEvent(const cc_string* line, struct ReplayEvent* e) {
+	cc_string parts[7];
+	int count = String_UNSAFE_Split(line, ' ', parts, 7);
+	int block;
+
+	/* cam [frame] [x] [y] [z] [yaw] [pitch] */
+	if (count == 7 && String_CaselessEqualsConst(&parts[0], "cam")) {
+		e->type = REPLAY_EVENT_CAMERA;
+		return Convert_ParseInt(&parts[1],   &e->frame)
+			&& Convert_ParseFloat(&parts[2], &e->pos.x) && Convert_ParseFloat(&parts[3], &e->pos.y)
+			&& Convert_ParseFloat(&parts[4], &e->pos.z) && Convert_ParseFloat(&parts[5], &e->yaw)
+			&& Convert_ParseFloat(&parts[6], &e->pitch);
+	}
+
+	/* block [frame] [x] [y] [z] [block id] */
+	if (count == 6 && String_CaselessEqualsConst(&parts[0], "block")) {
+		e->type = REPLAY_EVENT_BLOCK;
+		if (!Convert_ParseInt(&parts[5], &block) || block < 0 || block >= BLOCK_COUNT) return false;
+		e->block = (BlockID)block;
+
+		return Convert_ParseInt(&parts[1],  &e->frame)
+			&& Convert_ParseInt(&parts[2], &e->coords.x) && Convert_ParseInt(&parts[3], &e->coords.y)
+			&& Convert_ParseInt(&parts[4], &e->coords.z);
+	}
+
+	/* end [frame] - for when replay should keep running after the last camera/block change */
+	if (count == 2 && String_CaselessEqualsConst(&parts[0], "end")) {
+		e->type = REPLAY_EVENT_END;
+		return Convert_ParseInt(&parts[1], &e->frame);
+	}
+	return false;
+}
+
+cc_result Game_LoadReplay(const cc_string* path) {
+	cc_string line; char lineBuffer[STRING_SIZE * 2];
+	cc_string msg;  char msgBuffer[STRING_SIZE * 3];
+	struct ReplayEvent e;
+	struct Stream stream;
+	cc_result res;
+	int lastFrame = 0;
+
+	res = Stream_OpenBufferedFile(&stream, path);
+	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
+
+	for (;;) {
+		String_InitArray(line, lineBuffer);
+		res = Stream_ReadLine(&stream, &line);
+		if (res == ERR_END_OF_STREAM) { res = 0; break; }
+		if (res) { Logger_SysWarn2(res, "reading from", path); break; }
+
+		String_UNSAFE_TrimStart(&line);
+		String_UNSAFE_TrimEnd(&line);
+		if (!line.length || line.buffer[0] == '#') continue;
+
+		/* Events must be in frame order */
+		if (!Replay_ParseEvent(&line, &e) || e.frame < lastFrame) {
+			String_InitArray(msg, msgBuffer);
+			String_Format1(&msg, "Invalid replay line: %s", &line);
+			Logger_WarnFunc(&msg);
+			res = ERR_INVALID_ARGUMENT; break;
+		}
+
+		if (replay_eventsCount == replay_eventsCapacity) {
+			Utils_Resize((void**)&replay_events, &replay_eventsCapacity,
+				sizeof(struct ReplayEvent), REPLAY_DEF_EVENTS, REPLAY_DEF_EVENTS);
+		}
+		replay_events[replay_eventsCount++] = e;
+		lastFrame = e.frame;
+	}
+
+	stream.Close(&stream);
+	if (res) return res;
+
+	replay_frames     = lastFrame + 1;
+	replay_frameTimes = (int*)Mem_TryAlloc(replay_frames, sizeof(int));
+	if (!replay_frameTimes) return ERR_OUT_OF_MEMORY;
+
+	replay_active = true;
+	return 0;
+}
+
+static void Replay_BeginFrame(void) {
+	struct LocalPlayer* p = Entities.CurPlayer;
+	struct LocationUpdate update;
+	struct ReplayEvent* e;
+
+	/* Only start replaying once the map has finished loading */
+	if (!World.Loaded) return;
+	if (!replay_counting) {
+		replay_counting = true;
+		Game_SetFpsLimit(FPS_LIMIT_NONE);
+		/* Stop player falling or being pushed around between camera updates */
+		HacksComp_SetFlying(&p->Hacks, true);
+		HacksComp_SetNoclip(&p->Hacks, true);
+	}
+
+	for (; replay_nextEvent < replay_eventsCount; replay_nextEvent++)
+	{
+		e = &replay_events[replay_nextEvent];
+		if (e->frame > replay_frame) break;
+
+		if (e->type == REPLAY_EVENT_CAMERA) {
+			update.flags = LU_HAS_POS | LU_HAS_PITCH | LU_HAS_YAW;
+			update.pos   = e->pos;
+			update.yaw   = e->yaw;
+			update.pitch = e->pitch;
+			p->Base.VTABLE->SetLocation(&p->Base, &update);
+		} else if (e->type == REPLAY_EVENT_BLOCK) {
+			if (!World_Contains(e->coords.x, e->coords.y, e->coords.z)) continue;
+			Game_ChangeBlock(e->coords.x, e->coords.y, e->coords.z, e->block);
+		}
+	}
+}
+
+static void Replay_QuickSort(int left, int right) {
+	int* keys = replay_frameTimes; int key;
+
+	while (left < right) {
+		int i = left, j = right;
+		int pivot = keys[(i + j) >> 1];
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i]) i++;
+			while (pivot < keys[j]) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(Replay_QuickSort)
+	}
+}
+
+/* Micro-benchmarks the matrix and vertex transform functions, so they are tracked alongside frame times */
+#define REPLAY_MATH_ITERATIONS 100000
+#define REPLAY_MATH_POINTS 250
+static void Replay_MeasureMath(int* mulTime, int* transformTime) {
+	struct Matrix m = Matrix_IdentityValue, rot;
+	Vec3 points[REPLAY_MATH_POINTS];
+	cc_uint64 beg;
+	int i;
+
+	Matrix_RotateY(&rot, 0.01f);
+	beg = Stopwatch_Measure();
+	for (i = 0; i < REPLAY_MATH_ITERATIONS; i++)
+	{
+		Matrix_MulBy(&m, &rot);
+	}
+	*mulTime = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+	for (i = 0; i < REPLAY_MATH_POINTS; i++)
+	{
+		points[i] = Vec3_Create3((float)i, 1.0f, (float)-i);
+	}
+	beg = Stopwatch_Measure();
+	for (i = 0; i < REPLAY_MATH_ITERATIONS / REPLAY_MATH_POINTS; i++)
+	{
+		Vec3_TransformMany(points, sizeof(Vec3), points, sizeof(Vec3), REPLAY_MATH_POINTS, &m);
+	}
+	*transformTime = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+}
+
+static void Replay_WriteResults(void) {
+	static const cc_string path = String_FromConst(REPLAY_RESULTS_FILE);
+	cc_string str; char strBuffer[STRING_SIZE * 4];
+	int p50, p99, maxTime, chunkTime, fileCalls;
+	int mulTime, transformTime;
+	struct Stream stream;
+	cc_result res;
+
+	Replay_QuickSort(0, replay_frames - 1);
+	p50       = replay_frameTimes[(replay_frames - 1) * 50 / 100];
+	p99       = replay_frameTimes[(replay_frames - 1) * 99 / 100];
+	maxTime   = replay_frameTimes[replay_frames - 1];
+	chunkTime = (int)replay_chunkTime;
+	fileCalls = (int)Stream_FileCalls;
+	Replay_MeasureMath(&mulTime, &transformTime);
+
+	String_InitArray(str, strBuffer);
+	String_Format4(&str, "{ \"frames\": %i, \"frame_us_p50\": %i, \"frame_us_p99\": %i, \"frame_us_max\": %i, ",
+		&replay_frames, &p50, &p99, &maxTime);
+	String_Format3(&str, "\"chunk_updates\": %i, \"chunk_update_us\": %i, \"file_calls\": %i, ",
+		&replay_chunkUpdates, &chunkTime, &fileCalls);
+	/* Times to perform 100,000 matrix multiplies, and to transform 100,000 points */
+	String_Format2(&str, "\"matrix_mul_100k_us\": %i, \"transform_100k_us\": %i }",
+		&mulTime, &transformTime);
+	Platform_Log(str.buffer, str.length);
+
+	res = Stream_CreateFile(&stream, &path);
+	if (res) { Logger_SysWarn2(res, "creating", &path); return; }
+
+	res = Stream_WriteLine(&stream, &str);
+	if (res) Logger_SysWarn2(res, "writing to", &path);
+	res = stream.Close(&stream);
+	if (res) Logger_SysWarn2(res, "closing", &path);
+}
+
+static void Replay_EndFrame(cc_uint64 frameBeg) {
+	if (!replay_counting) return;
+	replay_frameTimes[replay_frame] = (int)Stopwatch_ElapsedMicroseconds(frameBeg, Stopwatch_Measure());
+	if (++replay_frame < replay_frames) return;
+
+	Replay_WriteResults();
+	Mem_Free(replay_frameTimes);
+	replay_active = false;
+	Window_RequestClose();
+}
+
+/* Also measures time spent updating chunks when running a replay benchmark */
+static void Game_UpdateMap(float delta) {
+	cc_uint64 beg;
+	int updates;
+	if (!replay_active) { MapRenderer_Update(delta); return; }
+
+	beg     = Stopwatch_Measure();
+	updates = Game.ChunkUpdates;
+	MapRenderer_Update(delta);
+
+	replay_chunkTime    += Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+	replay_chunkUpdates += Game.ChunkUpdates - updates;
+}
+
+/*########################################################################################################################*
+*--------------------------------------------------Subsystem benchmarks---------------------------------------------------*
+*#########################################################################################################################*/
+/* Times the hot routines of several subsystems on fixed inputs, so slowdowns can be bisected between versions */
+/* NOTE: All inputs are generated from a fixed seed, so each run of the same version processes identical data */
+#define PERF_RESULTS_FILE "perf.json"
+/* Each routine is run several times, and only the fastest run is reported (to reduce noise) */
+#define PERF_RUNS 5
+#define PERF_SEED 1234567
+#define PERF_MAP_WIDTH  128
+#define PERF_MAP_HEIGHT 64
+#define PERF_MAP_LENGTH 128
+#define PERF_PNG_SIZE 256
+#define PERF_JSON_SERVERS 500
+
+static cc_bool perf_active;
+static cc_uint8* perf_data;
+static cc_uint32 perf_length, perf_position, perf_capacity;
+
+void Game_StartPerf(void) { perf_active = true; }
+
+static void Perf_Record(cc_uint64 beg, int* best) {
+	int elapsed = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+	if (*best < 0 || elapsed < *best) *best = elapsed;
+}
+
+static cc_result Perf_MemWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	cc_uint32 capacity;
+	cc_uint8* buffer;
+
+	if (perf_position + count > perf_capacity) {
+		capacity = max(perf_capacity * 2, perf_position + count);
+		buffer   = (cc_uint8*)Mem_TryRealloc(perf_data, capacity, 1);
+		if (!buffer) return ERR_OUT_OF_MEMORY;
+
+		perf_data     = buffer;
+		perf_capacity = capacity;
+	}
+
+	Mem_Copy(perf_data + perf_position, data, count);
+	perf_position += count;
+	perf_length    = max(perf_length, perf_position);
+	*modified      = count;
+	return 0;
+}
+
+static cc_result Perf_MemSeek(struct Stream* s, cc_uint32 position) {
+	if (position > perf_length) return ERR_INVALID_ARGUMENT;
+	perf_position = position; return 0;
+}
+
+static cc_result Perf_MemPosition(struct Stream* s, cc_uint32* position) {
+	*position = perf_position; return 0;
+}
+
+/* Makes a stream that writes into perf_data, replacing anything previously written to it */
+/* NOTE: Seeking is supported, since e.g. PNG encoding goes back to fill in chunk sizes */
+static void Perf_MemStream(struct Stream* s) {
+	Stream_Init(s);
+	s->Write      = Perf_MemWrite;
+	s->Seek       = Perf_MemSeek;
+	s->Position   = Perf_MemPosition;
+	perf_length   = 0;
+	perf_position = 0;
+}
+
+/* Generates the map all of the other routines are timed with */
+static void Perf_GenerateMap(int* genTime) {
+	cc_uint64 beg;
+	int i;
+
+	World_NewMap();
+	World_SetDimensions(PERF_MAP_WIDTH, PERF_MAP_HEIGHT, PERF_MAP_LENGTH);
+	Gen_Active = &NotchyGen;
+
+	for (i = 0; i < PERF_RUNS; i++)
+	{
+		Mem_Free(Gen_Blocks);
+		Gen_Blocks = NULL;
+		Gen_Seed   = PERF_SEED;
+
+		beg = Stopwatch_Measure();
+		Gen_Start();
+		while (!Gen_IsDone()) { }
+		Perf_Record(beg, genTime);
+	}
+
+	World_SetNewMap(Gen_Blocks, World.Width, World.Height, World.Length);
+	World.Seed = PERF_SEED;
+	Gen_Blocks = NULL;
+}
+
+static void Perf_MeasureLighting(int* lightTime) {
+	cc_uint64 beg;
+	int i, x, y, z;
+
+	for (i = 0; i < PERF_RUNS; i++)
+	{
+		beg = Stopwatch_Measure();
+		Lighting.FreeState();
+		Lighting.AllocState();
+
+		/* Calculates lighting for every chunk, in the same way as when meshing them */
+		for (z = 0; z < World.Length; z += CHUNK_SIZE) {
+			for (y = 0; y < World.Height; y += CHUNK_SIZE) {
+				for (x = 0; x < World.Width; x += CHUNK_SIZE) {
+					Lighting.LightHint(x - 1, y - 1, z - 1);
+				}
+			}
+		}
+		Perf_Record(beg, lightTime);
+	}
+}
+
+static void Perf_MeasureBuilder(int* buildTime, int* chunks) {
+	cc_uint64 beg;
+	int i;
+
+	for (i = 0; i < PERF_RUNS; i++)
+	{
+		beg     = Stopwatch_Measure();
+		*chunks = MapRenderer_BuildAllChunks();
+		Perf_Record(beg, buildTime);
+	}
+}
+
+/* Times saving the map to a gzip compressed .cw file in memory, then decompressing and parsing it again */
+static void Perf_MeasureFormats(int* saveTime, int* inflateTime, int* parseTime) {
+	struct GZipState* gzip;
+	struct InflateState* inflate;
+	struct GZipHeader header;
+	struct Stream mem, stream, src;
+	cc_uint8* nbt;
+	cc_uint32 nbtLength;
+	cc_uint64 beg;
+	cc_result res = 0;
+	int i;
+
+	gzip    = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+	inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	if (!gzip || !inflate) { res = ERR_OUT_OF_MEMORY; goto cleanup; }
+
+	for (i = 0; i < PERF_RUNS; i++)
+	{
+		Perf_MemStream(&mem);
+		GZip_MakeStream(&stream, gzip, &mem);
+
+		beg = Stopwatch_Measure();
+		res = Cw_Save(&stream);
+		if (!res) res = stream.Close(&stream);
+		if (res) goto cleanup;
+		Perf_Record(beg, saveTime);
+	}
+
+	/* Last 4 bytes of the gzip footer are the uncompressed size */
+	nbtLength = Stream_GetU32_LE(perf_data + perf_length - 4);
+	nbt       = (cc_uint8*)Mem_TryAlloc(nbtLength, 1);
+	if (!nbt) { res = ERR_OUT_OF_MEMORY; goto cleanup; }
+
+	for (i = 0; i < PERF_RUNS; i++)
+	{
+		Stream_ReadonlyMemory(&src, perf_data, perf_length);
+		GZipHeader_Init(&header);
+		beg = Stopwatch_Measure();
+
+		while (!header.done && !(res = GZipHeader_Read(&src, &header))) { }
+		Inflate_MakeStream2(&stream, inflate, &src);
+		if (!res) res = Stream_Read(&stream, nbt, nbtLength);
+		if (res) break;
+		Perf_Record(beg, inflateTime);
+	}
+	Mem_Free(nbt);
+
+	for (i = 0; !res && i < PERF_RUNS; i++)
+	{
+		Stream_ReadonlyMemory(&src, perf_data, perf_length);
+		beg = Stopwatch_Measure();
+
+		res = Cw_Scan(&src);
+		if (!res) Perf_Record(beg, parseTime);
+	}
+
+cleanup:
+	if (res) Logger_SysWarn(res, "timing .cw saving and loading");
+	Mem_Free(gzip);
+	Mem_Free(inflate);
+}
+
+static void Perf_MeasurePng(int* encodeTime, int* decodeTime) {
+	struct Bitmap bmp, decoded;
+	struct Stream mem, src;
+	RNGState rnd;
+	BitmapCol col;
+	cc_uint64 beg;
+	cc_result res = 0;
+	int i, x, y, shade;
+
+	Bitmap_TryAllocate(&bmp, PERF_PNG_SIZE, PERF_PNG_SIZE);
+	if (!bmp.scan0) { Logger_SysWarn(ERR_OUT_OF_MEMORY, "allocating bitmap"); return; }
+	Random_Seed(&rnd, PERF_SEED);
+
+	/* Groups of 4x4 pixels in one of 16 shades, roughly like a texture pack's textures */
+	for (y = 0; y < PERF_PNG_SIZE; y++)
+	{
+		for (x = 0; x < PERF_PNG_SIZE; x += 4)
+		{
+			if (!(y & 3)) {
+				shade = Random_Next(&rnd, 16) * 16;
+				col   = BitmapCol_Make(shade, 255 - shade, shade / 2, 255);
+			} else {
+				col   = Bitmap_GetPixel(&bmp, x, y - 1);
+			}
+			Bitmap_GetPixel(&bmp, x, y) = col; Bitmap_GetPixel(&bmp, x + 1, y) = col;
+			Bitmap_GetPixel(&bmp, x + 2, y) = col; Bitmap_GetPixel(&bmp, x + 3, y) = col;
+		}
+	}
+
+	for (i = 0; !res && i < PERF_RUNS; i++)
+	{
+		Perf_MemStream(&mem);
+		beg = Stopwatch_Measure();
+
+		res = Png_Encode(&bmp, &mem, NULL, true, NULL);
+		if (!res) Perf_Record(beg, encodeTime);
+	}
+
+	for (i = 0; !res && i < PERF_RUNS; i++)
+	{
+		Stream_ReadonlyMemory(&src, perf_data, perf_length);
+		beg = Stopwatch_Measure();
+
+		res = Png_Decode(&decoded, &src);
+		if (!res) Perf_Record(beg, decodeTime);
+		Mem_Free(decoded.scan0);
+	}
+
+	if (res) Logger_SysWarn(res, "timing PNG encoding and decoding");
+	Mem_Free(bmp.scan0);
+}
+
+#ifndef CC_BUILD_WEB
+/* Times parsing a server list much like the one the launcher downloads */
+static void Perf_MeasureJson(int* parseTime) {
+	static const cc_string head = String_FromConst("{ \"servers\": [");
+	static const cc_string tail = String_FromConst("] }");
+	cc_string entry; char entryBuffer[STRING_SIZE * 8];
+	struct JsonContext ctx;
+	cc_uint64 beg;
+	char* json;
+	int i, length, uptime;
+
+	json = (char*)Mem_TryAlloc(PERF_JSON_SERVERS + 1, sizeof(entryBuffer));
+	if (!json) { Logger_SysWarn(ERR_OUT_OF_MEMORY, "allocating JSON"); return; }
+	Mem_Copy(json, head.buffer, head.length);
+	length = head.length;
+
+	for (i = 0; i < PERF_JSON_SERVERS; i++)
+	{
+		String_InitArray(entry, entryBuffer);
+		uptime = i * 3600;
+		if (i) String_Append(&entry, ',');
+
+		String_Format2(&entry, "{ \"hash\": \"%h\", \"name\": \"Server number %i\", ", &i, &i);
+		String_Format3(&entry, "\"players\": %i, \"maxplayers\": 64, \"uptime\": %i, \"port\": %i, ", &i, &uptime, &i);
+		String_AppendConst(&entry, "\"ip\": \"127.0.0.1\", \"mppass\": \"ff00ff00ff00ff00ff00ff00ff00ff00\", ");
+		String_AppendConst(&entry, "\"software\": \"&bMCGalaxy \\u00A7 1.9\", \"featured\": false, \"country_abbr\": \"NZ\" }");
+
+		Mem_Copy(json + length, entry.buffer, entry.length);
+		length += entry.length;
+	}
+	Mem_Copy(json + length, tail.buffer, tail.length);
+	length += tail.length;
+
+	for (i = 0; i < PERF_RUNS; i++)
+	{
+		Json_Init(&ctx, json, length);
+		beg = Stopwatch_Measure();
+
+		if (Json_Parse(&ctx)) Perf_Record(beg, parseTime);
+	}
+	Mem_Free(json);
+}
+#else
+static void Perf_MeasureJson(int* parseTime) { }
+#endif
+
+static void Perf_Run(void) {
+	static const cc_string path = String_FromConst(PERF_RESULTS_FILE);
+	cc_string str; char strBuffer[STRING_SIZE * 8];
+	/* Times are -1 when the routine could not be measured */
+	int genTime = -1, lightTime = -1, buildTime = -1, chunks = 0;
+	int saveTime = -1, inflateTime = -1, parseTime = -1;
+	int encodeTime = -1, decodeTime = -1, jsonTime = -1;
+	int runs = PERF_RUNS;
+	struct Stream stream;
+	cc_result res;
+
+	perf_active = false;
+	Perf_GenerateMap(&genTime);
+	if (World.Blocks) {
+		Perf_MeasureLighting(&lightTime);
+		Perf_MeasureBuilder(&buildTime, &chunks);
+		Perf_MeasureFormats(&saveTime, &inflateTime, &parseTime);
+	}
+	Perf_MeasurePng(&encodeTime, &decodeTime);
+	Perf_MeasureJson(&jsonTime);
+
+	Mem_Free(perf_data);
+	perf_data     = NULL;
+	perf_capacity = 0;
+
+	String_InitArray(str, strBuffer);
+	String_Format4(&str, "{ \"runs\": %i, \"notchy_gen_us\": %i, \"lighting_us\": %i, \"chunk_build_us\": %i, ",
+		&runs, &genTime, &lightTime, &buildTime);
+	String_Format4(&str, "\"chunks\": %i, \"cw_save_us\": %i, \"inflate_us\": %i, \"cw_parse_us\": %i, ",
+		&chunks, &saveTime, &inflateTime, &parseTime);
+	String_Format3(&str, "\"png_encode_us\": %i, \"png_decode_us\": %i, \"json_parse_us\": %i }",
+		&encodeTime, &decodeTime, &jsonTime);
+	Platform_Log(str.buffer, str.length);
+
+	res = Stream_CreateFile(&stream, &path);
+	if (res) { Logger_SysWarn2(res, "creating", &path); return; }
+
+	res = Stream_WriteLine(&stream, &str);
+	if (res) Logger_SysWarn2(res, "writing to", &path);
+	res = stream.Close(&stream);
+	if (res) Logger_SysWarn2(res, "closing", &path);
+	Window_RequestClose();
+}
+
 static void Render3DFrame(float delta, float t) {
 	struct Matrix mvp;
 	Vec3 pos;
@@ -516,26 +1649,52 @@ static void Render3DFrame(float delta, float t) {
 	Gfx_LoadMVP(&Gfx.View, &Gfx.Projection, &mvp);
 	FrustumCulling_CalcFrustumEquations(&mvp);
 
+	Game_BeginProfile(PROFILE_SKY);
+#ifndef ENVRENDERER_SKYBOX_AFTER_MAP
 	if (EnvRenderer_ShouldRenderSkybox()) EnvRenderer_RenderSkybox();
+#endif
 	AxisLinesRenderer_Render();
+	Game_EndProfile();
+
+	Game_BeginProfile(PROFILE_ENTITIES);
 	Entities_RenderModels(delta, t);
 	EntityNames_Render();
+	Game_EndProfile();
 
+	Game_BeginProfile(PROFILE_PARTICLES);
 	Particles_Render(t);
+	Game_EndProfile();
+
+	Game_BeginProfile(PROFILE_SKY);
 	EnvRenderer_RenderSky();
 	EnvRenderer_RenderClouds();
+	Game_EndProfile();
 
-	MapRenderer_Update(delta);
+	Game_BeginProfile(PROFILE_MAP_NORMAL);
+	Game_BeginProfile(PROFILE_MAP_BUILD);
+	Game_UpdateMap(delta);
+	Game_EndProfile();
 	MapRenderer_RenderNormal(delta);
 	EnvRenderer_RenderMapSides();
+	Game_EndProfile();
+
+#ifdef ENVRENDERER_SKYBOX_AFTER_MAP
+	Game_BeginProfile(PROFILE_SKY);
+	if (EnvRenderer_ShouldRenderSkybox()) EnvRenderer_RenderSkybox();
+	Game_EndProfile();
+#endif
 
+	Game_BeginProfile(PROFILE_ENTITIES);
 	EntityShadows_Render();
+	Game_EndProfile();
 	if (Game_SelectedPos.valid && !Game_HideGui) {
 		SelOutlineRenderer_Render(&Game_SelectedPos, true);
 	}
+	Plugins_RunHooks(PLUGIN_HOOK_RENDER, PLUGIN_PASS_OPAQUE, delta);
 
 	/* Render water over translucent blocks when under the water outside the map for proper alpha blending */
 	pos = Camera.CurrentPos;
+	Game_BeginProfile(PROFILE_MAP_TRANSLUCENT);
 	if (pos.y < Env.EdgeHeight && (pos.x < 0 || pos.z < 0 || pos.x > World.Width || pos.z > World.Length)) {
 		MapRenderer_RenderTranslucent(delta);
 		EnvRenderer_RenderMapEdges();
@@ -543,12 +1702,14 @@ static void Render3DFrame(float delta, float t) {
 		EnvRenderer_RenderMapEdges();
 		MapRenderer_RenderTranslucent(delta);
 	}
+	Game_EndProfile();
 
 	/* Need to render again over top of translucent block, as the selection outline */
 	/* is drawn without writing to the depth buffer */
 	if (Game_SelectedPos.valid && !Game_HideGui && Blocks.Draw[Game_SelectedPos.block] == DRAW_TRANSLUCENT) {
 		SelOutlineRenderer_Render(&Game_SelectedPos, false);
 	}
+	Plugins_RunHooks(PLUGIN_HOOK_RENDER, PLUGIN_PASS_TRANSLUCENT, delta);
 
 	Selections_Render();
 	EntityNames_RenderHovered();
@@ -568,30 +1729,112 @@ static void Render3D_Anaglyph(float delta, float t) {
 	Gfx_End3D(&proj, &view);
 }
 
-static void PerformScheduledTasks(double time) {
-	struct ScheduledTask* task;
-	int i;
+static void Render3D_Scaled(float delta, float t) {
+	float scale = 1.0f - dynres_level * DYNRES_SCALE_STEP;
+	int width   = max(1, (int)(Game.Width  * scale));
+	int height  = max(1, (int)(Game.Height * scale));
 
-	for (i = 0; i < tasksCount; i++) {
-		task = &tasks[i];
-		task->accumulator += time;
+	Gfx_BeginScaledScene(width, height);
+	Render3DFrame(delta, t);
+	Gfx_EndScaledScene(width, height);
+}
 
-		while (task->accumulator >= task->interval) {
-			task->Callback(task);
-			task->accumulator -= task->interval;
-		}
+#ifdef CC_BUILD_SCREENSHOTWORKER
+/* Encoding a large screenshot as .png can take a long while, so to avoid */
+/*  a noticeable hitch, only the readback happens on the main thread */
+/* When supported, the readback itself is also asynchronous, to avoid stalling until the GPU catches up */
+static struct Bitmap shot_bmp;
+static cc_string shot_path; static char shot_pathBuffer[FILENAME_SIZE];
+static cc_string shot_name; static char shot_nameBuffer[STRING_SIZE];
+static void* shot_thread;
+static volatile cc_bool shot_finished;
+static cc_bool shot_reading;
+static const char* shot_place;
+static cc_result shot_result;
+
+static BitmapCol* Screenshot_GetRow(struct Bitmap* bmp, int y, void* ctx) { 
+	/* Rows from Gfx_ReadScreenshot are in bottom-up order, so flip order when saving */
+	return Bitmap_GetRow(bmp, (bmp->height - 1) - y); 
+}
+
+static void ScreenshotWorker_Run(void) {
+	struct Stream stream;
+	cc_result res;
+
+	res = Stream_CreateFile(&stream, &shot_path);
+	if (res) { shot_place = "creating"; goto finished; }
+
+	res = Png_EncodeFast(&shot_bmp, &stream, Screenshot_GetRow, false, NULL);
+	if (res) {
+		shot_place = "saving to"; stream.Close(&stream);
+	} else if ((res = stream.Close(&stream))) {
+		shot_place = "closing";
 	}
+
+finished:
+	shot_result   = res;
+	shot_finished = true;
+}
+
+/* Waits for the screenshot thread to finish, then reports whether the screenshot was saved */
+static void ScreenshotWorker_Finish(void) {
+	Thread_Join(shot_thread);
+	shot_thread = NULL;
+
+	Mem_Free(shot_bmp.scan0);
+	shot_bmp.scan0 = NULL;
+
+	if (shot_result) { Logger_SysWarn2(shot_result, shot_place, &shot_path); return; }
+	Chat_Add1("&eTaken screenshot as: %s", &shot_name);
+
+#ifdef CC_BUILD_MOBILE
+	Platform_ShareScreenshot(&shot_name);
+#endif
+}
+
+static void ScreenshotWorker_Encode(void) {
+	shot_finished = false;
+	Thread_Run(&shot_thread, ScreenshotWorker_Run, 64 * 1024, "Screenshot");
+}
+
+/* Retrieves the backbuffer copied by the GPU, then starts encoding it */
+static void ScreenshotWorker_EndRead(void) {
+	cc_result res;
+	shot_reading = false;
+
+	res = Gfx_EndReadScreenshot(&shot_bmp);
+	if (res) { Logger_SysWarn2(res, "saving to", &shot_path); return; }
+	ScreenshotWorker_Encode();
 }
 
+static void ScreenshotWorker_Start(const cc_string* filename, const cc_string* path) {
+	cc_result res;
+	/* Only one screenshot can be saved at once */
+	if (shot_reading) ScreenshotWorker_EndRead();
+	if (shot_thread)  ScreenshotWorker_Finish();
+
+	String_InitArray(shot_path, shot_pathBuffer);
+	String_Copy(&shot_path, path);
+	String_InitArray(shot_name, shot_nameBuffer);
+	String_Copy(&shot_name, filename);
+
+	if (Gfx_BeginReadScreenshot()) { shot_reading = true; return; }
+
+	res = Gfx_ReadScreenshot(&shot_bmp);
+	if (res) { Logger_SysWarn2(res, "saving to", path); return; }
+	ScreenshotWorker_Encode();
+}
+#endif
+
 void Game_TakeScreenshot(void) {
 	cc_string filename; char fileBuffer[STRING_SIZE];
 	cc_string path;     char pathBuffer[FILENAME_SIZE];
 	struct DateTime now;
-	cc_result res;
 #ifdef CC_BUILD_WEB
 	cc_filepath str;
-#else
+#elif !defined CC_BUILD_SCREENSHOTWORKER
 	struct Stream stream;
+	cc_result res;
 #endif
 	Game_ScreenshotRequested = false;
 	DateTime_CurrentLocal(&now);
@@ -609,6 +1852,9 @@ void Game_TakeScreenshot(void) {
 	String_InitArray(path, pathBuffer);
 	String_Format1(&path, "screenshots/%s", &filename);
 
+#ifdef CC_BUILD_SCREENSHOTWORKER
+	ScreenshotWorker_Start(&filename, &path);
+#else
 	res = Stream_CreateFile(&stream, &path);
 	if (res) { Logger_SysWarn2(res, "creating", &path); return; }
 
@@ -625,6 +1871,7 @@ void Game_TakeScreenshot(void) {
 	Platform_ShareScreenshot(&filename);
 #endif
 #endif
+#endif
 }
 
 
@@ -669,6 +1916,282 @@ static void LimitFPS(void) {
 }
 #endif
 
+/* The first few frames of a benchmark are ignored, since chunks are usually still being built then */
+#define BENCHMARK_WARMUP_FRAMES 60
+static int bench_frames, bench_framesLeft;
+static int bench_total, bench_min, bench_max;
+
+void Game_StartBenchmark(int frames) {
+	bench_frames     = frames;
+	bench_framesLeft = frames + BENCHMARK_WARMUP_FRAMES;
+	bench_total = 0; bench_min = Int32_MaxValue; bench_max = 0;
+}
+
+static void Game_BenchmarkFrame(cc_uint64 frameBeg) {
+	int elapsed = (int)Stopwatch_ElapsedMicroseconds(frameBeg, Stopwatch_Measure());
+	int average;
+	if (--bench_framesLeft >= bench_frames) return;
+
+	bench_total += elapsed;
+	bench_min = min(bench_min, elapsed);
+	bench_max = max(bench_max, elapsed);
+	if (bench_framesLeft) return;
+
+	average = bench_total / bench_frames;
+	Chat_Add4("&eBenchmark: &f%i frames, %i us average, %i us min, %i us max",
+		&bench_frames, &average, &bench_min, &bench_max);
+}
+
+
+
+
+const char* const Profile_Names[PROFILE_COUNT] = {
+	"sky", "entities", "particles", "map", "translucent", "weather", "gui",
+	"build", "events", "tasks", "present", "sleep", "plugins"
+};
+cc_bool Game_Profiling;
+int Game_ProfileCpuTimes[PROFILE_COUNT], Game_ProfileGpuTimes[PROFILE_COUNT];
+
+/* Stages can be nested (e.g. weather is rendered during translucent map rendering) */
+#define PROFILE_MAX_DEPTH 4
+static int prof_stack[PROFILE_MAX_DEPTH], prof_depth;
+static int prof_cpuTotal[PROFILE_COUNT], prof_gpuTotal[PROFILE_COUNT];
+static int prof_frames;
+static float prof_elapsed;
+static cc_uint64 prof_beg, prof_frameEnd;
+static struct Stream prof_csv;
+
+/* Times of the current frame, which are copied into the history once the frame ends */
+static struct ProfileSample prof_cur;
+static struct ProfileSample* prof_history;
+static int prof_head, prof_count;
+
+void Game_BeginProfile(int stage) {
+	cc_uint64 now;
+	if (!Game_Profiling || prof_depth == PROFILE_MAX_DEPTH) return;
+	now = Stopwatch_Measure();
+
+	if (prof_depth) {
+		prof_cur.times[prof_stack[prof_depth - 1]] += (int)Stopwatch_ElapsedMicroseconds(prof_beg, now);
+		Gfx_EndGpuTimer();
+	}
+	prof_stack[prof_depth++] = stage;
+
+	prof_beg = now;
+	if (stage < PROFILE_GPU_COUNT) Gfx_BeginGpuTimer(stage);
+}
+
+void Game_EndProfile(void) {
+	cc_uint64 now;
+	int stage;
+	if (!Game_Profiling || !prof_depth) return;
+	now = Stopwatch_Measure();
+
+	prof_cur.times[prof_stack[--prof_depth]] += (int)Stopwatch_ElapsedMicroseconds(prof_beg, now);
+	Gfx_EndGpuTimer();
+	if (!prof_depth) return;
+
+	prof_beg = now;
+	stage    = prof_stack[prof_depth - 1];
+	if (stage < PROFILE_GPU_COUNT) Gfx_BeginGpuTimer(stage);
+}
+
+const struct ProfileSample* Game_GetProfileSample(int framesAgo) {
+	if (framesAgo < 0 || framesAgo >= prof_count) return NULL;
+	return &prof_history[(prof_head - 1 - framesAgo) & (PROFILE_HISTORY_SIZE - 1)];
+}
+
+static void Game_ProfileTask(int i, cc_uint64 beg) {
+	if (i >= PROFILE_MAX_TASKS) return;
+	prof_cur.tasks[i] += (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+}
+
+static void Game_CloseProfileCsv(void) {
+	cc_result res;
+	if (!prof_csv.meta.file) return;
+
+	res = prof_csv.Close(&prof_csv);
+	if (res) Logger_SysWarn(res, "closing profile CSV");
+	prof_csv.meta.file = 0;
+}
+
+static void Game_WriteProfileCsv(cc_bool header) {
+	cc_string line; char lineBuffer[STRING_SIZE * 4];
+	float time = (float)Game.Time;
+	cc_result res;
+	int i;
+	String_InitArray(line, lineBuffer);
+
+	if (header) {
+		String_AppendConst(&line, "time");
+		for (i = 0; i < PROFILE_COUNT; i++)
+		{
+			String_Format1(&line, ",%c_cpu", Profile_Names[i]);
+			if (i < PROFILE_GPU_COUNT) String_Format1(&line, ",%c_gpu", Profile_Names[i]);
+		}
+	} else {
+		String_Format1(&line, "%f2", &time);
+		for (i = 0; i < PROFILE_COUNT; i++)
+		{
+			String_Format1(&line, ",%i", &Game_ProfileCpuTimes[i]);
+			if (i < PROFILE_GPU_COUNT) String_Format1(&line, ",%i", &Game_ProfileGpuTimes[i]);
+		}
+	}
+
+	res = Stream_WriteLine(&prof_csv, &line);
+	if (!res) return;
+	Logger_SysWarn(res, "writing profile CSV");
+	Game_CloseProfileCsv();
+}
+
+void Game_SetProfiling(cc_bool enabled, const cc_string* csvPath) {
+	cc_result res;
+	Game_CloseProfileCsv();
+
+	Game_Profiling = enabled;
+	prof_depth     = 0;
+	prof_frames    = 0;
+	prof_elapsed   = 0;
+	prof_head      = 0;
+	prof_count     = 0;
+	prof_frameEnd  = Stopwatch_Measure();
+	Mem_Set(prof_cpuTotal, 0, sizeof(prof_cpuTotal));
+	Mem_Set(prof_gpuTotal, 0, sizeof(prof_gpuTotal));
+	Mem_Set(&prof_cur,     0, sizeof(prof_cur));
+
+	if (!enabled) {
+		Mem_Free(prof_history);
+		prof_history = NULL;
+		return;
+	}
+
+	/* History is optional, so just don't keep it when out of memory */
+	if (!prof_history) {
+		prof_history = (struct ProfileSample*)Mem_TryAlloc(PROFILE_HISTORY_SIZE, sizeof(struct ProfileSample));
+	}
+	if (!csvPath) return;
+
+	res = Stream_CreateFile(&prof_csv, csvPath);
+	if (res) { Logger_SysWarn2(res, "creating", csvPath); return; }
+	Game_WriteProfileCsv(true);
+}
+
+cc_result Game_DumpProfileHistory(const cc_string* path, int* frames) {
+	cc_string line; char lineBuffer[STRING_SIZE * 4];
+	const struct ProfileSample* sample;
+	struct Stream stream;
+	cc_result res;
+	int i, j, tasksUsed = min(tasksCount, PROFILE_MAX_TASKS);
+
+	*frames = prof_count;
+	res = Stream_CreateFile(&stream, path);
+	if (res) return res;
+
+	String_InitArray(line, lineBuffer);
+	String_AppendConst(&line, "frame");
+	for (i = 0; i < PROFILE_COUNT; i++)
+	{
+		String_Format1(&line, ",%c", Profile_Names[i]);
+	}
+	for (i = 0; i < tasksUsed; i++)
+	{
+		String_Format1(&line, ",task%i", &i);
+	}
+	res = Stream_WriteLine(&stream, &line);
+
+	for (i = prof_count - 1; i >= 0 && !res; i--)
+	{
+		sample = Game_GetProfileSample(i);
+		line.length = 0;
+		String_AppendInt(&line, sample->frameTime);
+
+		for (j = 0; j < PROFILE_COUNT; j++)
+		{
+			String_Format1(&line, ",%i", &sample->times[j]);
+		}
+		for (j = 0; j < tasksUsed; j++)
+		{
+			String_Format1(&line, ",%i", &sample->tasks[j]);
+		}
+		res = Stream_WriteLine(&stream, &line);
+	}
+
+	if (res) { stream.Close(&stream); return res; }
+	return stream.Close(&stream);
+}
+
+static void Game_ProfileFrame(float delta) {
+	cc_uint64 now = Stopwatch_Measure();
+	int i, gpuTime;
+	prof_depth = 0;
+	prof_frames++;
+	prof_elapsed += delta;
+
+	prof_cur.frameTime = (int)Stopwatch_ElapsedMicroseconds(prof_frameEnd, now);
+	prof_frameEnd      = now;
+	if (prof_history) {
+		prof_history[prof_head] = prof_cur;
+		prof_head  = (prof_head + 1) & (PROFILE_HISTORY_SIZE - 1);
+		prof_count = min(prof_count + 1, PROFILE_HISTORY_SIZE);
+	}
+
+	for (i = 0; i < PROFILE_COUNT; i++)
+	{
+		prof_cpuTotal[i] += prof_cur.times[i];
+	}
+	for (i = 0; i < PROFILE_GPU_COUNT; i++)
+	{
+		gpuTime = Gfx_GetGpuTime(i);
+		/* Use -1 as the total to indicate that GPU times are unsupported */
+		prof_gpuTotal[i] = gpuTime < 0 ? -1 : prof_gpuTotal[i] + gpuTime;
+	}
+	Mem_Set(&prof_cur, 0, sizeof(prof_cur));
+	if (prof_elapsed < 1.0f) return;
+
+	for (i = 0; i < PROFILE_COUNT; i++)
+	{
+		Game_ProfileCpuTimes[i] = prof_cpuTotal[i] / prof_frames;
+		/* CPU only stages have no GPU time */
+		Game_ProfileGpuTimes[i] = i >= PROFILE_GPU_COUNT || prof_gpuTotal[i] < 0 ? -1 : prof_gpuTotal[i] / prof_frames;
+		prof_cpuTotal[i] = 0;
+		prof_gpuTotal[i] = 0;
+	}
+	prof_frames  = 0;
+	prof_elapsed = 0;
+	if (prof_csv.meta.file) Game_WriteProfileCsv(false);
+}
+
+static void PerformScheduledTasks(double time) {
+	struct ScheduledTask* task;
+	cc_uint64 beg = Stopwatch_Measure(), taskBeg;
+	int i, runs, dropped;
+	double elapsed;
+
+	for (i = 0; i < tasksCount; i++) {
+		task = &tasks[i];
+		task->accumulator += time;
+		if (task->accumulator < task->interval) continue;
+
+		taskBeg = Stopwatch_Measure();
+		for (runs = 1; ; runs++) {
+			task->Callback(task);
+			task->accumulator -= task->interval;
+			if (task->accumulator < task->interval) break;
+
+			elapsed = Stopwatch_ElapsedMicroseconds(taskBeg, Stopwatch_Measure()) / (1000.0 * 1000.0);
+			if (runs < task->maxCatchup && elapsed < task->budget) continue;
+
+			/* Too far behind, so drop whole intervals (but keep remainder for interpolation) */
+			dropped = (int)(task->accumulator / task->interval);
+			task->accumulator -= dropped * task->interval;
+			Game.TicksDropped += dropped;
+			break;
+		}
+		if (Game_Profiling) Game_ProfileTask(i, taskBeg);
+	}
+	Game.TickTime += (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+}
+
 static CC_INLINE void Game_DrawFrame(float delta, float t) {
 	int i;
 
@@ -679,6 +2202,8 @@ static CC_INLINE void Game_DrawFrame(float delta, float t) {
 
 		if (Game_Anaglyph3D) {
 			Render3D_Anaglyph(delta, t);
+		} else if (DynRes_Active()) {
+			Render3D_Scaled(delta, t);
 		} else {
 			Render3DFrame(delta, t);
 		}
@@ -686,12 +2211,14 @@ static CC_INLINE void Game_DrawFrame(float delta, float t) {
 		RayTracer_SetInvalid(&Game_SelectedPos);
 	}
 
+	Game_BeginProfile(PROFILE_GUI);
 	Gfx_Begin2D(Game.Width, Game.Height);
 	Gui_RenderGui(delta);
 	for (i = 0; i < Array_Elems(Game.Draw2DHooks); i++)
 	{
 		if (Game.Draw2DHooks[i]) Game.Draw2DHooks[i](delta);
 	}
+	Plugins_RunHooks(PLUGIN_HOOK_RENDER, PLUGIN_PASS_GUI, delta);
 
 /* TODO find a better solution than this */
 #ifdef CC_BUILD_3DS
@@ -702,6 +2229,7 @@ static CC_INLINE void Game_DrawFrame(float delta, float t) {
 	}
 #endif
 	Gfx_End2D();
+	Game_EndProfile();
 }
 
 #ifdef CC_BUILD_SPLITSCREEN
@@ -726,19 +2254,111 @@ int Game_MapState(int deviceIndex) {
 }
 #endif
 
+/*########################################################################################################################*
+*-------------------------------------------------------Idle frames-------------------------------------------------------*
+*#########################################################################################################################*/
+/* While a menu is open or the window is unfocused, and the user has not done anything for a while, */
+/*  frames are only drawn occasionally (or when the camera moves), with the last frame staying on screen */
+/*  in between. Scheduled tasks (e.g. network ticks) still run, just with the game loop sleeping in between */
+/* NOTE: Since presenting swaps buffers, just the GUI can't be redrawn on top of the last frame */
+#define IDLE_INPUT_DELAY 1.0
+#define IDLE_SLEEP_MS    50
+#define IDLE_REDRAW_FOCUSED   0.25
+#define IDLE_REDRAW_UNFOCUSED 1.0
+
+static cc_bool idle_enabled;
+/* Game.Time that input was last received at, and that a frame was last drawn at */
+static double idle_lastInput, idle_lastDrawn;
+static Vec3 idle_camPos;
+static float idle_camYaw, idle_camPitch;
+
+/* Draws frames at full rate again for a while */
+static void Idle_Wake(void)       { idle_lastInput = Game.Time; }
+/* Draws the next frame, without leaving idle mode */
+static void Idle_Invalidate(void) { idle_lastDrawn = -IDLE_REDRAW_UNFOCUSED; }
+
+static void Idle_OnInput(void* obj, int key, cc_bool repeating, struct InputDevice* device) { Idle_Wake(); }
+static void Idle_OnPointer(void* obj, int idx)                   { Idle_Wake(); }
+static void Idle_OnRawMove(void* obj, float xDelta, float yDelta) { Idle_Wake(); }
+static void Idle_OnAxis(void* obj, int port, int axis, float x, float y) { Idle_Wake(); }
+static void Idle_OnWheel(void* obj, float delta)  { Idle_Wake(); }
+static void Idle_OnWindow(void* obj)              { Idle_Wake(); }
+static void Idle_OnRedraw(void* obj)              { Idle_Invalidate(); }
+static void Idle_OnChat(void* obj, const cc_string* msg, int msgType) { Idle_Invalidate(); }
+
+static void Idle_Init(void) {
+	idle_enabled = Options_GetBool(OPT_IDLE_RENDERING, true);
+	if (!idle_enabled) return;
+
+	Event_Register_(&InputEvents.Down2,        NULL, Idle_OnInput);
+	Event_Register_(&InputEvents.Up2,          NULL, Idle_OnInput);
+	Event_Register_(&InputEvents.Press,        NULL, Idle_OnPointer);
+	Event_Register_(&InputEvents.Wheel,        NULL, Idle_OnWheel);
+	Event_Register_(&PointerEvents.Moved,      NULL, Idle_OnPointer);
+	Event_Register_(&PointerEvents.Down,       NULL, Idle_OnPointer);
+	Event_Register_(&PointerEvents.Up,         NULL, Idle_OnPointer);
+	Event_Register_(&PointerEvents.RawMoved,   NULL, Idle_OnRawMove);
+	Event_Register_(&ControllerEvents.AxisUpdate, NULL, Idle_OnAxis);
+
+	Event_Register_(&WindowEvents.FocusChanged, NULL, Idle_OnWindow);
+	Event_Register_(&WindowEvents.StateChanged, NULL, Idle_OnWindow);
+	Event_Register_(&WindowEvents.Resized,      NULL, Idle_OnWindow);
+	Event_Register_(&WindowEvents.RedrawNeeded, NULL, Idle_OnRedraw);
+	Event_Register_(&ChatEvents.ChatReceived,   NULL, Idle_OnChat);
+}
+
+/* Whether drawing this frame can be skipped, leaving the last drawn frame on screen */
+static cc_bool Idle_CanSkipFrame(void) {
+	struct Entity* e = &Entities.CurPlayer->Base;
+	double interval;
+
+	if (!idle_enabled || replay_active || bench_framesLeft || Game_ScreenshotRequested) return false;
+	if (Window_Main.Focused && !Gui.InputGrab) return false;
+	if (Game.Time - idle_lastInput < IDLE_INPUT_DELAY) return false;
+
+	/* e.g. server teleported the player while in a menu */
+	if (!Vec3_Equals(&Camera.CurrentPos, &idle_camPos)) return false;
+	if (e->Yaw != idle_camYaw || e->Pitch != idle_camPitch) return false;
+
+	interval = Window_Main.Focused ? IDLE_REDRAW_FOCUSED : IDLE_REDRAW_UNFOCUSED;
+	return Game.Time - idle_lastDrawn < interval;
+}
+
+static void Idle_FrameDrawn(void) {
+	struct Entity* e = &Entities.CurPlayer->Base;
+	idle_lastDrawn = Game.Time;
+	idle_camPos    = Camera.CurrentPos;
+	idle_camYaw    = e->Yaw;
+	idle_camPitch  = e->Pitch;
+}
+
 static CC_INLINE void Game_RenderFrame(void) {
 	struct ScheduledTask entTask;
+	cc_uint64 render, elapsed;
+	cc_bool idle;
 	double deltaD;
 	float t, delta;
 
-	cc_uint64 render  = Stopwatch_Measure();
-	cc_uint64 elapsed = Stopwatch_ElapsedMicroseconds(frameStart, render);
+	/* The FPS limit sleep is done before input is processed, rather than straight after */
+	/*  presenting the last frame, so that this frame is drawn with the latest mouse input */
+	if (gfx_pendingSleep) {
+		gfx_pendingSleep = false;
+		Game_BeginProfile(PROFILE_SLEEP);
+		LimitFPS();
+		Game_EndProfile();
+	}
+
+	render  = Stopwatch_Measure();
+	elapsed = Stopwatch_ElapsedMicroseconds(frameStart, render);
 	/* avoid large delta with suspended process */
 	if (elapsed > 5000000) elapsed = 5000000;
 	
 	deltaD = (int)elapsed / (1000.0 * 1000.0);
+	if (replay_active) deltaD = REPLAY_FRAME_DELTA;
 	delta  = (float)deltaD;
+	Game_BeginProfile(PROFILE_EVENTS);
 	Window_ProcessEvents(delta);
+	Game_EndProfile();
 
 	if (delta <= 0.0f) return;
 	frameStart = render;
@@ -758,8 +2378,11 @@ static CC_INLINE void Game_RenderFrame(void) {
 		}
 	}
 
-	Gfx_BeginFrame();
-	Gfx_BindIb(Gfx.DefaultIb);
+	idle = Idle_CanSkipFrame();
+	if (!idle) {
+		Gfx_BeginFrame();
+		Gfx_BindIb(Gfx.DefaultIb);
+	}
 	Game.Time += deltaD;
 	Game_Vertices = 0;
 	Gamepad_Tick(delta);
@@ -784,7 +2407,17 @@ static CC_INLINE void Game_RenderFrame(void) {
 		InputHandler_SetFOV(Camera.ZoomFov);
 	}
 
+	if (replay_active) Replay_BeginFrame();
+	/* Only start timing once the initial map has finished generating */
+	if (perf_active && World.Loaded) Perf_Run();
+	Jobs_FinishDone();
+	Plugins_RunHooks(PLUGIN_HOOK_PRETICK, 0, delta);
+	Game_BeginProfile(PROFILE_TASKS);
 	PerformScheduledTasks(deltaD);
+	Game_EndProfile();
+	Plugins_RunHooks(PLUGIN_HOOK_POSTTICK, 0, delta);
+	Plugins_CheckTimes(delta);
+	Block_ApplyDefChanges();
 	entTask = tasks[entTaskI];
 	t = (float)(entTask.accumulator / entTask.interval);
 	LocalPlayer_SetInterpPosition(Entities.CurPlayer, t);
@@ -794,6 +2427,7 @@ static CC_INLINE void Game_RenderFrame(void) {
 	EnvRenderer_UpdateFog();
 	AudioBackend_Tick();
 
+	if (idle) { Thread_Sleep(IDLE_SLEEP_MS); return; }
 	/* TODO: Not calling Gfx_EndFrame doesn't work with Direct3D9 */
 	if (Window_Main.Inactive) return;
 	Gfx_ClearBuffers(GFX_BUFFER_COLOR | GFX_BUFFER_DEPTH);
@@ -822,9 +2456,27 @@ static CC_INLINE void Game_RenderFrame(void) {
 	Game_DrawFrame(delta, t);
 #endif
 
+#ifdef CC_BUILD_SCREENSHOTWORKER
+	if (shot_reading && Gfx_IsScreenshotReadDone()) ScreenshotWorker_EndRead();
+	if (shot_thread  && shot_finished) ScreenshotWorker_Finish();
+#endif
 	if (Game_ScreenshotRequested) Game_TakeScreenshot();
+	Game_BeginProfile(PROFILE_PRESENT);
 	Gfx_EndFrame();
-	if (gfx_minFrameMs) LimitFPS();
+	Game_EndProfile();
+
+	DynRes_FrameDrawn(render);
+	if (bench_framesLeft) Game_BenchmarkFrame(render);
+	if (replay_active)    Replay_EndFrame(render);
+	if (trace_firstFrame) {
+		trace_firstFrame = false;
+		StartupTrace_End("first frame");
+	}
+
+	if (gfx_minFrameMs) gfx_pendingSleep = true;
+	if (Game_Profiling) Game_ProfileFrame(delta);
+	Idle_FrameDrawn();
+	Logger_Trace(TRACE_EVENT_FRAME, (cc_uint32)Stopwatch_ElapsedMicroseconds(render, Stopwatch_Measure()), Game_Vertices);
 }
 
 
@@ -834,7 +2486,16 @@ static void Game_Free(void) {
 	/* Set to false so components will always free managed textures too */
 	Gfx.ManagedTextures = false;
 	Event_UnregisterAll();
-	tasksCount = 0;
+	tasksCount  = 0;
+	comps_count = 0;
+	Game_CloseProfileCsv();
+#ifdef CC_BUILD_SCREENSHOTWORKER
+	if (shot_reading) ScreenshotWorker_EndRead();
+	if (shot_thread)  ScreenshotWorker_Finish();
+#endif
+	/* Plugins may still have jobs in progress */
+	Jobs_Stop();
+	(void)Logger_CloseTraceFile();
 
 	for (comp = comps_head; comp; comp = comp->next)
 	{
@@ -894,6 +2555,8 @@ void Game_Run(int width, int height, const cc_string* title) {
 	Game.CurrentState = 0;
 
 	Game_Load();
+	Idle_Init();
+	DynRes_Init();
 	Event_RaiseVoid(&WindowEvents.Resized);
 
 	frameStart = Stopwatch_Measure();
@@ -21,6 +21,18 @@ CC_VAR extern struct _GameData {
 	/* Index of current game state being used (for splitscreen multiplayer) */
 	int CurrentState;
 	Game_Draw2DHook Draw2DHooks[4];
+	/* Time (in microseconds) spent sorting chunks within last second. Resets to 0 after every second. */
+	int ChunkSortTime;
+	/* Number of neighbouring chunk rebuilds skipped within last second, because lighting changes */
+	/*  along chunk boundaries did not affect any blocks in them. Resets to 0 after every second. */
+	int ChunkRefreshesSkipped;
+	/* Time (in microseconds) spent running scheduled tasks (e.g. entity ticks) within last second. Resets to 0 after every second. */
+	int TickTime;
+	/* Number of scheduled task invocations dropped within last second, because tasks */
+	/*  fell too far behind (e.g. after a hitch). Resets to 0 after every second. */
+	int TicksDropped;
+	/* Number of entities skipped in the last rendered frame, because they were offscreen or too far away */
+	int EntitiesCulled;
 } Game;
 
 extern struct RayTracer Game_SelectedPos;
@@ -93,6 +105,52 @@ void Game_CycleViewDistance(void);
 /* Attempts to reduce VRAM usage (e.g. reducing view distance) */
 /* Returns false if VRAM cannot be reduced any further */
 cc_bool Game_ReduceVRAM(void);
+/* Measures how long each of the next given number of frames takes to render, */
+/*  then prints the average/minimum/maximum frame times to chat */
+void Game_StartBenchmark(int frames);
+/* Loads a replay of camera positions and block changes, which are then replayed with a fixed */
+/*  delta once the map has loaded. Afterwards, frame time statistics are written as JSON and the game closes */
+cc_result Game_LoadReplay(const cc_string* path);
+/* Once the game has started, times how long generating, lighting, meshing and saving/loading a map */
+/*  with a fixed seed takes, along with PNG and JSON parsing. Afterwards, the times are written as JSON and the game closes */
+void Game_StartPerf(void);
+
+enum ProfileStage {
+	PROFILE_SKY, PROFILE_ENTITIES, PROFILE_PARTICLES, PROFILE_MAP_NORMAL,
+	PROFILE_MAP_TRANSLUCENT, PROFILE_WEATHER, PROFILE_GUI,
+	/* Stages below are only measured on the CPU */
+	PROFILE_MAP_BUILD, PROFILE_EVENTS, PROFILE_TASKS, PROFILE_PRESENT, PROFILE_SLEEP, PROFILE_PLUGINS,
+	PROFILE_COUNT
+};
+#define PROFILE_GPU_COUNT (PROFILE_GUI + 1)
+extern const char* const Profile_Names[PROFILE_COUNT];
+/* Whether the time spent in each stage of rendering a frame is being measured */
+extern cc_bool Game_Profiling;
+/* Whether the time taken by each step of starting the game is logged */
+extern cc_bool Game_StartupTrace;
+/* Average time in microseconds spent per frame in each stage over the last second */
+/* NOTE: GPU times are -1 when the graphics backend can't measure them */
+extern int Game_ProfileCpuTimes[PROFILE_COUNT], Game_ProfileGpuTimes[PROFILE_COUNT];
+/* Starts or stops measuring the time spent in each stage of rendering */
+/* If csvPath is non-NULL, the average times are also written to that file every second */
+void Game_SetProfiling(cc_bool enabled, const cc_string* csvPath);
+/* Starts measuring time spent in the given stage, pausing the current stage (if any) until Game_EndProfile */
+void Game_BeginProfile(int stage);
+/* Stops measuring time spent in the current stage, resuming the previous stage (if any) */
+void Game_EndProfile(void);
+
+#define PROFILE_HISTORY_SIZE 512
+#define PROFILE_MAX_TASKS 8
+struct ProfileSample {
+	int frameTime;                /* Total time in microseconds between the end of the previous frame and this one */
+	int times[PROFILE_COUNT];     /* CPU time in microseconds spent in each stage */
+	int tasks[PROFILE_MAX_TASKS]; /* CPU time in microseconds spent in each scheduled task */
+};
+/* Returns the times measured for the frame that was rendered the given number of frames ago */
+/* NOTE: Returns NULL if there is no such frame in the history of the last PROFILE_HISTORY_SIZE frames */
+const struct ProfileSample* Game_GetProfileSample(int framesAgo);
+/* Writes the times of every frame in the history to the given file as CSV, oldest first */
+cc_result Game_DumpProfileHistory(const cc_string* path, int* frames);
 
 void Game_SetViewDistance(int distance);
 void Game_UserSetViewDistance(int distance);
@@ -106,6 +164,26 @@ CC_API void Game_UpdateBlock(int x, int y, int z, BlockID block);
 /* Calls Game_UpdateBlock, then informs server connection of the block change. */
 /* In multiplayer this is sent to the server, in singleplayer just activates physics. */
 CC_API void Game_ChangeBlock(int x, int y, int z, BlockID block);
+/* Updates state associated with a block that was already changed in the map (e.g. lighting, chunk meshes) */
+/* NOTE: Unlike Game_UpdateBlock, this does not change the block or update physics state */
+void Game_NotifyBlockUpdated(int x, int y, int z, BlockID old, BlockID block);
+/* Defers updating state associated with blocks changed by Game_UpdateBlock until Game_EndBlockBatch, */
+/*  so that e.g. many block changes received from the server in one tick only update lighting once */
+/* NOTE: The blocks in the map are still changed immediately */
+void Game_BeginBlockBatch(void);
+/* Updates state associated with all blocks changed since Game_BeginBlockBatch */
+void Game_EndBlockBatch(void);
+/* Starts changing many blocks at once (e.g. /client cuboid), where rather than for every block, */
+/*  lighting and chunk meshes are only updated for the region of changed blocks in Game_EndBulkChange */
+void Game_BeginBulkChange(void);
+/* Same as Game_ChangeBlock, but defers updating associated state until Game_EndBulkChange */
+/* NOTE: Must only be called between Game_BeginBulkChange and Game_EndBulkChange */
+void Game_BulkChangeBlock(int x, int y, int z, BlockID block);
+/* Updates state associated with all blocks changed since Game_BeginBulkChange */
+void Game_EndBulkChange(void);
+/* Updates lighting, weather and chunk meshes for the given area of the map */
+/* NOTE: Must be called after blocks have been written directly into the map */
+void Game_RefreshBlocks(int minX, int minY, int minZ, int maxX, int maxY, int maxZ);
 
 cc_bool Game_CanPick(BlockID block);
 /* Updates Game_Width and Game_Height. */
@@ -157,11 +235,60 @@ struct ScheduledTask {
 	double interval;
 	/* Callback function that is periodically invoked */
 	void (*Callback)(struct ScheduledTask* task);
+	/* Max number of times callback can be invoked in one frame to catch up after a hitch */
+	int maxCatchup;
+	/* Max time (in seconds) that can be spent catching up in one frame */
+	double budget;
 };
 
 typedef void (*ScheduledTaskCallback)(struct ScheduledTask* task);
 /* Adds a task to list of scheduled tasks. (always at end) */
 CC_API int ScheduledTask_Add(double interval, ScheduledTaskCallback callback);
+/* Changes how much a task can catch up in one frame, before the rest of the elapsed time is dropped */
+/* NOTE: The callback is always invoked at least once when it is due */
+CC_API void ScheduledTask_SetLimits(int index, int maxCatchup, double budget);
+
+/* Represents work that is run on a background worker thread, then finished on the main thread */
+/* Rules for what Run can access, since the main thread never waits for or locks against workers: */
+/*  - Only data owned by the job. Copy anything needed from World, Entities, Blocks etc when queueing */
+/*     the job, as the main thread changes (and frees) that state at any time */
+/*  - Only Mem_, String_, Stream_, File_ and Mutex_/Waitable_ functions. Everything else */
+/*     (e.g. Gfx_, Gui_, Chat_, Event_ and World_ functions) must only be called from the main thread */
+/* Results should be applied to the game in Finish, which is always called on the main thread */
+struct GameJob;
+struct GameJob {
+	/* Called on a worker thread to do the work */
+	void (*Run)(struct GameJob* job);
+	/* Called on the main thread once Run has finished, or when the game closes before Run was called */
+	void (*Finish)(struct GameJob* job);
+	/* Whether Finish is being called without Run having been called */
+	cc_bool cancelled;
+	/* Next job in linked list of queued jobs. (internal, don't change while job is queued) */
+	struct GameJob* next;
+};
+/* Queues a job to be run on a worker thread */
+/* NOTE: The job must remain valid until its Finish function has been called */
+CC_API void Game_QueueJob(struct GameJob* job);
+
+#define PLUGIN_HOOKS_VERSION 1
+enum PluginRenderPass {
+	PLUGIN_PASS_OPAQUE,      /* After the opaque parts of the world and entities have been rendered */
+	PLUGIN_PASS_TRANSLUCENT, /* After the translucent parts of the world have been rendered */
+	PLUGIN_PASS_GUI          /* After the 2D GUI has been rendered */
+};
+/* Per-frame hooks that a plugin can optionally export as Plugin_Hooks, alongside Plugin_Component */
+/* NOTE: Hooks are called on the main thread, and time spent in them is attributed to the plugin */
+struct PluginHooks {
+	/* PLUGIN_HOOKS_VERSION that the plugin was compiled against */
+	/* NOTE: Newer versions only ever add fields to the end */
+	int version;
+	/* Called every frame before scheduled tasks (e.g. entity ticking) are run */
+	void (*PreTick)(float delta);
+	/* Called every frame after scheduled tasks have been run */
+	void (*PostTick)(float delta);
+	/* Called every frame for each render pass, with the render state set up for that pass */
+	void (*Render)(int pass, float delta);
+};
 
 CC_END_HEADER
 #endif
@@ -1,4 +1,9 @@
 #include "Generator.h"
+/* NOTE: Included before Funcs.h, since C++ standard headers may #undef its min/max */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define NOISE_SSE2
+	#include <emmintrin.h>
+#endif
 #include "BlockID.h"
 #include "ExtMath.h"
 #include "Funcs.h"
@@ -7,6 +12,7 @@
 #include "Utils.h"
 #include "Game.h"
 #include "Window.h"
+#define MEM_SUBSYSTEM MEM_SYS_WORLD
 
 const struct MapGenerator* Gen_Active;
 BlockRaw* Gen_Blocks;
@@ -231,6 +237,105 @@ static float CombinedNoise_Calc(const struct CombinedNoise* n, float x, float y)
 }
 
 
+/* Batch versions of the above, which calculate noise for multiple (x, y) samples at once */
+/* NOTE: These must produce exactly the same results as the scalar versions, */
+/*  otherwise maps generated from the same seed would differ between platforms */
+#define NOISE_MAX_BATCH 64
+
+#ifdef NOISE_SSE2
+/* Calculates noise for 4 samples at once, performing the same floating point operations in the same order */
+static __m128 ImprovedNoise_Calc4(const cc_uint8* p, __m128 x, __m128 y) {
+	int X[4], Y[4];
+	float gx[4][4], gy[4][4];
+	__m128i xFloor, yFloor;
+	__m128 u, v, x1, y1, g22, g12, g21, g11, c1, c2;
+	__m128 six = _mm_set1_ps(6), fifteen = _mm_set1_ps(15), ten = _mm_set1_ps(10), one = _mm_set1_ps(1);
+	int i, A, B, hash;
+
+	/* (int)x truncates towards 0, so subtract 1 for negative values (even for whole numbers, like scalar version) */
+	xFloor = _mm_add_epi32(_mm_cvttps_epi32(x), _mm_castps_si128(_mm_cmplt_ps(x, _mm_setzero_ps())));
+	yFloor = _mm_add_epi32(_mm_cvttps_epi32(y), _mm_castps_si128(_mm_cmplt_ps(y, _mm_setzero_ps())));
+	_mm_storeu_si128((__m128i*)X, _mm_and_si128(xFloor, _mm_set1_epi32(0xFF)));
+	_mm_storeu_si128((__m128i*)Y, _mm_and_si128(yFloor, _mm_set1_epi32(0xFF)));
+	x = _mm_sub_ps(x, _mm_cvtepi32_ps(xFloor));
+	y = _mm_sub_ps(y, _mm_cvtepi32_ps(yFloor));
+
+	u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x), _mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_mul_ps(x, six), fifteen)), ten));
+	v = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(y, y), y), _mm_add_ps(_mm_mul_ps(y, _mm_sub_ps(_mm_mul_ps(y, six), fifteen)), ten));
+
+	/* Permutation table lookups have no SSE2 equivalent, so are done per lane */
+	for (i = 0; i < 4; i++) 
+	{
+		A = p[X[i]] + Y[i]; B = p[X[i] + 1] + Y[i];
+
+		hash = (p[p[A]] & 0xF) << 1;
+		gx[0][i] = (float)(((xFlags >> hash) & 3) - 1); gy[0][i] = (float)(((yFlags >> hash) & 3) - 1);
+		hash = (p[p[B]] & 0xF) << 1;
+		gx[1][i] = (float)(((xFlags >> hash) & 3) - 1); gy[1][i] = (float)(((yFlags >> hash) & 3) - 1);
+		hash = (p[p[A + 1]] & 0xF) << 1;
+		gx[2][i] = (float)(((xFlags >> hash) & 3) - 1); gy[2][i] = (float)(((yFlags >> hash) & 3) - 1);
+		hash = (p[p[B + 1]] & 0xF) << 1;
+		gx[3][i] = (float)(((xFlags >> hash) & 3) - 1); gy[3][i] = (float)(((yFlags >> hash) & 3) - 1);
+	}
+	x1 = _mm_sub_ps(x, one);
+	y1 = _mm_sub_ps(y, one);
+
+	g22 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[0]), x),  _mm_mul_ps(_mm_loadu_ps(gy[0]), y));
+	g12 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[1]), x1), _mm_mul_ps(_mm_loadu_ps(gy[1]), y));
+	c1  = _mm_add_ps(g22, _mm_mul_ps(u, _mm_sub_ps(g12, g22)));
+
+	g21 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[2]), x),  _mm_mul_ps(_mm_loadu_ps(gy[2]), y1));
+	g11 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[3]), x1), _mm_mul_ps(_mm_loadu_ps(gy[3]), y1));
+	c2  = _mm_add_ps(g21, _mm_mul_ps(u, _mm_sub_ps(g11, g21)));
+
+	return _mm_add_ps(c1, _mm_mul_ps(v, _mm_sub_ps(c2, c1)));
+}
+#endif
+
+/* Calculates octave noise for count samples (at most NOISE_MAX_BATCH) */
+static void OctaveNoise_CalcBatch(const struct OctaveNoise* n, const float* xs, const float* ys, float* out, int count) {
+	float amplitude = 1, freq = 1;
+	int i, j = 0;
+
+#ifdef NOISE_SSE2
+	__m128 sums[NOISE_MAX_BATCH / 4];
+	__m128 f, a;
+	int blocks = count >> 2;
+
+	for (j = 0; j < blocks; j++) sums[j] = _mm_setzero_ps();
+
+	for (i = 0; i < n->octaves; i++) 
+	{
+		f = _mm_set1_ps(freq); a = _mm_set1_ps(amplitude);
+
+		for (j = 0; j < blocks; j++) {
+			sums[j] = _mm_add_ps(sums[j], _mm_mul_ps(ImprovedNoise_Calc4(n->p[i],
+						_mm_mul_ps(_mm_loadu_ps(xs + j * 4), f), _mm_mul_ps(_mm_loadu_ps(ys + j * 4), f)), a));
+		}
+		amplitude *= 2.0f;
+		freq *= 0.5f;
+	}
+
+	for (j = 0; j < blocks; j++) _mm_storeu_ps(out + j * 4, sums[j]);
+	j = blocks * 4;
+#endif
+	/* Calculate remaining samples one at a time */
+	for (; j < count; j++) {
+		out[j] = OctaveNoise_Calc(n, xs[j], ys[j]);
+	}
+}
+
+/* Calculates combined noise for count samples (at most NOISE_MAX_BATCH) */
+static void CombinedNoise_CalcBatch(const struct CombinedNoise* n, const float* xs, const float* ys, float* out, int count) {
+	float offsetXs[NOISE_MAX_BATCH];
+	int i;
+	OctaveNoise_CalcBatch(&n->noise2, xs, ys, out, count);
+
+	for (i = 0; i < count; i++) { offsetXs[i] = xs[i] + out[i]; }
+	OctaveNoise_CalcBatch(&n->noise1, offsetXs, ys, out, count);
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------Notchy map gen-------------------------------------------------------*
 *#########################################################################################################################*/
@@ -238,6 +343,64 @@ static int waterLevel, minHeight;
 static cc_int16* heightmap;
 static RNGState rnd;
 
+/* Stages that calculate each column of the map independently can be split up by rows */
+typedef void (*NotchyGen_RowFunc)(int z);
+#ifdef CC_BUILD_GENWORKERS
+/* Rows are processed in parallel by the map gen thread and these worker threads */
+#define GEN_MAX_WORKERS 3
+#define GEN_ROWS_PER_TASK 16
+static NotchyGen_RowFunc gen_rowFunc;
+static void* gen_rowMutex;
+static int gen_nextRow;
+
+static void NotchyGen_RowWorker(void) {
+	int z, end;
+
+	for (;;) 
+	{
+		Mutex_Lock(gen_rowMutex);
+		{
+			z = gen_nextRow;
+			gen_nextRow += GEN_ROWS_PER_TASK;
+		}
+		Mutex_Unlock(gen_rowMutex);
+
+		if (z >= World.Length) return;
+		Gen_CurrentProgress = (float)z / World.Length;
+		end = min(z + GEN_ROWS_PER_TASK, World.Length);
+		for (; z < end; z++) gen_rowFunc(z);
+	}
+}
+
+/* NOTE: Each row only depends on shared read-only state (e.g. noise tables already */
+/*  initialised from the RNG), so the generated map is identical to the single threaded version */
+static void NotchyGen_ForEachRow(NotchyGen_RowFunc func) {
+	void* threads[GEN_MAX_WORKERS];
+	int i;
+	gen_rowFunc  = func;
+	gen_nextRow  = 0;
+	gen_rowMutex = Mutex_Create("Map gen rows");
+
+	for (i = 0; i < GEN_MAX_WORKERS; i++) {
+		Thread_Run(&threads[i], NotchyGen_RowWorker, 64 * 1024, "Map gen worker");
+	}
+	NotchyGen_RowWorker();
+
+	for (i = 0; i < GEN_MAX_WORKERS; i++) {
+		Thread_Join(threads[i]);
+	}
+	Mutex_Free(gen_rowMutex);
+}
+#else
+static void NotchyGen_ForEachRow(NotchyGen_RowFunc func) {
+	int z;
+	for (z = 0; z < World.Length; z++) {
+		Gen_CurrentProgress = (float)z / World.Length;
+		func(z);
+	}
+}
+#endif
+
 static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, BlockRaw block) {
 	int xBeg = Math_Floor(max(x - radius, 0));
 	int xEnd = Math_Floor(min(x + radius, World.MaxX));
@@ -265,75 +428,115 @@ static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, Bloc
 }
 
 #define STACK_FAST 8192
+static int* fill_stack;
+static int fill_count, fill_limit;
+
+/* Pushes the start of each contiguous run of air blocks in the given X range of a row */
+static void NotchyGen_PushSpans(int rowIndex, int minX, int maxX) {
+	cc_bool inSpan = false;
+	int x;
+
+	for (x = minX; x <= maxX; x++) {
+		if (Gen_Blocks[rowIndex + x] != BLOCK_AIR) { inSpan = false; continue; }
+		if (inSpan) continue;
+
+		if (fill_count == fill_limit) {
+			Utils_Resize((void**)&fill_stack, &fill_limit, 4, STACK_FAST, STACK_FAST);
+		}
+		fill_stack[fill_count++] = rowIndex + x;
+		inSpan = true;
+	}
+}
+
+/* Fills air blocks reachable horizontally or downwards from the given block, using a scanline fill */
+/*  (each popped seed fills the entire X run of air it is in, then seeds spans in adjacent rows) */
 static void NotchyGen_FloodFill(int index, BlockRaw block) {
-	int* stack;
 	int stack_default[STACK_FAST]; /* avoid allocating memory if possible */
-	int count = 0, limit = STACK_FAST;
+	int rowIndex, minX, maxX;
 	int x, y, z;
 
-	stack = stack_default;
 	if (index < 0) return; /* y below map, don't bother starting */
-	stack[count++] = index;
-
-	while (count) {
-		index = stack[--count];
+	fill_stack = stack_default;
+	fill_limit = STACK_FAST;
+	fill_count = 0;
+	fill_stack[fill_count++] = index;
 
+	while (fill_count) {
+		index = fill_stack[--fill_count];
 		if (Gen_Blocks[index] != BLOCK_AIR) continue;
-		Gen_Blocks[index] = block;
 
 		x = index  % World.Width;
 		y = index  / World.OneY;
 		z = (index / World.Width) % World.Length;
+		rowIndex = index - x;
 
-		/* need to increase stack */
-		if (count >= limit - FACE_COUNT) {
-			Utils_Resize((void**)&stack, &limit, 4, STACK_FAST, STACK_FAST);
-		}
+		/* Find the extent of the air run containing this block, then fill it */
+		for (minX = x; minX > 0          && Gen_Blocks[rowIndex + minX - 1] == BLOCK_AIR; minX--) { }
+		for (maxX = x; maxX < World.MaxX && Gen_Blocks[rowIndex + maxX + 1] == BLOCK_AIR; maxX++) { }
+		Mem_Set(Gen_Blocks + rowIndex + minX, block, maxX - minX + 1);
 
-		if (x > 0)          { stack[count++] = index - 1; }
-		if (x < World.MaxX) { stack[count++] = index + 1; }
-		if (z > 0)          { stack[count++] = index - World.Width; }
-		if (z < World.MaxZ) { stack[count++] = index + World.Width; }
-		if (y > 0)          { stack[count++] = index - World.OneY; }
+		if (z > 0)          NotchyGen_PushSpans(rowIndex - World.Width, minX, maxX);
+		if (z < World.MaxZ) NotchyGen_PushSpans(rowIndex + World.Width, minX, maxX);
+		if (y > 0)          NotchyGen_PushSpans(rowIndex - World.OneY,  minX, maxX);
 	}
-	if (limit > STACK_FAST) Mem_Free(stack);
+	if (fill_limit > STACK_FAST) Mem_Free(fill_stack);
 }
 
 
-static void NotchyGen_CreateHeightmap(void) {
+static struct CombinedNoise heightmap_n1, heightmap_n2;
+static struct OctaveNoise heightmap_n3;
+
+static void NotchyGen_HeightmapRow(int z) {
+	float xs[NOISE_MAX_BATCH], ys[NOISE_MAX_BATCH];
+	float sxs[NOISE_MAX_BATCH], sys[NOISE_MAX_BATCH];
+	float low[NOISE_MAX_BATCH], high[NOISE_MAX_BATCH], sel[NOISE_MAX_BATCH];
 	float hLow, hHigh, height;
-	int hIndex = 0, adjHeight;
-	int x, z;
-	struct CombinedNoise n1, n2;
-	struct OctaveNoise n3;
+	int hIndex = z * World.Width;
+	int x, i, count;
 
-	CombinedNoise_Init(&n1, &rnd, 8, 8);
-	CombinedNoise_Init(&n2, &rnd, 8, 8);	
-	OctaveNoise_Init(&n3, &rnd, 6);
+	for (x = 0; x < World.Width; x += NOISE_MAX_BATCH) {
+		count = min(NOISE_MAX_BATCH, World.Width - x);
 
-	Gen_CurrentState = "Building heightmap";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+		for (i = 0; i < count; i++) {
+			xs[i]  = (x + i) * 1.3f; ys[i]  = z * 1.3f;
+			sxs[i] = (float)(x + i); sys[i] = (float)z;
+		}
+		/* NOTE: High noise is calculated for all columns, as batches are cheaper than branching */
+		CombinedNoise_CalcBatch(&heightmap_n1, xs,  ys,  low,  count);
+		OctaveNoise_CalcBatch(&heightmap_n3,   sxs, sys, sel,  count);
+		CombinedNoise_CalcBatch(&heightmap_n2, xs,  ys,  high, count);
 
-		for (x = 0; x < World.Width; x++) {
-			hLow   = CombinedNoise_Calc(&n1, x * 1.3f, z * 1.3f) / 6 - 4;
+		for (i = 0; i < count; i++) {
+			hLow   = low[i] / 6 - 4;
 			height = hLow;
 
-			if (OctaveNoise_Calc(&n3, (float)x, (float)z) <= 0) {
-				hHigh = CombinedNoise_Calc(&n2, x * 1.3f, z * 1.3f) / 5 + 6;
+			if (sel[i] <= 0) {
+				hHigh  = high[i] / 5 + 6;
 				height = max(hLow, hHigh);
 			}
 
 			height *= 0.5f;
 			if (height < 0) height *= 0.8f;
-
-			adjHeight = (int)(height + waterLevel);
-			minHeight = min(adjHeight, minHeight);
-			heightmap[hIndex++] = adjHeight;
+			heightmap[hIndex++] = (int)(height + waterLevel);
 		}
 	}
 }
 
+static void NotchyGen_CreateHeightmap(void) {
+	int i, count = World.Width * World.Length;
+
+	CombinedNoise_Init(&heightmap_n1, &rnd, 8, 8);
+	CombinedNoise_Init(&heightmap_n2, &rnd, 8, 8);	
+	OctaveNoise_Init(&heightmap_n3, &rnd, 6);
+
+	Gen_CurrentState = "Building heightmap";
+	NotchyGen_ForEachRow(NotchyGen_HeightmapRow);
+
+	for (i = 0; i < count; i++) {
+		minHeight = min(heightmap[i], minHeight);
+	}
+}
+
 static int NotchyGen_CreateStrataFast(void) {
 	cc_uint32 oneY = (cc_uint32)World.OneY;
 	int stoneHeight, airHeight;
@@ -363,43 +566,52 @@ static int NotchyGen_CreateStrataFast(void) {
 	return max(stoneHeight, 1);
 }
 
-static void NotchyGen_CreateStrata(void) {
-	int dirtThickness, dirtHeight;
-	int minStoneY, stoneHeight;
-	int hIndex = 0, maxY = World.MaxY, index = 0;
-	int x, y, z;
-	struct OctaveNoise n;
+static struct OctaveNoise strata_n;
+static int strata_minStoneY;
 
-	/* Try to bulk fill bottom of the map if possible */
-	minStoneY = NotchyGen_CreateStrataFast();
-	OctaveNoise_Init(&n, &rnd, 8);
+static void NotchyGen_StrataRow(int z) {
+	float xs[NOISE_MAX_BATCH], ys[NOISE_MAX_BATCH], thickness[NOISE_MAX_BATCH];
+	int dirtThickness, dirtHeight, stoneHeight;
+	int hIndex = z * World.Width, maxY = World.MaxY, index;
+	int x, y, i = NOISE_MAX_BATCH, count;
 
-	Gen_CurrentState = "Creating strata";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	for (x = 0; x < World.Width; x++, i++) {
+		if (i == NOISE_MAX_BATCH) {
+			count = min(NOISE_MAX_BATCH, World.Width - x);
+			for (i = 0; i < count; i++) { xs[i] = (float)(x + i); ys[i] = (float)z; }
 
-		for (x = 0; x < World.Width; x++) {
-			dirtThickness = (int)(OctaveNoise_Calc(&n, (float)x, (float)z) / 24 - 4);
-			dirtHeight    = heightmap[hIndex++];
-			stoneHeight   = dirtHeight + dirtThickness;
+			OctaveNoise_CalcBatch(&strata_n, xs, ys, thickness, count);
+			i = 0;
+		}
+		dirtThickness = (int)(thickness[i] / 24 - 4);
+		dirtHeight    = heightmap[hIndex++];
+		stoneHeight   = dirtHeight + dirtThickness;
 
-			stoneHeight = min(stoneHeight, maxY);
-			dirtHeight  = min(dirtHeight,  maxY);
+		stoneHeight = min(stoneHeight, maxY);
+		dirtHeight  = min(dirtHeight,  maxY);
 
-			index = World_Pack(x, minStoneY, z);
-			for (y = minStoneY; y <= stoneHeight; y++) {
-				Gen_Blocks[index] = BLOCK_STONE; index += World.OneY;
-			}
+		index = World_Pack(x, strata_minStoneY, z);
+		for (y = strata_minStoneY; y <= stoneHeight; y++) {
+			Gen_Blocks[index] = BLOCK_STONE; index += World.OneY;
+		}
 
-			stoneHeight = max(stoneHeight, 0);
-			index = World_Pack(x, (stoneHeight + 1), z);
-			for (y = stoneHeight + 1; y <= dirtHeight; y++) {
-				Gen_Blocks[index] = BLOCK_DIRT; index += World.OneY;
-			}
+		stoneHeight = max(stoneHeight, 0);
+		index = World_Pack(x, (stoneHeight + 1), z);
+		for (y = stoneHeight + 1; y <= dirtHeight; y++) {
+			Gen_Blocks[index] = BLOCK_DIRT; index += World.OneY;
 		}
 	}
 }
 
+static void NotchyGen_CreateStrata(void) {
+	/* Try to bulk fill bottom of the map if possible */
+	strata_minStoneY = NotchyGen_CreateStrataFast();
+	OctaveNoise_Init(&strata_n, &rnd, 8);
+
+	Gen_CurrentState = "Creating strata";
+	NotchyGen_ForEachRow(NotchyGen_StrataRow);
+}
+
 static void NotchyGen_CarveCaves(void) {
 	int cavesCount, caveLen;
 	float caveX, caveY, caveZ;
@@ -540,36 +752,37 @@ static void NotchyGen_FloodFillLava(void) {
 	}
 }
 
-static void NotchyGen_CreateSurfaceLayer(void) {	
-	int hIndex = 0, index;
-	BlockRaw above;
-	int x, y, z;
-	struct OctaveNoise n1, n2;
+static struct OctaveNoise surface_n1, surface_n2;
 
-	OctaveNoise_Init(&n1, &rnd, 8);
-	OctaveNoise_Init(&n2, &rnd, 8);
-
-	Gen_CurrentState = "Creating surface";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+static void NotchyGen_SurfaceRow(int z) {
+	int hIndex = z * World.Width, index;
+	BlockRaw above;
+	int x, y;
 
-		for (x = 0; x < World.Width; x++) {
-			y = heightmap[hIndex++];
-			if (y < 0 || y >= World.Height) continue;
+	for (x = 0; x < World.Width; x++) {
+		y = heightmap[hIndex++];
+		if (y < 0 || y >= World.Height) continue;
 
-			index = World_Pack(x, y, z);
-			above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
+		index = World_Pack(x, y, z);
+		above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
 
-			/* TODO: update heightmap */
-			if (above == BLOCK_STILL_WATER && (OctaveNoise_Calc(&n2, (float)x, (float)z) > 12)) {
-				Gen_Blocks[index] = BLOCK_GRAVEL;
-			} else if (above == BLOCK_AIR) {
-				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
-			}
+		/* TODO: update heightmap */
+		if (above == BLOCK_STILL_WATER && (OctaveNoise_Calc(&surface_n2, (float)x, (float)z) > 12)) {
+			Gen_Blocks[index] = BLOCK_GRAVEL;
+		} else if (above == BLOCK_AIR) {
+			Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&surface_n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
 		}
 	}
 }
 
+static void NotchyGen_CreateSurfaceLayer(void) {	
+	OctaveNoise_Init(&surface_n1, &rnd, 8);
+	OctaveNoise_Init(&surface_n2, &rnd, 8);
+
+	Gen_CurrentState = "Creating surface";
+	NotchyGen_ForEachRow(NotchyGen_SurfaceRow);
+}
+
 static void NotchyGen_PlantFlowers(void) {
 	int numPatches;
 	BlockRaw block;
@@ -28,11 +28,17 @@ struct MenuOptionsScreen;
 extern struct IGameComponent Gfx_Component;
 
 typedef enum VertexFormat_ {
-	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED
+	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED, VERTEX_FORMAT_CHUNK
 } VertexFormat;
 
 #define SIZEOF_VERTEX_COLOURED 16
 #define SIZEOF_VERTEX_TEXTURED 24
+#define SIZEOF_VERTEX_CHUNK    16
+
+/* Fixed point scales of the position and texture coordinates in a VertexChunk */
+#define VERTEX_CHUNK_POS_SCALE 1024
+#define VERTEX_CHUNK_U_SCALE   1024
+#define VERTEX_CHUNK_V_SCALE   16384
 
 #if defined CC_BUILD_PSP
 /* 3 floats for position (XYZ), 4 bytes for colour */
@@ -45,6 +51,9 @@ struct VertexColoured { float x, y, z; PackedCol Col; };
 /* 3 floats for position (XYZ), 2 floats for texture coordinates (UV), 4 bytes for colour */
 struct VertexTextured { float x, y, z; PackedCol Col; float U, V; };
 #endif
+/* 3 shorts for position relative to chunk origin (XYZ), 4 bytes for colour, 2 shorts for texture coordinates (UV) */
+/* NOTE: Only supported when Gfx.SupportsChunkVertices is true */
+struct VertexChunk { cc_int16 x, y, z, pad; PackedCol Col; cc_int16 U, V; };
 
 void Gfx_Create(void);
 void Gfx_Free(void);
@@ -73,7 +82,8 @@ CC_VAR extern struct _GfxData {
 	cc_bool NoUVSupport;
 	/* Type of the backend (e.g. OpenGL, Direct3D 9, etc)*/
 	cc_uint8 BackendType;
-	cc_bool __pad;
+	/* Whether the graphics backend supports VERTEX_FORMAT_CHUNK and Gfx_SetChunkOffset */
+	cc_bool SupportsChunkVertices;
 	/* Maximum total size in pixels a low resolution texture can consist of */
 	/* NOTE: Not all graphics backends specify a value for this */
 	int MaxLowResTexSize;
@@ -84,6 +94,22 @@ CC_VAR extern struct _GfxData {
 	cc_uint8 ReducedPerfModeCooldown;
 	/* Default index buffer for a triangle list representing quads */
 	GfxResourceID DefaultIb;
+	/* Whether the graphics backend supports Gfx_DrawIndexedTris_T2fC4b_Multi */
+	cc_bool SupportsMultiDraw;
+	/* Whether the graphics backend supports creating textures with TEXTURE_FLAG_COMPRESSED */
+	cc_bool SupportsCompressedTextures;
+	/* Whether textures created with TEXTURE_FLAG_COMPRESSED should actually be compressed */
+	cc_bool CompressTextures;
+	/* Whether Gfx_CreateVbFrom can be called from threads other than the main thread */
+	cc_bool SupportsThreadedVbCreation;
+	/* Maximum number of earlier frames the GPU may still be rendering when the CPU starts a new frame */
+	/* NOTE: 0 leaves this up to the graphics driver, and not all graphics backends support limiting this */
+	int MaxFramesInFlight;
+	/* Number of draw calls made by 2D rendering functions since this was last reset */
+	/* NOTE: Reset at the start of rendering the GUI each frame */
+	int Draw2DCalls;
+	/* Whether Gfx_BeginScaledScene/Gfx_EndScaledScene can render the 3D scene at a lower resolution */
+	cc_bool SupportsScaledScene;
 } Gfx;
 
 extern const cc_string Gfx_LowPerfMessage;
@@ -91,6 +117,8 @@ extern const cc_string Gfx_LowPerfMessage;
 #define ICOUNT(verticesCount) (((verticesCount) >> 2) * 6)
 #define GFX_MAX_INDICES (65536 / 4 * 6)
 #define GFX_MAX_VERTICES 65536
+/* Maximum number of ranges that can be drawn with one call to Gfx_DrawIndexedTris_T2fC4b_Multi */
+#define GFX_MAX_DRAW_RANGES 16
 
 void  Gfx_RecreateTexture(GfxResourceID* tex, struct Bitmap* bmp, cc_uint8 flags, cc_bool mipmaps);
 void* Gfx_RecreateAndLockVb(GfxResourceID* vb, VertexFormat fmt, int count);
@@ -113,6 +141,9 @@ SUMMARY:
 #define TEXTURE_FLAG_LOWRES      0x08
 /* Texture should be rendered using bilinear filtering if possible */
 #define TEXTURE_FLAG_BILINEAR    0x10
+/* Texture can be stored in a lossy compressed format to reduce video memory usage */
+/* NOTE: Only compressed when Gfx.CompressTextures is true, and never for dynamic or mipmapped textures */
+#define TEXTURE_FLAG_COMPRESSED  0x20
 
 cc_bool Gfx_CheckTextureSize(int width, int height, cc_uint8 flags);
 /* Creates a new texture. (and also generates mipmaps if mipmaps) */
@@ -295,6 +326,10 @@ CC_API void Gfx_DeleteVb(GfxResourceID* vb);
 CC_API void* Gfx_LockVb(GfxResourceID vb, VertexFormat fmt, int count);
 /* Submits the changed contents of a vertex buffer */
 CC_API void  Gfx_UnlockVb(GfxResourceID vb);
+/* Creates a new vertex buffer that is initially filled with the given vertices */
+/* NOTE: Returns 0 instead of attempting to free VRAM if the vertex buffer can't be created */
+/* NOTE: Can only be called from other threads when Gfx.SupportsThreadedVbCreation is true */
+CC_API GfxResourceID Gfx_CreateVbFrom(const void* vertices, VertexFormat fmt, int count);
 
 /* TODO: How to make LockDynamicVb work with OpenGL 1.1 Builder stupidity. */
 #ifdef CC_BUILD_GL11
@@ -321,6 +356,14 @@ CC_API void  Gfx_UnlockDynamicVb(GfxResourceID vb);
 
 /* Updates the data of a dynamic vertex buffer */
 CC_API void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount);
+#ifdef CC_BUILD_CHUNKARENA
+/* Updates the data of part of a dynamic vertex buffer, starting at the given vertex */
+void Gfx_SetDynamicVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount);
+#endif
+/* Updates the data of a dynamic vertex buffer, then draws the vertices as triangles */
+/* NOTE: Some backends instead append the vertices into a larger shared buffer, to avoid stalling */
+/*  when the same dynamic vertex buffer is updated many times in one frame */
+void Gfx_DrawDynamicVb_IndexedTris(GfxResourceID vb, void* vertices, int vCount);
 
 
 /*########################################################################################################################*
@@ -347,6 +390,11 @@ CC_API void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex);
 CC_API void Gfx_DrawVb_IndexedTris(int verticesCount);
 /* Special case Gfx_DrawVb_IndexedTris_Range for map renderer */
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex);
+#if CC_GFX_BACKEND_IS_GL()
+/* Special case Gfx_DrawIndexedTris_T2fC4b for drawing several ranges of vertices with one draw call */
+/* NOTE: Only supported when Gfx.SupportsMultiDraw is true */
+void Gfx_DrawIndexedTris_T2fC4b_Multi(const int* counts, const int* startVertices, int rangesCount);
+#endif
 
 
 /*########################################################################################################################*
@@ -385,6 +433,12 @@ CC_API void Gfx_LoadMatrix(MatrixType type, const struct Matrix* matrix);
 CC_API void Gfx_EnableTextureOffset(float x, float y);
 /* Disables texture U/V translation */
 CC_API void Gfx_DisableTextureOffset(void);
+#if CC_GFX_BACKEND == CC_GFX_BACKEND_GL1 || CC_GFX_BACKEND == CC_GFX_BACKEND_GL2
+/* Sets the world position that VERTEX_FORMAT_CHUNK vertex positions are relative to */
+void Gfx_SetChunkOffset(float x, float y, float z);
+#else
+#define Gfx_SetChunkOffset(x, y, z)
+#endif
 /* Loads given modelview and projection matrices, then calculates the combined MVP matrix */
 void Gfx_LoadMVP(const struct Matrix* view, const struct Matrix* proj, struct Matrix* mvp);
 
@@ -403,6 +457,12 @@ CC_API void Gfx_SetViewport(int x, int y, int w, int h);
 /*  By default this region has origin 0,0 and size is window width/height */
 /*  This region should normally be the same as the viewport region */
 CC_API void Gfx_SetScissor (int x, int y, int w, int h);
+/* Starts rendering the following 3D scene into a smaller width x height region of the framebuffer */
+/* NOTE: Only does anything when Gfx.SupportsScaledScene is true */
+void Gfx_BeginScaledScene(int width, int height);
+/* Stretches the region rendered to since Gfx_BeginScaledScene to cover the entire framebuffer */
+/*  and then restores the default viewport and scissor regions */
+void Gfx_EndScaledScene(int width, int height);
 
 
 /*########################################################################################################################*
@@ -410,6 +470,20 @@ CC_API void Gfx_SetScissor (int x, int y, int w, int h);
 *#########################################################################################################################*/
 /* Outputs a .png screenshot of the backbuffer */
 cc_result Gfx_TakeScreenshot(struct Stream* output);
+#if CC_GFX_BACKEND_IS_GL()
+/* Copies the backbuffer into a newly allocated bitmap, which can then be encoded later */
+/* NOTE: Rows are stored in bottom to top order. You are responsible for freeing its memory! */
+cc_result Gfx_ReadScreenshot(struct Bitmap* bmp);
+/* Starts asynchronously copying the backbuffer, so the CPU doesn't have to wait for the GPU */
+/* Returns false if unsupported, in which case Gfx_ReadScreenshot must be used instead */
+cc_bool Gfx_BeginReadScreenshot(void);
+/* Returns whether the GPU has finished the copy started by Gfx_BeginReadScreenshot */
+/* NOTE: Should be called at most once per frame */
+cc_bool Gfx_IsScreenshotReadDone(void);
+/* Copies the result of Gfx_BeginReadScreenshot into a newly allocated bitmap */
+/* NOTE: Same as Gfx_ReadScreenshot, rows are stored in bottom to top order */
+cc_result Gfx_EndReadScreenshot(struct Bitmap* bmp);
+#endif
 /* Warns in chat if the graphics backend has problems with the user's GPU */
 /* Returns whether legacy rendering mode for borders/sky/clouds is needed */
 cc_bool Gfx_WarnIfNecessary(void);
@@ -419,6 +493,16 @@ cc_bool Gfx_GetUIOptions(struct MenuOptionsScreen* s);
 /* NOTE: Each line is separated by \n */
 void Gfx_GetApiInfo(cc_string* info);
 
+#define GFX_MAX_GPU_TIMERS 8
+/* Starts measuring how long the GPU takes to execute the following commands, adding the time to the given timer */
+/* NOTE: Only one GPU timer can be measuring at a time */
+void Gfx_BeginGpuTimer(int timer);
+/* Stops measuring the GPU timer started by Gfx_BeginGpuTimer */
+void Gfx_EndGpuTimer(void);
+/* Returns how long in microseconds the GPU spent on the given timer during a recent frame */
+/* NOTE: Results are read back a few frames later to avoid stalling, and are -1 if unsupported */
+int  Gfx_GetGpuTime(int timer);
+
 /* Updates state when the window's dimensions have changed */
 /* NOTE: This may require recreating the context depending on the backend */
 void Gfx_OnWindowResize(void);
@@ -450,6 +534,9 @@ void Gfx_Draw2DFlat(int x, int y, int width, int height, PackedCol color);
 void Gfx_Draw2DGradient(int x, int y, int width, int height, PackedCol top, PackedCol bottom);
 /* Renders a 2D coloured texture */
 void Gfx_Draw2DTexture(const struct Texture* tex, PackedCol color);
+/* Binds the given texture, then renders vertices from the currently bound vertex buffer */
+/* NOTE: Counted in Gfx.Draw2DCalls, so should be used instead of Gfx_DrawVb_IndexedTris_Range for 2D */
+void Gfx_Draw2DRange(GfxResourceID texId, int verticesCount, int startVertex);
 /* Fills out the vertices for rendering a 2D coloured texture */
 void Gfx_Make2DQuad(const struct Texture* tex, PackedCol color, struct VertexTextured** vertices);
 
@@ -7,6 +7,7 @@
 #include <3ds.h>
 #define BUFFER_BASE_PADDR OS_VRAM_PADDR // VRAM physical address
 #include "../third_party/citro3d.c"
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 // autogenerated from the .v.pica files by Makefile
 extern const u8  coloured_shbin[];
@@ -1020,6 +1021,7 @@ void Gfx_Draw2DFlat(int x, int y, int width, int height, PackedCol color) {
 		C3D_ImmSendAttrib(v1.x, v1.y, 0.0f, 1.0f);
 		C3D_ImmSendAttrib(PackedCol_R(color), PackedCol_G(color), PackedCol_B(color), PackedCol_A(color));
 	C3D_ImmDrawEnd();
+	Gfx.Draw2DCalls++;
 }
 
 void Gfx_Draw2DGradient(int x, int y, int width, int height, PackedCol top, PackedCol bottom) {
@@ -1043,6 +1045,7 @@ void Gfx_Draw2DGradient(int x, int y, int width, int height, PackedCol top, Pack
 		C3D_ImmSendAttrib(v1.x, v1.y, 0.0f, 1.0f);
 		C3D_ImmSendAttrib(PackedCol_R(top), PackedCol_G(top), PackedCol_B(top), PackedCol_A(top));
 	C3D_ImmDrawEnd();
+	Gfx.Draw2DCalls++;
 }
 
 void Gfx_Draw2DTexture(const struct Texture* tex, PackedCol color) {
@@ -1070,5 +1073,6 @@ void Gfx_Draw2DTexture(const struct Texture* tex, PackedCol color) {
 		C3D_ImmSendAttrib(PackedCol_R(color), PackedCol_G(color), PackedCol_B(color), PackedCol_A(color));
 		C3D_ImmSendAttrib(v[0].U, v[0].V, 0.0f, 0.0f);
 	C3D_ImmDrawEnd();
+	Gfx.Draw2DCalls++;
 }
 #endif
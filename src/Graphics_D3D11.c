@@ -12,8 +12,10 @@
 #define NOIME
 #define COBJMACROS
 #include <d3d11.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 static const GUID guid_ID3D11Texture2D = { 0x6f15aaf2, 0xd208, 0x4e89, { 0x9a, 0xb4, 0x48, 0x95, 0x35, 0xd3, 0x4f, 0x9c } };
 static const GUID guid_IXDGIDevice     = { 0x54ec77fa, 0x1377, 0x44e6, { 0x8c, 0x32, 0x88, 0xfd, 0x5f, 0x44, 0xc8, 0x4c } };
+static const GUID guid_IXDGIDevice1    = { 0x77db970f, 0x6276, 0x48ba, { 0xba, 0x28, 0x07, 0x01, 0x43, 0xb4, 0x39, 0x2c } };
 
 // some generally useful debugging links
 //   https://docs.microsoft.com/en-us/visualstudio/debugger/graphics/visual-studio-graphics-diagnostics
@@ -45,6 +47,7 @@ static void VS_UpdateShader(void);
 static void PS_UpdateShader(void);
 static void InitPipeline(void);
 static void FreePipeline(void);
+static void FreeGpuTimers(void);
 
 static PFN_D3D11_CREATE_DEVICE_AND_SWAP_CHAIN _D3D11CreateDeviceAndSwapChain;
 
@@ -103,9 +106,14 @@ static void CreateDeviceAndSwapChain(void) {
 void Gfx_Create(void) {
 	LoadD3D11Library();
 	CreateDeviceAndSwapChain();
+	frameLatency = -1;
 	Gfx.Created         = true;
 	Gfx.BackendType     = CC_GFX_BACKEND_D3D11;
 	customMipmapsLevels = true;
+	// BC1 and BC3 are supported by every feature level
+	Gfx.SupportsCompressedTextures = true;
+	// ID3D11Device is free threaded, unlike the immediate ID3D11DeviceContext
+	Gfx.SupportsThreadedVbCreation = true;
 	Gfx_RestoreState();
 }
 
@@ -145,6 +153,7 @@ static void Gfx_FreeState(void) {
 	FreeDefaultResources();
 	FreePipeline();
 	Gfx_DeleteTexture(&white_square);
+	FreeGpuTimers();
 }
 
 static void Gfx_RestoreState(void) {
@@ -205,6 +214,7 @@ static void D3D11_DoMipmaps(ID3D11Resource* texture, int x, int y, struct Bitmap
 static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags, cc_bool mipmaps) {
 	ID3D11Texture2D* tex = NULL;
 	ID3D11ShaderResourceView* view = NULL;
+	cc_uint8* compressed = NULL;
 	HRESULT hr;
 
 	D3D11_TEXTURE2D_DESC desc = { 0 };
@@ -223,6 +233,17 @@ static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8
 	data.SysMemSlicePitch = 0;
 	D3D11_SUBRESOURCE_DATA* src = &data;
 
+	if (flags & TEXTURE_FLAG_COMPRESSED) {
+		cc_uint32 size;
+		cc_bool alpha;
+		compressed  = CompressTexture(bmp, rowWidth, &alpha, &size);
+		desc.Format = alpha ? DXGI_FORMAT_BC3_UNORM : DXGI_FORMAT_BC1_UNORM;
+
+		// pitch is the size of one row of 4x4 pixel blocks
+		data.pSysMem     = compressed;
+		data.SysMemPitch = size / (bmp->height / 4);
+	}
+
 	// Direct3D11 specifies pInitialData as an array of D3D11_SUBRESOURCE_DATA of length desc->MipsLevels
 	// Rather than writing such code just to support the mipmaps case, I went with the simpler approach of
 	//  leaving pInitialData as NULL and specfiying the texture data later using Gfx_UpdateTexturePart
@@ -236,13 +257,15 @@ static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8
 		if (hr == E_OUTOFMEMORY) {
 			// insufficient VRAM or RAM left to allocate texture, try to reduce the memory in use first
 			//  if can't reduce, return 'empty' texture so that at least the game will continue running
-			if (!Game_ReduceVRAM()) return 0;
+			if (!Game_ReduceVRAM()) { Mem_Free(compressed); return 0; }
 		} else {
 			// unknown issue, so don't even try to handle the error
 			Logger_Abort2(hr, "Failed to create texture");
 		}
 	}
 
+	Mem_Free(compressed);
+
 	hr = ID3D11Device_CreateShaderResourceView(device, tex, NULL, &view);
 	if (hr) Logger_Abort2(hr, "Failed to create view");
 
@@ -341,6 +364,24 @@ static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
 	return CreateVertexBuffer(fmt, count, false);
 }
 
+GfxResourceID Gfx_CreateVbFrom(const void* vertices, VertexFormat fmt, int count) {
+	ID3D11Buffer* buffer = NULL;
+
+	D3D11_BUFFER_DESC desc = { 0 };
+	desc.Usage     = D3D11_USAGE_IMMUTABLE;
+	desc.ByteWidth = count * strideSizes[fmt];
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem          = vertices;
+	data.SysMemPitch      = 0;
+	data.SysMemSlicePitch = 0;
+
+	// Only uses the device and not the immediate context, so can be called from mesh worker threads
+	HRESULT hr = ID3D11Device_CreateBuffer(device, &desc, &data, &buffer);
+	return hr ? NULL : buffer;
+}
+
 void Gfx_DeleteVb(GfxResourceID* vb) { 
 	ID3D11Buffer* buffer = (ID3D11Buffer*)(*vb);
 	if (buffer) ID3D11Buffer_Release(buffer);
@@ -1072,6 +1113,118 @@ void Gfx_DepthOnlyRendering(cc_bool depthOnly) {
 }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------GPU timers-------------------------------------------------------*
+*#########################################################################################################################*/
+// https://learn.microsoft.com/en-us/windows/win32/api/d3d11/ne-d3d11-d3d11_query
+//  Timestamps are only meaningful when the surrounding TIMESTAMP_DISJOINT query reports they didn't become unreliable
+// Queries are only read back a few frames after being issued, so that reading them doesn't stall
+#define GPU_TIMER_FRAMES  3
+#define GPU_TIMER_QUERIES 32
+
+static struct GpuTimerFrame {
+	ID3D11Query* disjoint;
+	ID3D11Query* beg[GPU_TIMER_QUERIES];
+	ID3D11Query* end[GPU_TIMER_QUERIES];
+	cc_uint8 timers[GPU_TIMER_QUERIES];
+	int count;
+	cc_bool issued;
+} gpu_frames[GPU_TIMER_FRAMES];
+static int gpu_frame, gpu_times[GFX_MAX_GPU_TIMERS];
+static cc_bool gpu_measuring;
+
+static ID3D11Query* GpuTimer_Make(ID3D11Query** query, D3D11_QUERY type) {
+	D3D11_QUERY_DESC desc = { type, 0 };
+	if (!(*query)) ID3D11Device_CreateQuery(device, &desc, query);
+	return *query;
+}
+
+void Gfx_BeginGpuTimer(int timer) {
+	struct GpuTimerFrame* f = &gpu_frames[gpu_frame];
+	if (gpu_measuring || f->count == GPU_TIMER_QUERIES) return;
+
+	if (!f->issued) {
+		if (!GpuTimer_Make(&f->disjoint, D3D11_QUERY_TIMESTAMP_DISJOINT)) return;
+		ID3D11DeviceContext_Begin(context, (ID3D11Asynchronous*)f->disjoint);
+		f->issued = true;
+	}
+
+	if (!GpuTimer_Make(&f->beg[f->count], D3D11_QUERY_TIMESTAMP)) return;
+	if (!GpuTimer_Make(&f->end[f->count], D3D11_QUERY_TIMESTAMP)) return;
+	f->timers[f->count] = (cc_uint8)timer;
+
+	// Timestamp queries only use End
+	ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)f->beg[f->count]);
+	gpu_measuring = true;
+}
+
+void Gfx_EndGpuTimer(void) {
+	struct GpuTimerFrame* f = &gpu_frames[gpu_frame];
+	if (!gpu_measuring) return;
+
+	ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)f->end[f->count]);
+	f->count++;
+	gpu_measuring = false;
+}
+
+int Gfx_GetGpuTime(int timer) { return gpu_times[timer]; }
+
+static cc_bool GpuTimer_Read(ID3D11Query* query, void* data, int size) {
+	return ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)query, data, size, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+}
+
+// Reads back the results of the queries issued GPU_TIMER_FRAMES - 1 frames ago
+static void GpuTimer_Collect(void) {
+	int times[GFX_MAX_GPU_TIMERS] = { 0 };
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	UINT64 beg, end;
+
+	struct GpuTimerFrame* f = &gpu_frames[gpu_frame];
+	Gfx_EndGpuTimer();
+	if (f->issued) ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)f->disjoint);
+
+	gpu_frame = (gpu_frame + 1) % GPU_TIMER_FRAMES;
+	f = &gpu_frames[gpu_frame];
+	if (!f->issued) return;
+	f->issued = false;
+
+	// GPU is running far behind, or timestamps are unreliable, so just skip this frame's results
+	if (!GpuTimer_Read(f->disjoint, &disjoint, sizeof(disjoint)) || disjoint.Disjoint) { f->count = 0; return; }
+
+	for (int i = 0; i < f->count; i++)
+	{
+		if (!GpuTimer_Read(f->beg[i], &beg, sizeof(beg))) { f->count = 0; return; }
+		if (!GpuTimer_Read(f->end[i], &end, sizeof(end))) { f->count = 0; return; }
+		times[f->timers[i]] += (int)((end - beg) * 1000000 / disjoint.Frequency);
+	}
+
+	Mem_Copy(gpu_times, times, sizeof(gpu_times));
+	f->count = 0;
+}
+
+static void GpuTimer_Release(ID3D11Query** query) {
+	if (*query) ID3D11Query_Release(*query);
+	*query = NULL;
+}
+
+static void FreeGpuTimers(void) {
+	for (int i = 0; i < GPU_TIMER_FRAMES; i++)
+	{
+		struct GpuTimerFrame* f = &gpu_frames[i];
+		GpuTimer_Release(&f->disjoint);
+
+		for (int j = 0; j < GPU_TIMER_QUERIES; j++)
+		{
+			GpuTimer_Release(&f->beg[j]);
+			GpuTimer_Release(&f->end[j]);
+		}
+		f->count  = 0;
+		f->issued = false;
+	}
+	gpu_measuring = false;
+}
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------------Misc----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -1129,7 +1282,25 @@ void Gfx_ClearBuffers(GfxBuffers buffers) {
 	OM_Clear(buffers); 
 }
 
+static int frameLatency = -1;
+// https://learn.microsoft.com/en-us/windows/win32/api/dxgi/nf-dxgi-idxgidevice1-setmaximumframelatency
+//  Present blocks when more than this many frames are queued, so the CPU can't get too far ahead of the GPU
+static void UpdateFrameLatency(void) {
+	IDXGIDevice1* dxgi = NULL;
+	HRESULT hr;
+	if (frameLatency == Gfx.MaxFramesInFlight) return;
+	frameLatency = Gfx.MaxFramesInFlight;
+
+	hr = ID3D11Device_QueryInterface(device, &guid_IXDGIDevice1, &dxgi);
+	if (hr) return;
+	// 0 resets to the driver default (usually 3)
+	IDXGIDevice1_SetMaximumFrameLatency(dxgi, frameLatency);
+	IDXGIDevice1_Release(dxgi);
+}
+
 void Gfx_EndFrame(void) {
+	GpuTimer_Collect();
+	UpdateFrameLatency();
 	// https://docs.microsoft.com/en-us/windows/win32/api/dxgi/nf-dxgi-idxgiswapchain-present
 	// gfx_vsync happens to match SyncInterval parameter
 	HRESULT hr = IDXGISwapChain_Present(swapchain, gfx_vsync, 0);
@@ -13,6 +13,7 @@
 #include <d3d9.h>
 #include <d3d9caps.h>
 #include <d3d9types.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 /* https://docs.microsoft.com/en-us/windows/win32/dxtecharts/resource-management-best-practices */
 /* https://docs.microsoft.com/en-us/windows/win32/dxtecharts/the-direct3d-transformation-pipeline */
@@ -28,6 +29,9 @@ static int cachedWidth, cachedHeight;
 static int depthBits;
 static float totalMem;
 static cc_bool fallbackRendering;
+/* Chunks are drawn from a few shared vertex buffers, so skip rebinding the same buffer */
+static IDirect3DVertexBuffer9* boundVb;
+static int boundStride;
 
 static void D3D9_RestoreRenderStates(void);
 static void D3D9_FreeResource(GfxResourceID resource) {
@@ -220,6 +224,7 @@ void Gfx_Free(void) {
 
 static void Gfx_FreeState(void) { 
 	FreeDefaultResources();
+	boundVb      = NULL;
 	cachedWidth  = 0;
 	cachedHeight = 0;
 }
@@ -610,16 +615,25 @@ static void* D3D9_LockVb(GfxResourceID vb, VertexFormat fmt, int count, int lock
 	return dst;
 }
 
+static void D3D9_DeleteVb(GfxResourceID* vb) {
+	if (*vb == boundVb) boundVb = NULL;
+	D3D9_FreeResource(*vb); *vb = NULL;
+}
+
 static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
 	return D3D9_AllocVertexBuffer(fmt, count, D3DUSAGE_WRITEONLY);
 }
 
-void Gfx_DeleteVb(GfxResourceID* vb) { D3D9_FreeResource(*vb); *vb = NULL; }
+void Gfx_DeleteVb(GfxResourceID* vb) { D3D9_DeleteVb(vb); }
 
 void Gfx_BindVb(GfxResourceID vb) {
 	IDirect3DVertexBuffer9* vbuffer = (IDirect3DVertexBuffer9*)vb;
-	cc_result res = IDirect3DDevice9_SetStreamSource(device, 0, vbuffer, 0, gfx_stride);
+	cc_result res;
+	if (vbuffer == boundVb && gfx_stride == boundStride) return;
+
+	res = IDirect3DDevice9_SetStreamSource(device, 0, vbuffer, 0, gfx_stride);
 	if (res) Logger_Abort2(res, "D3D9_BindVb");
+	boundVb = vbuffer; boundStride = gfx_stride;
 }
 
 void* Gfx_LockVb(GfxResourceID vb, VertexFormat fmt, int count) {
@@ -640,13 +654,9 @@ static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
 	return D3D9_AllocVertexBuffer(fmt, maxVertices, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY);
 }
 
-void Gfx_DeleteDynamicVb(GfxResourceID* vb) { D3D9_FreeResource(*vb); *vb = NULL; }
+void Gfx_DeleteDynamicVb(GfxResourceID* vb) { D3D9_DeleteVb(vb); }
 
-void Gfx_BindDynamicVb(GfxResourceID vb) {
-	IDirect3DVertexBuffer9* vbuffer = (IDirect3DVertexBuffer9*)vb;
-	cc_result res = IDirect3DDevice9_SetStreamSource(device, 0, vbuffer, 0, gfx_stride);
-	if (res) Logger_Abort2(res, "D3D9_BindDynamicVb");
-}
+void Gfx_BindDynamicVb(GfxResourceID vb) { Gfx_BindVb(vb); }
 
 void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
 	return D3D9_LockVb(vb, fmt, count, D3DLOCK_DISCARD);
@@ -661,9 +671,21 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	int size = vCount * gfx_stride;
 	IDirect3DVertexBuffer9* buffer = (IDirect3DVertexBuffer9*)vb;
 	D3D9_SetVbData(buffer, vertices, size, D3DLOCK_DISCARD);
+	Gfx_BindVb(vb);
+}
 
-	cc_result res = IDirect3DDevice9_SetStreamSource(device, 0, buffer, 0, gfx_stride);
-	if (res) Logger_Abort2(res, "D3D9_SetDynamicVbData - Bind");
+void Gfx_SetDynamicVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount) {
+	IDirect3DVertexBuffer9* buffer = (IDirect3DVertexBuffer9*)vb;
+	int offset = startVertex * strideSizes[fmt];
+	int size   = vCount      * strideSizes[fmt];
+	void* dst  = NULL;
+	/* NOTE: D3DLOCK_NOOVERWRITE can't be used, since the GPU may still be drawing from a range that was just reused */
+	cc_result res = IDirect3DVertexBuffer9_Lock(buffer, offset, size, &dst, 0);
+	if (res) Logger_Abort2(res, "D3D9_LockVbRange");
+
+	Mem_Copy(dst, vertices, size);
+	res = IDirect3DVertexBuffer9_Unlock(buffer);
+	if (res) Logger_Abort2(res, "D3D9_UnlockVbRange");
 }
 
 
@@ -9,6 +9,7 @@
 #include <dc/matrix.h>
 #include <dc/pvr.h>
 #include "../third_party/gldc/src/gldc.h"
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 static cc_bool renderingDisabled;
 #define VERTEX_BUFFER_SIZE 32 * 40000
@@ -182,8 +183,12 @@ void Gfx_DeleteIb(GfxResourceID* ib) { }
 /*########################################################################################################################*
 *------------------------------------------------------Vertex buffers-----------------------------------------------------*
 *#########################################################################################################################*/
+// Vertex data is aligned to SH4 cache lines (32 bytes), so that the
+//  prefetches in VertexTransform.S always start at the beginning of a line
+#define VB_ALIGNMENT 32
+
 static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
-	return memalign(16, count * strideSizes[fmt]);
+	return memalign(VB_ALIGNMENT, count * strideSizes[fmt]);
 }
 
 void Gfx_BindVb(GfxResourceID vb) { gfx_vertices = vb; }
@@ -206,7 +211,7 @@ void Gfx_UnlockVb(GfxResourceID vb) {
 
 
 static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
-	return memalign(16, maxVertices * strideSizes[fmt]);
+	return memalign(VB_ALIGNMENT, maxVertices * strideSizes[fmt]);
 }
 
 void Gfx_BindDynamicVb(GfxResourceID vb) { Gfx_BindVb(vb); }
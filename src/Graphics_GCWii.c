@@ -7,6 +7,7 @@
 #include <malloc.h>
 #include <string.h>
 #include <gccore.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 static void* fifo_buffer;
 #define FIFO_SIZE (256 * 1024)
@@ -346,12 +347,14 @@ void Gfx_DeleteIb(GfxResourceID* ib) { }
 *#########################################################################################################################*/
 static cc_uint8* gfx_vertices;
 static int vb_size;
+// Whether gfx_vertices is a static vertex buffer (see Draw_IndexedTriangles)
+static cc_bool gfx_staticVb;
 
 static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
-	return memalign(16, count * strideSizes[fmt]);
+	return memalign(32, count * strideSizes[fmt]);
 }
 
-void Gfx_BindVb(GfxResourceID vb) { gfx_vertices = vb; }
+void Gfx_BindVb(GfxResourceID vb) { gfx_vertices = vb; gfx_staticVb = true; }
 
 void Gfx_DeleteVb(GfxResourceID* vb) {
 	GfxResourceID data = *vb;
@@ -366,7 +369,10 @@ void* Gfx_LockVb(GfxResourceID vb, VertexFormat fmt, int count) {
 
 void Gfx_UnlockVb(GfxResourceID vb) { 
 	gfx_vertices = vb; 
+	gfx_staticVb = true;
 	DCFlushRange(vb, vb_size);
+	// Memory may have been previously used by a different vertex buffer
+	GX_InvVtxCache();
 }
 
 
@@ -374,7 +380,7 @@ static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
 	return memalign(16, maxVertices * strideSizes[fmt]);
 }
 
-void Gfx_BindDynamicVb(GfxResourceID vb) { Gfx_BindVb(vb); }
+void Gfx_BindDynamicVb(GfxResourceID vb) { gfx_vertices = vb; gfx_staticVb = false; }
 
 void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
 	vb_size = count * strideSizes[fmt];
@@ -383,6 +389,7 @@ void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
 
 void Gfx_UnlockDynamicVb(GfxResourceID vb) { 
 	gfx_vertices = vb;
+	gfx_staticVb = false;
 	DCFlushRange(vb, vb_size);
 }
 
@@ -564,17 +571,18 @@ void Gfx_DisableTextureOffset(void) {
 /*########################################################################################################################*
 *---------------------------------------------------------Drawing---------------------------------------------------------*
 *#########################################################################################################################*/
+// Type of the currently set vertex descriptors (GX_DIRECT or GX_INDEX16)
+static int gfx_descsType;
+static void* gfx_arrays;
+
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	if (fmt == gfx_format) return;
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
+	gfx_descsType = -1;
+	gfx_arrays    = NULL;
 
-	GX_ClearVtxDesc();
 	if (fmt == VERTEX_FORMAT_TEXTURED) {
-		GX_SetVtxDesc(GX_VA_POS,  GX_DIRECT);
-		GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-		GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
-
 		GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_POS,  GX_POS_XYZ,  GX_F32,   0);
 		GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
 		GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST,   GX_F32,   0);
@@ -585,9 +593,6 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 		GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
 		GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
 	} else {
-		GX_SetVtxDesc(GX_VA_POS,  GX_DIRECT);
-		GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-
 		GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_POS,  GX_POS_XYZ,  GX_F32,   0);
 		GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
 
@@ -601,7 +606,61 @@ void Gfx_DrawVb_Lines(int verticesCount) {
 }
 
 
+static void SetVertexDescs(int type) {
+	if (type == gfx_descsType) return;
+	gfx_descsType = type;
+
+	GX_ClearVtxDesc();
+	GX_SetVtxDesc(GX_VA_POS,  type);
+	GX_SetVtxDesc(GX_VA_CLR0, type);
+	if (gfx_format == VERTEX_FORMAT_TEXTURED) GX_SetVtxDesc(GX_VA_TEX0, type);
+}
+
+static void SetVertexArrays(void) {
+	if (gfx_arrays == gfx_vertices) return;
+	gfx_arrays = gfx_vertices;
+
+	if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+		struct VertexTextured* v = (struct VertexTextured*)gfx_vertices;
+		GX_SetArray(GX_VA_POS,  &v->x,   SIZEOF_VERTEX_TEXTURED);
+		GX_SetArray(GX_VA_CLR0, &v->Col, SIZEOF_VERTEX_TEXTURED);
+		GX_SetArray(GX_VA_TEX0, &v->U,   SIZEOF_VERTEX_TEXTURED);
+	} else {
+		struct VertexColoured* v = (struct VertexColoured*)gfx_vertices;
+		GX_SetArray(GX_VA_POS,  &v->x,   SIZEOF_VERTEX_COLOURED);
+		GX_SetArray(GX_VA_CLR0, &v->Col, SIZEOF_VERTEX_COLOURED);
+	}
+}
+
+// Static vertex buffers are drawn by sending only vertex indices through the FIFO,
+//  with the GPU then reading the vertex data directly from main memory
+// NOTE: Dynamic vertex buffers are usually rewritten multiple times per frame,
+//  so their vertex data must be copied into the FIFO instead (see below)
+static void Draw_IndexedTriangles(int verticesCount, int startVertex) {
+	SetVertexDescs(GX_INDEX16);
+	SetVertexArrays();
+	int end = startVertex + verticesCount;
+
+	GX_Begin(GX_QUADS, GX_VTXFMT0, verticesCount);
+	if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+		for (int i = startVertex; i < end; i++) 
+		{
+			GX_Position1x16(i);
+			GX_Color1x16(i);
+			GX_TexCoord1x16(i);
+		}
+	} else {
+		for (int i = startVertex; i < end; i++) 
+		{
+			GX_Position1x16(i);
+			GX_Color1x16(i);
+		}
+	}
+	GX_End();
+}
+
 static void Draw_ColouredTriangles(int verticesCount, int startVertex) {
+	SetVertexDescs(GX_DIRECT);
 	GX_Begin(GX_QUADS, GX_VTXFMT0, verticesCount);
 	// TODO: Ditch indexed rendering and use GX_QUADS instead ??
 	for (int i = 0; i < verticesCount; i++) 
@@ -615,6 +674,7 @@ static void Draw_ColouredTriangles(int verticesCount, int startVertex) {
 }
 
 static void Draw_TexturedTriangles(int verticesCount, int startVertex) {
+	SetVertexDescs(GX_DIRECT);
 	GX_Begin(GX_QUADS, GX_VTXFMT0, verticesCount);
 	for (int i = 0; i < verticesCount; i++) 
 	{
@@ -627,8 +687,13 @@ static void Draw_TexturedTriangles(int verticesCount, int startVertex) {
 	GX_End();
 }
 
+// Indices are limited to 16 bits
+#define CanDrawIndexed(verticesCount, startVertex) (gfx_staticVb && (startVertex) + (verticesCount) <= 0xFFFF)
+
 void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
-	if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+	if (CanDrawIndexed(verticesCount, startVertex)) {
+		Draw_IndexedTriangles(verticesCount, startVertex);
+	} else if (gfx_format == VERTEX_FORMAT_TEXTURED) {
 		Draw_TexturedTriangles(verticesCount, startVertex);
 	} else {
 		Draw_ColouredTriangles(verticesCount, startVertex);
@@ -636,7 +701,9 @@ void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
 }
 
 void Gfx_DrawVb_IndexedTris(int verticesCount) {
-	if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+	if (CanDrawIndexed(verticesCount, 0)) {
+		Draw_IndexedTriangles(verticesCount, 0);
+	} else if (gfx_format == VERTEX_FORMAT_TEXTURED) {
 		Draw_TexturedTriangles(verticesCount, 0);
 	} else {
 		Draw_ColouredTriangles(verticesCount, 0);
@@ -644,6 +711,10 @@ void Gfx_DrawVb_IndexedTris(int verticesCount) {
 }
 
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
-	Draw_TexturedTriangles(verticesCount, startVertex);
+	if (CanDrawIndexed(verticesCount, startVertex)) {
+		Draw_IndexedTriangles(verticesCount, startVertex);
+	} else {
+		Draw_TexturedTriangles(verticesCount, startVertex);
+	}
 }
 #endif
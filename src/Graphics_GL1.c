@@ -20,6 +20,7 @@
 /* e.g. GLAPI void APIENTRY glFunction(int args); */
 #define GL_FUNC(_retType, name) GLAPI _retType APIENTRY name
 #include "../misc/opengl/GL1Funcs.h"
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 #if defined CC_BUILD_GL11
 static GLuint activeList;
@@ -251,6 +252,18 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	_glBindBuffer(GL_ARRAY_BUFFER, vb);
 	_glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
 }
+
+void Gfx_SetDynamicVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount) {
+	cc_uint32 offset = startVertex * strideSizes[fmt];
+	cc_uint32 size   = vCount      * strideSizes[fmt];
+	_glBindBuffer(GL_ARRAY_BUFFER, vb);
+	_glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
+}
+
+static void Gfx_OrphanDynamicVb(GfxResourceID vb, cc_uint32 size) {
+	_glBindBuffer(GL_ARRAY_BUFFER, vb);
+	_glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+}
 #else
 static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
 	return (GfxResourceID)Mem_TryAlloc(maxVertices, strideSizes[fmt]);
@@ -301,6 +314,12 @@ static void GL_SetupVbTextured(void) {
 	_glTexCoordPointer(2, GL_FLOAT,      SIZEOF_VERTEX_TEXTURED, VB_PTR + 16);
 }
 
+static void GL_SetupVbChunk(void) {
+	_glVertexPointer(3, GL_SHORT,        SIZEOF_VERTEX_CHUNK, VB_PTR +  0);
+	_glColorPointer(4, GL_UNSIGNED_BYTE, SIZEOF_VERTEX_CHUNK, VB_PTR +  8);
+	_glTexCoordPointer(2, GL_SHORT,      SIZEOF_VERTEX_CHUNK, VB_PTR + 12);
+}
+
 static void GL_SetupVbColoured_Range(int startVertex) {
 	cc_uint32 offset = startVertex * SIZEOF_VERTEX_COLOURED;
 	_glVertexPointer(3, GL_FLOAT,          SIZEOF_VERTEX_COLOURED, VB_PTR + offset +  0);
@@ -314,8 +333,17 @@ static void GL_SetupVbTextured_Range(int startVertex) {
 	_glTexCoordPointer(2, GL_FLOAT,        SIZEOF_VERTEX_TEXTURED, VB_PTR + offset + 16);
 }
 
+static void GL_SetupVbChunk_Range(int startVertex) {
+	cc_uint32 offset = startVertex * SIZEOF_VERTEX_CHUNK;
+	_glVertexPointer(3, GL_SHORT,          SIZEOF_VERTEX_CHUNK, VB_PTR + offset +  0);
+	_glColorPointer(4, GL_UNSIGNED_BYTE,   SIZEOF_VERTEX_CHUNK, VB_PTR + offset +  8);
+	_glTexCoordPointer(2, GL_SHORT,        SIZEOF_VERTEX_CHUNK, VB_PTR + offset + 12);
+}
+
+static void SetChunkMatrices(cc_bool enabled);
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	if (fmt == gfx_format) return;
+	if (gfx_format == VERTEX_FORMAT_CHUNK) SetChunkMatrices(false);
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
@@ -325,6 +353,13 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 
 		gfx_setupVBFunc      = GL_SetupVbTextured;
 		gfx_setupVBRangeFunc = GL_SetupVbTextured_Range;
+	} else if (fmt == VERTEX_FORMAT_CHUNK) {
+		_glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnable(GL_TEXTURE_2D);
+		SetChunkMatrices(true);
+
+		gfx_setupVBFunc      = GL_SetupVbChunk;
+		gfx_setupVBRangeFunc = GL_SetupVbChunk_Range;
 	} else {
 		_glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisable(GL_TEXTURE_2D);
@@ -358,21 +393,36 @@ void Gfx_DrawVb_IndexedTris(int verticesCount) {
 #ifdef CC_BUILD_GL11
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) { glCallList(activeList); }
 #else
+/* NOTE: Uses current vertex format, which is either textured or chunk vertices */
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
-	cc_uint32 offset = startVertex * SIZEOF_VERTEX_TEXTURED;
-	_glVertexPointer(3, GL_FLOAT,        SIZEOF_VERTEX_TEXTURED, VB_PTR + offset +  0);
-	_glColorPointer(4, GL_UNSIGNED_BYTE, SIZEOF_VERTEX_TEXTURED, VB_PTR + offset + 12);
-	_glTexCoordPointer(2, GL_FLOAT,      SIZEOF_VERTEX_TEXTURED, VB_PTR + offset + 16);
-	_glDrawElements(GL_TRIANGLES,        ICOUNT(verticesCount),  GL_UNSIGNED_SHORT, IB_PTR);
+	gfx_setupVBRangeFunc(startVertex);
+	_glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, IB_PTR);
 }
 #endif /* !CC_BUILD_GL11 */
 
+void Gfx_DrawIndexedTris_T2fC4b_Multi(const int* counts, const int* startVertices, int rangesCount) {
+	GLsizei icounts[GFX_MAX_DRAW_RANGES];
+	const GLvoid* offsets[GFX_MAX_DRAW_RANGES];
+	int i;
+
+	if (GL_CalcDrawRanges(counts, startVertices, rangesCount, icounts, offsets)) {
+		gfx_setupVBFunc();
+		_glMultiDrawElements(GL_TRIANGLES, icounts, GL_UNSIGNED_SHORT, offsets, rangesCount);
+		return;
+	}
+
+	for (i = 0; i < rangesCount; i++)
+	{
+		Gfx_DrawIndexedTris_T2fC4b(counts[i], startVertices[i]);
+	}
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------------Textures--------------------------------------------------------*
 *#########################################################################################################################*/
 void Gfx_BindTexture(GfxResourceID texId) {
-	_glBindTexture(GL_TEXTURE_2D, ptr_to_uint(texId));
+	GL_BindTexture(ptr_to_uint(texId));
 }
 
 
@@ -444,8 +494,9 @@ void Gfx_DepthOnlyRendering(cc_bool depthOnly) {
 *#########################################################################################################################*/
 static GLenum matrix_modes[3] = { GL_PROJECTION, GL_MODELVIEW, GL_TEXTURE };
 static int lastMatrix;
+static struct Matrix _view;
 
-void Gfx_LoadMatrix(MatrixType type, const struct Matrix* matrix) {
+static void GL_LoadMatrix(int type, const struct Matrix* matrix) {
 	if (type != lastMatrix) { lastMatrix = type; glMatrixMode(matrix_modes[type]); }
 
 	if (matrix == &Matrix_Identity) {
@@ -455,6 +506,11 @@ void Gfx_LoadMatrix(MatrixType type, const struct Matrix* matrix) {
 	}
 }
 
+void Gfx_LoadMatrix(MatrixType type, const struct Matrix* matrix) {
+	if (type == MATRIX_VIEW) _view = *matrix;
+	GL_LoadMatrix(type, matrix);
+}
+
 void Gfx_LoadMVP(const struct Matrix* view, const struct Matrix* proj, struct Matrix* mvp) {
 	Gfx_LoadMatrix(MATRIX_VIEW, view);
 	Gfx_LoadMatrix(MATRIX_PROJ, proj);
@@ -469,6 +525,30 @@ void Gfx_EnableTextureOffset(float x, float y) {
 
 void Gfx_DisableTextureOffset(void) { Gfx_LoadMatrix(2, &Matrix_Identity); }
 
+/* Chunk vertices are fixed point, so the scale is undone with the modelview and texture matrices */
+static void SetChunkMatrices(cc_bool enabled) {
+	struct Matrix tex;
+	if (!enabled) {
+		GL_LoadMatrix(MATRIX_VIEW, &_view);
+		GL_LoadMatrix(2, &Matrix_Identity);
+		return;
+	}
+
+	Matrix_Scale(&tex, 1.0f / VERTEX_CHUNK_U_SCALE, 1.0f / VERTEX_CHUNK_V_SCALE, 1.0f);
+	GL_LoadMatrix(2, &tex);
+}
+
+void Gfx_SetChunkOffset(float x, float y, float z) {
+	struct Matrix offset, view;
+	if (!Gfx.SupportsChunkVertices) return;
+
+	Matrix_Scale(&offset, 1.0f / VERTEX_CHUNK_POS_SCALE, 1.0f / VERTEX_CHUNK_POS_SCALE, 1.0f / VERTEX_CHUNK_POS_SCALE);
+	offset.row4.x = x; offset.row4.y = y; offset.row4.z = z;
+
+	Matrix_Mul(&view, &offset, &_view);
+	GL_LoadMatrix(MATRIX_VIEW, &view);
+}
+
 
 /*########################################################################################################################*
 *-------------------------------------------------------State setup-------------------------------------------------------*
@@ -683,6 +763,8 @@ static void FallbackOpenGL(void) {
 	/* OpenGL 1.0 fallback support */
 	if (_realDrawElements) return;
 	Window_ShowDialog("Performance warning", "OpenGL 1.0 only support, expect awful performance");
+	Gfx.SupportsChunkVertices = false;
+	Gfx.SupportsScaledScene   = false;
 
 	_glDrawElements    = gl10_drawElements;    _glColorPointer  = gl10_colorPointer;
 	_glTexCoordPointer = gl10_texCoordPointer; _glVertexPointer = gl10_vertexPointer;
@@ -726,15 +808,23 @@ static void GLBackend_Init(void) {
 #endif
 	customMipmapsLevels = true;
 	Gfx.BackendType     = CC_GFX_BACKEND_GL1;
+	Gfx.SupportsChunkVertices = true;
 
 	/* Supported in core since 1.5 */
 	if (major > 1 || (major == 1 && minor >= 5)) {
 		GLContext_GetAll(coreVboFuncs, Array_Elems(coreVboFuncs));
+		GL_LoadMultiDraw();
+		GL_LoadCompressedTextures();
 	} else if (String_CaselessContains(&extensions, &vboExt)) {
 		GLContext_GetAll(arbVboFuncs,  Array_Elems(arbVboFuncs));
+		GL_LoadMultiDraw();
+		GL_LoadCompressedTextures();
 	} else {
 		FallbackOpenGL();
 	}
+	GL_LoadFenceSync();
+	GL_LoadTimerQueries();
+	GL_LoadPackBuffers();
 }
 #endif
 #endif
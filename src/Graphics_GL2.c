@@ -22,6 +22,7 @@
 #undef  GL_FUNC
 #define GL_FUNC(_retType, name) static _retType (APIENTRY *name)
 #include "../misc/opengl/GL2Funcs.h"
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 #define GLSym(sym) { DYNAMICLIB_QUOTE(sym), (void**)&sym }
 static const struct DynamicLibSym core_funcs[] = {
@@ -47,6 +48,10 @@ static const struct DynamicLibSym core_funcs[] = {
 #define _glTexSubImage2D  glTexSubImage2D
 
 #include "_GLShared.h"
+/* glDrawElementsBaseVertex is core since OpenGL 3.2 and OpenGL ES 3.2, but is an extension before then */
+typedef void (APIENTRY *FP_glDrawElementsBaseVertex)(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLint baseVertex);
+static FP_glDrawElementsBaseVertex _glDrawElementsBaseVertex;
+
 static GfxResourceID white_square;
 static int postProcess;
 enum PostProcess { POSTPROCESS_NONE, POSTPROCESS_GRAYSCALE };
@@ -56,10 +61,28 @@ static const char* const postProcess_Names[2] = { "NONE", "GRAYSCALE" };
 /*########################################################################################################################*
 *-------------------------------------------------------Index buffers-----------------------------------------------------*
 *#########################################################################################################################*/
+static void GL_BindBuffer(GLenum target, GLuint id) {
+	GLuint* cur = target == GL_ARRAY_BUFFER ? &gl_state.vb : &gl_state.ib;
+	if (*cur == id) { gl_callsSkipped++; return; }
+
+	*cur = id;
+	glBindBuffer(target, id);
+	gl_callsIssued++;
+}
+
+static void GL_DeleteBuffer(GLuint id) {
+	glDeleteBuffers(1, &id);
+	/* Deleting a bound buffer reverts the binding to buffer 0 */
+	if (gl_state.vb == id) gl_state.vb = 0;
+	if (gl_state.ib == id) gl_state.ib = 0;
+	/* And also detaches it from any vertex attributes */
+	if (gl_state.attribsVb == id) gl_state.attribsFormat = -1;
+}
+
 static GLuint GL_GenAndBind(GLenum target) {
 	GLuint id;
 	glGenBuffers(1, &id);
-	glBindBuffer(target, id);
+	GL_BindBuffer(target, id);
 	return id;
 }
 
@@ -74,13 +97,13 @@ GfxResourceID Gfx_CreateIb2(int count, Gfx_FillIBFunc fillFunc, void* obj) {
 }
 
 void Gfx_BindIb(GfxResourceID ib) { 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ptr_to_uint(ib)); 
+	GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ptr_to_uint(ib)); 
 }
 
 void Gfx_DeleteIb(GfxResourceID* ib) {
 	GLuint id = ptr_to_uint(*ib);
 	if (!id) return;
-	glDeleteBuffers(1, &id);
+	GL_DeleteBuffer(id);
 	*ib = 0;
 }
 
@@ -94,12 +117,12 @@ static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
 }
 
 void Gfx_BindVb(GfxResourceID vb) { 
-	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb)); 
+	GL_BindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb)); 
 }
 
 void Gfx_DeleteVb(GfxResourceID* vb) {
 	GLuint id = ptr_to_uint(*vb);
-	if (id) glDeleteBuffers(1, &id);
+	if (id) GL_DeleteBuffer(id);
 	*vb = 0;
 }
 
@@ -124,12 +147,12 @@ static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
 }
 
 void Gfx_BindDynamicVb(GfxResourceID vb) {
-	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb)); 
+	GL_BindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb)); 
 }
 
 void Gfx_DeleteDynamicVb(GfxResourceID* vb) {
 	GLuint id = ptr_to_uint(*vb);
-	if (id) glDeleteBuffers(1, &id);
+	if (id) GL_DeleteBuffer(id);
 	*vb = 0;
 }
 
@@ -138,16 +161,28 @@ void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
 }
 
 void Gfx_UnlockDynamicVb(GfxResourceID vb) {
-	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
+	GL_BindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
 	glBufferSubData(GL_ARRAY_BUFFER, 0, tmpSize, tmpData);
 }
 
 void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	cc_uint32 size = vCount * gfx_stride;
-	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
+	GL_BindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
 	glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
 }
 
+void Gfx_SetDynamicVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount) {
+	cc_uint32 offset = startVertex * strideSizes[fmt];
+	cc_uint32 size   = vCount      * strideSizes[fmt];
+	GL_BindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
+}
+
+static void Gfx_OrphanDynamicVb(GfxResourceID vb, cc_uint32 size) {
+	GL_BindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
+	glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+}
+
 
 /*########################################################################################################################*
 *------------------------------------------------------OpenGL modern------------------------------------------------------*
@@ -157,6 +192,7 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 #define FTR_TEX_OFFSET (1 << 2)
 #define FTR_LINEAR_FOG (1 << 3)
 #define FTR_DENSIT_FOG (1 << 4)
+#define FTR_CHUNK_VERT (1 << 5)
 #define FTR_HASANY_FOG (FTR_LINEAR_FOG | FTR_DENSIT_FOG)
 #define FTR_FS_MEDIUMP (1 << 7)
 
@@ -165,12 +201,14 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 #define UNI_FOG_COL    (1 << 2)
 #define UNI_FOG_END    (1 << 3)
 #define UNI_FOG_DENS   (1 << 4)
-#define UNI_MASK_ALL   0x1F
+#define UNI_CHUNK_OFF  (1 << 5)
+#define UNI_MASK_ALL   0x3F
 
 /* cached uniforms (cached for multiple programs */
 static struct Matrix _view, _proj, _mvp;
 static cc_bool gfx_texTransform;
 static float _texX, _texY;
+static float _chunkX, _chunkY, _chunkZ;
 static PackedCol gfx_fogColor;
 static float gfx_fogEnd = -1.0f, gfx_fogDensity = -1.0f;
 static int gfx_fogMode = -1;
@@ -180,8 +218,8 @@ static struct GLShader {
 	int features;     /* what features are enabled for this shader */
 	int uniforms;     /* which associated uniforms need to be resent to GPU */
 	GLuint program;   /* OpenGL program ID (0 if not yet compiled) */
-	int locations[5]; /* location of uniforms (not constant) */
-} shaders[6 * 3] = {
+	int locations[6]; /* location of uniforms (not constant) */
+} shaders[6 * 3 + 2 * 3] = {
 	/* no fog */
 	{ 0              },
 	{ 0              | FTR_ALPHA_TEST },
@@ -203,6 +241,13 @@ static struct GLShader {
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET | FTR_ALPHA_TEST },
+	/* chunk vertices */
+	{ FTR_CHUNK_VERT | FTR_TEXTURE_UV },
+	{ FTR_CHUNK_VERT | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
+	{ FTR_CHUNK_VERT | FTR_TEXTURE_UV | FTR_LINEAR_FOG },
+	{ FTR_CHUNK_VERT | FTR_TEXTURE_UV | FTR_LINEAR_FOG | FTR_ALPHA_TEST },
+	{ FTR_CHUNK_VERT | FTR_TEXTURE_UV | FTR_DENSIT_FOG },
+	{ FTR_CHUNK_VERT | FTR_TEXTURE_UV | FTR_DENSIT_FOG | FTR_ALPHA_TEST },
 };
 static struct GLShader* gfx_activeShader;
 
@@ -210,6 +255,7 @@ static struct GLShader* gfx_activeShader;
 static void GenVertexShader(const struct GLShader* shader, cc_string* dst) {
 	int uv = shader->features & FTR_TEXTURE_UV;
 	int tm = shader->features & FTR_TEX_OFFSET;
+	int ck = shader->features & FTR_CHUNK_VERT;
 
 	String_AppendConst(dst,         "attribute vec3 in_pos;\n");
 	String_AppendConst(dst,         "attribute vec4 in_col;\n");
@@ -218,11 +264,16 @@ static void GenVertexShader(const struct GLShader* shader, cc_string* dst) {
 	if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
 	String_AppendConst(dst,         "uniform mat4 mvp;\n");
 	if (tm) String_AppendConst(dst, "uniform vec2 texOffset;\n");
+	if (ck) String_AppendConst(dst, "uniform vec3 chunkOffset;\n");
 
+	/* Chunk vertices are fixed point, see VERTEX_CHUNK_POS_SCALE/U_SCALE/V_SCALE */
 	String_AppendConst(dst,         "void main() {\n");
-	String_AppendConst(dst,         "  gl_Position = mvp * vec4(in_pos, 1.0);\n");
+	if (ck) String_AppendConst(dst, "  vec3 pos = in_pos * (1.0 / 1024.0) + chunkOffset;\n");
+	else    String_AppendConst(dst, "  vec3 pos = in_pos;\n");
+	String_AppendConst(dst,         "  gl_Position = mvp * vec4(pos, 1.0);\n");
 	String_AppendConst(dst,         "  out_col = in_col;\n");
 	if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
+	if (ck) String_AppendConst(dst, "  out_uv  = out_uv * vec2(1.0 / 1024.0, 1.0 / 16384.0);\n");
 	if (tm) String_AppendConst(dst, "  out_uv  = out_uv + texOffset;\n");
 	String_AppendConst(dst,         "}");
 }
@@ -358,6 +409,7 @@ static void CompileProgram(struct GLShader* shader) {
 		shader->locations[2] = glGetUniformLocation(program, "fogCol");
 		shader->locations[3] = glGetUniformLocation(program, "fogEnd");
 		shader->locations[4] = glGetUniformLocation(program, "fogDensity");
+		shader->locations[5] = glGetUniformLocation(program, "chunkOffset");
 		return;
 	}
 	temp = 0;
@@ -385,28 +437,33 @@ static void ReloadUniforms(void) {
 	if (!s) return; /* NULL if context is lost */
 
 	if (s->uniforms & UNI_MVP_MATRIX) {
-		glUniformMatrix4fv(s->locations[0], 1, false, (float*)&_mvp);
+		glUniformMatrix4fv(s->locations[0], 1, false, (float*)&_mvp); gl_callsIssued++;
 		s->uniforms &= ~UNI_MVP_MATRIX;
 	}
 	if ((s->uniforms & UNI_TEX_OFFSET) && (s->features & FTR_TEX_OFFSET)) {
-		glUniform2f(s->locations[1], _texX, _texY);
+		glUniform2f(s->locations[1], _texX, _texY); gl_callsIssued++;
 		s->uniforms &= ~UNI_TEX_OFFSET;
 	}
 	if ((s->uniforms & UNI_FOG_COL) && (s->features & FTR_HASANY_FOG)) {
 		glUniform3f(s->locations[2], PackedCol_R(gfx_fogColor) / 255.0f, PackedCol_G(gfx_fogColor) / 255.0f,
 									 PackedCol_B(gfx_fogColor) / 255.0f);
+		gl_callsIssued++;
 		s->uniforms &= ~UNI_FOG_COL;
 	}
 	if ((s->uniforms & UNI_FOG_END) && (s->features & FTR_LINEAR_FOG)) {
-		glUniform1f(s->locations[3], gfx_fogEnd);
+		glUniform1f(s->locations[3], gfx_fogEnd); gl_callsIssued++;
 		s->uniforms &= ~UNI_FOG_END;
 	}
 	if ((s->uniforms & UNI_FOG_DENS) && (s->features & FTR_DENSIT_FOG)) {
 		/* See https://docs.microsoft.com/en-us/previous-versions/ms537113(v%3Dvs.85) */
 		/* The equation for EXP mode is exp(-density * z), so just negate density here */
-		glUniform1f(s->locations[4], -gfx_fogDensity);
+		glUniform1f(s->locations[4], -gfx_fogDensity); gl_callsIssued++;
 		s->uniforms &= ~UNI_FOG_DENS;
 	}
+	if ((s->uniforms & UNI_CHUNK_OFF) && (s->features & FTR_CHUNK_VERT)) {
+		glUniform3f(s->locations[5], _chunkX, _chunkY, _chunkZ); gl_callsIssued++;
+		s->uniforms &= ~UNI_CHUNK_OFF;
+	}
 }
 
 /* Switches program to one that duplicates current fixed function state */
@@ -420,16 +477,21 @@ static void SwitchProgram(void) {
 		if (gfx_fogMode >= 1) index += 6; /* exp fog */
 	}
 
-	if (gfx_format == VERTEX_FORMAT_TEXTURED) index += 2;
-	if (gfx_texTransform) index += 2;
-	if (gfx_alphaTest)    index += 1;
+	if (gfx_format == VERTEX_FORMAT_CHUNK) {
+		index = 6 * 3 + index / 3;        /* 2 chunk shaders per fog mode */
+	} else {
+		if (gfx_format == VERTEX_FORMAT_TEXTURED) index += 2;
+		if (gfx_texTransform) index += 2;
+	}
+	if (gfx_alphaTest) index += 1;
 
 	shader = &shaders[index];
-	if (shader == gfx_activeShader) { ReloadUniforms(); return; }
+	if (shader == gfx_activeShader) { gl_callsSkipped++; ReloadUniforms(); return; }
 	if (!shader->program) CompileProgram(shader);
 
 	gfx_activeShader = shader;
 	glUseProgram(shader->program);
+	gl_callsIssued++;
 	ReloadUniforms();
 }
 
@@ -443,37 +505,41 @@ void Gfx_BindTexture(GfxResourceID texId) {
 	/*   WebGL/OpenGL ES - pure black 1x1 texture */
 	/* So for consistency, always use a 1x1 pure white texture */
 	if (!texId) texId = white_square;
-	glBindTexture(GL_TEXTURE_2D, ptr_to_uint(texId));
+	GL_BindTexture(ptr_to_uint(texId));
 }
 
 
 /*########################################################################################################################*
 *-----------------------------------------------------State management----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetFog(cc_bool enabled) { gfx_fogEnabled = enabled; SwitchProgram(); }
+void Gfx_SetFog(cc_bool enabled) {
+	if (gfx_fogEnabled == enabled) { gl_callsSkipped++; return; }
+	gfx_fogEnabled = enabled; 
+	SwitchProgram(); 
+}
 void Gfx_SetFogCol(PackedCol color) {
-	if (color == gfx_fogColor) return;
+	if (color == gfx_fogColor) { gl_callsSkipped++; return; }
 	gfx_fogColor = color;
 	DirtyUniform(UNI_FOG_COL);
 	ReloadUniforms();
 }
 
 void Gfx_SetFogDensity(float value) {
-	if (gfx_fogDensity == value) return;
+	if (gfx_fogDensity == value) { gl_callsSkipped++; return; }
 	gfx_fogDensity = value;
 	DirtyUniform(UNI_FOG_DENS);
 	ReloadUniforms();
 }
 
 void Gfx_SetFogEnd(float value) {
-	if (gfx_fogEnd == value) return;
+	if (gfx_fogEnd == value) { gl_callsSkipped++; return; }
 	gfx_fogEnd = value;
 	DirtyUniform(UNI_FOG_END);
 	ReloadUniforms();
 }
 
 void Gfx_SetFogMode(FogFunc func) {
-	if (gfx_fogMode == func) return;
+	if (gfx_fogMode == func) { gl_callsSkipped++; return; }
 	gfx_fogMode = func;
 	SwitchProgram();
 }
@@ -491,10 +557,14 @@ void Gfx_DepthOnlyRendering(cc_bool depthOnly) {
 *---------------------------------------------------------Matrices--------------------------------------------------------*
 *#########################################################################################################################*/
 void Gfx_LoadMatrix(MatrixType type, const struct Matrix* matrix) {
+	struct Matrix mvp;
 	if (type == MATRIX_VIEW) _view = *matrix;
 	if (type == MATRIX_PROJ) _proj = *matrix;
 
-	Matrix_Mul(&_mvp, &_view, &_proj);
+	Matrix_Mul(&mvp, &_view, &_proj);
+	if (Mem_Equal(&mvp, &_mvp, sizeof(struct Matrix))) { gl_callsSkipped++; return; }
+
+	_mvp = mvp;
 	DirtyUniform(UNI_MVP_MATRIX);
 	ReloadUniforms();
 }
@@ -506,17 +576,29 @@ void Gfx_LoadMVP(const struct Matrix* view, const struct Matrix* proj, struct Ma
 }
 
 void Gfx_EnableTextureOffset(float x, float y) {
-	_texX = x; _texY = y;
+	if (x != _texX || y != _texY) {
+		_texX = x; _texY = y;
+		DirtyUniform(UNI_TEX_OFFSET);
+	}
+
+	if (gfx_texTransform) { ReloadUniforms(); return; }
 	gfx_texTransform = true;
-	DirtyUniform(UNI_TEX_OFFSET);
 	SwitchProgram();
 }
 
 void Gfx_DisableTextureOffset(void) {
+	if (!gfx_texTransform) { gl_callsSkipped++; return; }
 	gfx_texTransform = false;
 	SwitchProgram();
 }
 
+void Gfx_SetChunkOffset(float x, float y, float z) {
+	if (x == _chunkX && y == _chunkY && z == _chunkZ) return;
+	_chunkX = x; _chunkY = y; _chunkZ = z;
+	DirtyUniform(UNI_CHUNK_OFF);
+	ReloadUniforms();
+}
+
 
 /*########################################################################################################################*
 *-------------------------------------------------------State setup-------------------------------------------------------*
@@ -529,11 +611,41 @@ static void GLContext_GetAll(const struct DynamicLibSym* syms, int count) {
 	}
 }
 
+static void GL_LoadBaseVertex(void) {
+	/* Matches e.g. GL_ARB_draw_elements_base_vertex, GL_OES_draw_elements_base_vertex */
+	static const cc_string baseExt = String_FromConst("_draw_elements_base_vertex");
+	cc_string exts = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	void* func = NULL;
+
+#ifdef CC_BUILD_GLES
+	/* NOTE: Some EGL implementations return non-NULL for unsupported functions, so check extension first */
+	if (!String_CaselessContains(&exts, &baseExt)) return;
+	func = GLContext_GetAddress("glDrawElementsBaseVertexOES");
+	if (!func) func = GLContext_GetAddress("glDrawElementsBaseVertexEXT");
+	if (!func) func = GLContext_GetAddress("glDrawElementsBaseVertex");
+#else
+	const GLubyte* ver = glGetString(GL_VERSION);
+	int major = ver[0] - '0', minor = ver[2] - '0';
+	if (major < 3 || (major == 3 && minor < 2)) {
+		if (!String_CaselessContains(&exts, &baseExt)) return;
+	}
+	func = GLContext_GetAddress("glDrawElementsBaseVertex");
+#endif
+	_glDrawElementsBaseVertex = (FP_glDrawElementsBaseVertex)func;
+}
+
 static void GLBackend_Init(void) {
 #ifdef CC_BUILD_WIN
 	GLContext_GetAll(core_funcs, Array_Elems(core_funcs));
 #endif
 	Gfx.BackendType = CC_GFX_BACKEND_GL2;
+	Gfx.SupportsChunkVertices = true;
+	GL_LoadMultiDraw();
+	GL_LoadCompressedTextures();
+	GL_LoadBaseVertex();
+	GL_LoadFenceSync();
+	GL_LoadTimerQueries();
+	GL_LoadPackBuffers();
 
 #ifdef CC_BUILD_GLES
 	// OpenGL ES 2.0 doesn't support custom mipmaps levels, but 3.2 does
@@ -636,6 +748,26 @@ typedef void (*GL_SetupVBRangeFunc)(int startVertex);
 static GL_SetupVBFunc gfx_setupVBFunc;
 static GL_SetupVBRangeFunc gfx_setupVBRangeFunc;
 
+/* Sets up vertex attributes to start from the beginning of the currently bound vertex buffer */
+/* NOTE: Vertex attributes only need to be set up again when the vertex buffer or format changes */
+static void GL_SetupVb(void) {
+	if (gl_state.attribsVb == gl_state.vb && gl_state.attribsFormat == gfx_format) { 
+		gl_callsSkipped++; return; 
+	}
+
+	gl_state.attribsVb     = gl_state.vb;
+	gl_state.attribsFormat = gfx_format;
+	gfx_setupVBFunc();
+	gl_callsIssued++;
+}
+
+/* Sets up vertex attributes to start from the given vertex in the currently bound vertex buffer */
+static void GL_SetupVbRange(int startVertex) {
+	gl_state.attribsFormat = -1;
+	gfx_setupVBRangeFunc(startVertex);
+	gl_callsIssued++;
+}
+
 static void GL_SetupVbColoured(void) {
 	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_COLOURED, uint_to_ptr( 0));
 	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_COLOURED, uint_to_ptr(12));
@@ -647,6 +779,12 @@ static void GL_SetupVbTextured(void) {
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(16));
 }
 
+static void GL_SetupVbChunk(void) {
+	glVertexAttribPointer(0, 3, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr( 0));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_CHUNK, uint_to_ptr( 8));
+	glVertexAttribPointer(2, 2, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr(12));
+}
+
 static void GL_SetupVbColoured_Range(int startVertex) {
 	cc_uint32 offset = startVertex * SIZEOF_VERTEX_COLOURED;
 	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_COLOURED, uint_to_ptr(offset     ));
@@ -660,6 +798,13 @@ static void GL_SetupVbTextured_Range(int startVertex) {
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset + 16));
 }
 
+static void GL_SetupVbChunk_Range(int startVertex) {
+	cc_uint32 offset = startVertex * SIZEOF_VERTEX_CHUNK;
+	glVertexAttribPointer(0, 3, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr(offset     ));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_CHUNK, uint_to_ptr(offset +  8));
+	glVertexAttribPointer(2, 2, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr(offset + 12));
+}
+
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	if (fmt == gfx_format) return;
 	gfx_format = fmt;
@@ -669,6 +814,10 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 		glEnableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbTextured;
 		gfx_setupVBRangeFunc = GL_SetupVbTextured_Range;
+	} else if (fmt == VERTEX_FORMAT_CHUNK) {
+		glEnableVertexAttribArray(2);
+		gfx_setupVBFunc      = GL_SetupVbChunk;
+		gfx_setupVBRangeFunc = GL_SetupVbChunk_Range;
 	} else {
 		glDisableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbColoured;
@@ -678,33 +827,60 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 }
 
 void Gfx_DrawVb_Lines(int verticesCount) {
-	gfx_setupVBFunc();
+	GL_SetupVb();
 	glDrawArrays(GL_LINES, 0, verticesCount);
 }
 
+/* Draws triangles starting from the given vertex, without having to set up vertex attributes again */
+static void GL_DrawBaseVertex(int verticesCount, int startVertex) {
+	GL_SetupVb();
+	_glDrawElementsBaseVertex(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL, startVertex);
+}
+
 void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
-	gfx_setupVBRangeFunc(startVertex);
+	if (_glDrawElementsBaseVertex) { GL_DrawBaseVertex(verticesCount, startVertex); return; }
+
+	GL_SetupVbRange(startVertex);
 	glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
 }
 
 void Gfx_DrawVb_IndexedTris(int verticesCount) {
-	gfx_setupVBFunc();
+	GL_SetupVb();
 	glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
 }
 
+/* NOTE: Uses current vertex format, which is either textured or chunk vertices */
 void Gfx_BindVb_Textured(GfxResourceID vb) {
 	Gfx_BindVb(vb);
-	GL_SetupVbTextured();
+	GL_SetupVb();
 }
 
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
-	if (startVertex + verticesCount > GFX_MAX_VERTICES) {
-		GL_SetupVbTextured_Range(startVertex);
+	if (startVertex + verticesCount > GFX_MAX_VERTICES && _glDrawElementsBaseVertex) {
+		GL_DrawBaseVertex(verticesCount, startVertex);
+	} else if (startVertex + verticesCount > GFX_MAX_VERTICES) {
+		GL_SetupVbRange(startVertex);
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
-		GL_SetupVbTextured();
+		GL_SetupVb();
 	} else {
 		/* ICOUNT(startVertex) * 2 = startVertex * 3  */
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, uint_to_ptr(startVertex * 3));
 	}
 }
+
+void Gfx_DrawIndexedTris_T2fC4b_Multi(const int* counts, const int* startVertices, int rangesCount) {
+	GLsizei icounts[GFX_MAX_DRAW_RANGES];
+	const GLvoid* offsets[GFX_MAX_DRAW_RANGES];
+	int i;
+
+	if (GL_CalcDrawRanges(counts, startVertices, rangesCount, icounts, offsets)) {
+		_glMultiDrawElements(GL_TRIANGLES, icounts, GL_UNSIGNED_SHORT, offsets, rangesCount);
+		return;
+	}
+
+	for (i = 0; i < rangesCount; i++)
+	{
+		Gfx_DrawIndexedTris_T2fC4b(counts[i], startVertices[i]);
+	}
+}
 #endif
@@ -8,6 +8,7 @@
 #include <GL/gl.h>
 #include <GL/gl_integration.h>
 #include <malloc.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 typedef void (*GL_SetupVBFunc)(void);
 static GL_SetupVBFunc gfx_setupVBFunc;
@@ -5,6 +5,7 @@
 #include "Logger.h"
 #include "Window.h"
 #include <nds.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 /*########################################################################################################################*
 *---------------------------------------------------------General---------------------------------------------------------*
@@ -12,6 +12,7 @@
 #include <psxapi.h>
 #include <psxetc.h>
 #include <inline_c.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 // Based off https://github.com/Lameguy64/PSn00bSDK/blob/master/examples/beginner/hello/main.c
 
 
@@ -14,6 +14,7 @@
 #include <draw.h>
 #include <draw3d.h>
 #include <malloc.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 typedef struct Matrix VU0_MATRIX __attribute__((aligned(16)));
 typedef struct Vec4   VU0_VECTOR __attribute__((aligned(16)));
@@ -540,60 +541,20 @@ static xyz_t FinishVertex(VU0_VECTOR* src, float invW) {
 	return xyz;
 }
 
-static u64* DrawColouredTriangle(u64* dw, VU0_VECTOR* coords, 
-								struct VertexColoured* V0, struct VertexColoured* V1, struct VertexColoured* V2) {
-	ColouredVertex* dst = (ColouredVertex*)dw;
-	float Q;
-
-	// TODO optimise
-	// Add the "primitives" to the GIF packet
-	Q   = 1.0f / coords[0].w;
-	dst[0].rgba  = V0->Col;
-	dst[0].q     = Q;
-	dst[0].xyz   = FinishVertex(&coords[0], Q);
-
-	Q   = 1.0f / coords[1].w;
-	dst[1].rgba  = V1->Col;
-	dst[1].q     = Q;
-	dst[1].xyz   = FinishVertex(&coords[1], Q);
-
-	Q   = 1.0f / coords[2].w;
-	dst[2].rgba  = V2->Col;
-	dst[2].q     = Q;
-	dst[2].xyz   = FinishVertex(&coords[2], Q);
-
-	return dw + 6;
+static void FinishColouredVertex(ColouredVertex* dst, VU0_VECTOR* coords, struct VertexColoured* src) {
+	float Q = 1.0f / coords->w;
+	dst->rgba = src->Col;
+	dst->q    = Q;
+	dst->xyz  = FinishVertex(coords, Q);
 }
 
-static u64* DrawTexturedTriangle(u64* dw, VU0_VECTOR* coords, 
-								struct VertexTextured* V0, struct VertexTextured* V1, struct VertexTextured* V2) {
-	TexturedVertex* dst = (TexturedVertex*)dw;
-	float Q;
-
-	// TODO optimise
-	// Add the "primitives" to the GIF packet
-	Q   = 1.0f / coords[0].w;
-	dst[0].rgba  = V0->Col;
-	dst[0].q     = Q;
-	dst[0].u     = V0->U * Q;
-	dst[0].v     = V0->V * Q;
-	dst[0].xyz   = FinishVertex(&coords[0], Q);
-
-	Q   = 1.0f / coords[1].w;
-	dst[1].rgba  = V1->Col;
-	dst[1].q     = Q;
-	dst[1].u     = V1->U * Q;
-	dst[1].v     = V1->V * Q;
-	dst[1].xyz   = FinishVertex(&coords[1], Q);
-
-	Q   = 1.0f / coords[2].w;
-	dst[2].rgba  = V2->Col;
-	dst[2].q     = Q;
-	dst[2].u     = V2->U * Q;
-	dst[2].v     = V2->V * Q;
-	dst[2].xyz   = FinishVertex(&coords[2], Q);
-
-	return dw + 9;
+static void FinishTexturedVertex(TexturedVertex* dst, VU0_VECTOR* coords, struct VertexTextured* src) {
+	float Q = 1.0f / coords->w;
+	dst->rgba = src->Col;
+	dst->q    = Q;
+	dst->u    = src->U * Q;
+	dst->v    = src->V * Q;
+	dst->xyz  = FinishVertex(coords, Q);
 }
 
 extern void TransformTexturedQuad(void* src, VU0_VECTOR* dst, VU0_VECTOR* tmp, int* clip_flags);
@@ -607,21 +568,35 @@ static void DrawTexturedTriangles(int verticesCount, int startVertex) {
 
 	unsigned numVerts = 0;
 	VU0_VECTOR V[6], tmp;
+	TexturedVertex quad[4];
 	int clip[4];
 
 	for (int i = 0; i < verticesCount / 4; i++, v += 4)
 	{
 		TransformTexturedQuad(v, V, &tmp, clip);
+		cc_bool draw1 = ((clip[0] | clip[1] | clip[2]) & 0x3F) == 0;
+		cc_bool draw2 = ((clip[2] | clip[3] | clip[0]) & 0x3F) == 0;
+		if (!draw1 && !draw2) continue;
+
+		// Vertices 0 and 2 are shared by both triangles, so only
+		//  calculate the perspective divide for them once per quad
+		FinishTexturedVertex(&quad[0], &V[0], v + 0);
+		FinishTexturedVertex(&quad[2], &V[2], v + 2);
 		
-		if (((clip[0] | clip[1] | clip[2]) & 0x3F) == 0) {
-			dw = DrawTexturedTriangle(dw, V, v + 0, v + 1, v + 2);
-			numVerts += 3;
+		// Add the "primitives" to the GIF packet
+		TexturedVertex* dst = (TexturedVertex*)dw;
+		if (draw1) {
+			FinishTexturedVertex(&quad[1], &V[1], v + 1);
+			dst[0] = quad[0]; dst[1] = quad[1]; dst[2] = quad[2];
+			dst += 3; numVerts += 3;
 		}
 		
-		if (((clip[2] | clip[3] | clip[0]) & 0x3F) == 0) {
-			dw = DrawTexturedTriangle(dw, V + 3, v + 2, v + 3, v + 0);
-			numVerts += 3;
+		if (draw2) {
+			FinishTexturedVertex(&quad[3], &V[4], v + 3);
+			dst[0] = quad[2]; dst[1] = quad[3]; dst[2] = quad[0];
+			dst += 3; numVerts += 3;
 		}
+		dw = (u64*)dst;
 	}
 
 	if (numVerts == 0) {
@@ -644,21 +619,35 @@ static void DrawColouredTriangles(int verticesCount, int startVertex) {
 
 	unsigned numVerts = 0;
 	VU0_VECTOR V[6], tmp;
+	ColouredVertex quad[4];
 	int clip[4];
 
 	for (int i = 0; i < verticesCount / 4; i++, v += 4)
 	{
 		TransformColouredQuad(v, V, &tmp, clip);
+		cc_bool draw1 = ((clip[0] | clip[1] | clip[2]) & 0x3F) == 0;
+		cc_bool draw2 = ((clip[2] | clip[3] | clip[0]) & 0x3F) == 0;
+		if (!draw1 && !draw2) continue;
+
+		// Vertices 0 and 2 are shared by both triangles, so only
+		//  calculate the perspective divide for them once per quad
+		FinishColouredVertex(&quad[0], &V[0], v + 0);
+		FinishColouredVertex(&quad[2], &V[2], v + 2);
 		
-		if (((clip[0] | clip[1] | clip[2]) & 0x3F) == 0) {
-			dw = DrawColouredTriangle(dw, V, v + 0, v + 1, v + 2);
-			numVerts += 3;
+		// Add the "primitives" to the GIF packet
+		ColouredVertex* dst = (ColouredVertex*)dw;
+		if (draw1) {
+			FinishColouredVertex(&quad[1], &V[1], v + 1);
+			dst[0] = quad[0]; dst[1] = quad[1]; dst[2] = quad[2];
+			dst += 3; numVerts += 3;
 		}
 		
-		if (((clip[2] | clip[3] | clip[0]) & 0x3F) == 0) {
-			dw = DrawColouredTriangle(dw, V + 3, v + 2, v + 3, v + 0);
-			numVerts += 3;
+		if (draw2) {
+			FinishColouredVertex(&quad[3], &V[4], v + 3);
+			dst[0] = quad[2]; dst[1] = quad[3]; dst[2] = quad[0];
+			dst += 3; numVerts += 3;
 		}
+		dw = (u64*)dst;
 	}
 
 	if (numVerts == 0) {
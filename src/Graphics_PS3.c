@@ -7,6 +7,7 @@
 #include <malloc.h>
 #include <rsx/rsx.h>
 #include <sysutil/video.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 static cc_bool renderingDisabled;
 
 static gcmContextData* context;
@@ -11,6 +11,7 @@
 #include <pspdebug.h>
 #include <pspctrl.h>
 #include <pspgu.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 #define BUFFER_WIDTH  512
 #define SCREEN_WIDTH  480
@@ -5,6 +5,7 @@
 #include "Logger.h"
 #include "Window.h"
 #include <vitasdk.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 // TODO track last frame used on
 static cc_bool gfx_depthOnly;
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <yaul.h>
 #include <stdlib.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 #define SCREEN_WIDTH  320
 #define SCREEN_HEIGHT 224
@@ -1,8 +1,27 @@
 #include "Core.h"
 #if CC_GFX_BACKEND == CC_GFX_BACKEND_SOFTGPU
+/* NOTE: Included before Funcs.h, since C++ standard headers may #undef its min/max */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define SOFTGPU_SSE2
+	#include <emmintrin.h>
+#elif defined __ARM_NEON && defined __aarch64__
+	#define SOFTGPU_NEON
+	#include <arm_neon.h>
+#endif
 #include "_GraphicsBase.h"
 #include "Errors.h"
 #include "Window.h"
+#define MEM_SUBSYSTEM MEM_SYS_GFX
+
+/* SIMD rasteriser processes 4 pixels at once, and only supports 32 bit pixels with alpha in the upper 8 bits */
+#if (defined SOFTGPU_SSE2 || defined SOFTGPU_NEON) && BITMAPCOLOR_SIZE == 4 && BITMAPCOLOR_A_SHIFT == 24
+	#define SOFTGPU_SIMD
+#endif
+
+/* Triangles are binned into screen tiles, which are then rasterised in parallel on worker threads */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_LOWMEM && !defined CC_BUILD_CONSOLE
+	#define SOFTGPU_BINNING
+#endif
 
 static cc_bool faceCulling;
 static int fb_width, fb_height; 
@@ -12,16 +31,30 @@ static int fb_maxX, fb_maxY;
 
 static BitmapCol* colorBuffer;
 static BitmapCol clearColor;
-static cc_bool colWrite = true;
 static int cb_stride;
 
 static float* depthBuffer;
-static cc_bool depthTest  = true;
-static cc_bool depthWrite = true;
 static int db_stride;
 
+/* State that affects how triangles are rasterised */
+struct RastState {
+	BitmapCol* texPixels;
+	int texWidth, texHeight;
+	int texWidthMask, texHeightMask;
+	cc_bool textured, alphaTest, alphaBlend;
+	cc_bool depthTest, depthWrite, colWrite;
+};
+static struct RastState rast = { NULL, 0, 0, 0, 0, false, false, false, true, true, true };
+
 static void* gfx_vertices;
 static GfxResourceID white_square;
+/* Whether to use the SIMD rasteriser for 3D triangles (the scalar one acts as the reference) */
+static cc_bool rast_simd;
+/* Rasterises all triangles that have been drawn so far, but not rasterised yet */
+static void Bin_Flush(void);
+static void Bin_Start(void);
+static void Bin_Stop(void);
+static void Bin_Resize(void);
 
 void Gfx_RestoreState(void) {
 	InitDefaultResources();
@@ -49,8 +82,13 @@ void Gfx_Create(void) {
 
 	Gfx.Created      = true;
 	Gfx.BackendType  = CC_GFX_BACKEND_SOFTGPU;
+	Gfx.SupportsScaledScene = true;
 	
 	Gfx_RestoreState();
+#ifdef SOFTGPU_SIMD
+	rast_simd = Options_GetBool(OPT_SOFTGPU_SIMD, true);
+#endif
+	Bin_Start();
 }
 
 static void DestroyBuffers(void) {
@@ -60,6 +98,7 @@ static void DestroyBuffers(void) {
 }
 
 void Gfx_Free(void) { 
+	Bin_Stop();
 	Gfx_FreeState();
 	DestroyBuffers();
 }
@@ -70,27 +109,22 @@ typedef struct CCTexture {
 	BitmapCol pixels[];
 } CCTexture;
 
-static CCTexture* curTexture;
-static BitmapCol* curTexPixels;
-static int curTexWidth, curTexHeight;
-static int texWidthMask, texHeightMask;
-		
 void Gfx_BindTexture(GfxResourceID texId) {
 	if (!texId) texId = white_square;
 	CCTexture* tex = texId;
 
-	curTexture   = tex;
-	curTexPixels = tex->pixels;
-	curTexWidth  = tex->width;
-	curTexHeight = tex->height;
+	rast.texPixels = tex->pixels;
+	rast.texWidth  = tex->width;
+	rast.texHeight = tex->height;
 
-	texWidthMask  = (1 << Math_ilog2(tex->width))  - 1;
-	texHeightMask = (1 << Math_ilog2(tex->height)) - 1;
+	rast.texWidthMask  = (1 << Math_ilog2(tex->width))  - 1;
+	rast.texHeightMask = (1 << Math_ilog2(tex->height)) - 1;
 }
 		
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GfxResourceID data = *texId;
-	if (data) Mem_Free(data);
+	/* Binned triangles might still be using the texture */
+	if (data) { Bin_Flush(); Mem_Free(data); }
 	*texId = NULL;
 }
 		
@@ -108,6 +142,7 @@ void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, i
 	CCTexture* tex = (CCTexture*)texId;
 	BitmapCol* dst = (tex->pixels + x) + y * tex->width;
 
+	Bin_Flush();
 	CopyTextureData(dst, tex->width * BITMAPCOLOR_SIZE,
 					part, rowWidth  * BITMAPCOLOR_SIZE);
 }
@@ -130,11 +165,11 @@ void Gfx_SetFaceCulling(cc_bool enabled) {
 }
 
 static void SetAlphaTest(cc_bool enabled) {
-	/* Uses value from Gfx_SetAlphaTest */
+	rast.alphaTest = enabled;
 }
 
 static void SetAlphaBlend(cc_bool enabled) {
-	/* Uses value from Gfx_SetAlphaBlending */
+	rast.alphaBlend = enabled;
 }
 
 void Gfx_SetAlphaArgBlend(cc_bool enabled) { }
@@ -163,6 +198,7 @@ static void ClearDepthBuffer(void) {
 }
 
 void Gfx_ClearBuffers(GfxBuffers buffers) {
+	Bin_Flush();
 	if (buffers & GFX_BUFFER_COLOR) ClearColorBuffer();
 	if (buffers & GFX_BUFFER_DEPTH) ClearDepthBuffer();
 }
@@ -177,11 +213,11 @@ void Gfx_ClearColor(PackedCol color) {
 }
 
 void Gfx_SetDepthTest(cc_bool enabled) {
-	depthTest = enabled;
+	rast.depthTest = enabled;
 }
 
 void Gfx_SetDepthWrite(cc_bool enabled) {
-	depthWrite = enabled;
+	rast.depthWrite = enabled;
 }
 
 static void SetColorWrite(cc_bool r, cc_bool g, cc_bool b, cc_bool a) {
@@ -189,7 +225,7 @@ static void SetColorWrite(cc_bool r, cc_bool g, cc_bool b, cc_bool a) {
 }
 
 void Gfx_DepthOnlyRendering(cc_bool depthOnly) {
-	colWrite = !depthOnly;
+	rast.colWrite = !depthOnly;
 }
 
 
@@ -384,27 +420,17 @@ static CC_INLINE int FastFloor(float value) {
 
 #define edgeFunction(ax,ay, bx,by, cx,cy) (((bx) - (ax)) * ((cy) - (ay)) - ((by) - (ay)) * ((cx) - (ax)))
 
-static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+static void RasterTriangle2D(const Vertex* V0, const Vertex* V1, const Vertex* V2, const struct RastState* s,
+							int minX, int minY, int maxX, int maxY) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
-	int minX = min(x0, min(x1, x2));
-	int minY = min(y0, min(y1, y2));
-	int maxX = max(x0, max(x1, x2));
-	int maxY = max(y0, max(y1, y2));
 
 	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
-
-	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
 	float factor = 1.0f / area;
 
-	float u0 = V0->u * curTexWidth,  u1 = V1->u * curTexWidth,  u2 = V2->u * curTexWidth;
-	float v0 = V0->v * curTexHeight, v1 = V1->v * curTexHeight, v2 = V2->v * curTexHeight;
+	float u0 = V0->u * s->texWidth,  u1 = V1->u * s->texWidth,  u2 = V2->u * s->texWidth;
+	float v0 = V0->v * s->texHeight, v1 = V1->v * s->texHeight, v2 = V2->v * s->texHeight;
 	PackedCol color = V0->c;
 	
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
@@ -433,14 +459,14 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			int cb_index = y * cb_stride + x;
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (s->textured) {
 				float u = ic0 * u0 + ic1 * u1 + ic2 * u2;
 				float v = ic0 * v0 + ic1 * v1 + ic2 * v2;
-				int texX = ((int)u) & texWidthMask;
-				int texY = ((int)v) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)u) & s->texWidthMask;
+				int texY = ((int)v) & s->texHeightMask;
+				int texIndex = texY * s->texWidth + texX;
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = s->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -456,8 +482,8 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
-			if (gfx_alphaBlend) {
+			if (s->alphaTest && A < 0x80) continue;
+			if (s->alphaBlend) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -473,37 +499,143 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	}
 }
 
-static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
-	int x0 = (int)V0->x, y0 = (int)V0->y;
-	int x1 = (int)V1->x, y1 = (int)V1->y;
-	int x2 = (int)V2->x, y2 = (int)V2->y;
-	int minX = min(x0, min(x1, x2));
-	int minY = min(y0, min(y1, y2));
-	int maxX = max(x0, max(x1, x2));
-	int maxY = max(y0, max(y1, y2));
+#if defined SOFTGPU_SSE2 && defined SOFTGPU_SIMD
+typedef __m128  SimdFloat;
+typedef __m128i SimdInt;
+
+#define Simd_Set1F(value) _mm_set1_ps(value)
+#define Simd_AddF(a, b)   _mm_add_ps(a, b)
+#define Simd_MulF(a, b)   _mm_mul_ps(a, b)
+#define Simd_DivF(a, b)   _mm_div_ps(a, b)
+#define Simd_LoadF(ptr)   _mm_loadu_ps(ptr)
+#define Simd_StoreF(ptr, value) _mm_storeu_ps(ptr, value)
+#define Simd_LoadI(ptr)   _mm_loadu_si128((const __m128i*)(ptr))
+#define Simd_StoreI(ptr, value) _mm_storeu_si128((__m128i*)(ptr), value)
+#define Simd_Lanes()      _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f)
+
+/* Masks are stored as integer lanes, with all bits set for lanes that are to be drawn */
+#define Simd_GEqualF(a, b) _mm_castps_si128(_mm_cmpge_ps(a, b))
+#define Simd_LEqualF(a, b) _mm_castps_si128(_mm_cmple_ps(a, b))
+#define Simd_And(a, b)     _mm_and_si128(a, b)
+#define Simd_Any(mask)     _mm_movemask_epi8(mask)
+
+static CC_INLINE SimdFloat Simd_SelectF(SimdInt mask, SimdFloat a, SimdFloat b) {
+	__m128 m = _mm_castsi128_ps(mask);
+	return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
 
-	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	if (faceCulling) {
-		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
-		if (area < 0) return;
-	}
+static CC_INLINE SimdInt Simd_SelectI(SimdInt mask, SimdInt a, SimdInt b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
 
-	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
+/* Returns (int)(|value - floor(value)| * scale) & mask */
+static CC_INLINE SimdInt Simd_WrapCoord(SimdFloat value, float scale, int mask) {
+	__m128 floored = _mm_cvtepi32_ps(_mm_cvttps_epi32(value));
+	/* Truncation rounds negative values up instead of down */
+	floored = _mm_sub_ps(floored, _mm_and_ps(_mm_cmpgt_ps(floored, value), _mm_set1_ps(1.0f)));
 
-	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+	value = _mm_sub_ps(value, floored);
+	value = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+	return _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(value, _mm_set1_ps(scale))), _mm_set1_epi32(mask));
+}
+
+/* Returns (a * b) >> 8 for each 8 bit channel */
+static CC_INLINE SimdInt Simd_Modulate(SimdInt a, SimdInt b) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+	__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+/* Returns (src * A + dst * (255 - A)) >> 8 for each 8 bit channel */
+static CC_INLINE SimdInt Simd_Blend(SimdInt src, SimdInt dst) {
+	__m128i zero  = _mm_setzero_si128();
+	__m128i max   = _mm_set1_epi16(255);
+	__m128i srcLo = _mm_unpacklo_epi8(src, zero), srcHi = _mm_unpackhi_epi8(src, zero);
+	__m128i dstLo = _mm_unpacklo_epi8(dst, zero), dstHi = _mm_unpackhi_epi8(dst, zero);
+	/* Broadcast alpha of each pixel across all 4 of its channels */
+	__m128i aLo   = _mm_shufflehi_epi16(_mm_shufflelo_epi16(srcLo, 0xFF), 0xFF);
+	__m128i aHi   = _mm_shufflehi_epi16(_mm_shufflelo_epi16(srcHi, 0xFF), 0xFF);
+
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(srcLo, aLo), _mm_mullo_epi16(dstLo, _mm_sub_epi16(max, aLo)));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(srcHi, aHi), _mm_mullo_epi16(dstHi, _mm_sub_epi16(max, aHi)));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+/* Returns a mask of the pixels whose alpha is at least 0x80 */
+static CC_INLINE SimdInt Simd_AlphaTest(SimdInt color) {
+	return _mm_cmpgt_epi32(_mm_srli_epi32(color, 24), _mm_set1_epi32(0x7F));
+}
+
+#define Simd_SetColor(color) _mm_set1_epi32((int)(color))
+#define Simd_MakeOpaque(color) _mm_or_si128(color, _mm_set1_epi32((int)BITMAPCOLOR_A_MASK))
+#elif defined SOFTGPU_NEON && defined SOFTGPU_SIMD
+typedef float32x4_t SimdFloat;
+typedef uint32x4_t  SimdInt;
+
+#define Simd_Set1F(value) vdupq_n_f32(value)
+#define Simd_AddF(a, b)   vaddq_f32(a, b)
+#define Simd_MulF(a, b)   vmulq_f32(a, b)
+#define Simd_DivF(a, b)   vdivq_f32(a, b)
+#define Simd_LoadF(ptr)   vld1q_f32(ptr)
+#define Simd_StoreF(ptr, value) vst1q_f32(ptr, value)
+#define Simd_LoadI(ptr)   vld1q_u32((const uint32_t*)(ptr))
+#define Simd_StoreI(ptr, value) vst1q_u32((uint32_t*)(ptr), value)
+static const float simd_lanes[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+#define Simd_Lanes()      vld1q_f32(simd_lanes)
+
+/* Masks are stored as integer lanes, with all bits set for lanes that are to be drawn */
+#define Simd_GEqualF(a, b) vcgeq_f32(a, b)
+#define Simd_LEqualF(a, b) vcleq_f32(a, b)
+#define Simd_And(a, b)     vandq_u32(a, b)
+#define Simd_Any(mask)     vmaxvq_u32(mask)
+
+#define Simd_SelectF(mask, a, b) vbslq_f32(mask, a, b)
+#define Simd_SelectI(mask, a, b) vbslq_u32(mask, a, b)
+
+/* Returns (int)(|value - floor(value)| * scale) & mask */
+static CC_INLINE SimdInt Simd_WrapCoord(SimdFloat value, float scale, int mask) {
+	value = vabsq_f32(vsubq_f32(value, vrndmq_f32(value)));
+	return vandq_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(vmulq_n_f32(value, scale))), vdupq_n_u32(mask));
+}
+
+/* Returns (a * b) >> 8 for each 8 bit channel */
+static CC_INLINE SimdInt Simd_Modulate(SimdInt a, SimdInt b) {
+	uint8x16_t a8 = vreinterpretq_u8_u32(a), b8 = vreinterpretq_u8_u32(b);
+	uint8x8_t lo  = vshrn_n_u16(vmull_u8(vget_low_u8(a8),  vget_low_u8(b8)),  8);
+	uint8x8_t hi  = vshrn_n_u16(vmull_u8(vget_high_u8(a8), vget_high_u8(b8)), 8);
+	return vreinterpretq_u32_u8(vcombine_u8(lo, hi));
+}
+
+/* Returns (src * A + dst * (255 - A)) >> 8 for each 8 bit channel */
+static CC_INLINE SimdInt Simd_Blend(SimdInt src, SimdInt dst) {
+	/* Broadcast alpha of each pixel across all 4 of its channels */
+	uint8x16_t a8    = vreinterpretq_u8_u32(vmulq_n_u32(vshrq_n_u32(src, 24), 0x01010101));
+	uint8x16_t inv8  = vsubq_u8(vdupq_n_u8(255), a8);
+	uint8x16_t src8  = vreinterpretq_u8_u32(src), dst8 = vreinterpretq_u8_u32(dst);
+
+	uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(src8),  vget_low_u8(a8)),  vget_low_u8(dst8),  vget_low_u8(inv8));
+	uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(src8), vget_high_u8(a8)), vget_high_u8(dst8), vget_high_u8(inv8));
+	return vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+}
+
+/* Returns a mask of the pixels whose alpha is at least 0x80 */
+#define Simd_AlphaTest(color)  vcgtq_u32(vshrq_n_u32(color, 24), vdupq_n_u32(0x7F))
+
+#define Simd_SetColor(color)   vdupq_n_u32(color)
+#define Simd_MakeOpaque(color) vorrq_u32(color, vdupq_n_u32(BITMAPCOLOR_A_MASK))
+#endif
+
+static void RasterTriangle3D(const Vertex* V0, const Vertex* V1, const Vertex* V2, const struct RastState* s,
+							int minX, int minY, int maxX, int maxY) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
 
 	// NOTE: W in frag variables below is actually 1/W 
+	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
 	float factor = 1.0f / area;
 	float w0 = V0->w, w1 = V1->w, w2 = V2->w;
-	
-	// TODO proper clipping
-	if (w0 <= 0 || w1 <= 0 || w2 <= 0) {
-		return;
-	}
 
 	float z0 = V0->z, z1 = V1->z, z2 = V2->z;
 	float u0 = V0->u, u1 = V1->u, u2 = V2->u;
@@ -520,13 +652,93 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	float bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5f,minY+0.5f);
 	float bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5f,minY+0.5f);
 
+#ifdef SOFTGPU_SIMD
+	SimdFloat lanes   = Simd_Lanes();
+	SimdFloat vstep12 = Simd_MulF(lanes, Simd_Set1F((float)dx12));
+	SimdFloat vstep20 = Simd_MulF(lanes, Simd_Set1F((float)dx20));
+	SimdFloat vstep01 = Simd_MulF(lanes, Simd_Set1F((float)dx01));
+
+	SimdFloat vfactor = Simd_Set1F(factor), vzero = Simd_Set1F(0.0f), vone = Simd_Set1F(1.0f);
+	SimdFloat vw0 = Simd_Set1F(w0), vw1 = Simd_Set1F(w1), vw2 = Simd_Set1F(w2);
+	SimdFloat vz0 = Simd_Set1F(z0), vz1 = Simd_Set1F(z1), vz2 = Simd_Set1F(z2);
+	SimdFloat vu0 = Simd_Set1F(u0), vu1 = Simd_Set1F(u1), vu2 = Simd_Set1F(u2);
+	SimdFloat vv0 = Simd_Set1F(v0), vv1 = Simd_Set1F(v1), vv2 = Simd_Set1F(v2);
+	SimdInt vcolor = Simd_SetColor(BitmapCol_Make(PackedCol_R(color), PackedCol_G(color), 
+									PackedCol_B(color), PackedCol_A(color)));
+	#define Simd_Interp(a, b, c) Simd_AddF(Simd_AddF(Simd_MulF(ic0, a), Simd_MulF(ic1, b)), Simd_MulF(ic2, c))
+#endif
+
 	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01) 
 	{
 		float bc0 = bc0_start;
 		float bc1 = bc1_start;
 		float bc2 = bc2_start;
+		int x = minX;
 
-		for (int x = minX; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
+#ifdef SOFTGPU_SIMD
+		// Rasterise groups of 4 pixels at once, then the scalar loop below handles any remaining pixels
+		for (; rast_simd && x + 3 <= maxX; x += 4, bc0 += dx12 * 4, bc1 += dx20 * 4, bc2 += dx01 * 4) 
+		{
+			SimdFloat ic0 = Simd_MulF(Simd_AddF(Simd_Set1F(bc0), vstep12), vfactor);
+			SimdFloat ic1 = Simd_MulF(Simd_AddF(Simd_Set1F(bc1), vstep20), vfactor);
+			SimdFloat ic2 = Simd_MulF(Simd_AddF(Simd_Set1F(bc2), vstep01), vfactor);
+
+			SimdInt mask = Simd_And(Simd_And(Simd_GEqualF(ic0, vzero), Simd_GEqualF(ic1, vzero)), Simd_GEqualF(ic2, vzero));
+			if (!Simd_Any(mask)) continue;
+			int db_index = y * db_stride + x;
+
+			SimdFloat w = Simd_DivF(vone, Simd_Interp(vw0, vw1, vw2));
+			SimdFloat z = Simd_MulF(Simd_Interp(vz0, vz1, vz2), w);
+
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+			SimdFloat depth = Simd_LoadF(depthBuffer + db_index);
+			if (s->depthTest) {
+				mask = Simd_And(mask, Simd_And(Simd_GEqualF(z, vzero), Simd_LEqualF(z, depth)));
+				if (!Simd_Any(mask)) continue;
+			}
+			if (!s->colWrite) {
+				if (s->depthWrite) Simd_StoreF(depthBuffer + db_index, Simd_SelectF(mask, z, depth));
+				continue;
+			}
+#else
+			if (!s->colWrite) continue;
+#endif
+
+			SimdInt col = vcolor;
+			if (s->textured) {
+				SimdFloat u = Simd_MulF(Simd_Interp(vu0, vu1, vu2), w);
+				SimdFloat v = Simd_MulF(Simd_Interp(vv0, vv1, vv2), w);
+				int texX[4], texY[4];
+				BitmapCol texels[4];
+				Simd_StoreI(texX, Simd_WrapCoord(u, (float)s->texWidth,  s->texWidthMask));
+				Simd_StoreI(texY, Simd_WrapCoord(v, (float)s->texHeight, s->texHeightMask));
+
+				// No gather instruction, so fetch each texel individually
+				for (int i = 0; i < 4; i++) 
+				{
+					texels[i] = s->texPixels[texY[i] * s->texWidth + texX[i]];
+				}
+				col = Simd_Modulate(Simd_LoadI(texels), vcolor);
+			}
+
+			if (s->alphaTest) {
+				mask = Simd_And(mask, Simd_AlphaTest(col));
+				if (!Simd_Any(mask)) continue;
+			}
+			int cb_index = y * cb_stride + x;
+			SimdInt dst  = Simd_LoadI(colorBuffer + cb_index);
+
+			if (s->alphaBlend) col = Simd_Blend(col, dst);
+			col = Simd_MakeOpaque(col);
+
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+			if (s->depthWrite) Simd_StoreF(depthBuffer + db_index, Simd_SelectF(mask, z, depth));
+#endif
+			Simd_StoreI(colorBuffer + cb_index, Simd_SelectI(mask, col, dst));
+		}
+#endif
+
+		for (; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
 		{
 			float ic0 = bc0 * factor;
 			float ic1 = bc1 * factor;
@@ -538,24 +750,24 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			float z = (ic0 * z0 + ic1 * z1 + ic2 * z2) * w;
 
 #ifndef SOFTGPU_DISABLE_ZBUFFER
-			if (depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
-			if (!colWrite) {
-				if (depthWrite) depthBuffer[db_index] = z;
+			if (s->depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
+			if (!s->colWrite) {
+				if (s->depthWrite) depthBuffer[db_index] = z;
 				continue;
 			}
 #else
-			if (!colWrite) continue;
+			if (!s->colWrite) continue;
 #endif
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (s->textured) {
 				float u = (ic0 * u0 + ic1 * u1 + ic2 * u2) * w;
 				float v = (ic0 * v0 + ic1 * v1 + ic2 * v2) * w;
-				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * curTexWidth )) & texWidthMask;
-				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * curTexHeight)) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * s->texWidth )) & s->texWidthMask;
+				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * s->texHeight)) & s->texHeightMask;
+				int texIndex = texY * s->texWidth + texX;
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = s->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -571,10 +783,10 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
+			if (s->alphaTest && A < 0x80) continue;
 			int cb_index = y * cb_stride + x;
 			
-			if (gfx_alphaBlend) {
+			if (s->alphaBlend) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -586,11 +798,295 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			}
 
 #ifndef SOFTGPU_DISABLE_ZBUFFER
-			if (depthWrite) depthBuffer[db_index] = z;
+			if (s->depthWrite) depthBuffer[db_index] = z;
 #endif
 			colorBuffer[cb_index] = BitmapCol_Make(R, G, B, 0xFF);
 		}
 	}
+#ifdef SOFTGPU_SIMD
+	#undef Simd_Interp
+#endif
+}
+
+static void RasterTriangle(const Vertex* V0, const Vertex* V1, const Vertex* V2, const struct RastState* s,
+							cc_bool is2D, int minX, int minY, int maxX, int maxY) {
+	if (is2D) {
+		RasterTriangle2D(V0, V1, V2, s, minX, minY, maxX, maxY);
+	} else {
+		RasterTriangle3D(V0, V1, V2, s, minX, minY, maxX, maxY);
+	}
+}
+
+
+#ifdef SOFTGPU_BINNING
+/*########################################################################################################################*
+*----------------------------------------------------Tiled rasterisation--------------------------------------------------*
+*#########################################################################################################################*/
+/* Triangles are transformed on the main thread, and then binned into the screen tiles that they overlap. */
+/* Once a batch of triangles has been binned, the tiles are rasterised in parallel by a pool of worker */
+/*  threads (with the main thread also helping out). Each tile is only rasterised by one thread, and */
+/*  triangles are rasterised in the order they were drawn, so the result is identical to drawing each */
+/*  triangle immediately. Tiles are disjoint regions of the framebuffer, so need no locking either. */
+#define BIN_TILE_SHIFT 6
+#define BIN_TILE_SIZE (1 << BIN_TILE_SHIFT)
+/* NOTE: Must be <= 65536, as tiles store triangle indices as cc_uint16 */
+#define BIN_MAX_TRIS 16384
+#define BIN_MAX_THREADS 16
+
+struct BinnedTri {
+	Vertex v[3];
+	struct RastState state;
+	int minX, minY, maxX, maxY;
+	cc_bool is2D;
+};
+struct BinTile { cc_uint16* tris; int count, capacity; };
+
+static struct BinnedTri* bin_tris;
+static int bin_trisCount;
+static struct BinTile* bin_tiles;
+static int bin_tilesX, bin_tilesY;
+
+static int bin_workersCount, bin_workersStarted, bin_workersBusy;
+static int bin_nextTile;
+static void* bin_threads[BIN_MAX_THREADS];
+static void* bin_wakeups[BIN_MAX_THREADS];
+static void* bin_mutex;
+static void* bin_finished;
+static cc_bool bin_quit;
+
+static void Bin_AddTriangle(Vertex* V0, Vertex* V1, Vertex* V2, cc_bool is2D, 
+							int minX, int minY, int maxX, int maxY) {
+	struct BinnedTri* tri;
+	struct BinTile* tile;
+	int x, y, index;
+	int tileMaxX = min(maxX >> BIN_TILE_SHIFT, bin_tilesX - 1);
+	int tileMaxY = min(maxY >> BIN_TILE_SHIFT, bin_tilesY - 1);
+
+	if (bin_trisCount == BIN_MAX_TRIS) Bin_Flush();
+	index = bin_trisCount++;
+	tri   = &bin_tris[index];
+
+	tri->v[0]  = *V0; tri->v[1] = *V1; tri->v[2] = *V2;
+	tri->state = rast;
+	tri->is2D  = is2D;
+	tri->minX  = minX; tri->minY = minY;
+	tri->maxX  = maxX; tri->maxY = maxY;
+
+	for (y = minY >> BIN_TILE_SHIFT; y <= tileMaxY; y++)
+	{
+		for (x = minX >> BIN_TILE_SHIFT; x <= tileMaxX; x++)
+		{
+			tile = &bin_tiles[y * bin_tilesX + x];
+
+			if (tile->count == tile->capacity) {
+				tile->capacity = tile->capacity ? tile->capacity * 2 : 64;
+				tile->tris     = (cc_uint16*)Mem_Realloc(tile->tris, tile->capacity, 2, "binned triangles");
+			}
+			tile->tris[tile->count++] = index;
+		}
+	}
+}
+
+static void Bin_RasterTile(int index) {
+	struct BinTile* tile = &bin_tiles[index];
+	struct BinnedTri* tri;
+	int minX = (index % bin_tilesX) << BIN_TILE_SHIFT;
+	int minY = (index / bin_tilesX) << BIN_TILE_SHIFT;
+	int maxX = minX + BIN_TILE_SIZE - 1;
+	int maxY = minY + BIN_TILE_SIZE - 1;
+	int i;
+
+	for (i = 0; i < tile->count; i++)
+	{
+		tri = &bin_tris[tile->tris[i]];
+		RasterTriangle(&tri->v[0], &tri->v[1], &tri->v[2], &tri->state, tri->is2D,
+						max(tri->minX, minX), max(tri->minY, minY),
+						min(tri->maxX, maxX), min(tri->maxY, maxY));
+	}
+	tile->count = 0;
+}
+
+/* Rasterises tiles until there are none left */
+static void Bin_RunTiles(void) {
+	int tile, tilesCount = bin_tilesX * bin_tilesY;
+
+	for (;;) {
+		Mutex_Lock(bin_mutex);
+		tile = bin_nextTile < tilesCount ? bin_nextTile++ : -1;
+		Mutex_Unlock(bin_mutex);
+		if (tile < 0) return;
+
+		if (bin_tiles[tile].count) Bin_RasterTile(tile);
+	}
+}
+
+static void Bin_WorkerLoop(void) {
+	void* wakeup;
+	Mutex_Lock(bin_mutex);
+	wakeup = bin_wakeups[bin_workersStarted++];
+	Mutex_Unlock(bin_mutex);
+
+	for (;;) {
+		Waitable_Wait(wakeup);
+		if (bin_quit) return;
+		Bin_RunTiles();
+
+		Mutex_Lock(bin_mutex);
+		if (--bin_workersBusy == 0) Waitable_Signal(bin_finished);
+		Mutex_Unlock(bin_mutex);
+	}
+}
+
+static void Bin_Flush(void) {
+	int i, busy;
+	if (!bin_trisCount) return;
+
+	bin_workersBusy = bin_workersCount;
+	bin_nextTile    = 0;
+
+	for (i = 0; i < bin_workersCount; i++) {
+		Waitable_Signal(bin_wakeups[i]);
+	}
+	Bin_RunTiles();
+
+	for (;;) {
+		Mutex_Lock(bin_mutex);
+		busy = bin_workersBusy;
+		Mutex_Unlock(bin_mutex);
+
+		if (!busy) break;
+		Waitable_Wait(bin_finished);
+	}
+	bin_trisCount = 0;
+}
+
+static void Bin_FreeTiles(void) {
+	int i;
+	if (!bin_tiles) return;
+
+	for (i = 0; i < bin_tilesX * bin_tilesY; i++) {
+		Mem_Free(bin_tiles[i].tris);
+	}
+	Mem_Free(bin_tiles);
+	bin_tiles = NULL;
+}
+
+static void Bin_Resize(void) {
+	if (!bin_workersCount) return;
+	Bin_FreeTiles();
+
+	bin_tilesX = Math_CeilDiv(fb_width,  BIN_TILE_SIZE);
+	bin_tilesY = Math_CeilDiv(fb_height, BIN_TILE_SIZE);
+	bin_tiles  = (struct BinTile*)Mem_AllocCleared(bin_tilesX * bin_tilesY, sizeof(struct BinTile), "screen tiles");
+}
+
+static void Bin_Start(void) {
+	int i;
+	bin_workersCount = Options_GetInt(OPT_SOFTGPU_WORKERS, 0, BIN_MAX_THREADS, 3);
+	if (!bin_workersCount) return;
+
+	bin_mutex    = Mutex_Create("Raster workers");
+	bin_finished = Waitable_Create("Raster workers finished");
+	bin_tris     = (struct BinnedTri*)Mem_Alloc(BIN_MAX_TRIS, sizeof(struct BinnedTri), "binned triangles");
+
+	for (i = 0; i < bin_workersCount; i++) {
+		bin_wakeups[i] = Waitable_Create("Raster worker wakeup");
+	}
+	for (i = 0; i < bin_workersCount; i++) {
+		Thread_Run(&bin_threads[i], Bin_WorkerLoop, 256 * 1024, "Raster worker");
+	}
+	if (fb_width) Bin_Resize();
+}
+
+static void Bin_Stop(void) {
+	int i;
+	if (!bin_workersCount) return;
+	Bin_Flush();
+	bin_quit = true;
+
+	for (i = 0; i < bin_workersCount; i++) {
+		Waitable_Signal(bin_wakeups[i]);
+	}
+	for (i = 0; i < bin_workersCount; i++) {
+		Thread_Join(bin_threads[i]);
+		Waitable_Free(bin_wakeups[i]);
+	}
+
+	Bin_FreeTiles();
+	Mem_Free(bin_tris);
+	Mutex_Free(bin_mutex);
+	Waitable_Free(bin_finished);
+
+	bin_tris = NULL;
+	bin_workersCount   = 0;
+	bin_workersStarted = 0;
+	bin_quit = false;
+}
+#else
+static void Bin_Flush(void)  { }
+static void Bin_Start(void)  { }
+static void Bin_Stop(void)   { }
+static void Bin_Resize(void) { }
+#endif
+
+static void SubmitTriangle(Vertex* V0, Vertex* V1, Vertex* V2, cc_bool is2D, 
+							int minX, int minY, int maxX, int maxY) {
+#ifdef SOFTGPU_BINNING
+	if (bin_tiles) {
+		Bin_AddTriangle(V0, V1, V2, is2D, minX, minY, maxX, maxY); return;
+	}
+#endif
+	RasterTriangle(V0, V1, V2, &rast, is2D, minX, minY, maxX, maxY);
+}
+
+static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+
+	// Reject triangles completely outside
+	if (maxX < 0 || minX > fb_maxX) return;
+	if (maxY < 0 || minY > fb_maxY) return;
+
+	// Perform scissoring
+	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
+	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+
+	SubmitTriangle(V0, V1, V2, true, minX, minY, maxX, maxY);
+}
+
+static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+
+	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
+	if (faceCulling) {
+		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
+		if (area < 0) return;
+	}
+
+	// Reject triangles completely outside
+	if (maxX < 0 || minX > fb_maxX) return;
+	if (maxY < 0 || minY > fb_maxY) return;
+
+	// Perform scissoring
+	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
+	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+	
+	// TODO proper clipping
+	if (V0->w <= 0 || V1->w <= 0 || V2->w <= 0) {
+		return;
+	}
+	SubmitTriangle(V0, V1, V2, false, minX, minY, maxX, maxY);
 }
 
 #define V0_VIS (1 << 0)
@@ -903,6 +1399,7 @@ void DrawQuads(int startVertex, int verticesCount) {
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
+	rast.textured = fmt == VERTEX_FORMAT_TEXTURED;
 }
 
 void Gfx_DrawVb_Lines(int verticesCount) { } /* TODO */
@@ -929,6 +1426,7 @@ static BitmapCol* CB_GetRow(struct Bitmap* bmp, int y, void* ctx) {
 
 cc_result Gfx_TakeScreenshot(struct Stream* output) {
 	struct Bitmap bmp;
+	Bin_Flush();
 	Bitmap_Init(bmp, fb_width, fb_height, NULL);
 	return Png_Encode(&bmp, output, CB_GetRow, false, NULL);
 }
@@ -940,6 +1438,7 @@ void Gfx_BeginFrame(void) { }
 
 void Gfx_EndFrame(void) {
 	Rect2D r = { 0, 0, fb_width, fb_height };
+	Bin_Flush();
 	Window_DrawFramebuffer(r, &fb_bmp);
 }
 
@@ -948,6 +1447,7 @@ void Gfx_SetVSync(cc_bool vsync) {
 }
 
 void Gfx_OnWindowResize(void) {
+	Bin_Flush();
 	if (depthBuffer) DestroyBuffers();
 
 	fb_width   = Game.Width;
@@ -964,6 +1464,7 @@ void Gfx_OnWindowResize(void) {
 
 	Gfx_SetViewport(0, 0, Game.Width, Game.Height);
 	Gfx_SetScissor (0, 0, Game.Width, Game.Height);
+	Bin_Resize();
 }
 
 void Gfx_SetViewport(int x, int y, int w, int h) {
@@ -977,6 +1478,40 @@ void Gfx_SetScissor (int x, int y, int w, int h) {
 	fb_maxY = y + h - 1;
 }
 
+void Gfx_BeginScaledScene(int width, int height) {
+	Bin_Flush();
+	Gfx_SetViewport(0, 0, width, height);
+	Gfx_SetScissor (0, 0, width, height);
+}
+
+void Gfx_EndScaledScene(int width, int height) {
+	int x, y, srcX, stepX, stepY;
+	BitmapCol* src;
+	BitmapCol* dst;
+	Bin_Flush();
+
+	width  = min(width,  fb_width);
+	height = min(height, fb_height);
+	stepX  = (width  << 16) / fb_width;
+	stepY  = (height << 16) / fb_height;
+
+	/* Upscale in place, starting from the bottom right corner so that */
+	/*  source pixels are always read before they can be overwritten */
+	for (y = fb_height - 1; y >= 0; y--)
+	{
+		src = colorBuffer + ((y * stepY) >> 16) * cb_stride;
+		dst = colorBuffer + y * cb_stride;
+
+		for (x = fb_width - 1, srcX = x * stepX; x >= 0; x--, srcX -= stepX)
+		{
+			dst[x] = src[srcX >> 16];
+		}
+	}
+
+	Gfx_SetViewport(0, 0, fb_width, fb_height);
+	Gfx_SetScissor (0, 0, fb_width, fb_height);
+}
+
 void Gfx_GetApiInfo(cc_string* info) {
 	int pointerSize = sizeof(void*) * 8;
 	String_Format1(info, "-- Using software (%i bit) --\n", &pointerSize);
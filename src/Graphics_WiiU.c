@@ -23,6 +23,7 @@
 #include <coreinit/memdefaultheap.h>
 #include "../build-wiiu/coloured_gsh.h"
 #include "../build-wiiu/textured_gsh.h"
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 static WHBGfxShaderGroup colorShader;
 static WHBGfxShaderGroup textureShader;
@@ -5,6 +5,7 @@
 #include "Logger.h"
 #include "Window.h"
 #include <pbkit/pbkit.h>
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 
 #define MAX_RAM_ADDR 0x03FFAFFF
 #define MASK(mask, val) (((val) << (__builtin_ffs(mask)-1)) & (mask))
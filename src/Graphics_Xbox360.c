@@ -10,6 +10,7 @@
 #include "../misc/xbox360/vs_coloured.h"
 #include "../misc/xbox360/ps_textured.h"
 #include "../misc/xbox360/vs_textured.h"
+#define MEM_SUBSYSTEM MEM_SYS_GFX
 static struct XenosShader* shdr_tex_vs;
 static struct XenosShader* shdr_tex_ps;
 static struct XenosShader* shdr_col_vs;
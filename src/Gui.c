@@ -18,6 +18,7 @@
 #include "Server.h"
 #include "TexturePack.h"
 #include "InputHandler.h"
+#define MEM_SUBSYSTEM MEM_SYS_UI
 
 struct _GuiData Gui;
 struct Screen* Gui_Screens[GUI_MAX_SCREENS];
@@ -334,6 +335,8 @@ void Gui_RenderGui(float delta) {
 	struct Screen* s;
 	int i;
 
+	Gui.Draw2DCalls = Gfx.Draw2DCalls;
+	Gfx.Draw2DCalls = 0;
 	Gfx_3DS_SetRenderScreen(BOTTOM_SCREEN);
 #ifdef CC_BUILD_DUALSCREEN
 	Texture_Render(&touchBgTex);
@@ -430,6 +433,103 @@ void TextAtlas_AddInt(struct TextAtlas* atlas, int value, struct VertexTextured*
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------GlyphAtlas--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Maximum width of a row of glyphs in the atlas */
+#define GLYPHATLAS_ROW_WIDTH 512
+
+void GlyphAtlas_Make(struct GlyphAtlas* atlas, struct FontDesc* font) {
+	struct DrawTextArgs args;
+	struct Context2D ctx;
+	char chars[2]; cc_string str;
+	int i, x = 0, y = 0, width = 0;
+	int cellWidth, singleWidth;
+
+	Gfx_DeleteTexture(&atlas->tex.ID);
+	str = String_Init(chars, 2, 2);
+	DrawTextArgs_Make(&args, &str, font, true);
+	atlas->height = Drawer2D_TextHeight(&args);
+
+	for (i = 0; i < GLYPHATLAS_COUNT; i++)
+	{
+		chars[0] = chars[1] = (char)(GLYPHATLAS_FIRST + i);
+		args.text.length = 1;
+		args.useShadow   = true;
+		cellWidth = Drawer2D_TextWidth(&args);
+
+		/* Unlike width of a single character, advance also includes the spacing between characters */
+		args.useShadow = false;
+		singleWidth    = Drawer2D_TextWidth(&args);
+		args.text.length = 2;
+		atlas->advances[i] = Drawer2D_TextWidth(&args) - singleWidth;
+
+		if (x && x + cellWidth > GLYPHATLAS_ROW_WIDTH) { x = 0; y += atlas->height; }
+		atlas->xs[i]     = x;
+		atlas->ys[i]     = y;
+		atlas->widths[i] = cellWidth;
+		/* add 1 pixel of padding */
+		x    += cellWidth + 1;
+		width = max(width, x);
+	}
+
+	Context2D_Alloc(&ctx, width, y + atlas->height);
+	{
+		args.text.length = 1;
+		args.useShadow   = true;
+
+		for (i = 0; i < GLYPHATLAS_COUNT; i++)
+		{
+			chars[0] = (char)(GLYPHATLAS_FIRST + i);
+			Context2D_DrawText(&ctx, &args, atlas->xs[i], atlas->ys[i]);
+		}
+		Context2D_MakeTexture(&atlas->tex, &ctx);
+	}
+	Context2D_Free(&ctx);
+
+	atlas->uScale = 1.0f / (float)ctx.bmp.width;
+	atlas->vScale = 1.0f / (float)ctx.bmp.height;
+}
+
+void GlyphAtlas_Free(struct GlyphAtlas* atlas) { Gfx_DeleteTexture(&atlas->tex.ID); }
+
+int GlyphAtlas_Add(struct GlyphAtlas* atlas, const cc_string* text, int x, int y, struct VertexTextured** vertices) {
+	struct Texture part = atlas->tex;
+	/* Glyphs are drawn in the default color, so only color codes need tinting */
+	PackedCol color = PACKEDCOL_WHITE;
+	BitmapCol col;
+	int i, c, count = 0;
+
+	part.y      = y;
+	part.height = atlas->height;
+
+	for (i = 0; i < text->length; i++)
+	{
+		c = (cc_uint8)text->buffer[i];
+		if (c == '&' && Drawer2D_ValidColorCodeAt(text, i + 1)) {
+			col   = Drawer2D_GetColor(text->buffer[i + 1]);
+			color = PackedCol_Make(BitmapCol_R(col), BitmapCol_G(col), BitmapCol_B(col), 255);
+			i++; continue; /* skip over the color code */
+		}
+
+		c -= GLYPHATLAS_FIRST;
+		if (c < 0 || c >= GLYPHATLAS_COUNT) continue;
+
+		part.x     = x;
+		part.width = atlas->widths[c];
+		part.uv.u1 = atlas->xs[c] * atlas->uScale;
+		part.uv.u2 = part.uv.u1   + part.width  * atlas->uScale;
+		part.uv.v1 = atlas->ys[c] * atlas->vScale;
+		part.uv.v2 = part.uv.v1   + part.height * atlas->vScale;
+
+		Gfx_Make2DQuad(&part, color, vertices);
+		x += atlas->advances[c];
+		count++;
+	}
+	return count;
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------Widget base-------------------------------------------------------*
 *#########################################################################################################################*/
@@ -68,6 +68,8 @@ CC_VAR extern struct _GuiData {
 	float BarSize;
 	/* The color of the cinematic bars, if enabled. */
 	PackedCol CinematicBarColor;
+	/* Number of 2D draw calls made while rendering the GUI in the previous frame. */
+	int Draw2DCalls;
 } Gui;
 
 #ifdef CC_BUILD_TOUCH
@@ -298,6 +300,25 @@ void TextAtlas_Free(struct TextAtlas* atlas);
 void TextAtlas_Add(struct TextAtlas* atlas, int charI, struct VertexTextured** vertices);
 void TextAtlas_AddInt(struct TextAtlas* atlas, int value, struct VertexTextured** vertices);
 
+/* Atlas of all the printable ASCII characters (' ' to '~') drawn using a font */
+/* Allows frequently changing text to be drawn as a quad per character, instead of */
+/*  needing to rasterise the whole text into a new texture whenever it changes */
+#define GLYPHATLAS_FIRST ' '
+#define GLYPHATLAS_COUNT 95
+struct GlyphAtlas {
+	struct Texture tex;
+	float uScale, vScale;
+	short height;
+	short xs[GLYPHATLAS_COUNT], ys[GLYPHATLAS_COUNT];
+	short widths[GLYPHATLAS_COUNT], advances[GLYPHATLAS_COUNT];
+};
+void GlyphAtlas_Make(struct GlyphAtlas* atlas, struct FontDesc* font);
+void GlyphAtlas_Free(struct GlyphAtlas* atlas);
+/* Adds a quad for each character in the given text, with color codes applied as vertex colors */
+/* NOTE: Characters outside the atlas are skipped */
+/* Returns the number of quads added */
+int  GlyphAtlas_Add(struct GlyphAtlas* atlas, const cc_string* text, int x, int y, struct VertexTextured** vertices);
+
 #define Elem_Render(elem, delta) (elem)->VTABLE->Render(elem, delta)
 #define Elem_Free(elem)          (elem)->VTABLE->Free(elem)
 #define Elem_HandlesKeyPress(elem, key) (elem)->VTABLE->HandlesKeyPress(elem, key)
@@ -15,6 +15,7 @@ cc_bool HeldBlockRenderer_Show;
 static BlockID held_block;
 static struct Entity held_entity;
 static struct Matrix held_blockProj;
+static struct BlockModelMesh held_mesh;
 
 static cc_bool held_animating, held_breaking, held_swinging;
 static float held_swingY;
@@ -38,9 +39,9 @@ static void HeldBlockRenderer_RenderModel(void) {
 	Gfx_SetFaceCulling(true);
 	Gfx_SetDepthTest(false);
 	/* Gfx_SetDepthWrite(false); */
-	/* TODO: Need to properly reallocate per model VB here */
 
 	if (Blocks.Draw[held_block] == DRAW_GAS) {
+		/* TODO: Need to properly reallocate per model VB here */
 		model = Entities.CurPlayer->Base.Model;
 		SetHeldModel(model);
 		Vec3_Set(held_entity.ModelScale, 1.0f, 1.0f, 1.0f);
@@ -49,12 +50,10 @@ static void HeldBlockRenderer_RenderModel(void) {
 		Gfx_SetAlphaTest(false);
 	}
 	else {
-		model = Models.Block;
-		SetHeldModel(model);
 		Vec3_Set(held_entity.ModelScale, 0.4f, 0.4f, 0.4f);
 
 		Gfx_SetupAlphaState(Blocks.Draw[held_block]);
-		Model_Render(model, &held_entity);
+		BlockModel_RenderCached(&held_entity, &held_mesh);
 		Gfx_RestoreAlphaState(Blocks.Draw[held_block]);
 	}
 	
@@ -244,8 +243,12 @@ void HeldBlockRenderer_Render(float delta) {
 
 static void OnContextLost(void* obj) {
 	Gfx_DeleteDynamicVb(&held_entity.ModelVB);
+	Gfx_DeleteDynamicVb(&held_mesh.vb);
+	held_mesh.valid = false;
 }
 
+static void InvalidateMesh(void* obj) { held_mesh.valid = false; }
+
 static const struct EntityVTABLE heldEntity_VTABLE = {
 	NULL, NULL, NULL, HeldBlockRenderer_GetCol,
 	NULL, NULL
@@ -262,6 +265,8 @@ static void OnInit(void) {
 	Event_Register_(&UserEvents.HeldBlockChanged, NULL, DoSwitchBlockAnim);
 	Event_Register_(&UserEvents.BlockChanged,     NULL, OnBlockChanged);
 	Event_Register_(&GfxEvents.ContextLost,       NULL, OnContextLost);
+	Event_Register_(&TextureEvents.AtlasChanged,  NULL, InvalidateMesh);
+	Event_Register_(&BlockEvents.BlockDefChanged, NULL, InvalidateMesh);
 }
 #else
 void HeldBlockRenderer_ClickAnim(cc_bool digging) { }
@@ -16,6 +16,9 @@ struct StringsBuffer;
 #define URL_MAX_SIZE (STRING_SIZE * 2)
 #define HTTP_FLAG_PRIORITY 0x01
 #define HTTP_FLAG_NOCACHE  0x02
+/* Response is cached on disk, and later requests for the same URL revalidate it */
+/* NOTE: Only intended for small and mostly static responses (e.g. skins) */
+#define HTTP_FLAG_CACHE    0x04
 
 extern struct IGameComponent Http_Component;
 
@@ -46,6 +49,8 @@ struct HttpRequest {
 	cc_uint8 requestType;           /* See the various REQUEST_TYPE_ */
 	cc_bool success;                /* Whether Result is 0, status is 200, and data is not NULL */
 	struct StringsBuffer* cookies;  /* Cookie list sent in requests. May be modified by the response. */
+	cc_uint8 flags;                 /* See the various HTTP_FLAG_ */
+	int _maxAge;                    /* (private) Cache-Control max-age of the response */
 };
 
 /* Frees all dynamically allocated data from a HTTP request */
@@ -3,6 +3,7 @@
 #include "_HttpBase.h"
 #include <emscripten/emscripten.h>
 #include "Errors.h"
+#define MEM_SUBSYSTEM MEM_SYS_HTTP
 extern int interop_DownloadAsync(const char* url, int method, int reqID);
 extern int interop_IsHttpsOnly(void);
 static struct RequestList workingReqs, queuedReqs;
@@ -1,6 +1,7 @@
 #include "Core.h"
 #ifndef CC_BUILD_WEB
 #include "_HttpBase.h"
+#define MEM_SUBSYSTEM MEM_SYS_HTTP
 
 /* Allocates initial data buffer to store response contents */
 static void Http_BufferInit(struct HttpRequest* req) {
@@ -15,7 +16,8 @@ static void Http_BufferEnsure(struct HttpRequest* req, cc_uint32 amount) {
 	cc_uint32 newSize = req->size + amount;
 	if (newSize <= req->_capacity) return;
 
-	req->_capacity = newSize;
+	/* Grow geometrically, as e.g. chunked responses don't report their total size upfront */
+	req->_capacity = max(newSize, req->_capacity * 2);
 	req->data      = (cc_uint8*)Mem_Realloc(req->data, newSize, 1, "http data+");
 }
 
@@ -49,6 +51,23 @@ static void Http_ParseContentLength(struct HttpRequest* req, const cc_string* va
 	req->contentLength = contentLen;
 }
 
+/* e.g. "public, max-age=3600" */
+static void Http_ParseCacheControl(struct HttpRequest* req, const cc_string* value) {
+	cc_string maxAge;
+	int i;
+	if (String_ContainsConst(value, "no-store")) req->flags &= ~HTTP_FLAG_CACHE;
+	if (String_ContainsConst(value, "no-cache")) return;
+
+	i = String_IndexOfConst(value, "max-age=");
+	if (i < 0) return;
+
+	maxAge = String_UNSAFE_SubstringAt(value, i + 8);
+	i = String_IndexOf(&maxAge, ',');
+	if (i >= 0) maxAge.length = i;
+
+	if (!Convert_ParseInt(&maxAge, &req->_maxAge) || req->_maxAge < 0) req->_maxAge = 0;
+}
+
 /* Parses a HTTP header */
 static void Http_ParseHeader(struct HttpRequest* req, const cc_string* line) {
 	static const cc_string httpVersion = String_FromConst("HTTP");
@@ -73,6 +92,8 @@ static void Http_ParseHeader(struct HttpRequest* req, const cc_string* line) {
 		Http_ParseContentLength(req, &value);
 	} else if (String_CaselessEqualsConst(&name, "Last-Modified")) {
 		String_CopyToRawArray(req->lastModified, &value);
+	} else if (String_CaselessEqualsConst(&name, "Cache-Control")) {
+		Http_ParseCacheControl(req, &value);
 	} else if (req->cookies && String_CaselessEqualsConst(&name, "Set-Cookie")) {
 		Http_ParseCookie(req, &value);
 	}
@@ -527,41 +548,99 @@ static struct ConnectionPoolEntry {
 	cc_string addr;
 	char addrBuffer[STRING_SIZE];
 	cc_bool https;
+	cc_bool inUse; /* Whether a worker is currently using this connection */
+	int keepAlive; /* Seconds the server keeps the connection open when idle (0 if unknown) */
+	cc_uint64 lastUsed;
 } connection_pool[10];
+static void* poolMutex;
 
-static cc_result ConnectionPool_Insert(int i, struct HttpConnection** conn, const struct HttpUrl* url) {
-	struct ConnectionPoolEntry* e = &connection_pool[i];
-	*conn = &e->conn;
-
-	String_InitArray(e->addr, e->addrBuffer);
-	String_Copy(&e->addr, &url->address);
-	e->https = url->https;
-	return HttpConnection_Open(&e->conn, url);
+/* Returns whether the server has likely already closed the idle connection */
+static cc_bool ConnectionPool_IsStale(struct ConnectionPoolEntry* e, cc_uint64 now) {
+	/* Leave a second of leeway, as the server may close the connection slightly early */
+	return e->keepAlive && Stopwatch_ElapsedMS(e->lastUsed, now) >= (e->keepAlive - 1) * 1000;
 }
 
-static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+/* Finds an entry not in use by other workers, preferring an open connection to the same address */
+static struct ConnectionPoolEntry* ConnectionPool_Find(const struct HttpUrl* url, cc_bool* reused) {
+	cc_uint64 now = Stopwatch_Measure();
 	struct ConnectionPoolEntry* e;
-	int i;
+	int i, j;
+	*reused = false;
 
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (e->conn.valid && e->https == url->https && String_Equals(&e->addr, &url->address)) {
-			*conn = &connection_pool[i].conn;
-			return 0;
+		if (e->inUse || !e->conn.valid) continue;
+
+		/* Avoid a wasted round trip that would just fail with SocketDropped */
+		if (ConnectionPool_IsStale(e, now)) {
+			HttpConnection_Close(&e->conn); continue;
+		}
+		if (e->https == url->https && String_Equals(&e->addr, &url->address)) {
+			*reused = true; return e;
 		}
 	}
 
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (!e->conn.valid) return ConnectionPool_Insert(i, conn, url);
+		if (!e->inUse && !e->conn.valid) return e;
 	}
 
 	/* TODO: Should we be consistent in which entry gets evicted? */
-	i = (cc_uint8)Stopwatch_Measure() % Array_Elems(connection_pool);
-	HttpConnection_Close(&connection_pool[i].conn);
-	return ConnectionPool_Insert(i, conn, url);
+	/* NOTE: There are always fewer workers than pool entries, so an unused entry always exists */
+	j = (cc_uint8)now % Array_Elems(connection_pool);
+	for (i = 0; i < Array_Elems(connection_pool); i++)
+	{
+		e = &connection_pool[(i + j) % Array_Elems(connection_pool)];
+		if (e->inUse) continue;
+
+		HttpConnection_Close(&e->conn);
+		return e;
+	}
+	return &connection_pool[j];
+}
+
+static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+	struct ConnectionPoolEntry* e;
+	cc_bool reused;
+
+	Mutex_Lock(poolMutex);
+	{
+		e = ConnectionPool_Find(url, &reused);
+		e->inUse = true;
+	}
+	Mutex_Unlock(poolMutex);
+
+	*conn = &e->conn;
+	if (reused) return 0;
+
+	/* Connecting is done outside the lock so other workers aren't blocked by it */
+	String_InitArray(e->addr, e->addrBuffer);
+	String_Copy(&e->addr, &url->address);
+	e->https     = url->https;
+	e->keepAlive = 0;
+	return HttpConnection_Open(&e->conn, url);
+}
+
+/* Makes the given connection available for other workers to reuse */
+static void ConnectionPool_Release(struct HttpConnection* conn, int keepAlive) {
+	struct ConnectionPoolEntry* e;
+	int i;
+
+	Mutex_Lock(poolMutex);
+	{
+		for (i = 0; i < Array_Elems(connection_pool); i++)
+		{
+			e = &connection_pool[i];
+			if (&e->conn != conn) continue;
+
+			e->inUse     = false;
+			e->lastUsed  = Stopwatch_Measure();
+			if (keepAlive) e->keepAlive = keepAlive;
+		}
+	}
+	Mutex_Unlock(poolMutex);
 }
 
 
@@ -588,6 +667,7 @@ struct HttpClientState {
 	cc_uint32 dataLeft; /* Number of bytes still to read from the current chunk or body */
 	int chunked;
 	cc_bool autoClose;
+	int keepAlive; /* Idle timeout from the Keep-Alive header (0 if not sent) */
 	cc_string header, location;
 	struct HttpUrl url;
 	char _headerBuffer[HTTP_HEADER_MAX_LENGTH];
@@ -599,6 +679,7 @@ static void HttpClientState_Reset(struct HttpClientState* state) {
 	state->chunked     = 0;
 	state->dataLeft    = 0;
 	state->autoClose   = false;
+	state->keepAlive   = 0;
 	String_InitArray(state->header,   state->_headerBuffer);
 	String_InitArray(state->location, state->_locationBuffer);
 }
@@ -645,6 +726,19 @@ static cc_result HttpClient_SendRequest(struct HttpClientState* state) {
 }
 
 
+/* e.g. "timeout=5, max=100" */
+static void HttpClient_ParseKeepAlive(struct HttpClientState* state, const cc_string* value) {
+	cc_string timeout;
+	int i = String_IndexOfConst(value, "timeout=");
+	if (i < 0) return;
+
+	timeout = String_UNSAFE_SubstringAt(value, i + 8);
+	i = String_IndexOf(&timeout, ',');
+	if (i >= 0) timeout.length = i;
+
+	if (!Convert_ParseInt(&timeout, &state->keepAlive) || state->keepAlive < 0) state->keepAlive = 0;
+}
+
 static void HttpClient_ParseHeader(struct HttpClientState* state, const cc_string* line) {
 	static const cc_string HTTP_10_VERSION = String_FromConst("HTTP/1.0");
 	cc_string name, value;
@@ -661,6 +755,8 @@ static void HttpClient_ParseHeader(struct HttpClientState* state, const cc_strin
 	} else if (String_CaselessEqualsConst(&name, "Connection")) {
 		if (String_CaselessEqualsConst(&value, "keep-alive")) state->autoClose = false;
 		if (String_CaselessEqualsConst(&value, "close"))      state->autoClose = true;
+	} else if (String_CaselessEqualsConst(&name, "Keep-Alive")) {
+		HttpClient_ParseKeepAlive(state, &value);
 	}
 }
 
@@ -890,6 +986,7 @@ static cc_result HttpClient_HandleRedirect(struct HttpClientState* state) {
 *#########################################################################################################################*/
 static void HttpBackend_Init(void) {
 	SSLBackend_Init(httpsVerify);
+	poolMutex = Mutex_Create("HTTP pool");
 	//httpOnly = true; // TODO: insecure
 }
 
@@ -901,14 +998,12 @@ static cc_result HttpBackend_PerformRequest(struct HttpClientState* state) {
 	cc_result res;
 
 	res = ConnectionPool_Open(&state->conn, &state->url);
-	if (res) { HttpConnection_Close(state->conn); return res; }
-
-	res = HttpClient_SendRequest(state);
-	if (res) { HttpConnection_Close(state->conn); return res; }
-
-	res = HttpClient_ParseResponse(state);
-	if (res) HttpConnection_Close(state->conn);
+	if (!res) res = HttpClient_SendRequest(state);
+	if (!res) res = HttpClient_ParseResponse(state);
 
+	/* Server will close the connection once the response is sent anyways */
+	if (res || state->autoClose) HttpConnection_Close(state->conn);
+	ConnectionPool_Release(state->conn, state->keepAlive);
 	return res;
 }
 
@@ -1213,14 +1308,172 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 #endif
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Http cache--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Responses to HTTP_FLAG_CACHE requests are stored in httpcache/, and revalidated using If-None-Match/If-Modified-Since */
+/* Each URL maps to one of a fixed number of slots, which bounds the total size of the cache */
+#define HTTPCACHE_MAGIC       0x43484343UL /* "CCHC" */
+#define HTTPCACHE_SLOTS       1024
+#define HTTPCACHE_MAX_SIZE    (64 * 1024)
+#define HTTPCACHE_HEADER_SIZE 20
+
+struct HttpCacheEntry {
+	cc_uint8* data;
+	cc_uint32 size;
+	TimeMS expires; /* Time (in seconds) until which the response can be used without revalidating */
+};
+
+static cc_bool HttpCache_Enabled(struct HttpRequest* req) {
+	return (req->flags & HTTP_FLAG_CACHE) && req->requestType == REQUEST_TYPE_GET && !Platform_ReadonlyFilesystem;
+}
+
+static void HttpCache_MakePath(struct HttpRequest* req, cc_string* path) {
+	cc_string url = String_FromRawArray(req->url);
+	int slot = (int)(Utils_CRC32((const cc_uint8*)url.buffer, url.length) % HTTPCACHE_SLOTS);
+	String_Format1(path, "httpcache/%i", &slot);
+}
+
+/* Reads a cached response, returning false if it is invalid or for a different URL using the same slot */
+static cc_bool HttpCache_Read(struct Stream* s, struct HttpRequest* req, struct HttpCacheEntry* entry) {
+	cc_uint8 header[HTTPCACHE_HEADER_SIZE];
+	char urlBuffer[URL_MAX_SIZE], etag[STRING_SIZE], lastModified[STRING_SIZE];
+	int urlLen, etagLen, lastModifiedLen;
+	cc_string url, cachedUrl;
+
+	if (Stream_Read(s, header, HTTPCACHE_HEADER_SIZE)) return false;
+	if (Stream_GetU32_LE(header) != HTTPCACHE_MAGIC)   return false;
+
+	entry->size     = Stream_GetU32_LE(header + 4);
+	entry->expires  = Stream_GetU32_LE(header + 8) | ((TimeMS)Stream_GetU32_LE(header + 12) << 32);
+	urlLen          = Stream_GetU16_LE(header + 16);
+	etagLen         = header[18];
+	lastModifiedLen = header[19];
+
+	if (!entry->size || entry->size > HTTPCACHE_MAX_SIZE) return false;
+	if (urlLen > URL_MAX_SIZE || etagLen >= STRING_SIZE || lastModifiedLen >= STRING_SIZE) return false;
+
+	if (Stream_Read(s, (cc_uint8*)urlBuffer,    urlLen))          return false;
+	if (Stream_Read(s, (cc_uint8*)etag,         etagLen))         return false;
+	if (Stream_Read(s, (cc_uint8*)lastModified, lastModifiedLen)) return false;
+
+	url       = String_FromRawArray(req->url);
+	cachedUrl = String_Init(urlBuffer, urlLen, urlLen);
+	if (!String_Equals(&url, &cachedUrl)) return false;
+
+	entry->data = (cc_uint8*)Mem_TryAlloc(entry->size, 1);
+	if (!entry->data) return false;
+	if (Stream_Read(s, entry->data, entry->size)) return false;
+
+	etag[etagLen]                 = '\0';
+	lastModified[lastModifiedLen] = '\0';
+	Mem_Copy(req->etag,         etag,         etagLen + 1);
+	Mem_Copy(req->lastModified, lastModified, lastModifiedLen + 1);
+	return true;
+}
+
+/* Looks up the cached response for the given request, if there is one */
+/* Returns whether the cached response can be used without needing to revalidate it */
+static cc_bool HttpCache_Lookup(struct HttpRequest* req, struct HttpCacheEntry* entry) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	struct Stream s;
+	cc_bool valid;
+
+	if (!HttpCache_Enabled(req)) return false;
+	String_InitArray(path, pathBuffer);
+	HttpCache_MakePath(req, &path);
+	if (Stream_OpenFile(&s, &path)) return false;
+
+	valid = HttpCache_Read(&s, req, entry);
+	/* No point logging error for closing readonly file */
+	(void)s.Close(&s);
+
+	if (!valid) {
+		Mem_Free(entry->data);
+		entry->data = NULL;
+		return false;
+	}
+	return DateTime_CurrentUTC() < entry->expires;
+}
+
+static void HttpCache_Save(struct HttpRequest* req) {
+	cc_uint8 header[HTTPCACHE_HEADER_SIZE];
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_string url, etag, lastModified;
+	TimeMS expires = 0;
+	struct Stream s;
+	cc_result res, closeRes;
+
+	url          = String_FromRawArray(req->url);
+	etag         = String_FromRawArray(req->etag);
+	lastModified = String_FromRawArray(req->lastModified);
+	/* Response can never be reused without revalidating, but can't be revalidated either */
+	if (!etag.length && !lastModified.length && !req->_maxAge) return;
+	if (req->_maxAge) expires = DateTime_CurrentUTC() + req->_maxAge;
+
+	Stream_SetU32_LE(header +  0, HTTPCACHE_MAGIC);
+	Stream_SetU32_LE(header +  4, req->size);
+	Stream_SetU32_LE(header +  8, (cc_uint32)expires);
+	Stream_SetU32_LE(header + 12, (cc_uint32)(expires >> 32));
+	Stream_SetU16_LE(header + 16, url.length);
+	header[18] = etag.length;
+	header[19] = lastModified.length;
+
+	String_InitArray(path, pathBuffer);
+	HttpCache_MakePath(req, &path);
+	res = Stream_CreateFile(&s, &path);
+	if (res) { Platform_Log2("Error %e caching %s", &res, &url); return; }
+
+	res = Stream_Write(&s, header, HTTPCACHE_HEADER_SIZE);
+	if (!res) res = Stream_Write(&s, (const cc_uint8*)url.buffer,          url.length);
+	if (!res) res = Stream_Write(&s, (const cc_uint8*)etag.buffer,         etag.length);
+	if (!res) res = Stream_Write(&s, (const cc_uint8*)lastModified.buffer, lastModified.length);
+	if (!res) res = Stream_Write(&s, req->data, req->size);
+
+	closeRes = s.Close(&s);
+	if (!res) res = closeRes;
+	if (res) Platform_Log2("Error %e caching %s", &res, &url);
+}
+
+/* Updates the cache after the given request has been performed */
+static void HttpCache_Update(struct HttpRequest* req, struct HttpCacheEntry* entry) {
+	if (!req->result && req->statusCode == 304 && entry->data) {
+		/* Cached response is unchanged, so use that instead */
+		Mem_Free(req->data);
+		req->data       = entry->data;
+		req->size       = entry->size;
+		req->statusCode = 200;
+		entry->data     = NULL;
+		/* Freshness lifetime may have changed */
+		if (req->_maxAge && HttpCache_Enabled(req)) HttpCache_Save(req);
+	} else if (!req->result && req->statusCode == 200 && req->data && req->size <= HTTPCACHE_MAX_SIZE) {
+		if (HttpCache_Enabled(req)) HttpCache_Save(req);
+	}
+
+	Mem_Free(entry->data);
+	entry->data = NULL;
+}
+
+
+/* Only the builtin backend's connection pool is safe to use from multiple workers */
+#if CC_NET_BACKEND == CC_NET_BACKEND_BUILTIN && !defined CC_BUILD_LOWMEM
+	#define HTTP_MAX_WORKERS 4
+#else
+	#define HTTP_MAX_WORKERS 1
+#endif
+/* Maximum number of requests to the same host that are performed simultaneously */
+/* (one less than the number of workers, so e.g. skins never block a texture pack) */
+#define HTTP_MAX_PER_HOST 3
+
 static void* workerWaitable;
-static void* workerThread;
+static void* workerThreads[HTTP_MAX_WORKERS];
+static int workersCount, workersStarted;
 
 static void* pendingMutex;
 static struct RequestList pendingReqs;
 
 static void* curRequestMutex;
-static struct HttpRequest http_curRequest;
+static struct HttpRequest http_curRequests[HTTP_MAX_WORKERS];
 
 
 /*########################################################################################################################*
@@ -1239,20 +1492,35 @@ cc_bool Http_GetResult(int reqID, struct HttpRequest* item) {
 }
 
 cc_bool Http_GetCurrent(int* reqID, int* progress) {
+	int i;
+	*reqID    = 0;
+	*progress = HTTP_PROGRESS_NOT_WORKING_ON;
+
 	Mutex_Lock(curRequestMutex);
 	{
-		*reqID    = http_curRequest.id;
-		*progress = http_curRequest.progress;
+		for (i = 0; i < HTTP_MAX_WORKERS; i++)
+		{
+			if (!http_curRequests[i].id) continue;
+			*reqID    = http_curRequests[i].id;
+			*progress = http_curRequests[i].progress;
+			break;
+		}
 	}
 	Mutex_Unlock(curRequestMutex);
 	return *reqID != 0;
 }
 
 int Http_CheckProgress(int reqID) {
-	int curReqID, progress;
-	Http_GetCurrent(&curReqID, &progress);
+	int i, progress = HTTP_PROGRESS_NOT_WORKING_ON;
 
-	if (reqID != curReqID) progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	Mutex_Lock(curRequestMutex);
+	{
+		for (i = 0; i < HTTP_MAX_WORKERS; i++)
+		{
+			if (http_curRequests[i].id == reqID) progress = http_curRequests[i].progress;
+		}
+	}
+	Mutex_Unlock(curRequestMutex);
 	return progress;
 }
 
@@ -1282,25 +1550,28 @@ void Http_TryCancel(int reqID) {
 /*########################################################################################################################*
 *-----------------------------------------------------Http worker---------------------------------------------------------*
 *#########################################################################################################################*/
-/* Sets up state to begin a http request */
-static void PrepareCurrentRequest(struct HttpRequest* req, cc_string* url) {
-	static const char* verbs[] = { "GET", "HEAD", "POST" };
-	Http_GetUrl(req, url);
-	Platform_Log2("Fetching %s (%c)", url, verbs[req->requestType]);
-	/* TODO change to verbs etc */
-
-	Mutex_Lock(curRequestMutex);
-	{
-		HttpRequest_Copy(&http_curRequest, req);
-		http_curRequest.progress = HTTP_PROGRESS_MAKING_REQUEST;
-	}
-	Mutex_Unlock(curRequestMutex);
+/* Sets up state for the given worker to begin a http request */
+/* NOTE: curRequestMutex must be held when calling this */
+static void PrepareCurrentRequest(int worker, struct HttpRequest* req) {
+	HttpRequest_Copy(&http_curRequests[worker], req);
+	http_curRequests[worker].progress = HTTP_PROGRESS_MAKING_REQUEST;
 }
 
 static void PerformRequest(struct HttpRequest* req, cc_string* url) {
+	struct HttpCacheEntry cached = { 0 };
 	cc_uint64 beg, end;
 	int elapsed;
 
+	if (HttpCache_Lookup(req, &cached)) {
+		Platform_LogConst("HTTP: using cached response");
+		req->data       = cached.data;
+		req->size       = cached.size;
+		req->statusCode = 200;
+		req->progress   = 100;
+		Http_FinishRequest(req);
+		return;
+	}
+
 	beg = Stopwatch_Measure();
 	req->result = HttpBackend_Do(req, url);
 	end = Stopwatch_Measure();
@@ -1309,46 +1580,100 @@ static void PerformRequest(struct HttpRequest* req, cc_string* url) {
 	Platform_Log4("HTTP: result %e (http %i) in %i ms (%i bytes)",
 		&req->result, &req->statusCode, &elapsed, &req->size);
 
+	HttpCache_Update(req, &cached);
 	Http_FinishRequest(req);
 }
 
-static void ClearCurrentRequest(void) {
+static void ClearCurrentRequest(int worker) {
 	Mutex_Lock(curRequestMutex);
 	{
-		http_curRequest.id       = 0;
-		http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+		http_curRequests[worker].id       = 0;
+		http_curRequests[worker].progress = HTTP_PROGRESS_NOT_WORKING_ON;
 	}
 	Mutex_Unlock(curRequestMutex);
 }
 
-static void DoRequest(struct HttpRequest* request) {
+/* Performs the given worker's current request */
+static void DoRequest(int worker) {
+	static const char* verbs[] = { "GET", "HEAD", "POST" };
+	struct HttpRequest* req = &http_curRequests[worker];
 	char urlBuffer[URL_MAX_SIZE]; cc_string url;
 
 	String_InitArray(url, urlBuffer);
-	PrepareCurrentRequest(request, &url);
-	PerformRequest(&http_curRequest, &url);
-	ClearCurrentRequest();
+	Http_GetUrl(req, &url);
+	Platform_Log2("Fetching %s (%c)", &url, verbs[req->requestType]);
+	/* TODO change to verbs etc */
+
+	PerformRequest(req, &url);
+	ClearCurrentRequest(worker);
+}
+
+/* Returns the host portion of the given request's URL (e.g. "example.com:8080") */
+static cc_string Http_GetHost(struct HttpRequest* req) {
+	cc_string url = String_FromRawArray(req->url);
+	int i;
+
+	i = String_IndexOfConst(&url, "://");
+	if (i >= 0) url = String_UNSAFE_SubstringAt(&url, i + 3);
+	i = String_IndexOf(&url, '/');
+	if (i >= 0) url.length = i;
+	return url;
+}
+
+/* Returns whether fewer than HTTP_MAX_PER_HOST workers are fetching from the request's host */
+/* NOTE: curRequestMutex must be held when calling this */
+static cc_bool CanStartRequest(struct HttpRequest* req) {
+	cc_string host = Http_GetHost(req), cur;
+	int i, active = 0;
+
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
+	{
+		if (!http_curRequests[i].id) continue;
+		cur = Http_GetHost(&http_curRequests[i]);
+		if (String_CaselessEquals(&host, &cur)) active++;
+	}
+	return active < HTTP_MAX_PER_HOST;
+}
+
+/* Moves the first pending request that can be started into the given worker's current request */
+/* NOTE: Pending requests are ordered so that HTTP_FLAG_PRIORITY requests are always first */
+static cc_bool ClaimPendingRequest(int worker) {
+	int i;
+	for (i = 0; i < pendingReqs.count; i++)
+	{
+		if (!CanStartRequest(&pendingReqs.entries[i])) continue;
+
+		PrepareCurrentRequest(worker, &pendingReqs.entries[i]);
+		RequestList_RemoveAt(&pendingReqs, i);
+		return true;
+	}
+	return false;
 }
 
 static void WorkerLoop(void) {
-	struct HttpRequest request;
-	cc_bool hasRequest;
+	cc_bool hasRequest, hasMore;
+	int worker;
 
-	for (;;) {
-		hasRequest = false;
+	Mutex_Lock(pendingMutex);
+	{
+		worker = workersStarted++;
+	}
+	Mutex_Unlock(pendingMutex);
 
+	for (;;) {
 		Mutex_Lock(pendingMutex);
+		Mutex_Lock(curRequestMutex);
 		{
-			if (pendingReqs.count) {
-				HttpRequest_Copy(&request, &pendingReqs.entries[0]);
-				hasRequest = true;
-				RequestList_RemoveAt(&pendingReqs, 0);
-			}
+			hasRequest = ClaimPendingRequest(worker);
+			hasMore    = pendingReqs.count > 0;
 		}
+		Mutex_Unlock(curRequestMutex);
 		Mutex_Unlock(pendingMutex);
 
 		if (hasRequest) {
-			DoRequest(&request);
+			/* Wake up another worker to start on the remaining requests */
+			if (hasMore && workersCount > 1) Waitable_Signal(workerWaitable);
+			DoRequest(worker);
 		} else {
 			/* Block until another thread submits a request to do */
 			Platform_LogConst("Download queue empty, going back to sleep...");
@@ -1361,7 +1686,12 @@ static void WorkerLoop(void) {
 static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 #if defined CC_BUILD_PSP || defined CC_BUILD_NDS
 	/* TODO why doesn't threading work properly on PSP */
-	DoRequest(req);
+	Mutex_Lock(curRequestMutex);
+	{
+		PrepareCurrentRequest(0, req);
+	}
+	Mutex_Unlock(curRequestMutex);
+	DoRequest(0);
 #else
 	Mutex_Lock(pendingMutex);
 	{
@@ -1376,12 +1706,17 @@ static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 *-----------------------------------------------------Http component------------------------------------------------------*
 *#########################################################################################################################*/
 static void Http_Init(void) {
+	int i;
 	Http_InitCommon();
-	http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
+	{
+		http_curRequests[i].progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	}
 	/* Http component gets initialised multiple times on Android */
-	if (workerThread) return;
+	if (workersCount) return;
 
 	HttpBackend_Init();
+	if (!Platform_ReadonlyFilesystem) Utils_EnsureDirectory("httpcache");
 	RequestList_Init(&pendingReqs);
 	RequestList_Init(&processedReqs);
 
@@ -1389,7 +1724,11 @@ static void Http_Init(void) {
 	pendingMutex    = Mutex_Create("HTTP pending");
 	processedMutex  = Mutex_Create("HTTP processed");
 	curRequestMutex = Mutex_Create("HTTP current");
-	
-	Thread_Run(&workerThread, WorkerLoop, 128 * 1024, "HTTP");
+
+	workersCount = Options_GetInt(OPT_HTTP_WORKERS, 1, HTTP_MAX_WORKERS, HTTP_MAX_WORKERS);
+	for (i = 0; i < workersCount; i++)
+	{
+		Thread_Run(&workerThreads[i], WorkerLoop, 128 * 1024, "HTTP");
+	}
 }
 #endif
@@ -272,7 +272,18 @@ static void MouseStateUpdate(int button, cc_bool pressed) {
 	CPE_SendPlayerClick(button, pressed, (EntityID)input_pickingId, &Game_SelectedPos);	
 }
 
+/* The targeted block is normally only picked once per frame, which at low FPS means clicks */
+/*  use the camera orientation from before any mouse movement that happened earlier in the frame */
+/* So apply that movement and pick again, which also lets several clicks within one frame */
+/*  each target the block behind the one the previous click broke */
+static void MouseUpdateTarget(void) {
+	if (Gui_GetBlocksWorld()) return;
+	Camera_ApplyPendingMovement();
+	Camera.Active->GetPickedBlock(&Game_SelectedPos);
+}
+
 static void MouseStatePress(int button) {
+	MouseUpdateTarget();
 	input_lastClick = Game.Time;
 	input_pickingId = -1;
 	MouseStateUpdate(button, true);
@@ -7,10 +7,19 @@
 #include "TexturePack.h"
 #include "Block.h"
 #include "Game.h"
+#include "Event.h"
+#include "Platform.h"
 
 static struct VertexTextured* iso_vertices;
 static struct VertexTextured* iso_vertices_base;
 static int* iso_state;
+static int* iso_state_base;
+
+/* Unit size vertices of each block's angled icon, relative to the icon centre */
+/* These only depend on the block definition and the terrain atlas layout */
+static struct VertexTextured* iso_icons;
+static cc_uint16 iso_iconTexs[BLOCK_COUNT * 3];
+static cc_bool iso_iconCached[BLOCK_COUNT];
 
 static cc_bool iso_cacheInited;
 static PackedCol iso_colorXSide, iso_colorZSide, iso_colorYBottom;
@@ -29,9 +38,9 @@ static void IsometricDrawer_InitCache(void) {
 		&iso_colorXSide, &iso_colorZSide, &iso_colorYBottom);
 }
 
-static TextureLoc IsometricDrawer_GetTexLoc(BlockID block, Face face) {
+static TextureLoc IsometricDrawer_GetTexLoc(BlockID block, Face face, int i) {
 	TextureLoc loc = Block_Tex(block, face);
-	*iso_state++   = Atlas1D_Index(loc);
+	iso_iconTexs[block * 3 + i] = Atlas1D_Index(loc);
 	return loc;
 }
 
@@ -67,16 +76,17 @@ static void IsometricDrawer_Flat(BlockID block, float size) {
 	iso_vertices = v;
 }
 
-static void IsometricDrawer_Angled(BlockID block, float size) {
+static void IsometricDrawer_CacheAngled(BlockID block) {
 	cc_bool bright;
 	Vec3 min, max;
-	struct VertexTextured* beg = iso_vertices;
+	struct VertexTextured* beg = &iso_icons[block * ISOMETRICDRAWER_MAXVERTICES];
+	struct VertexTextured* end = beg;
 	struct VertexTextured* v;
 	float x, y, scale;
 
 	/* isometric coords size: cosY * -scale - sinY * scale */
 	/* we need to divide by (2 * cosY), as the calling function expects size to be in pixels. */
-	scale = size / (2.0f * iso_cosY);
+	scale = 1.0f / (2.0f * iso_cosY);
 
 	Drawer.MinBB = Blocks.MinBB[block]; Drawer.MinBB.y = 1.0f - Drawer.MinBB.y;
 	Drawer.MaxBB = Blocks.MaxBB[block]; Drawer.MaxBB.y = 1.0f - Drawer.MaxBB.y;
@@ -94,13 +104,13 @@ static void IsometricDrawer_Angled(BlockID block, float size) {
 	Drawer.TintCol = Blocks.FogCol[block];
 
 	Drawer_XMax(1, bright ? PACKEDCOL_WHITE : iso_colorXSide,
-		IsometricDrawer_GetTexLoc(block, FACE_XMAX), &iso_vertices);
+		IsometricDrawer_GetTexLoc(block, FACE_XMAX, 0), &end);
 	Drawer_ZMin(1, bright ? PACKEDCOL_WHITE : iso_colorZSide,
-		IsometricDrawer_GetTexLoc(block, FACE_ZMIN), &iso_vertices);
+		IsometricDrawer_GetTexLoc(block, FACE_ZMIN, 1), &end);
 	Drawer_YMax(1, PACKEDCOL_WHITE,
-		IsometricDrawer_GetTexLoc(block, FACE_YMAX), &iso_vertices);
+		IsometricDrawer_GetTexLoc(block, FACE_YMAX, 2), &end);
 
-	for (v = beg; v < iso_vertices; v++)
+	for (v = beg; v < end; v++)
 	{
 		/* Cut down form of: */
 		/*   Matrix_RotateY(&rotY,  45.0f * MATH_DEG2RAD); */
@@ -113,9 +123,38 @@ static void IsometricDrawer_Angled(BlockID block, float size) {
 		x = v->x * iso_cosY                              + v->z * -iso_sinY;
 		y = v->x * iso_sinX * iso_sinY + v->y * iso_cosX + v->z * iso_sinX * iso_cosY;
 
-		v->x = x + iso_posX;
-		v->y = y + iso_posY;
+		v->x = x;
+		v->y = y;
 	}
+	iso_iconCached[block] = true;
+}
+
+static void IsometricDrawer_Angled(BlockID block, float size) {
+	struct VertexTextured* src;
+	struct VertexTextured* v = iso_vertices;
+	int i;
+
+	if (!iso_icons) {
+		iso_icons = (struct VertexTextured*)Mem_Alloc(BLOCK_COUNT * ISOMETRICDRAWER_MAXVERTICES,
+								sizeof(struct VertexTextured), "isometric icons");
+	}
+	if (!iso_iconCached[block]) IsometricDrawer_CacheAngled(block);
+
+	src = &iso_icons[block * ISOMETRICDRAWER_MAXVERTICES];
+	for (i = 0; i < ISOMETRICDRAWER_MAXVERTICES; i++, src++, v++)
+	{
+		v->x   = src->x * size + iso_posX;
+		v->y   = src->y * size + iso_posY;
+		v->z   = src->z * size;
+		v->Col = src->Col;
+		v->U   = src->U; v->V = src->V;
+	}
+
+	for (i = 0; i < 3; i++) 
+	{
+		*iso_state++ = iso_iconTexs[block * 3 + i];
+	}
+	iso_vertices = v;
 }
 
 void IsometricDrawer_BeginBatch(struct VertexTextured* vertices, int* state) {
@@ -123,6 +162,7 @@ void IsometricDrawer_BeginBatch(struct VertexTextured* vertices, int* state) {
 	iso_vertices      = vertices;
 	iso_vertices_base = vertices;
 	iso_state         = state; /* TODO just store TextureLoc ??? */
+	iso_state_base    = state;
 }
 
 void IsometricDrawer_AddBatch(BlockID block, float size, float x, float y) {
@@ -142,7 +182,33 @@ void IsometricDrawer_AddBatch(BlockID block, float size, float x, float y) {
 	}
 }
 
+/* Sorts the buffered quads by 1D atlas index, so that Render only needs one draw call per atlas */
+/* NOTE: Quads of different icons in the same batch must not overlap, as their order may change */
+static void IsometricDrawer_SortBatch(void) {
+	struct VertexTextured tmp[4];
+	struct VertexTextured* quads = iso_vertices_base;
+	int count = (int)(iso_state - iso_state_base);
+	int i, j, key;
+
+	/* Insertion sort, as batches are small and usually almost entirely in one 1D atlas */
+	for (i = 1; i < count; i++)
+	{
+		key = iso_state_base[i];
+		if (iso_state_base[i - 1] <= key) continue;
+		Mem_Copy(tmp, &quads[i * 4], sizeof(tmp));
+
+		for (j = i; j > 0 && iso_state_base[j - 1] > key; j--)
+		{
+			iso_state_base[j] = iso_state_base[j - 1];
+			Mem_Copy(&quads[j * 4], &quads[(j - 1) * 4], sizeof(tmp));
+		}
+		iso_state_base[j] = key;
+		Mem_Copy(&quads[j * 4], tmp, sizeof(tmp));
+	}
+}
+
 int IsometricDrawer_EndBatch(void) {
+	IsometricDrawer_SortBatch();
 	return (int)(iso_vertices - iso_vertices_base);
 }
 
@@ -170,3 +236,30 @@ void IsometricDrawer_Render(int count, int offset, int* state) {
 	Atlas1D_Bind(curIdx);
 	Gfx_DrawVb_IndexedTris_Range(batchLen, batchBeg);
 }
+
+
+/*########################################################################################################################*
+*-----------------------------------------------IsometricDrawer component-------------------------------------------------*
+*#########################################################################################################################*/
+static void InvalidateIcons(void* obj) {
+	Mem_Set(iso_iconCached, 0, sizeof(iso_iconCached));
+}
+
+static void OnInit(void) {
+	Event_Register_(&TextureEvents.AtlasChanged,  NULL, InvalidateIcons);
+	Event_Register_(&BlockEvents.BlockDefChanged, NULL, InvalidateIcons);
+}
+
+static void OnReset(void) { InvalidateIcons(NULL); }
+
+static void OnFree(void) {
+	Mem_Free(iso_icons);
+	iso_icons = NULL;
+	InvalidateIcons(NULL);
+}
+
+struct IGameComponent IsometricDrawer_Component = {
+	OnInit,  /* Init  */
+	OnFree,  /* Free  */
+	OnReset, /* Reset */
+};
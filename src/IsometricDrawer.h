@@ -7,6 +7,8 @@ CC_BEGIN_HEADER
    Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 */
 struct VertexTextured;
+struct IGameComponent;
+extern struct IGameComponent IsometricDrawer_Component;
 
 /* Maximum number of vertices used to draw a block in isometric way. */
 #define ISOMETRICDRAWER_MAXVERTICES 12
@@ -16,6 +18,7 @@ void IsometricDrawer_BeginBatch(struct VertexTextured* vertices, int* state);
 /* Buffers the vertices needed to draw the given block at the given position */
 void IsometricDrawer_AddBatch(BlockID block, float size, float x, float y);
 /* Returns the number of buffered vertices */
+/* NOTE: Buffered vertices are reordered to minimise draw calls, so icons in a batch must not overlap */
 int  IsometricDrawer_EndBatch(void);
 /* Draws the buffered vertices */
 void IsometricDrawer_Render(int count, int offset, int* state);
@@ -1271,7 +1271,7 @@ static void ServersScreen_HashFilter(cc_string* str) {
 
 static void ServersScreen_SearchChanged(struct LInput* w) {
 	struct ServersScreen* s = &ServersScreen;
-	LTable_ApplyFilter(&s->table);
+	LTable_RefineFilter(&s->table);
 	LBackend_NeedsRedraw(&s->table);
 }
 
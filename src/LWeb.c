@@ -76,7 +76,7 @@ static cc_string Json_ConsumeNumber(struct JsonContext* ctx) {
 	return String_Init(ctx->cur - len, len, len);
 }
 
-static void Json_ConsumeString(struct JsonContext* ctx, cc_string* str) {
+static void Json_DecodeString(struct JsonContext* ctx, cc_string* str) {
 	int codepoint, h[4];
 	char c;
 	str->length = 0;
@@ -105,10 +105,28 @@ static void Json_ConsumeString(struct JsonContext* ctx, cc_string* str) {
 
 	ctx->failed = true; str->length = 0;
 }
+
+/* Most strings do not contain any escape sequences, in which case the string */
+/*  can just point directly into the JSON text instead of being decoded into tmp */
+static cc_string Json_ConsumeString(struct JsonContext* ctx, cc_string* tmp) {
+	char* beg = ctx->cur;
+	int i;
+
+	for (i = 0; i < ctx->left; i++) {
+		if (beg[i] == '\\') break;
+		if (beg[i] != '"')  continue;
+
+		JsonContext_Consume(ctx, i + 1);
+		return String_Init(beg, i, i);
+	}
+
+	Json_DecodeString(ctx, tmp);
+	return *tmp;
+}
 static cc_string Json_ConsumeValue(int token, struct JsonContext* ctx);
 
 static void Json_ConsumeObject(struct JsonContext* ctx) {
-	char keyBuffer[STRING_SIZE];
+	cc_string key; char keyBuffer[STRING_SIZE];
 	cc_string value, oldKey = ctx->curKey;
 	int token;
 	ctx->depth++;
@@ -120,8 +138,8 @@ static void Json_ConsumeObject(struct JsonContext* ctx) {
 		if (token == '}') break;
 
 		if (token != '"') { ctx->failed = true; break; }
-		String_InitArray(ctx->curKey, keyBuffer);
-		Json_ConsumeString(ctx, &ctx->curKey);
+		String_InitArray(key, keyBuffer);
+		ctx->curKey = Json_ConsumeString(ctx, &key);
 
 		token = Json_ConsumeToken(ctx);
 		if (token != ':') { ctx->failed = true; break; }
@@ -158,7 +176,7 @@ static cc_string Json_ConsumeValue(int token, struct JsonContext* ctx) {
 	switch (token) {
 	case '{': Json_ConsumeObject(ctx); break;
 	case '[': Json_ConsumeArray(ctx);  break;
-	case '"': Json_ConsumeString(ctx, &ctx->_tmp); return ctx->_tmp;
+	case '"': return Json_ConsumeString(ctx, &ctx->_tmp);
 
 	case TOKEN_NUM:   return Json_ConsumeNumber(ctx);
 	case TOKEN_TRUE:  return strTrue;
@@ -645,7 +663,7 @@ static void FetchFlagsTask_DownloadNext(void) {
 			&flags[FetchFlagsTask.count].country[0], &flags[FetchFlagsTask.count].country[1]);
 
 	FetchFlagsTask.Base.Handle = FetchFlagsTask_Handle;
-	FetchFlagsTask.Base.reqID  = Http_AsyncGetData(&url, 0);
+	FetchFlagsTask.Base.reqID  = Http_AsyncGetData(&url, HTTP_FLAG_CACHE);
 }
 
 static void FetchFlagsTask_Ensure(void) {
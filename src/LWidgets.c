@@ -693,6 +693,7 @@ void LTable_Reset(struct LTable* w) {
 	w->rowsCount  = 0;
 	w->_wheelAcc  = 0.0f;
 	w->sortingCol = -1;
+	w->_filtered  = false;
 }
 
 static int ShouldShowServer(struct LTable* w, struct ServerInfo* server) {
@@ -700,6 +701,25 @@ static int ShouldShowServer(struct LTable* w, struct ServerInfo* server) {
 		&& (Launcher_ShowEmptyServers || server->players > 0);
 }
 
+static void LTable_FilterChanged(struct LTable* w, int rows) {
+	int j, count = FetchServersTask.numServers;
+	w->rowsCount = rows;
+
+	for (j = rows; j < count; j++) {
+		FetchServersTask.servers[j]._order = -100000;
+	}
+
+	/* Remember filter so LTable_RefineFilter knows if only narrowing it */
+	String_InitArray(w->_lastFilter, w->_lastFilterBuffer);
+	String_Copy(&w->_lastFilter, w->filter);
+	w->_filtered      = w->_lastFilter.length == w->filter->length;
+	w->_lastShowEmpty = Launcher_ShowEmptyServers;
+
+	w->_lastRow = -1;
+	LTable_ClampTopRow(w);
+	LBackend_TableUpdate(w);
+}
+
 void LTable_ApplyFilter(struct LTable* w) {
 	int i, j, count;
 
@@ -709,15 +729,24 @@ void LTable_ApplyFilter(struct LTable* w) {
 			FetchServersTask.servers[j++]._order = FetchServersTask.orders[i];
 		}
 	}
+	LTable_FilterChanged(w, j);
+}
 
-	w->rowsCount = j;
-	for (; j < count; j++) {
-		FetchServersTask.servers[j]._order = -100000;
+void LTable_RefineFilter(struct LTable* w) {
+	int i, j;
+	/* Any server containing the new filter must also contain the old filter, */
+	/*  so only need to check servers which are already being shown */
+	if (!w->_filtered || w->_lastShowEmpty != Launcher_ShowEmptyServers
+		|| !String_CaselessContains(w->filter, &w->_lastFilter)) {
+		LTable_ApplyFilter(w); return;
 	}
 
-	w->_lastRow = -1;
-	LTable_ClampTopRow(w);
-	LBackend_TableUpdate(w);
+	for (i = 0, j = 0; i < w->rowsCount; i++) {
+		if (ShouldShowServer(w, LTable_Get(i))) {
+			FetchServersTask.servers[j++]._order = FetchServersTask.servers[i]._order;
+		}
+	}
+	LTable_FilterChanged(w, j);
 }
 
 static int sortingCol;
@@ -218,6 +218,10 @@ struct LTable {
 	int _lastRow;    /* last clicked row (for doubleclick join) */
 	cc_uint64 _lastClick; /* timestamp of last mouse click on a row */
 	int sortingCol;
+
+	/* Filter that was used when rows were last filtered (see LTable_RefineFilter) */
+	cc_string _lastFilter; char _lastFilterBuffer[STRING_SIZE];
+	cc_bool _lastShowEmpty, _filtered;
 };
 
 struct LTableCell { struct LTable* table; int x, y, width; };
@@ -235,6 +239,9 @@ void LTable_Reset(struct LTable* table);
 cc_bool LTable_HandlesKey(int key, struct InputDevice* device);
 /* Filters rows to only show those containing 'w->Filter' in the name. */
 void LTable_ApplyFilter(struct LTable* table);
+/* Same as LTable_ApplyFilter, but only rechecks the currently shown rows when */
+/*  the filter has only been narrowed (e.g. user typed another character in search) */
+void LTable_RefineFilter(struct LTable* table);
 /* Sorts the rows in the table by current Sorter function of table */
 void LTable_Sort(struct LTable* table);
 /* If selected row is not visible, adjusts top row so it does show. */
@@ -414,8 +414,8 @@ static void ExtractTerrainTiles(struct Bitmap* bmp) {
 	Bitmap_Allocate(&stoneBmp, TILESIZE, TILESIZE);
 
 	/* Precompute the scaled background */
-	Bitmap_Scale(&dirtBmp,  bmp, 2 * tileSize, 0, tileSize, tileSize);
-	Bitmap_Scale(&stoneBmp, bmp, 1 * tileSize, 0, tileSize, tileSize);
+	Bitmap_ScaleFiltered(&dirtBmp,  bmp, 2 * tileSize, 0, tileSize, tileSize);
+	Bitmap_ScaleFiltered(&stoneBmp, bmp, 1 * tileSize, 0, tileSize, tileSize);
 
 	TintBitmap(&dirtBmp, 128, 64, TILESIZE, TILESIZE);
 	TintBitmap(&stoneBmp, 96, 96, TILESIZE, TILESIZE);
@@ -463,7 +463,7 @@ static cc_result ExtractTexturePack(const cc_string* path) {
 	struct Stream stream;
 	cc_result res;
 
-	res = Stream_OpenFile(&stream, path);
+	res = Stream_OpenBufferedFile(&stream, path);
 	if (res == ReturnCode_FileNotFound) return res;
 	if (res) { Logger_SysWarn(res, "opening texture pack"); return res; }
 
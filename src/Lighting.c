@@ -1,4 +1,12 @@
 #include "Lighting.h"
+/* NOTE: Included before Funcs.h, since C++ standard headers may #undef its min/max */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define HEIGHTMAP_SSE2
+	#include <emmintrin.h>
+#elif defined __ARM_NEON && defined __aarch64__
+	#define HEIGHTMAP_NEON
+	#include <arm_neon.h>
+#endif
 #include "Block.h"
 #include "Funcs.h"
 #include "MapRenderer.h"
@@ -12,6 +20,7 @@
 #include "ExtMath.h"
 #include "Options.h"
 #include "Builder.h"
+#define MEM_SUBSYSTEM MEM_SYS_LIGHTING
 
 const char* const LightingMode_Names[LIGHTING_MODE_COUNT] = { "Classic", "Fancy" };
 
@@ -58,7 +67,7 @@ static int ClassicLighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
 	if (World.IDMask <= 0xFF) {
 		ClassicLighting_CalcBody(World.Blocks[i]);
 	} else {
-		ClassicLighting_CalcBody(World.Blocks[i] | (World.Blocks2[i] << 8));
+		ClassicLighting_CalcBody(World.Blocks[i] | (World_GetUpperBlock(i) << 8));
 	}
 #endif
 
@@ -124,6 +133,23 @@ void ClassicLighting_Refresh(void) {
 	}
 }
 
+cc_bool ClassicLighting_GetHeightmap(cc_int16* heightmap) {
+	int x, z, i = 0;
+	if (!classic_heightmap) return false;
+
+	for (z = 0; z < World.Length; z++) {
+		for (x = 0; x < World.Width; x++, i++) {
+			heightmap[i] = ClassicLighting_GetLightHeight(x, z);
+		}
+	}
+	return true;
+}
+
+void ClassicLighting_SetHeightmap(const cc_int16* heightmap) {
+	if (!classic_heightmap) return;
+	Mem_Copy(classic_heightmap, heightmap, World.Width * World.Length * 2);
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Lighting update------------------------------------------------------*
@@ -185,7 +211,7 @@ static cc_bool ClassicLighting_NeedsNeighour(BlockID block, int i, int minY, int
 	if (World.IDMask <= 0xFF) {
 		ClassicLighting_NeedsNeighourBody(World.Blocks[i]);
 	} else {
-		ClassicLighting_NeedsNeighourBody(World.Blocks[i] | (World.Blocks2[i] << 8));
+		ClassicLighting_NeedsNeighourBody(World.Blocks[i] | (World_GetUpperBlock(i) << 8));
 	}
 #endif
 	return false;
@@ -199,6 +225,8 @@ static void ClassicLighting_ResetNeighbour(int x, int y, int z, BlockID block, i
 
 		if (ClassicLighting_NeedsNeighour(block, World_Pack(x, y, z), minY, y, y)) {
 			MapRenderer_RefreshChunk(cx, cy, cz);
+		} else {
+			Game.ChunkRefreshesSkipped++;
 		}
 	} else {
 		for (cy = maxCy; cy >= minCy; cy--) {
@@ -208,6 +236,8 @@ static void ClassicLighting_ResetNeighbour(int x, int y, int z, BlockID block, i
 
 			if (ClassicLighting_NeedsNeighour(block, World_Pack(x, maxY, z), minY, maxY, y)) {
 				MapRenderer_RefreshChunk(cx, cy, cz);
+			} else {
+				Game.ChunkRefreshesSkipped++;
 			}
 		}
 	}
@@ -269,10 +299,82 @@ void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, Block
 	ClassicLighting_RefreshAffected(x, y, z, newBlock, lightH + 1, newHeight);
 }
 
+void ClassicLighting_OnRegionChanged(int minX, int minZ, int maxX, int maxY, int maxZ) {
+	int x, z, cx, cy, cz, hIndex, oldH, newH, lowest = Int32_MaxValue;
+	/* Blocks with LIGHT_FLAG_SHADES_FROM_BELOW just above the region also affect light height */
+	int topY = min(maxY + 1, World.MaxY);
+
+	for (z = minZ; z <= maxZ; z++) {
+		for (x = minX; x <= maxX; x++) 
+		{
+			hIndex = Lighting_Pack(x, z);
+			oldH   = classic_heightmap[hIndex];
+			/* Light height is only affected when the top of the column was inside the region */
+			if (oldH == HEIGHT_UNCALCULATED || oldH > maxY) continue;
+
+			newH = ClassicLighting_CalcHeightAt(x, topY, z, hIndex);
+			if (newH != oldH) lowest = min(lowest, min(oldH, newH) + 1);
+		}
+	}
+	if (lowest == Int32_MaxValue) return;
+	lowest = max(lowest, 0);
+
+	/* Refresh each chunk which shadows may have changed in just once */
+	/* (including neighbouring columns, as faces along chunk borders may be shadowed too) */
+	for (cz = (minZ - 1) >> CHUNK_SHIFT; cz <= (maxZ + 1) >> CHUNK_SHIFT; cz++) {
+		for (cx = (minX - 1) >> CHUNK_SHIFT; cx <= (maxX + 1) >> CHUNK_SHIFT; cx++) {
+			for (cy = lowest >> CHUNK_SHIFT; cy <= topY >> CHUNK_SHIFT; cy++) 
+			{
+				MapRenderer_RefreshChunk(cx, cy, cz);
+			}
+		}
+	}
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Lighting heightmap----------------------------------------------------*
 *#########################################################################################################################*/
+/* Total time spent calculating the heightmap for the current map, in microseconds */
+static cc_uint64 heightmapTime;
+
+/* Returns whether every block in the given row of blocks is 0 (i.e. air) */
+/* NOTE: Checks 16 blocks at a time when SIMD instructions are available */
+cc_bool ClassicLighting_IsRowEmpty(const BlockRaw* row, int count) {
+	int i = 0;
+#if defined HEIGHTMAP_SSE2
+	__m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16) {
+		__m128i cur = _mm_loadu_si128((const __m128i*)(row + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(cur, zero)) != 0xFFFF) return false;
+	}
+#elif defined HEIGHTMAP_NEON
+	for (; i + 16 <= count; i += 16) {
+		if (vmaxvq_u8(vld1q_u8(row + i))) return false;
+	}
+#endif
+
+	for (; i < count; i++) {
+		if (row[i]) return false;
+	}
+	return true;
+}
+
+#ifdef EXTENDED_BLOCKS
+/* Returns whether every block in the given row of blocks has no upper 8 bits set */
+cc_bool ClassicLighting_IsUpperRowEmpty(int index, int count) {
+	int len;
+	/* Rows may span across more than one page */
+	while (count) {
+		len = min(count, WORLD_PAGE_SIZE - (index & WORLD_PAGE_MASK));
+		if (!ClassicLighting_IsRowEmpty(&World_GetUpperBlock(index), len)) return false;
+
+		index += len; count -= len;
+	}
+	return true;
+}
+#endif
+
 static int Heightmap_InitialCoverage(int x1, int z1, int xCount, int zCount, int* skip) {
 	int elemsLeft = 0, index = 0, curRunCount = 0;
 	int x, z, hIndex, lightH;
@@ -297,7 +399,7 @@ static int Heightmap_InitialCoverage(int x1, int z1, int xCount, int zCount, int
 	return elemsLeft;
 }
 
-#define Heightmap_CalculateBody(get_block)\
+#define Heightmap_CalculateBody(get_block, row_empty)\
 for (y = World.Height - 1; y >= 0; y--) {\
 	if (elemsLeft <= 0) { return true; } \
 	mapIndex = World_Pack(x1, y, z1);\
@@ -306,6 +408,9 @@ for (y = World.Height - 1; y >= 0; y--) {\
 	for (z = 0; z < zCount; z++) {\
 		baseIndex = mapIndex;\
 		index = z * xCount;\
+		/* Quickly skip over rows of only air (e.g. the sky above the map) */ \
+		if (skipAir && row_empty) { hIndex += World.Width; mapIndex += World.Width; continue; }\
+\
 		for (x = 0; x < xCount;) {\
 			curRunCount = skip[index];\
 			x += curRunCount; mapIndex += curRunCount; index += curRunCount;\
@@ -345,14 +450,19 @@ static cc_bool Heightmap_CalculateCoverage(int x1, int z1, int xCount, int zCoun
 	int lightOffset, offset;
 	int mapIndex, hIndex, baseIndex, index;
 	int x, y, z;
+	/* Rows of air can only be skipped when air doesn't block light */
+	cc_bool skipAir = !Blocks.BlocksLight[BLOCK_AIR];
 
 #ifndef EXTENDED_BLOCKS
-	Heightmap_CalculateBody(World.Blocks[mapIndex]);
+	Heightmap_CalculateBody(World.Blocks[mapIndex], 
+		ClassicLighting_IsRowEmpty(World.Blocks + mapIndex, xCount));
 #else
 	if (World.IDMask <= 0xFF) {
-		Heightmap_CalculateBody(World.Blocks[mapIndex]);
+		Heightmap_CalculateBody(World.Blocks[mapIndex], 
+			ClassicLighting_IsRowEmpty(World.Blocks + mapIndex, xCount));
 	} else {
-		Heightmap_CalculateBody(World.Blocks[mapIndex] | (World.Blocks2[mapIndex] << 8));
+		Heightmap_CalculateBody(World.Blocks[mapIndex] | (World_GetUpperBlock(mapIndex) << 8), 
+			ClassicLighting_IsRowEmpty(World.Blocks + mapIndex, xCount) && ClassicLighting_IsUpperRowEmpty(mapIndex, xCount));
 	}
 #endif
 	return false;
@@ -379,16 +489,27 @@ void ClassicLighting_LightHint(int startX, int startY, int startZ) {
 	int z1 = max(startZ, 0), z2 = min(World.Length, startZ + EXTCHUNK_SIZE);
 	int xCount = x2 - x1, zCount = z2 - z1;
 	int skip[EXTCHUNK_SIZE * EXTCHUNK_SIZE];
+	cc_uint64 beg = Stopwatch_Measure();
 
 	int elemsLeft = Heightmap_InitialCoverage(x1, z1, xCount, zCount, skip);
+	if (!elemsLeft) return;
+
 	if (!Heightmap_CalculateCoverage(x1, z1, xCount, zCount, elemsLeft, skip)) {
 		Heightmap_FinishCoverage(x1, z1, xCount, zCount);
 	}
+	heightmapTime += Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
 }
 
 void ClassicLighting_FreeState(void) {
+	int elapsed;
+	if (heightmapTime) {
+		elapsed = (int)(heightmapTime / 1000);
+		Platform_Log1("lighting heightmap took: %i", &elapsed);
+	}
+
 	Mem_Free(classic_heightmap);
 	classic_heightmap = NULL;
+	heightmapTime     = 0;
 }
 
 void ClassicLighting_AllocState(void) {
@@ -400,6 +521,15 @@ void ClassicLighting_AllocState(void) {
 	}
 }
 
+/* Heightmap lighting is cheap to update for each block change, so there's no need for batching */
+static void ClassicLighting_BeginBatch(void) { }
+static void ClassicLighting_EndBatch(void)   { }
+
+/* Lighting is always quickly calculated by LightHint, so there's no need to do it on other threads */
+static void ClassicLighting_QueueHint(int startX, int startY, int startZ) { }
+static int  ClassicLighting_NextQueuedGroup(void) { return 0; }
+static void ClassicLighting_CalcQueued(int task, int worker) { }
+
 static void ClassicLighting_SetActive(void) {
 	cc_bool smoothLighting = false;
 	if (!Game_ClassicMode) smoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
@@ -420,6 +550,13 @@ static void ClassicLighting_SetActive(void) {
 	Lighting.FreeState  = ClassicLighting_FreeState;
 	Lighting.AllocState = ClassicLighting_AllocState;
 	Lighting.LightHint  = ClassicLighting_LightHint;
+
+	Lighting.BeginBatch = ClassicLighting_BeginBatch;
+	Lighting.EndBatch   = ClassicLighting_EndBatch;
+
+	Lighting.QueueHint       = ClassicLighting_QueueHint;
+	Lighting.NextQueuedGroup = ClassicLighting_NextQueuedGroup;
+	Lighting.CalcQueued      = ClassicLighting_CalcQueued;
 }
 
 
@@ -440,13 +577,16 @@ static void Lighting_SwitchActive(void) {
 	Lighting.AllocState();
 }
 
+/* NOTE: Both lighting modes lazily calculate their state as chunks are built, so switching mode */
+/*  only needs to reallocate the state. The existing chunk meshes are then kept on screen until they */
+/*  are rebuilt (nearest first, with the usual per frame chunk update limits) with the new mode */
 static void Lighting_HandleModeChanged(void* obj, cc_uint8 oldMode, cc_bool fromServer) {
 	if (Lighting_Mode == oldMode) return;
 	Builder_ApplyActive();
 
 	if (World.Loaded) {
 		Lighting_SwitchActive();
-		MapRenderer_Refresh();
+		MapRenderer_RefreshBuiltChunks();
 	} else {
 		Lighting_ApplyActive();
 	}
@@ -37,6 +37,9 @@ void Lighting_SetMode(cc_uint8 mode, cc_bool fromServer);
 /* A byte that fills the lamp level area with ones. Equivalent to 0b_1111_0000 */
 #define FANCY_LIGHTING_LAMP_MASK 0xF0
 
+/* Max number of threads that can call Lighting.CalcQueued at the same time */
+#define LIGHTING_MAX_WORKERS 17
+
 CC_VAR extern struct _Lighting {
 	/* Releases/Frees the per-level lighting state */
 	void (*FreeState)(void);
@@ -47,9 +50,25 @@ CC_VAR extern struct _Lighting {
 	/*  [x, y, z] to [x + 18, y + 18, z + 18] */
 	void (*LightHint)(int startX, int startY, int startZ);
 
+	/* Queues up calculating most of what LightHint would calculate for the region, */
+	/*  which can then be calculated on multiple threads before LightHint is called */
+	void (*QueueHint)(int startX, int startY, int startZ);
+	/* Moves onto the next group of queued lighting tasks, returning the number of tasks */
+	/*  in the group. (0 once there are no more groups left, which also clears the queue) */
+	/* NOTE: Tasks in a group can run at the same time, but must finish before the next group */
+	int  (*NextQueuedGroup)(void);
+	/* Runs the given task from the current group of lighting tasks */
+	/* NOTE: worker must be different for each thread, and less than LIGHTING_MAX_WORKERS */
+	void (*CalcQueued)(int task, int worker);
+
 	/* Called when a block is changed to update internal lighting state. */
 	/* NOTE: Implementations ***MUST*** mark all chunks affected by this lighting change as needing to be refreshed. */
 	void (*OnBlockChanged)(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+	/* Starts a batch of many block changes, during which OnBlockChanged may just queue up */
+	/*  the change, so that lighting for all of the changes can be updated together at once */
+	void (*BeginBatch)(void);
+	/* Updates lighting for all of the block changes queued up since BeginBatch */
+	void (*EndBatch)(void);
 	/* Invalidates/Resets lighting state for all of the blocks in the world */
 	/*  (e.g. because a block changed whether it is full bright or not) */
 	void (*Refresh)(void);
@@ -86,6 +105,21 @@ void ClassicLighting_LightHint(int startX, int startY, int startZ);
 cc_bool ClassicLighting_IsLit(int x, int y, int z);
 cc_bool ClassicLighting_IsLit_Fast(int x, int y, int z);
 void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+/* Recalculates light height of each column in the region after many blocks in it were changed at once, */
+/*  then refreshes the chunks affected by the change in shadows */
+void ClassicLighting_OnRegionChanged(int minX, int minZ, int maxX, int maxY, int maxZ);
+/* Calculates light height of every column and copies them into the given heightmap */
+/* Returns false if the heightmap for the current world has not been allocated */
+cc_bool ClassicLighting_GetHeightmap(cc_int16* heightmap);
+/* Replaces light height of every column with the given (e.g. previously cached) values */
+void ClassicLighting_SetHeightmap(const cc_int16* heightmap);
+/* Returns whether every block in the given row of blocks is 0 (i.e. air) */
+/* NOTE: Also used for quickly calculating the weather heightmap in EnvRenderer */
+cc_bool ClassicLighting_IsRowEmpty(const BlockRaw* row, int count);
+#ifdef EXTENDED_BLOCKS
+/* Returns whether every block in the given row of blocks has no upper 8 bits set */
+cc_bool ClassicLighting_IsUpperRowEmpty(int index, int count);
+#endif
 
 CC_END_HEADER
 #endif
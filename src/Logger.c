@@ -96,6 +96,10 @@ static const char* GetCCErrorDesc(cc_result res) {
 	case CW_ERR_ROOT_TAG:   return "Invalid root NBT tag";
 	case CW_ERR_STRING_LEN: return "NBT string too long";
 
+	case CCR_ERR_VERSION:    return "Unsupported .ccr map version";
+	case CCR_ERR_DIMENSIONS: return "Invalid .ccr map dimensions";
+	case CHUNKED_ERR_SECTION: return "Invalid chunked map data";
+
 	case ERR_DOWNLOAD_INVALID: return "Website denied download or doesn't exist";
 	case ERR_NO_AUDIO_OUTPUT:  return "No audio output devices plugged in";
 	case ERR_INVALID_DATA_URL: return "Cannot download from invalid URL";
@@ -152,6 +156,7 @@ void Logger_Warn(cc_result res, const char* action, Logger_DescribeError describ
 	cc_string msg; char msgBuffer[256];
 	String_InitArray(msg, msgBuffer);
 
+	Logger_Trace(TRACE_EVENT_WARNING, res, 0);
 	Logger_FormatWarn(&msg, res, action, describeErr);
 	Logger_WarnFunc(&msg);
 }
@@ -160,6 +165,7 @@ void Logger_Warn2(cc_result res, const char* action, const cc_string* path, Logg
 	cc_string msg; char msgBuffer[256];
 	String_InitArray(msg, msgBuffer);
 
+	Logger_Trace(TRACE_EVENT_WARNING, res, 0);
 	Logger_FormatWarn2(&msg, res, action, path, describeErr);
 	Logger_WarnFunc(&msg);
 }
@@ -1244,6 +1250,229 @@ void Logger_Abort2(cc_result result, const char* raw_msg) {
 #endif
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Trace logging------------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_TRACELOG
+/* Each thread appends trace records to its own ring buffer, so recording an event never needs to lock */
+/* NOTE: Only the oldest records are overwritten once a ring buffer is full */
+/* NOTE: No memory barriers are used, so on weakly ordered CPUs a record being written */
+/*  at the same time as the flush thread reads it may occasionally be flushed partially written */
+#define TRACE_RING_SIZE 1024 /* must be power of two */
+#define TRACE_MAX_RINGS 16
+/* Threads started after all the other ring buffers have been claimed share the last ring buffer */
+#define TRACE_SHARED_RING (TRACE_MAX_RINGS - 1)
+/* How far back (in microseconds) records are dumped to client.log after a crash */
+#define TRACE_DUMP_TIME (5 * 1000 * 1000)
+#define TRACE_FLUSH_INTERVAL 1000
+
+struct TraceRecord { cc_uint64 time; cc_uint32 event, arg1, arg2; };
+struct TraceRing {
+	struct TraceRecord records[TRACE_RING_SIZE];
+	/* Total number of records ever written to this ring buffer */
+	volatile cc_uint32 head;
+	/* Total number of records written to the trace file (only accessed by the flush thread) */
+	cc_uint32 flushed;
+};
+
+static struct TraceRing* trace_rings[TRACE_MAX_RINGS];
+static int trace_claimed;
+static void* trace_mutex;
+static cc_uint64 trace_begin;
+static CC_THREADLOCAL struct TraceRing* trace_ring;
+
+static const char* const trace_names[TRACE_EVENT_COUNT] = {
+	"frame", "warning", "map loaded", "job"
+};
+
+void Logger_InitTrace(void) {
+	trace_mutex = Mutex_Create("Trace rings");
+	trace_begin = Stopwatch_Measure();
+}
+
+static CC_NOINLINE struct TraceRing* Trace_ClaimRing(void) {
+	struct TraceRing* ring;
+	int i;
+	if (!trace_mutex) return NULL;
+
+	Mutex_Lock(trace_mutex);
+	i = trace_claimed < TRACE_SHARED_RING ? trace_claimed : TRACE_SHARED_RING;
+	if (!trace_rings[i]) {
+		trace_rings[i] = (struct TraceRing*)Mem_TryAllocCleared(1, sizeof(struct TraceRing));
+	}
+
+	ring = trace_rings[i];
+	if (ring && i < TRACE_SHARED_RING) trace_claimed++;
+	Mutex_Unlock(trace_mutex);
+
+	trace_ring = ring;
+	return ring;
+}
+
+void Logger_Trace(cc_uint32 event, cc_uint32 arg1, cc_uint32 arg2) {
+	struct TraceRing* ring = trace_ring;
+	struct TraceRecord* rec;
+	cc_bool shared;
+
+	if (!ring && !(ring = Trace_ClaimRing())) return;
+	shared = ring == trace_rings[TRACE_SHARED_RING];
+	if (shared) Mutex_Lock(trace_mutex);
+
+	rec = &ring->records[ring->head & (TRACE_RING_SIZE - 1)];
+	rec->time  = Stopwatch_Measure();
+	rec->event = event;
+	rec->arg1  = arg1;
+	rec->arg2  = arg2;
+	ring->head++;
+
+	if (shared) Mutex_Unlock(trace_mutex);
+}
+
+/* Format: "[seconds].[micros] [ring] [event name] [arg1] [arg2]" */
+static void Trace_Format(cc_string* str, int ring, const struct TraceRecord* rec) {
+	cc_uint64 micros = Stopwatch_ElapsedMicroseconds(trace_begin, rec->time);
+	int secs = (int)(micros / 1000000), frac = (int)(micros % 1000000);
+	int event = (int)rec->event, arg1 = (int)rec->arg1, arg2 = (int)rec->arg2;
+
+	String_Format3(str, "%i.%p6 [%i] ", &secs, &frac, &ring);
+	if (rec->event < TRACE_EVENT_COUNT) {
+		String_AppendConst(str, trace_names[rec->event]);
+	} else {
+		String_Format1(str, "event %i", &event);
+	}
+	String_Format2(str, " %i %i" _NL, &arg1, &arg2);
+}
+
+/* Logs the records from the last few seconds before a crash to client.log */
+/* NOTE: Doesn't lock, as the thread that crashed may have been holding trace_mutex */
+static void DumpTrace(void) {
+	static const cc_string header = String_FromConst("-- trace --" _NL);
+	cc_string str; char strBuffer[128];
+	struct TraceRing* ring;
+	struct TraceRecord* rec;
+	cc_uint64 now = Stopwatch_Measure();
+	cc_uint32 i, head, count;
+	int r;
+
+	if (!trace_rings[0]) return;
+	Logger_Log(&header);
+
+	for (r = 0; r < TRACE_MAX_RINGS; r++) 
+	{
+		if (!(ring = trace_rings[r])) continue;
+		head  = ring->head;
+		count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+
+		for (i = head - count; i != head; i++) 
+		{
+			rec = &ring->records[i & (TRACE_RING_SIZE - 1)];
+			if (Stopwatch_ElapsedMicroseconds(rec->time, now) > TRACE_DUMP_TIME) continue;
+
+			String_InitArray(str, strBuffer);
+			Trace_Format(&str, r, rec);
+			Logger_Log(&str);
+		}
+	}
+}
+
+#ifndef CC_BUILD_MINFILES
+static struct Stream trace_file;
+static void* trace_thread;
+static void* trace_wakeup;
+static volatile cc_bool trace_quit;
+static cc_result trace_res;
+
+/* Writes any records added since the previous flush to the trace file */
+static cc_result Trace_Flush(void) {
+	cc_string str; char strBuffer[4096];
+	struct TraceRing* ring;
+	cc_uint32 head;
+	cc_result res;
+	int r;
+	String_InitArray(str, strBuffer);
+
+	for (r = 0; r < TRACE_MAX_RINGS; r++) 
+	{
+		if (!(ring = trace_rings[r])) continue;
+		head = ring->head;
+		/* Older records have already been overwritten */
+		if (head - ring->flushed > TRACE_RING_SIZE) ring->flushed = head - TRACE_RING_SIZE;
+
+		for (; ring->flushed != head; ring->flushed++)
+		{
+			Trace_Format(&str, r, &ring->records[ring->flushed & (TRACE_RING_SIZE - 1)]);
+			if (str.length < str.capacity - 128) continue;
+
+			if ((res = Stream_Write(&trace_file, (cc_uint8*)str.buffer, str.length))) return res;
+			str.length = 0;
+		}
+	}
+	return Stream_Write(&trace_file, (cc_uint8*)str.buffer, str.length);
+}
+
+static void TraceWorker_Run(void) {
+	cc_bool quit;
+
+	for (;;) {
+		quit      = trace_quit;
+		trace_res = Trace_Flush();
+		if (quit || trace_res) return;
+		Waitable_WaitFor(trace_wakeup, TRACE_FLUSH_INTERVAL);
+	}
+}
+
+cc_bool Logger_IsTraceFileOpen(void) { return trace_thread != NULL; }
+
+cc_result Logger_OpenTraceFile(const cc_string* path) {
+	cc_result res;
+	int r;
+	if (trace_thread) return 0;
+	if ((res = Stream_CreateFile(&trace_file, path))) return res;
+
+	/* Only write records that are added from now on */
+	Mutex_Lock(trace_mutex);
+	for (r = 0; r < TRACE_MAX_RINGS; r++) 
+	{
+		if (trace_rings[r]) trace_rings[r]->flushed = trace_rings[r]->head;
+	}
+	Mutex_Unlock(trace_mutex);
+
+	trace_quit   = false;
+	trace_res    = 0;
+	trace_wakeup = Waitable_Create("Trace flush wakeup");
+	Thread_Run(&trace_thread, TraceWorker_Run, 64 * 1024, "Trace flush");
+	return 0;
+}
+
+cc_result Logger_CloseTraceFile(void) {
+	cc_result res;
+	if (!trace_thread) return 0;
+
+	trace_quit = true;
+	Waitable_Signal(trace_wakeup);
+	Thread_Join(trace_thread);
+	Waitable_Free(trace_wakeup);
+	trace_thread = NULL;
+
+	res = trace_file.Close(&trace_file);
+	return trace_res ? trace_res : res;
+}
+#else
+cc_bool Logger_IsTraceFileOpen(void) { return false; }
+cc_result Logger_OpenTraceFile(const cc_string* path) { return ERR_NOT_SUPPORTED; }
+cc_result Logger_CloseTraceFile(void) { return 0; }
+#endif
+#else
+void Logger_InitTrace(void) { }
+void Logger_Trace(cc_uint32 event, cc_uint32 arg1, cc_uint32 arg2) { }
+static void DumpTrace(void) { }
+
+cc_bool Logger_IsTraceFileOpen(void) { return false; }
+cc_result Logger_OpenTraceFile(const cc_string* path) { return ERR_NOT_SUPPORTED; }
+cc_result Logger_CloseTraceFile(void) { return 0; }
+#endif
+
+
 /*########################################################################################################################*
 *----------------------------------------------------------Common---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -1328,6 +1557,7 @@ static void AbortCommon(cc_result result, const char* raw_msg, void* ctx) {
 	Logger_Log(&backtrace);
 	if (ctx) Logger_Backtrace(&msg, ctx);
 
+	DumpTrace();
 	DumpMisc();
 	CloseLogFile();
 
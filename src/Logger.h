@@ -58,5 +58,25 @@ void Logger_Abort(const char* raw_msg);
 CC_NOINLINE void Logger_Abort2(cc_result result, const char* raw_msg);
 void Logger_FailToStart(const char* raw_msg);
 
+enum TraceEvent_ {
+	TRACE_EVENT_FRAME,      /* arg1 = frame time in microseconds, arg2 = vertices rendered */
+	TRACE_EVENT_WARNING,    /* arg1 = error code */
+	TRACE_EVENT_MAP_LOADED, /* arg1 = map volume */
+	TRACE_EVENT_JOB,        /* arg1 = time spent running the job in microseconds */
+	TRACE_EVENT_COUNT
+};
+/* Initialises trace logging. (must be called before any other threads are started) */
+void Logger_InitTrace(void);
+/* Records a trace event with two event specific arguments, in a ring buffer for the current thread. */
+/* The most recent records are written to client.log when the game crashes. */
+/* NOTE: Event ids from TRACE_EVENT_COUNT onwards can be used by plugins */
+CC_API void Logger_Trace(cc_uint32 event, cc_uint32 arg1, cc_uint32 arg2);
+/* Whether trace records are currently being written to a file. */
+cc_bool Logger_IsTraceFileOpen(void);
+/* Starts writing all newly recorded trace records to the given file, on a background thread. */
+cc_result Logger_OpenTraceFile(const cc_string* path);
+/* Stops writing trace records to the file, then closes it. */
+cc_result Logger_CloseTraceFile(void);
+
 CC_END_HEADER
 #endif
@@ -9,11 +9,13 @@
 #include "Funcs.h"
 #include "Game.h"
 #include "Graphics.h"
+#include "Lighting.h"
 #include "Platform.h"
 #include "TexturePack.h"
 #include "Utils.h"
 #include "World.h"
 #include "Options.h"
+#define MEM_SUBSYSTEM MEM_SYS_CHUNKS
 
 int MapRenderer_1DUsedCount;
 struct ChunkPartInfo* MapRenderer_PartsNormal;
@@ -21,6 +23,10 @@ struct ChunkPartInfo* MapRenderer_PartsTranslucent;
 
 static cc_bool inTranslucent;
 static IVec3 chunkPos;
+/* Whether opaque chunk parts are first drawn only to the depth buffer, so that each pixel is only shaded once */
+static cc_bool depthPrepass;
+/* Whether translucent chunk parts are drawn back to front, instead of filling the depth buffer first */
+static cc_bool sortTranslucent;
 
 /* The number of non-empty Normal/Translucent ChunkPartInfos (across entire world) for each 1D atlas batch. */
 /* 1D atlas batches that do not have any ChunkPartInfos can be entirely skipped. */
@@ -42,10 +48,34 @@ static struct ChunkInfo** renderChunks;
 static int renderChunksCount;
 /* Distance of each chunk from the camera. */
 static cc_uint32* distances;
+/* Temporary storage used while sorting sortedChunks and distances */
+static struct ChunkInfo** sortTemp;
+static cc_uint32* distancesTemp;
 /* Maximum number of chunk updates that can be performed in one frame. */
 static int maxChunkUpdates;
 /* Cached number of chunks in the world */
 static int chunksCount;
+/* Bounds of each chunk's mesh, or of the whole chunk when it hasn't been built yet */
+/* NOTE: Structure of arrays in the same order as mapChunks, so they can be culled in batches */
+static struct FrustumBoxes chunkBounds;
+/* Whether each chunk's bounds are at least partially inside the view frustum */
+static cc_uint8* chunkInFrustum;
+#define ChunkInFrustum(info) chunkInFrustum[(info) - mapChunks]
+
+/* Padding added to the blocks a chunk's mesh covers, since e.g. sprites can be offset outside their block */
+#define CHUNK_BOUNDS_PADDING 0.5f
+
+void MapRenderer_SetChunkBounds(struct ChunkInfo* info, int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	int i = (int)(info - mapChunks);
+	chunkBounds.minX[i] = minX - CHUNK_BOUNDS_PADDING; chunkBounds.maxX[i] = maxX + CHUNK_BOUNDS_PADDING;
+	chunkBounds.minY[i] = minY - CHUNK_BOUNDS_PADDING; chunkBounds.maxY[i] = maxY + CHUNK_BOUNDS_PADDING;
+	chunkBounds.minZ[i] = minZ - CHUNK_BOUNDS_PADDING; chunkBounds.maxZ[i] = maxZ + CHUNK_BOUNDS_PADDING;
+}
+
+static void ResetChunkBounds(struct ChunkInfo* info) {
+	int x = info->centreX - HALF_CHUNK_SIZE, y = info->centreY - HALF_CHUNK_SIZE, z = info->centreZ - HALF_CHUNK_SIZE;
+	MapRenderer_SetChunkBounds(info, x, y, z, x + CHUNK_SIZE, y + CHUNK_SIZE, z + CHUNK_SIZE);
+}
 
 static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->centreX = x + HALF_CHUNK_SIZE; chunk->centreY = y + HALF_CHUNK_SIZE; 
@@ -59,12 +89,16 @@ static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->dirty   = false; 
 	chunk->allAir  = false;
 	chunk->noData  = true;
+	chunk->occluded     = false;
+	chunk->lod          = 0;
+	chunk->connectivity = CHUNK_ALL_CONNECTED;
 
 	chunk->drawXMin = false; chunk->drawXMax = false; chunk->drawZMin = false;
 	chunk->drawZMax = false; chunk->drawYMin = false; chunk->drawYMax = false;
 
 	chunk->normalParts      = NULL;
 	chunk->translucentParts = NULL;
+	ResetChunkBounds(chunk);
 }
 
 /* Index of maximum used 1D atlas + 1 */
@@ -95,23 +129,91 @@ static void CheckWeather(float delta) {
 	/* If we are under water, render weather before to blend properly */
 	if (!inTranslucent || Env.Weather == WEATHER_SUNNY) return;
 	Gfx_SetAlphaBlending(true);
+	Game_BeginProfile(PROFILE_WEATHER);
 	EnvRenderer_RenderWeather(delta);
+	Game_EndProfile();
 	Gfx_SetAlphaBlending(false);
 }
 
+/* Chunk meshes are built with fixed point vertices when supported (see Builder_MakeChunk) */
+#define ChunkVertexFormat() (Gfx.SupportsChunkVertices ? VERTEX_FORMAT_CHUNK : VERTEX_FORMAT_TEXTURED)
+#define ChunkVertexSize()   (Gfx.SupportsChunkVertices ? SIZEOF_VERTEX_CHUNK : SIZEOF_VERTEX_TEXTURED)
+
+#ifdef CC_BUILD_CHUNKARENA
+#define ChunkMeshVertexSize() ChunkVertexSize()
+#else
+#define ChunkMeshVertexSize() SIZEOF_VERTEX_TEXTURED
+#endif
+/* Number of vertices in the mesh of the given chunk part */
+#define ChunkPart_Vertices(part) ((part)->spriteCount + (part)->counts[FACE_XMIN] + (part)->counts[FACE_XMAX] + \
+	(part)->counts[FACE_ZMIN] + (part)->counts[FACE_ZMAX] + (part)->counts[FACE_YMIN] + (part)->counts[FACE_YMAX])
+
+cc_uint32 MapRenderer_MeshBytes;
+cc_uint32 MapRenderer_MeshBudget;
+
+#ifdef CC_BUILD_CHUNKARENA
+#define ChunkVbOffset(info) (info)->vbOffset
+#else
+#define ChunkVbOffset(info) 0
+#endif
+
 #ifdef CC_BUILD_GL11
 #define DrawFace(face, ign)    Gfx_BindVb(part.vbs[face]); Gfx_DrawIndexedTris_T2fC4b(0, 0);
 #define DrawFaces(f1, f2, ign) DrawFace(f1, ign); DrawFace(f2, ign);
+#define DrawCulledFaces(f1, f2, ign) Gfx_SetFaceCulling(true); DrawFaces(f1, f2, ign); Gfx_SetFaceCulling(false);
+#define DrawChunkRanges()
 #else
-#define DrawFace(face, offset)    Gfx_DrawIndexedTris_T2fC4b(part.counts[face], offset);
-#define DrawFaces(f1, f2, offset) Gfx_DrawIndexedTris_T2fC4b(part.counts[f1] + part.counts[f2], offset);
+#define DrawFace(face, offset)    AddDrawRange(&drawRanges, part.counts[face], offset);
+#define DrawFaces(f1, f2, offset) AddDrawRange(&drawRanges, part.counts[f1] + part.counts[f2], offset);
+#define DrawCulledFaces(f1, f2, offset) AddDrawRange(&culledRanges, part.counts[f1] + part.counts[f2], offset);
+
+/* Ranges of the current chunk's vertices to draw, which are then all drawn at once by DrawChunkRanges */
+/* NOTE: A range directly following the previously added range is merged into that range */
+static struct DrawRanges {
+	int count;
+	int counts[GFX_MAX_DRAW_RANGES], starts[GFX_MAX_DRAW_RANGES];
+} drawRanges, culledRanges;
+
+static void AddDrawRange(struct DrawRanges* r, int count, int start) {
+	int last = r->count - 1;
+	if (last >= 0 && r->starts[last] + r->counts[last] == start) {
+		r->counts[last] += count; return;
+	}
+
+	r->counts[r->count] = count;
+	r->starts[r->count] = start;
+	r->count++;
+}
+
+static void FlushDrawRanges(struct DrawRanges* r) {
+	int i;
+#if CC_GFX_BACKEND_IS_GL()
+	if (Gfx.SupportsMultiDraw && r->count > 1) {
+		Gfx_DrawIndexedTris_T2fC4b_Multi(r->counts, r->starts, r->count);
+		r->count = 0; return;
+	}
+#endif
+
+	for (i = 0; i < r->count; i++) 
+	{
+		Gfx_DrawIndexedTris_T2fC4b(r->counts[i], r->starts[i]);
+	}
+	r->count = 0;
+}
+
+static void DrawChunkRanges(void) {
+	if (culledRanges.count) {
+		Gfx_SetFaceCulling(true);
+		FlushDrawRanges(&culledRanges);
+		Gfx_SetFaceCulling(false);
+	}
+	FlushDrawRanges(&drawRanges);
+}
 #endif
 
 #define DrawNormalFaces(minFace, maxFace) \
 if (drawMin && drawMax) { \
-	Gfx_SetFaceCulling(true); \
-	DrawFaces(minFace, maxFace, offset); \
-	Gfx_SetFaceCulling(false); \
+	DrawCulledFaces(minFace, maxFace, offset); \
 	Game_Vertices += (part.counts[minFace] + part.counts[maxFace]); \
 } else if (drawMin) { \
 	DrawFace(minFace, offset); \
@@ -138,9 +240,10 @@ static void RenderNormalBatch(int batch) {
 
 #ifndef CC_BUILD_GL11
 		Gfx_BindVb_Textured(info->vb);
+		Gfx_SetChunkOffset(info->centreX - 8, info->centreY - 8, info->centreZ - 8);
 #endif
 
-		offset  = part.offset + part.spriteCount;
+		offset  = ChunkVbOffset(info) + part.offset + part.spriteCount;
 		drawMin = info->drawXMin && part.counts[FACE_XMIN];
 		drawMax = info->drawXMax && part.counts[FACE_XMAX];
 		DrawNormalFaces(FACE_XMIN, FACE_XMAX);
@@ -155,46 +258,67 @@ static void RenderNormalBatch(int batch) {
 		drawMax = info->drawYMax && part.counts[FACE_YMAX];
 		DrawNormalFaces(FACE_YMIN, FACE_YMAX);
 
-		if (!part.spriteCount) continue;
-		offset = part.offset;
+		if (!part.spriteCount) { DrawChunkRanges(); continue; }
+		offset = ChunkVbOffset(info) + part.offset;
 		count  = part.spriteCount >> 2; /* 4 per sprite */
 
-		Gfx_SetFaceCulling(true);
 		/* TODO: fix to not render them all */
 #ifdef CC_BUILD_GL11
+		Gfx_SetFaceCulling(true);
 		Gfx_BindVb(part.vbs[FACE_COUNT]);
 		Gfx_DrawIndexedTris_T2fC4b(0, 0);
 		Game_Vertices += count * 4;
 		Gfx_SetFaceCulling(false);
-		continue;
-#endif
+#else
 		if (info->drawXMax || info->drawZMin) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			AddDrawRange(&culledRanges, count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->drawXMin || info->drawZMax) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			AddDrawRange(&culledRanges, count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->drawXMin || info->drawZMin) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			AddDrawRange(&culledRanges, count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->drawXMax || info->drawZMax) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			AddDrawRange(&culledRanges, count, offset); Game_Vertices += count;
 		}
-		Gfx_SetFaceCulling(false);
+		DrawChunkRanges();
+#endif
 	}
 }
 
 void MapRenderer_RenderNormal(float delta) {
-	int batch;
+	int vertices, batch;
 	if (!mapChunks) return;
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_SetVertexFormat(ChunkVertexFormat());
 	Gfx_SetAlphaTest(true);
-	
 	Gfx_EnableMipmaps();
+
+	if (depthPrepass) {
+		/* First fill depth buffer (texture still needed for alpha tested blocks such as leaves) */
+		vertices = Game_Vertices;
+		Gfx_DepthOnlyRendering(true);
+
+		for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+		{
+			if (normPartsCount[batch] <= 0) continue;
+			if (hasNormParts[batch] || checkNormParts[batch]) {
+				Atlas1D_Bind(batch);
+				RenderNormalBatch(batch);
+				checkNormParts[batch] = false;
+			}
+		}
+		Game_Vertices = vertices;
+
+		/* Then only shade the closest surface of each pixel */
+		Gfx_DepthOnlyRendering(false);
+		Gfx_SetDepthWrite(false);
+	}
+
 	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
 	{
 		if (normPartsCount[batch] <= 0) continue;
@@ -204,13 +328,12 @@ void MapRenderer_RenderNormal(float delta) {
 			checkNormParts[batch] = false;
 		}
 	}
+
 	Gfx_DisableMipmaps();
+	if (depthPrepass) Gfx_SetDepthWrite(true);
 
 	CheckWeather(delta);
 	Gfx_SetAlphaTest(false);
-#if DEBUG_OCCLUSION
-	DebugPickedPos();
-#endif
 }
 
 #define DrawTranslucentFaces(minFace, maxFace) \
@@ -233,7 +356,8 @@ static void RenderTranslucentBatch(int batch) {
 	int i, offset;
 
 	for (i = 0; i < renderChunksCount; i++) {
-		info = renderChunks[i];
+		/* renderChunks is sorted front to back */
+		info = renderChunks[sortTranslucent ? renderChunksCount - 1 - i : i];
 		if (!info->translucentParts) continue;
 
 		part = info->translucentParts[batchOffset];
@@ -242,9 +366,10 @@ static void RenderTranslucentBatch(int batch) {
 
 #ifndef CC_BUILD_GL11
 		Gfx_BindVb_Textured(info->vb);
+		Gfx_SetChunkOffset(info->centreX - 8, info->centreY - 8, info->centreZ - 8);
 #endif
 
-		offset  = part.offset;
+		offset  = ChunkVbOffset(info) + part.offset;
 		drawMin = (inTranslucent || info->drawXMin) && part.counts[FACE_XMIN];
 		drawMax = (inTranslucent || info->drawXMax) && part.counts[FACE_XMAX];
 		DrawTranslucentFaces(FACE_XMIN, FACE_XMAX);
@@ -258,6 +383,7 @@ static void RenderTranslucentBatch(int batch) {
 		drawMin = (inTranslucent || info->drawYMin) && part.counts[FACE_YMIN];
 		drawMax = (inTranslucent || info->drawYMax) && part.counts[FACE_YMAX];
 		DrawTranslucentFaces(FACE_YMIN, FACE_YMAX);
+		DrawChunkRanges();
 	}
 }
 
@@ -265,35 +391,53 @@ void MapRenderer_RenderTranslucent(float delta) {
 	int vertices, batch;
 	if (!mapChunks) return;
 
-	/* First fill depth buffer */
-	vertices = Game_Vertices;
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
-	Gfx_SetAlphaBlending(false);
-	Gfx_DepthOnlyRendering(true);
-
-	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
-	{
-		if (tranPartsCount[batch] <= 0) continue;
-		if (hasTranParts[batch] || checkTranParts[batch]) {
-			RenderTranslucentBatch(batch);
-			checkTranParts[batch] = false;
+	Gfx_SetVertexFormat(ChunkVertexFormat());
+
+	if (sortTranslucent) {
+		/* Chunks are drawn back to front, so depth testing is only needed within each chunk */
+		/* NOTE: Sorting is only per 1D atlas batch, which is fine as most maps only use one batch */
+		Gfx_SetAlphaBlending(true);
+		Gfx_EnableMipmaps();
+
+		for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+		{
+			if (tranPartsCount[batch] <= 0) continue;
+			if (hasTranParts[batch] || checkTranParts[batch]) {
+				Atlas1D_Bind(batch);
+				RenderTranslucentBatch(batch);
+				checkTranParts[batch] = false;
+			}
 		}
-	}
-	Game_Vertices = vertices;
+	} else {
+		/* First fill depth buffer */
+		vertices = Game_Vertices;
+		Gfx_SetAlphaBlending(false);
+		Gfx_DepthOnlyRendering(true);
+
+		for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+		{
+			if (tranPartsCount[batch] <= 0) continue;
+			if (hasTranParts[batch] || checkTranParts[batch]) {
+				RenderTranslucentBatch(batch);
+				checkTranParts[batch] = false;
+			}
+		}
+		Game_Vertices = vertices;
 
-	/* Then actually draw the transluscent blocks */
-	Gfx_SetAlphaBlending(true);
-	Gfx_DepthOnlyRendering(false);
-	Gfx_SetDepthWrite(false); /* already calculated depth values in depth pass */
+		/* Then actually draw the transluscent blocks */
+		Gfx_SetAlphaBlending(true);
+		Gfx_DepthOnlyRendering(false);
+		Gfx_SetDepthWrite(false); /* already calculated depth values in depth pass */
 
-	Gfx_EnableMipmaps();
-	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
-	{
-		if (tranPartsCount[batch] <= 0) continue;
-		if (!hasTranParts[batch]) continue;
+		Gfx_EnableMipmaps();
+		for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+		{
+			if (tranPartsCount[batch] <= 0) continue;
+			if (!hasTranParts[batch]) continue;
 
-		Atlas1D_Bind(batch);
-		RenderTranslucentBatch(batch);
+			Atlas1D_Bind(batch);
+			RenderTranslucentBatch(batch);
+		}
 	}
 	Gfx_DisableMipmaps();
 
@@ -301,22 +445,369 @@ void MapRenderer_RenderTranslucent(float delta) {
 	/* If we weren't under water, render weather after to blend properly */
 	if (!inTranslucent && Env.Weather != WEATHER_SUNNY) {
 		Gfx_SetAlphaTest(true);
+		Game_BeginProfile(PROFILE_WEATHER);
 		EnvRenderer_RenderWeather(delta);
+		Game_EndProfile();
 		Gfx_SetAlphaTest(false);
 	}
 	Gfx_SetAlphaBlending(false);
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------Occlusion culling----------------------------------------------------*
+*#########################################################################################################################*/
+/* Chunks are only visible when they can be reached from the camera's chunk by travelling through */
+/*  connected faces of chunks, while never travelling back towards the camera. (i.e. chunks in caves */
+/*  far underground are never rendered when the camera is above ground, and vice versa) */
+static cc_bool occlusionCulling, occlusionDirty;
+/* Queue of chunks to visit. Chunks are only ever added at most once to this */
+static int* occlusionQueue;
+static int occlusionCount;
+/* Bit for each chunk face travelled through to reach each chunk (0 if chunk not reached) */
+static cc_uint8* occlusionDirs;
+/* Face of each chunk that it was entered through (FACE_COUNT if camera is inside the chunk) */
+static cc_uint8* occlusionEntry;
+#define OCCLUSION_REACHED 0x80
+
+static const cc_int8 occlusionOffsets[FACE_COUNT][3] = {
+	{ -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 }
+};
+
+static void Occlusion_Visit(int cx, int cy, int cz, int entry, int dirs, int maxDistSqr) {
+	struct ChunkInfo* info;
+	int index, dx, dy, dz;
+	if (cx < 0 || cy < 0 || cz < 0 || cx >= World.ChunksX || cy >= World.ChunksY || cz >= World.ChunksZ) return;
+
+	index = World_ChunkPack(cx, cy, cz);
+	if (occlusionDirs[index]) return;
+	info  = &mapChunks[index];
+
+	/* Chunks past render distance are never visible anyway */
+	dx = info->centreX - chunkPos.x; dy = info->centreY - chunkPos.y; dz = info->centreZ - chunkPos.z;
+	if (dx * dx + dy * dy + dz * dz > maxDistSqr) return;
+
+	info->occluded        = false;
+	occlusionDirs[index]  = dirs | OCCLUSION_REACHED;
+	occlusionEntry[index] = entry;
+	occlusionQueue[occlusionCount++] = index;
+}
+
+/* Enters the map through all the chunks on the given side of the map */
+static void Occlusion_VisitSide(Face entry, int maxDistSqr) {
+	int a, b, aMax, bMax;
+	int dir = 1 << (entry ^ 1);
+
+	if (entry <= FACE_XMAX) {
+		aMax = World.ChunksY; bMax = World.ChunksZ;
+	} else if (entry <= FACE_ZMAX) {
+		aMax = World.ChunksX; bMax = World.ChunksY;
+	} else {
+		aMax = World.ChunksX; bMax = World.ChunksZ;
+	}
+
+	for (a = 0; a < aMax; a++) {
+		for (b = 0; b < bMax; b++) {
+			switch (entry) {
+			case FACE_XMIN: Occlusion_Visit(0,                  a, b, entry, dir, maxDistSqr); break;
+			case FACE_XMAX: Occlusion_Visit(World.ChunksX - 1,  a, b, entry, dir, maxDistSqr); break;
+			case FACE_ZMIN: Occlusion_Visit(a, b,                  0, entry, dir, maxDistSqr); break;
+			case FACE_ZMAX: Occlusion_Visit(a, b, World.ChunksZ - 1,  entry, dir, maxDistSqr); break;
+			case FACE_YMIN: Occlusion_Visit(a,                  0, b, entry, dir, maxDistSqr); break;
+			case FACE_YMAX: Occlusion_Visit(a, World.ChunksY - 1,  b, entry, dir, maxDistSqr); break;
+			}
+		}
+	}
+}
+
+/* Recalculates which chunks are occluded from the camera */
+static void UpdateOcclusion(int maxDistSqr) {
+	struct ChunkInfo* info;
+	int i, face, entry, dirs;
+	int cx, cy, cz;
+	occlusionDirty = false;
+
+	for (i = 0; i < chunksCount; i++) {
+		mapChunks[i].occluded = occlusionCulling;
+		occlusionDirs[i]      = 0;
+	}
+	if (!occlusionCulling) return;
+
+	occlusionCount = 0;
+	cx = chunkPos.x >> CHUNK_SHIFT; cy = chunkPos.y >> CHUNK_SHIFT; cz = chunkPos.z >> CHUNK_SHIFT;
+
+	if (cx >= 0 && cy >= 0 && cz >= 0 && cx < World.ChunksX && cy < World.ChunksY && cz < World.ChunksZ) {
+		Occlusion_Visit(cx, cy, cz, FACE_COUNT, 0, maxDistSqr);
+	} else {
+		/* Camera is outside the map, so enter through the sides of the map facing the camera */
+		if (cx < 0)              Occlusion_VisitSide(FACE_XMIN, maxDistSqr);
+		if (cx >= World.ChunksX) Occlusion_VisitSide(FACE_XMAX, maxDistSqr);
+		if (cz < 0)              Occlusion_VisitSide(FACE_ZMIN, maxDistSqr);
+		if (cz >= World.ChunksZ) Occlusion_VisitSide(FACE_ZMAX, maxDistSqr);
+		if (cy < 0)              Occlusion_VisitSide(FACE_YMIN, maxDistSqr);
+		if (cy >= World.ChunksY) Occlusion_VisitSide(FACE_YMAX, maxDistSqr);
+	}
+
+	for (i = 0; i < occlusionCount; i++) {
+		info  = &mapChunks[occlusionQueue[i]];
+		entry = occlusionEntry[occlusionQueue[i]];
+		dirs  = occlusionDirs[occlusionQueue[i]] & ~OCCLUSION_REACHED;
+
+		cx = info->centreX >> CHUNK_SHIFT; cy = info->centreY >> CHUNK_SHIFT; cz = info->centreZ >> CHUNK_SHIFT;
+
+		for (face = 0; face < FACE_COUNT; face++) {
+			/* Never travel back towards the camera */
+			if (dirs & (1 << (face ^ 1))) continue;
+			if (entry != FACE_COUNT && !(info->connectivity & Chunk_FacesBit(entry, face))) continue;
+
+			Occlusion_Visit(cx + occlusionOffsets[face][0], cy + occlusionOffsets[face][1], 
+							cz + occlusionOffsets[face][2], face ^ 1, dirs | (1 << face), maxDistSqr);
+		}
+	}
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Chunk vertex arena----------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_CHUNKARENA
+/* Chunk meshes are stored in ranges of a few large vertex buffers ('pages'), instead of a vertex buffer per chunk. */
+/* Ranges are rounded up to a power of two number of vertices ('size class'), and freed ranges */
+/*  are kept in a list per size class, so rebuilding chunks doesn't create or delete vertex buffers. */
+/* NOTE: Pages are GFX_MAX_VERTICES large so any range can be drawn with the default index buffer */
+#define ARENA_MIN_CLASS  8 /* 256 vertices */
+#define ARENA_MAX_CLASS 16 /* GFX_MAX_VERTICES vertices */
+#define ARENA_DEDICATED  0 /* Mesh is too large for a page, so has its own vertex buffer */
+
+struct ArenaRange { GfxResourceID vb; int offset; };
+static struct ArenaFreeList { 
+	struct ArenaRange* ranges; 
+	int count, capacity; 
+} arenaFree[ARENA_MAX_CLASS + 1];
+
+static GfxResourceID* arenaPages;
+static int arenaPagesCount, arenaPagesCapacity;
+/* Number of vertices allocated so far from the most recently created page */
+static int arenaPageUsed;
+#ifdef CC_BUILD_CHUNKSHADOW
+/* Copy of the contents of each page, for reuploading after the context is lost */
+static cc_uint8** arenaShadows;
+/* Vertex buffers the pages had before the context was lost */
+static GfxResourceID* arenaLostPages;
+#endif
+
+static void Arena_AddFree(int sizeClass, GfxResourceID vb, int offset) {
+	struct ArenaFreeList* list = &arenaFree[sizeClass];
+	if (list->count == list->capacity) {
+		list->capacity = max(32, list->capacity * 2);
+		list->ranges   = (struct ArenaRange*)Mem_Realloc(list->ranges, list->capacity, 
+												sizeof(struct ArenaRange), "arena free ranges");
+	}
+
+	list->ranges[list->count].vb     = vb;
+	list->ranges[list->count].offset = offset;
+	list->count++;
+}
+
+/* Adds the unallocated remainder of the current page to the free lists, then creates a new page */
+static cc_bool Arena_NewPage(void) {
+	GfxResourceID vb;
+	int sizeClass, remaining;
+
+	if (arenaPagesCount) {
+		vb        = arenaPages[arenaPagesCount - 1];
+		remaining = GFX_MAX_VERTICES - arenaPageUsed;
+
+		/* Remainder is always a multiple of the smallest size class */
+		for (sizeClass = ARENA_MIN_CLASS; sizeClass < ARENA_MAX_CLASS; sizeClass++) 
+		{
+			if (!(remaining & (1 << sizeClass))) continue;
+			Arena_AddFree(sizeClass, vb, arenaPageUsed);
+			arenaPageUsed += 1 << sizeClass;
+		}
+	}
+
+	vb = Gfx_CreateDynamicVb(ChunkVertexFormat(), GFX_MAX_VERTICES);
+	if (!vb) return false;
+
+	if (arenaPagesCount == arenaPagesCapacity) {
+		arenaPagesCapacity = max(8, arenaPagesCapacity * 2);
+		arenaPages = (GfxResourceID*)Mem_Realloc(arenaPages, arenaPagesCapacity, 
+												sizeof(GfxResourceID), "arena pages");
+#ifdef CC_BUILD_CHUNKSHADOW
+		arenaShadows = (cc_uint8**)Mem_Realloc(arenaShadows, arenaPagesCapacity,
+												sizeof(cc_uint8*), "arena shadows");
+#endif
+	}
+#ifdef CC_BUILD_CHUNKSHADOW
+	arenaShadows[arenaPagesCount] = (cc_uint8*)Mem_TryAlloc(GFX_MAX_VERTICES, ChunkVertexSize());
+	if (!arenaShadows[arenaPagesCount]) { Gfx_DeleteDynamicVb(&vb); return false; }
+#endif
+
+	arenaPages[arenaPagesCount++] = vb;
+	arenaPageUsed = 0;
+	return true;
+}
+
+#ifdef CC_BUILD_CHUNKSHADOW
+static void Arena_CopyToShadow(GfxResourceID vb, int offset, void* vertices, int count) {
+	int i, stride = ChunkVertexSize();
+
+	for (i = 0; i < arenaPagesCount; i++) 
+	{
+		if (arenaPages[i] != vb) continue;
+		Mem_Copy(arenaShadows[i] + offset * stride, vertices, count * stride);
+		return;
+	}
+}
+
+/* Deletes the vertex buffers of all pages, but keeps their contents and free ranges */
+static void Arena_LosePages(void) {
+	int i;
+	if (!arenaPagesCount) return;
+	arenaLostPages = (GfxResourceID*)Mem_Realloc(arenaLostPages, arenaPagesCount, 
+												sizeof(GfxResourceID), "arena lost pages");
+
+	for (i = 0; i < arenaPagesCount; i++) 
+	{
+		arenaLostPages[i] = arenaPages[i];
+		Gfx_DeleteDynamicVb(&arenaPages[i]);
+	}
+}
+
+static GfxResourceID Arena_RemapLost(GfxResourceID vb) {
+	int i;
+	for (i = 0; i < arenaPagesCount; i++) 
+	{
+		if (arenaLostPages[i] == vb) return arenaPages[i];
+	}
+	return vb;
+}
+
+/* Recreates the vertex buffers of all pages, then reuploads their contents */
+/* NOTE: Chunks must then be updated to use the new vertex buffers using Arena_RemapLost */
+static cc_bool Arena_RestorePages(void) {
+	struct ArenaFreeList* list;
+	VertexFormat fmt = ChunkVertexFormat();
+	int i, j, used;
+
+	for (i = 0; i < arenaPagesCount; i++) 
+	{
+		arenaPages[i] = Gfx_CreateDynamicVb(fmt, GFX_MAX_VERTICES);
+		if (!arenaPages[i]) return false;
+
+		used = i == arenaPagesCount - 1 ? arenaPageUsed : GFX_MAX_VERTICES;
+		if (used) Gfx_SetDynamicVbRange(arenaPages[i], fmt, 0, arenaShadows[i], used);
+	}
+
+	for (i = 0; i <= ARENA_MAX_CLASS; i++) 
+	{
+		list = &arenaFree[i];
+		for (j = 0; j < list->count; j++) 
+		{
+			list->ranges[j].vb = Arena_RemapLost(list->ranges[j].vb);
+		}
+	}
+	return true;
+}
+#endif
+
+void MapRenderer_UploadChunk(struct ChunkInfo* info, void* vertices, int count) {
+	VertexFormat fmt = ChunkVertexFormat();
+	struct ArenaFreeList* list;
+	int sizeClass, size;
+
+	/* add an extra element to fix crashing on some GPUs */
+	for (sizeClass = ARENA_MIN_CLASS; (1 << sizeClass) < count + 1; sizeClass++) { }
+	size = 1 << sizeClass;
+	list = sizeClass <= ARENA_MAX_CLASS ? &arenaFree[sizeClass] : NULL;
+
+	if (!list) {
+		info->vb       = Gfx_CreateDynamicVb(fmt, count + 1);
+		info->vbOffset = 0;
+		sizeClass      = ARENA_DEDICATED;
+	} else if (list->count) {
+		list->count--;
+		info->vb       = list->ranges[list->count].vb;
+		info->vbOffset = list->ranges[list->count].offset;
+	} else {
+		if (!arenaPagesCount || arenaPageUsed + size > GFX_MAX_VERTICES) {
+			if (!Arena_NewPage()) return;
+		}
+
+		info->vb       = arenaPages[arenaPagesCount - 1];
+		info->vbOffset = arenaPageUsed;
+		arenaPageUsed += size;
+	}
+
+	info->vbClass = sizeClass;
+	if (!info->vb) return;
+	Gfx_SetDynamicVbRange(info->vb, fmt, info->vbOffset, vertices, count);
+
+#ifdef CC_BUILD_CHUNKSHADOW
+	if (sizeClass != ARENA_DEDICATED) Arena_CopyToShadow(info->vb, info->vbOffset, vertices, count);
+#endif
+}
+
+static void Arena_FreeChunk(struct ChunkInfo* info) {
+	if (!info->vb) return;
+
+	if (info->vbClass == ARENA_DEDICATED) {
+		Gfx_DeleteDynamicVb(&info->vb);
+	} else {
+		Arena_AddFree(info->vbClass, info->vb, info->vbOffset);
+		info->vb = 0;
+	}
+}
+
+/* Deletes all pages and free ranges */
+/* NOTE: All chunks must have been deleted before calling this */
+static void Arena_Reset(void) {
+	int i;
+	for (i = 0; i < arenaPagesCount; i++) 
+	{
+		Gfx_DeleteDynamicVb(&arenaPages[i]);
+	}
+	for (i = 0; i <= ARENA_MAX_CLASS; i++) 
+	{
+		Mem_Free(arenaFree[i].ranges);
+		arenaFree[i].ranges   = NULL;
+		arenaFree[i].count    = 0;
+		arenaFree[i].capacity = 0;
+	}
+
+#ifdef CC_BUILD_CHUNKSHADOW
+	for (i = 0; i < arenaPagesCount; i++) 
+	{
+		Mem_Free(arenaShadows[i]);
+	}
+	Mem_Free(arenaShadows);
+	Mem_Free(arenaLostPages);
+	arenaShadows   = NULL;
+	arenaLostPages = NULL;
+#endif
+
+	Mem_Free(arenaPages);
+	arenaPages         = NULL;
+	arenaPagesCount    = 0;
+	arenaPagesCapacity = 0;
+	arenaPageUsed      = 0;
+}
+#endif
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Chunk functionality---------------------------------------------------*
 *#########################################################################################################################*/
 /* Deletes vertex buffer associated with the given chunk and updates internal state */
 static void DeleteChunk(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
+	cc_uint32 vertices = 0;
 	int i;
-#ifdef CC_BUILD_GL11
+#if defined CC_BUILD_GL11
 	int j;
+#elif defined CC_BUILD_CHUNKARENA
+	Arena_FreeChunk(info);
 #else
 	Gfx_DeleteVb(&info->vb);
 #endif
@@ -324,16 +815,14 @@ static void DeleteChunk(struct ChunkInfo* info) {
 	info->empty  = false; 
 	info->allAir = false;
 	info->noData = true;
-#ifdef OCCLUSION
-	info.OcclusionFlags = 0;
-	info.OccludedFlags = 0;
-#endif
+	ResetChunkBounds(info);
 
 	if (info->normalParts) {
 		ptr = info->normalParts;
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
 			if (ptr->offset < 0) continue; 
 			normPartsCount[i]--;
+			vertices += ChunkPart_Vertices(ptr);
 #ifdef CC_BUILD_GL11
 			for (j = 0; j < CHUNKPART_MAX_VBS; j++) Gfx_DeleteVb(&ptr->vbs[j]);
 #endif
@@ -346,23 +835,22 @@ static void DeleteChunk(struct ChunkInfo* info) {
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
 			if (ptr->offset < 0) continue;
 			tranPartsCount[i]--;
+			vertices += ChunkPart_Vertices(ptr);
 #ifdef CC_BUILD_GL11
 			for (j = 0; j < CHUNKPART_MAX_VBS; j++) Gfx_DeleteVb(&ptr->vbs[j]);
 #endif
 		}
 		info->translucentParts = NULL;
 	}
+	MapRenderer_MeshBytes -= vertices * ChunkMeshVertexSize();
 }
 
-/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
-static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+/* Updates internal state after the mesh for the given chunk has been built */
+static void FinishChunk(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
+	cc_uint32 vertices = 0;
 	int i;
 
-	Game.ChunkUpdates++;
-	(*chunkUpdates)++;
-	Builder_MakeChunk(info);
-
 	info->dirty  = false;
 	info->noData = !info->normalParts && !info->translucentParts;
 	info->empty  = info->noData;
@@ -371,38 +859,235 @@ static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
 	if (info->normalParts) {
 		ptr = info->normalParts;
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
-			if (ptr->offset >= 0) normPartsCount[i]++;
+			if (ptr->offset < 0) continue;
+			normPartsCount[i]++;
+			vertices += ChunkPart_Vertices(ptr);
 		}
 	}
 
 	if (info->translucentParts) {
 		ptr = info->translucentParts;
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
-			if (ptr->offset >= 0) tranPartsCount[i]++;
+			if (ptr->offset < 0) continue;
+			tranPartsCount[i]++;
+			vertices += ChunkPart_Vertices(ptr);
+		}
+	}
+	MapRenderer_MeshBytes += vertices * ChunkMeshVertexSize();
+}
+
+/* Average time taken to build the mesh of a chunk on the main thread, in microseconds */
+static int avgBuildTime = 1000;
+
+/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
+static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+	cc_uint16 connectivity = info->connectivity;
+	cc_uint64 beg = Stopwatch_Measure();
+	int elapsed;
+
+	Game.ChunkUpdates++;
+	(*chunkUpdates)++;
+	Builder_MakeChunk(info);
+	FinishChunk(info);
+	if (info->connectivity != connectivity) occlusionDirty = true;
+
+	elapsed      = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+	avgBuildTime = (avgBuildTime * 7 + elapsed) / 8;
+}
+
+
+#ifdef CC_BUILD_MESHWORKERS
+/*########################################################################################################################*
+*---------------------------------------------------Chunk mesh workers----------------------------------------------------*
+*#########################################################################################################################*/
+/* Chunks are meshed in parallel by a pool of worker threads, with the main thread also helping out. */
+/* All jobs are always completed before MapRenderer_Update returns, which means the world and */
+/*  lighting state can never change while chunks are being meshed by the worker threads. */
+/* NOTE: Must be less than LIGHTING_MAX_WORKERS, since the main thread also runs lighting tasks */
+#define WORKERS_MAX_THREADS 16
+#ifdef CC_BUILD_3DS
+/* Only one other core is available for background work (see Platform_3DS.c) */
+#define WORKERS_DEFAULT_THREADS 1
+#else
+#define WORKERS_DEFAULT_THREADS 3
+#endif
+#define WORKERS_MAX_JOBS 256
+enum WORKERS_PASS { WORKERS_PASS_READ, WORKERS_PASS_LIGHT, WORKERS_PASS_MESH };
+
+static int workersCount, workersStarted, workersBusy, workersPass;
+/* Number of tasks in the current pass (i.e. jobs, or lighting tasks) */
+static int passCount, passNext;
+static void* workerThreads[WORKERS_MAX_THREADS];
+static void* workerWakeups[WORKERS_MAX_THREADS];
+static void* workersMutex;
+static void* workersFinished;
+static cc_bool workersQuit;
+
+static struct BuilderJob* jobs;
+static int jobsCount;
+
+/* Runs tasks from the current pass until there are none left */
+/* NOTE: worker is the index of the calling thread (the main thread is last) */
+static void RunJobs(int worker) {
+	int task;
+
+	for (;;) {
+		Mutex_Lock(workersMutex);
+		task = passNext < passCount ? passNext++ : -1;
+		Mutex_Unlock(workersMutex);
+		if (task < 0) return;
+
+		if (workersPass == WORKERS_PASS_READ) {
+			Builder_ReadJob(&jobs[task]);
+		} else if (workersPass == WORKERS_PASS_LIGHT) {
+			Lighting.CalcQueued(task, worker);
+		} else {
+			Builder_MeshJob(&jobs[task]);
 		}
 	}
 }
 
+static void WorkerLoop(void) {
+	void* wakeup;
+	int worker;
+	Mutex_Lock(workersMutex);
+	worker = workersStarted++;
+	wakeup = workerWakeups[worker];
+	Mutex_Unlock(workersMutex);
+
+	for (;;) {
+		Waitable_Wait(wakeup);
+		if (workersQuit) return;
+		RunJobs(worker);
+
+		Mutex_Lock(workersMutex);
+		if (--workersBusy == 0) Waitable_Signal(workersFinished);
+		Mutex_Unlock(workersMutex);
+	}
+}
+
+/* Runs the given pass on all of its tasks, then waits until all the tasks have been completed */
+static void RunPass(int pass, int count) {
+	int i, busy;
+	workersPass = pass;
+	workersBusy = workersCount;
+	passCount   = count;
+	passNext    = 0;
+
+	for (i = 0; i < workersCount; i++) {
+		Waitable_Signal(workerWakeups[i]);
+	}
+	RunJobs(workersCount);
+
+	for (;;) {
+		Mutex_Lock(workersMutex);
+		busy = workersBusy;
+		Mutex_Unlock(workersMutex);
+
+		if (!busy) break;
+		Waitable_Wait(workersFinished);
+	}
+}
+
+static void StartWorkers(void) {
+	int i;
+	workersCount = Options_GetInt(OPT_CHUNK_WORKERS, 0, WORKERS_MAX_THREADS, WORKERS_DEFAULT_THREADS);
+	if (!workersCount) return;
+
+	workersMutex    = Mutex_Create("Mesh workers");
+	workersFinished = Waitable_Create("Mesh workers finished");
+	jobs = (struct BuilderJob*)Mem_AllocCleared(WORKERS_MAX_JOBS, sizeof(struct BuilderJob), "mesh jobs");
+
+	for (i = 0; i < workersCount; i++) {
+		workerWakeups[i] = Waitable_Create("Mesh worker wakeup");
+	}
+	for (i = 0; i < workersCount; i++) {
+		Thread_Run(&workerThreads[i], WorkerLoop, 256 * 1024, "Mesh worker");
+	}
+}
+
+static void FreeJobs(void) {
+	int i;
+	if (!jobs) return;
+
+	for (i = 0; i < WORKERS_MAX_JOBS; i++) {
+		Builder_FreeJob(&jobs[i]);
+	}
+}
+
+static void StopWorkers(void) {
+	int i;
+	if (!workersCount) return;
+	workersQuit = true;
+
+	for (i = 0; i < workersCount; i++) {
+		Waitable_Signal(workerWakeups[i]);
+	}
+	/* Threads don't necessarily claim the wakeup with the same index, */
+	/*  so wakeups can only be freed once every thread has exited */
+	for (i = 0; i < workersCount; i++) {
+		Thread_Join(workerThreads[i]);
+	}
+	for (i = 0; i < workersCount; i++) {
+		Waitable_Free(workerWakeups[i]);
+	}
+
+	FreeJobs();
+	Mem_Free(jobs);
+	Mutex_Free(workersMutex);
+	Waitable_Free(workersFinished);
+
+	jobs = NULL;
+	workersCount   = 0;
+	workersStarted = 0;
+	workersQuit    = false;
+}
+#endif
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Chunks mangagement---------------------------------------------------*
 *#########################################################################################################################*/
+/* Chunk state arrays are kept allocated between maps with the same number of chunks */
+/* NOTE: mapChunks is NULL when no map is loaded, so it's stored in pooledChunks until then */
+static struct ChunkInfo* pooledChunks;
+static int chunksCapacity;
+static cc_uint32 partsCapacity;
+
 static void FreeParts(void) {
 	Mem_Free(MapRenderer_PartsNormal);
 	MapRenderer_PartsNormal      = NULL;
 	MapRenderer_PartsTranslucent = NULL;
+	partsCapacity = 0;
 }
 
 static void FreeChunks(void) {
 	Mem_Free(mapChunks);
+	Mem_Free(pooledChunks);
 	Mem_Free(sortedChunks);
 	Mem_Free(renderChunks);
 	Mem_Free(distances);
+	Mem_Free(sortTemp);
+	Mem_Free(distancesTemp);
+	Mem_Free(occlusionQueue);
+	Mem_Free(occlusionDirs);
+	Mem_Free(occlusionEntry);
+	Mem_Free(chunkBounds.minX);
+	Mem_Free(chunkInFrustum);
 
 	mapChunks    = NULL;
+	pooledChunks = NULL;
 	sortedChunks = NULL;
 	renderChunks = NULL;
 	distances    = NULL;
+	sortTemp      = NULL;
+	distancesTemp = NULL;
+	occlusionQueue = NULL;
+	occlusionDirs  = NULL;
+	occlusionEntry = NULL;
+	chunkBounds.minX = NULL;
+	chunkInFrustum   = NULL;
+	chunksCapacity   = 0;
 }
 
 static void AllocateParts(void) {
@@ -412,6 +1097,7 @@ static void AllocateParts(void) {
 	ptr = (struct ChunkPartInfo*)Mem_AllocCleared(count * 2, sizeof(struct ChunkPartInfo), "chunk parts");
 	MapRenderer_PartsNormal      = ptr;
 	MapRenderer_PartsTranslucent = ptr + count;
+	partsCapacity = count;
 }
 
 static void AllocateChunks(void) {
@@ -419,6 +1105,21 @@ static void AllocateChunks(void) {
 	sortedChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
 	renderChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "render chunk info");
 	distances    = (cc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances");
+	sortTemp      = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk temp");
+	distancesTemp = (cc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances temp");
+
+	occlusionQueue = (int*)Mem_Alloc(chunksCount, sizeof(int), "occlusion queue");
+	occlusionDirs  = (cc_uint8*)Mem_Alloc(chunksCount, 1, "occlusion dirs");
+	occlusionEntry = (cc_uint8*)Mem_Alloc(chunksCount, 1, "occlusion entry");
+
+	chunkBounds.minX = (float*)Mem_Alloc(chunksCount * 6, 4, "chunk bounds");
+	chunkBounds.minY = chunkBounds.minX + chunksCount;
+	chunkBounds.minZ = chunkBounds.minY + chunksCount;
+	chunkBounds.maxX = chunkBounds.minZ + chunksCount;
+	chunkBounds.maxY = chunkBounds.maxX + chunksCount;
+	chunkBounds.maxZ = chunkBounds.maxY + chunksCount;
+	chunkInFrustum   = (cc_uint8*)Mem_Alloc(chunksCount, 1, "chunk in frustum");
+	chunksCapacity   = chunksCount;
 }
 
 static void ResetPartFlags(void) {
@@ -474,6 +1175,10 @@ static void DeleteChunks(void) {
 		DeleteChunk(&mapChunks[i]);
 	}
 	ResetPartCounts();
+	MapRenderer_MeshBytes = 0;
+#ifdef CC_BUILD_CHUNKARENA
+	Arena_Reset();
+#endif
 }
 
 void MapRenderer_Refresh(void) {
@@ -495,6 +1200,32 @@ void MapRenderer_Refresh(void) {
 	ResetPartCounts();
 }
 
+void MapRenderer_RefreshBuiltChunks(void) {
+	struct ChunkInfo* info;
+	int i;
+	if (!mapChunks || !World.Blocks) return;
+
+	for (i = 0; i < chunksCount; i++) {
+		info = &mapChunks[i];
+		/* Chunks without a mesh will be built with the new state anyways */
+		if (info->empty || info->noData) continue;
+		info->dirty = true;
+	}
+}
+
+int MapRenderer_BuildAllChunks(void) {
+	struct ChunkInfo* info;
+	int i, chunkUpdates = 0;
+	if (!mapChunks || !World.Blocks) return 0;
+
+	for (i = 0; i < chunksCount; i++) {
+		info = &mapChunks[i];
+		DeleteChunk(info);
+		BuildChunk(info, &chunkUpdates);
+	}
+	return chunkUpdates;
+}
+
 /* Refreshes chunks on the border of the map whose y is less than 'maxHeight'. */
 static void RefreshBorderChunks(int maxHeight) {
 	int cx, cy, cz;
@@ -520,8 +1251,17 @@ static void RefreshBorderChunks(int maxHeight) {
 /*########################################################################################################################*
 *--------------------------------------------------Chunks updating/sorting------------------------------------------------*
 *#########################################################################################################################*/
-#define CHUNK_TARGET_TIME ((1.0f/30) + 0.01f)
-static int chunksTarget = 12;
+#ifdef CC_BUILD_MOBILE
+	#define CHUNK_DEF_BUDGET 4
+#else
+	#define CHUNK_DEF_BUDGET 10
+#endif
+/* Default max memory used by chunk meshes, in megabytes (0 for unlimited) */
+#ifdef CC_BUILD_LOWMEM
+	#define MESH_DEF_BUDGET 8
+#else
+	#define MESH_DEF_BUDGET 0
+#endif
 static Vec3 lastCamPos;
 static float lastYaw, lastPitch;
 /* Max distance from camera that chunks are rendered within */
@@ -530,6 +1270,29 @@ static int renderDistSquared;
 /* Max distance from camera that chunks are built within */
 /* Chunks past this distance are automatically unloaded */
 static int buildDistSquared;
+/* Max distance from camera that chunks are built within, while over the mesh memory budget */
+static int budgetDistSquared;
+/* Distance from camera past which chunks are built at lowest detail, while over the mesh memory budget */
+static int budgetLodDistSquared;
+
+/* Max time spent building chunks each frame, in microseconds */
+static int buildBudget;
+/* Time that building chunks started at in the current frame */
+static cc_uint64 buildStart;
+
+/* Whether there is enough time left in this frame to build the mesh of another chunk */
+/* NOTE: Chunks outside the view can only use the first half of the time, */
+/*  so that chunks in view (which are more noticeable when missing) are prioritised */
+static cc_bool CanBuildChunk(int chunkUpdates, cc_bool visible) {
+	int elapsed, budget;
+	if (chunkUpdates >= maxChunkUpdates) return false;
+	/* Always build at least one chunk, so chunks still get built on very slow devices */
+	if (!chunkUpdates) return true;
+
+	budget  = visible ? buildBudget : buildBudget / 2;
+	elapsed = (int)Stopwatch_ElapsedMicroseconds(buildStart, Stopwatch_Measure());
+	return elapsed + avgBuildTime <= budget;
+}
 
 static int AdjustDist(int dist) {
 	if (dist < CHUNK_SIZE) dist = CHUNK_SIZE;
@@ -542,9 +1305,119 @@ static void CalcViewDists(void) {
 	renderDistSquared = AdjustDist(Game_ViewDistance);
 }
 
+/* Distance from camera beyond which chunks are built at reduced detail (0 to disable) */
+static int lodDistance;
+/* Max distance from camera that chunks are built within at each level of detail */
+static int lodDistsSquared[CHUNK_MAX_LOD];
+/* Distance that chunks must come back within before being rebuilt at a finer level of detail */
+/* NOTE: This avoids constantly rebuilding chunks right on the boundary when moving back and forth */
+static int lodFinerDistsSquared[CHUNK_MAX_LOD];
+
+static void CalcLodDists(void) {
+	int i, dist;
+	for (i = 0; i < CHUNK_MAX_LOD; i++) {
+		dist = lodDistance << i;
+		lodDistsSquared[i]      = dist * dist;
+		lodFinerDistsSquared[i] = (dist - CHUNK_SIZE) * (dist - CHUNK_SIZE);
+	}
+}
+
+/* Marks the given chunk as needing to be rebuilt, if it was built at a different level of detail */
+/*  to what it should be built at for its current distance from the camera */
+static void UpdateChunkLod(struct ChunkInfo* info, int distSqr) {
+	int lod = 0;
+	if (!lodDistance) return;
+
+	while (lod < CHUNK_MAX_LOD && distSqr > lodDistsSquared[lod]) lod++;
+	if (lod < info->lod && distSqr > lodFinerDistsSquared[lod]) lod++;
+	if (distSqr >= budgetLodDistSquared) lod = CHUNK_MAX_LOD;
+	if (lod == info->lod) return;
+
+	info->lod   = lod;
+	info->dirty = true;
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Chunk mesh budget----------------------------------------------------*
+*#########################################################################################################################*/
+/* When the meshes of all chunks in view take up more memory than MapRenderer_MeshBudget, the meshes of the */
+/*  farthest chunks are evicted, and chunks past them are not built again until there is room for them. */
+/* When level of detail is enabled, evicted chunks are first rebuilt at the lowest detail before being dropped. */
+#define MESH_BUDGET_UNLIMITED Int32_MaxValue
+
+static void ResetMeshBudgetDists(void) {
+	budgetDistSquared    = MESH_BUDGET_UNLIMITED;
+	budgetLodDistSquared = MESH_BUDGET_UNLIMITED;
+}
+
+/* Deletes the meshes of the farthest chunks, until meshes take up at most 'target' bytes */
+static void EvictChunkMeshes(cc_uint32 target) {
+	struct ChunkInfo* info;
+	int i;
+
+	for (i = chunksCount - 1; i >= 0 && MapRenderer_MeshBytes > target; i--)
+	{
+		info = sortedChunks[i];
+		if (info->empty || info->noData) continue;
+		DeleteChunk(info);
+
+		if (lodDistance && info->lod < CHUNK_MAX_LOD) {
+			budgetLodDistSquared = min(budgetLodDistSquared, (int)distances[i]);
+			info->lod = CHUNK_MAX_LOD;
+		} else {
+			/* Chunks are sorted by distance, so all further chunks now have no mesh */
+			budgetDistSquared = min(budgetDistSquared, (int)distances[i] - 1);
+		}
+	}
+}
+
+/* Moves the distances chunks are evicted/downgraded past one chunk further away */
+static void RelaxMeshBudgetDists(void) {
+	int dist;
+
+	if (budgetDistSquared != MESH_BUDGET_UNLIMITED) {
+		dist = (int)Math_SqrtF((float)budgetDistSquared) + CHUNK_SIZE;
+		budgetDistSquared = dist * dist;
+		if (budgetDistSquared > buildDistSquared) budgetDistSquared = MESH_BUDGET_UNLIMITED;
+	} else if (budgetLodDistSquared != MESH_BUDGET_UNLIMITED) {
+		dist = (int)Math_SqrtF((float)budgetLodDistSquared) + CHUNK_SIZE;
+		budgetLodDistSquared = dist * dist;
+		if (budgetLodDistSquared > buildDistSquared) budgetLodDistSquared = MESH_BUDGET_UNLIMITED;
+	}
+}
+
+static void UpdateMeshBudget(int chunkUpdates) {
+	if (!MapRenderer_MeshBudget) return;
+
+	if (MapRenderer_MeshBytes > MapRenderer_MeshBudget) {
+		EvictChunkMeshes(MapRenderer_MeshBudget);
+	} else if (!chunkUpdates && MapRenderer_MeshBytes <= MapRenderer_MeshBudget / 4 * 3) {
+		/* Only allow more chunks to be built once all chunks within range have been built */
+		RelaxMeshBudgetDists();
+	}
+}
+
+cc_bool MapRenderer_ReduceMeshMemory(void) {
+	cc_uint32 target;
+	if (!mapChunks || !MapRenderer_MeshBytes) return false;
+
+	/* Stay below the amount of memory that could actually be allocated from now on */
+	target = MapRenderer_MeshBytes / 4 * 3;
+	if (!MapRenderer_MeshBudget || target < MapRenderer_MeshBudget) MapRenderer_MeshBudget = target;
+	EvictChunkMeshes(target);
+
+#ifdef CC_BUILD_CHUNKARENA
+	/* Evicted ranges are only reused by later chunks, rather than being returned to the GPU */
+	return false;
+#else
+	return true;
+#endif
+}
+
 static int UpdateChunksAndVisibility(int* chunkUpdates) {
 	int renderDistSqr = renderDistSquared;
-	int buildDistSqr  = buildDistSquared;
+	int buildDistSqr  = min(buildDistSquared, budgetDistSquared);
 
 	struct ChunkInfo* info;
 	int i, j = 0, distSqr;
@@ -561,15 +1434,16 @@ static int UpdateChunksAndVisibility(int* chunkUpdates) {
 		if (!noData && distSqr >= buildDistSqr + 32 * 16) {
 			DeleteChunk(info); continue;
 		}
+		UpdateChunkLod(info, distSqr);
 		noData |= info->dirty;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
+		info->visible = !info->occluded && distSqr <= renderDistSqr &&
+			ChunkInFrustum(info);
+
+		if (noData && distSqr <= buildDistSqr && CanBuildChunk(*chunkUpdates, info->visible)) {
 			DeleteChunk(info);
 			BuildChunk(info, chunkUpdates);
 		}
-
-		info->visible = distSqr <= renderDistSqr &&
-			FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 		if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
 	}
 	return j;
@@ -577,7 +1451,7 @@ static int UpdateChunksAndVisibility(int* chunkUpdates) {
 
 static int UpdateChunksStill(int* chunkUpdates) {
 	int renderDistSqr = renderDistSquared;
-	int buildDistSqr  = buildDistSquared;
+	int buildDistSqr  = min(buildDistSquared, budgetDistSquared);
 
 	struct ChunkInfo* info;
 	int i, j = 0, distSqr;
@@ -594,36 +1468,111 @@ static int UpdateChunksStill(int* chunkUpdates) {
 		if (!noData && distSqr >= buildDistSqr + 32 * 16) {
 			DeleteChunk(info); continue;
 		}
+		UpdateChunkLod(info, distSqr);
 		noData |= info->dirty;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
-			BuildChunk(info, chunkUpdates);
-
+		if (noData && distSqr <= buildDistSqr) {
 			/* only need to update the visibility of chunks in range. */
-			info->visible = distSqr <= renderDistSqr &&
-				FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
-			if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
-		} else if (info->visible) {
-			renderChunks[j] = info; j++;
+			info->visible = !info->occluded && distSqr <= renderDistSqr &&
+				ChunkInFrustum(info);
+
+			if (CanBuildChunk(*chunkUpdates, info->visible)) {
+				DeleteChunk(info);
+				BuildChunk(info, chunkUpdates);
+			}
 		}
+		if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
 	}
 	return j;
 }
 
-static void UpdateChunks(float delta) {
+#ifdef CC_BUILD_MESHWORKERS
+/* Average time taken per chunk when building the meshes of chunks in parallel, in microseconds */
+static int avgJobTime = 1000;
+
+/* Builds the meshes for several of the nearest chunks which need to be built, in parallel */
+/* NOTE: Chunks in view are picked first, then chunks outside the view if there's still time left */
+static void BuildChunksParallel(int* chunkUpdates) {
+	int renderDistSqr = renderDistSquared;
+	int buildDistSqr  = min(buildDistSquared, budgetDistSquared);
+	int maxJobs = min(WORKERS_MAX_JOBS, maxChunkUpdates * (workersCount + 1));
+
+	cc_uint16 connectivity[WORKERS_MAX_JOBS];
+	struct ChunkInfo* info;
+	int i, pass, count, distSqr, elapsed;
+	jobsCount = 0;
+
+	maxJobs = min(maxJobs, buildBudget / avgJobTime);
+	maxJobs = max(maxJobs, 1);
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < chunksCount && jobsCount < maxJobs; i++) {
+			info    = sortedChunks[i];
+			distSqr = distances[i];
+			/* Chunks are sorted by distance, so no further chunks can be in build range */
+			if (distSqr > buildDistSqr) break;
+			if (info->empty) continue;
+
+			if (pass == 0) {
+				UpdateChunkLod(info, distSqr);
+				info->visible = !info->occluded && distSqr <= renderDistSqr &&
+					ChunkInFrustum(info);
+			}
+			if (!(info->noData || info->dirty) || info->visible != (pass == 0)) continue;
+
+			DeleteChunk(info);
+			connectivity[jobsCount] = info->connectivity;
+			jobs[jobsCount++].info  = info;
+		}
+	}
+	if (!jobsCount) return;
+
+	RunPass(WORKERS_PASS_READ, jobsCount);
+
+	/* Most lighting calculation is split into groups of tasks run on the workers, */
+	/*  with the remaining lazily calculated lighting state then done on the main thread */
+	for (i = 0; i < jobsCount; i++) {
+		Builder_QueueLightJob(&jobs[i]);
+	}
+	while ((count = Lighting.NextQueuedGroup())) {
+		RunPass(WORKERS_PASS_LIGHT, count);
+	}
+
+	for (i = 0; i < jobsCount; i++) {
+		Builder_LightJob(&jobs[i]);
+	}
+	RunPass(WORKERS_PASS_MESH, jobsCount);
+
+	for (i = 0; i < jobsCount; i++) {
+		Builder_UploadJob(&jobs[i]);
+		FinishChunk(jobs[i].info);
+		if (jobs[i].info->connectivity != connectivity[i]) occlusionDirty = true;
+	}
+
+	Game.ChunkUpdates += jobsCount;
+	*chunkUpdates     += jobsCount;
+
+	elapsed    = (int)Stopwatch_ElapsedMicroseconds(buildStart, Stopwatch_Measure()) / jobsCount;
+	avgJobTime = (avgJobTime * 7 + elapsed) / 8;
+	avgJobTime = max(avgJobTime, 1);
+}
+#endif
+
+static void UpdateChunks(void) {
 	struct LocalPlayer* p;
 	cc_bool samePos;
 	int chunkUpdates = 0;
-
-	/* Build more chunks if 30 FPS or over, otherwise slowdown */
-	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
-	Math_Clamp(chunksTarget, 4, maxChunkUpdates);
+	buildStart = Stopwatch_Measure();
 
 	p = Entities.CurPlayer;
 	samePos = Vec3_Equals(&Camera.CurrentPos, &lastCamPos)
 		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw;
 
+	FrustumCulling_BoxesInFrustum(&chunkBounds, chunksCount, chunkInFrustum);
+#ifdef CC_BUILD_MESHWORKERS
+	if (workersCount) BuildChunksParallel(&chunkUpdates);
+#endif
+
 	renderChunksCount = samePos ?
 		UpdateChunksStill(&chunkUpdates) :
 		UpdateChunksAndVisibility(&chunkUpdates);
@@ -632,30 +1581,63 @@ static void UpdateChunks(float delta) {
 	lastPitch  = p->Base.Pitch;
 	lastYaw    = p->Base.Yaw;
 
+	UpdateMeshBudget(chunkUpdates);
 	if (!samePos || chunkUpdates) ResetPartFlags();
 }
 
-static void SortMapChunks(int left, int right) {
-	struct ChunkInfo** values = sortedChunks; struct ChunkInfo* value;
-	cc_uint32* keys = distances; cc_uint32 key;
+#define SORT_RADIX_BITS 11
+#define SORT_RADIX_SIZE (1 << SORT_RADIX_BITS)
+#define SORT_RADIX_MASK (SORT_RADIX_SIZE - 1)
+
+/* Sorts chunks by distance, using a radix sort starting from their previous sort order */
+/* NOTE: Since chunk centres are always in multiples of 16, the lowest 8 bits of distance are always 0 */
+static void SortMapChunks(void) {
+	static int offsets[SORT_RADIX_SIZE];
+	struct ChunkInfo** srcValues = sortedChunks; struct ChunkInfo** dstValues = sortTemp;
+	cc_uint32* srcKeys = distances; cc_uint32* dstKeys = distancesTemp;
+	struct ChunkInfo** tmpValues;
+	cc_uint32* tmpKeys;
+	cc_uint32 maxKey = 0;
+	cc_bool sorted   = true;
+	int i, shift, digit, offset, count;
 
-	while (left < right) {
-		int i = left, j = right;
-		cc_uint32 pivot = keys[(i + j) >> 1];
+	for (i = 0; i < chunksCount; i++) {
+		maxKey = max(maxKey, srcKeys[i]);
+		if (i && srcKeys[i] < srcKeys[i - 1]) sorted = false;
+	}
+	/* Moving into an adjacent chunk often preserves the previous order */
+	if (sorted) return;
+
+	for (shift = 8; (maxKey >> shift) != 0; shift += SORT_RADIX_BITS) {
+		Mem_Set(offsets, 0, sizeof(offsets));
+		for (i = 0; i < chunksCount; i++) {
+			offsets[(srcKeys[i] >> shift) & SORT_RADIX_MASK]++;
+		}
+
+		for (digit = 0, offset = 0; digit < SORT_RADIX_SIZE; digit++) {
+			count = offsets[digit];
+			offsets[digit] = offset;
+			offset += count;
+		}
 
-		/* partition the list */
-		while (i <= j) {
-			while (pivot > keys[i]) i++;
-			while (pivot < keys[j]) j--;
-			QuickSort_Swap_KV_Maybe();
+		for (i = 0; i < chunksCount; i++) {
+			offset = offsets[(srcKeys[i] >> shift) & SORT_RADIX_MASK]++;
+			dstValues[offset] = srcValues[i];
+			dstKeys[offset]   = srcKeys[i];
 		}
-		/* recurse into the smaller subset */
-		QuickSort_Recurse(SortMapChunks)
+
+		tmpValues = srcValues; srcValues = dstValues; dstValues = tmpValues;
+		tmpKeys   = srcKeys;   srcKeys   = dstKeys;   dstKeys   = tmpKeys;
 	}
+
+	/* Sorted results may have ended up in the temp arrays */
+	sortedChunks = srcValues; sortTemp      = dstValues;
+	distances    = srcKeys;   distancesTemp = dstKeys;
 }
 
 static void UpdateSortOrder(void) {
 	struct ChunkInfo* info;
+	cc_uint64 beg, end;
 	IVec3 pos;
 	int i, dx, dy, dz;
 
@@ -669,6 +1651,7 @@ static void UpdateSortOrder(void) {
 	if (pos.x == chunkPos.x && pos.y == chunkPos.y && pos.z == chunkPos.z) return;
 	chunkPos = pos;
 	if (!chunksCount) return;
+	beg = Stopwatch_Measure();
 
 	for (i = 0; i < chunksCount; i++) {
 		info = sortedChunks[i];
@@ -689,15 +1672,24 @@ static void UpdateSortOrder(void) {
 		info->drawYMin = dy >= 0; info->drawYMax = dy <= 0;
 	}
 
-	SortMapChunks(0, chunksCount - 1);
+	SortMapChunks();
 	ResetPartFlags();
-	/*SimpleOcclusionCulling();*/
+	occlusionDirty = true;
+
+	end = Stopwatch_Measure();
+	Game.ChunkSortTime += (int)Stopwatch_ElapsedMicroseconds(beg, end);
 }
 
 void MapRenderer_Update(float delta) {
 	if (!mapChunks) return;
 	UpdateSortOrder();
-	UpdateChunks(delta);
+
+	if (occlusionDirty) {
+		UpdateOcclusion(renderDistSquared);
+		/* Force visibility of all chunks to be recalculated */
+		lastCamPos = Vec3_BigPos();
+	}
+	UpdateChunks();
 }
 
 
@@ -724,9 +1716,39 @@ void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block) {
 	MapRenderer_RefreshChunk(cx, cy, cz);
 }
 
+void MapRenderer_OnRegionChanged(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	int cx, cy, cz;
+	struct ChunkInfo* info;
+	/* Faces of blocks just outside the region may have been hidden or revealed too */
+	int minCx = max(minX - 1, 0) >> CHUNK_SHIFT, maxCx = min(maxX + 1, World.MaxX) >> CHUNK_SHIFT;
+	int minCy = max(minY - 1, 0) >> CHUNK_SHIFT, maxCy = min(maxY + 1, World.MaxY) >> CHUNK_SHIFT;
+	int minCz = max(minZ - 1, 0) >> CHUNK_SHIFT, maxCz = min(maxZ + 1, World.MaxZ) >> CHUNK_SHIFT;
+
+	for (cy = minCy; cy <= maxCy; cy++) {
+		for (cz = minCz; cz <= maxCz; cz++) {
+			for (cx = minCx; cx <= maxCx; cx++) 
+			{
+				info = &mapChunks[World_ChunkPack(cx, cy, cz)];
+				/* Chunks containing changed blocks might not be all air anymore */
+				/* (this is recalculated properly when the chunk is next built) */
+				if ((cx << CHUNK_SHIFT) <= maxX && (cx << CHUNK_SHIFT) + CHUNK_MAX >= minX
+				 && (cy << CHUNK_SHIFT) <= maxY && (cy << CHUNK_SHIFT) + CHUNK_MAX >= minY
+				 && (cz << CHUNK_SHIFT) <= maxZ && (cz << CHUNK_SHIFT) + CHUNK_MAX >= minZ) {
+					info->allAir = false;
+				}
+
+				if (info->allAir) continue;
+				info->empty = false;
+				info->dirty = true;
+			}
+		}
+	}
+}
+
 static void OnEnvVariableChanged(void* obj, int envVar) {
+	/* Servers with day/night cycles may change these colours every few seconds */
 	if (envVar == ENV_VAR_SUN_COLOR || envVar == ENV_VAR_SHADOW_COLOR) {
-		MapRenderer_Refresh();
+		MapRenderer_RefreshBuiltChunks();
 	} else if (envVar == ENV_VAR_EDGE_HEIGHT || envVar == ENV_VAR_SIDES_OFFSET) {
 		int oldClip        = Builder_EdgeLevel;
 		Builder_SidesLevel = max(0, Env_SidesHeight);
@@ -749,8 +1771,35 @@ static void OnTerrainAtlasChanged(void* obj) {
 	ResetPartFlags();
 }
 
+/* Marks chunks which may contain (or be next to) blocks whose definitions were changed as needing to be rebuilt */
+static void RefreshChangedBlockChunks(void) {
+	struct ChunkInfo* info;
+	cc_uint32 changed = 0;
+	int i;
+	if (!mapChunks || !World.Blocks) return;
+
+	for (i = BLOCK_AIR; i < BLOCK_COUNT; i++) {
+		if (Block_IsDefChanged((BlockID)i)) changed |= ChunkInfo_BlockBit(i);
+	}
+
+	for (i = 0; i < chunksCount; i++) {
+		info = &mapChunks[i];
+		if (!(info->blockBits & changed)) continue;
+
+		/* e.g. a block might not be invisible anymore */
+		info->allAir = false;
+		info->empty  = false;
+		info->dirty  = true;
+	}
+}
+
 static void OnBlockDefinitionChanged(void* obj) {
-	MapRenderer_Refresh();
+	/* Parts arrays need to be reallocated when the number of used atlases changes */
+	if (MapRenderer_UsedAtlases() != MapRenderer_1DUsedCount) {
+		MapRenderer_Refresh();
+	} else {
+		RefreshChangedBlockChunks();
+	}
 	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
 	ResetPartFlags();
 }
@@ -758,30 +1807,84 @@ static void OnBlockDefinitionChanged(void* obj) {
 static void OnVisibilityChanged(void* obj) {
 	lastCamPos = Vec3_BigPos();
 	CalcViewDists();
+	occlusionDirty = true;
+}
+#ifdef CC_BUILD_CHUNKSHADOW
+static void OnContextLost(void* obj) {
+	struct ChunkInfo* info;
+	int i;
+	if (!mapChunks) return;
+
+	/* Large chunks with their own vertex buffer aren't kept in system memory, so must be rebuilt */
+	for (i = 0; i < chunksCount; i++) 
+	{
+		info = &mapChunks[i];
+		if (info->vb && info->vbClass == ARENA_DEDICATED) DeleteChunk(info);
+	}
+	Arena_LosePages();
 }
-static void DeleteChunks_(void* obj) { DeleteChunks(); }
-static void Refresh_(void* obj)      { MapRenderer_Refresh(); }
+
+static void OnContextRecreated(void* obj) {
+	struct ChunkInfo* info;
+	int i;
+	chunkPos = IVec3_MaxValue();
+	if (!mapChunks) return;
+
+	if (!Arena_RestorePages()) { MapRenderer_Refresh(); return; }
+
+	for (i = 0; i < chunksCount; i++) 
+	{
+		info = &mapChunks[i];
+		if (info->vb) info->vb = Arena_RemapLost(info->vb);
+	}
+}
+#else
+static void OnContextLost(void* obj)      { DeleteChunks(); }
+static void OnContextRecreated(void* obj) { MapRenderer_Refresh(); }
+#endif
 
 static void OnNewMap(void) {
-	Game.ChunkUpdates = 0;
+	Game.ChunkUpdates  = 0;
+	Game.ChunkSortTime = 0;
 	DeleteChunks();
 	ResetPartCounts();
+	ResetMeshBudgetDists();
 
 	chunkPos = IVec3_MaxValue();
+	/* The next map often has the same dimensions (e.g. when rejoining a server) */
+	pooledChunks = mapChunks;
+	mapChunks    = NULL;
+#ifdef CC_BUILD_MESHWORKERS
+	FreeJobs();
+#endif
+}
+
+static void OnFree(void) {
+	OnNewMap();
 	FreeChunks();
 	FreeParts();
+#ifdef CC_BUILD_MESHWORKERS
+	StopWorkers();
+#endif
 }
 
 static void OnNewMapLoaded(void) {
 	chunksCount = World.ChunksCount;
-	/* TODO: Only perform reallocation when map volume has changed */
-	/*if (chunksCount != World.ChunksCount) { */
-		/* chunksCount = World.ChunksCount; */
+
+	if (chunksCount != chunksCapacity) {
 		FreeChunks();
-		FreeParts();
 		AllocateChunks();
+	} else {
+		mapChunks    = pooledChunks;
+		pooledChunks = NULL;
+	}
+
+	if (chunksCount * MapRenderer_1DUsedCount != partsCapacity) {
+		FreeParts();
 		AllocateParts();
-	/*}*/
+	} else {
+		Mem_Set(MapRenderer_PartsNormal, 0, partsCapacity * 2 * sizeof(struct ChunkPartInfo));
+	}
 
 	InitChunks();
 	lastCamPos = Vec3_BigPos();
@@ -794,19 +1897,30 @@ static void OnInit(void) {
 
 	Event_Register_(&GfxEvents.ViewDistanceChanged, NULL, OnVisibilityChanged);
 	Event_Register_(&GfxEvents.ProjectionChanged,   NULL, OnVisibilityChanged);
-	Event_Register_(&GfxEvents.ContextLost,         NULL, DeleteChunks_);
-	Event_Register_(&GfxEvents.ContextRecreated,    NULL, Refresh_);
+	Event_Register_(&GfxEvents.ContextLost,         NULL, OnContextLost);
+	Event_Register_(&GfxEvents.ContextRecreated,    NULL, OnContextRecreated);
 
 	/* This = 87 fixes map being invisible when no textures */
 	MapRenderer_1DUsedCount = 87; /* Atlas1D_UsedAtlasesCount(); */
 	chunkPos   = IVec3_MaxValue();
 	maxChunkUpdates = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, 1024, 30);
+	occlusionCulling = Options_GetBool(OPT_OCCLUSION_CULLING, true);
+	lodDistance      = Options_GetInt(OPT_LOD_DISTANCE, 0, 4096, 256);
+	buildBudget      = Options_GetInt(OPT_CHUNK_BUDGET, 1, 100, CHUNK_DEF_BUDGET) * 1000;
+	depthPrepass     = Options_GetBool(OPT_DEPTH_PREPASS, false);
+	sortTranslucent  = Options_GetBool(OPT_SORT_TRANSLUCENT, false);
+	MapRenderer_MeshBudget = Options_GetInt(OPT_MESH_BUDGET, 0, 2048, MESH_DEF_BUDGET) * 1024 * 1024;
 	CalcViewDists();
+	CalcLodDists();
+	ResetMeshBudgetDists();
+#ifdef CC_BUILD_MESHWORKERS
+	StartWorkers();
+#endif
 }
 
 struct IGameComponent MapRenderer_Component = {
 	OnInit, /* Init */
-	OnNewMap, /* Free */
+	OnFree, /* Free */
 	OnNewMap, /* Reset */
 	OnNewMap, /* OnNewMap */
 	OnNewMapLoaded /* OnNewMapLoaded */
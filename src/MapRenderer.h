@@ -14,6 +14,11 @@ extern struct IGameComponent MapRenderer_Component;
 
 /* Max used 1D atlases. (i.e. Atlas1D_Index(maxTextureLoc) + 1) */
 extern int MapRenderer_1DUsedCount;
+/* Total size in bytes of the vertices of all chunk meshes */
+extern cc_uint32 MapRenderer_MeshBytes;
+/* Max total size in bytes of all chunk meshes, before the meshes of the farthest chunks are evicted */
+/* NOTE: 0 means unlimited, until the GPU runs out of memory (see MapRenderer_ReduceMeshMemory) */
+extern cc_uint32 MapRenderer_MeshBudget;
 
 /* Buffer for all chunk parts. There are (MapRenderer_ChunksCount * Atlas1D_Count) parts in the buffer,
 with parts for 'normal' buffer being in lower half. */
@@ -32,7 +37,19 @@ struct ChunkPartInfo {
 	cc_uint16 counts[FACE_COUNT]; /* Counts per face */
 };
 
+/* Bit in ChunkInfo.connectivity for whether the two given (different) faces of a chunk are connected */
+#define Chunk_FacesBit(a, b) (1 << ((a) < (b) ? (a) * (11 - (a)) / 2 + (b) - (a) - 1 : (b) * (11 - (b)) / 2 + (a) - (b) - 1))
+/* ChunkInfo.connectivity for when all faces of a chunk are connected to each other */
+#define CHUNK_ALL_CONNECTED 0x7FFF
+
+/* Max level of detail far away chunks are built at. (i.e. 4x4x4 block cells) */
+#define CHUNK_MAX_LOD 2
+
 /* Describes data necessary for rendering a chunk. */
+/* Returns the bit in ChunkInfo.blockBits for the given block */
+/* NOTE: Several blocks share the same bit, so a set bit only means the chunk MAY contain the block */
+#define ChunkInfo_BlockBit(block) (1u << ((block) & 0x1F))
+
 struct ChunkInfo {	
 	cc_uint16 centreX, centreY, centreZ; /* Centre coordinates of the chunk */
 
@@ -41,6 +58,8 @@ struct ChunkInfo {
 	cc_uint8 dirty : 1;   /* Whether chunk is pending being rebuilt */
 	cc_uint8 allAir : 1;  /* Whether chunk is completely air */
 	cc_uint8 noData : 1;  /* Whether the chunk is currently empty of data, but may have data if built */
+	cc_uint8 occluded : 1;/* Whether chunk is hidden from the camera behind other chunks */
+	cc_uint8 lod : 2;     /* Level of detail the chunk is built at (cells of 2^lod blocks are collapsed) */
 	cc_uint8 : 0;         /* pad to next byte*/
 
 	cc_uint8 drawXMin : 1;
@@ -50,12 +69,14 @@ struct ChunkInfo {
 	cc_uint8 drawYMin : 1;
 	cc_uint8 drawYMax : 1;
 	cc_uint8 : 0;          /* pad to next byte */
-#ifdef OCCLUSION
-	public cc_bool Visited = false, Occluded = false;
-	public byte OcclusionFlags, OccludedFlags, DistanceFlags;
-#endif
+	cc_uint16 connectivity; /* Which pairs of faces are connected by non-opaque blocks (see Chunk_FacesBit) */
+	cc_uint32 blockBits;    /* Which blocks are in or around the chunk, as of when it was last built (see ChunkInfo_BlockBit) */
 #ifndef CC_BUILD_GL11
 	GfxResourceID vb;
+#endif
+#ifdef CC_BUILD_CHUNKARENA
+	cc_uint16 vbOffset; /* First vertex of the chunk's range in vb */
+	cc_uint8  vbClass;  /* Size class of the chunk's range in vb */
 #endif
 	struct ChunkPartInfo* normalParts;
 	struct ChunkPartInfo* translucentParts;
@@ -75,8 +96,28 @@ void MapRenderer_Update(float delta);
 void MapRenderer_RefreshChunk(int cx, int cy, int cz);
 /* Called when a block is changed, to update internal state. */
 void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block);
+/* Marks all chunks affected by changing many blocks in the given region at once as needing to be rebuilt. */
+void MapRenderer_OnRegionChanged(int minX, int minY, int minZ, int maxX, int maxY, int maxZ);
 /* Deletes all chunks and resets internal state. */
 void MapRenderer_Refresh(void);
+/* Marks all chunks which currently have a mesh as needing to be rebuilt. */
+/* NOTE: Unlike MapRenderer_Refresh, the current meshes are still drawn until the chunks are rebuilt, */
+/*  so the world is gradually updated (nearest chunks first) instead of disappearing and reappearing */
+void MapRenderer_RefreshBuiltChunks(void);
+/* Immediately rebuilds the mesh of every chunk in the world, returning the number of chunks built. */
+/* NOTE: This blocks until finished, so it is only really useful for measuring mesh building time */
+int MapRenderer_BuildAllChunks(void);
+/* Evicts the meshes of the farthest chunks, and lowers the mesh memory budget to match. */
+/* Returns false if this did not free any video memory. (e.g. no chunks have a mesh) */
+cc_bool MapRenderer_ReduceMeshMemory(void);
+/* Sets the region of blocks that the given chunk's mesh actually covers, */
+/*  so that chunks can be more tightly frustum culled than by their whole area */
+/* NOTE: Can be called from mesh worker threads */
+void MapRenderer_SetChunkBounds(struct ChunkInfo* info, int minX, int minY, int minZ, int maxX, int maxY, int maxZ);
+#ifdef CC_BUILD_CHUNKARENA
+/* Allocates a range of the shared chunk vertex buffers for the given chunk, then copies the vertices into it. */
+void MapRenderer_UploadChunk(struct ChunkInfo* info, void* vertices, int count);
+#endif
 
 CC_END_HEADER
 #endif
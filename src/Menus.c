@@ -36,6 +36,7 @@
 #include "SystemFonts.h"
 #include "Lighting.h"
 #include "InputHandler.h"
+#define MEM_SUBSYSTEM MEM_SYS_UI
 
 /*########################################################################################################################*
 *--------------------------------------------------------Menu base--------------------------------------------------------*
@@ -1329,9 +1330,16 @@ static void SaveLevelScreen_RemoveOverwrites(struct SaveLevelScreen* s) {
 	}
 }
 
-static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
+static MapExportFunc GetMapExporter(const cc_string* path) {
 	static const cc_string schematic = String_FromConst(".schematic");
 	static const cc_string mine      = String_FromConst(".mine");
+
+	if (String_CaselessEnds(path, &schematic)) return Schematic_Save;
+	if (String_CaselessEnds(path, &mine))      return Dat_Save;
+	return Cw_Save;
+}
+
+static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
 	struct Stream stream, compStream;
 	cc_result res;
 
@@ -1339,13 +1347,7 @@ static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
 	if (res) { Logger_SysWarn2(res, "creating", path); return res; }
 	GZip_MakeStream(&compStream, state, &stream);
 
-	if (String_CaselessEnds(path, &schematic)) {
-		res = Schematic_Save(&compStream);
-	} else if (String_CaselessEnds(path, &mine)) {
-		res = Dat_Save(&compStream);
-	} else {
-		res = Cw_Save(&compStream);
-	}
+	res = GetMapExporter(path)(&compStream);
 
 	if (res) {
 		stream.Close(&stream);
@@ -1362,10 +1364,23 @@ static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
 	return 0;
 }
 
+static cc_bool IsRegionMap(const cc_string* path) {
+	static const cc_string ccr = String_FromConst(".ccr");
+	return String_CaselessEnds(path, &ccr);
+}
+
 static cc_result SaveLevelScreen_SaveMap(const cc_string* path) {
 	struct GZipState* state;
 	cc_result res;
 
+	if (IsRegionMap(path)) {
+		res = Map_SaveRegions(path, false);
+		if (res) { Logger_SysWarn2(res, "encoding", path); return res; }
+
+		Gui_ShowPauseMenu();
+		return 0;
+	}
+
 	state = Mem_TryAlloc(1, sizeof(struct GZipState));
 	res   = ERR_OUT_OF_MEMORY;
 	if (!state) { Logger_SysWarn(res, "allocating temp memory"); return res; }
@@ -1393,10 +1408,17 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	}
 
 	String_InitArray(path, pathBuffer);
-	String_Format1(&path, "maps/%s.cw", &file);
 	String_Copy(&World.Name, &file);
 
+	/* Keep saving region maps as region maps, since only the changed regions then need to be written */
+	String_Format1(&path, "maps/%s.ccr", &file);
 	Platform_EncodePath(&str, &path);
+	if (!File_Exists(&str)) {
+		path.length = 0;
+		String_Format1(&path, "maps/%s.cw", &file);
+		Platform_EncodePath(&str, &path);
+	}
+
 	if (File_Exists(&str) && !btn->optName) {
 		btn->optName = "";
 		SaveLevelScreen_UpdateSave(s);
@@ -1404,21 +1426,33 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	}
 		
 	SaveLevelScreen_RemoveOverwrites(s);
+#ifdef CC_BUILD_SAVEWORKERS
+	/* Saving a large map can take a while, so finish saving it in the background */
+	if (IsRegionMap(&path)) {
+		res = Map_SaveRegions(&path, true);
+	} else {
+		res = Map_SaveInBackground(&path, GetMapExporter(&path));
+	}
+	if (res) { Logger_SysWarn2(res, "encoding", &path); return; }
+	Gui_ShowPauseMenu();
+#else
 	if ((res = SaveLevelScreen_SaveMap(&path))) return;
-	Chat_Add1("&eSaved map to: %s", &path);
+	/* Region maps show this in chat themselves */
+	if (!IsRegionMap(&path)) Chat_Add1("&eSaved map to: %s", &path);
+#endif
 }
 
 static void SaveLevelScreen_UploadCallback(const cc_string* path) {
 	cc_result res = SaveLevelScreen_SaveMap(path);
-	if (!res) Chat_Add1("&eSaved map to: %s", path);
+	if (!res && !IsRegionMap(path)) Chat_Add1("&eSaved map to: %s", path);
 }
 
 static void SaveLevelScreen_File(void* screen, void* b) {
 	static const char* const titles[] = {
-		"ClassiCube map", "Minecraft schematic", "Minecraft classic map", NULL
+		"ClassiCube map", "Minecraft schematic", "Minecraft classic map", "ClassiCube region map", NULL
 	};
 	static const char* const filters[] = {
-		".cw", ".schematic", ".mine", NULL
+		".cw", ".schematic", ".mine", ".ccr", NULL
 	};
 	struct SaveLevelScreen* s = (struct SaveLevelScreen*)screen;
 	struct SaveFileDialogArgs args;
@@ -1816,7 +1850,7 @@ static void LoadLevelScreen_LoadEntries(struct ListScreen* s) {
 static void LoadLevelScreen_UploadCallback(const cc_string* path) { Map_LoadFrom(path); }
 static void LoadLevelScreen_ActionFunc(void* s, void* w) {
 	static const char* const filters[] = { 
-		".cw", ".dat", ".lvl", ".mine", ".fcm", ".mclevel", NULL 
+		".cw", ".dat", ".lvl", ".mine", ".fcm", ".mclevel", ".ccr", NULL 
 	}; /* TODO not hardcode list */
 	static struct OpenFileDialogArgs args = {
 		"Classic map files", filters,
@@ -2597,8 +2631,7 @@ static void TexIdsOverlay_Render(void* screen, float delta) {
 	offset = Widget_Render2(&s->title, offset);
 	offset = TexIdsOverlay_RenderTerrain(s, offset);
 
-	Gfx_BindTexture(s->idAtlas.tex.ID);
-	Gfx_DrawVb_IndexedTris_Range(s->textVertices, offset);
+	Gfx_Draw2DRange(s->idAtlas.tex.ID, s->textVertices, offset);
 }
 
 static int TexIdsOverlay_KeyDown(void* screen, int key, struct InputDevice* device) {
@@ -177,8 +177,7 @@ void Model_UpdateVB(void) {
 	if (!Models.Vb)
 		Models.Vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, Models.MaxVertices);
 	
-	Gfx_SetDynamicVbData(Models.Vb, Models.Vertices, model->index);
-	Gfx_DrawVb_IndexedTris(model->index);
+	Gfx_DrawDynamicVb_IndexedTris(Models.Vb, Models.Vertices, model->index);
 	model->index = 0;
 }
 
@@ -229,10 +228,25 @@ void Model_DrawPart(struct ModelPart* part) {
 	model->index += count;
 }
 
-#define Model_RotateX t = cosX * v.y + sinX * v.z; v.z = -sinX * v.y + cosX * v.z; v.y = t;
-#define Model_RotateY t = cosY * v.x - sinY * v.z; v.z =  sinY * v.x + cosY * v.z; v.x = t;
-#define Model_RotateZ t = cosZ * v.x + sinZ * v.y; v.y = -sinZ * v.x + cosZ * v.y; v.x = t;
+/* Premultiplies the given 3x3 rotation matrix by a rotation around the given axis (0 = X, 1 = Y, 2 = Z) */
+static void Model_Rotate(float m[3][3], int axis, float cosA, float sinA) {
+	/* Rows of the rotation matrix that are affected by the rotation */
+	int a = axis == 0 ? 1 : 0;
+	int b = axis == 2 ? 1 : 2;
+	float t;
+	int i;
+	/* Y rotation is the opposite direction to X and Z rotations */
+	if (axis == 1) sinA = -sinA;
 
+	for (i = 0; i < 3; i++) {
+		t       =  cosA * m[a][i] + sinA * m[b][i];
+		m[b][i] = -sinA * m[a][i] + cosA * m[b][i];
+		m[a][i] = t;
+	}
+}
+
+/* Most model parts (i.e. boxes) are 24 vertices */
+#define MODEL_TRANSFORM_BATCH 32
 void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart* part, cc_bool head) {
 	struct Model* model        = Models.Active;
 	struct ModelVertex* src    = &model->vertices[part->offset];
@@ -241,44 +255,63 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 	float cosX = Math_CosF(-angleX), sinX = Math_SinF(-angleX);
 	float cosY = Math_CosF(-angleY), sinY = Math_SinF(-angleY);
 	float cosZ = Math_CosF(-angleZ), sinZ = Math_SinF(-angleZ);
-	float t, x = part->rotX, y = part->rotY, z = part->rotZ;
+	float x = part->rotX, y = part->rotY, z = part->rotZ;
+	float uScale = Models.uScale, vScale = Models.vScale;
+	float m[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+	struct Matrix rot;
+	Vec3 pos[MODEL_TRANSFORM_BATCH];
 	
 	struct ModelVertex v;
-	int i, count = part->count;
-
-	for (i = 0; i < count; i++) {
-		v = *src;
-		v.x -= x; v.y -= y; v.z -= z;
-
-		/* Rotate locally */
-		if (Models.Rotation == ROTATE_ORDER_ZYX) {
-			Model_RotateZ
-			Model_RotateY
-			Model_RotateX
-		} else if (Models.Rotation == ROTATE_ORDER_XZY) {
-			Model_RotateX
-			Model_RotateZ
-			Model_RotateY
-		} else if (Models.Rotation == ROTATE_ORDER_YZX) {
-			Model_RotateY
-			Model_RotateZ
-			Model_RotateX
-		} else if (Models.Rotation == ROTATE_ORDER_XYZ) {
-			Model_RotateX
-			Model_RotateY
-			Model_RotateZ
-		}
-
-		/* Rotate globally (inlined RotY) */
-		if (head) {
-			t = Models.cosHead * v.x - Models.sinHead * v.z; v.z = Models.sinHead * v.x + Models.cosHead * v.z; v.x = t;
+	int i, j, n, count = part->count;
+
+	/* Most parts are not rotated at all when the entity is standing still */
+	if (!angleX && !angleY && !angleZ && !head) { Model_DrawPart(part); return; }
+
+	/* Combine the local rotations and global head rotation into one matrix, */
+	/*  instead of separately rotating every vertex around each axis */
+	if (Models.Rotation == ROTATE_ORDER_ZYX) {
+		Model_Rotate(m, 2, cosZ, sinZ);
+		Model_Rotate(m, 1, cosY, sinY);
+		Model_Rotate(m, 0, cosX, sinX);
+	} else if (Models.Rotation == ROTATE_ORDER_XZY) {
+		Model_Rotate(m, 0, cosX, sinX);
+		Model_Rotate(m, 2, cosZ, sinZ);
+		Model_Rotate(m, 1, cosY, sinY);
+	} else if (Models.Rotation == ROTATE_ORDER_YZX) {
+		Model_Rotate(m, 1, cosY, sinY);
+		Model_Rotate(m, 2, cosZ, sinZ);
+		Model_Rotate(m, 0, cosX, sinX);
+	} else if (Models.Rotation == ROTATE_ORDER_XYZ) {
+		Model_Rotate(m, 0, cosX, sinX);
+		Model_Rotate(m, 1, cosY, sinY);
+		Model_Rotate(m, 2, cosZ, sinZ);
+	}
+	if (head) Model_Rotate(m, 1, Models.cosHead, Models.sinHead);
+
+	/* Rotating around the part's origin is the same as rotating and then translating by origin - rotated origin */
+	rot.row1.x = m[0][0]; rot.row1.y = m[1][0]; rot.row1.z = m[2][0]; rot.row1.w = 0.0f;
+	rot.row2.x = m[0][1]; rot.row2.y = m[1][1]; rot.row2.z = m[2][1]; rot.row2.w = 0.0f;
+	rot.row3.x = m[0][2]; rot.row3.y = m[1][2]; rot.row3.z = m[2][2]; rot.row3.w = 0.0f;
+	rot.row4.x = x - (m[0][0] * x + m[0][1] * y + m[0][2] * z);
+	rot.row4.y = y - (m[1][0] * x + m[1][1] * y + m[1][2] * z);
+	rot.row4.z = z - (m[2][0] * x + m[2][1] * y + m[2][2] * z);
+	rot.row4.w = 1.0f;
+
+	/* Positions are transformed in batches into a temp buffer, so that vertices are still */
+	/*  written out sequentially (the vertex buffer may be write combined GPU memory) */
+	for (i = 0; i < count; i += n) {
+		n = min(count - i, MODEL_TRANSFORM_BATCH);
+		Vec3_TransformMany(pos, sizeof(Vec3), src, sizeof(struct ModelVertex), n, &rot);
+
+		for (j = 0; j < n; j++) {
+			v = *src;
+			dst->x = pos[j].x; dst->y = pos[j].y; dst->z = pos[j].z;
+			dst->Col = Models.Cols[(i + j) >> 2];
+
+			dst->U = ((v.u & UV_POS_MASK) - (v.u >> UV_MAX_SHIFT) * 0.01f) * uScale;
+			dst->V = ((v.v & UV_POS_MASK) - (v.v >> UV_MAX_SHIFT) * 0.01f) * vScale;
+			src++; dst++;
 		}
-		dst->x = v.x + x; dst->y = v.y + y; dst->z = v.z + z;
-		dst->Col = Models.Cols[i >> 2];
-
-		dst->U = (v.u & UV_POS_MASK) * Models.uScale - (v.u >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
-		dst->V = (v.v & UV_POS_MASK) * Models.vScale - (v.v >> UV_MAX_SHIFT) * 0.01f * Models.vScale;
-		src++; dst++;
 	}
 	model->index += count;
 }
@@ -661,6 +694,36 @@ static float CustomModel_GetAnimValue(cc_uint8 type, struct CustomModelAnim* ani
 	return 0.0f;
 }
 
+static cc_bool CustomModel_IsTimeAnim(cc_uint8 type) {
+	return type == CustomModelAnimType_Spin       ||
+		type == CustomModelAnimType_SinRotate     || type == CustomModelAnimType_SinTranslate  ||
+		type == CustomModelAnimType_SinSize       || type == CustomModelAnimType_FlipRotate    ||
+		type == CustomModelAnimType_FlipTranslate || type == CustomModelAnimType_FlipSize;
+}
+
+/* Calculates animations that are the same for every entity using this model once per frame, */
+/*  instead of once per entity (e.g. when servers use many copies of the same detailed NPC) */
+static void CustomModel_CalcTimeAnims(struct CustomModel* cm) {
+	struct CustomModelPart* part;
+	int i, j;
+	if (cm->animTime == Game.Time) return;
+	cm->animTime = Game.Time;
+
+	for (i = 0; i < cm->numParts; i++)
+	{
+		part = &cm->parts[i];
+		part->timeAnims = 0;
+
+		for (j = 0; j < MAX_CUSTOM_MODEL_ANIMS; j++)
+		{
+			if (!CustomModel_IsTimeAnim(part->animType[j])) continue;
+
+			part->timeAnims |= 1 << j;
+			part->timeAnimValues[j] = CustomModel_GetAnimValue(part->animType[j], &part->anims[j], NULL);
+		}
+	}
+}
+
 static PackedCol oldCols[FACE_COUNT];
 static void CustomModel_DrawPart(
 	struct CustomModelPart* part,
@@ -696,7 +759,12 @@ static void CustomModel_DrawPart(
 		axis = part->animAxis[animIndex];
 
 		if (type == CustomModelAnimType_None) continue;
-		value = CustomModel_GetAnimValue(type, anim, e);
+
+		if (part->timeAnims & (1 << animIndex)) {
+			value = part->timeAnimValues[animIndex];
+		} else {
+			value = CustomModel_GetAnimValue(type, anim, e);
+		}
 	
 		if (
 			!modifiedVertices &&
@@ -811,6 +879,7 @@ static void CustomModel_Draw(struct Entity* e) {
 	Model_ApplyTexture(e);
 	Models.uScale = e->uScale / cm->uScale;
 	Models.vScale = e->vScale / cm->vScale;
+	CustomModel_CalcTimeAnims(cm);
 	Model_LockVB(e, cm->numParts * MODEL_BOX_VERTICES);
 
 	for (i = 0; i < cm->numParts; i++) 
@@ -885,6 +954,7 @@ void CustomModel_Register(struct CustomModel* cm) {
 	cm->model.GetCollisionSize = CustomModel_GetCollisionSize;
 	cm->model.GetPickingBounds = CustomModel_GetPickingBounds;
 	cm->model.DrawArm          = CustomModel_DrawArm;
+	cm->animTime = -1.0; /* force recalculating time based animations */
 
 	/* add to front of models linked list to override original models */
 	if (!models_head) {
@@ -2150,14 +2220,10 @@ static void BlockModel_SpriteXQuad(cc_bool firstPart, cc_bool mirror) {
 	bModel_vertices = ptr;
 }
 
-static void BlockModel_BuildParts(struct Entity* e, cc_bool sprite) {
-	struct VertexTextured* ptr;
+static void BlockModel_BuildParts(cc_bool sprite, struct VertexTextured* ptr) {
 	Vec3 min, max;
 	TextureLoc loc;
 
-	Model_LockVB(e, sprite ? BLOCKMODEL_SPRITE_COUNT : BLOCKMODEL_CUBE_COUNT);
-	ptr = Models.Vertices;
-
 	if (sprite) {
 		bModel_vertices = ptr;
 
@@ -2189,22 +2255,20 @@ static void BlockModel_BuildParts(struct Entity* e, cc_bool sprite) {
 		loc = BlockModel_GetTex(FACE_XMIN); Drawer_XMin(1, Models.Cols[4], loc, &ptr);
 		loc = BlockModel_GetTex(FACE_YMAX); Drawer_YMax(1, Models.Cols[0], loc, &ptr);
 	}
-
-	Model_UnlockVB();
 }
 
-static void BlockModel_DrawParts(void) {
+static void BlockModel_DrawParts(const int* texIndices, int texCount) {
 	int lastTexIndex, i, offset = 0, count = 0;
 
-	lastTexIndex = bModel_texIndices[0];
-	for (i = 0; i < bModel_index; i++, count += 4) 
+	lastTexIndex = texIndices[0];
+	for (i = 0; i < texCount; i++, count += 4) 
 	{
-		if (bModel_texIndices[i] == lastTexIndex) continue;
+		if (texIndices[i] == lastTexIndex) continue;
 
 		/* Different 1D flush texture, flush current vertices */
 		Atlas1D_Bind(lastTexIndex);
 		Gfx_DrawVb_IndexedTris_Range(count, offset);
-		lastTexIndex = bModel_texIndices[i];
+		lastTexIndex = texIndices[i];
 			
 		offset += count;
 		count   = 0;
@@ -2216,13 +2280,12 @@ static void BlockModel_DrawParts(void) {
 	Gfx_DrawVb_IndexedTris_Range(count, offset);
 }
 
-static void BlockModel_Draw(struct Entity* e) {
-	cc_bool sprite;
+/* Returns false if the entity's block is invisible (i.e. gas) */
+static cc_bool BlockModel_Setup(struct Entity* e) {
 	int i;
-
 	bModel_block = e->ModelBlock;
 	bModel_index = 0;
-	if (Blocks.Draw[bModel_block] == DRAW_GAS) return;
+	if (Blocks.Draw[bModel_block] == DRAW_GAS) return false;
 
 	if (Blocks.Brightness[bModel_block]) {
 		for (i = 0; i < FACE_COUNT; i++)
@@ -2230,15 +2293,66 @@ static void BlockModel_Draw(struct Entity* e) {
 			Models.Cols[i] = PACKEDCOL_WHITE;
 		}
 	}
+	return true;
+}
+
+static void BlockModel_Draw(struct Entity* e) {
+	cc_bool sprite;
+	if (!BlockModel_Setup(e)) return;
 
 	sprite = Blocks.Draw[bModel_block] == DRAW_SPRITE;
-	BlockModel_BuildParts(e, sprite);
+	Model_LockVB(e, sprite ? BLOCKMODEL_SPRITE_COUNT : BLOCKMODEL_CUBE_COUNT);
+	BlockModel_BuildParts(sprite, Models.Vertices);
+	Model_UnlockVB();
 
 	if (sprite) Gfx_SetFaceCulling(true);
-	BlockModel_DrawParts();
+	BlockModel_DrawParts(bModel_texIndices, bModel_index);
 	if (sprite) Gfx_SetFaceCulling(false);
 }
 
+void BlockModel_RenderCached(struct Entity* e, struct BlockModelMesh* mesh) {
+	struct Matrix m, transform;
+	struct VertexTextured* ptr;
+	cc_bool sprite;
+	int i;
+
+	Model_SetupState(Models.Block, e);
+	if (!BlockModel_Setup(e)) return;
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	sprite = Blocks.Draw[bModel_block] == DRAW_SPRITE;
+
+	/* Only the color of the entity changes between most frames, */
+	/*  with any animation being done purely through the transform */
+	if (!mesh->valid || mesh->block != bModel_block || mesh->col != Models.Cols[0]) {
+		if (!mesh->vb) mesh->vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, BLOCKMODEL_MAX_VERTICES);
+
+		ptr = (struct VertexTextured*)Gfx_LockDynamicVb(mesh->vb, VERTEX_FORMAT_TEXTURED,
+								sprite ? BLOCKMODEL_SPRITE_COUNT : BLOCKMODEL_CUBE_COUNT);
+		BlockModel_BuildParts(sprite, ptr);
+		Gfx_UnlockDynamicVb(mesh->vb);
+
+		for (i = 0; i < bModel_index; i++)
+		{
+			mesh->texIndices[i] = bModel_texIndices[i];
+		}
+		mesh->texCount = bModel_index;
+		mesh->block    = bModel_block;
+		mesh->col      = Models.Cols[0];
+		mesh->valid    = true;
+	} else {
+		Gfx_BindDynamicVb(mesh->vb);
+	}
+
+	Model_GetEntityTransform(Models.Block, e, &transform);
+	Matrix_Mul(&m, &transform, &Gfx.View);
+	Gfx_LoadMatrix(MATRIX_VIEW, &m);
+
+	if (sprite) Gfx_SetFaceCulling(true);
+	BlockModel_DrawParts(mesh->texIndices, mesh->texCount);
+	if (sprite) Gfx_SetFaceCulling(false);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+}
+
 static struct Model block_model = { "block", NULL, &human_tex,
 	Model_NoParts,       BlockModel_Draw,
 	BlockModel_GetNameY, BlockModel_GetEyeY,
@@ -148,6 +148,18 @@ CC_API void Model_DrawPart(struct ModelPart* part);
 CC_API void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart* part, cc_bool head);
 /* Renders the 'arm' of a model. */
 void Model_RenderArm(struct Model* model, struct Entity* entity);
+
+/* Mesh of a block model that is kept between frames, for a block drawn every frame (e.g. held block) */
+struct BlockModelMesh {
+	GfxResourceID vb;
+	BlockID block;
+	PackedCol col;
+	cc_bool valid;
+	int texCount, texIndices[8];
+};
+/* Draws the given entity as the block model, only rebuilding the mesh when its block or color changes. */
+/* NOTE: Set valid to false when block definitions or the terrain atlas changes. */
+void BlockModel_RenderCached(struct Entity* entity, struct BlockModelMesh* mesh);
 /* Draws the given part with appropriate rotation to produce an arm look. */
 CC_API void Model_DrawArmPart(struct ModelPart* part);
 
@@ -274,6 +286,10 @@ struct CustomModelPart {
 	cc_uint8 animAxis[MAX_CUSTOM_MODEL_ANIMS];
 	cc_bool fullbright;
 	cc_bool firstPersonArm;
+	/* Bit for each animation that only depends on time (and so is the same for all entities) */
+	cc_uint8 timeAnims;
+	/* Values of time based animations, calculated once per frame */
+	float timeAnimValues[MAX_CUSTOM_MODEL_ANIMS];
 };
 
 struct CustomModel {
@@ -293,6 +309,8 @@ struct CustomModel {
 	cc_uint8 numParts;
 	cc_uint8 numArmParts;
 	struct CustomModelPart parts[MAX_CUSTOM_MODEL_PARTS];
+	/* Value of Game.Time when time based animations of parts were last calculated */
+	double animTime;
 };
 
 struct CustomModel* CustomModel_Get(int id);
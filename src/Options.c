@@ -16,9 +16,188 @@ static cc_bool savingPaused;
 	#define OPTIONS_SAVE_IMMEDIATELY
 #endif
 
+
+/*########################################################################################################################*
+*------------------------------------------------------Options index------------------------------------------------------*
+*#########################################################################################################################*/
+/* options.txt can easily have hundreds of entries (e.g. hotkeys), so rather than comparing */
+/*  against every entry's key, options are looked up using a hash table of their keys */
+/* Each slot is the index of the entry + 1, or 0 when the slot is empty */
+static int* optsIndex;
+static int optsIndexMask;
+/* Number of entries when the index was built, or -1 when the index needs to be rebuilt */
+static int optsIndexCount = -1;
+#define OPTS_INDEX_MIN_SIZE 256
+
+/* Since keys are case insensitive, the hash must be too */
+static cc_uint32 OptsIndex_Hash(const cc_string* key) {
+	cc_uint32 hash = 2166136261UL;
+	char c;
+	int i;
+
+	for (i = 0; i < key->length; i++) 
+	{
+		c = key->buffer[i]; Char_MakeLower(c);
+		hash = (hash ^ (cc_uint8)c) * 16777619UL;
+	}
+	return hash;
+}
+
+/* Returns index of the entry with the given key, or -1 and the empty slot it would go in if not */
+static int OptsIndex_Find(const cc_string* key, int* slot) {
+	cc_string entry, curKey, curValue;
+	int i = (int)(OptsIndex_Hash(key) & optsIndexMask);
+
+	for (; optsIndex[i]; i = (i + 1) & optsIndexMask) 
+	{
+		StringsBuffer_UNSAFE_GetRaw(&Options, optsIndex[i] - 1, &entry);
+		String_UNSAFE_Separate(&entry, '=', &curKey, &curValue);
+		if (String_CaselessEquals(key, &curKey)) return optsIndex[i] - 1;
+	}
+	*slot = i;
+	return -1;
+}
+
+static void OptsIndex_Rebuild(void) {
+	cc_string entry, key, value;
+	int i, slot, size = OPTS_INDEX_MIN_SIZE;
+	/* Keep the table at most half full, so probe sequences stay short */
+	while (size < Options.count * 2) size *= 2;
+
+	if (size - 1 != optsIndexMask) {
+		Mem_Free(optsIndex);
+		optsIndex     = (int*)Mem_Alloc(size, sizeof(int), "options index");
+		optsIndexMask = size - 1;
+	}
+	Mem_Set(optsIndex, 0, size * sizeof(int));
+
+	for (i = 0; i < Options.count; i++) 
+	{
+		StringsBuffer_UNSAFE_GetRaw(&Options, i, &entry);
+		String_UNSAFE_Separate(&entry, '=', &key, &value);
+		/* First entry with a key takes priority, same as EntryList_UNSAFE_Get */
+		if (OptsIndex_Find(&key, &slot) >= 0) continue;
+		optsIndex[slot] = i + 1;
+	}
+	optsIndexCount = Options.count;
+}
+
+/* Must be called whenever entries are added to or removed from Options */
+#define OptsIndex_Invalidate() optsIndexCount = -1
+
+static cc_string OptsIndex_Get(const cc_string* key) {
+	cc_string entry, curKey, curValue;
+	int i, slot;
+	if (optsIndexCount != Options.count) OptsIndex_Rebuild();
+
+	i = OptsIndex_Find(key, &slot);
+	if (i == -1) return String_Empty;
+
+	StringsBuffer_UNSAFE_GetRaw(&Options, i, &entry);
+	String_UNSAFE_Separate(&entry, '=', &curKey, &curValue);
+	return curValue;
+}
+
+static void OptsIndex_Free(void) {
+	Mem_Free(optsIndex);
+	optsIndex      = NULL;
+	optsIndexMask  = 0;
+	optsIndexCount = -1;
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Options saving------------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_FILERENAME
+static const cc_string opts_path    = String_FromConst("options.txt");
+static const cc_string opts_tmpPath = String_FromConst("options.txt.tmp");
+
+/* Converts all the entries into the contents of options.txt */
+static cc_uint8* SerialiseOptions(cc_uint32* len) {
+	cc_string entry;
+	cc_uint8* data;
+	const char* nl;
+	int i, j, size;
+
+	/* Each character is at most 3 bytes in UTF8 */
+	size = Options.totalLength * 3 + Options.count * 2 + 1;
+	data = (cc_uint8*)Mem_Alloc(size, 1, "options contents");
+	*len = 0;
+
+	for (i = 0; i < Options.count; i++) 
+	{
+		StringsBuffer_UNSAFE_GetRaw(&Options, i, &entry);
+		for (j = 0; j < entry.length; j++) 
+		{
+			*len += Convert_CP437ToUtf8(entry.buffer[j], data + *len);
+		}
+		for (nl = _NL; *nl; nl++) { data[(*len)++] = *nl; }
+	}
+	return data;
+}
+
+/* The contents are written to a separate file first, as otherwise options.txt */
+/*  ends up empty or only partially written if the game is killed partway through */
+static cc_result WriteOptions(const cc_uint8* data, cc_uint32 len, const char** place) {
+	cc_filepath src, dst;
+	struct Stream stream;
+	cc_result res;
+
+	*place = "creating";
+	if ((res = Stream_CreateFile(&stream, &opts_tmpPath))) return res;
+
+	*place = "writing to";
+	if ((res = Stream_Write(&stream, data, len))) { stream.Close(&stream); return res; }
+	*place = "closing";
+	if ((res = stream.Close(&stream))) return res;
+
+	*place = "replacing options.txt with";
+	Platform_EncodePath(&src, &opts_tmpPath);
+	Platform_EncodePath(&dst, &opts_path);
+	return File_Rename(&src, &dst);
+}
+#endif
+
+#ifdef CC_BUILD_OPTIONSWORKER
+/* Writing to slow storage (e.g. flash) can take a while, so options.txt */
+/*  is written out on a background thread from a copy of its contents */
+static void* save_thread;
+static cc_uint8* save_data;
+static cc_uint32 save_len;
+static const char* save_place;
+static cc_result save_result;
+
+static void SaveWorker_Run(void) {
+	save_result = WriteOptions(save_data, save_len, &save_place);
+}
+
+/* Waits for options.txt to finish being written, then reports whether it was saved */
+static void SaveWorker_Finish(void) {
+	if (!save_thread) return;
+	Thread_Join(save_thread);
+	save_thread = NULL;
+
+	Mem_Free(save_data);
+	save_data = NULL;
+	if (save_result) Logger_SysWarn2(save_result, save_place, &opts_tmpPath);
+}
+
+static void SaveWorker_Start(void) {
+	/* Only one save can be in progress at once */
+	SaveWorker_Finish();
+	save_data = SerialiseOptions(&save_len);
+	Thread_Run(&save_thread, SaveWorker_Run, 64 * 1024, "Options saver");
+}
+#else
+#define SaveWorker_Finish()
+#endif
+
 void Options_Free(void) {
+	SaveWorker_Finish();
 	StringsBuffer_Clear(&Options);
 	StringsBuffer_Clear(&changedOpts);
+	OptsIndex_Free();
 }
 
 static cc_bool HasChanged(const cc_string* key) {
@@ -43,11 +222,14 @@ void Options_Load(void) {
 	StringsBuffer_SetLengthBits(&Options, 11);
 	Options_LoadResult = EntryList_Load(&Options, "options-default.txt", '=', NULL);
 	Options_LoadResult = EntryList_Load(&Options, "options.txt",         '=', NULL);
+	OptsIndex_Invalidate();
 }
 
 void Options_Reload(void) {
 	cc_string entry, key, value;
 	int i;
+	/* Make sure options.txt isn't still being written */
+	SaveWorker_Finish();
 
 	/* Reset all the unchanged options */
 	for (i = Options.count - 1; i >= 0; i--) {
@@ -59,18 +241,33 @@ void Options_Reload(void) {
 	}
 	/* Load only options which have not changed */
 	Options_LoadResult = EntryList_Load(&Options, "options.txt", '=', Options_LoadFilter);
+	OptsIndex_Invalidate();
 }
 
 static void SaveOptions(void) {
+#if defined CC_BUILD_OPTIONSWORKER
+	SaveWorker_Start();
+#elif defined CC_BUILD_FILERENAME
+	const char* place;
+	cc_uint32 len;
+	cc_uint8* data = SerialiseOptions(&len);
+	cc_result res  = WriteOptions(data, len, &place);
+
+	Mem_Free(data);
+	if (res) Logger_SysWarn2(res, place, &opts_tmpPath);
+#else
 	EntryList_Save(&Options, "options.txt");
+#endif
 	StringsBuffer_Clear(&changedOpts);
 }
 
 void Options_SaveIfChanged(void) {
-	if (!changedOpts.count) return;
-	
-	Options_Reload();
-	SaveOptions();
+	if (changedOpts.count) {
+		Options_Reload();
+		SaveOptions();
+	}
+	/* Callers expect options.txt to be saved afterwards (e.g. before starting game process) */
+	SaveWorker_Finish();
 }
 
 void Options_PauseSaving(void) { savingPaused = true; }
@@ -87,7 +284,7 @@ cc_bool Options_UNSAFE_Get(const char* keyRaw, cc_string* value) {
 	int idx;
 	cc_string key = String_FromReadonly(keyRaw);
 
-	*value = EntryList_UNSAFE_Get(&Options, &key, '=');
+	*value = OptsIndex_Get(&key);
 	if (value->length) return true; 
 
 	/* Fallback to without '-' (e.g. "hacks-fly" to "fly") */
@@ -96,7 +293,7 @@ cc_bool Options_UNSAFE_Get(const char* keyRaw, cc_string* value) {
 	if (idx == -1) return false;
 	key = String_UNSAFE_SubstringAt(&key, idx + 1);
 
-	*value = EntryList_UNSAFE_Get(&Options, &key, '=');
+	*value = OptsIndex_Get(&key);
 	return value->length > 0;
 }
 
@@ -184,6 +381,7 @@ void Options_SetString(const cc_string* key, const cc_string* value) {
 	} else {
 		EntryList_Set(&Options, key, value, '=');
 	}
+	OptsIndex_Invalidate();
 
 #if defined OPTIONS_SAVE_IMMEDIATELY
 	if (!savingPaused) SaveOptions();
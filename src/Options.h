@@ -17,16 +17,27 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_VIEW_DISTANCE "viewdist"
 #define OPT_BLOCK_PHYSICS "singleplayerphysics"
 #define OPT_NAMES_MODE "namesmode"
+#define OPT_NAMES_DISTANCE "namesdistance"
 #define OPT_INVERT_MOUSE "invertmouse"
 #define OPT_SENSITIVITY "mousesensitivity"
 #define OPT_FPS_LIMIT "fpslimit"
+#define OPT_FRAMES_IN_FLIGHT "gfx-framesinflight"
+#define OPT_IDLE_RENDERING "gfx-idlerendering"
+#define OPT_DYNAMIC_RESOLUTION "gfx-dynamicresolution"
 #define OPT_DEFAULT_TEX_PACK "defaulttexpack"
 #define OPT_VIEW_BOBBING "viewbobbing"
 #define OPT_ENTITY_SHADOW "entityshadow"
+#define OPT_INTERP_DELAY "entity-interpdelay"
+#define OPT_ENTITY_DRAW_DISTANCE "entity-drawdistance"
+#define OPT_ENTITY_ANIM_DISTANCE "entity-animdistance"
 #define OPT_RENDER_TYPE "normal"
 #define OPT_SMOOTH_LIGHTING "gfx-smoothlighting"
+#define OPT_GREEDY_MESHING "gfx-greedymeshing"
 #define OPT_LIGHTING_MODE "gfx-lightingmode"
 #define OPT_MIPMAPS "gfx-mipmaps"
+#define OPT_COMPRESS_TEXTURES "gfx-compresstextures"
+#define OPT_LAZY_ATLAS "gfx-lazyatlas"
+#define OPT_ATLAS_EVICT_TIME "gfx-atlasevicttime"
 #define OPT_CHAT_LOGGING "chat-logging"
 #define OPT_WINDOW_WIDTH "window-width"
 #define OPT_WINDOW_HEIGHT "window-height"
@@ -71,6 +82,15 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_CLASSIC_CHAT "nostalgia-classicchat"
 #define OPT_CLASSIC_INVENTORY "nostalgia-classicinventory"
 #define OPT_MAX_CHUNK_UPDATES "gfx-maxchunkupdates"
+#define OPT_CHUNK_WORKERS "gfx-chunkworkers"
+#define OPT_SOFTGPU_WORKERS "gfx-softgpuworkers"
+#define OPT_SOFTGPU_SIMD "gfx-softgpusimd"
+#define OPT_OCCLUSION_CULLING "gfx-occlusionculling"
+#define OPT_LOD_DISTANCE "gfx-loddistance"
+#define OPT_CHUNK_BUDGET "gfx-chunkbudget"
+#define OPT_MESH_BUDGET "gfx-meshbudget"
+#define OPT_DEPTH_PREPASS "gfx-depthprepass"
+#define OPT_SORT_TRANSLUCENT "gfx-sorttranslucent"
 #define OPT_CAMERA_MASS "cameramass"
 #define OPT_CAMERA_SMOOTH "camera-smooth"
 #define OPT_GRAB_CURSOR "win-grab-cursor"
@@ -80,11 +100,15 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_HTTP_ONLY "http-no-https"
 #define OPT_HTTPS_VERIFY "https-verify"
 #define OPT_SKIN_SERVER "http-skinserver"
+#define OPT_HTTP_WORKERS "http-workers"
 #define OPT_RAW_INPUT "win-raw-input"
 #define OPT_DPI_SCALING "win-dpi-scaling"
 #define OPT_GAME_VERSION "game-version"
 #define OPT_INV_SCROLLBAR_SCALE "inv-scrollbar-scale"
 #define OPT_ANAGLYPH3D "anaglyph-3d"
+#define OPT_MAP_CACHE "map-fastloadcache"
+#define OPT_TEXCACHE_MAX_SIZE "texturecache-maxsizemb"
+#define OPT_FILE_BUFFER_SIZE "file-buffersize"
 
 #define OPT_SELECTED_BLOCK_OUTLINE_COLOR "selected-block-outline-color"
 #define OPT_SELECTED_BLOCK_OUTLINE_OPACITY "selected-block-outline-opacity"
@@ -9,11 +9,14 @@
 #include "Funcs.h"
 #include "Game.h"
 #include "Event.h"
+#include "Platform.h"
 
-#ifdef CC_BUILD_TINYMEM
+#if defined CC_BUILD_TINYMEM
 	#define PARTICLES_MAX 10
-#else
+#elif defined CC_BUILD_LOWMEM
 	#define PARTICLES_MAX 600
+#else
+	#define PARTICLES_MAX 4096
 #endif
 
 
@@ -176,28 +179,31 @@ static void Rain_Render(float t) {
 	Gfx_DrawVb_IndexedTris(rain_count * 4);
 }
 
-static void Rain_RemoveAt(int i) {
-	for (; i < rain_count - 1; i++) {
-		rain_Particles[i] = rain_Particles[i + 1];
-	}
-	rain_count--;
+/* Removes the given number of oldest particles, to make room for new ones */
+static void Rain_RemoveOldest(int count) {
+	count = min(count, rain_count);
+	rain_count -= count;
+	Mem_Move(rain_Particles, rain_Particles + count, rain_count * sizeof(struct Particle));
 }
 
 static void Rain_Tick(float delta) {
-	int i;
+	int i, j = 0;
+	/* Expired particles are removed by compacting the remaining particles in one pass */
 	for (i = 0; i < rain_count; i++) {
-		if (RainParticle_Tick(&rain_Particles[i], delta)) {
-			Rain_RemoveAt(i); i--;
-		}
+		if (RainParticle_Tick(&rain_Particles[i], delta)) continue;
+
+		if (i != j) rain_Particles[j] = rain_Particles[i];
+		j++;
 	}
+	rain_count = j;
 }
 
 void Particles_RainSnowEffect(float x, float y, float z) {
 	struct Particle* p;
 	int i, type;
+	if (rain_count + 2 > PARTICLES_MAX) Rain_RemoveOldest(rain_count + 2 - PARTICLES_MAX);
 
 	for (i = 0; i < 2; i++) {
-		if (rain_count == PARTICLES_MAX) Rain_RemoveAt(0);
 		p = &rain_Particles[rain_count++];
 
 		p->velocity.x = Random_Float(&rnd) * 0.8f - 0.4f; /* [-0.4, 0.4] */
@@ -306,22 +312,24 @@ static void Terrain_Render(float t) {
 	}
 }
 
-static void Terrain_RemoveAt(int i) {
-	for (; i < terrain_count - 1; i++) 
-	{
-		terrain_particles[i] = terrain_particles[i + 1];
-	}
-	terrain_count--;
+/* Removes the given number of oldest particles, to make room for new ones */
+static void Terrain_RemoveOldest(int count) {
+	count = min(count, terrain_count);
+	terrain_count -= count;
+	Mem_Move(terrain_particles, terrain_particles + count, terrain_count * sizeof(struct TerrainParticle));
 }
 
 static void Terrain_Tick(float delta) {
-	int i;
+	int i, j = 0;
+	/* Expired particles are removed by compacting the remaining particles in one pass */
 	for (i = 0; i < terrain_count; i++) 
 	{
-		if (TerrainParticle_Tick(&terrain_particles[i], delta)) {
-			Terrain_RemoveAt(i); i--;
-		}
+		if (TerrainParticle_Tick(&terrain_particles[i], delta)) continue;
+
+		if (i != j) terrain_particles[j] = terrain_particles[i];
+		j++;
 	}
+	terrain_count = j;
 }
 
 void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
@@ -366,6 +374,10 @@ void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
 
 	maxU2 = baseRec.u1 + maxU * uScale;
 	maxV2 = baseRec.v1 + maxV * vScale;
+	/* Make room for the maximum number of particles that might be spawned all at once */
+	#define GRID_CELLS (GRID_SIZE * GRID_SIZE * GRID_SIZE)
+	if (terrain_count + GRID_CELLS > PARTICLES_MAX) Terrain_RemoveOldest(terrain_count + GRID_CELLS - PARTICLES_MAX);
+
 	for (x = 0; x < GRID_SIZE; x++) {
 		for (y = 0; y < GRID_SIZE; y++) {
 			for (z = 0; z < GRID_SIZE; z++) {
@@ -375,7 +387,7 @@ void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
 				if (cell.x < minBB.x || cell.x > maxBB.x || cell.y < minBB.y
 					|| cell.y > maxBB.y || cell.z < minBB.z || cell.z > maxBB.z) continue;
 
-				if (terrain_count == PARTICLES_MAX) Terrain_RemoveAt(0);
+				if (terrain_count == PARTICLES_MAX) continue;
 				p = &terrain_particles[terrain_count++];
 
 				/* centre random offset around [-0.2, 0.2] */
@@ -488,20 +500,23 @@ static void Custom_Render(float t) {
 	Gfx_DrawVb_IndexedTris(custom_count * 4);
 }
 
-static void Custom_RemoveAt(int i) {
-	for (; i < custom_count - 1; i++) {
-		custom_particles[i] = custom_particles[i + 1];
-	}
-	custom_count--;
+/* Removes the given number of oldest particles, to make room for new ones */
+static void Custom_RemoveOldest(int count) {
+	count = min(count, custom_count);
+	custom_count -= count;
+	Mem_Move(custom_particles, custom_particles + count, custom_count * sizeof(struct CustomParticle));
 }
 
 static void Custom_Tick(float delta) {
-	int i;
+	int i, j = 0;
+	/* Expired particles are removed by compacting the remaining particles in one pass */
 	for (i = 0; i < custom_count; i++) {
-		if (CustomParticle_Tick(&custom_particles[i], delta)) {
-			Custom_RemoveAt(i); i--;
-		}
+		if (CustomParticle_Tick(&custom_particles[i], delta)) continue;
+
+		if (i != j) custom_particles[j] = custom_particles[i];
+		j++;
 	}
+	custom_count = j;
 }
 
 void Particles_CustomEffect(int effectID, float x, float y, float z, float originX, float originY, float originZ) {
@@ -512,10 +527,12 @@ void Particles_CustomEffect(int effectID, float x, float y, float z, float origi
 	float d;
 
 	origin.x = originX; origin.y = originY; origin.z = originZ;
+	/* Make room for all the new particles at once, instead of shifting every particle for each new one */
+	count = min(count, PARTICLES_MAX);
+	if (custom_count + count > PARTICLES_MAX) Custom_RemoveOldest(custom_count + count - PARTICLES_MAX);
 
 	for (i = 0; i < count; i++) 
 	{
-		if (custom_count == PARTICLES_MAX) Custom_RemoveAt(0);
 		p = &custom_particles[custom_count++];
 		p->effectId = effectID;
 
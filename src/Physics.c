@@ -149,18 +149,58 @@ static void Searcher_QuickSort(int left, int right) {
 	}
 }
 
-int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, struct AABB* entityExtentBB) {
-	Vec3 vel = entity->Velocity;
-	IVec3 min, max;
-	cc_uint32 elements;
-	struct SearcherState* curState;
-	int count;
-
+static struct SearcherState* Searcher_FindInRange(struct SearcherState* curState, Vec3* vel, 
+												struct AABB* entityBB, struct AABB* entityExtentBB, IVec3 min, IVec3 max) {
 	BlockID block;
 	struct AABB blockBB;
 	float xx, yy, zz, tx, ty, tz;
 	int x, y, z;
 
+	/* Order loops so that we minimise cache misses */
+	for (y = min.y; y <= max.y; y++) {
+		for (z = min.z; z <= max.z; z++) {
+			for (x = min.x; x <= max.x; x++) {
+				block = World_GetPhysicsBlock(x, y, z);
+				if (Block_PhysInfo[block].collide != COLLIDE_SOLID) continue;
+
+				xx = (float)x; yy = (float)y; zz = (float)z;
+				blockBB.Min = Block_PhysInfo[block].minBB;
+				blockBB.Min.x += xx; blockBB.Min.y += yy; blockBB.Min.z += zz;
+				blockBB.Max = Block_PhysInfo[block].maxBB;
+				blockBB.Max.x += xx; blockBB.Max.y += yy; blockBB.Max.z += zz;
+
+				if (!AABB_Intersects(entityExtentBB, &blockBB)) continue; /* necessary for non whole blocks. (slabs) */
+				Searcher_CalcTime(vel, entityBB, &blockBB, &tx, &ty, &tz);
+				if (tx > 1.0f || ty > 1.0f || tz > 1.0f) continue;
+
+				curState->x = (x << 3) | (block  & 0x007);
+				curState->y = (y << 4) | ((block & 0x078) >> 3);
+				curState->z = (z << 3) | ((block & 0x380) >> 7);
+				curState->tSquared = tx * tx + ty * ty + tz * tz;
+				curState++;
+			}
+		}
+	}
+	return curState;
+}
+
+/* Whether the given range of a chunk sized section of the map is inside the map and only contains one non-solid block */
+static cc_bool Searcher_CanSkipSection(int cx, int cy, int cz, IVec3 min, IVec3 max) {
+	int block;
+	if (min.x < 0 || min.y < 0 || min.z < 0) return false;
+	if (max.x >= World.Width || max.y >= World.Height || max.z >= World.Length) return false;
+
+	block = World_GetSectionBlock(cx, cy, cz);
+	return block != WORLD_SECTION_MIXED && Block_PhysInfo[block].collide != COLLIDE_SOLID;
+}
+
+int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, struct AABB* entityExtentBB) {
+	Vec3 vel = entity->Velocity;
+	IVec3 min, max, secMin, secMax;
+	cc_uint32 elements;
+	struct SearcherState* curState;
+	int cx, cy, cz, count;
+
 	Entity_GetBounds(entity, entityBB);
 	/* Exact maximum extent the entity can reach, and the equivalent map coordinates. */
 	entityExtentBB->Min.x = entityBB->Min.x + (vel.x < 0.0f ? vel.x : 0.0f);
@@ -177,39 +217,31 @@ int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, s
 
 	if (elements > searcherCapacity) {
 		Searcher_Free();
-		searcherCapacity = elements;
-		Searcher_States  = (struct SearcherState*)Mem_Alloc(elements, sizeof(struct SearcherState), "collision search states");
+		/* Grow geometrically, so that speeding up does not reallocate every tick */
+		searcherCapacity = max(elements, searcherCapacity * 2);
+		Searcher_States  = (struct SearcherState*)Mem_Alloc(searcherCapacity, sizeof(struct SearcherState), "collision search states");
 	}
 	curState = Searcher_States;
 
-	/* Order loops so that we minimise cache misses */
-	for (y = min.y; y <= max.y; y++) {
-		for (z = min.z; z <= max.z; z++) {
-			for (x = min.x; x <= max.x; x++) {
-				block = World_GetPhysicsBlock(x, y, z);
-				if (Blocks.Collide[block] != COLLIDE_SOLID) continue;
+	/* Fast flying entities sweep through large volumes, which are usually mostly air */
+	/* So skip over any chunk sized sections of the map that only contain a non-solid block */
+	for (cy = min.y >> CHUNK_SHIFT; cy <= max.y >> CHUNK_SHIFT; cy++) {
+		secMin.y = max(min.y, cy << CHUNK_SHIFT); secMax.y = min(max.y, (cy << CHUNK_SHIFT) + CHUNK_MAX);
 
-				xx = (float)x; yy = (float)y; zz = (float)z;
-				blockBB.Min = Blocks.MinBB[block];
-				blockBB.Min.x += xx; blockBB.Min.y += yy; blockBB.Min.z += zz;
-				blockBB.Max = Blocks.MaxBB[block];
-				blockBB.Max.x += xx; blockBB.Max.y += yy; blockBB.Max.z += zz;
+		for (cz = min.z >> CHUNK_SHIFT; cz <= max.z >> CHUNK_SHIFT; cz++) {
+			secMin.z = max(min.z, cz << CHUNK_SHIFT); secMax.z = min(max.z, (cz << CHUNK_SHIFT) + CHUNK_MAX);
 
-				if (!AABB_Intersects(entityExtentBB, &blockBB)) continue; /* necessary for non whole blocks. (slabs) */
-				Searcher_CalcTime(&vel, entityBB, &blockBB, &tx, &ty, &tz);
-				if (tx > 1.0f || ty > 1.0f || tz > 1.0f) continue;
+			for (cx = min.x >> CHUNK_SHIFT; cx <= max.x >> CHUNK_SHIFT; cx++) {
+				secMin.x = max(min.x, cx << CHUNK_SHIFT); secMax.x = min(max.x, (cx << CHUNK_SHIFT) + CHUNK_MAX);
 
-				curState->x = (x << 3) | (block  & 0x007);
-				curState->y = (y << 4) | ((block & 0x078) >> 3);
-				curState->z = (z << 3) | ((block & 0x380) >> 7);
-				curState->tSquared = tx * tx + ty * ty + tz * tz;
-				curState++;
+				if (Searcher_CanSkipSection(cx, cy, cz, secMin, secMax)) continue;
+				curState = Searcher_FindInRange(curState, &vel, entityBB, entityExtentBB, secMin, secMax);
 			}
 		}
 	}
 
 	count = (int)(curState - Searcher_States);
-	if (count) Searcher_QuickSort(0, count - 1);
+	if (count > 1) Searcher_QuickSort(0, count - 1);
 	return count;
 }
 
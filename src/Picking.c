@@ -159,7 +159,8 @@ static cc_bool RayTrace(struct RayTracer* t, const Vec3* origin, const Vec3* dir
 	float dxMin, dxMax, dx;
 	float dyMin, dyMax, dy;
 	float dzMin, dzMax, dz;
-	int i, x, y, z;
+	int i, x, y, z, cx, cy, cz;
+	cc_bool skipAir, airSection, inSection;
 
 	RayTracer_Init(t, origin, dir);
 	/* Check if origin is at NaN (happens if player's position is at infinity) */
@@ -172,12 +173,22 @@ static cc_bool RayTrace(struct RayTracer* t, const Vec3* origin, const Vec3* dir
 	/*  pick blocks on the INSIDE of the map borders instead of OUTSIDE them */
 	insideMap = World_ContainsXZ(pOrigin.x, pOrigin.z) && pOrigin.y >= 0;
 	reachSq   = reach * reach;
+	skipAir   = insideMap && Blocks.Draw[BLOCK_AIR] == DRAW_GAS;
 		
 	for (i = 0; i < 25000; i++) {
 		x   = t->pos.x; y   = t->pos.y; z   = t->pos.z;
 		v.x = (float)x; v.y = (float)y; v.z = (float)z;
-
-		t->block = insideMap ? Picking_GetInside(x, y, z) : Picking_GetOutside(x, y, z, pOrigin);
+		cx  = x >> CHUNK_SHIFT; cy = y >> CHUNK_SHIFT; cz = z >> CHUNK_SHIFT;
+
+		/* Everything above the map is also air, so is skipped through the same way */
+		inSection  = y < World.Height;
+		airSection = skipAir && World_ContainsXZ(x, z) && y >= 0
+					&& (!inSection || World_GetSectionBlock(cx, cy, cz) == BLOCK_AIR);
+		if (airSection) {
+			t->block = BLOCK_AIR;
+		} else {
+			t->block = insideMap ? Picking_GetInside(x, y, z) : Picking_GetOutside(x, y, z, pOrigin);
+		}
 		Vec3_Add(&t->Min, &v, &Blocks.RenderMinBB[t->block]);
 		Vec3_Add(&t->Max, &v, &Blocks.RenderMaxBB[t->block]);
 
@@ -187,6 +198,19 @@ static cc_bool RayTrace(struct RayTracer* t, const Vec3* origin, const Vec3* dir
 		dx = min(dxMin, dxMax); dy = min(dyMin, dyMax); dz = min(dzMin, dzMax);
 		if (dx * dx + dy * dy + dz * dz > reachSq) return false;
 
+		/* Air can never be picked or clip the camera, so step straight through any chunk */
+		/*  sized sections of the map that entirely consist of air (e.g. sky with large reach) */
+		/* NOTE: A section partially above the map top is only skipped through above the map, */
+		/*  unless the part of it inside the map is all air too */
+		if (airSection) {
+			do {
+				RayTracer_Step(t);
+			} while ((t->pos.x >> CHUNK_SHIFT) == cx && (t->pos.y >> CHUNK_SHIFT) == cy
+				&& (t->pos.z >> CHUNK_SHIFT) == cz && World_ContainsXZ(t->pos.x, t->pos.z)
+				&& t->pos.y >= 0 && (inSection || t->pos.y >= World.Height));
+			continue;
+		}
+
 		if (intersect(t)) return true;
 		RayTracer_Step(t);
 	}
@@ -162,6 +162,47 @@ CC_API void* Mem_Realloc(void* mem, cc_uint32 numElems, cc_uint32 elemsSize, con
 /* Frees an allocated a block of memory. Does nothing when passed NULL. */
 CC_API void  Mem_Free(void* mem);
 
+/* Subsystems that allocations are attributed to when built with CC_BUILD_MEMTRACK */
+/* NOTE: A .c file can tag all of its allocations by defining MEM_SUBSYSTEM after its #includes */
+enum MemSubsystem {
+	MEM_SYS_OTHER, MEM_SYS_WORLD, MEM_SYS_LIGHTING, MEM_SYS_CHUNKS, MEM_SYS_TEXTURES,
+	MEM_SYS_SKINS, MEM_SYS_HTTP, MEM_SYS_AUDIO, MEM_SYS_UI, MEM_SYS_GFX, MEM_SYS_COUNT,
+	/* Used by any .c file which doesn't define MEM_SUBSYSTEM */
+	MEM_SUBSYSTEM = MEM_SYS_OTHER
+};
+
+#ifdef CC_BUILD_MEMTRACK
+struct MemUsage { cc_uint32 live, peak; };
+extern const char* const Mem_SubsystemNames[MEM_SYS_COUNT];
+/* Gets the bytes currently and at most allocated by each subsystem, then in total */
+/* NOTE: usage must have room for MEM_SYS_COUNT + 1 entries */
+void Mem_GetUsage(struct MemUsage* usage);
+/* Changes which subsystem an allocation is attributed to */
+void Mem_Retag(void* mem, int subsystem);
+
+void* Mem_TryAllocTagged(cc_uint32 numElems, cc_uint32 elemsSize, int subsystem);
+void* Mem_TryAllocClearedTagged(cc_uint32 numElems, cc_uint32 elemsSize, int subsystem);
+void* Mem_TryReallocTagged(void* mem, cc_uint32 numElems, cc_uint32 elemsSize, int subsystem);
+void* Mem_AllocTagged(cc_uint32 numElems, cc_uint32 elemsSize, const char* place, int subsystem);
+void* Mem_AllocClearedTagged(cc_uint32 numElems, cc_uint32 elemsSize, const char* place, int subsystem);
+void* Mem_ReallocTagged(void* mem, cc_uint32 numElems, cc_uint32 elemsSize, const char* place, int subsystem);
+void  Mem_FreeTagged(void* mem);
+
+/* Platform backends define CC_MEM_UNTRACKED, since they implement the untracked functions */
+/* NOTE: Memory must only be freed by a file built the same way as the file that allocated it */
+#ifndef CC_MEM_UNTRACKED
+#define Mem_TryAlloc(numElems, elemsSize)               Mem_TryAllocTagged(numElems, elemsSize, MEM_SUBSYSTEM)
+#define Mem_TryAllocCleared(numElems, elemsSize)        Mem_TryAllocClearedTagged(numElems, elemsSize, MEM_SUBSYSTEM)
+#define Mem_TryRealloc(mem, numElems, elemsSize)        Mem_TryReallocTagged(mem, numElems, elemsSize, MEM_SUBSYSTEM)
+#define Mem_Alloc(numElems, elemsSize, place)           Mem_AllocTagged(numElems, elemsSize, place, MEM_SUBSYSTEM)
+#define Mem_AllocCleared(numElems, elemsSize, place)    Mem_AllocClearedTagged(numElems, elemsSize, place, MEM_SUBSYSTEM)
+#define Mem_Realloc(mem, numElems, elemsSize, place)    Mem_ReallocTagged(mem, numElems, elemsSize, place, MEM_SUBSYSTEM)
+#define Mem_Free(mem)                                   Mem_FreeTagged(mem)
+#endif
+#else
+#define Mem_Retag(mem, subsystem)
+#endif
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Memory modification--------------------------------------------------*
@@ -266,6 +307,19 @@ cc_result File_Seek(cc_file file, int offset, int seekType);
 cc_result File_Position(cc_file file, cc_uint32* pos);
 /* Attempts to retrieve the length of the given file. */
 cc_result File_Length(cc_file file, cc_uint32* len);
+#ifdef CC_BUILD_FILEMAP
+/* Attempts to map the entire contents of an existing file into memory for reading. */
+/* NOTE: Data is only read from disc when that part of the memory is first accessed. */
+cc_result File_Map(const cc_filepath* path, void** data, cc_uint32* len);
+/* Attempts to unmap memory previously mapped using File_Map. */
+cc_result File_Unmap(void* data, cc_uint32 len);
+#endif
+#ifdef CC_BUILD_FILERENAME
+/* Attempts to rename a file, replacing the destination file if it already exists. */
+cc_result File_Rename(const cc_filepath* src, const cc_filepath* dst);
+/* Attempts to delete a file. */
+cc_result File_Delete(const cc_filepath* path);
+#endif
 
 
 /*########################################################################################################################*
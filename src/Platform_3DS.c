@@ -202,9 +202,32 @@ static void Exec3DSThread(void* param) {
 	((Thread_StartFunc)param)(); 
 }
 
+// Core that background threads are created on, or -2 for the application core
+static int bg_core = -2;
+
+static void InitBackgroundCore(void) {
+	bool isNew3DS = false;
+	APT_CheckNew3DS(&isNew3DS);
+
+	// New 3DS has an extra core that applications can use freely
+	if (isNew3DS) { bg_core = 2; return; }
+
+	// Otherwise the system core can be used, but only for a limited percentage of its time
+	if (R_SUCCEEDED(APT_SetAppCpuTimeLimit(30))) bg_core = 1;
+}
+
 void Thread_Run(void** handle, Thread_StartFunc func, int stackSize, const char* name) {
 	//TODO: Not quite correct, but eh
-	*handle = threadCreate(Exec3DSThread, (void*)func, stackSize, 0x3f, -2, false);
+	Thread thread = NULL;
+	// Avoid competing with the main thread for the application core if possible
+	if (bg_core != -2) {
+		thread = threadCreate(Exec3DSThread, (void*)func, stackSize, 0x3f, bg_core, false);
+	}
+
+	if (!thread) {
+		thread = threadCreate(Exec3DSThread, (void*)func, stackSize, 0x3f, -2, false);
+	}
+	*handle = thread;
 }
 
 void Thread_Detach(void* handle) {
@@ -398,6 +421,7 @@ static void CreateRootDirectory(const char* path) {
 void Platform_Init(void) {
 	// Take full advantage of new 3DS if running on it
 	osSetSpeedupEnable(true);
+	InitBackgroundCore();
 	
 	// create root directories (no permissions anyways)
 	CreateRootDirectory("sdmc:/3ds");
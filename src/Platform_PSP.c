@@ -33,7 +33,7 @@ const char* Platform_AppNameSuffix = " PSP";
 cc_bool Platform_ReadonlyFilesystem;
 
 PSP_MODULE_INFO("ClassiCube", PSP_MODULE_USER, 1, 0);
-PSP_MAIN_THREAD_ATTR(PSP_THREAD_ATTR_USER);
+PSP_MAIN_THREAD_ATTR(PSP_THREAD_ATTR_USER | PSP_THREAD_ATTR_VFPU);
 
 PSP_DISABLE_AUTOSTART_PTHREAD() // reduces .elf size by 140 kb
 
@@ -212,7 +212,7 @@ static int ExecThread(unsigned int argc, void *argv) {
 
 void Thread_Run(void** handle, Thread_StartFunc func, int stackSize, const char* name) {
 	#define CC_THREAD_PRIORITY 17 // TODO: 18?
-	#define CC_THREAD_ATTRS 0 // TODO PSP_THREAD_ATTR_VFPU?
+	#define CC_THREAD_ATTRS PSP_THREAD_ATTR_VFPU // matrix maths may be used on any thread
 	Thread_StartFunc func_ = func;
 	
 	int threadID = sceKernelCreateThread(name, ExecThread, CC_THREAD_PRIORITY, 
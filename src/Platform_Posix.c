@@ -24,6 +24,7 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <utime.h>
 #include <signal.h>
@@ -325,6 +326,38 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 	*len = st.st_size; return 0;
 }
 
+#ifdef CC_BUILD_FILEMAP
+cc_result File_Map(const cc_filepath* path, void** data, cc_uint32* len) {
+	cc_file file;
+	cc_result res;
+	if ((res = File_Open(&file, path))) return res;
+
+	res = File_Length(file, len);
+	/* mmap always fails for zero length */
+	if (!res && !*len) res = ERR_INVALID_ARGUMENT;
+
+	if (!res) {
+		*data = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, file, 0);
+		if (*data == MAP_FAILED) res = errno;
+	}
+	/* Mapping remains valid even after the file is closed */
+	close(file);
+	return res;
+}
+
+cc_result File_Unmap(void* data, cc_uint32 len) {
+	return munmap(data, len) == -1 ? errno : 0;
+}
+#endif
+
+cc_result File_Rename(const cc_filepath* src, const cc_filepath* dst) {
+	return rename(src->buffer, dst->buffer) == -1 ? errno : 0;
+}
+
+cc_result File_Delete(const cc_filepath* path) {
+	return unlink(path->buffer) == -1 ? errno : 0;
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------------Threading--------------------------------------------------------*
@@ -359,6 +392,9 @@ void Thread_Run(void** handle, Thread_StartFunc func, int stackSize, const char*
 	pthread_attr_setstacksize(&attrs, stackSize);
 	
 	res = pthread_create(ptr, &attrs, ExecThread, (void*)func);
+	/* glibc reserves space for thread local variables from the thread's stack, */
+	/*  so creating a thread fails if they don't fit in the requested stack size */
+	if (res == EINVAL) res = pthread_create(ptr, NULL, ExecThread, (void*)func);
 	if (res) Logger_Abort2(res, "Creating thread");
 	pthread_attr_destroy(&attrs);
 	
@@ -752,10 +788,12 @@ cc_result Socket_CheckReadable(cc_socket s, cc_bool* readable) {
 cc_result Socket_CheckWritable(cc_socket s, cc_bool* writable) {
 	socklen_t resultSize = sizeof(socklen_t);
 	cc_result res = Socket_Poll(s, SOCKET_POLL_WRITE, writable);
-	if (res || *writable) return res;
+	if (res) return res;
 
 	/* https://stackoverflow.com/questions/29479953/so-error-value-after-successful-socket-operation */
+	/* NOTE: poll also reports a socket that failed to connect as being writable */
 	getsockopt(s, SOL_SOCKET, SO_ERROR, &res, &resultSize);
+	if (res) *writable = false;
 	return res;
 }
 
@@ -227,6 +227,155 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 /*########################################################################################################################*
 *--------------------------------------------------------Threading--------------------------------------------------------*
 *#########################################################################################################################*/
+#ifdef CC_BUILD_WEBTHREADS
+/* Threads are backed by Web Workers sharing the same memory (requires cross-origin isolation) */
+/* NOTE: Emscripten can only start a Web Worker once the main thread has returned to the */
+/*  browser event loop, so enough workers must be preallocated (see PTHREAD_POOL_SIZE) */
+/*  to ensure the main thread never blocks waiting on threads that haven't started yet */
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#define NS_PER_SEC 1000000000ULL
+
+void Thread_Sleep(cc_uint32 milliseconds) { usleep(milliseconds * 1000); }
+
+static void* ExecThread(void* param) {
+	((Thread_StartFunc)param)();
+	return NULL;
+}
+
+void Thread_Run(void** handle, Thread_StartFunc func, int stackSize, const char* name) {
+	pthread_t* ptr = (pthread_t*)Mem_Alloc(1, sizeof(pthread_t), "thread");
+	pthread_attr_t attrs;
+	int res;
+	*handle = ptr;
+
+	pthread_attr_init(&attrs);
+	pthread_attr_setstacksize(&attrs, stackSize);
+
+	res = pthread_create(ptr, &attrs, ExecThread, (void*)func);
+	if (res) Logger_Abort2(res, "Creating thread");
+	pthread_attr_destroy(&attrs);
+}
+
+void Thread_Detach(void* handle) {
+	pthread_t* ptr = (pthread_t*)handle;
+	int res = pthread_detach(*ptr);
+	if (res) Logger_Abort2(res, "Detaching thread");
+	Mem_Free(ptr);
+}
+
+void Thread_Join(void* handle) {
+	pthread_t* ptr = (pthread_t*)handle;
+	int res = pthread_join(*ptr, NULL);
+	if (res) Logger_Abort2(res, "Joining thread");
+	Mem_Free(ptr);
+}
+
+void* Mutex_Create(const char* name) {
+	pthread_mutex_t* ptr = (pthread_mutex_t*)Mem_Alloc(1, sizeof(pthread_mutex_t), "mutex");
+	int res = pthread_mutex_init(ptr, NULL);
+	if (res) Logger_Abort2(res, "Creating mutex");
+	return ptr;
+}
+
+void Mutex_Free(void* handle) {
+	int res = pthread_mutex_destroy((pthread_mutex_t*)handle);
+	if (res) Logger_Abort2(res, "Destroying mutex");
+	Mem_Free(handle);
+}
+
+void Mutex_Lock(void* handle) {
+	int res = pthread_mutex_lock((pthread_mutex_t*)handle);
+	if (res) Logger_Abort2(res, "Locking mutex");
+}
+
+void Mutex_Unlock(void* handle) {
+	int res = pthread_mutex_unlock((pthread_mutex_t*)handle);
+	if (res) Logger_Abort2(res, "Unlocking mutex");
+}
+
+struct WaitData {
+	pthread_cond_t  cond;
+	pthread_mutex_t mutex;
+	int signalled; /* For when Waitable_Signal is called before Waitable_Wait */
+};
+
+void* Waitable_Create(const char* name) {
+	struct WaitData* ptr = (struct WaitData*)Mem_Alloc(1, sizeof(struct WaitData), "waitable");
+	int res;
+
+	res = pthread_cond_init(&ptr->cond, NULL);
+	if (res) Logger_Abort2(res, "Creating waitable");
+	res = pthread_mutex_init(&ptr->mutex, NULL);
+	if (res) Logger_Abort2(res, "Creating waitable mutex");
+
+	ptr->signalled = false;
+	return ptr;
+}
+
+void Waitable_Free(void* handle) {
+	struct WaitData* ptr = (struct WaitData*)handle;
+	int res;
+
+	res = pthread_cond_destroy(&ptr->cond);
+	if (res) Logger_Abort2(res, "Destroying waitable");
+	res = pthread_mutex_destroy(&ptr->mutex);
+	if (res) Logger_Abort2(res, "Destroying waitable mutex");
+	Mem_Free(handle);
+}
+
+void Waitable_Signal(void* handle) {
+	struct WaitData* ptr = (struct WaitData*)handle;
+	int res;
+
+	Mutex_Lock(&ptr->mutex);
+	ptr->signalled = true;
+	Mutex_Unlock(&ptr->mutex);
+
+	res = pthread_cond_signal(&ptr->cond);
+	if (res) Logger_Abort2(res, "Signalling event");
+}
+
+void Waitable_Wait(void* handle) {
+	struct WaitData* ptr = (struct WaitData*)handle;
+	int res;
+
+	Mutex_Lock(&ptr->mutex);
+	if (!ptr->signalled) {
+		res = pthread_cond_wait(&ptr->cond, &ptr->mutex);
+		if (res) Logger_Abort2(res, "Waitable wait");
+	}
+	ptr->signalled = false;
+	Mutex_Unlock(&ptr->mutex);
+}
+
+void Waitable_WaitFor(void* handle, cc_uint32 milliseconds) {
+	struct WaitData* ptr = (struct WaitData*)handle;
+	struct timeval tv;
+	struct timespec ts;
+	int res;
+	gettimeofday(&tv, NULL);
+
+	/* absolute time for some silly reason */
+	ts.tv_sec  = tv.tv_sec + milliseconds / 1000;
+	ts.tv_nsec = 1000 * (tv.tv_usec + 1000 * (milliseconds % 1000));
+
+	/* statement above might exceed max nsec, so adjust for that */
+	while (ts.tv_nsec >= NS_PER_SEC) {
+		ts.tv_sec++;
+		ts.tv_nsec -= NS_PER_SEC;
+	}
+
+	Mutex_Lock(&ptr->mutex);
+	if (!ptr->signalled) {
+		res = pthread_cond_timedwait(&ptr->cond, &ptr->mutex, &ts);
+		if (res && res != ETIMEDOUT) Logger_Abort2(res, "Waitable wait for");
+	}
+	ptr->signalled = false;
+	Mutex_Unlock(&ptr->mutex);
+}
+#else
 /* No real threading support with emscripten backend */
 void  Thread_Sleep(cc_uint32 milliseconds) { }
 
@@ -240,6 +389,7 @@ void  Waitable_Free(void* handle) { }
 void  Waitable_Signal(void* handle) { }
 void  Waitable_Wait(void* handle) { }
 void  Waitable_WaitFor(void* handle, cc_uint32 milliseconds) { }
+#endif
 
 
 /*########################################################################################################################*
@@ -320,6 +320,51 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 	return *len != INVALID_FILE_SIZE ? 0 : GetLastError();
 }
 
+cc_result File_Map(const cc_filepath* path, void** data, cc_uint32* len) {
+	HANDLE mapping;
+	cc_file file;
+	cc_result res;
+	if ((res = File_Open(&file, path))) return res;
+
+	res = File_Length(file, len);
+	/* CreateFileMapping always fails for zero length */
+	if (!res && !*len) res = ERR_INVALID_ARGUMENT;
+	if (res) { CloseHandle(file); return res; }
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) { res = GetLastError(); CloseHandle(file); return res; }
+
+	*data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	res   = *data ? 0 : GetLastError();
+
+	/* View remains valid even after the handles are closed */
+	CloseHandle(mapping);
+	CloseHandle(file);
+	return res;
+}
+
+cc_result File_Unmap(void* data, cc_uint32 len) {
+	return UnmapViewOfFile(data) ? 0 : GetLastError();
+}
+
+cc_result File_Rename(const cc_filepath* src, const cc_filepath* dst) {
+	cc_result res;
+	if (MoveFileExW(src->uni, dst->uni, MOVEFILE_REPLACE_EXISTING)) return 0;
+	if ((res = GetLastError()) != ERROR_CALL_NOT_IMPLEMENTED) return res;
+
+	/* Windows 9x does not support MoveFileEx, and MoveFile fails if destination exists */
+	DeleteFileA(dst->ansi);
+	return MoveFileA(src->ansi, dst->ansi) ? 0 : GetLastError();
+}
+
+cc_result File_Delete(const cc_filepath* path) {
+	cc_result res;
+	if (DeleteFileW(path->uni)) return 0;
+	if ((res = GetLastError()) != ERROR_CALL_NOT_IMPLEMENTED) return res;
+
+	return DeleteFileA(path->ansi) ? 0 : GetLastError();
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------------Threading--------------------------------------------------------*
@@ -33,11 +33,15 @@
 #include "InputHandler.h"
 #include "HeldBlockRenderer.h"
 #include "Options.h"
+#include "BlockPhysics.h"
 
 struct _ProtocolData Protocol;
 
 /* Classic state */
 static cc_bool classic_receivedFirstPos;
+/* Last position packet sent to the server (0 length if none sent yet) */
+static cc_uint8 classic_lastPos[32];
+static int classic_lastPosLen, classic_posSkipped;
 
 /* Map state */
 static cc_bool map_begunLoading;
@@ -94,6 +98,7 @@ static struct CpeExt
 	lightingMode_Ext    = { "LightingMode", 1 },
 	cinematicGui_Ext   = { "CinematicGui", 1 },
 	extTextures_Ext     = { "ExtendedTextures", 1 },
+	chunkedMap_Ext      = { "ChunkedMap", 1 },
 	extBlocks_Ext       = { "ExtendedBlocks", 1 };
 
 static struct CpeExt* cpe_clientExtensions[] = {
@@ -103,6 +108,7 @@ static struct CpeExt* cpe_clientExtensions[] = {
 	&blockDefsExt_Ext, &bulkBlockUpdate_Ext, &textColors_Ext, &envMapAspect_Ext, &entityProperty_Ext, &extEntityPos_Ext,
 	&twoWayPing_Ext, &invOrder_Ext, &instantMOTD_Ext, &fastMap_Ext, &setHotbar_Ext, &setSpawnpoint_Ext, &velControl_Ext,
 	&customParticles_Ext, &pluginMessages_Ext, &extTeleport_Ext, &lightingMode_Ext, &cinematicGui_Ext,
+	&chunkedMap_Ext,
 #ifdef CUSTOM_MODELS
 	&customModels_Ext,
 #endif
@@ -352,6 +358,19 @@ struct MapState {
 	cc_uint8 size[MAP_SIZE_LEN];
 	int index, sizeIndex;
 	cc_bool allocFailed;
+#ifdef CC_BUILD_MAPWORKERS
+	/* Compressed data received from the server, which the worker has not decompressed yet */
+	cc_uint8* queued;
+	cc_uint32 queuedOffset, queuedLength, queuedCapacity;
+	/* Stream the worker decompresses from, which waits for more data to be queued */
+	struct Stream source;
+	void* mutex;
+	void* waitable;
+	void* thread;
+	/* Whether no more data will be queued */
+	cc_bool finished;
+	volatile cc_result result;
+#endif
 };
 static struct MapState map1;
 #ifdef EXTENDED_BLOCKS
@@ -367,8 +386,49 @@ static void DisconnectInvalidMap(cc_result res) {
 	Game_Disconnect(&title, &tmp); return;
 }
 
+#ifdef CC_BUILD_MAPWORKERS
+static cc_result MapSource_Read(struct Stream* s, cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	struct MapState* m = (struct MapState*)s->meta.inflate;
+	Mutex_Lock(m->mutex);
+
+	while (m->queuedOffset == m->queuedLength && !m->finished) {
+		Mutex_Unlock(m->mutex);
+		Waitable_Wait(m->waitable);
+		Mutex_Lock(m->mutex);
+	}
+
+	count = min(count, m->queuedLength - m->queuedOffset);
+	Mem_Copy(data, m->queued + m->queuedOffset, count);
+	m->queuedOffset += count;
+
+	Mutex_Unlock(m->mutex);
+	*modified = count;
+	return 0;
+}
+
+static void MapState_InitWorker(struct MapState* m) {
+	if (!m->mutex)    m->mutex    = Mutex_Create("Map data queue");
+	if (!m->waitable) m->waitable = Waitable_Create("Map data queue");
+
+	Stream_Init(&m->source);
+	m->source.Read         = MapSource_Read;
+	/* NOTE: Reusing the inflate field to point to the owning map state */
+	m->source.meta.inflate = m;
+
+	m->queuedOffset = 0;
+	m->queuedLength = 0;
+	m->finished     = false;
+	m->result       = 0;
+}
+#endif
+
 static void MapState_Init(struct MapState* m) {
+#ifdef CC_BUILD_MAPWORKERS
+	MapState_InitWorker(m);
+	Inflate_MakeStream2(&m->stream, &m->inflateState, &m->source);
+#else
 	Inflate_MakeStream2(&m->stream, &m->inflateState, &map_part);
+#endif
 	GZipHeader_Init(&m->gzHeader);
 
 	m->index       = 0;
@@ -382,7 +442,17 @@ static CC_INLINE void MapState_SkipHeader(struct MapState* m) {
 	m->sizeIndex     = MAP_SIZE_LEN;
 }
 
+#ifdef CC_BUILD_MAPWORKERS
+static void MapState_FinishWorker(struct MapState* m);
+#endif
+
 static void FreeMapStates(void) {
+#ifdef CC_BUILD_MAPWORKERS
+	MapState_FinishWorker(&map1);
+	#ifdef EXTENDED_BLOCKS
+	MapState_FinishWorker(&map2);
+	#endif
+#endif
 	Mem_Free(map1.blocks);
 	map1.blocks = NULL;
 #ifdef EXTENDED_BLOCKS
@@ -413,10 +483,14 @@ static cc_result MapState_Read(struct MapState* m) {
 		m->blocks = (BlockRaw*)Mem_TryAlloc(map_volume, 1);
 		/* unlikely but possible */
 		if (!m->blocks) {
+#ifndef CC_BUILD_MAPWORKERS
+			/* NOTE: Map workers can't show dialogs, Classic_LevelFinalise shows a chat message instead */
 			Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
+#endif
 			m->allocFailed = true;
 			return 0;
 		}
+		Inflate_SetOutputBuffer(&m->inflateState, m->blocks, map_volume);
 	}
 
 	left = map_volume - m->index;
@@ -426,6 +500,305 @@ static cc_result MapState_Read(struct MapState* m) {
 	return res;
 }
 
+#ifdef CC_BUILD_MAPWORKERS
+static void MapWorker_Run(struct MapState* m) {
+	cc_result res = 0;
+	int prevRead;
+
+	if (!m->gzHeader.done) {
+		res = GZipHeader_Read(&m->source, &m->gzHeader);
+		/* Source stream only runs out of data once all of the map has been received */
+		if (res == ERR_END_OF_STREAM) return;
+	}
+
+	while (!res && !m->allocFailed) {
+		prevRead = m->sizeIndex + m->index;
+		res      = MapState_Read(m);
+		if (m->sizeIndex + m->index == prevRead) break;
+	}
+	m->result = res;
+}
+
+static void MapWorker_Run1(void) { MapWorker_Run(&map1); }
+#ifdef EXTENDED_BLOCKS
+static void MapWorker_Run2(void) { MapWorker_Run(&map2); }
+#endif
+
+/* Adds compressed data to be decompressed by the map state's worker thread */
+static void MapState_Queue(struct MapState* m, const cc_uint8* data, cc_uint32 length) {
+	cc_uint32 left;
+	Mutex_Lock(m->mutex);
+	{
+		/* Move not yet decompressed data back to start of the queue once most of it has been */
+		if (m->queuedOffset > m->queuedCapacity / 2) {
+			left = m->queuedLength - m->queuedOffset;
+			Mem_Move(m->queued, m->queued + m->queuedOffset, left);
+			m->queuedOffset = 0;
+			m->queuedLength = left;
+		}
+
+		if (m->queuedLength + length > m->queuedCapacity) {
+			m->queuedCapacity = max(m->queuedCapacity * 2, 16384);
+			m->queuedCapacity = max(m->queuedCapacity, m->queuedLength + length);
+			m->queued = (cc_uint8*)Mem_Realloc(m->queued, m->queuedCapacity, 1, "map data queue");
+		}
+
+		Mem_Copy(m->queued + m->queuedLength, data, length);
+		m->queuedLength += length;
+	}
+	Mutex_Unlock(m->mutex);
+	Waitable_Signal(m->waitable);
+
+	if (m->thread) return;
+#ifdef EXTENDED_BLOCKS
+	Thread_Run(&m->thread, m == &map1 ? MapWorker_Run1 : MapWorker_Run2, 64 * 1024, "Map decompress");
+#else
+	Thread_Run(&m->thread, MapWorker_Run1, 64 * 1024, "Map decompress");
+#endif
+}
+
+/* Waits for the map state's worker thread to decompress all the data queued so far */
+static void MapState_FinishWorker(struct MapState* m) {
+	if (!m->thread) return;
+
+	Mutex_Lock(m->mutex);
+	{
+		m->finished = true;
+	}
+	Mutex_Unlock(m->mutex);
+	Waitable_Signal(m->waitable);
+
+	Thread_Join(m->thread);
+	m->thread = NULL;
+
+	Mem_Free(m->queued);
+	m->queued         = NULL;
+	m->queuedCapacity = 0;
+}
+#endif
+
+
+/*########################################################################################################################*
+*------------------------------------------------------Chunked map--------------------------------------------------------*
+*#########################################################################################################################*/
+/* With the ChunkedMap extension, the server sends the map as separately compressed sections, */
+/*  so that the map can be shown once the sections around the spawn point have been received */
+/* Bits in the flags field of the ChunkedMapBegin packet */
+#define CHUNKED_FLAG_UPPER 0x01 /* Sections also include the upper 8 bits of each block */
+/* Bits in the flags field of the ChunkedMapData packet */
+#define CHUNKED_FLAG_LAST  0x01 /* Last part of the compressed data of this section */
+/* Largest compressed size allowed for a section (anything larger is treated as corrupted) */
+#define CHUNKED_MAX_COMPRESSED (64 * 1024)
+/* Sections within this distance of the spawn point's section must be received before the map is shown */
+#define CHUNKED_SPAWN_RANGE 1
+
+static cc_bool chunked_active, chunked_shown, chunked_hasUpper, chunked_allocFailed;
+static int chunked_width, chunked_height, chunked_length;
+static int chunked_chunksX, chunked_chunksY, chunked_chunksZ;
+static int chunked_spawnX, chunked_spawnY, chunked_spawnZ, chunked_spawnLeft;
+static int chunked_receivedCount;
+/* Blocks of the map, until it is handed over to the world once shown */
+static BlockRaw* chunked_blocks;
+static BlockRaw* chunked_upper;
+/* Whether each section of the map has been received */
+static cc_uint8* chunked_received;
+/* Compressed data of the section currently being received */
+static cc_uint8* chunked_comp;
+static cc_uint32 chunked_compLength, chunked_compCapacity;
+static int chunked_curIndex;
+
+static void ChunkedMap_Free(void) {
+	if (!chunked_shown) {
+		Mem_Free(chunked_blocks);
+		Mem_Free(chunked_upper);
+	}
+	chunked_blocks = NULL;
+	chunked_upper  = NULL;
+
+	Mem_Free(chunked_received);
+	Mem_Free(chunked_comp);
+	chunked_received = NULL;
+	chunked_comp     = NULL;
+
+	chunked_compLength   = 0;
+	chunked_compCapacity = 0;
+	chunked_active = false;
+	chunked_shown  = false;
+	chunked_allocFailed = false;
+}
+
+static cc_bool ChunkedMap_InSpawnRange(int cx, int cy, int cz) {
+	return Math_AbsI(cx - chunked_spawnX) <= CHUNKED_SPAWN_RANGE &&
+		   Math_AbsI(cy - chunked_spawnY) <= CHUNKED_SPAWN_RANGE && 
+		   Math_AbsI(cz - chunked_spawnZ) <= CHUNKED_SPAWN_RANGE;
+}
+
+static void ChunkedMap_Init(int width, int height, int length, int spawnX, int spawnY, int spawnZ, cc_bool upper) {
+	int volume = width * height * length;
+	int cx, cy, cz;
+	ChunkedMap_Free();
+
+	chunked_active   = true;
+	chunked_hasUpper = upper;
+	chunked_width  = width;  chunked_chunksX = (width  + CHUNK_MAX) >> CHUNK_SHIFT;
+	chunked_height = height; chunked_chunksY = (height + CHUNK_MAX) >> CHUNK_SHIFT;
+	chunked_length = length; chunked_chunksZ = (length + CHUNK_MAX) >> CHUNK_SHIFT;
+	chunked_receivedCount = 0;
+	chunked_curIndex      = -1;
+
+	Math_Clamp(spawnX, 0, width  - 1);
+	Math_Clamp(spawnY, 0, height - 1);
+	Math_Clamp(spawnZ, 0, length - 1);
+	chunked_spawnX = spawnX >> CHUNK_SHIFT;
+	chunked_spawnY = spawnY >> CHUNK_SHIFT;
+	chunked_spawnZ = spawnZ >> CHUNK_SHIFT;
+	chunked_spawnLeft = 0;
+
+	for (cy = 0; cy < chunked_chunksY; cy++) {
+		for (cz = 0; cz < chunked_chunksZ; cz++) {
+			for (cx = 0; cx < chunked_chunksX; cx++)
+			{
+				if (ChunkedMap_InSpawnRange(cx, cy, cz)) chunked_spawnLeft++;
+			}
+		}
+	}
+
+	/* Sections that haven't been received yet are left as air */
+	chunked_blocks   = (BlockRaw*)Mem_TryAllocCleared(volume, 1);
+	chunked_received = (cc_uint8*)Mem_TryAllocCleared(chunked_chunksX * chunked_chunksY * chunked_chunksZ, 1);
+#ifdef EXTENDED_BLOCKS
+	if (upper) chunked_upper = (BlockRaw*)Mem_TryAllocCleared(volume, 1);
+	if (upper && !chunked_upper) chunked_allocFailed = true;
+#endif
+	if (!chunked_blocks || !chunked_received) chunked_allocFailed = true;
+	if (!chunked_allocFailed) return;
+
+	/* Level finalise packet shows a chat message then */
+	ChunkedMap_Free();
+	chunked_active      = true;
+	chunked_allocFailed = true;
+}
+
+/* Hands over the blocks received so far to the world, so that the player can start playing */
+static void ChunkedMap_Show(void) {
+	int cx, cy, cz, index = 0;
+	chunked_shown = true;
+
+#ifdef EXTENDED_BLOCKS
+	if (chunked_upper) World_SetMapUpper(chunked_upper);
+#endif
+	World_SetNewMap(chunked_blocks, chunked_width, chunked_height, chunked_length);
+	/* Remaining sections just act as air if there isn't enough memory to track them */
+	if (!World_MarkSectionsPending()) return;
+
+	for (cy = 0; cy < chunked_chunksY; cy++) {
+		for (cz = 0; cz < chunked_chunksZ; cz++) {
+			for (cx = 0; cx < chunked_chunksX; cx++, index++)
+			{
+				if (chunked_received[index]) World_MarkSectionReceived(cx, cy, cz);
+			}
+		}
+	}
+}
+
+/* Copies the decompressed blocks of a section into the map */
+static void ChunkedMap_Import(int cx, int cy, int cz, const cc_uint8* src, int volume) {
+	int x1 = cx << CHUNK_SHIFT, x2 = min(x1 + CHUNK_SIZE, chunked_width);
+	int y1 = cy << CHUNK_SHIFT, y2 = min(y1 + CHUNK_SIZE, chunked_height);
+	int z1 = cz << CHUNK_SHIFT, z2 = min(z1 + CHUNK_SIZE, chunked_length);
+	const cc_uint8* upper = src + volume;
+	int x, y, z, index;
+	BlockID block;
+
+	if (chunked_shown) {
+		/* Blocks can't be written directly into the world, since it may store upper blocks in pages */
+		Physics_FinishTick();
+
+		for (y = y1; y < y2; y++) {
+			for (z = z1; z < z2; z++) {
+				for (x = x1; x < x2; x++, src++)
+				{
+					block = *src;
+					if (chunked_hasUpper) block |= (*upper++) << 8;
+					World_SetBlock(x, y, z, block & World.IDMask);
+				}
+			}
+		}
+
+		World_MarkSectionReceived(cx, cy, cz);
+		Game_RefreshBlocks(x1, y1, z1, x2 - 1, y2 - 1, z2 - 1);
+		return;
+	}
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			index = (y * chunked_length + z) * chunked_width + x1;
+			Mem_Copy(chunked_blocks + index, src, x2 - x1);
+			src += x2 - x1;
+
+			if (!chunked_upper) continue;
+			Mem_Copy(chunked_upper + index, upper, x2 - x1);
+			upper += x2 - x1;
+		}
+	}
+}
+
+/* Decompresses the section whose compressed data has been completely received */
+static cc_result ChunkedMap_Receive(int cx, int cy, int cz) {
+	static cc_uint8 raw[CHUNK_SIZE_3 * 2];
+	struct Stream src, stream;
+	int volume, index;
+	cc_result res;
+
+	volume = (min(chunked_width  - (cx << CHUNK_SHIFT), CHUNK_SIZE)) *
+			 (min(chunked_height - (cy << CHUNK_SHIFT), CHUNK_SIZE)) *
+			 (min(chunked_length - (cz << CHUNK_SHIFT), CHUNK_SIZE));
+
+	/* NOTE: map1's inflate state is otherwise unused, since the map isn't sent as a single stream */
+	Stream_ReadonlyMemory(&src, chunked_comp, chunked_compLength);
+	Inflate_MakeStream2(&stream, &map1.inflateState, &src);
+	Inflate_SetOutputBuffer(&map1.inflateState, raw, volume * (chunked_hasUpper ? 2 : 1));
+
+	res = Stream_Read(&stream, raw, volume * (chunked_hasUpper ? 2 : 1));
+	chunked_compLength = 0;
+	chunked_curIndex   = -1;
+	if (res) return res;
+
+	ChunkedMap_Import(cx, cy, cz, raw, volume);
+	index = (cy * chunked_chunksZ + cz) * chunked_chunksX + cx;
+	if (chunked_received[index]) return 0;
+
+	chunked_received[index] = true;
+	chunked_receivedCount++;
+	if (ChunkedMap_InSpawnRange(cx, cy, cz)) chunked_spawnLeft--;
+	if (chunked_shown) return 0;
+
+	Event_RaiseFloat(&WorldEvents.Loading, 
+		(float)chunked_receivedCount / (chunked_chunksX * chunked_chunksY * chunked_chunksZ));
+	if (!chunked_spawnLeft) ChunkedMap_Show();
+	return 0;
+}
+
+/* Called once the server has sent all sections of the map */
+static void ChunkedMap_Finish(int width, int height, int length) {
+	if (chunked_allocFailed) {
+		Chat_AddRaw("&cFailed to load map, try joining a different map");
+		Chat_AddRaw("   &cNot enough free memory to load the map");
+		ChunkedMap_Free();
+		World_SetNewMap(NULL, 0, 0, 0);
+		return;
+	}
+
+	if (width != chunked_width || height != chunked_height || length != chunked_length) {
+		Chat_AddRaw("&cMap dimensions sent at the end of the map do not match those at the start");
+	}
+	if (!chunked_shown) ChunkedMap_Show();
+
+	/* Any sections the server didn't send just stay as air */
+	World_ClearPendingSections();
+	ChunkedMap_Free();
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Classic protocol-----------------------------------------------------*
@@ -531,7 +904,13 @@ static void Classic_StartLoading(void) {
 	LoadingScreen_Show(&Server.Name, &Server.MOTD);
 	WoM_CheckMotd();
 	classic_receivedFirstPos = false;
+	classic_lastPosLen       = 0;
 
+#ifdef CC_BUILD_MAPWORKERS
+	/* in case server is buggy and never finished sending previous map */
+	FreeMapStates();
+#endif
+	ChunkedMap_Free();
 	map_begunLoading = true;
 	map_receiveBeg   = Stopwatch_Measure();
 	map_volume       = 0;
@@ -583,6 +962,12 @@ static void Classic_LevelDataChunk(cc_uint8* data) {
 	}
 #endif
 
+#ifdef CC_BUILD_MAPWORKERS
+	/* Worker stops decompressing once any invalid data is encountered */
+	res = m->result;
+	if (res) { DisconnectInvalidMap(res); return; }
+	MapState_Queue(m, data + 2, usedLength);
+#else
 	if (!m->gzHeader.done) {
 		res = GZipHeader_Read(&map_part, &m->gzHeader);
 		if (res && res != ERR_END_OF_STREAM) { DisconnectInvalidMap(res); return; }
@@ -592,6 +977,7 @@ static void Classic_LevelDataChunk(cc_uint8* data) {
 		res = MapState_Read(m);
 		if (res) { DisconnectInvalidMap(res); return; }
 	}
+#endif
 
 	progress = !map_volume ? 0.0f : (float)map1.index / map_volume;
 	Event_RaiseFloat(&WorldEvents.Loading, progress);
@@ -601,6 +987,17 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 	int width, height, length, volume;
 	cc_uint64 end;
 	int delta;
+#ifdef CC_BUILD_MAPWORKERS
+	cc_result res;
+
+	MapState_FinishWorker(&map1);
+	res = map1.result;
+	#ifdef EXTENDED_BLOCKS
+	MapState_FinishWorker(&map2);
+	if (!res) res = map2.result;
+	#endif
+	if (res) { FreeMapStates(); DisconnectInvalidMap(res); return; }
+#endif
 
 	end   = Stopwatch_Measure();
 	delta = Stopwatch_ElapsedMS(map_receiveBeg, end);
@@ -616,6 +1013,7 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 	height = Stream_GetU16_BE(data + 2);
 	length = Stream_GetU16_BE(data + 4);
 	volume = width * height * length;
+	if (chunked_active) { ChunkedMap_Finish(width, height, length); return; }
 
 	if (map1.allocFailed) {
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
@@ -797,6 +1195,7 @@ static void Classic_Reset(void) {
 	Stream_ReadonlyMemory(&map_part, NULL, 0);
 	map_begunLoading = false;
 	classic_receivedFirstPos = false;
+	classic_lastPosLen       = 0;
 
 	Net_Set(OPCODE_HANDSHAKE, Classic_Handshake, Classic_HandshakeSize());
 	Net_Set(OPCODE_PING, Classic_Ping, 1);
@@ -817,13 +1216,33 @@ static void Classic_Reset(void) {
 	Net_Set(OPCODE_SET_PERMISSION, Classic_SetPermission, 2);
 }
 
+/* Position is still resent at least this often (in position ticks) when unchanged, */
+/*  in case the server uses position packets to detect whether the client is still alive */
+#define CLASSIC_MAX_SKIPPED_POS 20
+
 static cc_uint8* Classic_Tick(cc_uint8* data) {
 	struct Entity* e = &Entities.CurPlayer->Base;
+	cc_uint8* end;
+	int len;
 	if (!classic_receivedFirstPos) return data;
 
 	/* Report end position of each physics tick, rather than current position */
 	/*  (otherwise can miss landing on a block then jumping off of it again) */
-	return Classic_WritePosition(data, e->next.pos, e->Yaw, e->Pitch);
+	end = Classic_WritePosition(data, e->next.pos, e->Yaw, e->Pitch);
+	len = (int)(end - data);
+
+	/* NOTE: The protocol has no relative movement packets from client to server, */
+	/*  so the only way to reduce bandwidth is to not send an unchanged position */
+	if (len == classic_lastPosLen && Mem_Equal(data, classic_lastPos, len)
+			&& classic_posSkipped < CLASSIC_MAX_SKIPPED_POS) {
+		classic_posSkipped++;
+		return data;
+	}
+
+	Mem_Copy(classic_lastPos, data, len);
+	classic_lastPosLen = len;
+	classic_posSkipped = 0;
+	return end;
 }
 
 
@@ -1278,6 +1697,7 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 		data += BULK_MAX_BLOCKS / 4;
 	}
 
+	Lighting.BeginBatch();
 	for (i = 0; i < count; i++) {
 		index = indices[i];
 		if (index < 0 || index >= World.Volume) continue;
@@ -1289,6 +1709,7 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 		Game_UpdateBlock(x, y, z, blocks[i]);
 #endif
 	}
+	Lighting.EndBatch();
 }
 
 static void CPE_SetTextColor(cc_uint8* data) {
@@ -1572,6 +1993,56 @@ static void CPE_CinematicGui(cc_uint8* data) {
 	Gui.BarSize = (float)barSize / UInt16_MaxValue;
 }
 
+static void CPE_ChunkedMapBegin(cc_uint8* data) {
+	int width, height, length;
+	/* In case the server didn't send LevelInit beforehand */
+	if (!map_begunLoading) Classic_StartLoading();
+
+	width  = Stream_GetU16_BE(data + 0);
+	height = Stream_GetU16_BE(data + 2);
+	length = Stream_GetU16_BE(data + 4);
+	if (!width || !height || !length) { DisconnectInvalidMap(CHUNKED_ERR_SECTION); return; }
+
+	ChunkedMap_Init(width, height, length, Stream_GetU16_BE(data + 6), Stream_GetU16_BE(data + 8), 
+					Stream_GetU16_BE(data + 10), data[12] & CHUNKED_FLAG_UPPER);
+}
+
+static void CPE_ChunkedMapData(cc_uint8* data) {
+	int cx, cy, cz, index, length;
+	cc_uint32 required;
+	cc_result res;
+	if (!chunked_active || chunked_allocFailed) return;
+
+	cx     = Stream_GetU16_BE(data + 0);
+	cy     = Stream_GetU16_BE(data + 2);
+	cz     = Stream_GetU16_BE(data + 4);
+	length = Stream_GetU16_BE(data + 7);
+	index  = (cy * chunked_chunksZ + cz) * chunked_chunksX + cx;
+	required = chunked_compLength + length;
+
+	if (cx >= chunked_chunksX || cy >= chunked_chunksY || cz >= chunked_chunksZ || length > 1024 
+		|| required > CHUNKED_MAX_COMPRESSED) {
+		DisconnectInvalidMap(CHUNKED_ERR_SECTION); return;
+	}
+	/* All the parts of a section must be sent before any parts of the next section */
+	if (chunked_curIndex != -1 && chunked_curIndex != index) {
+		DisconnectInvalidMap(CHUNKED_ERR_SECTION); return;
+	}
+	chunked_curIndex = index;
+
+	if (required > chunked_compCapacity) {
+		chunked_compCapacity = max(chunked_compCapacity * 2, 4096);
+		chunked_compCapacity = max(chunked_compCapacity, required);
+		chunked_comp = (cc_uint8*)Mem_Realloc(chunked_comp, chunked_compCapacity, 1, "map section data");
+	}
+	Mem_Copy(chunked_comp + chunked_compLength, data + 9, length);
+	chunked_compLength = required;
+
+	if (!(data[6] & CHUNKED_FLAG_LAST)) return;
+	res = ChunkedMap_Receive(cx, cy, cz);
+	if (res) DisconnectInvalidMap(res);
+}
+
 static void CPE_Reset(void) {
 	cpe_serverExtensionsCount = 0; cpe_pingTicks = 0;
 	CPEExtensions_Reset();
@@ -1616,6 +2087,8 @@ static void CPE_Reset(void) {
 	Net_Set(OPCODE_ENTITY_TELEPORT_EXT, CPE_ExtEntityTeleport, 11);
 	Net_Set(OPCODE_LIGHTING_MODE, CPE_LightingMode, 3);
 	Net_Set(OPCODE_CINEMATIC_GUI, CPE_CinematicGui, 10);
+	Net_Set(OPCODE_CHUNKED_MAP_BEGIN, CPE_ChunkedMapBegin, 14);
+	Net_Set(OPCODE_CHUNKED_MAP_DATA,  CPE_ChunkedMapData,  1034);
 }
 
 static cc_uint8* CPE_Tick(cc_uint8* data) {
@@ -1932,6 +2405,7 @@ static void OnReset(void) {
 	Mem_Set(&Protocol, 0, sizeof(Protocol));
 	Protocol_Reset();
 	FreeMapStates();
+	ChunkedMap_Free();
 }
 #else
 void CPE_SendPlayerClick(int button, cc_bool pressed, cc_uint8 targetId, struct RayTracer* t) { }
@@ -40,6 +40,7 @@ enum OPCODE_ {
 	OPCODE_DEFINE_MODEL, OPCODE_DEFINE_MODEL_PART, OPCODE_UNDEFINE_MODEL,
 	OPCODE_PLUGIN_MESSAGE, OPCODE_ENTITY_TELEPORT_EXT,
 	OPCODE_LIGHTING_MODE, OPCODE_CINEMATIC_GUI,
+	OPCODE_CHUNKED_MAP_BEGIN, OPCODE_CHUNKED_MAP_DATA,
 
 	OPCODE_COUNT
 };
@@ -62,18 +62,27 @@ static cc_result ZipEntry_ExtractData(struct ResourceZipEntry* e, struct Stream*
 *------------------------------------------------------Utility functions -------------------------------------------------*
 *#########################################################################################################################*/
 static void ZipFile_InspectEntries(const cc_string* path, Zip_SelectEntry selector) {
-	struct ZipEntry entries[64];
+	struct ZipArchive archive;
 	struct Stream stream;
+	cc_string name;
 	cc_result res;
+	int i;
 
 	res = Stream_OpenFile(&stream, path);
 	if (res == ReturnCode_FileNotFound) return;
 	if (res) { Logger_SysWarn2(res, "opening", path); return; }
 
-	res = Zip_Extract(&stream, selector, NULL, 
-						entries, Array_Elems(entries));
+	/* Only need the names of entries, which are all in the central directory */
+	res = ZipArchive_Open(&archive, &stream);
 	if (res) Logger_SysWarn2(res, "inspecting", path);
 
+	for (i = 0; !res && i < ZipArchive_Count(&archive); i++) 
+	{
+		name = ZipArchive_GetPath(&archive, i);
+		selector(&name);
+	}
+	ZipArchive_Close(&archive);
+
 	/* No point logging error for closing readonly file */
 	(void)stream.Close(&stream);
 }
@@ -517,6 +526,7 @@ static struct SoundAsset {
 	const char* hash;
 	int reqID, size;
 	void* data;
+	struct SoundAsset* source; /* Earlier sound with the same hash, data is copied from it */
 } soundAssets[] = {
 	{ "dig_cloth1.wav",  "5fd568d724ba7d53911b6cccf5636f859d2662e8" }, { "dig_cloth2.wav",  "56c1d0ac0de2265018b2c41cb571cc6631101484" },
 	{ "dig_cloth3.wav",  "9c63f2a3681832dc32d206f6830360bfe94b5bfc" }, { "dig_cloth4.wav",  "55da1856e77cfd31a7e8c3d358e1f856c5583198" },
@@ -632,12 +642,29 @@ static void SoundAsset_CreateZip(void) {
 *#########################################################################################################################*/
 #define SoundAsset_Download(hash) MusicAsset_Download(hash)
 
+/* Returns an earlier sound that has the same hash as the given sound */
+static struct SoundAsset* SoundAsset_FindSource(int i) {
+	cc_string hash = String_FromReadonly(soundAssets[i].hash);
+	int j;
+
+	for (j = 0; j < i; j++)
+	{
+		if (String_CaselessEqualsConst(&hash, soundAssets[j].hash)) return &soundAssets[j];
+	}
+	return NULL;
+}
+
 static void SoundAssets_DownloadAssets(void) {
+	struct SoundAsset* source;
 	int i;
 	for (i = 0; i < Array_Elems(soundAssets); i++)
 	{
 		if (allSoundsExist) continue;
-		soundAssets[i].reqID = SoundAsset_Download(soundAssets[i].hash);
+		/* Step sounds are the same files as dig sounds, so don't download them twice */
+		source = SoundAsset_FindSource(i);
+		soundAssets[i].source = source;
+
+		soundAssets[i].reqID = source ? 0 : SoundAsset_Download(soundAssets[i].hash);
 	}
 }
 
@@ -650,25 +677,38 @@ static const char* SoundAssets_GetRequestName(int reqID) {
 	return NULL;
 }
 
-static void SoundAsset_Check(struct SoundAsset* sound, int i) {
+static void SoundAsset_CopySource(struct SoundAsset* sound) {
+	struct SoundAsset* source = sound->source;
+	if (!source->data) return;
+
+	sound->data = Mem_Alloc(source->size, 1, "sound asset");
+	sound->size = source->size;
+	Mem_Copy(sound->data, source->data, source->size);
+	Fetcher_Downloaded++;
+}
+
+static void SoundAsset_Check(struct SoundAsset* sound) {
 	struct HttpRequest item;
+	if (sound->data) return;
+	if (sound->source) { SoundAsset_CopySource(sound); return; }
 	if (!Fetcher_Get(sound->reqID, &item)) return;
 
 	sound->data = item.data;
 	sound->size = item.size;
 	item.data   = NULL;
 	HttpRequest_Free(&item);
-
-	if (i == Array_Elems(soundAssets) - 1)
-		SoundAsset_CreateZip();
 }
 
 static void SoundAssets_CheckStatus(void) {
-	int i;
+	int i, count = 0;
 	for (i = 0; i < Array_Elems(soundAssets); i++)
 	{
-		SoundAsset_Check(&soundAssets[i], i);
+		SoundAsset_Check(&soundAssets[i]);
+		if (soundAssets[i].data) count++;
 	}
+
+	/* Downloads may complete in any order when multiple run at once */
+	if (count == Array_Elems(soundAssets)) SoundAsset_CreateZip();
 }
 
 static const struct AssetSet mccSoundAssetSet = {
@@ -14,6 +14,7 @@
 #include "Platform.h"
 #include "String.h"
 #include "Funcs.h"
+#define MEM_SUBSYSTEM MEM_SYS_HTTP
 
 /* https://gist.github.com/mmozeiko/c0dfcc8fec527a90a02145d2cc0bfb6d */
 /* https://web.archive.org/web/20210116110926/http://www.coastrd.com/c-schannel-smtp */
@@ -51,7 +52,8 @@ void SSLBackend_Init(cc_bool verifyCerts) {
 		DynamicLib_Sym(InitSecurityInterfaceA)
 	};
 	static const cc_string schannel = String_FromConst("schannel.dll");
-	_verifyCerts = verifyCerts;
+	_verifyCerts   = verifyCerts;
+	ssl_credsMutex = Mutex_Create("SSL credentials");
 	/* TODO: Load later?? it's unsafe to do on a background thread though */
 	DynamicLib_LoadAll(&schannel, funcs, Array_Elems(funcs), &schannel_lib);
 }
@@ -94,15 +96,31 @@ struct SSLContext {
 #define _SP_PROT_TLS1_1_CLIENT 0x00000200
 #define _SP_PROT_TLS1_2_CLIENT 0x00000800
 
+/* Schannel only resumes previous TLS sessions for connections using the same credentials handle, */
+/*  so a single credentials handle is shared between all connections instead of one per connection */
+static CredHandle ssl_creds;
+static cc_bool ssl_credsAcquired;
+static void* ssl_credsMutex;
+
 static SECURITY_STATUS SSL_CreateHandle(struct SSLContext* ctx) {
 	SCHANNEL_CRED cred = { 0 };
+	SECURITY_STATUS res = 0;
 	cred.dwVersion = SCHANNEL_CRED_VERSION;
 	cred.dwFlags   = SCH_CRED_NO_DEFAULT_CREDS | (_verifyCerts ? SCH_CRED_AUTO_CRED_VALIDATION : SCH_CRED_MANUAL_CRED_VALIDATION);
 	cred.grbitEnabledProtocols = SP_PROT_TLS1_CLIENT | _SP_PROT_TLS1_1_CLIENT | _SP_PROT_TLS1_2_CLIENT;
 
-	/* TODO: SCHANNEL_NAME_A ? */
-	return FP_AcquireCredentialsHandleA(NULL, UNISP_NAME_A, SECPKG_CRED_OUTBOUND, NULL,
-						&cred, NULL, NULL, &ctx->handle, NULL);
+	Mutex_Lock(ssl_credsMutex);
+	{
+		/* TODO: SCHANNEL_NAME_A ? */
+		if (!ssl_credsAcquired) {
+			res = FP_AcquireCredentialsHandleA(NULL, UNISP_NAME_A, SECPKG_CRED_OUTBOUND, NULL,
+								&cred, NULL, NULL, &ssl_creds, NULL);
+			ssl_credsAcquired = res == 0;
+		}
+		ctx->handle = ssl_creds;
+	}
+	Mutex_Unlock(ssl_credsMutex);
+	return res;
 }
 
 static cc_result SSL_RecvRaw(struct SSLContext* ctx) {
@@ -400,12 +418,14 @@ cc_result SSL_Free(void* ctx_) {
 	/* TODO send TLS close */
 	struct SSLContext* ctx = (struct SSLContext*)ctx_;
 	FP_DeleteSecurityContext(&ctx->context);
-	FP_FreeCredentialsHandle(&ctx->handle);
+	/* NOTE: Credentials handle is shared, so isn't freed here */
 	Mem_Free(ctx);
 	return 0; 
 }
 #elif CC_SSL_BACKEND == CC_SSL_BACKEND_BEARSSL
 #include "String.h"
+#include "Platform.h"
+#include "Constants.h"
 #include "bearssl.h"
 #include "../misc/certs/certs.h"
 // https://github.com/unkaktus/bearssl/blob/master/samples/client_basic.c#L283
@@ -425,13 +445,76 @@ typedef struct SSLContext {
 	br_sslio_context ioc;
 	cc_result readError, writeError;
 	cc_socket socket;
+	char host[STRING_SIZE];
+	cc_bool sessionSaved;
 } SSLContext;
 
 static cc_bool _verifyCerts;
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Session cache------------------------------------------------------*
+*#########################################################################################################################*/
+/* Sessions are cached per host, so that later connections to the same host can */
+/*  resume the previous session instead of performing the expensive full handshake */
+#define SSL_CACHED_SESSIONS 8
+static struct SSLCachedSession {
+	char host[STRING_SIZE];
+	br_ssl_session_parameters params;
+} ssl_sessions[SSL_CACHED_SESSIONS];
+static int ssl_nextSession;
+static void* ssl_sessionsMutex;
+
+static int SSLSessions_Find(const cc_string* host) {
+	cc_string name;
+	int i;
+
+	for (i = 0; i < SSL_CACHED_SESSIONS; i++)
+	{
+		name = String_FromRawArray(ssl_sessions[i].host);
+		if (name.length && String_CaselessEquals(&name, host)) return i;
+	}
+	return -1;
+}
+
+/* Returns whether there is a previous session for the given host */
+static cc_bool SSLSessions_Get(const cc_string* host, br_ssl_session_parameters* params) {
+	int i;
+	Mutex_Lock(ssl_sessionsMutex);
+	{
+		i = SSLSessions_Find(host);
+		if (i >= 0) *params = ssl_sessions[i].params;
+	}
+	Mutex_Unlock(ssl_sessionsMutex);
+	return i >= 0;
+}
+
+static void SSLSessions_Set(const cc_string* host, const br_ssl_session_parameters* params) {
+	int i;
+	/* Server doesn't support session resumption */
+	if (!params->session_id_len) return;
+
+	Mutex_Lock(ssl_sessionsMutex);
+	{
+		i = SSLSessions_Find(host);
+		/* Replace the oldest cached session */
+		if (i < 0) {
+			i = ssl_nextSession;
+			ssl_nextSession = (i + 1) % SSL_CACHED_SESSIONS;
+			String_CopyToRawArray(ssl_sessions[i].host, host);
+		}
+		ssl_sessions[i].params = *params;
+	}
+	Mutex_Unlock(ssl_sessionsMutex);
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------BearSSL backend-----------------------------------------------------*
+*#########################################################################################################################*/
 void SSLBackend_Init(cc_bool verifyCerts) {
 	_verifyCerts = verifyCerts; // TODO support
+	ssl_sessionsMutex = Mutex_Create("SSL sessions");
 }
 
 cc_bool SSLBackend_DescribeError(cc_result res, cc_string* dst) {
@@ -501,6 +584,8 @@ static int sock_write(void* ctx_, const unsigned char* buf, size_t len) {
 }
 
 cc_result SSL_Init(cc_socket socket, const cc_string* host_, void** out_ctx) {
+	br_ssl_session_parameters session;
+	cc_bool resume;
 	SSLContext* ctx;
 	char host[NATIVE_STR_LEN];
 	String_EncodeUtf8(host, host_);
@@ -515,7 +600,14 @@ cc_result SSL_Init(cc_socket socket, const cc_string* host_, void** out_ctx) {
 	ctx->socket = socket;
 
 	br_ssl_engine_set_buffer(&ctx->sc.eng, ctx->iobuf, sizeof(ctx->iobuf), 1);
-	br_ssl_client_reset(&ctx->sc, host, 0);
+
+	/* Hosts too long to be cached are never resumed */
+	ctx->sessionSaved = host_->length >= STRING_SIZE;
+	String_CopyToRawArray(ctx->host, host_);
+
+	resume = !ctx->sessionSaved && SSLSessions_Get(host_, &session);
+	if (resume) br_ssl_engine_set_session_parameters(&ctx->sc.eng, &session);
+	br_ssl_client_reset(&ctx->sc, host, resume);
 	
 	/* Account login must be done over TLS 1.2 */
 	if (String_CaselessEqualsConst(host_, "www.classicube.net")) {
@@ -542,6 +634,8 @@ cc_result SSL_Init(cc_socket socket, const cc_string* host_, void** out_ctx) {
 
 cc_result SSL_Read(void* ctx_, cc_uint8* data, cc_uint32 count, cc_uint32* read) { 
 	SSLContext* ctx = (SSLContext*)ctx_;
+	br_ssl_session_parameters session;
+	cc_string host;
 	// TODO: just br_sslio_write ??
 	int res = br_sslio_read(&ctx->ioc, data, count);
 	int err;
@@ -556,6 +650,14 @@ cc_result SSL_Read(void* ctx_, cc_uint8* data, cc_uint32 count, cc_uint32* read)
 		return SSL_ERROR_SHIFT + err;
 	}
 	
+	/* Handshake must have completed by the time data is read */
+	if (!ctx->sessionSaved) {
+		host = String_FromRawArray(ctx->host);
+		br_ssl_engine_get_session_parameters(&ctx->sc.eng, &session);
+		SSLSessions_Set(&host, &session);
+		ctx->sessionSaved = true;
+	}
+
 	br_sslio_flush(&ctx->ioc);
 	*read = res;
 	return 0;
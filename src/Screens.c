@@ -23,6 +23,8 @@
 #include "Utils.h"
 #include "Options.h"
 #include "InputHandler.h"
+#include "MapRenderer.h"
+#define MEM_SUBSYSTEM MEM_SYS_UI
 
 #define CHAT_MAX_STATUS Array_Elems(Chat_Status)
 #define CHAT_MAX_BOTTOMRIGHT Array_Elems(Chat_BottomRight)
@@ -69,31 +71,57 @@ CC_NOINLINE static cc_bool IsOnlyChatActive(void) {
 static struct HUDScreen {
 	Screen_Body
 	struct FontDesc font;
-	struct TextWidget line1, line2;
+	struct TextWidget line1, line2, profile;
 	struct TextAtlas posAtlas;
+	struct GlyphAtlas glyphs;
 	float accumulator;
-	int frames, posCount;
+	int frames, posCount, line1Count;
+	cc_string line1Text; char _line1Buffer[STRING_SIZE * 2];
 	cc_bool hacksChanged;
 	float lastSpeed;
 	int lastFov;
 	int lastX, lastY, lastZ;
 	struct HotbarWidget hotbar;
+	GfxResourceID graphVb;
 } HUDScreen_Instance;
 
 /* Each integer can be at most 10 digits + minus prefix */
 #define POSITION_VAL_CHARS 11
 /* [PREFIX] [(] [X] [,] [Y] [,] [Z] [)] */
 #define POSITION_HUD_CHARS (1 + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1)
-#define HUD_MAX_VERTICES (4 + TEXTWIDGET_MAX * 2 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4)
+#define LINE1_HUD_CHARS (STRING_SIZE * 2)
+#define HUD_MAX_VERTICES (4 + TEXTWIDGET_MAX * 3 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4 + LINE1_HUD_CHARS * 4)
+/* Profile line is after crosshair, line1, line2, hotbar and position */
+#define HUD_PROFILE_OFFSET (12 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4)
+/* Glyphs of line1 are after the profile line */
+#define HUD_LINE1_OFFSET (HUD_PROFILE_OFFSET + TEXTWIDGET_MAX)
+
+/* Whether line1 is drawn using the glyph atlas instead of its own texture */
+#define HUDScreen_Line1UsesGlyphs(s) ((s)->glyphs.tex.ID != 0)
+
+/* Sets the text of line1, which is updated every second */
+static void HUDScreen_SetLine1(struct HUDScreen* s, const cc_string* text) {
+	struct DrawTextArgs args;
+	if (!HUDScreen_Line1UsesGlyphs(s)) {
+		TextWidget_Set(&s->line1, text, &s->font); return;
+	}
+
+	/* Changing the text only requires rebuilding the mesh */
+	String_Copy(&s->line1Text, text);
+	DrawTextArgs_Make(&args, text, &s->font, true);
+	s->line1.width  = Drawer2D_TextWidth(&args);
+	s->line1.height = Drawer2D_TextHeight(&args);
+	Widget_Layout(&s->line1);
+}
 
 static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 	cc_string status; char statusBuffer[STRING_SIZE * 2];
-	int indices, ping, fps;
+	int indices, ping, fps, kbytes;
 	float real_fps;
 
 	String_InitArray(status, statusBuffer);
 	/* Don't remake texture when FPS isn't being shown */
-	if (!Gui.ShowFPS && s->line1.tex.ID) return;
+	if (!Gui.ShowFPS && (s->line1.tex.ID || s->line1Text.length)) return;
 	fps = s->accumulator == 0 ? 1 : (int)(s->frames / s->accumulator);
 
 	if (Gfx.ReducedPerfMode || (Gfx.ReducedPerfModeCooldown > 0)) {
@@ -113,14 +141,38 @@ static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 		if (Game.ChunkUpdates) {
 			String_Format1(&status, "%i chunks/s, ", &Game.ChunkUpdates);
 		}
+		if (Game.ChunkSortTime) {
+			String_Format1(&status, "sort %i us, ", &Game.ChunkSortTime);
+		}
+		if (Game.ChunkRefreshesSkipped) {
+			String_Format1(&status, "%i skipped, ", &Game.ChunkRefreshesSkipped);
+		}
+		if (Game.TickTime) {
+			String_Format1(&status, "ticks %i us, ", &Game.TickTime);
+		}
+		if (Game.TicksDropped) {
+			String_Format1(&status, "%i ticks dropped, ", &Game.TicksDropped);
+		}
+
+		if (Game.EntitiesCulled) {
+			String_Format1(&status, "%i entities culled, ", &Game.EntitiesCulled);
+		}
 
 		indices = ICOUNT(Game_Vertices);
-		String_Format1(&status, "%i vertices", &indices);
+		String_Format2(&status, "%i vertices, %i 2D draws", &indices, &Gui.Draw2DCalls);
 
 		ping = Ping_AveragePingMS();
 		if (ping) String_Format1(&status, ", ping %i ms", &ping);
+
+		if (NetStats.TotalBytes) {
+			kbytes = NetStats.TotalBytes / 1024;
+			String_Format2(&status, ", %i packets/s (%i KB/s)", &NetStats.TotalPackets, &kbytes);
+		}
+		if (NetStats.SendQueued) {
+			String_Format1(&status, ", %i bytes queued", &NetStats.SendQueued);
+		}
 	}
-	TextWidget_Set(&s->line1, &status, &s->font);
+	HUDScreen_SetLine1(s, &status);
 	s->dirty = true;
 }
 
@@ -189,15 +241,144 @@ static void HUDScreen_RemakeLine2(struct HUDScreen* s) {
 }
 
 
+/* Colour code of each stage, in both the profile line and the frame time graph */
+static const char profile_colors[PROFILE_COUNT] = { 'b', 'c', 'd', 'a', '3', '9', 'e', '2', '5', '6', '4', '8', '1' };
+/* Time in frames not spent in any of the measured stages */
+#define PROFILE_OTHER_COLOR '7'
+
+#ifdef CC_BUILD_MEMTRACK
+static void HUDScreen_AppendMemory(cc_string* status) {
+	struct MemUsage usage[MEM_SYS_COUNT + 1];
+	int live, peak;
+	Mem_GetUsage(usage);
+
+	live = usage[MEM_SYS_COUNT].live / 1024;
+	peak = usage[MEM_SYS_COUNT].peak / 1024;
+	String_Format2(status, ", mem %i/%i KB", &live, &peak);
+}
+#endif
+
+static void HUDScreen_AppendMeshMemory(cc_string* status) {
+	int used   = MapRenderer_MeshBytes  / 1024;
+	int budget = MapRenderer_MeshBudget / 1024;
+
+	if (budget) {
+		String_Format2(status, ", meshes %i/%i KB", &used, &budget);
+	} else {
+		String_Format1(status, ", meshes %i KB", &used);
+	}
+}
+
+static void HUDScreen_RemakeProfile(struct HUDScreen* s) {
+	cc_string status; char statusBuffer[STRING_SIZE * 6];
+	int i;
+	String_InitArray(status, statusBuffer);
+
+	for (i = 0; i < PROFILE_COUNT; i++)
+	{
+		String_Format3(&status, "&%r%c %i", &profile_colors[i], Profile_Names[i], &Game_ProfileCpuTimes[i]);
+		if (Game_ProfileGpuTimes[i] >= 0) {
+			String_Format1(&status, "/%i", &Game_ProfileGpuTimes[i]);
+		}
+		String_AppendConst(&status, ", ");
+	}
+
+	String_Append(&status, '&');
+	String_Append(&status, PROFILE_OTHER_COLOR);
+	String_AppendConst(&status, "other&f us (cpu/gpu)");
+	HUDScreen_AppendMeshMemory(&status);
+#ifdef CC_BUILD_MEMTRACK
+	HUDScreen_AppendMemory(&status);
+#endif
+	TextWidget_Set(&s->profile, &status, &s->font);
+	s->dirty = true;
+}
+
+/* Background, 60 FPS line, then one quad per stage (and other) for each frame */
+#define PROFILE_GRAPH_MAX_QUADS (2 + PROFILE_HISTORY_SIZE * (PROFILE_COUNT + 1))
+/* Frame time in microseconds at the top of the graph (longer frames are clipped) */
+#define PROFILE_GRAPH_MAX_TIME 50000
+
+static int HUDScreen_AddGraphQuad(struct VertexColoured* v, int quads, int x, int y, int width, int height, PackedCol color) {
+	if (!v) return quads + 1;
+	v += quads * 4;
+
+	v->x = (float)x;           v->y = (float)y;            v->z = 0; v->Col = color; v++;
+	v->x = (float)(x + width); v->y = (float)y;            v->z = 0; v->Col = color; v++;
+	v->x = (float)(x + width); v->y = (float)(y + height); v->z = 0; v->Col = color; v++;
+	v->x = (float)x;           v->y = (float)(y + height); v->z = 0; v->Col = color; v++;
+	return quads + 1;
+}
+
+/* Builds a stacked bar graph of the frames in the profile history, with the most recent frame on the right */
+/* NOTE: If v is NULL, only counts the number of quads that would be built */
+static int HUDScreen_BuildGraph(struct HUDScreen* s, struct VertexColoured* v) {
+	const struct ProfileSample* sample;
+	int x = s->profile.x, y = s->profile.y + s->profile.height;
+	int width  = min(PROFILE_HISTORY_SIZE, Window_Main.Width - x);
+	int height = Display_ScaleY(100);
+	int i, j, time, top, bottom, quads = 0;
+	PackedCol color;
+
+	quads = HUDScreen_AddGraphQuad(v, quads, x, y, width, height, PackedCol_Make(0, 0, 0, 127));
+	top   = y + height - 16667 * height / PROFILE_GRAPH_MAX_TIME;
+	quads = HUDScreen_AddGraphQuad(v, quads, x, top, width, 1, PackedCol_Make(255, 255, 255, 127));
+
+	for (i = 0; i < width; i++)
+	{
+		sample = Game_GetProfileSample(i);
+		if (!sample) break;
+		bottom = y + height;
+		time   = 0;
+
+		for (j = 0; j <= PROFILE_COUNT; j++)
+		{
+			/* Stack using the total so far, so that rounding doesn't accumulate */
+			time  = j < PROFILE_COUNT ? time + sample->times[j] : max(time, sample->frameTime);
+			top   = y + height - min(time, PROFILE_GRAPH_MAX_TIME) * height / PROFILE_GRAPH_MAX_TIME;
+			if (top >= bottom) continue;
+
+			color  = Drawer2D_GetColor(j < PROFILE_COUNT ? profile_colors[j] : PROFILE_OTHER_COLOR);
+			quads  = HUDScreen_AddGraphQuad(v, quads, x + width - 1 - i, top, 1, bottom - top, color);
+			bottom = top;
+		}
+	}
+	return quads;
+}
+
+static void HUDScreen_RenderGraph(struct HUDScreen* s) {
+	struct VertexColoured* data;
+	int count;
+
+	if (!s->graphVb) {
+		s->graphVb = Gfx_CreateDynamicVb(VERTEX_FORMAT_COLOURED, PROFILE_GRAPH_MAX_QUADS * 4);
+		if (!s->graphVb) return;
+	}
+	count = HUDScreen_BuildGraph(s, NULL) * 4;
+
+	data = (struct VertexColoured*)Gfx_LockDynamicVb(s->graphVb, VERTEX_FORMAT_COLOURED, count);
+	HUDScreen_BuildGraph(s, data);
+	Gfx_UnlockDynamicVb(s->graphVb);
+
+	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
+	Gfx_BindDynamicVb(s->graphVb);
+	Gfx_DrawVb_IndexedTris(count);
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+}
+
+
 static void HUDScreen_ContextLost(void* screen) {
 	struct HUDScreen* s = (struct HUDScreen*)screen;
 	Font_Free(&s->font);
 	Screen_ContextLost(screen);
 
 	TextAtlas_Free(&s->posAtlas);
+	GlyphAtlas_Free(&s->glyphs);
 	Elem_Free(&s->hotbar);
 	Elem_Free(&s->line1);
 	Elem_Free(&s->line2);
+	Elem_Free(&s->profile);
+	Gfx_DeleteDynamicVb(&s->graphVb);
 }
 
 static void HUDScreen_ContextRecreated(void* screen) {	
@@ -211,9 +392,13 @@ static void HUDScreen_ContextRecreated(void* screen) {
 	Font_SetPadding(&s->font, 2);
 	HotbarWidget_SetFont(&s->hotbar, &s->font);
 
+	/* Can't draw parts of a texture without UV support */
+	if (!Gfx.NoUVSupport) GlyphAtlas_Make(&s->glyphs, &s->font);
+	s->line1Text.length = 0;
 	HUDScreen_RemakeLine1(s);
 	TextAtlas_Make(&s->posAtlas, &chars, &s->font, &prefix);
 	HUDScreen_RemakeLine2(s);
+	if (Game_Profiling) HUDScreen_RemakeProfile(s);
 }
 
 int HUDScreen_LayoutHotbar(void) {
@@ -248,6 +433,11 @@ static void HUDScreen_Layout(void* screen) {
 
 	HUDScreen_LayoutHotbar();
 	Widget_Layout(line2);
+
+	Widget_SetLocation(&s->profile, ANCHOR_MIN, ANCHOR_MIN, 
+						2 + DisplayInfo.ContentOffsetX, 0);
+	s->profile.yOffset = max(line1->y + line1->height, line2->y + line2->height);
+	Widget_Layout(&s->profile);
 }
 
 static int HUDScreen_KeyDown(void* screen, int key, struct InputDevice* device) {
@@ -303,13 +493,16 @@ static void HUDScreen_NeedRedrawing(void* obj) {
 static void HUDScreen_Init(void* screen) {
 	struct HUDScreen* s = (struct HUDScreen*)screen;
 	s->maxVertices      = HUD_MAX_VERTICES;
+	String_InitArray(s->line1Text, s->_line1Buffer);
 
 	HotbarWidget_Create(&s->hotbar);
 	TextWidget_Init(&s->line1);
 	TextWidget_Init(&s->line2);
+	TextWidget_Init(&s->profile);
 	
-	s->line1.flags  |= WIDGET_FLAG_MAINSCREEN;
-	s->line2.flags  |= WIDGET_FLAG_MAINSCREEN;
+	s->line1.flags   |= WIDGET_FLAG_MAINSCREEN;
+	s->line2.flags   |= WIDGET_FLAG_MAINSCREEN;
+	s->profile.flags |= WIDGET_FLAG_MAINSCREEN;
 
 	Event_Register_(&UserEvents.HacksStateChanged, s, HUDScreen_HacksChanged);
 	Event_Register_(&TextureEvents.AtlasChanged,   s, HUDScreen_NeedRedrawing);
@@ -328,9 +521,14 @@ static void HUDScreen_UpdateFPS(struct HUDScreen* s, float delta) {
 	if (s->accumulator < 1.0f) return;
 
 	HUDScreen_RemakeLine1(s);
-	s->accumulator    = 0.0f;
-	s->frames         = 0;
-	Game.ChunkUpdates = 0;
+	if (Game_Profiling) HUDScreen_RemakeProfile(s);
+	s->accumulator     = 0.0f;
+	s->frames          = 0;
+	Game.ChunkUpdates  = 0;
+	Game.ChunkSortTime = 0;
+	Game.ChunkRefreshesSkipped = 0;
+	Game.TickTime      = 0;
+	Game.TicksDropped  = 0;
 }
 
 static void HUDScreen_Update(void* screen, float delta) {
@@ -381,6 +579,11 @@ static void HUDScreen_BuildMesh(void* screen) {
 
 	if (!Game_ClassicMode) 
 		HUDScreen_BuildPosition(s, data);
+
+	data += POSITION_HUD_CHARS * 4;
+	Widget_BuildMesh(&s->profile, ptr);
+
+	s->line1Count = GlyphAtlas_Add(&s->glyphs, &s->line1Text, s->line1.x, s->line1.y, ptr);
 	Gfx_UnlockDynamicVb(s->vb);
 }
 
@@ -392,27 +595,31 @@ static void HUDScreen_Render(void* screen, float delta) {
 
 	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
 	Gfx_BindDynamicVb(s->vb);
-	if (Gui.ShowFPS) Widget_Render2(&s->line1, 4);
+	if (Gui.ShowFPS && HUDScreen_Line1UsesGlyphs(s)) {
+		Gfx_Draw2DRange(s->glyphs.tex.ID, s->line1Count * 4, HUD_LINE1_OFFSET);
+	} else if (Gui.ShowFPS) {
+		Widget_Render2(&s->line1, 4);
+	}
 
 	if (Game_ClassicMode) {
 		Widget_Render2(&s->line2, 8);
 	} else if (IsOnlyChatActive() && Gui.ShowFPS) {
 		Widget_Render2(&s->line2, 8);
-		Gfx_BindTexture(s->posAtlas.tex.ID);
-		Gfx_DrawVb_IndexedTris_Range(s->posCount, 12 + HOTBAR_MAX_VERTICES);
+		Gfx_Draw2DRange(s->posAtlas.tex.ID, s->posCount, 12 + HOTBAR_MAX_VERTICES);
 		/* TODO swap these two lines back */
 	}
+	if (Game_Profiling && s->profile.tex.ID) Widget_Render2(&s->profile, HUD_PROFILE_OFFSET);
 
 	if (!Gui_GetBlocksWorld()) {
 		Gfx_BindDynamicVb(s->vb);
 		if (!Gui.HideHotbar) Widget_Render2(&s->hotbar, 12);
 
 		if (!Gui.HideCrosshair && Gui.IconsTex && !tablist_active) {
-			Gfx_BindTexture(Gui.IconsTex);
 			Gfx_BindDynamicVb(s->vb); /* Have to rebind for mobile right now... */
-			Gfx_DrawVb_IndexedTris(4);
+			Gfx_Draw2DRange(Gui.IconsTex, 4, 0);
 		}
 	}
+	if (Game_Profiling) HUDScreen_RenderGraph(s);
 
 	Gfx_3DS_SetRenderScreen(BOTTOM_SCREEN);
 }
@@ -701,37 +908,121 @@ static void TabListOverlay_SortAndLayout(struct TabListOverlay* s) {
 	s->dirty = true;
 }
 
+/* Large servers frequently add/update/remove entries, so rather than resorting */
+/*  and redrawing group names for every change, entries are moved in place */
+static void TabListOverlay_InsertAt(struct TabListOverlay* s, int index, int id, struct Texture* tex) {
+	int i;
+	for (i = s->usedCount; i > index; i--)
+	{
+		s->ids[i]      = s->ids[i - 1];
+		s->textures[i] = s->textures[i - 1];
+	}
+
+	s->ids[index]      = id;
+	s->textures[index] = *tex;
+	s->usedCount++;
+}
+
+/* Returns index of first entry between begin and end that the given player sorts before */
+static int TabListOverlay_FindPosition(struct TabListOverlay* s, int id, int begin, int end) {
+	int mid;
+	while (begin < end) {
+		mid = (begin + end) / 2;
+
+		if (TabListOverlay_PlayerCompare(id, s->ids[mid]) < 0) {
+			end = mid;
+		} else {
+			begin = mid + 1;
+		}
+	}
+	return begin;
+}
+
+/* Returns index of the group name after the group starting at the given index */
+static int TabListOverlay_NextGroup(struct TabListOverlay* s, int i) {
+	for (i++; i < s->usedCount && s->ids[i] != GROUP_NAME_ID; i++) { }
+	return i;
+}
+
+static void TabListOverlay_InsertName(struct TabListOverlay* s, EntityID id) {
+	cc_string name, group, curGroup;
+	struct Texture tex, groupTex;
+	int i, end;
+
+	name = TabList_UNSAFE_GetList(id);
+	TabListOverlay_DrawText(&tex, s, &name);
+
+	if (s->classic) {
+		i = TabListOverlay_FindPosition(s, id, 0, s->usedCount);
+		TabListOverlay_InsertAt(s, i, id, &tex); return;
+	}
+	group = TabList_UNSAFE_GetGroup(id);
+
+	/* NOTE: Every group name is always followed by at least one player */
+	for (i = 0; i < s->usedCount; i = end)
+	{
+		end      = TabListOverlay_NextGroup(s, i);
+		curGroup = TabList_UNSAFE_GetGroup(s->ids[i + 1]);
+
+		if (String_CaselessEquals(&group, &curGroup)) {
+			i = TabListOverlay_FindPosition(s, id, i + 1, end);
+			TabListOverlay_InsertAt(s, i, id, &tex); return;
+		}
+		if (TabListOverlay_GroupCompare(id, s->ids[i + 1]) < 0) break;
+	}
+
+	/* First player in this group, so need to add the group name too */
+	TabListOverlay_DrawText(&groupTex, s, &group);
+	TabListOverlay_InsertAt(s, i,     GROUP_NAME_ID, &groupTex);
+	TabListOverlay_InsertAt(s, i + 1, id,            &tex);
+}
+
+static void TabListOverlay_RemoveAt(struct TabListOverlay* s, int i) {
+	TabListOverlay_DeleteAt(s, i);
+	if (s->classic) return;
+
+	/* Also remove the group name when this was the last player in the group */
+	if (s->ids[i - 1] == GROUP_NAME_ID && (i == s->usedCount || s->ids[i] == GROUP_NAME_ID)) {
+		TabListOverlay_DeleteAt(s, i - 1);
+	}
+}
+
+static int TabListOverlay_IndexOf(struct TabListOverlay* s, int id) {
+	int i;
+	for (i = 0; i < s->usedCount; i++)
+	{
+		if (s->ids[i] == id) return i;
+	}
+	return -1;
+}
+
 static void TabListOverlay_Add(void* obj, int id) {
 	struct TabListOverlay* s = (struct TabListOverlay*)obj;
-	TabListOverlay_AddName(s, id, -1);
-	TabListOverlay_SortAndLayout(s);
+	TabListOverlay_InsertName(s, id);
+	TabListOverlay_Layout(s);
+	s->dirty = true;
 }
 
 static void TabListOverlay_Update(void* obj, int id) {
 	struct TabListOverlay* s = (struct TabListOverlay*)obj;
-	int i;
-	for (i = 0; i < s->usedCount; i++)
-	{
-		if (s->ids[i] != id) continue;
-		Gfx_DeleteTexture(&s->textures[i].ID);
+	int i = TabListOverlay_IndexOf(s, id);
+	if (i == -1) return;
 
-		TabListOverlay_AddName(s, id, i);
-		TabListOverlay_SortAndLayout(s);
-		return;
-	}
+	/* Rank or group may have changed too, so entry might need to be moved elsewhere */
+	TabListOverlay_RemoveAt(s, i);
+	TabListOverlay_InsertName(s, id);
+	TabListOverlay_Layout(s);
+	s->dirty = true;
 }
 
 static void TabListOverlay_Remove(void* obj, int id) {
 	struct TabListOverlay* s = (struct TabListOverlay*)obj;
-	int i;
-	for (i = 0; i < s->usedCount; i++)
-	{
-		if (s->ids[i] != id) continue;
+	int i = TabListOverlay_IndexOf(s, id);
+	if (i == -1) return;
 
-		TabListOverlay_DeleteAt(s, i);
-		TabListOverlay_SortAndLayout(s);
-		return;
-	}
+	TabListOverlay_RemoveAt(s, i);
+	TabListOverlay_Layout(s);
+	s->dirty = true;
 }
 
 static int TabListOverlay_PointerDown(void* screen, int id, int x, int y) {
@@ -841,9 +1132,7 @@ static void TabListOverlay_Render(void* screen, float delta) {
 	for (i = 0; i < s->usedCount; i++)
 	{
 		if (!s->textures[i].ID) continue;
-		Gfx_BindTexture(s->textures[i].ID);
-
-		Gfx_DrawVb_IndexedTris_Range(4, offset);
+		Gfx_Draw2DRange(s->textures[i].ID, 4, offset);
 		offset += 4;
 	}
 
@@ -898,6 +1187,8 @@ static struct ChatScreen {
 	cc_bool suppressNextPress;
 	int chatIndex, paddingX, paddingY;
 	int lastDownloadStatus;
+	/* Number of chat lines received since chat textures were last updated */
+	int pendingChatLines;
 	struct FontDesc chatFont, announcementFont, bigAnnouncementFont, smallAnnouncementFont;
 	struct TextWidget announcement, bigAnnouncement, smallAnnouncement;
 	struct ChatInputWidget input;
@@ -982,8 +1273,23 @@ static cc_bool ChatScreen_ChatUpdateFont(struct ChatScreen* s) {
 	return true;
 }
 
-static void ChatScreen_Redraw(struct ChatScreen* s) {
+static void ChatScreen_RedrawChat(struct ChatScreen* s) {
+	s->pendingChatLines = 0;
 	TextGroupWidget_RedrawAll(&s->chat);
+}
+
+/* Servers may send hundreds of messages per second, so rather than redrawing */
+/*  chat for every message, lines that arrived this frame are laid out in one pass */
+static void ChatScreen_UpdatePendingChat(struct ChatScreen* s) {
+	int count = s->pendingChatLines;
+	if (!count) return;
+
+	s->pendingChatLines = 0;
+	TextGroupWidget_ShiftUpBy(&s->chat, count);
+}
+
+static void ChatScreen_Redraw(struct ChatScreen* s) {
+	ChatScreen_RedrawChat(s);
 	TextWidget_Set(&s->announcement, &Chat_Announcement, &s->announcementFont);
 	TextWidget_Set(&s->bigAnnouncement, &Chat_BigAnnouncement, &s->bigAnnouncementFont);
 	TextWidget_Set(&s->smallAnnouncement, &Chat_SmallAnnouncement, &s->smallAnnouncementFont);
@@ -1005,6 +1311,7 @@ static int ChatScreen_ClampChatIndex(int index) {
 static void ChatScreen_ScrollChatBy(struct ChatScreen* s, int delta) {
 	int newIndex = ChatScreen_ClampChatIndex(s->chatIndex + delta);
 	delta = newIndex - s->chatIndex;
+	ChatScreen_UpdatePendingChat(s);
 
 	while (delta) {
 		if (delta < 0) {
@@ -1037,7 +1344,7 @@ static void ChatScreen_EnterChatInput(struct ChatScreen* s, cc_bool close) {
 	defaultIndex = Chat_Log.count - Gui.Chatlines;
 	if (s->chatIndex != defaultIndex) {
 		s->chatIndex = defaultIndex;
-		TextGroupWidget_RedrawAll(&s->chat);
+		ChatScreen_RedrawChat(s);
 	}
 }
 
@@ -1085,7 +1392,8 @@ static void ChatScreen_ChatReceived(void* screen, const cc_string* msg, int type
 	if (type == MSG_TYPE_NORMAL) {
 		s->chatIndex++;
 		if (!Gui.Chatlines) return;
-		TextGroupWidget_ShiftUp(&s->chat);
+		/* Textures are updated in ChatScreen_Update */
+		s->pendingChatLines++;
 	} else if (type >= MSG_TYPE_STATUS_1 && type <= MSG_TYPE_STATUS_3) {
 		/* Status[0] is for texture pack downloading message */
 		/* Status[1] is for reduced performance mode message */
@@ -1113,6 +1421,7 @@ static void ChatScreen_ChatReceived(void* screen, const cc_string* msg, int type
 static void ChatScreen_Update(void* screen, float delta) {
 	struct ChatScreen* s = (struct ChatScreen*)screen;
 	double now = Game.Time;
+	ChatScreen_UpdatePendingChat(s);
 
 	/* Destroy announcement texture before even rendering it at all, */
 	/* otherwise changing texture pack shows announcement for one frame */
@@ -1171,8 +1480,7 @@ static void ChatScreen_DrawChat(struct ChatScreen* s, float delta) {
 			/* Only draw chat within last 10 seconds */
 			if (Chat_GetLogTime(logIdx) + 10 < now) continue;
 			
-			Gfx_BindTexture(tex.ID);
-			Gfx_DrawVb_IndexedTris_Range(4, i * 4);
+			Gfx_Draw2DRange(tex.ID, 4, i * 4);
 		}
 	}
 
@@ -1572,7 +1880,7 @@ void ChatScreen_SetChatlines(int lines) {
 	Elem_Free(&s->chat);
 	s->chatIndex += s->chat.lines - lines;
 	s->chat.lines = lines;
-	TextGroupWidget_RedrawAll(&s->chat);
+	ChatScreen_RedrawChat(s);
 
 	s->maxVertices = ChatScreen_CalcMaxVertices(s);
 	Screen_UpdateVb(s);
@@ -12,6 +12,7 @@ struct SelectionBox {
 	Vec3 p0, p1;
 	PackedCol color;
 	float minDist, maxDist;
+	cc_bool nearby; /* Whether box is close enough to camera to use a smaller offset */
 };
 
 #define X0 0
@@ -34,7 +35,7 @@ static void BuildFaces(struct SelectionBox* box, struct VertexColoured* v) {
 	PackedCol color;
 	int i, flags;
 
-	float offset = box->minDist < 32.0f * 32.0f ? (1/32.0f) : (1/16.0f);
+	float offset = box->nearby ? (1/32.0f) : (1/16.0f);
 	Vec3 coords[2];
 	Vec3_Add1(&coords[0], &box->p0, -offset);
 	Vec3_Add1(&coords[1], &box->p1,  offset);
@@ -58,7 +59,7 @@ static void BuildEdges(struct SelectionBox* box, struct VertexColoured* v) {
 	PackedCol color;
 	int i, flags;
 
-	float offset = box->minDist < 32.0f * 32.0f ? (1/32.0f) : (1/16.0f);
+	float offset = box->nearby ? (1/32.0f) : (1/16.0f);
 	Vec3 coords[2];
 	Vec3_Add1(&coords[0], &box->p0, -offset);
 	Vec3_Add1(&coords[1], &box->p1,  offset);
@@ -90,7 +91,9 @@ static int CompareDists(struct SelectionBox* a, struct SelectionBox* b) {
 	return 0;
 }
 
-static void CalcDists(struct SelectionBox* box, Vec3 P) {
+/* Returns whether the box's offset from its actual coordinates has changed */
+static cc_bool CalcDists(struct SelectionBox* box, Vec3 P) {
+	cc_bool wasNearby = box->nearby;
 	float dx0 = (P.x - box->p0.x) * (P.x - box->p0.x), dx1 = (P.x - box->p1.x) * (P.x - box->p1.x);
 	float dy0 = (P.y - box->p0.y) * (P.y - box->p0.y), dy1 = (P.y - box->p1.y) * (P.y - box->p1.y);
 	float dz0 = (P.z - box->p0.z) * (P.z - box->p0.z), dz1 = (P.z - box->p1.z) * (P.z - box->p1.z);
@@ -98,6 +101,9 @@ static void CalcDists(struct SelectionBox* box, Vec3 P) {
 	/* Distance to closest and furthest of the eight box corners */
 	box->minDist = min(dx0, dx1) + min(dy0, dy1) + min(dz0, dz1);
 	box->maxDist = max(dx0, dx1) + max(dy0, dy1) + max(dz0, dz1);
+
+	box->nearby  = box->minDist < 32.0f * 32.0f;
+	return box->nearby != wasNearby;
 }
 
 
@@ -109,6 +115,13 @@ static int selections_count;
 static struct SelectionBox selections_list[SELECTIONS_MAX];
 static cc_uint8 selections_ids[SELECTIONS_MAX];
 static GfxResourceID selections_VB, selections_LineVB;
+/* Whether each box (in sorted order) was inside the view frustum when the vertices were last built */
+static cc_uint8 selections_visible[SELECTIONS_MAX];
+/* Number of vertices in the faces/edges vertex buffers */
+static int selections_vertices;
+/* Whether the vertices need to be rebuilt, because the boxes or their order have changed */
+static cc_bool selections_dirty;
+static Vec3 selections_lastPos;
 
 void Selections_Add(cc_uint8 id, const IVec3* p1, const IVec3* p2, PackedCol color) {
 	struct SelectionBox sel;
@@ -120,6 +133,10 @@ void Selections_Add(cc_uint8 id, const IVec3* p1, const IVec3* p2, PackedCol col
 	selections_list[selections_count] = sel;
 	selections_ids[selections_count]  = id;
 	selections_count++;
+
+	/* Distances and sort order need to be recalculated for the new box */
+	selections_lastPos = Vec3_BigPos();
+	selections_dirty   = true;
 }
 
 void Selections_Remove(cc_uint8 id) {
@@ -133,6 +150,7 @@ void Selections_Remove(cc_uint8 id) {
 		}
 
 		selections_count--;
+		selections_dirty = true;
 		return;
 	}
 }
@@ -147,63 +165,126 @@ static void AllocateVertexBuffers(void) {
 	selections_LineVB = Gfx_CreateDynamicVb(VERTEX_FORMAT_COLOURED, SELECTIONS_MAX_VERTICES);
 }
 
-static void Selections_QuickSort(int left, int right) {
-	cc_uint8* values = selections_ids; cc_uint8 value;
-	struct SelectionBox* keys = selections_list; struct SelectionBox key;
-
-	while (left < right) {
-		int i = left, j = right;
-		struct SelectionBox* pivot = &keys[(i + j) >> 1];
-
-		/* partition the list */
-		while (i <= j) {
-			while (CompareDists(pivot, &keys[i]) > 0) i++;
-			while (CompareDists(pivot, &keys[j]) < 0) j--;
-			QuickSort_Swap_KV_Maybe();
+/* Sorts the boxes from furthest to nearest, returning whether the order of any boxes changed */
+/* NOTE: Insertion sort is used since the order usually changes very little between frames */
+static cc_bool Selections_InsertionSort(void) {
+	struct SelectionBox key;
+	cc_bool changed = false;
+	cc_uint8 id;
+	int i, j;
+
+	for (i = 1; i < selections_count; i++)
+	{
+		key = selections_list[i];
+		id  = selections_ids[i];
+
+		for (j = i - 1; j >= 0 && CompareDists(&selections_list[j], &key) > 0; j--)
+		{
+			selections_list[j + 1] = selections_list[j];
+			selections_ids[j + 1]  = selections_ids[j];
 		}
-		/* recurse into the smaller subset */
-		QuickSort_Recurse(Selections_QuickSort)
+		if (j + 1 == i) continue;
+
+		selections_list[j + 1] = key;
+		selections_ids[j + 1]  = id;
+		changed = true;
 	}
+	return changed;
 }
 
-void Selections_Render(void) {
-	struct VertexColoured* data;
-	Vec3 cameraPos;
-	int i, count;
-	if (!selections_count) return;
+/* Updates whether each box is inside the view frustum, returning whether that changed for any box */
+static cc_bool Selections_CalcVisible(void) {
+	static float bounds[6][SELECTIONS_MAX];
+	cc_uint8 visible[SELECTIONS_MAX];
+	struct FrustumBoxes boxes;
+	struct SelectionBox* box;
+	cc_bool changed = false;
+	int i;
 
-	/* TODO: Proper selection box sorting. But this is very difficult because
-	   we can have boxes within boxes, intersecting boxes, etc. Probably not worth it. */
-	cameraPos = Camera.CurrentPos;
-	for (i = 0; i < selections_count; i++) {
-		CalcDists(&selections_list[i], cameraPos);
+	boxes.minX = bounds[0]; boxes.minY = bounds[1]; boxes.minZ = bounds[2];
+	boxes.maxX = bounds[3]; boxes.maxY = bounds[4]; boxes.maxZ = bounds[5];
+
+	for (i = 0; i < selections_count; i++)
+	{
+		box = &selections_list[i];
+		bounds[0][i] = box->p0.x; bounds[1][i] = box->p0.y; bounds[2][i] = box->p0.z;
+		bounds[3][i] = box->p1.x; bounds[4][i] = box->p1.y; bounds[5][i] = box->p1.z;
 	}
-	Selections_QuickSort(0, selections_count - 1);
+	FrustumCulling_BoxesInFrustum(&boxes, selections_count, visible);
 
-	/* lazy init as most servers don't use this */
-	if (!selections_VB) AllocateVertexBuffers();
+	for (i = 0; i < selections_count; i++)
+	{
+		changed |= visible[i] != selections_visible[i];
+		selections_visible[i] = visible[i];
+	}
+	return changed;
+}
 
-	count = selections_count * SELECTIONS_VERTICES;
-	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
+static void Selections_Rebuild(void) {
+	struct VertexColoured* data;
+	int i, count = 0;
+
+	for (i = 0; i < selections_count; i++) 
+	{
+		if (selections_visible[i]) count += SELECTIONS_VERTICES;
+	}
+	selections_vertices = count;
+	if (!count) return;
 
 	data = (struct VertexColoured*)Gfx_LockDynamicVb(selections_LineVB, 
 										VERTEX_FORMAT_COLOURED, count);
-	for (i = 0; i < selections_count; i++, data += SELECTIONS_VERTICES) {
-		BuildEdges(&selections_list[i], data);
+	for (i = 0; i < selections_count; i++) {
+		if (!selections_visible[i]) continue;
+		BuildEdges(&selections_list[i], data); data += SELECTIONS_VERTICES;
 	}
 	Gfx_UnlockDynamicVb(selections_LineVB);
-	Gfx_DrawVb_Lines(count);
 
 	data = (struct VertexColoured*)Gfx_LockDynamicVb(selections_VB, 
 										VERTEX_FORMAT_COLOURED, count);
-	for (i = 0; i < selections_count; i++, data += SELECTIONS_VERTICES) {
-		BuildFaces(&selections_list[i], data);
+	for (i = 0; i < selections_count; i++) {
+		if (!selections_visible[i]) continue;
+		BuildFaces(&selections_list[i], data); data += SELECTIONS_VERTICES;
 	}
 	Gfx_UnlockDynamicVb(selections_VB);
+}
+
+void Selections_Render(void) {
+	Vec3 cameraPos;
+	int i;
+	if (!selections_count) return;
+
+	/* TODO: Proper selection box sorting. But this is very difficult because
+	   we can have boxes within boxes, intersecting boxes, etc. Probably not worth it. */
+	cameraPos = Camera.CurrentPos;
+	if (!Vec3_Equals(&cameraPos, &selections_lastPos)) {
+		for (i = 0; i < selections_count; i++) {
+			selections_dirty |= CalcDists(&selections_list[i], cameraPos);
+		}
+		selections_dirty  |= Selections_InsertionSort();
+		selections_lastPos = cameraPos;
+	}
+	/* NOTE: Visibility is always calculated, as the camera may have rotated */
+	selections_dirty |= Selections_CalcVisible();
+
+	/* lazy init as most servers don't use this */
+	if (!selections_VB) {
+		AllocateVertexBuffers();
+		selections_dirty = true;
+	}
+
+	/* Vertices are only rebuilt when the boxes or their order change */
+	if (selections_dirty) Selections_Rebuild();
+	selections_dirty = false;
+	if (!selections_vertices) return;
+
+	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
+	Gfx_BindDynamicVb(selections_LineVB);
+	Gfx_DrawVb_Lines(selections_vertices);
 
+	Gfx_BindDynamicVb(selections_VB);
 	Gfx_SetDepthWrite(false);
 	Gfx_SetAlphaBlending(true);
-	Gfx_DrawVb_IndexedTris(count);
+	Gfx_DrawVb_IndexedTris(selections_vertices);
 	Gfx_SetDepthWrite(true);
 	Gfx_SetAlphaBlending(false);
 }
@@ -74,12 +74,15 @@ int Ping_NextPingId(void) {
 	return next;
 }
 
+static void NetStats_AddPing(int ms);
 void Ping_Update(int id) {
 	int i;
 	for (i = 0; i < Array_Elems(ping_entries); i++) {
 		if (ping_entries[i].id != id) continue;
 
 		ping_entries[i].recv = Stopwatch_Measure();
+		/* Only want time to send data to server, see Ping_AveragePingMS */
+		NetStats_AddPing(Stopwatch_ElapsedMS(ping_entries[i].sent, ping_entries[i].recv) / 2);
 		return;
 	}
 }
@@ -110,6 +113,68 @@ static void Ping_Reset(void) {
 }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------NetStats---------------------------------------------------------*
+*#########################################################################################################################*/
+struct _NetStatsData NetStats;
+const int NetStats_PingBucketLimits[NETSTATS_PING_BUCKETS] = { 25, 50, 100, 150, 250, 500, 1000, Int32_MaxValue };
+
+static void NetStats_AddPing(int ms) {
+	int i;
+	for (i = 0; i < NETSTATS_PING_BUCKETS - 1; i++) 
+	{
+		if (ms < NetStats_PingBucketLimits[i]) break;
+	}
+	NetStats.PingBuckets[i]++;
+}
+
+#ifdef CC_BUILD_NETWORKING
+/* Statistics for the current (not yet complete) second */
+static int stats_packets[256], stats_bytes[256], stats_handlerTime[256];
+static double stats_lastUpdate;
+
+static CC_INLINE void NetStats_AddPacket(cc_uint8 opcode, cc_uint64 beg, cc_uint64 end) {
+	stats_packets[opcode]++;
+	stats_bytes[opcode]       += Protocol.Sizes[opcode];
+	stats_handlerTime[opcode] += (int)Stopwatch_ElapsedMicroseconds(beg, end);
+}
+
+/* Moves statistics for the current second into NetStats, once a second has elapsed */
+static void NetStats_Update(int sendQueued) {
+	int i;
+	NetStats.SendQueued = sendQueued;
+	if (Game.Time < stats_lastUpdate + 1.0) return;
+	stats_lastUpdate = Game.Time;
+
+	NetStats.TotalPackets = 0;
+	NetStats.TotalBytes   = 0;
+
+	for (i = 0; i < 256; i++)
+	{
+		NetStats.Packets[i]     = stats_packets[i];
+		NetStats.Bytes[i]       = stats_bytes[i];
+		NetStats.HandlerTime[i] = stats_handlerTime[i];
+
+		NetStats.TotalPackets += stats_packets[i];
+		NetStats.TotalBytes   += stats_bytes[i];
+	}
+
+	Mem_Set(stats_packets,     0, sizeof(stats_packets));
+	Mem_Set(stats_bytes,       0, sizeof(stats_bytes));
+	Mem_Set(stats_handlerTime, 0, sizeof(stats_handlerTime));
+}
+
+static void NetStats_Reset(void) {
+	Mem_Set(&NetStats, 0, sizeof(NetStats));
+	stats_lastUpdate = Game.Time;
+
+	Mem_Set(stats_packets,     0, sizeof(stats_packets));
+	Mem_Set(stats_bytes,       0, sizeof(stats_bytes));
+	Mem_Set(stats_handlerTime, 0, sizeof(stats_handlerTime));
+}
+#endif
+
+
 /*########################################################################################################################*
 *-------------------------------------------------Singleplayer connection-------------------------------------------------*
 *#########################################################################################################################*/
@@ -203,6 +268,7 @@ static void SPConnection_SendData(const cc_uint8* data, cc_uint32 len) { }
 
 static void SPConnection_Tick(struct ScheduledTask* task) {
 	if (Server.Disconnected) return;
+	Physics_Update();
 	/* 60 -> 20 ticks a second */
 	if ((ticks++ % 3) != 0)  return;
 	
@@ -229,7 +295,8 @@ static void SPConnection_Init(void) {
 /*########################################################################################################################*
 *--------------------------------------------------Multiplayer connection-------------------------------------------------*
 *#########################################################################################################################*/
-static cc_socket net_socket = -1;
+#define NET_NO_SOCKET ((cc_socket)-1)
+static cc_socket net_socket = NET_NO_SOCKET;
 static cc_result net_writeFailure;
 static void OnClose(void);
 
@@ -243,6 +310,100 @@ static cc_bool net_connecting;
 static double net_connectTimeout;
 #define NET_TIMEOUT_SECS 15
 
+/* Addresses the server's address resolved to, and the socket connecting to each of them */
+/* NOTE: Sockets are NET_NO_SOCKET when not or no longer connecting to that address */
+static cc_sockaddr net_addrs[SOCKET_MAX_ADDRS];
+static cc_socket net_attempts[SOCKET_MAX_ADDRS];
+static int net_numAddrs, net_nextAddr;
+static cc_result net_resolveResult, net_attemptFailure;
+static double net_nextAttemptTime;
+/* How long to wait for a connection attempt to succeed, before also trying the next address */
+/*  (e.g. so that a broken IPv6 network doesn't delay connecting over IPv4) */
+#define NET_ATTEMPT_DELAY 0.25
+
+#ifdef CC_BUILD_NETTHREAD
+static void* net_resolveThread;
+static volatile cc_bool net_resolveDone;
+#endif
+
+/* Data that could not be sent yet, because the socket's send buffer was full */
+/* NOTE: Head and tail only ever increase, and are masked to get the position in the buffer */
+static cc_uint8 net_sendQueue[64 * 1024];
+#define NET_SEND_MASK (sizeof(net_sendQueue) - 1)
+static cc_uint32 net_sendHead, net_sendTail;
+/* Number of times the send buffer was full, and most data ever waiting in the send queue */
+static int net_sendStalls, net_sendMaxQueued;
+static void MPConnection_FlushSend(void);
+
+#ifdef CC_BUILD_NETTHREAD
+/* Data received by the network thread, which has not been processed by the main thread yet */
+/* NOTE: Head and tail only ever increase, and are masked to get the position in the buffer */
+static cc_uint8 net_ring[256 * 1024];
+#define NET_RING_MASK (sizeof(net_ring) - 1)
+static volatile cc_uint32 net_ringHead, net_ringTail;
+static void* net_ringMutex;
+
+static void* net_thread;
+static volatile cc_bool net_threadStop, net_threadClosed;
+static volatile cc_result net_threadFailure;
+/* Maximum time per network tick spent processing received data, in milliseconds */
+#define NET_TICK_BUDGET_MS 10
+
+static void NetThread_Run(void) {
+	cc_uint32 head, tail, count, read;
+	cc_result res;
+
+	while (!net_threadStop) {
+		Mutex_Lock(net_ringMutex);
+		{
+			head = net_ringHead;
+			tail = net_ringTail;
+		}
+		Mutex_Unlock(net_ringMutex);
+
+		/* Only read into the contiguous free part of the ring buffer */
+		count = sizeof(net_ring) - (head - tail);
+		count = min(count, sizeof(net_ring) - (head & NET_RING_MASK));
+		/* Main thread is still processing previously received data */
+		if (!count) { Thread_Sleep(1); continue; }
+
+		res = Socket_Read(net_socket, net_ring + (head & NET_RING_MASK), count, &read);
+		if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) {
+			Thread_Sleep(1); continue;
+		}
+		if (res) { net_threadFailure = res; return; }
+
+		/* recv only returns 0 read when socket is closed.. probably? */
+		if (!read) { net_threadClosed = true; Thread_Sleep(10); continue; }
+
+		Mutex_Lock(net_ringMutex);
+		{
+			net_ringHead = head + read;
+		}
+		Mutex_Unlock(net_ringMutex);
+	}
+}
+
+static void NetThread_Start(void) {
+	if (!net_ringMutex) net_ringMutex = Mutex_Create("Network ring");
+	net_ringHead      = 0;
+	net_ringTail      = 0;
+	net_threadStop    = false;
+	net_threadClosed  = false;
+	net_threadFailure = 0;
+
+	Thread_Run(&net_thread, NetThread_Run, 64 * 1024, "Network");
+}
+
+static void NetThread_Stop(void) {
+	if (!net_thread) return;
+	net_threadStop = true;
+
+	Thread_Join(net_thread);
+	net_thread = NULL;
+}
+#endif
+
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
 	Event_RaiseVoid(&NetEvents.Connected);
@@ -250,6 +411,13 @@ static void MPConnection_FinishConnect(void) {
 
 	net_readCurrent = net_readBuffer;
 	net_lastPacket  = Game.Time;
+
+	net_sendHead   = 0; net_sendTail      = 0;
+	net_sendStalls = 0; net_sendMaxQueued = 0;
+	NetStats_Reset();
+#ifdef CC_BUILD_NETTHREAD
+	NetThread_Start();
+#endif
 	Classic_SendLogin();
 }
 
@@ -275,15 +443,113 @@ static void MPConnection_FailConnect(cc_result result) {
 	MPConnection_Fail(&reason);
 }
 
+/* Resolves the server's address (via DNS if needed) into one or more IP addresses */
+static void MPConnection_Resolve(void) {
+	net_resolveResult = Socket_ParseAddress(&Server.Address, Server.Port, net_addrs, &net_numAddrs);
+#ifdef CC_BUILD_NETTHREAD
+	net_resolveDone   = true;
+#endif
+}
+
+/* Returns false (after disconnecting) if the server's address could not be resolved */
+static cc_bool MPConnection_CheckResolved(void) {
+	static const cc_string invalid_reason = String_FromConst("Invalid IP address");
+	cc_result res = net_resolveResult;
+
+	if (res == ERR_INVALID_ARGUMENT) {
+		MPConnection_Fail(&invalid_reason); return false;
+	} else if (res) {
+		MPConnection_FailConnect(res); return false;
+	}
+	return true;
+}
+
+/* Begins connecting to the next address that the server's address resolved to */
+static void MPConnection_StartAttempt(void) {
+	int i = net_nextAddr++;
+	cc_result res;
+	net_nextAttemptTime = Game.Time + NET_ATTEMPT_DELAY;
+
+	res = Socket_Create(&net_attempts[i], &net_addrs[i], true);
+	if (res) { net_attempts[i] = NET_NO_SOCKET; net_attemptFailure = res; return; }
+	res = Socket_Connect(net_attempts[i], &net_addrs[i]);
+
+	if (res && res != ReturnCode_SocketInProgess && res != ReturnCode_SocketWouldBlock) {
+		Socket_Close(net_attempts[i]);
+		net_attempts[i]     = NET_NO_SOCKET;
+		net_attemptFailure  = res;
+		/* No point waiting before trying the next address */
+		net_nextAttemptTime = Game.Time;
+	}
+}
+
+/* Closes all sockets still connecting to an address, except for the given socket */
+static void MPConnection_CloseAttempts(cc_socket keep) {
+	int i;
+	for (i = 0; i < net_nextAddr; i++)
+	{
+		if (net_attempts[i] != NET_NO_SOCKET && net_attempts[i] != keep) {
+			Socket_Close(net_attempts[i]);
+		}
+		net_attempts[i] = NET_NO_SOCKET;
+	}
+}
+
+/* Stops resolving the server's address and closes all connection attempts */
+static void MPConnection_StopConnecting(void) {
+#ifdef CC_BUILD_NETTHREAD
+	/* NOTE: There's no way to cancel a DNS lookup, so just have to wait for it */
+	if (net_resolveThread) {
+		Thread_Join(net_resolveThread);
+		net_resolveThread = NULL;
+	}
+#endif
+	MPConnection_CloseAttempts(NET_NO_SOCKET);
+}
+
 static void MPConnection_TickConnect(void) {
-	cc_bool writable;
-	double now    = Game.Time;
-	cc_result res = Socket_CheckWritable(net_socket, &writable);
+	cc_bool writable, pending = false;
+	double now = Game.Time;
+	cc_result res;
+	int i;
 
-	if (res) {
-		MPConnection_FailConnect(res);
-	} else if (writable) {
-		MPConnection_FinishConnect();
+#ifdef CC_BUILD_NETTHREAD
+	if (net_resolveThread && net_resolveDone) {
+		Thread_Join(net_resolveThread);
+		net_resolveThread = NULL;
+		if (!MPConnection_CheckResolved()) return;
+	}
+	pending = net_resolveThread != NULL;
+#endif
+
+	/* Start connecting to the next address, in case the previous ones are slow or broken */
+	if (!pending && net_nextAddr < net_numAddrs && now >= net_nextAttemptTime) {
+		MPConnection_StartAttempt();
+	}
+
+	for (i = 0; i < net_nextAddr; i++)
+	{
+		if (net_attempts[i] == NET_NO_SOCKET) continue;
+		res = Socket_CheckWritable(net_attempts[i], &writable);
+
+		if (res) {
+			Socket_Close(net_attempts[i]);
+			net_attempts[i]     = NET_NO_SOCKET;
+			net_attemptFailure  = res;
+			net_nextAttemptTime = now;
+		} else if (writable) {
+			/* Use whichever connection attempt succeeds first */
+			net_socket = net_attempts[i];
+			MPConnection_CloseAttempts(net_socket);
+			MPConnection_FinishConnect();
+			return;
+		} else {
+			pending = true;
+		}
+	}
+
+	if (!pending && net_nextAddr == net_numAddrs) {
+		MPConnection_FailConnect(net_attemptFailure);
 	} else if (now > net_connectTimeout) {
 		MPConnection_FailConnect(0);
 	} else {
@@ -293,11 +559,7 @@ static void MPConnection_TickConnect(void) {
 }
 
 static void MPConnection_BeginConnect(void) {
-	static const cc_string invalid_reason = String_FromConst("Invalid IP address");
 	cc_string title; char titleBuffer[STRING_SIZE];
-	cc_sockaddr addrs[SOCKET_MAX_ADDRS];
-	int numValidAddrs;
-	cc_result res;
 	String_InitArray(title, titleBuffer);
 
 	/* Default block permissions (in case server supports SetBlockPermissions but doesn't send) */
@@ -307,28 +569,29 @@ static void MPConnection_BeginConnect(void) {
 	Blocks.CanPlace[BLOCK_STILL_LAVA] = false;  Blocks.CanDelete[BLOCK_STILL_LAVA] = false;
 	Blocks.CanPlace[BLOCK_STILL_WATER] = false; Blocks.CanDelete[BLOCK_STILL_WATER] = false;
 	Blocks.CanPlace[BLOCK_BEDROCK] = false;     Blocks.CanDelete[BLOCK_BEDROCK] = false;
-	
-	res = Socket_ParseAddress(&Server.Address, Server.Port, addrs, &numValidAddrs);
-	if (res == ERR_INVALID_ARGUMENT) {
-		MPConnection_Fail(&invalid_reason); return;
-	} else if (res) {
-		MPConnection_FailConnect(res); return;
-	}
 
-	res = Socket_Create(&net_socket, &addrs[0], true);
-	if (res) { MPConnection_FailConnect(res); return; }
-	res = Socket_Connect(net_socket, &addrs[0]);
+	net_socket          = NET_NO_SOCKET;
+	net_numAddrs        = 0;
+	net_nextAddr        = 0;
+	net_attemptFailure  = 0;
+	net_nextAttemptTime = 0;
 
-	if (res && res != ReturnCode_SocketInProgess && res != ReturnCode_SocketWouldBlock) {
-		MPConnection_FailConnect(res);
-	} else {
-		Server.Disconnected = false;
-		net_connecting      = true;
-		net_connectTimeout  = Game.Time + NET_TIMEOUT_SECS;
+	Server.Disconnected = false;
+	net_connecting      = true;
+	net_connectTimeout  = Game.Time + NET_TIMEOUT_SECS;
 
-		String_Format2(&title, "Connecting to %s:%i..", &Server.Address, &Server.Port);
-		LoadingScreen_Show(&title, &String_Empty);
-	}
+	String_Format2(&title, "Connecting to %s:%i..", &Server.Address, &Server.Port);
+	LoadingScreen_Show(&title, &String_Empty);
+
+#ifdef CC_BUILD_NETTHREAD
+	/* DNS lookups can take a while, so avoid freezing the game while waiting for them */
+	net_resolveDone = false;
+	Thread_Run(&net_resolveThread, MPConnection_Resolve, 128 * 1024, "DNS lookup");
+#else
+	MPConnection_Resolve();
+	if (!MPConnection_CheckResolved()) return;
+	MPConnection_StartAttempt();
+#endif
 }
 
 static void MPConnection_SendBlock(int x, int y, int z, BlockID old, BlockID now) {
@@ -376,17 +639,134 @@ static void DisconnectInvalidOpcode(cc_uint8 opcode) {
 	Game_Disconnect(&title, &tmp); return;
 }
 
-static void MPConnection_Tick(struct ScheduledTask* task) {
+/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
+static cc_bool MPConnection_IsD3ExtraByte(cc_uint8 opcode) {
+	if (!cpe_needD3Fix || lastOpcode != OPCODE_HACK_CONTROL) return false;
+	if (opcode != 0x00 && opcode != 0xFF) return false;
+
+	Platform_LogConst("Skipping invalid HackControl byte from D3 server");
+	LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
+	return true;
+}
+
+static CC_INLINE void MPConnection_HandlePacket(cc_uint8 opcode, Net_Handler handler, cc_uint8* data) {
+	cc_uint64 beg = Stopwatch_Measure();
+	lastOpcode    = opcode;
+	handler(data + 1); /* skip opcode */
+	NetStats_AddPacket(opcode, beg, Stopwatch_Measure());
+}
+
+#ifdef CC_BUILD_NETTHREAD
+/* Returns false if disconnected */
+static cc_bool MPConnection_ReadData(void) {
+	cc_uint64 beg = Stopwatch_Measure();
+	cc_uint32 head, tail, offset, part, size;
+	cc_bool overBudget = false;
+	Net_Handler handler;
+	cc_uint8* packet;
+	cc_uint8 opcode;
+
+	Mutex_Lock(net_ringMutex);
+	{
+		head = net_ringHead;
+		tail = net_ringTail;
+	}
+	Mutex_Unlock(net_ringMutex);
+	if (head != tail) net_lastPacket = Game.Time;
+
+	/* Process as much received data as possible within the budget, */
+	/*  so that e.g. loading maps is limited by bandwidth rather than framerate */
+	while (tail != head && !Server.Disconnected) {
+		offset = tail & NET_RING_MASK;
+		packet = net_ring + offset;
+		opcode = packet[0];
+		if (MPConnection_IsD3ExtraByte(opcode)) { tail++; continue; }
+
+		/* Protocol packets might be split up across TCP packets */
+		/* If so, wait for rest of the packet to be received */
+		size = Protocol.Sizes[opcode];
+		if (head - tail < size) break;
+
+		handler = Protocol.Handlers[opcode];
+		if (!handler) { DisconnectInvalidOpcode(opcode); return false; }
+
+		/* Packets are handled directly from the ring buffer, unless split across its end */
+		part = sizeof(net_ring) - offset;
+		if (part < size) {
+			Mem_Copy(net_readBuffer,        packet,   part);
+			Mem_Copy(net_readBuffer + part, net_ring, size - part);
+			packet = net_readBuffer;
+		}
+
+		MPConnection_HandlePacket(opcode, handler, packet);
+		tail += size;
+		if (tail != head) continue;
+
+		/* Hand the processed space back to the network thread, and check for newly received data */
+		Mutex_Lock(net_ringMutex);
+		{
+			net_ringTail = tail;
+			head         = net_ringHead;
+		}
+		Mutex_Unlock(net_ringMutex);
+
+		overBudget = Stopwatch_ElapsedMS(beg, Stopwatch_Measure()) >= NET_TICK_BUDGET_MS;
+		if (overBudget) break;
+	}
+
+	Mutex_Lock(net_ringMutex);
+	{
+		net_ringTail = tail;
+	}
+	Mutex_Unlock(net_ringMutex);
+
+	/* Only check for errors after processing all data received before them (e.g. kick packets) */
+	if (overBudget) return true;
+	if (net_threadFailure) { DisconnectReadFailed(net_threadFailure); return false; }
+
+	/* Over 30 seconds since last packet, connection probably dropped */
+	if (net_threadClosed && net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return false; }
+	return true;
+}
+#else
+/* Processes all complete packets in the given number of newly read bytes */
+/* Returns false if disconnected due to invalid data */
+static cc_bool MPConnection_ProcessData(cc_uint32 read) {
 	Net_Handler handler;
 	cc_uint8* readEnd;
 	cc_uint8* readCur;
+	int remaining;
+
+	readCur        = net_readBuffer;
+	readEnd        = net_readCurrent + read;
+	net_lastPacket = Game.Time;
+
+	while (readCur < readEnd) {
+		cc_uint8 opcode = readCur[0];
+		if (MPConnection_IsD3ExtraByte(opcode)) { readCur++; continue; }
+
+		if (readCur + Protocol.Sizes[opcode] > readEnd) break;
+		handler = Protocol.Handlers[opcode];
+		if (!handler) { DisconnectInvalidOpcode(opcode); return false; }
+
+		MPConnection_HandlePacket(opcode, handler, readCur);
+		readCur += Protocol.Sizes[opcode];
+	}
+
+	/* Protocol packets might be split up across TCP packets */
+	/* If so, copy last few unprocessed bytes back to beginning of buffer */
+	/* These bytes are then later combined with subsequently read TCP packet data */
+	remaining = (int)(readEnd - readCur);
+	if (remaining) Mem_Move(net_readBuffer, readCur, remaining);
+	net_readCurrent = net_readBuffer + remaining;
+	return true;
+}
+
+/* Returns false if disconnected */
+static cc_bool MPConnection_ReadData(void) {
 	cc_uint32 read;
-	int i, remaining;
 	cc_result res;
 
-	if (Server.Disconnected) return;
-	if (net_connecting) { MPConnection_TickConnect(); return; }
-
 	/* NOTE: using a read call that is a multiple of 4096 (appears to?) improve read performance */	
 	res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &read);
 	
@@ -395,47 +775,34 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 		if (res == ReturnCode_SocketInProgess)  res = 0;
 		if (res == ReturnCode_SocketWouldBlock) res = 0;
 
-		if (res) { DisconnectReadFailed(res); return; }
+		if (res) { DisconnectReadFailed(res); return false; }
 	} else if (read == 0) {
 		/* recv only returns 0 read when socket is closed.. probably? */
 		/* Over 30 seconds since last packet, connection probably dropped */
 		/* TODO: Should this be checked unconditonally instead of just when read = 0 ? */
-		if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return; }
+		if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return false; }
 	} else {
-		readCur        = net_readBuffer;
-		readEnd        = net_readCurrent + read;
-		net_lastPacket = Game.Time;
-
-		while (readCur < readEnd) {
-			cc_uint8 opcode = readCur[0];
-
-			/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
-			if (cpe_needD3Fix && lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
-				Platform_LogConst("Skipping invalid HackControl byte from D3 server");
-				readCur++;
-				LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
-				continue;
-			}
-
-			if (readCur + Protocol.Sizes[opcode] > readEnd) break;
-			handler = Protocol.Handlers[opcode];
-			if (!handler) { DisconnectInvalidOpcode(opcode); return; }
-
-			lastOpcode = opcode;
-			handler(readCur + 1); /* skip opcode */
-			readCur += Protocol.Sizes[opcode];
-		}
+		return MPConnection_ProcessData(read);
+	}
+	return true;
+}
+#endif
 
-		/* Protocol packets might be split up across TCP packets */
-		/* If so, copy last few unprocessed bytes back to beginning of buffer */
-		/* These bytes are then later combined with subsequently read TCP packet data */
-		remaining = (int)(readEnd - readCur);
-		for (i = 0; i < remaining; i++) 
-		{
-			net_readBuffer[i] = readCur[i];
-		}
-		net_readCurrent = net_readBuffer + remaining;
+static void MPConnection_Tick(struct ScheduledTask* task) {
+	cc_bool disconnected;
+	if (Server.Disconnected) return;
+	if (net_connecting) { MPConnection_TickConnect(); return; }
+
+	/* Servers may send many block changes at once (e.g. when /fill or physics is used) */
+	Game_BeginBlockBatch();
+	{
+		disconnected = !MPConnection_ReadData();
 	}
+	Game_EndBlockBatch();
+
+	if (disconnected) return;
+	MPConnection_FlushSend();
+	NetStats_Update((int)(net_sendHead - net_sendTail));
 
 	if (net_writeFailure) {
 		Platform_Log1("Error from send: %e", &net_writeFailure);
@@ -449,28 +816,64 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 	Protocol_Tick();
 }
 
-static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
-	cc_uint32 wrote;
+/* Writes as much of the given data as possible without blocking, returning number of bytes written */
+static cc_uint32 MPConnection_Write(const cc_uint8* data, cc_uint32 len) {
+	cc_uint32 wrote, total = 0;
 	cc_result res;
-	int tries = 0;
-	if (Server.Disconnected) return;
 
 	while (len) {
 		res = Socket_Write(net_socket, data, len, &wrote);
-		/* If sending would block (send buffer full), retry for a bit up to 10 seconds */
-		/* TODO: Avoid doing this and manually buffer data when this happens */
-		if (res && tries < 1000 && (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock)) {
-			Thread_Sleep(10);
-			tries++;
-			continue;
+		/* Send buffer is full, so rest of the data will need to be sent later */
+		if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) {
+			net_sendStalls++; break;
 		}
 
 		/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
-		if (res)    { net_writeFailure = res;                  return; }
-		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+		if (res)    { net_writeFailure = res;                  break; }
+		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; break; }
+
+		data += wrote; len -= wrote; total += wrote;
+	}
+	return total;
+}
+
+/* Attempts to send data that was previously queued because the send buffer was full */
+static void MPConnection_FlushSend(void) {
+	cc_uint32 part, wrote;
+
+	while (net_sendHead != net_sendTail && !net_writeFailure) {
+		/* Only send the contiguous part of the ring buffer each time */
+		part  = net_sendHead - net_sendTail;
+		part  = min(part, sizeof(net_sendQueue) - (net_sendTail & NET_SEND_MASK));
+		wrote = MPConnection_Write(net_sendQueue + (net_sendTail & NET_SEND_MASK), part);
 
+		net_sendTail += wrote;
+		if (wrote < part) return;
+	}
+}
+
+static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
+	cc_uint32 wrote, part;
+	if (Server.Disconnected) return;
+
+	/* Data must be sent in order, so can't send directly while older data is still queued */
+	if (net_sendHead == net_sendTail) {
+		wrote = MPConnection_Write(data, len);
 		data += wrote; len -= wrote;
 	}
+	if (!len || net_writeFailure) return;
+
+	if (len > sizeof(net_sendQueue) - (net_sendHead - net_sendTail)) {
+		/* Server hasn't been receiving data for a long time, connection probably dropped */
+		net_writeFailure = ERR_OUT_OF_MEMORY; return;
+	}
+
+	for (; len; data += part, len -= part, net_sendHead += part)
+	{
+		part = min(len, sizeof(net_sendQueue) - (net_sendHead & NET_SEND_MASK));
+		Mem_Copy(net_sendQueue + (net_sendHead & NET_SEND_MASK), data, part);
+	}
+	net_sendMaxQueued = max(net_sendMaxQueued, (int)(net_sendHead - net_sendTail));
 }
 
 static void MPConnection_Init(void) {
@@ -541,9 +944,20 @@ static void OnClose(void) {
 		Physics_Free();
 	} else {
 		Ping_Reset();
+#ifdef CC_BUILD_NETTHREAD
+		NetThread_Stop();
+#endif
+#ifdef CC_BUILD_NETWORKING
+		MPConnection_StopConnecting();
+		if (net_sendStalls) {
+			Platform_Log2("Send buffer was full %i times (at most %i bytes queued)", &net_sendStalls, &net_sendMaxQueued);
+			net_sendStalls = 0;
+		}
+#endif
 		if (Server.Disconnected) return;
 
-		Socket_Close(net_socket);
+		if (net_socket != NET_NO_SOCKET) Socket_Close(net_socket);
+		net_socket          = NET_NO_SOCKET;
 		Server.Disconnected = true;
 	}
 }
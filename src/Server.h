@@ -19,6 +19,27 @@ void Ping_Update(int id);
 /* Calculates average ping time based on most recent ping entries */
 int Ping_AveragePingMS(void);
 
+#define NETSTATS_PING_BUCKETS 8
+/* Upper limit (in milliseconds) of the ping times counted in each ping histogram bucket */
+extern const int NetStats_PingBucketLimits[NETSTATS_PING_BUCKETS];
+
+/* Statistics about the current multiplayer connection */
+/* NOTE: Per second statistics are for the previous full second */
+CC_VAR extern struct _NetStatsData {
+	/* Number of packets received per second, for each opcode */
+	int Packets[256];
+	/* Number of bytes received per second, for each opcode */
+	int Bytes[256];
+	/* Time spent per second in the packet handler, for each opcode, in microseconds */
+	int HandlerTime[256];
+	/* Total number of packets and bytes received per second */
+	int TotalPackets, TotalBytes;
+	/* Number of bytes waiting to be sent to the server */
+	int SendQueued;
+	/* Number of ping measurements in each ping histogram bucket */
+	int PingBuckets[NETSTATS_PING_BUCKETS];
+} NetStats;
+
 /* Data for currently active connection to a server */
 CC_VAR extern struct _ServerConnectionData {
 	/* Begins connecting to the server */
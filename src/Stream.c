@@ -88,7 +88,10 @@ void Stream_Init(struct Stream* s) {
 /*########################################################################################################################*
 *-------------------------------------------------------FileStream--------------------------------------------------------*
 *#########################################################################################################################*/
+cc_uint32 Stream_FileCalls;
+
 static cc_result Stream_FileRead(struct Stream* s, cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	Stream_FileCalls++;
 	return File_Read(s->meta.file, data, count, modified);
 }
 static cc_result Stream_FileWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
@@ -100,15 +103,19 @@ static cc_result Stream_FileClose(struct Stream* s) {
 	return res;
 }
 static cc_result Stream_FileSkip(struct Stream* s, cc_uint32 count) {
+	Stream_FileCalls++;
 	return File_Seek(s->meta.file, count, FILE_SEEKFROM_CURRENT);
 }
 static cc_result Stream_FileSeek(struct Stream* s, cc_uint32 position) {
+	Stream_FileCalls++;
 	return File_Seek(s->meta.file, position, FILE_SEEKFROM_BEGIN);
 }
 static cc_result Stream_FilePosition(struct Stream* s, cc_uint32* position) {
+	Stream_FileCalls++;
 	return File_Position(s->meta.file, position);
 }
 static cc_result Stream_FileLength(struct Stream* s, cc_uint32* length) {
+	Stream_FileCalls++;
 	return File_Length(s->meta.file, length);
 }
 
@@ -289,6 +296,25 @@ void Stream_ReadonlyMemory(struct Stream* s, void* data, cc_uint32 len) {
 	s->meta.mem.base   = (cc_uint8*)data;
 }
 
+#ifdef CC_BUILD_FILEMAP
+static cc_result Stream_MappedClose(struct Stream* s) {
+	return File_Unmap(s->meta.mem.base, s->meta.mem.length);
+}
+
+cc_result Stream_OpenMappedFile(struct Stream* s, const cc_string* path) {
+	cc_filepath str;
+	cc_uint32 len;
+	void* data;
+	cc_result res;
+	Platform_EncodePath(&str, path);
+
+	if ((res = File_Map(&str, &data, &len))) return res;
+	Stream_ReadonlyMemory(s, data, len);
+	s->Close = Stream_MappedClose;
+	return 0;
+}
+#endif
+
 
 /*########################################################################################################################*
 *----------------------------------------------------BufferedStream-------------------------------------------------------*
@@ -303,6 +329,13 @@ static cc_result Stream_BufferedRead(struct Stream* s, cc_uint8* data, cc_uint32
 		source               = s->meta.buffered.source; 
 		s->meta.buffered.cur = s->meta.buffered.base;
 
+		/* Avoid pointlessly copying large reads through the buffer */
+		if (count >= s->meta.buffered.length) {
+			res = source->Read(source, data, count, modified);
+			if (!res) s->meta.buffered.end += *modified;
+			return res;
+		}
+
 		res = source->Read(source, s->meta.buffered.cur, s->meta.buffered.length, &read);
 		if (res) return res;
 		s->meta.buffered.left  = read;
@@ -353,11 +386,43 @@ static cc_result Stream_BufferedSeek(struct Stream* s, cc_uint32 position) {
 	return res;
 }
 
+static cc_result Stream_BufferedSkip(struct Stream* s, cc_uint32 count) {
+	struct Stream* source;
+	cc_result res;
+
+	if (count <= s->meta.buffered.left) {
+		s->meta.buffered.cur  += count;
+		s->meta.buffered.left -= count;
+		return 0;
+	}
+
+	count -= s->meta.buffered.left;
+	source = s->meta.buffered.source;
+	res    = source->Skip(source, count);
+	if (res) return res;
+
+	s->meta.buffered.cur   = s->meta.buffered.base;
+	s->meta.buffered.left  = 0;
+	s->meta.buffered.end  += count;
+	return 0;
+}
+
+static cc_result Stream_BufferedPosition(struct Stream* s, cc_uint32* position) {
+	*position = s->meta.buffered.end - s->meta.buffered.left; return 0;
+}
+static cc_result Stream_BufferedLength(struct Stream* s, cc_uint32* length) {
+	struct Stream* source = s->meta.buffered.source;
+	return source->Length(source, length);
+}
+
 void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data, cc_uint32 size) {
 	Stream_Init(s);
-	s->Read   = Stream_BufferedRead;
-	s->ReadU8 = Stream_BufferedReadU8;
-	s->Seek   = Stream_BufferedSeek;
+	s->Read     = Stream_BufferedRead;
+	s->ReadU8   = Stream_BufferedReadU8;
+	s->Skip     = Stream_BufferedSkip;
+	s->Seek     = Stream_BufferedSeek;
+	s->Position = Stream_BufferedPosition;
+	s->Length   = Stream_BufferedLength;
 
 	s->meta.buffered.left   = 0;
 	s->meta.buffered.end    = 0;
@@ -367,6 +432,37 @@ void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data
 	s->meta.buffered.source = source;
 }
 
+#ifdef CC_BUILD_LOWMEM
+cc_uint32 Stream_FileBufferSize =  8 * 1024;
+#else
+cc_uint32 Stream_FileBufferSize = 64 * 1024;
+#endif
+
+static cc_result Stream_BufferedFileClose(struct Stream* s) {
+	struct Stream* file = s->meta.buffered.source;
+	cc_result res = file->Close(file);
+
+	Mem_Free(file);
+	return res;
+}
+
+cc_result Stream_OpenBufferedFile(struct Stream* s, const cc_string* path) {
+	struct Stream* file;
+	cc_result res;
+	if (!Stream_FileBufferSize) return Stream_OpenFile(s, path);
+
+	/* Buffer is stored directly after the underlying file stream */
+	file = (struct Stream*)Mem_TryAlloc(1, sizeof(struct Stream) + Stream_FileBufferSize);
+	if (!file) return Stream_OpenFile(s, path);
+
+	res = Stream_OpenFile(file, path);
+	if (res) { Mem_Free(file); return res; }
+
+	Stream_ReadonlyBuffered(s, file, file + 1, Stream_FileBufferSize);
+	s->Close = Stream_BufferedFileClose;
+	return 0;
+}
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------CRC32Stream---------------------------------------------------------*
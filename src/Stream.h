@@ -66,9 +66,22 @@ CC_API void Stream_FromFile(struct Stream* s, cc_file file);
 CC_API void Stream_ReadonlyPortion(struct Stream* s, struct Stream* source, cc_uint32 len);
 /* Wraps a block of memory, allowing reading from and seeking in the block. */
 CC_API void Stream_ReadonlyMemory(struct Stream* s, void* data, cc_uint32 len);
+#ifdef CC_BUILD_FILEMAP
+/* Wrapper for File_Map() then Stream_ReadonlyMemory(), with Close unmapping the file */
+cc_result Stream_OpenMappedFile(struct Stream* s, const cc_string* path);
+#endif
 /* Wraps another Stream, reading through an intermediary buffer. (Useful for files, since each read call is expensive) */
 CC_API void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data, cc_uint32 size);
 
+/* Size of the readahead buffer used by Stream_OpenBufferedFile. (0 disables buffering) */
+extern cc_uint32 Stream_FileBufferSize;
+/* Number of read/skip/seek/position/length calls made to files by file streams */
+/* NOTE: Not thread safe, so only approximate when files are read on multiple threads */
+CC_VAR extern cc_uint32 Stream_FileCalls;
+/* Wrapper for Stream_OpenFile() then Stream_ReadonlyBuffered(), with Close also freeing the buffer */
+/* NOTE: Reads larger than the buffer still go directly to the file */
+cc_result Stream_OpenBufferedFile(struct Stream* s, const cc_string* path);
+
 /* Wraps another Stream, calculating a running CRC32 as data is written. */
 /* To get the final CRC32, xor it with 0xFFFFFFFFUL */
 void Stream_WriteonlyCrc32(struct Stream* s, struct Stream* source);
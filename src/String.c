@@ -11,6 +11,63 @@ const cc_string String_Empty = { NULL, 0, 0 };
 const cc_string String_Empty;
 #endif
 
+/* Comparing and searching strings one 4 byte word at a time is much faster than byte by byte */
+/* NOTE: Bytes are assembled individually since strings may not be aligned, which compilers turn into one load */
+#define String_ReadWord(p) ((cc_uint32)(cc_uint8)(p)[0]        | ((cc_uint32)(cc_uint8)(p)[1] << 8) | \
+							((cc_uint32)(cc_uint8)(p)[2] << 16) | ((cc_uint32)(cc_uint8)(p)[3] << 24))
+#define WORD_ALL_BYTES(b) ((b) * 0x01010101UL)
+
+/* Lowercases every 'A' to 'Z' byte in the given word at once (same as Char_MakeLower on each byte) */
+static CC_INLINE cc_uint32 Word_MakeLower(cc_uint32 w) {
+	cc_uint32 low = w & WORD_ALL_BYTES(0x7F);
+	/* Top bit of each byte is set in geA when the byte is >= 'A', and in gtZ when the byte is > 'Z' */
+	cc_uint32 geA = low + WORD_ALL_BYTES(0x80 - 'A');
+	cc_uint32 gtZ = low + WORD_ALL_BYTES(0x7F - 'Z');
+	cc_uint32 isUpper = geA & ~gtZ & ~w & WORD_ALL_BYTES(0x80);
+	/* 0x80 >> 2 is the 0x20 difference between upper and lower case letters */
+	return w | (isUpper >> 2);
+}
+
+/* Whether the first len characters of a and b are the same, ignoring case */
+static cc_bool String_CaselessEqualsRaw(const char* a, const char* b, int len) {
+	cc_uint32 aWord, bWord;
+	char aCur, bCur;
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		aWord = String_ReadWord(a + i);
+		bWord = String_ReadWord(b + i);
+		if (aWord != bWord && Word_MakeLower(aWord) != Word_MakeLower(bWord)) return false;
+	}
+
+	for (; i < len; i++)
+	{
+		aCur = a[i]; Char_MakeLower(aCur);
+		bCur = b[i]; Char_MakeLower(bCur);
+		if (aCur != bCur) return false;
+	}
+	return true;
+}
+
+/* Returns the index of the first c in the given range of characters, or -1 if there are none */
+static int String_FindChar(const char* buffer, int i, int end, char c) {
+	cc_uint32 pattern = WORD_ALL_BYTES((cc_uint8)c), word;
+
+	for (; i + 4 <= end; i += 4)
+	{
+		/* Bytes that are c become 0, and the expression below is non-zero when any byte is 0 */
+		word = String_ReadWord(buffer + i) ^ pattern;
+		if ((word - WORD_ALL_BYTES(0x01)) & ~word & WORD_ALL_BYTES(0x80)) break;
+	}
+
+	for (; i < end; i++)
+	{
+		if (buffer[i] == c) return i;
+	}
+	return -1;
+}
+
 int String_CalcLen(const char* raw, int capacity) {
 	int length = 0;
 	while (length < capacity && *raw) { raw++; length++; }
@@ -120,22 +177,15 @@ int String_Equals(const cc_string* a, const cc_string* b) {
 } 
 
 int String_CaselessEquals(const cc_string* a, const cc_string* b) {
-	int i;
-	char aCur, bCur;
 	if (a->length != b->length) return false;
-
-	for (i = 0; i < a->length; i++) {
-		aCur = a->buffer[i]; Char_MakeLower(aCur);
-		bCur = b->buffer[i]; Char_MakeLower(bCur);
-		if (aCur != bCur) return false;
-	}
-	return true;
+	return String_CaselessEqualsRaw(a->buffer, b->buffer, a->length);
 }
 
 int String_CaselessEqualsConst(const cc_string* a, const char* b) {
 	int i;
 	char aCur, bCur;
 
+	/* NOTE: Can't compare a word at a time here, as that might read past the end of b */
 	for (i = 0; i < a->length; i++) {
 		aCur = a->buffer[i]; Char_MakeLower(aCur);
 		bCur = b[i];         Char_MakeLower(bCur);
@@ -284,11 +334,7 @@ void String_AppendColorless(cc_string* str, const cc_string* src) {
 
 
 int String_IndexOfAt(const cc_string* str, int offset, char c) {
-	int i;
-	for (i = offset; i < str->length; i++) {
-		if (str->buffer[i] == c) return i;
-	}
-	return -1;
+	return String_FindChar(str->buffer, offset, str->length, c);
 }
 
 int String_LastIndexOfAt(const cc_string* str, int offset, char c) {
@@ -349,58 +395,39 @@ void String_UNSAFE_TrimEnd(cc_string* str) {
 }
 
 int String_IndexOfConst(const cc_string* str, const char* sub) {
-	int i, j;
+	int i, len = String_Length(sub);
+	int last   = str->length - len; /* last index sub could start at */
+	if (!len) return str->length ? 0 : -1;
 
-	for (i = 0; i < str->length; i++) {
-		for (j = 0; sub[j] && (i + j) < str->length; j++) {
+	for (i = 0; i <= last; i++) {
+		/* Skip straight to the next possible match */
+		i = String_FindChar(str->buffer, i, last + 1, sub[0]);
+		if (i == -1) return -1;
 
-			if (str->buffer[i + j] != sub[j]) break;
-		}
-		if (sub[j] == '\0') return i;
+		if (Mem_Equal(str->buffer + i + 1, sub + 1, len - 1)) return i;
 	}
 	return -1;
 }
 
 int String_CaselessContains(const cc_string* str, const cc_string* sub) {
-	char strCur, subCur;
-	int i, j;
-
-	for (i = 0; i < str->length; i++) {
-		for (j = 0; j < sub->length && (i + j) < str->length; j++) {
+	int i, last = str->length - sub->length;
+	if (!sub->length) return str->length > 0;
 
-			strCur = str->buffer[i + j]; Char_MakeLower(strCur);
-			subCur = sub->buffer[j];     Char_MakeLower(subCur);
-			if (strCur != subCur) break;
-		}
-		if (j == sub->length) return true;
+	for (i = 0; i <= last; i++) {
+		if (String_CaselessEqualsRaw(str->buffer + i, sub->buffer, sub->length)) return true;
 	}
 	return false;
 }
 
 int String_CaselessStarts(const cc_string* str, const cc_string* sub) {
-	char strCur, subCur;
-	int i;
 	if (str->length < sub->length) return false;
-
-	for (i = 0; i < sub->length; i++) {
-		strCur = str->buffer[i]; Char_MakeLower(strCur);
-		subCur = sub->buffer[i]; Char_MakeLower(subCur);
-		if (strCur != subCur) return false;
-	}
-	return true;
+	return String_CaselessEqualsRaw(str->buffer, sub->buffer, sub->length);
 }
 
 int String_CaselessEnds(const cc_string* str, const cc_string* sub) {
-	char strCur, subCur;
-	int i, j = str->length - sub->length;	
+	int j = str->length - sub->length;	
 	if (j < 0) return false; /* sub longer than str */
-
-	for (i = 0; i < sub->length; i++) {
-		strCur = str->buffer[j + i]; Char_MakeLower(strCur);
-		subCur = sub->buffer[i];     Char_MakeLower(subCur);
-		if (strCur != subCur) return false;
-	}
-	return true;
+	return String_CaselessEqualsRaw(str->buffer + j, sub->buffer, sub->length);
 }
 
 int String_Compare(const cc_string* a, const cc_string* b) {
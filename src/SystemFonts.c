@@ -12,6 +12,7 @@
 #include "Errors.h"
 #include "Window.h"
 #include "Options.h"
+#define MEM_SUBSYSTEM MEM_SYS_UI
 
 static char defaultBuffer[STRING_SIZE];
 static cc_string font_default = String_FromArray(defaultBuffer);
@@ -427,6 +428,9 @@ struct SysFont {
 	cc_uint16 widths[256]; /* cached width of each character glyph */
 	FT_BitmapGlyph glyphs[256];	       /* cached glyphs */
 	FT_BitmapGlyph shadow_glyphs[256]; /* cached glyphs (for back layer shadow) */
+	int size, dpiX, dpiY; /* 0 size when font was not successfully created */
+	char keyBuffer[FILENAME_SIZE + 16]; /* "path,index" value this font was looked up from */
+	int keyLength;
 #ifdef CC_BUILD_DARWIN
 	char filename[FILENAME_SIZE + 1];
 #endif
@@ -732,6 +736,61 @@ void SysFonts_GetNames(struct StringsBuffer* buffer) {
 }
 
 #define TEXT_CEIL(x) (((x) + 63) >> 6)
+/* Recently freed fonts are kept around instead of being destroyed straight away, */
+/*  as menus tend to recreate the same fonts every time they are opened. */
+/* Reusing a pooled font means its already rasterised glyphs can be reused too */
+#define SYSFONT_POOL_SIZE 4
+static struct SysFont* font_pool[SYSFONT_POOL_SIZE]; /* most recently freed first */
+static int font_poolCount;
+
+static void SysFont_SetKey(struct SysFont* font, const cc_string* value, int size, int dpiX, int dpiY) {
+	/* Too long to store, so just never reuse this font */
+	if (value->length > (int)sizeof(font->keyBuffer)) return;
+
+	Mem_Copy(font->keyBuffer, value->buffer, value->length);
+	font->keyLength = value->length;
+	font->size = size;
+	font->dpiX = dpiX;
+	font->dpiY = dpiY;
+}
+
+static struct SysFont* SysFont_TakePooled(const cc_string* value, int size, int dpiX, int dpiY) {
+	struct SysFont* font;
+	cc_string key;
+	int i;
+
+	for (i = 0; i < font_poolCount; i++) 
+	{
+		font = font_pool[i];
+		if (font->size != size || font->dpiX != dpiX || font->dpiY != dpiY) continue;
+
+		key = String_Init(font->keyBuffer, font->keyLength, font->keyLength);
+		if (!String_Equals(&key, value)) continue;
+
+		for (; i < font_poolCount - 1; i++) font_pool[i] = font_pool[i + 1];
+		font_poolCount--;
+		return font;
+	}
+	return NULL;
+}
+
+static void SysFont_Destroy(struct SysFont* font) {
+	FT_Done_Face(font->face);
+	Mem_Free(font);
+}
+
+static void SysFont_ReturnToPool(struct SysFont* font) {
+	int i;
+	/* Evict least recently freed font */
+	if (font_poolCount == SYSFONT_POOL_SIZE) {
+		SysFont_Destroy(font_pool[--font_poolCount]);
+	}
+
+	for (i = font_poolCount; i > 0; i--) font_pool[i] = font_pool[i - 1];
+	font_pool[0] = font;
+	font_poolCount++;
+}
+
 cc_result SysFont_Make(struct FontDesc* desc, const cc_string* fontName, int size, int flags) {
 	struct SysFont* font;
 	cc_string value, path, index;
@@ -748,19 +807,28 @@ cc_result SysFont_Make(struct FontDesc* desc, const cc_string* fontName, int siz
 	String_UNSAFE_Separate(&value, ',', &path, &index);
 	Convert_ParseInt(&index, &faceIndex);
 
+	/* TODO: Use 72 instead of 96 dpi for mobile devices */
+	dpiX = (int)(DisplayInfo.ScaleX * 96);
+	dpiY = (int)(DisplayInfo.ScaleY * 96);
+
+	font = SysFont_TakePooled(&value, size, dpiX, dpiY);
+	if (font) {
+		desc->handle = font;
+		desc->height = TEXT_CEIL(font->face->size->metrics.height);
+		return 0;
+	}
+
 	font = (struct SysFont*)Mem_TryAlloc(1, sizeof(struct SysFont));
 	if (!font) return ERR_OUT_OF_MEMORY;
 
 	InitFreeTypeLibrary();
 	if ((err = SysFont_Init(&path, font, &args))) { Mem_Free(font); return err; }
 	desc->handle = font;
-
-	/* TODO: Use 72 instead of 96 dpi for mobile devices */
-	dpiX = (int)(DisplayInfo.ScaleX * 96);
-	dpiY = (int)(DisplayInfo.ScaleY * 96);
+	font->size   = 0;
 
 	if ((err = FT_New_Face(ft_lib, &args, faceIndex, &font->face)))     return err;
 	if ((err = FT_Set_Char_Size(font->face, size * 64, 0, dpiX, dpiY))) return err;
+	SysFont_SetKey(font, &value, size, dpiX, dpiY);
 
 	/* height of any text when drawn with the given system font */
 	desc->height = TEXT_CEIL(font->face->size->metrics.height);
@@ -802,17 +870,41 @@ void SysFont_MakeDefault(struct FontDesc* desc, int size, int flags) {
 
 void SysFont_Free(struct FontDesc* desc) {
 	struct SysFont* font = (struct SysFont*)desc->handle;
-	FT_Done_Face(font->face);
-	Mem_Free(font);
+	if (font->size) {
+		SysFont_ReturnToPool(font);
+	} else {
+		SysFont_Destroy(font);
+	}
+}
+
+/* Loads and renders the glyph for the given character, then caches it and its advance width */
+static FT_BitmapGlyph SysFont_CacheGlyph(struct SysFont* font, char c, FT_BitmapGlyph* glyphs) {
+	FT_Face face = font->face;
+	FT_Glyph glyph;
+	FT_Error res;
+	cc_unichar uc;
+
+	uc  = Convert_CP437ToUnicode(c);
+	res = FT_Load_Char(face, uc, FT_LOAD_RENDER);
+
+	if (res) {
+		Platform_Log2("Error %e loading glyph for %r", &res, &c);
+		font->widths[(cc_uint8)c] = 0;
+		return NULL;
+	}
+	/* Shadow transform only translates, so doesn't affect advance */
+	font->widths[(cc_uint8)c] = face->glyph->advance.x;
+
+	/* due to FT_LOAD_RENDER, glyph is always a bitmap one */
+	if ((res = FT_Get_Glyph(face->glyph, &glyph))) return NULL;
+	glyphs[(cc_uint8)c] = (FT_BitmapGlyph)glyph;
+	return (FT_BitmapGlyph)glyph;
 }
 
 int SysFont_TextWidth(struct DrawTextArgs* args) {
 	struct SysFont* font = (struct SysFont*)args->font->handle;
-	FT_Face face   = font->face;
 	cc_string text = args->text;
 	int i, width = 0, charWidth;
-	FT_Error res;
-	cc_unichar uc;
 
 	for (i = 0; i < text.length; i++) {
 		char c = text.buffer[i];
@@ -822,18 +914,10 @@ int SysFont_TextWidth(struct DrawTextArgs* args) {
 
 		charWidth = font->widths[(cc_uint8)c];
 		/* need to calculate glyph width */
+		/* (text is usually drawn right after being measured, so render glyph now too) */
 		if (charWidth == UInt16_MaxValue) {
-			uc  = Convert_CP437ToUnicode(c);
-			res = FT_Load_Char(face, uc, 0);
-
-			if (res) {
-				Platform_Log2("Error %e measuring width of %r", &res, &c);
-				charWidth = 0;
-			} else {
-				charWidth = face->glyph->advance.x;		
-			}
-
-			font->widths[(cc_uint8)c] = charWidth;
+			SysFont_CacheGlyph(font, c, font->glyphs);
+			charWidth = font->widths[(cc_uint8)c];
 		}
 		width += charWidth;
 	}
@@ -911,8 +995,6 @@ void SysFont_DrawText(struct DrawTextArgs* args, struct Bitmap* bmp, int x, int
 	FT_BitmapGlyph glyph;
 	FT_Bitmap* img;
 	int i, offset;
-	FT_Error res;
-	cc_unichar uc;
 
 	if (shadow) {
 		glyphs = font->shadow_glyphs;
@@ -935,19 +1017,8 @@ void SysFont_DrawText(struct DrawTextArgs* args, struct Bitmap* bmp, int x, int
 		}
 
 		glyph = glyphs[(cc_uint8)c];
-		if (!glyph) {
-			uc  = Convert_CP437ToUnicode(c);
-			res = FT_Load_Char(face, uc, FT_LOAD_RENDER);
-
-			if (res) {
-				Platform_Log2("Error %e drawing %r", &res, &text.buffer[i]);
-				continue;
-			}
-
-			/* due to FT_LOAD_RENDER, glyph is always a bitmap one */
-			FT_Get_Glyph(face->glyph, (FT_Glyph*)&glyph); /* TODO: Check error */
-			glyphs[(cc_uint8)c] = glyph;
-		}
+		if (!glyph) glyph = SysFont_CacheGlyph(font, c, glyphs);
+		if (!glyph) continue;
 
 		offset = (height + descender) - glyph->top;
 		x += glyph->left; y += offset;
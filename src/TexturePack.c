@@ -16,6 +16,8 @@
 #include "Utils.h"
 #include "Chat.h" /* TODO avoid this include */
 #include "Errors.h"
+#include "MapRenderer.h"
+#define MEM_SUBSYSTEM MEM_SYS_TEXTURES
 
 /* Simple fallback terrain for when no texture packs are available at all */
 static BitmapCol fallback_terrain[16 * 8] = {
@@ -66,6 +68,17 @@ struct _Atlas2DData Atlas2D;
 struct _Atlas1DData Atlas1D;
 int TexturePack_ReqID;
 
+#ifdef CC_BUILD_LOWMEM
+	#define ATLAS1D_DEF_LAZY true
+#else
+	#define ATLAS1D_DEF_LAZY false
+#endif
+/* Whether 1D atlases are only created when they are first bound */
+static cc_bool atlas1D_lazy;
+/* Seconds after which a lazily loaded 1D atlas that isn't bound is evicted (0 = never) */
+static int atlas1D_evictTime;
+static double atlas1D_lastBound[ATLAS1D_MAX_ATLASES];
+
 TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index) {
 	TextureRec rec;
 	int y  = Atlas1D_RowId(texLoc);
@@ -97,8 +110,6 @@ static void Atlas1D_Load(int index, struct Bitmap* atlas1D) {
 	Gfx_RecreateTexture(&Atlas1D.TexIds[index], atlas1D, TEXTURE_FLAG_MANAGED | TEXTURE_FLAG_DYNAMIC, Gfx.Mipmaps);
 }
 
-/* TODO: always do this? */
-#ifdef CC_BUILD_LOWMEM
 static void Atlas1D_LoadBlock(int index) {
 	int tileSize      = Atlas2D.TileSize;
 	int tilesPerAtlas = Atlas1D.TilesPerAtlas;
@@ -114,17 +125,32 @@ static void Atlas1D_LoadBlock(int index) {
 void Atlas1D_Bind(int index) {
 	if (index < Atlas1D.Count && !Atlas1D.TexIds[index])
 		Atlas1D_LoadBlock(index);
+
+	atlas1D_lastBound[index] = Game.Time;
 	Gfx_BindTexture(Atlas1D.TexIds[index]);
 }
 
-static void Atlas_Convert2DTo1D(void) {
-	int tilesPerAtlas = Atlas1D.TilesPerAtlas;
-	int atlasesCount  = Atlas1D.Count;
-	Platform_Log2("Terrain atlas: %i bmps, %i per bmp", &atlasesCount, &tilesPerAtlas);
+int Atlas1D_LoadedCount(void) {
+	int i, count = 0;
+	for (i = 0; i < Atlas1D.Count; i++) 
+	{
+		if (Atlas1D.TexIds[i]) count++;
+	}
+	return count;
 }
-#else
-void Atlas1D_Bind(int index) {
-	Gfx_BindTexture(Atlas1D.TexIds[index]);
+
+static void Atlas1D_EvictTask(struct ScheduledTask* task) {
+	int i;
+	if (!atlas1D_lazy || !atlas1D_evictTime) return;
+
+	for (i = 0; i < Atlas1D.Count; i++) 
+	{
+		if (!Atlas1D.TexIds[i]) continue;
+		if (Game.Time - atlas1D_lastBound[i] < atlas1D_evictTime) continue;
+
+		Platform_Log1("Evicted unused atlas #%i", &i);
+		Gfx_DeleteTexture(&Atlas1D.TexIds[i]);
+	}
 }
 
 static void Atlas_Convert2DTo1D(void) {
@@ -134,6 +160,12 @@ static void Atlas_Convert2DTo1D(void) {
 	struct Bitmap atlas1D;
 	int i;
 
+	/* 1D atlases will be created on demand by Atlas1D_Bind instead */
+	if (atlas1D_lazy) {
+		Platform_Log2("Terrain atlas: %i bmps, %i per bmp", &atlasesCount, &tilesPerAtlas);
+		return;
+	}
+
 	Platform_Log2("Loaded terrain atlas: %i bmps, %i per bmp", &atlasesCount, &tilesPerAtlas);
 	Bitmap_Allocate(&atlas1D, tileSize, tilesPerAtlas * tileSize);
 	
@@ -143,7 +175,6 @@ static void Atlas_Convert2DTo1D(void) {
 	}
 	Mem_Free(atlas1D.scan0);
 }
-#endif
 
 static void Atlas_Update1D(void) {
 	int maxAtlasHeight, maxTilesPerAtlas, maxTiles;
@@ -156,7 +187,7 @@ static void Atlas_Update1D(void) {
 		maxTexHeight     = min(maxTexHeight, maxCurHeight);
 	}
 
-	maxAtlasHeight   = min(4096, maxTexHeight);
+	maxAtlasHeight   = min(ATLAS1D_MAX_HEIGHT, maxTexHeight);
 	maxTilesPerAtlas = maxAtlasHeight / Atlas2D.TileSize;
 	maxTiles         = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
 
@@ -168,6 +199,27 @@ static void Atlas_Update1D(void) {
 	Atlas1D.Shift = Math_ilog2(Atlas1D.TilesPerAtlas);
 }
 
+static cc_bool Atlas2D_IsRowsUniform(int tileX, int tileY) {
+	int size = Atlas2D.TileSize, y;
+	BitmapCol* first = Bitmap_GetRow(&Atlas2D.Bmp, tileY * size) + (tileX * size);
+	BitmapCol* row;
+
+	for (y = 1; y < size; y++) {
+		row = Bitmap_GetRow(&Atlas2D.Bmp, tileY * size + y) + (tileX * size);
+		if (!Mem_Equal(first, row, size * BITMAPCOLOR_SIZE)) return false;
+	}
+	return true;
+}
+
+static void Atlas2D_CalcRowsUniform(void) {
+	int i, tilesCount = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+
+	for (i = 0; i < Array_Elems(Atlas2D.RowsUniform); i++) 
+	{
+		Atlas2D.RowsUniform[i] = i < tilesCount && Atlas2D_IsRowsUniform(Atlas2D_TileX(i), Atlas2D_TileY(i));
+	}
+}
+
 /* Loads the given atlas and converts it into an array of 1D atlases. */
 static void Atlas_Update(struct Bitmap* bmp) {
 	Atlas2D.Bmp       = *bmp;
@@ -175,10 +227,73 @@ static void Atlas_Update(struct Bitmap* bmp) {
 	Atlas2D.RowsCount = bmp->height / Atlas2D.TileSize;
 	Atlas2D.RowsCount = min(Atlas2D.RowsCount, ATLAS2D_MAX_ROWS_COUNT);
 
+	Atlas2D_CalcRowsUniform();
 	Atlas_Update1D();
 	Atlas_Convert2DTo1D();
 }
 
+static cc_bool Atlas2D_TileEquals(struct Bitmap* a, struct Bitmap* b, int tileX, int tileY) {
+	int size = Atlas2D.TileSize, y;
+	int x = tileX * size;
+
+	for (y = tileY * size; y < (tileY + 1) * size; y++) 
+	{
+		if (!Mem_Equal(Bitmap_GetRow(a, y) + x, Bitmap_GetRow(b, y) + x, size * BITMAPCOLOR_SIZE)) return false;
+	}
+	return true;
+}
+
+/* Replaces the current atlas with the given atlas of the same dimensions, */
+/*  only updating the parts of the 1D atlases for tiles that are actually different */
+/* Returns false if the 1D atlases should just be entirely recreated instead */
+static cc_bool Atlas_UpdateChangedTiles(struct Bitmap* bmp) {
+	cc_bool changed[ATLAS2D_TILES_PER_ROW * ATLAS2D_MAX_ROWS_COUNT];
+	int i, x, y, size = Atlas2D.TileSize;
+	int tilesCount, changedCount = 0;
+	struct Bitmap old = Atlas2D.Bmp;
+	struct Bitmap tile;
+	cc_bool uniform, refresh = false;
+	GfxResourceID tex;
+
+	if (!old.scan0 || old.width != bmp->width || old.height != bmp->height) return false;
+	tilesCount = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+
+	for (i = 0; i < tilesCount; i++) 
+	{
+		changed[i]    = !Atlas2D_TileEquals(&old, bmp, Atlas2D_TileX(i), Atlas2D_TileY(i));
+		changedCount += changed[i];
+	}
+	/* Recreating is faster than updating when most of the tiles are different anyways */
+	if (changedCount > tilesCount / 2) return false;
+
+	Atlas2D.Bmp = *bmp;
+	tile.width  = size;
+	tile.height = size;
+
+	for (i = 0; i < tilesCount; i++) 
+	{
+		if (!changed[i]) continue;
+		x = Atlas2D_TileX(i) * size;
+		y = Atlas2D_TileY(i) * size;
+
+		/* Chunk meshes may have merged faces using this tile, if it was uniform before */
+		uniform  = Atlas2D_IsRowsUniform(Atlas2D_TileX(i), Atlas2D_TileY(i));
+		refresh |= Atlas2D.RowsUniform[i] && !uniform;
+		Atlas2D.RowsUniform[i] = uniform;
+
+		/* NOTE: 1D atlas might not have been lazily loaded yet (see Atlas1D_Bind) */
+		tile.scan0 = Bitmap_GetRow(bmp, y) + x;
+		tex = Atlas1D.TexIds[Atlas1D_Index(i)];
+		if (tex) Gfx_UpdateTexture(tex, 0, Atlas1D_RowId(i) * size, &tile, bmp->width, Gfx.Mipmaps);
+	}
+
+	if (old.scan0 != fallback_terrain) Mem_Free(old.scan0);
+	if (refresh) MapRenderer_Refresh();
+
+	Platform_Log2("Updated terrain atlas: %i of %i tiles changed", &changedCount, &tilesCount);
+	return true;
+}
+
 GfxResourceID Atlas2D_LoadTile(TextureLoc texLoc) {
 	int size = Atlas2D.TileSize;
 	struct Bitmap tile;
@@ -245,10 +360,12 @@ cc_bool Atlas_TryChange(struct Bitmap* atlas) {
 	}
 
 	if (Gfx.LostContext) return false;
-	Atlas1D_Free();
-	Atlas2D_Free();
 
-	Atlas_Update(atlas);
+	if (!Atlas_UpdateChangedTiles(atlas)) {
+		Atlas1D_Free();
+		Atlas2D_Free();
+		Atlas_Update(atlas);
+	}
 	Event_RaiseVoid(&TextureEvents.AtlasChanged);
 	return true;
 }
@@ -358,11 +475,11 @@ static cc_bool OpenCachedData(const cc_string* url, struct Stream* stream) {
 	
 
 	MakeCachePath(&mainPath, &altPath, url);
-	res = Stream_OpenFile(stream, &mainPath);
+	res = Stream_OpenBufferedFile(stream, &mainPath);
 
 	/* try fallback cache if can't find in main cache */
 	if (res == ReturnCode_FileNotFound && altPath.length)
-		res = Stream_OpenFile(stream, &altPath);
+		res = Stream_OpenBufferedFile(stream, &altPath);
 
 	if (res == ReturnCode_FileNotFound) return false;
 	if (res) { Logger_SysWarn2(res, "opening cache for", url); return false; }
@@ -406,7 +523,7 @@ CC_NOINLINE static void SetCachedTag(const cc_string* url, struct StringsBuffer*
 }
 
 /* Updates cached data, ETag, and Last-Modified for the given URL */
-static void UpdateCache(struct HttpRequest* req) {
+static cc_result UpdateCache(struct HttpRequest* req) {
 	cc_string url, altPath, value;
 	cc_string path; char pathBuffer[FILENAME_SIZE];
 	cc_result res;
@@ -423,6 +540,697 @@ static void UpdateCache(struct HttpRequest* req) {
 
 	res = Stream_WriteAllTo(&path, req->data, req->size);
 	if (res) { Logger_SysWarn2(res, "caching", &url); }
+	return res;
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Texture cache index---------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_FILERENAME
+/* Tracks the size and last access time of each cached texture pack, so that the least recently used */
+/*  texture packs can be deleted once the texture cache grows beyond its size limit */
+/* NOTE: Only last access times are saved to the index, as sizes are found by scanning the cache folders */
+/*  on a worker thread at startup (which also picks up texture packs cached by older game versions) */
+#define INDEX_TXT "texturecache/cacheindex.txt"
+#define INDEX_SAVE_INTERVAL 30
+
+struct CacheIndexEntry { cc_uint32 key, rawSize, decodedSize, lastAccess; cc_bool used; };
+struct CacheIndex { struct CacheIndexEntry* entries; int capacity, count; cc_uint64 totalSize; };
+
+static struct CacheIndex cacheIndex;
+static cc_bool cacheIndexLoaded, cacheIndexDirty, cacheIndexSaving, cacheEvicting;
+static cc_uint64 cacheIndexLimit; /* Max total size of cached texture packs in bytes, 0 for no limit */
+
+#define CacheIndex_Key(url) Utils_CRC32((const cc_uint8*)(url)->buffer, (url)->length)
+#define CacheIndex_Size(e) ((cc_uint64)(e)->rawSize + (e)->decodedSize)
+/* Minutes since 01/01/0001 */
+#define CacheIndex_Now() ((cc_uint32)(DateTime_CurrentUTC() / (60 * 1000)))
+
+static void CacheIndex_Free(struct CacheIndex* index) {
+	Mem_Free(index->entries);
+	index->entries   = NULL;
+	index->capacity  = 0;
+	index->count     = 0;
+	index->totalSize = 0;
+}
+
+static struct CacheIndexEntry* CacheIndex_Get(struct CacheIndex* index, cc_uint32 key, cc_bool add);
+/* Doubles capacity of the hash table (which is always a power of two) */
+static void CacheIndex_Grow(struct CacheIndex* index) {
+	struct CacheIndex old = *index;
+	struct CacheIndexEntry* e;
+	int i;
+
+	index->capacity = old.capacity ? old.capacity * 2 : 64;
+	index->entries  = (struct CacheIndexEntry*)Mem_AllocCleared(index->capacity, sizeof(struct CacheIndexEntry), "texture cache index");
+	index->count    = 0;
+
+	for (i = 0; i < old.capacity; i++)
+	{
+		if (!old.entries[i].used) continue;
+		e  = CacheIndex_Get(index, old.entries[i].key, true);
+		*e = old.entries[i];
+	}
+	Mem_Free(old.entries);
+}
+
+/* Returns the entry for the given key, adding a new entry for it when add is true */
+/* NOTE: Entries are looked up using linear probing */
+static struct CacheIndexEntry* CacheIndex_Get(struct CacheIndex* index, cc_uint32 key, cc_bool add) {
+	struct CacheIndexEntry* e;
+	int i, mask;
+	/* Keep hash table at most half full, so that probe sequences stay short */
+	if (add && (index->count + 1) * 2 > index->capacity) CacheIndex_Grow(index);
+	if (!index->capacity) return NULL;
+	mask = index->capacity - 1;
+
+	for (i = (key * 2654435761U) & mask; ; i = (i + 1) & mask) 
+	{
+		e = &index->entries[i];
+		if (e->used && e->key == key) return e;
+		if (e->used) continue;
+		if (!add)    return NULL;
+
+		Mem_Set(e, 0, sizeof(*e));
+		e->used = true;
+		e->key  = key;
+		index->count++;
+		return e;
+	}
+}
+
+/* Rebuilds the hash table, dropping entries which have been marked as unused */
+/* NOTE: Entries can't simply be marked as unused, as that would break probe sequences for other keys */
+static void CacheIndex_Rebuild(struct CacheIndex* index) {
+	struct CacheIndex old = *index;
+	struct CacheIndexEntry* e;
+	int i;
+
+	index->entries   = NULL;
+	index->capacity  = 0;
+	index->count     = 0;
+	index->totalSize = 0;
+
+	for (i = 0; i < old.capacity; i++)
+	{
+		if (!old.entries[i].used) continue;
+		e  = CacheIndex_Get(index, old.entries[i].key, true);
+		*e = old.entries[i];
+		index->totalSize += CacheIndex_Size(e);
+	}
+	Mem_Free(old.entries);
+}
+
+static void CacheIndex_CheckLimit(void);
+/* Records that the cached texture pack for the given URL has just been used */
+static void CacheIndex_Touch(const cc_string* url);
+
+/* Updates the size of one of the cached files for the given URL */
+static void CacheIndex_SetSize(const cc_string* url, cc_uint32 size, cc_bool decoded) {
+	struct CacheIndexEntry* e = CacheIndex_Get(&cacheIndex, CacheIndex_Key(url), true);
+	cacheIndex.totalSize -= CacheIndex_Size(e);
+
+	if (decoded) { e->decodedSize = size; } else { e->rawSize = size; }
+	cacheIndex.totalSize += CacheIndex_Size(e);
+	CacheIndex_Touch(url);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Cache index loading---------------------------------------------------*
+*#########################################################################################################################*/
+static struct CacheLoadJob {
+	struct GameJob job;
+	struct CacheIndex index;
+	cc_string cacheDir; char cacheDirBuffer[FILENAME_SIZE];
+} cacheLoadJob;
+
+static void CacheLoad_ReadIndex(struct CacheIndex* index) {
+	cc_string line; char lineBuffer[STRING_SIZE];
+	cc_string key, value;
+	cc_uint64 rawKey, lastAccess;
+	struct CacheIndexEntry* e;
+	struct Stream stream;
+	cc_string path = String_FromReadonly(INDEX_TXT);
+	cc_result res;
+
+	res = Stream_OpenBufferedFile(&stream, &path);
+	if (res) return;
+	String_InitArray(line, lineBuffer);
+
+	for (;;) 
+	{
+		res = Stream_ReadLine(&stream, &line);
+		if (res) break;
+		if (!String_UNSAFE_Separate(&line, ' ', &key, &value)) continue;
+
+		if (!Convert_ParseUInt64(&key, &rawKey) || rawKey > 0xFFFFFFFFUL) continue;
+		if (!Convert_ParseUInt64(&value, &lastAccess) || lastAccess > 0xFFFFFFFFUL) continue;
+
+		e = CacheIndex_Get(index, (cc_uint32)rawKey, true);
+		e->lastAccess = (cc_uint32)lastAccess;
+	}
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+}
+
+/* Adds the size of a "<key>" or "<key>.decoded" cache file to its entry */
+static void CacheLoad_AddFile(const cc_string* path, void* obj, int isDirectory) {
+	struct CacheIndex* index = (struct CacheIndex*)obj;
+	static const cc_string decoded = String_FromConst("decoded");
+	cc_string name = *path, key, ext;
+	struct CacheIndexEntry* e;
+	cc_uint64 rawKey;
+	cc_uint32 size;
+	cc_filepath str;
+	cc_file file;
+	cc_bool isDecoded;
+	if (isDirectory) return;
+
+	Utils_UNSAFE_GetFilename(&name);
+	isDecoded = String_UNSAFE_Separate(&name, '.', &key, &ext);
+	if (!isDecoded) key = name;
+	if (isDecoded && !String_Equals(&ext, &decoded)) return;
+	if (!Convert_ParseUInt64(&key, &rawKey) || rawKey > 0xFFFFFFFFUL) return;
+
+	Platform_EncodePath(&str, path);
+	if (File_Open(&file, &str)) return;
+	if (File_Length(file, &size)) size = 0;
+	(void)File_Close(file);
+
+	e = CacheIndex_Get(index, (cc_uint32)rawKey, true);
+	if (isDecoded) { e->decodedSize = size; } else { e->rawSize = size; }
+}
+
+static void CacheLoad_Run(struct GameJob* job) {
+	struct CacheLoadJob* load = (struct CacheLoadJob*)job;
+	cc_string dir = String_FromReadonly("texturecache");
+	int i;
+
+	CacheLoad_ReadIndex(&load->index);
+	(void)Directory_Enum(&dir, &load->index, CacheLoad_AddFile);
+	if (load->cacheDir.length) (void)Directory_Enum(&load->cacheDir, &load->index, CacheLoad_AddFile);
+
+	/* Forget about texture packs which are no longer cached */
+	for (i = 0; i < load->index.capacity; i++)
+	{
+		if (CacheIndex_Size(&load->index.entries[i])) continue;
+		load->index.entries[i].used = false;
+	}
+	CacheIndex_Rebuild(&load->index);
+}
+
+static void CacheLoad_Finish(struct GameJob* job) {
+	struct CacheLoadJob* load = (struct CacheLoadJob*)job;
+	struct CacheIndexEntry* src;
+	struct CacheIndexEntry* dst;
+	int i;
+
+	if (job->cancelled) { CacheIndex_Free(&load->index); return; }
+	/* Texture packs may have been cached or used while the index was being loaded */
+	for (i = 0; i < load->index.capacity; i++)
+	{
+		src = &load->index.entries[i];
+		if (!src->used) continue;
+		dst = CacheIndex_Get(&cacheIndex, src->key, true);
+
+		if (!dst->rawSize)     dst->rawSize     = src->rawSize;
+		if (!dst->decodedSize) dst->decodedSize = src->decodedSize;
+		dst->lastAccess = max(dst->lastAccess, src->lastAccess);
+	}
+
+	CacheIndex_Free(&load->index);
+	CacheIndex_Rebuild(&cacheIndex);
+	cacheIndexLoaded = true;
+	CacheIndex_CheckLimit();
+}
+
+static void CacheIndex_Load(void) {
+	struct CacheLoadJob* load = &cacheLoadJob;
+	String_InitArray(load->cacheDir, load->cacheDirBuffer);
+
+	Directory_GetCachePath(&load->cacheDir);
+	if (load->cacheDir.length) String_AppendConst(&load->cacheDir, "/texturecache");
+
+	load->job.Run    = CacheLoad_Run;
+	load->job.Finish = CacheLoad_Finish;
+	Game_QueueJob(&load->job);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Cache index saving----------------------------------------------------*
+*#########################################################################################################################*/
+#define INDEX_LINE_SIZE (STRING_INT_CHARS * 2 + 3)
+
+static struct CacheSaveJob {
+	struct GameJob job;
+	cc_string data;
+	cc_result res;
+} cacheSaveJob;
+
+/* Formats the index into a "<key> <last access>" line for each entry */
+static cc_bool CacheIndex_Format(cc_string* data) {
+	struct CacheIndexEntry* e;
+	char* buffer;
+	int i, capacity;
+
+	capacity = (cacheIndex.count + 1) * INDEX_LINE_SIZE;
+	buffer   = (char*)Mem_TryAlloc(capacity, 1);
+	if (!buffer) return false;
+	*data = String_Init(buffer, 0, capacity);
+
+	for (i = 0; i < cacheIndex.capacity; i++)
+	{
+		e = &cacheIndex.entries[i];
+		if (!e->used) continue;
+
+		String_AppendUInt32(data, e->key);
+		String_Append(data, ' ');
+		String_AppendUInt32(data, e->lastAccess);
+		String_AppendConst(data, "\r\n");
+	}
+	return true;
+}
+
+static void CacheSave_Run(struct GameJob* job) {
+	struct CacheSaveJob* save = (struct CacheSaveJob*)job;
+	cc_string path = String_FromReadonly(INDEX_TXT);
+	save->res = Stream_WriteAllTo(&path, (cc_uint8*)save->data.buffer, save->data.length);
+}
+
+static void CacheSave_Finish(struct GameJob* job) {
+	struct CacheSaveJob* save = (struct CacheSaveJob*)job;
+	static const cc_string path = String_FromConst(INDEX_TXT);
+
+	if (job->cancelled) {
+		cacheIndexDirty = true;
+	} else if (save->res) {
+		cacheIndexDirty = true;
+		Logger_SysWarn2(save->res, "saving", &path);
+	}
+	Mem_Free(save->data.buffer);
+	cacheIndexSaving = false;
+}
+
+static void CacheIndex_SaveTask(struct ScheduledTask* task) {
+	if (!cacheIndexDirty || !cacheIndexLoaded || cacheIndexSaving) return;
+	if (!CacheIndex_Format(&cacheSaveJob.data)) return;
+
+	cacheIndexDirty  = false;
+	cacheIndexSaving = true;
+	cacheSaveJob.job.Run    = CacheSave_Run;
+	cacheSaveJob.job.Finish = CacheSave_Finish;
+	Game_QueueJob(&cacheSaveJob.job);
+}
+
+/* Saves the index immediately if it has unsaved changes */
+static void CacheIndex_SaveNow(void) {
+	static const cc_string path = String_FromConst(INDEX_TXT);
+	cc_string data;
+	cc_result res;
+	if (!cacheIndexDirty || !cacheIndexLoaded || !CacheIndex_Format(&data)) return;
+
+	res = Stream_WriteAllTo(&path, (cc_uint8*)data.buffer, data.length);
+	if (res) Logger_SysWarn2(res, "saving", &path);
+	Mem_Free(data.buffer);
+	cacheIndexDirty = false;
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Cache index eviction---------------------------------------------------*
+*#########################################################################################################################*/
+struct CacheVictim { cc_uint32 key; volatile cc_bool spared; };
+
+static struct CacheEvictJob {
+	struct GameJob job;
+	struct CacheVictim* victims;
+	int count;
+	cc_string cacheDir; char cacheDirBuffer[FILENAME_SIZE];
+} cacheEvictJob;
+
+static void CacheEvict_DeleteFile(const cc_string* dir, cc_uint32 key, cc_bool decoded) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_filepath str;
+	String_InitArray(path, pathBuffer);
+
+	String_Format1(&path, "%s/", dir);
+	String_AppendUInt32(&path, key);
+	if (decoded) String_AppendConst(&path, ".decoded");
+
+	Platform_EncodePath(&str, &path);
+	(void)File_Delete(&str);
+}
+
+static void CacheEvict_Run(struct GameJob* job) {
+	struct CacheEvictJob* evict = (struct CacheEvictJob*)job;
+	cc_string dir = String_FromReadonly("texturecache");
+	cc_uint32 key;
+	int i;
+
+	for (i = 0; i < evict->count; i++)
+	{
+		/* Texture pack may have been used again after eviction was started */
+		if (evict->victims[i].spared) continue;
+		key = evict->victims[i].key;
+
+		CacheEvict_DeleteFile(&dir, key, false);
+		CacheEvict_DeleteFile(&dir, key, true);
+		if (!evict->cacheDir.length) continue;
+
+		CacheEvict_DeleteFile(&evict->cacheDir, key, false);
+		CacheEvict_DeleteFile(&evict->cacheDir, key, true);
+	}
+}
+
+static void CacheEvict_Finish(struct GameJob* job) {
+	struct CacheEvictJob* evict = (struct CacheEvictJob*)job;
+	cc_string key; char keyBuffer[STRING_INT_CHARS];
+	struct CacheIndexEntry* e;
+	int i;
+
+	for (i = 0; !job->cancelled && i < evict->count; i++)
+	{
+		if (evict->victims[i].spared) continue;
+		e = CacheIndex_Get(&cacheIndex, evict->victims[i].key, false);
+		if (e) e->used = false;
+
+		String_InitArray(key, keyBuffer);
+		String_AppendUInt32(&key, evict->victims[i].key);
+		EntryList_Remove(&etagCache,    &key, ' ');
+		EntryList_Remove(&lastModCache, &key, ' ');
+	}
+
+	if (!job->cancelled) {
+		CacheIndex_Rebuild(&cacheIndex);
+		EntryList_Save(&etagCache,    ETAGS_TXT);
+		EntryList_Save(&lastModCache, LASTMOD_TXT);
+		cacheIndexDirty = true;
+	}
+
+	Mem_Free(evict->victims);
+	evict->victims = NULL;
+	cacheEvicting  = false;
+}
+
+static struct CacheIndexEntry** evict_entries;
+static void CacheEvict_QuickSort(int left, int right) {
+	struct CacheIndexEntry** keys = evict_entries; struct CacheIndexEntry* key;
+
+	while (left < right) {
+		int i = left, j = right;
+		cc_uint32 pivot = keys[(i + j) >> 1]->lastAccess;
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i]->lastAccess) i++;
+			while (pivot < keys[j]->lastAccess) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(CacheEvict_QuickSort);
+	}
+}
+
+/* Starts deleting the least recently used texture packs when the cache is over its size limit */
+static void CacheIndex_CheckLimit(void) {
+	struct CacheEvictJob* evict = &cacheEvictJob;
+	struct CacheIndexEntry* e;
+	cc_uint64 size, target;
+	cc_uint32 curKey;
+	int i, count;
+
+	if (!cacheIndexLimit || !cacheIndexLoaded || cacheEvicting) return;
+	if (cacheIndex.totalSize <= cacheIndexLimit) return;
+
+	evict_entries = (struct CacheIndexEntry**)Mem_TryAlloc(cacheIndex.count, sizeof(struct CacheIndexEntry*));
+	if (!evict_entries) return;
+	evict->victims = (struct CacheVictim*)Mem_TryAlloc(cacheIndex.count, sizeof(struct CacheVictim));
+	if (!evict->victims) { Mem_Free(evict_entries); return; }
+
+	/* Never delete the texture pack currently in use */
+	curKey = CacheIndex_Key(&TexturePack_Url);
+	for (i = 0, count = 0; i < cacheIndex.capacity; i++)
+	{
+		e = &cacheIndex.entries[i];
+		if (!e->used || (TexturePack_Url.length && e->key == curKey)) continue;
+		evict_entries[count++] = e;
+	}
+	if (count) CacheEvict_QuickSort(0, count - 1);
+
+	/* Delete down to below the limit, so that eviction doesn't need to happen again straight away */
+	size   = cacheIndex.totalSize;
+	target = cacheIndexLimit / 4 * 3;
+	for (i = 0; i < count && size > target; i++)
+	{
+		evict->victims[i].key    = evict_entries[i]->key;
+		evict->victims[i].spared = false;
+		size -= CacheIndex_Size(evict_entries[i]);
+	}
+
+	Mem_Free(evict_entries);
+	evict_entries = NULL;
+	evict->count  = i;
+	if (!evict->count) { Mem_Free(evict->victims); evict->victims = NULL; return; }
+
+	String_InitArray(evict->cacheDir, evict->cacheDirBuffer);
+	Directory_GetCachePath(&evict->cacheDir);
+	if (evict->cacheDir.length) String_AppendConst(&evict->cacheDir, "/texturecache");
+
+	cacheEvicting    = true;
+	evict->job.Run    = CacheEvict_Run;
+	evict->job.Finish = CacheEvict_Finish;
+	Game_QueueJob(&evict->job);
+}
+
+static void CacheIndex_Touch(const cc_string* url) {
+	struct CacheIndexEntry* e;
+	cc_uint32 key;
+	int i;
+	if (Platform_ReadonlyFilesystem || !url->length) return;
+
+	key = CacheIndex_Key(url);
+	e   = CacheIndex_Get(&cacheIndex, key, true);
+	e->lastAccess   = CacheIndex_Now();
+	cacheIndexDirty = true;
+
+	for (i = 0; cacheEvicting && i < cacheEvictJob.count; i++)
+	{
+		if (cacheEvictJob.victims[i].key == key) cacheEvictJob.victims[i].spared = true;
+	}
+	CacheIndex_CheckLimit();
+}
+
+static void CacheIndex_Init(void) {
+	int limit;
+	if (Platform_ReadonlyFilesystem) return;
+
+	limit = Options_GetInt(OPT_TEXCACHE_MAX_SIZE, 0, 1024 * 1024, 256);
+	cacheIndexLimit = (cc_uint64)limit * 1024 * 1024;
+
+	CacheIndex_Load();
+	ScheduledTask_SetLimits(ScheduledTask_Add(INDEX_SAVE_INTERVAL, CacheIndex_SaveTask), 1, 0);
+}
+
+static void CacheIndex_Shutdown(void) {
+	CacheIndex_SaveNow();
+	CacheIndex_Free(&cacheIndex);
+	cacheIndexLoaded = false;
+	cacheIndexDirty  = false;
+}
+#else
+static void CacheIndex_SetSize(const cc_string* url, cc_uint32 size, cc_bool decoded) { }
+static void CacheIndex_Touch(const cc_string* url) { }
+static void CacheIndex_Init(void) { }
+static void CacheIndex_Shutdown(void) { }
+#endif
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Decoded texture cache--------------------------------------------------*
+*#########################################################################################################################*/
+/* The decompressed entries of a cached texture pack are also cached, with PNGs already decoded into their pixels */
+/*  so that reapplying an unchanged texture pack (i.e. same ETag) can skip decompressing and decoding it again */
+#define DECODED_MAGIC       0x43434454UL /* "CCDT" */
+#define DECODED_VERSION     1
+#define DECODED_HEADER_SIZE 17
+#define DECODED_MAX_NAME    255
+#define DECODED_MAX_DIM     16384
+#define DECODED_ENTRY_RAW 0
+#define DECODED_ENTRY_BMP 1
+
+static const cc_string* decoded_url;
+static struct Stream decoded_out;
+static cc_bool decoded_opened;
+static cc_result decoded_res;
+static cc_uint32 decoded_count;
+static cc_uint32 decoded_size;
+
+static void MakeDecodedCachePath(cc_string* path, const cc_string* url) {
+	cc_string altPath = String_Empty;
+	MakeCachePath(path, &altPath, url);
+	String_AppendConst(path, ".decoded");
+}
+
+/* Starts writing the entries of the texture pack about to be extracted for the given URL to the decoded cache */
+static void DecodedCache_Begin(const cc_string* url) {
+	cc_string etag = GetCachedETag(url);
+	decoded_url    = NULL;
+	if (Platform_ReadonlyFilesystem || !etag.length || etag.length > DECODED_MAX_NAME) return;
+
+	decoded_url    = url;
+	decoded_opened = false;
+	decoded_res    = 0;
+	decoded_count  = 0;
+}
+
+static cc_result DecodedCache_Open(void) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8 header[DECODED_HEADER_SIZE + DECODED_MAX_NAME];
+	cc_string etag = GetCachedETag(decoded_url);
+	cc_result res;
+
+	String_InitArray(path, pathBuffer);
+	MakeDecodedCachePath(&path, decoded_url);
+	if ((res = Stream_CreateFile(&decoded_out, &path))) return res;
+	decoded_opened = true;
+
+	/* Number of entries is only filled in after all entries have been written, */
+	/*  so that an incompletely written cache is never mistaken for a valid one */
+	Stream_SetU32_LE(header +  0, DECODED_MAGIC);
+	Stream_SetU32_LE(header +  4, DECODED_VERSION);
+	Stream_SetU32_LE(header +  8, BitmapCol_Make(1, 2, 3, 4));
+	Stream_SetU32_LE(header + 12, 0);
+	header[16] = etag.length;
+
+	Mem_Copy(header + DECODED_HEADER_SIZE, etag.buffer, etag.length);
+	decoded_size = DECODED_HEADER_SIZE + etag.length;
+	return Stream_Write(&decoded_out, header, DECODED_HEADER_SIZE + etag.length);
+}
+
+/* Writes the given texture pack entry to the decoded cache, if one is being written */
+/* NOTE: data must be a memory stream (e.g. from Stream_ReadonlyMemory), even when bmp is non-NULL */
+static void DecodedCache_Add(const cc_string* name, struct Stream* data, struct Bitmap* bmp) {
+	cc_uint8 header[2 + DECODED_MAX_NAME + 8];
+	int len = name->length;
+	cc_result res;
+
+	if (!decoded_url || decoded_res) return;
+	if (len > DECODED_MAX_NAME) { decoded_res = ERR_INVALID_ARGUMENT; return; }
+	if (!decoded_opened && (res = DecodedCache_Open())) { decoded_res = res; return; }
+
+	header[0] = bmp ? DECODED_ENTRY_BMP : DECODED_ENTRY_RAW;
+	header[1] = len;
+	Mem_Copy(header + 2, name->buffer, len);
+
+	if (bmp) {
+		Stream_SetU32_LE(header + 2 + len, bmp->width);
+		Stream_SetU32_LE(header + 6 + len, bmp->height);
+
+		res = Stream_Write(&decoded_out, header, 10 + len);
+		if (!res) res = Stream_Write(&decoded_out, (cc_uint8*)bmp->scan0,
+									Bitmap_DataSize(bmp->width, bmp->height));
+		decoded_size += 10 + len + Bitmap_DataSize(bmp->width, bmp->height);
+	} else {
+		Stream_SetU32_LE(header + 2 + len, data->meta.mem.length);
+
+		res = Stream_Write(&decoded_out, header, 6 + len);
+		if (!res) res = Stream_Write(&decoded_out, data->meta.mem.base, data->meta.mem.length);
+		decoded_size += 6 + len + data->meta.mem.length;
+	}
+
+	decoded_res = res;
+	decoded_count++;
+}
+
+/* Finishes writing the decoded cache, which is only marked as valid if the texture pack was fully extracted */
+static void DecodedCache_End(cc_result extractRes) {
+	const cc_string* url = decoded_url;
+	cc_uint8 count[4];
+	cc_result res;
+
+	decoded_url = NULL;
+	if (!url || !decoded_opened) return;
+	res = decoded_res;
+
+	if (!res && !extractRes) {
+		Stream_SetU32_LE(count, decoded_count);
+		res = decoded_out.Seek(&decoded_out, 12);
+		if (!res) res = Stream_Write(&decoded_out, count, 4);
+	}
+
+	if (!res) {
+		res = decoded_out.Close(&decoded_out);
+	} else {
+		(void)decoded_out.Close(&decoded_out);
+	}
+	if (res) Logger_SysWarn2(res, "writing decoded cache for", url);
+	if (!res && !extractRes) CacheIndex_SetSize(url, decoded_size, true);
+}
+
+static cc_bool DecodedCache_CheckHeader(struct Stream* s, const cc_string* etag, cc_uint32* count) {
+	cc_uint8 header[DECODED_HEADER_SIZE + DECODED_MAX_NAME];
+	cc_string tag;
+
+	if (Stream_Read(s, header, DECODED_HEADER_SIZE)) return false;
+	if (Stream_GetU32_LE(header + 0) != DECODED_MAGIC)   return false;
+	if (Stream_GetU32_LE(header + 4) != DECODED_VERSION) return false;
+	if (Stream_GetU32_LE(header + 8) != BitmapCol_Make(1, 2, 3, 4)) return false;
+
+	/* Cached texture pack may have been updated since the decoded cache was written */
+	*count = Stream_GetU32_LE(header + 12);
+	if (!(*count) || header[16] != etag->length) return false;
+	if (Stream_Read(s, header + DECODED_HEADER_SIZE, etag->length)) return false;
+
+	tag = String_Init((char*)header + DECODED_HEADER_SIZE, etag->length, etag->length);
+	return String_Equals(&tag, etag);
+}
+
+static cc_result DecodedCache_ReadEntry(struct Stream* s) {
+	char nameBuffer[DECODED_MAX_NAME];
+	cc_uint32 width, height, size;
+	cc_uint8 tmp[8];
+	struct Stream data;
+	struct Bitmap bmp;
+	cc_uint8* raw;
+	cc_string name;
+	cc_result res;
+
+	if ((res = Stream_Read(s, tmp, 2)))                          return res;
+	if ((res = Stream_Read(s, (cc_uint8*)nameBuffer, tmp[1]))) return res;
+	name = String_Init(nameBuffer, tmp[1], tmp[1]);
+
+	if (tmp[0] == DECODED_ENTRY_BMP) {
+		if ((res = Stream_Read(s, tmp, 8))) return res;
+		width  = Stream_GetU32_LE(tmp + 0);
+		height = Stream_GetU32_LE(tmp + 4);
+		if (!width || !height || width > DECODED_MAX_DIM || height > DECODED_MAX_DIM) return ERR_INVALID_ARGUMENT;
+
+		Bitmap_TryAllocate(&bmp, width, height);
+		if (!bmp.scan0) return ERR_OUT_OF_MEMORY;
+		res = Stream_Read(s, (cc_uint8*)bmp.scan0, Bitmap_DataSize(width, height));
+		if (res) { Mem_Free(bmp.scan0); return res; }
+
+		Stream_ReadonlyMemory(&data, NULL, 0);
+		Png_SetDecoded(&data, &bmp);
+		Event_RaiseEntry(&TextureEvents.FileChanged, &data, &name);
+		Png_SetDecoded(NULL, NULL);
+	} else {
+		if ((res = Stream_Read(s, tmp, 4))) return res;
+		size = Stream_GetU32_LE(tmp);
+
+		raw = (cc_uint8*)Mem_TryAlloc(size, 1);
+		if (size && !raw) return ERR_OUT_OF_MEMORY;
+		res = Stream_Read(s, raw, size);
+		if (res) { Mem_Free(raw); return res; }
+
+		Stream_ReadonlyMemory(&data, raw, size);
+		Event_RaiseEntry(&TextureEvents.FileChanged, &data, &name);
+		Mem_Free(raw);
+	}
+	return 0;
 }
 
 
@@ -463,13 +1271,74 @@ cc_result TexturePack_ExtractDefault(DefaultZipCallback callback) {
 
 
 static cc_bool SelectZipEntry(const cc_string* path) { return true; }
-static cc_result ProcessZipEntry(const cc_string* path, struct Stream* stream, struct ZipEntry* source) {
-	cc_string name = *path;
+static void* DecodeZipEntry(const cc_string* path, struct Stream* data) {
+	static const cc_string png = String_FromConst(".png");
+	struct Bitmap* bmp;
+	if (!String_CaselessEnds(path, &png)) return NULL;
+
+	bmp = (struct Bitmap*)Mem_TryAlloc(1, sizeof(struct Bitmap));
+	if (!bmp) return NULL;
+	if (!Png_Decode(bmp, data)) return bmp;
+
+	/* Let the main thread decode the image again, so it logs the error */
+	Mem_Free(bmp->scan0);
+	Mem_Free(bmp);
+	return NULL;
+}
+
+static cc_result ProcessDecodedEntry(const cc_string* path, struct Stream* data, void* decoded) {
+	struct Bitmap* bmp = (struct Bitmap*)decoded;
+	cc_string name     = *path;
 	Utils_UNSAFE_GetFilename(&name);
-	Event_RaiseEntry(&TextureEvents.FileChanged, stream, &name);
+	DecodedCache_Add(&name, data, bmp);
+
+	if (bmp) { Png_SetDecoded(data, bmp); Mem_Free(bmp); }
+	Event_RaiseEntry(&TextureEvents.FileChanged, data, &name);
+	if (bmp) Png_SetDecoded(NULL, NULL);
 	return 0;
 }
 
+#ifdef CC_BUILD_ZIPWORKERS
+static void FreeDecodedEntry(void* decoded) {
+	struct Bitmap* bmp = (struct Bitmap*)decoded;
+	Mem_Free(bmp->scan0);
+	Mem_Free(bmp);
+}
+#else
+static cc_result ProcessZipEntry(const cc_string* path, struct Stream* stream, struct ZipEntry* source) {
+	cc_uint32 size = source->UncompressedSize;
+	cc_string name = *path;
+	struct Stream mem;
+	cc_uint8* data;
+	void* decoded;
+	cc_result res;
+
+	/* Entry needs to be entirely in memory to also be written to the decoded cache */
+	data = NULL;
+	if (decoded_url && !decoded_res) {
+		data = (cc_uint8*)Mem_TryAlloc(size, 1);
+		if (size && !data) decoded_res = ERR_OUT_OF_MEMORY;
+	}
+
+	if (!decoded_url || decoded_res) {
+		Utils_UNSAFE_GetFilename(&name);
+		Event_RaiseEntry(&TextureEvents.FileChanged, stream, &name);
+		return 0;
+	}
+
+	res = Stream_Read(stream, data, size);
+	if (res) { Mem_Free(data); return res; }
+
+	Stream_ReadonlyMemory(&mem, data, size);
+	decoded = DecodeZipEntry(path, &mem);
+	Stream_ReadonlyMemory(&mem, data, size);
+
+	res = ProcessDecodedEntry(path, &mem, decoded);
+	Mem_Free(data);
+	return res;
+}
+#endif
+
 static cc_result ExtractPng(struct Stream* stream) {
 	struct Bitmap bmp;
 	cc_result res = Png_Decode(&bmp, stream);
@@ -493,8 +1362,13 @@ static cc_result ExtractFrom(struct Stream* stream, const cc_string* path) {
 	res = ExtractPng(stream);
 	if (res == PNG_ERR_INVALID_SIG) {
 		/* file isn't a .png image, probably a .zip archive then */
+#ifdef CC_BUILD_ZIPWORKERS
+		res = Zip_ExtractParallel(stream, SelectZipEntry, DecodeZipEntry,
+							FreeDecodedEntry, ProcessDecodedEntry, entries, Array_Elems(entries));
+#else
 		res = Zip_Extract(stream, SelectZipEntry, ProcessZipEntry,
 							entries, Array_Elems(entries));
+#endif
 
 		if (res) Logger_SysWarn2(res, "extracting", path);
 	} else if (res) {
@@ -503,6 +1377,50 @@ static cc_result ExtractFrom(struct Stream* stream, const cc_string* path) {
 	return res;
 }
 
+/* Attempts to extract the texture pack for the given URL from the decoded cache */
+/* Returns false if there is no decoded cache for the currently cached version of the texture pack */
+static cc_bool ExtractDecodedCache(const cc_string* url) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_string etag = GetCachedETag(url);
+	struct Stream stream;
+	cc_uint32 i, count;
+	cc_result res;
+
+	/* Let ExtractFrom defer loading the texture pack instead */
+	if (!etag.length || Gfx.LostContext) return false;
+	String_InitArray(path, pathBuffer);
+	MakeDecodedCachePath(&path, url);
+
+	res = Stream_OpenBufferedFile(&stream, &path);
+	if (res == ReturnCode_FileNotFound) return false;
+	if (res) { Logger_SysWarn2(res, "opening decoded cache for", url); return false; }
+
+	if (DecodedCache_CheckHeader(&stream, &etag, &count)) {
+		Event_RaiseVoid(&TextureEvents.PackChanged);
+		needReload = false;
+
+		for (i = 0; i < count && !res; i++)
+		{
+			res = DecodedCache_ReadEntry(&stream);
+		}
+		if (res) Logger_SysWarn2(res, "reading decoded cache for", url);
+	} else {
+		res = ERR_INVALID_ARGUMENT;
+	}
+
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+	return res == 0;
+}
+
+static cc_result ExtractFromUrl(struct Stream* stream, const cc_string* url) {
+	cc_result res;
+	DecodedCache_Begin(url);
+	res = ExtractFrom(stream, url);
+	DecodedCache_End(res);
+	return res;
+}
+
 #if defined CC_BUILD_PS1 || defined CC_BUILD_SATURN
 #include "../misc/ps1/classicubezip.h"
 
@@ -517,7 +1435,7 @@ static cc_result ExtractFromFile(const cc_string* path) {
 	struct Stream stream;
 	cc_result res;
 
-	res = Stream_OpenFile(&stream, path);
+	res = Stream_OpenBufferedFile(&stream, path);
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
 	res = ExtractFrom(&stream, path);
@@ -556,8 +1474,12 @@ cc_result TexturePack_ExtractCurrent(cc_bool forceReload) {
 		usingDefault = true;
 	}
 
-	if (url.length && OpenCachedData(&url, &stream)) {
-		res = ExtractFrom(&stream, &url);
+	if (url.length && ExtractDecodedCache(&url)) {
+		usingDefault = false;
+		CacheIndex_Touch(&url);
+	} else if (url.length && OpenCachedData(&url, &stream)) {
+		CacheIndex_Touch(&url);
+		res = ExtractFromUrl(&stream, &url);
 		usingDefault = false;
 
 		/* No point logging error for closing readonly file */
@@ -571,16 +1493,32 @@ cc_result TexturePack_ExtractCurrent(cc_bool forceReload) {
 
 /* Extracts and updates cache for the downloaded texture pack */
 static void ApplyDownloaded(struct HttpRequest* item) {
-	struct Stream mem;
+	struct Stream stream;
+	cc_bool cached = false;
 	cc_string url;
 
 	url = String_FromRawArray(item->url);
-	if (!Platform_ReadonlyFilesystem) UpdateCache(item);
+	if (!Platform_ReadonlyFilesystem) cached = UpdateCache(item) == 0;
+	if (cached) CacheIndex_SetSize(&url, item->size, false);
 	/* Took too long to download and is no longer active texture pack */
 	if (!String_Equals(&TexturePack_Url, &url)) return;
 
-	Stream_ReadonlyMemory(&mem, item->data, item->size);
-	ExtractFrom(&mem, &url);
+	/* Extract from the just written cache file instead when possible, so that */
+	/*  the whole downloaded archive isn't kept in memory while its entries are decoded */
+	if (cached) {
+		Mem_Free(item->data);
+		item->data = NULL;
+		item->size = 0;
+	}
+
+	if (cached && OpenCachedData(&url, &stream)) {
+		ExtractFromUrl(&stream, &url);
+		/* No point logging error for closing readonly file */
+		(void)stream.Close(&stream);
+	} else if (item->data) {
+		Stream_ReadonlyMemory(&stream, item->data, item->size);
+		ExtractFromUrl(&stream, &url);
+	}
 	usingDefault = false;
 }
 
@@ -692,10 +1630,15 @@ static void OnInit(void) {
 	/*  which called TextureEntry_Register, whoops*/
 	entries_head = NULL;
 
+	atlas1D_lazy      = Options_GetBool(OPT_LAZY_ATLAS, ATLAS1D_DEF_LAZY);
+	atlas1D_evictTime = Options_GetInt(OPT_ATLAS_EVICT_TIME, 0, 3600, 60);
+	ScheduledTask_SetLimits(ScheduledTask_Add(5, Atlas1D_EvictTask), 1, 0);
+
 	TextureEntry_Register(&terrain_entry);
 	Utils_EnsureDirectory("texpacks");
 	Utils_EnsureDirectory("texturecache");
 	TextureCache_Init();
+	CacheIndex_Init();
 }
 
 static void OnReset(void) {
@@ -707,6 +1650,7 @@ static void OnReset(void) {
 static void OnFree(void) {
 	OnContextLost(NULL);
 	Atlas2D_Free();
+	CacheIndex_Shutdown();
 	TexturePack_Url.length = 0;
 	entries_head = NULL;
 }
@@ -30,6 +30,14 @@ extern struct IGameComponent Textures_Component;
 #endif
 /* Maximum possible number of 1D terrain atlases. (worst case, each 1D atlas only has 1 tile) */
 #define ATLAS1D_MAX_ATLASES (ATLAS2D_TILES_PER_ROW * ATLAS2D_MAX_ROWS_COUNT)
+/* Maximum height of each 1D terrain atlas in pixels. (further limited by the backend) */
+/* Taller atlases mean fewer atlases, and so fewer texture batches when drawing the map. */
+/* NOTE: 16384 is VERTEX_CHUNK_V_SCALE, so packed chunk vertices can still address every row */
+#if defined CC_BUILD_LOWMEM
+	#define ATLAS1D_MAX_HEIGHT  4096
+#else
+	#define ATLAS1D_MAX_HEIGHT 16384
+#endif
 
 CC_VAR extern struct _Atlas2DData {
 	/* Bitmap that contains the textures of all tiles. */
@@ -39,6 +47,9 @@ CC_VAR extern struct _Atlas2DData {
 	int TileSize;
 	/* Number of rows in the atlas. (default 16, can be 32) */
 	int RowsCount;
+	/* Whether every row of pixels within each tile is identical. */
+	/* (i.e. whether the tile looks the same when stretched vertically) */
+	cc_bool RowsUniform[ATLAS2D_TILES_PER_ROW * ATLAS2D_MAX_ROWS_COUNT];
 } Atlas2D;
 
 CC_VAR extern struct _Atlas1DData {
@@ -77,7 +88,10 @@ cc_bool Atlas_TryChange(struct Bitmap* bmp);
 /* That is, returns U1/U2/V1/V2 coords that make up the tile in a 1D atlas. */
 /* index is set to the index of the 1D atlas that the tile is in. */
 TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index);
+/* Binds the given 1D atlas, creating its texture first if it was lazily not loaded yet. */
 void Atlas1D_Bind(int index);
+/* Returns the number of 1D atlases that currently have a texture created. */
+int  Atlas1D_LoadedCount(void);
 
 /* Whether the given URL is in list of accepted URLs. */
 cc_bool TextureCache_HasAccepted(const cc_string* url);
@@ -340,12 +340,25 @@ void EntryList_Set(struct StringsBuffer* list, const cc_string* key, const cc_st
 	StringsBuffer_Add(list, &entry);
 }
 
+/* Whether the given entry definitely does not have the given key */
+/* NOTE: Much cheaper than separating every entry in the list into its key and value */
+static cc_bool EntryList_CanSkip(const cc_string* entry, const cc_string* key) {
+	char entryFirst, keyFirst;
+	if (entry->length < key->length) return true;
+	if (!key->length) return false;
+
+	entryFirst = entry->buffer[0]; Char_MakeLower(entryFirst);
+	keyFirst   = key->buffer[0];   Char_MakeLower(keyFirst);
+	return entryFirst != keyFirst;
+}
+
 cc_string EntryList_UNSAFE_Get(struct StringsBuffer* list, const cc_string* key, char separator) {
 	cc_string curEntry, curKey, curValue;
 	int i;
 
 	for (i = 0; i < list->count; i++) {
 		StringsBuffer_UNSAFE_GetRaw(list, i, &curEntry);
+		if (EntryList_CanSkip(&curEntry, key)) continue;
 		String_UNSAFE_Separate(&curEntry, separator, &curKey, &curValue);
 
 		if (String_CaselessEquals(key, &curKey)) return curValue;
@@ -359,6 +372,7 @@ int EntryList_Find(struct StringsBuffer* list, const cc_string* key, char separa
 
 	for (i = 0; i < list->count; i++) {
 		StringsBuffer_UNSAFE_GetRaw(list, i, &curEntry);
+		if (EntryList_CanSkip(&curEntry, key)) continue;
 		String_UNSAFE_Separate(&curEntry, separator, &curKey, &curValue);
 
 		if (String_CaselessEquals(key, &curKey)) return i;
@@ -1,8 +1,19 @@
 #include "Vectors.h"
+/* NOTE: Included before Funcs.h, since C++ standard headers may #undef its min/max */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define VECTORS_SSE2
+	#include <emmintrin.h>
+#elif defined __ARM_NEON && defined __aarch64__
+	#define VECTORS_NEON
+	#include <arm_neon.h>
+#endif
 #include "ExtMath.h"
 #include "Funcs.h"
 #include "Constants.h"
 #include "Core.h"
+#if defined CC_BUILD_PSP
+#include <pspgum.h>
+#endif
 
 void Vec3_Lerp(Vec3* result, const Vec3* a, const Vec3* b, float blend) {
 	result->x = blend * (b->x - a->x) + a->x;
@@ -36,6 +47,51 @@ void Vec3_TransformY(Vec3* result, float y, const struct Matrix* mat) {
 	result->z = y * mat->row2.z + mat->row4.z;
 }
 
+void Vec3_TransformMany(void* dst, int dstStride, const void* src, int srcStride, int count, const struct Matrix* mat) {
+	cc_uint8* d = (cc_uint8*)dst;
+	const cc_uint8* s = (const cc_uint8*)src;
+	const float* p;
+	float* r;
+	int i;
+#if defined VECTORS_SSE2
+	__m128 r1 = _mm_loadu_ps(&mat->row1.x), r2 = _mm_loadu_ps(&mat->row2.x);
+	__m128 r3 = _mm_loadu_ps(&mat->row3.x), r4 = _mm_loadu_ps(&mat->row4.x);
+	__m128 v;
+#elif defined VECTORS_NEON
+	float32x4_t r1 = vld1q_f32(&mat->row1.x), r2 = vld1q_f32(&mat->row2.x);
+	float32x4_t r3 = vld1q_f32(&mat->row3.x), r4 = vld1q_f32(&mat->row4.x);
+	float32x4_t v;
+#else
+	float x, y, z;
+#endif
+
+	for (i = 0; i < count; i++, s += srcStride, d += dstStride)
+	{
+		p = (const float*)s;
+		r = (float*)d;
+#if defined VECTORS_SSE2
+		v = _mm_add_ps(_mm_mul_ps(r1, _mm_set1_ps(p[0])), r4);
+		v = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(p[1])), v);
+		v = _mm_add_ps(_mm_mul_ps(r3, _mm_set1_ps(p[2])), v);
+		/* Only X/Y/Z can be stored, since whatever follows the point must not be overwritten */
+		_mm_storel_pi((__m64*)r, v);
+		_mm_store_ss(r + 2, _mm_movehl_ps(v, v));
+#elif defined VECTORS_NEON
+		v = vmlaq_n_f32(r4, r1, p[0]);
+		v = vmlaq_n_f32(v,  r2, p[1]);
+		v = vmlaq_n_f32(v,  r3, p[2]);
+		vst1_f32(r, vget_low_f32(v));
+		vst1q_lane_f32(r + 2, v, 2);
+#else
+		/* p could be pointing to r - therefore can't directly assign X/Y/Z */
+		x = p[0] * mat->row1.x + p[1] * mat->row2.x + p[2] * mat->row3.x + mat->row4.x;
+		y = p[0] * mat->row1.y + p[1] * mat->row2.y + p[2] * mat->row3.y + mat->row4.y;
+		z = p[0] * mat->row1.z + p[1] * mat->row2.z + p[2] * mat->row3.z + mat->row4.z;
+		r[0] = x; r[1] = y; r[2] = z;
+#endif
+	}
+}
+
 Vec3 Vec3_RotateX(Vec3 v, float angle) {
 	float cosA = Math_CosF(angle);
 	float sinA = Math_SinF(angle);
@@ -132,6 +188,49 @@ void Matrix_Scale(struct Matrix* result, float x, float y, float z) {
 	result->row1.x = x; result->row2.y = y; result->row3.z = z;
 }
 
+#if defined CC_BUILD_PSP
+/* Links against libpspgum_vfpu, so the multiply is done with a single VFPU vmmul */
+/* NOTE: Main thread must be created with PSP_THREAD_ATTR_VFPU for this to work */
+void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct Matrix* right) {
+	/* gum treats matrices as column major, so the arguments are swapped here */
+	gumMultMatrix((ScePspFMatrix4*)result, (const ScePspFMatrix4*)right, (const ScePspFMatrix4*)left);
+}
+#elif defined VECTORS_SSE2
+/* Each row of the result is the rows of right, weighted by the elements in that row of left */
+/* NOTE: Both matrices are entirely loaded first, since result might be pointing to left or right */
+#define Matrix_MulRow(l) \
+	_mm_add_ps( \
+		_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(l, l, 0x00), r1), _mm_mul_ps(_mm_shuffle_ps(l, l, 0x55), r2)), \
+		_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(l, l, 0xAA), r3), _mm_mul_ps(_mm_shuffle_ps(l, l, 0xFF), r4)))
+
+void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct Matrix* right) {
+	__m128 l1 = _mm_loadu_ps(&left->row1.x),  l2 = _mm_loadu_ps(&left->row2.x);
+	__m128 l3 = _mm_loadu_ps(&left->row3.x),  l4 = _mm_loadu_ps(&left->row4.x);
+	__m128 r1 = _mm_loadu_ps(&right->row1.x), r2 = _mm_loadu_ps(&right->row2.x);
+	__m128 r3 = _mm_loadu_ps(&right->row3.x), r4 = _mm_loadu_ps(&right->row4.x);
+
+	_mm_storeu_ps(&result->row1.x, Matrix_MulRow(l1));
+	_mm_storeu_ps(&result->row2.x, Matrix_MulRow(l2));
+	_mm_storeu_ps(&result->row3.x, Matrix_MulRow(l3));
+	_mm_storeu_ps(&result->row4.x, Matrix_MulRow(l4));
+}
+#elif defined VECTORS_NEON
+/* Same as the SSE2 version, but using multiply-accumulate by lane */
+#define Matrix_MulRow(l) \
+	vmlaq_laneq_f32(vmlaq_laneq_f32(vmlaq_laneq_f32(vmulq_laneq_f32(r1, l, 0), r2, l, 1), r3, l, 2), r4, l, 3)
+
+void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct Matrix* right) {
+	float32x4_t l1 = vld1q_f32(&left->row1.x),  l2 = vld1q_f32(&left->row2.x);
+	float32x4_t l3 = vld1q_f32(&left->row3.x),  l4 = vld1q_f32(&left->row4.x);
+	float32x4_t r1 = vld1q_f32(&right->row1.x), r2 = vld1q_f32(&right->row2.x);
+	float32x4_t r3 = vld1q_f32(&right->row3.x), r4 = vld1q_f32(&right->row4.x);
+
+	vst1q_f32(&result->row1.x, Matrix_MulRow(l1));
+	vst1q_f32(&result->row2.x, Matrix_MulRow(l2));
+	vst1q_f32(&result->row3.x, Matrix_MulRow(l3));
+	vst1q_f32(&result->row4.x, Matrix_MulRow(l4));
+}
+#else
 void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct Matrix* right) {
 	/* Originally from http://www.edais.co.uk/blog/?p=27 */
 	float
@@ -165,6 +264,7 @@ void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct M
 	result->row4.z = (((lM41 * rM13) + (lM42 * rM23)) + (lM43 * rM33)) + (lM44 * rM43);
 	result->row4.w = (((lM41 * rM14) + (lM42 * rM24)) + (lM43 * rM34)) + (lM44 * rM44);
 }
+#endif
 
 void Matrix_LookRot(struct Matrix* result, Vec3 pos, Vec2 rot) {
 	struct Matrix rotX, rotY, trans;
@@ -207,6 +307,90 @@ cc_bool FrustumCulling_SphereInFrustum(float x, float y, float z, float radius)
 	return true;
 }
 
+#define FRUSTUM_PLANES 5
+void FrustumCulling_BoxesInFrustum(const struct FrustumBoxes* boxes, int count, cc_uint8* visible) {
+	struct Plane planes[FRUSTUM_PLANES];
+	const float* xs[FRUSTUM_PLANES];
+	const float* ys[FRUSTUM_PLANES];
+	const float* zs[FRUSTUM_PLANES];
+	struct Plane p;
+	float d;
+	int i = 0, j;
+#if defined VECTORS_SSE2
+	__m128 pa[FRUSTUM_PLANES], pb[FRUSTUM_PLANES], pc[FRUSTUM_PLANES], pd[FRUSTUM_PLANES];
+	__m128 inside, dist, zero = _mm_setzero_ps();
+	int bits;
+#elif defined VECTORS_NEON
+	float32x4_t pa[FRUSTUM_PLANES], pb[FRUSTUM_PLANES], pc[FRUSTUM_PLANES], pd[FRUSTUM_PLANES];
+	float32x4_t dist, zero = vdupq_n_f32(0.0f);
+	uint32x4_t inside;
+#endif
+	/* Don't test NEAR plane, it's pointless */
+	planes[0] = frustumR; planes[1] = frustumL; planes[2] = frustumB;
+	planes[3] = frustumT; planes[4] = frustumF;
+
+	for (j = 0; j < FRUSTUM_PLANES; j++)
+	{
+		/* Box is completely outside a plane when the corner furthest along its normal is outside */
+		p = planes[j];
+		xs[j] = p.a >= 0.0f ? boxes->maxX : boxes->minX;
+		ys[j] = p.b >= 0.0f ? boxes->maxY : boxes->minY;
+		zs[j] = p.c >= 0.0f ? boxes->maxZ : boxes->minZ;
+#if defined VECTORS_SSE2
+		pa[j] = _mm_set1_ps(p.a); pb[j] = _mm_set1_ps(p.b);
+		pc[j] = _mm_set1_ps(p.c); pd[j] = _mm_set1_ps(p.d);
+#elif defined VECTORS_NEON
+		pa[j] = vdupq_n_f32(p.a); pb[j] = vdupq_n_f32(p.b);
+		pc[j] = vdupq_n_f32(p.c); pd[j] = vdupq_n_f32(p.d);
+#endif
+	}
+
+	/* Tests 4 boxes at a time when SIMD instructions are available */
+#if defined VECTORS_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (j = 0; j < FRUSTUM_PLANES; j++)
+		{
+			dist = _mm_add_ps(_mm_mul_ps(pa[j], _mm_loadu_ps(xs[j] + i)), pd[j]);
+			dist = _mm_add_ps(_mm_mul_ps(pb[j], _mm_loadu_ps(ys[j] + i)), dist);
+			dist = _mm_add_ps(_mm_mul_ps(pc[j], _mm_loadu_ps(zs[j] + i)), dist);
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(dist, zero));
+		}
+
+		bits = _mm_movemask_ps(inside);
+		visible[i + 0] = (bits >> 0) & 1; visible[i + 1] = (bits >> 1) & 1;
+		visible[i + 2] = (bits >> 2) & 1; visible[i + 3] = (bits >> 3) & 1;
+	}
+#elif defined VECTORS_NEON
+	for (; i + 4 <= count; i += 4)
+	{
+		inside = vdupq_n_u32(~0u);
+		for (j = 0; j < FRUSTUM_PLANES; j++)
+		{
+			dist = vmlaq_f32(pd[j], pa[j], vld1q_f32(xs[j] + i));
+			dist = vmlaq_f32(dist,  pb[j], vld1q_f32(ys[j] + i));
+			dist = vmlaq_f32(dist,  pc[j], vld1q_f32(zs[j] + i));
+			inside = vandq_u32(inside, vcgtq_f32(dist, zero));
+		}
+
+		visible[i + 0] = vgetq_lane_u32(inside, 0) & 1; visible[i + 1] = vgetq_lane_u32(inside, 1) & 1;
+		visible[i + 2] = vgetq_lane_u32(inside, 2) & 1; visible[i + 3] = vgetq_lane_u32(inside, 3) & 1;
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		visible[i] = true;
+		for (j = 0; j < FRUSTUM_PLANES; j++)
+		{
+			p = planes[j];
+			d = p.a * xs[j][i] + p.b * ys[j][i] + p.c * zs[j][i] + p.d;
+			if (d <= 0.0f) { visible[i] = false; break; }
+		}
+	}
+}
+
 void FrustumCulling_CalcFrustumEquations(struct Matrix* clip) {
 	/* Extract the RIGHT plane */
 	frustumR.a = clip->row1.w - clip->row1.x;
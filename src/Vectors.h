@@ -94,6 +94,10 @@ void Vec3_Normalise(Vec3* v);
 void Vec3_Transform(Vec3* result, const Vec3* a, const struct Matrix* mat);
 /* Same as Vec3_Transform, but faster since X and Z are assumed as 0. */
 void Vec3_TransformY(Vec3* result, float y, const struct Matrix* mat);
+/* Transforms count points by the given matrix, using SIMD instructions where available. */
+/* NOTE: Each point is the first 3 floats of an element, with elements being srcStride/dstStride bytes apart */
+/*  (e.g. so the positions in an array of vertices can be transformed directly). Only X/Y/Z are written to. */
+void Vec3_TransformMany(void* dst, int dstStride, const void* src, int srcStride, int count, const struct Matrix* mat);
 
 Vec3 Vec3_RotateX(Vec3 v, float angle);
 Vec3 Vec3_RotateY(Vec3 v, float angle);
@@ -135,6 +139,11 @@ CC_API void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const s
 void Matrix_LookRot(struct Matrix* result, Vec3 pos, Vec2 rot);
 
 cc_bool FrustumCulling_SphereInFrustum(float x, float y, float z, float radius);
+/* Axis aligned bounding boxes, stored as a structure of arrays (box i is minX[i]..maxZ[i]) */
+struct FrustumBoxes { float* minX; float* minY; float* minZ; float* maxX; float* maxY; float* maxZ; };
+/* Sets visible[i] to whether box i is at least partially inside the frustum, for every box */
+/* NOTE: Boxes are tested several at a time using SIMD instructions where available */
+void FrustumCulling_BoxesInFrustum(const struct FrustumBoxes* boxes, int count, cc_uint8* visible);
 /* Calculates the clipping planes from the combined modelview and projection matrices */
 /* Matrix_Mul(&clip, modelView, projection); */
 void FrustumCulling_CalcFrustumEquations(struct Matrix* clip);
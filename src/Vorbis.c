@@ -6,6 +6,7 @@
 #include "Funcs.h"
 #include "Errors.h"
 #include "Stream.h"
+#define MEM_SUBSYSTEM MEM_SYS_AUDIO
 
 /*########################################################################################################################*
 *-------------------------------------------------------Ogg stream--------------------------------------------------------*
@@ -249,10 +250,17 @@ static float float32_unpack(struct VorbisState* ctx) {
 /* Vorbis spec 3. Probability Model and Codebooks */
 #define CODEBOOK_SYNC 0x564342
 
+/* Number of bits looked up at once when decoding huffman codewords */
+#define CODEBOOK_FAST_BITS 10
+#define CODEBOOK_FAST_SIZE (1 << CODEBOOK_FAST_BITS)
+
 struct Codebook {
 	cc_uint32 dimensions, entries, totalCodewords;
 	cc_uint32* codewords;
 	cc_uint32* values;
+	/* Lookup table indexed by the next CODEBOOK_FAST_BITS bits of the stream */
+	/*  (value << 5) | length of codeword, or 0 if the codeword is longer than CODEBOOK_FAST_BITS */
+	cc_uint32* fastLookup;
 	cc_uint32 numCodewords[33]; /* number of codewords of bit length i */
 	/* vector quantisation values */
 	float minValue, deltaValue;
@@ -263,6 +271,7 @@ struct Codebook {
 static void Codebook_Free(struct Codebook* c) {
 	Mem_Free(c->codewords);
 	Mem_Free(c->values);
+	Mem_Free(c->fastLookup);
 	Mem_Free(c->multiplicands);
 }
 
@@ -357,6 +366,32 @@ static cc_bool Codebook_CalcCodewords(struct Codebook* c, cc_uint8* len) {
 	return true;
 }
 
+static void Codebook_CalcFastLookup(struct Codebook* c) {
+	cc_uint32 i, j, depth, bits, codeword, reversed;
+	int offset = 0;
+
+	c->fastLookup = (cc_uint32*)Mem_AllocCleared(CODEBOOK_FAST_SIZE, 4, "codebook lookup");
+	for (depth = 1; depth <= CODEBOOK_FAST_BITS; depth++) 
+	{
+		for (i = 0; i < c->numCodewords[depth]; i++, offset++) 
+		{
+			/* Codewords are stored MSB first, but bits are read from the stream LSB first */
+			codeword = c->codewords[offset];
+			reversed = 0;
+			for (bits = 0; bits < depth; bits++) 
+			{
+				reversed |= ((codeword >> (31 - bits)) & 1) << bits;
+			}
+
+			/* All stream bit patterns beginning with this codeword map to it */
+			for (j = reversed; j < CODEBOOK_FAST_SIZE; j += 1U << depth) 
+			{
+				c->fastLookup[j] = (c->values[offset] << 5) | depth;
+			}
+		}
+	}
+}
+
 static cc_result Codebook_DecodeSetup(struct VorbisState* ctx, struct Codebook* c) {
 	cc_uint32 sync;
 	cc_uint8* codewordLens;
@@ -411,6 +446,7 @@ static cc_result Codebook_DecodeSetup(struct VorbisState* ctx, struct Codebook*
 
 	c->totalCodewords = entry;
 	Codebook_CalcCodewords(c, codewordLens);
+	Codebook_CalcFastLookup(c);
 	Mem_Free(codewordLens);
 
 	c->lookupType    = Vorbis_ReadBits(ctx, 4);
@@ -442,8 +478,26 @@ static cc_uint32 Codebook_DecodeScalar(struct VorbisState* ctx, struct Codebook*
 	cc_uint32 codeword = 0, shift = 31, depth, i;
 	cc_uint32* codewords = c->codewords;
 	cc_uint32* values    = c->values;
+	struct OggState* src = ctx->source;
+	cc_uint32 entry;
+
+	/* Fill bit buffer from the current packet (never reading past the end of it) */
+	while (ctx->NumBits < CODEBOOK_FAST_BITS && src->left) {
+		Vorbis_PushByte(ctx, *src->cur);
+		src->cur++; src->left--;
+	}
+
+	/* Fast path for short codewords, which are by far the most common */
+	if (ctx->NumBits >= CODEBOOK_FAST_BITS) {
+		entry = c->fastLookup[Vorbis_PeekBits(ctx, CODEBOOK_FAST_BITS)];
+		if (entry) { 
+			depth = entry & 0x1F;
+			Vorbis_ConsumeBits(ctx, depth);
+			return entry >> 5;
+		}
+	}
 
-	/* TODO: This is so massively slow */
+	/* Slow path for long codewords, or at the end of a packet */
 	for (depth = 1; depth <= 32; depth++, shift--) 
 	{
 		codeword |= Vorbis_ReadBit(ctx) << shift;
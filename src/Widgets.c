@@ -17,6 +17,7 @@
 #include "Block.h"
 #include "Input.h"
 #include "InputHandler.h"
+#define MEM_SUBSYSTEM MEM_SYS_UI
 
 static void Widget_NullFunc(void* widget) { }
 static int  Widget_Pointer(void* elem, int id, int x, int y) { return false; }
@@ -60,8 +61,7 @@ static void TextWidget_BuildMesh(void* widget, struct VertexTextured** vertices)
 static int TextWidget_Render2(void* widget, int offset) {
 	struct TextWidget* w = (struct TextWidget*)widget;
 	if (w->tex.ID) {
-		Gfx_BindTexture(w->tex.ID);
-		Gfx_DrawVb_IndexedTris_Range(4, offset);
+		Gfx_Draw2DRange(w->tex.ID, 4, offset);
 	}
 	return offset + 4;
 }
@@ -214,13 +214,12 @@ static void ButtonWidget_BuildMesh(void* widget, struct VertexTextured** vertice
 
 static int ButtonWidget_Render2(void* widget, int offset) {
 	struct ButtonWidget* w = (struct ButtonWidget*)widget;	
-	Gfx_BindTexture(Gui.ClassicTexture ? Gui.GuiClassicTex : Gui.GuiTex);
 	/* TODO: Does this 400 need to take DPI into account */
-	Gfx_DrawVb_IndexedTris_Range(w->width >= 400 ? 4 : 8, offset);
+	Gfx_Draw2DRange(Gui.ClassicTexture ? Gui.GuiClassicTex : Gui.GuiTex, 
+					w->width >= 400 ? 4 : 8, offset);
 
 	if (w->tex.ID) {
-		Gfx_BindTexture(w->tex.ID);
-		Gfx_DrawVb_IndexedTris_Range(4, offset + 8);
+		Gfx_Draw2DRange(w->tex.ID, 4, offset + 8);
 	}
 	return offset + 12;
 }
@@ -451,8 +450,7 @@ static void HotbarWidget_RenderOutline(struct HotbarWidget* w, int offset) {
 	GfxResourceID tex;
 	tex = Gui.ClassicTexture ? Gui.GuiClassicTex : Gui.GuiTex;
 
-	Gfx_BindTexture(tex);
-	Gfx_DrawVb_IndexedTris_Range(8, offset);
+	Gfx_Draw2DRange(tex, 8, offset);
 }
 
 static void HotbarWidget_RenderEntries(struct HotbarWidget* w, int offset) {
@@ -771,7 +769,7 @@ static void TableWidget_BuildMesh(void* widget, struct VertexTextured** vertices
 	struct TableWidget* w = (struct TableWidget*)widget;
 	struct VertexTextured* data = *vertices;
 	int cellSizeX, cellSizeY;
-	int i, x, y;
+	int i, x, y, count;
 
 	cellSizeX = w->cellSizeX;
 	cellSizeY = w->cellSizeY;
@@ -787,6 +785,10 @@ static void TableWidget_BuildMesh(void* widget, struct VertexTextured** vertices
 			w->normBlockSize, x + cellSizeX / 2, y + cellSizeY / 2);
 	}
 
+	count = IsometricDrawer_EndBatch();
+
+	/* Selected block overlaps its neighbours, so must be in a separate batch */
+	IsometricDrawer_BeginBatch(data + count, w->state + count / 4);
 	i = w->selectedIndex;
 	if (i != -1) {
 		TableWidget_GetCoords(w, i, &x, &y);
@@ -795,7 +797,7 @@ static void TableWidget_BuildMesh(void* widget, struct VertexTextured** vertices
 			w->selBlockSize, x + cellSizeX / 2, y + cellSizeY / 2);
 	}
 
-	w->verticesCount = IsometricDrawer_EndBatch();
+	w->verticesCount = count + IsometricDrawer_EndBatch();
 	*vertices        = data + TABLE_MAX_VERTICES;
 }
 
@@ -1596,13 +1598,11 @@ static void TextInputWidget_BuildMesh(void* widget, struct VertexTextured** vert
 
 static int TextInputWidget_Render2(void* widget, int offset) {
 	struct InputWidget* w = (struct InputWidget*)widget;
-	Gfx_BindTexture(w->inputTex.ID);
-	Gfx_DrawVb_IndexedTris_Range(4, offset);
+	Gfx_Draw2DRange(w->inputTex.ID, 4, offset);
 	offset += 4;
 
 	if (w->showCaret && Math_Mod1((float)w->caretAccumulator) < 0.5f) {
-		Gfx_BindTexture(w->caretTex.ID);
-		Gfx_DrawVb_IndexedTris_Range(4, offset);
+		Gfx_Draw2DRange(w->caretTex.ID, 4, offset);
 	}
 	return offset + 4;
 }
@@ -2030,16 +2030,31 @@ void ChatInputWidget_SetFont(struct ChatInputWidget* w, struct FontDesc* font) {
 *-----------------------------------------------------TextGroupWidget-----------------------------------------------------*
 *#########################################################################################################################*/
 void TextGroupWidget_ShiftUp(struct TextGroupWidget* w) {
-	int last, i;
-	Gfx_DeleteTexture(&w->textures[0].ID);
-	last = w->lines - 1;
+	TextGroupWidget_ShiftUpBy(w, 1);
+}
+
+void TextGroupWidget_ShiftUpBy(struct TextGroupWidget* w, int count) {
+	int keep, i;
+	if (count <= 0) return;
+	/* Every line scrolled out of view, so just redraw everything */
+	if (count >= w->lines) { TextGroupWidget_RedrawAll(w); return; }
+
+	for (i = 0; i < count; i++) 
+	{
+		Gfx_DeleteTexture(&w->textures[i].ID);
+	}
+	keep = w->lines - count;
 
-	for (i = 0; i < last; i++) 
+	for (i = 0; i < keep; i++) 
+	{
+		w->textures[i] = w->textures[i + count];
+	}
+	/* Gfx_DeleteTexture() called by TextGroupWidget_Redraw otherwise */
+	for (i = keep; i < w->lines; i++) 
 	{
-		w->textures[i] = w->textures[i + 1];
+		w->textures[i].ID = 0;
+		TextGroupWidget_Redraw(w, i);
 	}
-	w->textures[last].ID = 0; /* Gfx_DeleteTexture() called by TextGroupWidget_Redraw otherwise */
-	TextGroupWidget_Redraw(w, last);
 }
 
 void TextGroupWidget_ShiftDown(struct TextGroupWidget* w) {
@@ -2445,9 +2460,7 @@ static int TextGroupWidget_Render2(void* widget, int offset) {
 	for (i = 0; i < w->lines; i++, offset += 4)
 	{
 		if (!textures[i].ID) continue;
-
-		Gfx_BindTexture(textures[i].ID);
-		Gfx_DrawVb_IndexedTris_Range(4, offset);
+		Gfx_Draw2DRange(textures[i].ID, 4, offset);
 	}
 	return offset;
 }
@@ -2798,13 +2811,18 @@ static int ThumbstickWidget_CalcDirs(struct ThumbstickWidget* w) {
 
 static int ThumbstickWidget_Render2(void* widget, int offset) {
 	struct ThumbstickWidget* w = (struct ThumbstickWidget*)widget;
-	int i, base, flags = ThumbstickWidget_CalcDirs(w);
+	int i, j, base, flags = ThumbstickWidget_CalcDirs(w);
 
 	if (Gui.TouchTex) {
-		Gfx_BindTexture(Gui.TouchTex);
-		for (i = 0; i < 4; i++) {
+		for (i = 0; i < 4; i = j) {
 			base = (flags & (1 << i)) ? 0 : THUMBSTICKWIDGET_PER;
-			Gfx_DrawVb_IndexedTris_Range(4, offset + base + (i * 4));
+
+			/* Adjacent directions in the same state are contiguous in the mesh, so draw them together */
+			for (j = i + 1; j < 4; j++) 
+			{
+				if (((flags & (1 << j)) ? 0 : THUMBSTICKWIDGET_PER) != base) break;
+			}
+			Gfx_Draw2DRange(Gui.TouchTex, (j - i) * 4, offset + base + (i * 4));
 		}
 	}
 	return offset + THUMBSTICKWIDGET_MAX;
@@ -261,6 +261,8 @@ CC_NOINLINE void TextGroupWidget_SetFont(struct TextGroupWidget* w, struct FontD
 /* Deletes first line, then moves all other lines upwards, then redraws last line. */
 /* NOTE: GetLine must also adjust the lines it returns for this to behave properly. */
 CC_NOINLINE void TextGroupWidget_ShiftUp(struct TextGroupWidget* w);
+/* Same as calling TextGroupWidget_ShiftUp count times, but only redraws each line at most once. */
+CC_NOINLINE void TextGroupWidget_ShiftUpBy(struct TextGroupWidget* w, int count);
 /* Deletes last line, then moves all other lines downwards, then redraws first line. */
 /* NOTE: GetLine must also adjust the lines it returns for this to behave properly. */
 CC_NOINLINE void TextGroupWidget_ShiftDown(struct TextGroupWidget* w);
@@ -129,7 +129,10 @@ static int orig_KB = K_XLATE;
 #endif
 
 static void UpdateDimensions(void) {
-	ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws);
+	/* Output isn't a terminal (e.g. redirected to a file when benchmarking), so assume a standard size */
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) || !ws.ws_col || !ws.ws_row) {
+		ws.ws_col = 80; ws.ws_row = 24;
+	}
 
 	DisplayInfo.Width  = ws.ws_col;
 	DisplayInfo.Height = ws.ws_row * CHARS_PER_CELL;
@@ -531,14 +534,32 @@ cc_result Window_SaveFileDialog(const struct SaveFileDialogArgs* args) {
 }
 
 
+static BitmapCol* fb_emitted;
+static char* out_buf;
+static int out_len, out_capacity;
+static cc_bool fb_emittedValid;
+
 void Window_AllocFramebuffer(struct Bitmap* bmp, int width, int height) {
 	bmp->scan0  = (BitmapCol*)Mem_Alloc(width * height, BITMAPCOLOR_SIZE, "window pixels");
 	bmp->width  = width;
 	bmp->height = height;
+
+	// Colours last output for each pixel, so unchanged cells don't need to be output again
+	// NOTE: Contents of the terminal are unknown after a resize, so always output every cell then
+	fb_emitted      = (BitmapCol*)Mem_Alloc(width * height, BITMAPCOLOR_SIZE, "window emitted pixels");
+	fb_emittedValid = false;
+
+	// Worst case is a cursor move and two 24 bit colour SGR sequences for every cell
+	out_capacity = width * (height / CHARS_PER_CELL + 1) * 56 + 256;
+	out_buf      = (char*)Mem_Alloc(out_capacity, 1, "window output");
 }
 
 void Window_FreeFramebuffer(struct Bitmap* bmp) {
 	Mem_Free(bmp->scan0);
+	Mem_Free(fb_emitted);
+	Mem_Free(out_buf);
+	fb_emitted = NULL;
+	out_buf    = NULL;
 }
 
 void OnscreenKeyboard_Open(struct OpenKeyboardArgs* args) { }
@@ -561,17 +582,6 @@ void Window_DisableRawMouse(void) {
 /*########################################################################################################################*
 *-------------------------------------------------------Console output-----------------------------------------------------*
 *#########################################################################################################################*/
-// TODO still wrong
-static void AppendByteFast(cc_string* str, int value) {
-	if (value >= 100) { 
-		String_Append(str, '0' + (value / 100)); value %= 100;
-		String_Append(str, '0' + (value /  10)); value %=  10;
-	} else if (value >=  10) { 
-		String_Append(str, '0' + (value /  10)); value %=  10; 
-	}
-	String_Append(str, '0' + value);
-}
-
 static int Index256(int value) {
 	if (value <= 0x5F) return value;
 	// Add 20 to round to nearest
@@ -586,69 +596,116 @@ static int CalcIndex(BitmapCol rgb) {
 	return 16 + 36 * r + 6 * g + b;
 }
 
+static void FlushOutput(void) {
+#ifdef CC_BUILD_WIN
+	OutputConsole(out_buf, out_len);
+#else
+	int i, written;
+	// write can write less than requested (e.g. interrupted by a signal)
+	for (i = 0; i < out_len; i += written)
+	{
+		written = OutputConsole(out_buf + i, out_len - i);
+		if (written <= 0) break;
+	}
+#endif
+	out_len = 0;
+}
+
+static CC_INLINE void AppendConst(const char* str, int len) {
+	Mem_Copy(out_buf + out_len, str, len);
+	out_len += len;
+}
+#define AppendConstStr(str) AppendConst(str, sizeof(str) - 1)
+
+static void AppendInt(int value) {
+	char digits[16];
+	int i = 0;
+	do {
+		digits[i++] = '0' + (value % 10); value /= 10;
+	} while (value);
+
+	while (i) out_buf[out_len++] = digits[--i];
+}
+
+// https://en.wikipedia.org/wiki/ANSI_escape_code#Colors
+static void AppendColor(const char* mode, BitmapCol col) {
+	AppendConst(mode, 2);
+	if (supportsTruecolor) {
+		AppendConstStr(SEP_STR "2" SEP_STR);
+		AppendInt(BitmapCol_R(col)); out_buf[out_len++] = SEP_CHAR;
+		AppendInt(BitmapCol_G(col)); out_buf[out_len++] = SEP_CHAR;
+		AppendInt(BitmapCol_B(col));
+	} else {
+		AppendConstStr(SEP_STR "5" SEP_STR);
+		AppendInt(CalcIndex(col));
+	}
+}
+
+// Returns the value that determines the actual colour output for the given colour
+static CC_INLINE int ColorKey(BitmapCol col) {
+	if (!supportsTruecolor) return CalcIndex(col);
+	return (BitmapCol_R(col) << 16) | (BitmapCol_G(col) << 8) | BitmapCol_B(col);
+}
+
 void Window_DrawFramebuffer(Rect2D r, struct Bitmap* bmp) {
-	char buf[256];
-	cc_string str;
-	int len;
-	String_InitArray(str, buf);
-	
-	for (int y = r.y & ~0x01; y < r.y + r.height; y += 2)
+	int x, y, row, idx, curX = -1, curY = -1;
+	int lastTop = -1, lastBot = -1, topKey, botKey;
+	BitmapCol top, bot;
+	cc_bool full = !fb_emittedValid;
+
+	// Terminal rows are 1 based, so the first two rows of pixels would end up on the
+	//  same terminal row as the second two rows of pixels and always be drawn over
+	y = max(r.y & ~0x01, CHARS_PER_CELL);
+	for (; y < r.y + r.height; y += 2)
 	{
-		//len = sprintf(buf, CSI "%i;%iH", y / 2, r.x); // move cursor to start
-		//OutputConsole(buf, len);
-		str.length = 0;
-		String_AppendConst(&str, CSI);
-		String_AppendInt(  &str, y / CHARS_PER_CELL);
-		String_Append(     &str, ';');
-		String_AppendInt(  &str, r.x);
-		String_Append(     &str, 'H');
-		OutputConsole(buf, str.length);
-		
-		for (int x = r.x; x < r.x + r.width; x++)
+		row = y / CHARS_PER_CELL;
+		for (x = r.x; x < r.x + r.width; x++)
 		{
-			BitmapCol top = Bitmap_GetPixel(bmp, x, y + 0);
-			BitmapCol bot = Bitmap_GetPixel(bmp, x, y + 1);
-	
+			top = Bitmap_GetPixel(bmp, x, y + 0);
+			bot = Bitmap_GetPixel(bmp, x, y + 1);
+			idx = y * bmp->width + x;
+
+			if (!full && fb_emitted[idx] == top && fb_emitted[idx + bmp->width] == bot) continue;
+			fb_emitted[idx] = top; fb_emitted[idx + bmp->width] = bot;
+
+			// Make sure there's always enough space left for the output of one cell
+			if (out_len + 64 > out_capacity) FlushOutput();
+
+			if (row != curY || x != curX) {
+				AppendConstStr(CSI);
+				if (row == curY) {
+					// Moving forward on the same row is shorter than absolute positioning
+					AppendInt(x - curX);
+					out_buf[out_len++] = 'C';
+				} else {
+					AppendInt(row);
+					out_buf[out_len++] = ';';
+					AppendInt(x + 1);
+					out_buf[out_len++] = 'H';
+				}
+			}
+
 			// Use '▄' so each cell can use a background and foreground colour
 			// This essentially doubles the vertical resolution of the displayed image
-			//printf(CSI "48;2;%i;%i;%im", BitmapCol_R(top), BitmapCol_G(top), BitmapCol_B(top));
-			//printf(CSI "38;2;%i;%i;%im", BitmapCol_R(bot), BitmapCol_G(bot), BitmapCol_B(bot));
-			//printf("\xE2\x96\x84");
-			//len = sprintf(buf, CSI "48;2;%i;%i;%im" CSI "38;2;%i;%i;%im" BOX_CHAR, 
-			//				BitmapCol_R(top), BitmapCol_G(top), BitmapCol_B(top),
-			//				BitmapCol_R(bot), BitmapCol_G(bot), BitmapCol_B(bot));
-			
-			// https://en.wikipedia.org/wiki/ANSI_escape_code#Colors
-			str.length = 0;
-			if (supportsTruecolor) {
-				String_AppendConst(&str, CSI "48" SEP_STR "2" SEP_STR);
-				String_AppendInt(  &str, BitmapCol_R(top));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_G(top));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_B(top));
-				String_Append(     &str, 'm');
-				
-				String_AppendConst(&str, CSI "38" SEP_STR "2" SEP_STR);
-				String_AppendInt(  &str, BitmapCol_R(bot));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_G(bot));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_B(bot));
-				String_Append(     &str, 'm');
-			} else {
-				String_AppendConst(&str, CSI "48" SEP_STR "5" SEP_STR);
-				String_AppendInt(  &str, CalcIndex(top));
-				String_Append(     &str, 'm');
-				
-				String_AppendConst(&str, CSI "38" SEP_STR "5" SEP_STR);
-				String_AppendInt(  &str, CalcIndex(bot));
-				String_Append(     &str, 'm');
+			// Colours that are the same as the previously output cell don't need to be set again
+			topKey = ColorKey(top);
+			botKey = ColorKey(bot);
+
+			if (topKey != lastTop || botKey != lastBot) {
+				AppendConstStr(CSI);
+				if (topKey != lastTop) AppendColor("48", top);
+				if (topKey != lastTop && botKey != lastBot) out_buf[out_len++] = ';';
+				if (botKey != lastBot) AppendColor("38", bot);
+				out_buf[out_len++] = 'm';
 			}
-			
-			String_AppendConst(&str, BOX_CHAR);
-			OutputConsole(buf, str.length);
-		}		
+			lastTop = topKey; lastBot = botKey;
+
+			AppendConstStr(BOX_CHAR);
+			curX = x + 1; curY = row;
+		}
 	}
+
+	FlushOutput();
+	fb_emittedValid = fb_emittedValid || (r.x == 0 && r.y == 0 && r.width == bmp->width && r.height == bmp->height);
 }
 #endif
@@ -7,12 +7,21 @@
 #include "Entity.h"
 #include "ExtMath.h"
 #include "Physics.h"
+#include "BlockPhysics.h"
 #include "Game.h"
 #include "TexturePack.h"
 #include "Window.h"
+#include "Funcs.h"
+#define MEM_SUBSYSTEM MEM_SYS_WORLD
 
 struct _WorldData World;
 static char nameBuffer[STRING_SIZE];
+static void Sections_Free(void);
+static void Sections_Calculate(void);
+#ifdef EXTENDED_BLOCKS
+static void Upper_Free(void);
+static void Upper_Init(void);
+#endif
 /*########################################################################################################################*
 *----------------------------------------------------------World----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -39,12 +48,11 @@ static void GenerateNewUuid(void) {
 
 void World_Reset(void) {
 #ifdef EXTENDED_BLOCKS
-	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
-	World.Blocks2 = NULL;
-	World.IDMask  = 0xFF;
+	Upper_Free();
 #endif
 	Mem_Free(World.Blocks);
 	World.Blocks = NULL;
+	Sections_Free();
 	String_InitArray(World.Name, nameBuffer);
 
 	World_SetDimensions(0, 0, 0);
@@ -55,6 +63,8 @@ void World_Reset(void) {
 }
 
 void World_NewMap(void) {
+	/* Physics worker thread may still be changing blocks in the old map */
+	Physics_FinishTick();
 	World_Reset();
 	Event_RaiseVoid(&WorldEvents.NewMap);
 }
@@ -62,6 +72,7 @@ void World_NewMap(void) {
 void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
 	/* TODO: TEMP HACK */
 	if (!blocks) { width = 0; height = 0; length = 0; }
+	Physics_FinishTick();
 
 	World_SetDimensions(width, height, length);
 	World.Blocks      = blocks;
@@ -69,21 +80,29 @@ void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
 
 	if (!World.Volume) World.Blocks = NULL;
 #ifdef EXTENDED_BLOCKS
-	/* .cw maps may have set this to a non-NULL when importing */
-	if (!World.Blocks2) {
-		World.Blocks2 = World.Blocks;
-		World.IDMask  = 0xFF;
-	}
+	Upper_Init();
 #endif
 
 	if (Env.EdgeHeight == -1)   { Env.EdgeHeight   = height / 2; }
 	if (Env.CloudsHeight == -1) { Env.CloudsHeight = height + 2; }
 
+	Sections_Calculate();
 	GenerateNewUuid();
 	World.Loaded = true;
 	Event_RaiseVoid(&WorldEvents.MapLoaded);
 }
 
+/* Calculates the multiplier and shift that divide any 31 bit value by divisor */
+/*  (see "Division by Invariant Integers using Multiplication" by Granlund and Montgomery) */
+static void CalcReciprocal(int divisor, cc_uint64* mul, int* shift) {
+	int bits = 0;
+	if (divisor <= 0) { *mul = 0; *shift = 0; return; }
+
+	while ((1 << bits) < divisor) bits++;
+	*shift = 31 + bits;
+	*mul   = (((cc_uint64)1 << *shift) + divisor - 1) / divisor;
+}
+
 CC_NOINLINE void World_SetDimensions(int width, int height, int length) {
 	World.Width  = width; World.Height = height; World.Length = length;
 	World.Volume = width * height * length;
@@ -98,14 +117,10 @@ CC_NOINLINE void World_SetDimensions(int width, int height, int length) {
 	World.ChunksZ = (length + CHUNK_MAX) >> CHUNK_SHIFT;
 
 	World.ChunksCount = World.ChunksX * World.ChunksY * World.ChunksZ;
-}
 
-#ifdef EXTENDED_BLOCKS
-void World_SetMapUpper(BlockRaw* blocks) {
-	World.Blocks2 = blocks;
-	World.IDMask  = 0x3FF;
+	CalcReciprocal(width,  &World.WidthMul,  &World.WidthShift);
+	CalcReciprocal(length, &World.LengthMul, &World.LengthShift);
 }
-#endif
 
 void World_OutOfMemory(void) {
 	Window_ShowDialog("Out of memory", "Not enough free memory to load the map.\nTry joining a different map.");
@@ -113,30 +128,351 @@ void World_OutOfMemory(void) {
 }
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------World sections------------------------------------------------------*
+*#########################################################################################################################*/
+/* Block that every block in each chunk sized section of the map is, or SECTION_MIXED */
+/* NOTE: Sections only ever change from uniform to mixed when blocks are changed, */
+/*  as working out whether a mixed section became uniform again would need to check every block of it */
+static cc_uint16* sections;
+#define SECTION_MIXED 0xFFFF
+/* Version of each section of the map, incremented whenever a block in that section is changed */
+static volatile cc_uint32* versions;
+/* Whether each section of the map has not been received yet */
+static cc_uint8* pendingSections;
+static int pendingCount;
+#ifdef EXTENDED_BLOCKS
+/* Whether any block in each section of the map has upper 8 bits set */
+static cc_uint8* upperSections;
+#endif
+
+/* Clamps the given area of the map to the range of sections that overlap it */
+#define Sections_GetRange(x1, y1, z1, x2, y2, z2) \
+	cx1 = max(0, x1) >> CHUNK_SHIFT; cx2 = min(World.MaxX, x2) >> CHUNK_SHIFT; \
+	cy1 = max(0, y1) >> CHUNK_SHIFT; cy2 = min(World.MaxY, y2) >> CHUNK_SHIFT; \
+	cz1 = max(0, z1) >> CHUNK_SHIFT; cz2 = min(World.MaxZ, z2) >> CHUNK_SHIFT;
+
+static void Sections_Free(void) {
+	Mem_Free(sections);
+	Mem_Free((void*)versions);
+	Mem_Free(pendingSections);
+	sections = NULL;
+	versions = NULL;
+	pendingSections = NULL;
+	pendingCount    = 0;
+#ifdef EXTENDED_BLOCKS
+	Mem_Free(upperSections);
+	upperSections = NULL;
+#endif
+}
+
+static int Sections_CalcBlock(int x1, int y1, int z1) {
+	int x2 = min(World.Width,  x1 + CHUNK_SIZE);
+	int y2 = min(World.Height, y1 + CHUNK_SIZE);
+	int z2 = min(World.Length, z1 + CHUNK_SIZE);
+	int x, y, z, index;
+	BlockID block = World_GetBlock(x1, y1, z1);
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			index = World_Pack(x1, y, z);
+
+			for (x = x1; x < x2; x++, index++) {
+				if (World_GetRawBlock(index) != block) return SECTION_MIXED;
+			}
+		}
+	}
+	return block;
+}
+
+#ifdef EXTENDED_BLOCKS
+static cc_bool Sections_CalcUpper(int x1, int y1, int z1) {
+	int x2 = min(World.Width,  x1 + CHUNK_SIZE);
+	int y2 = min(World.Height, y1 + CHUNK_SIZE);
+	int z2 = min(World.Length, z1 + CHUNK_SIZE);
+	int x, y, z, index;
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			index = World_Pack(x1, y, z);
+
+			for (x = x1; x < x2; x++, index++) {
+				if (World_GetUpperBlock(index)) return true;
+			}
+		}
+	}
+	return false;
+}
+#endif
+
+static void Sections_Calculate(void) {
+	int cx, cy, cz, index = 0;
+	Sections_Free();
+	if (!World.Blocks) return;
+	versions = (volatile cc_uint32*)Mem_AllocCleared(World.ChunksCount, sizeof(cc_uint32), "section versions");
+#ifdef EXTENDED_BLOCKS
+	upperSections = (cc_uint8*)Mem_TryAllocCleared(World.ChunksCount, sizeof(cc_uint8));
+
+	if (upperSections && World.IDMask > 0xFF) {
+		for (cz = 0; cz < World.ChunksZ; cz++) {
+			for (cy = 0; cy < World.ChunksY; cy++) {
+				for (cx = 0; cx < World.ChunksX; cx++, index++) {
+					upperSections[index] = Sections_CalcUpper(cx << CHUNK_SHIFT, cy << CHUNK_SHIFT, cz << CHUNK_SHIFT);
+				}
+			}
+		}
+		index = 0;
+	}
+#endif
+
+	/* Not having sections just means world can't be skipped over as quickly */
+	sections = (cc_uint16*)Mem_TryAlloc(World.ChunksCount, sizeof(cc_uint16));
+	if (!sections) return;
+
+	/* NOTE: Order matches World_ChunkPack */
+	for (cz = 0; cz < World.ChunksZ; cz++) {
+		for (cy = 0; cy < World.ChunksY; cy++) {
+			for (cx = 0; cx < World.ChunksX; cx++, index++) {
+				sections[index] = Sections_CalcBlock(cx << CHUNK_SHIFT, cy << CHUNK_SHIFT, cz << CHUNK_SHIFT);
+			}
+		}
+	}
+}
+
+/* NOTE: Must be called after the block has been written to the map */
+static CC_INLINE void Sections_Update(int x, int y, int z, BlockID block) {
+	int index;
+	if (!versions) return;
+
+	index = World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+	versions[index]++;
+
+#ifdef EXTENDED_BLOCKS
+	if (upperSections && block >= 256) upperSections[index] = true;
+#endif
+	if (!sections) return;
+	if (sections[index] != block) sections[index] = SECTION_MIXED;
+}
+
+int World_GetSectionBlock(int cx, int cy, int cz) {
+	int block, index;
+	if (!sections) return WORLD_SECTION_MIXED;
+
+	index = World_ChunkPack(cx, cy, cz);
+	/* Pending sections are solid, even though they only contain air so far */
+	if (pendingCount && pendingSections[index]) return WORLD_SECTION_MIXED;
+
+	block = sections[index];
+	return block == SECTION_MIXED ? WORLD_SECTION_MIXED : block;
+}
+
+cc_uint32 World_GetVersionStamp(int x1, int y1, int z1, int x2, int y2, int z2) {
+	int cx1, cy1, cz1, cx2, cy2, cz2;
+	int cx, cy, cz;
+	cc_uint32 stamp = 0;
+	if (!versions) return 0;
+	Sections_GetRange(x1, y1, z1, x2, y2, z2);
+
+	/* Versions only ever increase, so their sum changes whenever any of them changes */
+	for (cz = cz1; cz <= cz2; cz++) {
+		for (cy = cy1; cy <= cy2; cy++) {
+			for (cx = cx1; cx <= cx2; cx++) {
+				stamp += versions[World_ChunkPack(cx, cy, cz)];
+			}
+		}
+	}
+	return stamp;
+}
+
+void World_RefreshSections(int x1, int y1, int z1, int x2, int y2, int z2) {
+	int cx1, cy1, cz1, cx2, cy2, cz2;
+	int cx, cy, cz, index;
+	if (!versions) return;
+	Sections_GetRange(x1, y1, z1, x2, y2, z2);
+
+	for (cz = cz1; cz <= cz2; cz++) {
+		for (cy = cy1; cy <= cy2; cy++) {
+			for (cx = cx1; cx <= cx2; cx++) {
+				index = World_ChunkPack(cx, cy, cz);
+				versions[index]++;
+#ifdef EXTENDED_BLOCKS
+				if (upperSections && World.IDMask > 0xFF) {
+					upperSections[index] = Sections_CalcUpper(cx << CHUNK_SHIFT, cy << CHUNK_SHIFT, cz << CHUNK_SHIFT);
+				}
+#endif
+				if (sections) sections[index] = Sections_CalcBlock(cx << CHUNK_SHIFT, cy << CHUNK_SHIFT, cz << CHUNK_SHIFT);
+			}
+		}
+	}
+}
+
+cc_bool World_MarkSectionsPending(void) {
+	if (!pendingSections) pendingSections = (cc_uint8*)Mem_TryAlloc(World.ChunksCount, 1);
+	if (!pendingSections) return false;
+
+	Mem_Set(pendingSections, true, World.ChunksCount);
+	pendingCount = World.ChunksCount;
+	return true;
+}
+
+void World_MarkSectionReceived(int cx, int cy, int cz) {
+	int index;
+	if (!pendingSections) return;
+
+	index = World_ChunkPack(cx, cy, cz);
+	if (!pendingSections[index]) return;
+	pendingSections[index] = false;
+
+	pendingCount--;
+}
+
+void World_ClearPendingSections(void) {
+	/* NOTE: Not freed until the map is, as mesh builder threads may be reading it */
+	if (pendingSections) Mem_Set(pendingSections, 0, World.ChunksCount);
+	pendingCount = 0;
+}
+
+#ifdef EXTENDED_BLOCKS
+cc_bool World_HasUpperBlocks(int x1, int y1, int z1, int x2, int y2, int z2) {
+	int cx1, cy1, cz1, cx2, cy2, cz2;
+	int cx, cy, cz;
+	if (World.IDMask <= 0xFF) return false;
+	if (!upperSections)       return true;
+	Sections_GetRange(x1, y1, z1, x2, y2, z2);
+
+	for (cz = cz1; cz <= cz2; cz++) {
+		for (cy = cy1; cy <= cy2; cy++) {
+			for (cx = cx1; cx <= cx2; cx++) {
+				if (upperSections[World_ChunkPack(cx, cy, cz)]) return true;
+			}
+		}
+	}
+	return false;
+}
+#endif
+
+
 #ifdef EXTENDED_BLOCKS
-static CC_NOINLINE void LazyInitUpper(int i, BlockID block) {
-	BlockRaw* data = (BlockRaw*)Mem_TryAllocCleared(World.Volume, 1);
-	if (!data) { World_OutOfMemory(); return; }
+/*########################################################################################################################*
+*------------------------------------------------------Upper blocks-------------------------------------------------------*
+*#########################################################################################################################*/
+enum UPPER_MODE { 
+	UPPER_NONE,   /* No blocks use the upper 8 bits, pages point into World.Blocks */
+	UPPER_SPARSE, /* Pages are individually allocated, or point to upperEmptyPage */
+	UPPER_DENSE   /* Pages point into upperDense */
+};
+static cc_uint8 upperMode;
+static int upperPagesCount, upperPagesUsed;
+/* Upper 8 bits of all blocks when stored in one single array */
+static BlockRaw* upperDense;
+/* Page shared by all sparse pages which have no upper bits set */
+static BlockRaw upperEmptyPage[WORLD_PAGE_SIZE];
+
+static void Upper_Free(void) {
+	int i;
+	if (upperMode == UPPER_SPARSE) {
+		for (i = 0; i < upperPagesCount; i++) {
+			if (World.Blocks2Pages[i] != upperEmptyPage) Mem_Free(World.Blocks2Pages[i]);
+		}
+	}
+	Mem_Free(upperDense);
+	Mem_Free(World.Blocks2Pages);
+
+	upperDense         = NULL;
+	World.Blocks2Pages = NULL;
+	World.IDMask       = 0xFF;
+	upperMode          = UPPER_NONE;
+	upperPagesCount    = 0;
+	upperPagesUsed     = 0;
+}
+
+static void Upper_SetPages(BlockRaw* blocks) {
+	int i;
+	for (i = 0; i < upperPagesCount; i++) {
+		World.Blocks2Pages[i] = blocks ? blocks + (i << WORLD_PAGE_SHIFT) : upperEmptyPage;
+	}
+}
+
+static void Upper_Init(void) {
+	if (!World.Blocks) { Upper_Free(); return; }
+	upperPagesCount    = (World.Volume + WORLD_PAGE_MASK) >> WORLD_PAGE_SHIFT;
+	World.Blocks2Pages = (BlockRaw**)Mem_Alloc(upperPagesCount, sizeof(BlockRaw*), "upper block pages");
+
+	/* .cw maps may have set this to a non-NULL when importing */
+	if (upperDense) {
+		Upper_SetPages(upperDense);
+		upperMode = UPPER_DENSE;
+	} else {
+		Upper_SetPages(World.Blocks);
+		upperMode = UPPER_NONE;
+	}
+}
+
+void World_SetMapUpper(BlockRaw* blocks) {
+	/* NOTE: Pages are set up afterwards by World_SetNewMap */
+	Upper_Free();
+	upperDense   = blocks;
+	World.IDMask = 0x3FF;
+}
+
+/* Many small allocations fragment the heap, so once most pages are */
+/*  used anyway just switch to storing upper blocks in a single array */
+static void Upper_MakeDense(void) {
+	BlockRaw* dense = (BlockRaw*)Mem_TryAllocCleared(World.Volume, 1);
+	BlockRaw* page;
+	int i, offset;
+	if (!dense) return; /* sparse pages still work fine */
+
+	for (i = 0; i < upperPagesCount; i++) {
+		page = World.Blocks2Pages[i];
+		if (page == upperEmptyPage) continue;
+
+		offset = i << WORLD_PAGE_SHIFT;
+		Mem_Copy(dense + offset, page, min(WORLD_PAGE_SIZE, World.Volume - offset));
+		Mem_Free(page);
+	}
+
+	upperDense     = dense;
+	upperMode      = UPPER_DENSE;
+	upperPagesUsed = 0;
+	Upper_SetPages(dense);
+}
+
+static CC_NOINLINE void Upper_AllocPage(int i, BlockID block) {
+	BlockRaw* page;
+	if (upperMode == UPPER_NONE) {
+		Upper_SetPages(NULL);
+		upperMode    = UPPER_SPARSE;
+		World.IDMask = 0x3FF;
+	}
+
+	page = (BlockRaw*)Mem_TryAllocCleared(WORLD_PAGE_SIZE, 1);
+	if (!page) { World_OutOfMemory(); return; }
 
-	World_SetMapUpper(data);
-	World.Blocks2[i] = (BlockRaw)(block >> 8);
+	World.Blocks2Pages[i >> WORLD_PAGE_SHIFT] = page;
+	page[i & WORLD_PAGE_MASK] = (BlockRaw)(block >> 8);
+	if (++upperPagesUsed * 2 > upperPagesCount) Upper_MakeDense();
 }
 
 void World_SetBlock(int x, int y, int z, BlockID block) {
 	int i = World_Pack(x, y, z);
+	BlockRaw* page;
 	World.Blocks[i] = (BlockRaw)block;
+	Sections_Update(x, y, z, block);
 
-	/* defer allocation of second map array if possible */
-	if (World.Blocks == World.Blocks2) {
+	/* defer allocation of upper block pages if possible */
+	page = World.Blocks2Pages[i >> WORLD_PAGE_SHIFT];
+	if (upperMode == UPPER_NONE || page == upperEmptyPage) {
 		if (block < 256) return;
-		LazyInitUpper(i, block);
+		Upper_AllocPage(i, block);
 		return;
 	}
-	World.Blocks2[i] = (BlockRaw)(block >> 8);
+	page[i & WORLD_PAGE_MASK] = (BlockRaw)(block >> 8);
 }
 #else
 void World_SetBlock(int x, int y, int z, BlockID block) {
 	World.Blocks[World_Pack(x, y, z)] = block; 
+	Sections_Update(x, y, z, block);
 }
 #endif
 
@@ -144,6 +480,9 @@ BlockID World_GetPhysicsBlock(int x, int y, int z) {
 	if (y < 0 || !World_ContainsXZ(x, z)) return BLOCK_BEDROCK;
 	if (y >= World.Height) return BLOCK_AIR;
 
+	/* Stops entities falling through parts of the map that are still being received */
+	if (pendingCount && pendingSections[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)]) 
+		return BLOCK_BEDROCK;
 	return World_GetBlock(x, y, z);
 }
 
@@ -11,8 +11,11 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 struct AABB;
 extern struct IGameComponent World_Component;
 
-/* Unpacka an index into x,y,z (slow!) */
-#define World_Unpack(idx, x, y, z) x = idx % World.Width; z = (idx / World.Width) % World.Length; y = (idx / World.Width) / World.Length;
+/* Divides a non-negative value by World.Width/World.Length, using multiplication by a reciprocal instead of division */
+#define World_DivWidth(value)  ((int)(((cc_uint64)(value) * World.WidthMul)  >> World.WidthShift))
+#define World_DivLength(value) ((int)(((cc_uint64)(value) * World.LengthMul) >> World.LengthShift))
+/* Unpacks an index into x,y,z */
+#define World_Unpack(idx, x, y, z) z = World_DivWidth(idx); x = (idx) - z * World.Width; y = World_DivLength(z); z -= y * World.Length;
 /* Packs an x,y,z into a single index */
 #define World_Pack(x, y, z) (((y) * World.Length + (z)) * World.Width + (x))
 #define WORLD_UUID_LEN 16
@@ -25,9 +28,10 @@ CC_VAR extern struct _WorldData {
 	/* The blocks in the world. */
 	BlockRaw* Blocks;
 #ifdef EXTENDED_BLOCKS
-	/* The upper 8 bit of blocks in the world. */
-	/* If only 8 bit blocks are used, equals World_Blocks. */
-	BlockRaw* Blocks2;
+	/* The upper 8 bit of blocks in the world, split into pages of WORLD_PAGE_SIZE blocks. */
+	/* If only 8 bit blocks are used, the pages point into World.Blocks. */
+	/* NOTE: Pages with no upper bits set may all point to the same shared page. */
+	BlockRaw** Blocks2Pages;
 #endif
 	/* Volume of the world. */
 	int Volume;
@@ -43,7 +47,7 @@ CC_VAR extern struct _WorldData {
 	cc_uint8 Uuid[WORLD_UUID_LEN];
 
 #ifdef EXTENDED_BLOCKS
-	/* Masks access to World.Blocks/World.Blocks2 */
+	/* Masks access to World.Blocks/World.Blocks2Pages */
 	/* e.g. this will be 255 if only 8 bit blocks are used */
 	int IDMask;
 #endif
@@ -60,6 +64,9 @@ CC_VAR extern struct _WorldData {
 	int ChunksCount;
 	/* Seed world was generated with. May be 0 (unknown) */
 	int Seed;
+	/* Reciprocals of Width and Length, used by World_Unpack to avoid slow integer division */
+	cc_uint64 WidthMul, LengthMul;
+	int WidthShift, LengthShift;
 } World;
 
 /* Frees the blocks array, sets dimensions to 0, resets environment to default. */
@@ -76,10 +83,18 @@ CC_NOINLINE void World_SetDimensions(int width, int height, int length);
 void World_OutOfMemory(void);
 
 #ifdef EXTENDED_BLOCKS
-/* Sets World.Blocks2 and updates internal state for more than 256 blocks. */
+/* Sets the upper 8 bits of all blocks and updates internal state for more than 256 blocks. */
+/* NOTE: blocks must be World.Volume long, and is freed by World_Reset */
 void World_SetMapUpper(BlockRaw* blocks);
+/* Whether any blocks within the given area of the map have upper 8 bits set */
+cc_bool World_HasUpperBlocks(int x1, int y1, int z1, int x2, int y2, int z2);
 
-#define World_GetRawBlock(idx) ((World.Blocks[idx] | (World.Blocks2[idx] << 8)) & World.IDMask)
+#define WORLD_PAGE_SHIFT 12
+#define WORLD_PAGE_SIZE  (1 << WORLD_PAGE_SHIFT)
+#define WORLD_PAGE_MASK  (WORLD_PAGE_SIZE - 1)
+
+#define World_GetUpperBlock(idx) World.Blocks2Pages[(idx) >> WORLD_PAGE_SHIFT][(idx) & WORLD_PAGE_MASK]
+#define World_GetRawBlock(idx) ((World.Blocks[idx] | (World_GetUpperBlock(idx) << 8)) & World.IDMask)
 
 /* Gets the block at the given coordinates. */
 /* NOTE: Does NOT check that the coordinates are inside the map. */
@@ -94,6 +109,7 @@ static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
 
 /* If Y is above the map, returns BLOCK_AIR. */
 /* If coordinates are outside the map, returns BLOCK_AIR. */
+/* If the coordinates are in a section that is still pending, returns BLOCK_BEDROCK. */
 /* Otherwise returns the block at the given coordinates. */
 BlockID World_GetPhysicsBlock(int x, int y, int z);
 /* Sets the block at the given coordinates. */
@@ -103,6 +119,28 @@ void World_SetBlock(int x, int y, int z, BlockID block);
 /* Otherwise returns the block at the given coordinates. */
 BlockID World_SafeGetBlock(int x, int y, int z);
 
+#define WORLD_SECTION_MIXED -1
+/* Returns the block that every block in the given chunk sized section of the map is, */
+/*  or WORLD_SECTION_MIXED if the section contains (or may contain) different blocks */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+int World_GetSectionBlock(int cx, int cy, int cz);
+/* Returns a stamp that changes whenever any block within the given area of the map is changed */
+/* NOTE: This allows other threads to copy blocks from the map without any locking, */
+/*  by checking the stamp is still the same after copying and otherwise copying again */
+cc_uint32 World_GetVersionStamp(int x1, int y1, int z1, int x2, int y2, int z2);
+/* Recalculates the sections overlapping the given area of the map, and changes their version stamps */
+/* NOTE: Must be called after blocks have been written directly into World.Blocks */
+void World_RefreshSections(int x1, int y1, int z1, int x2, int y2, int z2);
+
+/* Marks every section of the map as not having been received yet (e.g. when streaming the map) */
+/* NOTE: Pending sections are solid for collision detection, but otherwise act as air */
+/* Returns false if there isn't enough memory to track which sections are pending */
+cc_bool World_MarkSectionsPending(void);
+/* Marks the given section of the map as received */
+void World_MarkSectionReceived(int cx, int cy, int cz);
+/* Marks every section of the map as received */
+void World_ClearPendingSections(void);
+
 /* Whether the given coordinates lie inside the map. */
 static CC_INLINE cc_bool World_Contains(int x, int y, int z) {
 	return (unsigned)x < (unsigned)World.Width
@@ -21,35 +21,326 @@
 #define uint_to_ptr(raw) ((void*)((cc_uintptr)(raw)))
 #define ptr_to_uint(raw) ((GLuint)((cc_uintptr)(raw)))
 
+/* glMultiDrawElements is core since OpenGL 1.4, but isn't available in OpenGL ES */
+typedef void (APIENTRY *FP_glMultiDrawElements)(GLenum mode, const GLsizei* count, GLenum type, const GLvoid* const* indices, GLsizei drawcount);
+static FP_glMultiDrawElements _glMultiDrawElements;
+
+#define _GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define _GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+/* glCompressedTexImage2D is core since OpenGL 1.3 and OpenGL ES 2.0, but S3TC formats are an extension */
+typedef void (APIENTRY *FP_glCompressedTexImage2D)(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid* data);
+static FP_glCompressedTexImage2D _glCompressedTexImage2D;
+
+static void GL_LoadCompressedTextures(void) {
+	static const cc_string s3tcExt = String_FromConst("GL_EXT_texture_compression_s3tc");
+	cc_string exts = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	if (!String_CaselessContains(&exts, &s3tcExt)) return;
+
+	_glCompressedTexImage2D = (FP_glCompressedTexImage2D)GLContext_GetAddress("glCompressedTexImage2D");
+	Gfx.SupportsCompressedTextures = _glCompressedTexImage2D != NULL;
+}
+
+static void GL_LoadMultiDraw(void) {
+#ifndef CC_BUILD_GLES
+	/* NOTE: Some EGL implementations return non-NULL for unsupported functions, so don't even try there */
+	_glMultiDrawElements  = (FP_glMultiDrawElements)GLContext_GetAddress("glMultiDrawElements");
+	Gfx.SupportsMultiDraw = _glMultiDrawElements != NULL;
+#endif
+}
+
+/* glFenceSync is core since OpenGL 3.2 and OpenGL ES 3.0, but is an extension (GL_ARB_sync) before then */
+typedef void* GL_SyncObject;
+typedef GL_SyncObject (APIENTRY *FP_glFenceSync)(GLenum condition, GLuint flags);
+typedef GLenum (APIENTRY *FP_glClientWaitSync)(GL_SyncObject sync, GLuint flags, cc_uint64 timeout);
+typedef void   (APIENTRY *FP_glDeleteSync)(GL_SyncObject sync);
+static FP_glFenceSync      _glFenceSync;
+static FP_glClientWaitSync _glClientWaitSync;
+static FP_glDeleteSync     _glDeleteSync;
+
+#define _GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define _GL_SYNC_FLUSH_COMMANDS_BIT    0x0001
+
+static void GL_LoadFenceSync(void) {
+	const char* ver = (const char*)glGetString(GL_VERSION);
+#ifdef CC_BUILD_GLES
+	/* Version string is always: OpenGL ES x.y (and whatever afterwards) */
+	if (ver[9] != ' ' || ver[10] < '3') return;
+#else
+	static const cc_string syncExt = String_FromConst("GL_ARB_sync");
+	cc_string exts = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	int major = ver[0] - '0', minor = ver[2] - '0';
+
+	if (major < 3 || (major == 3 && minor < 2)) {
+		if (!String_CaselessContains(&exts, &syncExt)) return;
+	}
+#endif
+	_glFenceSync      = (FP_glFenceSync)GLContext_GetAddress("glFenceSync");
+	_glClientWaitSync = (FP_glClientWaitSync)GLContext_GetAddress("glClientWaitSync");
+	_glDeleteSync     = (FP_glDeleteSync)GLContext_GetAddress("glDeleteSync");
+	if (!_glClientWaitSync || !_glDeleteSync) _glFenceSync = NULL;
+}
+
+/* Query objects are core since OpenGL 1.5, but GL_TIME_ELAPSED requires OpenGL 3.3 or GL_ARB_timer_query */
+typedef void (APIENTRY *FP_glGenQueries)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *FP_glDeleteQueries)(GLsizei n, const GLuint* ids);
+typedef void (APIENTRY *FP_glBeginQuery)(GLenum target, GLuint id);
+typedef void (APIENTRY *FP_glEndQuery)(GLenum target);
+typedef void (APIENTRY *FP_glGetQueryObjectuiv)(GLuint id, GLenum pname, GLuint* params);
+static FP_glGenQueries        _glGenQueries;
+static FP_glDeleteQueries     _glDeleteQueries;
+static FP_glBeginQuery        _glBeginQuery;
+static FP_glEndQuery          _glEndQuery;
+static FP_glGetQueryObjectuiv _glGetQueryObjectuiv;
+
+#define _GL_TIME_ELAPSED           0x88BF
+#define _GL_QUERY_RESULT           0x8866
+#define _GL_QUERY_RESULT_AVAILABLE 0x8867
+
+static void GL_LoadTimerQueries(void) {
+#ifndef CC_BUILD_GLES
+	/* NOTE: OpenGL ES only supports GL_TIME_ELAPSED through GL_EXT_disjoint_timer_query, so don't even try there */
+	static const cc_string timerExt = String_FromConst("GL_ARB_timer_query");
+	cc_string exts  = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	const char* ver = (const char*)glGetString(GL_VERSION);
+	int major = ver[0] - '0', minor = ver[2] - '0';
+
+	if (major < 3 || (major == 3 && minor < 3)) {
+		if (!String_CaselessContains(&exts, &timerExt)) return;
+	}
+	_glGenQueries        = (FP_glGenQueries)GLContext_GetAddress("glGenQueries");
+	_glDeleteQueries     = (FP_glDeleteQueries)GLContext_GetAddress("glDeleteQueries");
+	_glEndQuery          = (FP_glEndQuery)GLContext_GetAddress("glEndQuery");
+	_glGetQueryObjectuiv = (FP_glGetQueryObjectuiv)GLContext_GetAddress("glGetQueryObjectuiv");
+	if (!_glGenQueries || !_glDeleteQueries || !_glEndQuery || !_glGetQueryObjectuiv) return;
+	_glBeginQuery        = (FP_glBeginQuery)GLContext_GetAddress("glBeginQuery");
+#endif
+}
+
+/* Pixel pack buffers are core since OpenGL 2.1, but are an extension (GL_ARB_pixel_buffer_object) before then */
+/* NOTE: Buffer functions are loaded separately here, since the GL1 backend may be emulating its own ones */
+typedef void      (APIENTRY *FP_glPackGenBuffers)(GLsizei n, GLuint* buffers);
+typedef void      (APIENTRY *FP_glPackDeleteBuffers)(GLsizei n, const GLuint* buffers);
+typedef void      (APIENTRY *FP_glPackBindBuffer)(GLenum target, GLuint buffer);
+typedef void      (APIENTRY *FP_glPackBufferData)(GLenum target, cc_uintptr size, const GLvoid* data, GLenum usage);
+typedef void*     (APIENTRY *FP_glPackMapBuffer)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY *FP_glPackUnmapBuffer)(GLenum target);
+static struct GLPackBufferFuncs {
+	FP_glPackGenBuffers    GenBuffers;
+	FP_glPackDeleteBuffers DeleteBuffers;
+	FP_glPackBindBuffer    BindBuffer;
+	FP_glPackBufferData    BufferData;
+	FP_glPackMapBuffer     MapBuffer;
+	FP_glPackUnmapBuffer   UnmapBuffer;
+} gl_pack;
+
+#define _GL_PIXEL_PACK_BUFFER 0x88EB
+#define _GL_STREAM_READ       0x88E1
+#define _GL_READ_ONLY         0x88B8
+
+static void GL_LoadPackBuffers(void) {
+#ifndef CC_BUILD_GLES
+	/* NOTE: OpenGL ES 2.0 doesn't support pixel pack buffers, and 3.0 doesn't support glMapBuffer */
+	static const cc_string pboExt = String_FromConst("GL_ARB_pixel_buffer_object");
+	cc_string exts  = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	const char* ver = (const char*)glGetString(GL_VERSION);
+	int major = ver[0] - '0', minor = ver[2] - '0';
+
+	if (major < 2 || (major == 2 && minor < 1)) {
+		if (!String_CaselessContains(&exts, &pboExt)) return;
+	}
+	gl_pack.GenBuffers    = (FP_glPackGenBuffers)GLContext_GetAddress("glGenBuffers");
+	gl_pack.DeleteBuffers = (FP_glPackDeleteBuffers)GLContext_GetAddress("glDeleteBuffers");
+	gl_pack.BindBuffer    = (FP_glPackBindBuffer)GLContext_GetAddress("glBindBuffer");
+	gl_pack.BufferData    = (FP_glPackBufferData)GLContext_GetAddress("glBufferData");
+	gl_pack.UnmapBuffer   = (FP_glPackUnmapBuffer)GLContext_GetAddress("glUnmapBuffer");
+	if (!gl_pack.GenBuffers || !gl_pack.DeleteBuffers || !gl_pack.BindBuffer) return;
+	if (!gl_pack.BufferData || !gl_pack.UnmapBuffer) return;
+	gl_pack.MapBuffer     = (FP_glPackMapBuffer)GLContext_GetAddress("glMapBuffer");
+#endif
+}
+
+/* Fills out the index counts and offsets for drawing the given ranges with the default index buffer */
+/* Returns false if any range can't be drawn from the start of the vertex buffer with 16 bit indices */
+static cc_bool GL_CalcDrawRanges(const int* counts, const int* startVertices, int rangesCount,
+								GLsizei* icounts, const GLvoid** offsets) {
+	int i;
+	for (i = 0; i < rangesCount; i++)
+	{
+		if (startVertices[i] + counts[i] > GFX_MAX_VERTICES) return false;
+		icounts[i] = ICOUNT(counts[i]);
+		/* ICOUNT(startVertex) * 2 = startVertex * 3  */
+		offsets[i] = uint_to_ptr(startVertices[i] * 3);
+	}
+	return true;
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------------General---------------------------------------------------------*
 *#########################################################################################################################*/
 static void GLBackend_Init(void);
 
+static void GL_ResetStateCache(void);
+
 void Gfx_Create(void) {
 	GLContext_Create();
+	GL_ResetStateCache();
 	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &Gfx.MaxTexWidth);
 	Gfx.MaxTexHeight = Gfx.MaxTexWidth;
 	Gfx.Created      = true;
 	/* necessary for android which "loses" context when window is closed */
 	Gfx.LostContext  = false;
+	Gfx.SupportsScaledScene = true;
 
 	GLBackend_Init();
 	Gfx_RestoreState();
 	GLContext_SetVSync(gfx_vsync);
 }
 
+static GL_SyncObject gl_fences[4];
+static int gl_fenceIndex, gl_gpuWaitTime;
+static void GL_ForgetGpuTimers(void);
+static void GL_FreeGpuTimers(void);
+static void GL_ForgetScreenshotRead(void);
+static void GL_FreeScreenshotRead(void);
+static void GL_ForgetSceneTexture(void);
+static void GL_FreeSceneTexture(void);
+
 cc_bool Gfx_TryRestoreContext(void) {
-	return GLContext_TryRestore();
+	if (!GLContext_TryRestore()) return false;
+	/* Context might have been recreated with default state */
+	GL_ResetStateCache();
+	Mem_Set(gl_fences, 0, sizeof(gl_fences));
+	GL_ForgetGpuTimers();
+	GL_ForgetScreenshotRead();
+	GL_ForgetSceneTexture();
+	return true;
+}
+
+static void GL_FreeFences(void) {
+	int i;
+	for (i = 0; i < Array_Elems(gl_fences); i++)
+	{
+		if (gl_fences[i]) _glDeleteSync(gl_fences[i]);
+		gl_fences[i] = NULL;
+	}
 }
 
 void Gfx_Free(void) {
 	Gfx_FreeState();
+	GL_FreeFences();
+	GL_FreeGpuTimers();
+	GL_FreeScreenshotRead();
+	GL_FreeSceneTexture();
 	GLContext_Free();
 }
 
-#define gl_Toggle(cap) if (enabled) { glEnable(cap); } else { glDisable(cap); }
+/* Waits until the GPU has finished rendering the frame submitted Gfx.MaxFramesInFlight frames ago */
+/* This way the CPU can't get too far ahead of the GPU, so input for the next frame is sampled */
+/*  just before the GPU can actually start rendering it (reducing input latency with VSync) */
+static void GL_LimitFramesInFlight(void) {
+	int frames = min(Gfx.MaxFramesInFlight, Array_Elems(gl_fences) - 1);
+	cc_uint64 beg;
+	int old;
+
+	gl_gpuWaitTime = 0;
+	if (!_glFenceSync || frames <= 0) return;
+
+	if (gl_fences[gl_fenceIndex]) _glDeleteSync(gl_fences[gl_fenceIndex]);
+	gl_fences[gl_fenceIndex] = _glFenceSync(_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	old = (gl_fenceIndex + Array_Elems(gl_fences) - frames) % Array_Elems(gl_fences);
+	gl_fenceIndex = (gl_fenceIndex + 1) % Array_Elems(gl_fences);
+	if (!gl_fences[old]) return;
+
+	/* Give up after a second, in case the GPU has hung */
+	beg = Stopwatch_Measure();
+	_glClientWaitSync(gl_fences[old], _GL_SYNC_FLUSH_COMMANDS_BIT, 1000 * 1000 * 1000);
+	gl_gpuWaitTime = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+	_glDeleteSync(gl_fences[old]);
+	gl_fences[old] = NULL;
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------GPU timers--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Queries are only read back a few frames after being issued, so that reading them doesn't stall */
+#define GPU_TIMER_FRAMES  3
+#define GPU_TIMER_QUERIES 32
+
+static struct GpuTimerFrame {
+	GLuint queries[GPU_TIMER_QUERIES];
+	cc_uint8 timers[GPU_TIMER_QUERIES];
+	int count;
+} gpu_frames[GPU_TIMER_FRAMES];
+static int gpu_frame, gpu_times[GFX_MAX_GPU_TIMERS];
+static cc_bool gpu_measuring;
+
+void Gfx_BeginGpuTimer(int timer) {
+	struct GpuTimerFrame* f = &gpu_frames[gpu_frame];
+	if (!_glBeginQuery || gpu_measuring || f->count == GPU_TIMER_QUERIES) return;
+
+	if (!f->queries[f->count]) _glGenQueries(1, &f->queries[f->count]);
+	f->timers[f->count] = (cc_uint8)timer;
+
+	_glBeginQuery(_GL_TIME_ELAPSED, f->queries[f->count]);
+	f->count++;
+	gpu_measuring = true;
+}
+
+void Gfx_EndGpuTimer(void) {
+	if (!gpu_measuring) return;
+	_glEndQuery(_GL_TIME_ELAPSED);
+	gpu_measuring = false;
+}
+
+int Gfx_GetGpuTime(int timer) { return _glBeginQuery ? gpu_times[timer] : -1; }
+
+/* Reads back the results of the queries issued GPU_TIMER_FRAMES - 1 frames ago */
+static void GL_CollectGpuTimers(void) {
+	int i, times[GFX_MAX_GPU_TIMERS] = { 0 };
+	struct GpuTimerFrame* f;
+	GLuint available, elapsed;
+
+	if (!_glBeginQuery) return;
+	Gfx_EndGpuTimer();
+	gpu_frame = (gpu_frame + 1) % GPU_TIMER_FRAMES;
+	f = &gpu_frames[gpu_frame];
+
+	for (i = 0; i < f->count; i++)
+	{
+		_glGetQueryObjectuiv(f->queries[i], _GL_QUERY_RESULT_AVAILABLE, &available);
+		/* GPU is running far behind, so just skip this frame's results */
+		if (!available) { f->count = 0; return; }
+
+		_glGetQueryObjectuiv(f->queries[i], _GL_QUERY_RESULT, &elapsed);
+		times[f->timers[i]] += elapsed / 1000;
+	}
+
+	Mem_Copy(gpu_times, times, sizeof(gpu_times));
+	f->count = 0;
+}
+
+/* Context was recreated, so all the previous query objects are gone */
+static void GL_ForgetGpuTimers(void) {
+	Mem_Set(gpu_frames, 0, sizeof(gpu_frames));
+	gpu_measuring = false;
+}
+
+static void GL_FreeGpuTimers(void) {
+	int i;
+	if (!_glBeginQuery) return;
+
+	for (i = 0; i < GPU_TIMER_FRAMES; i++)
+	{
+		_glDeleteQueries(GPU_TIMER_QUERIES, gpu_frames[i].queries);
+	}
+	GL_ForgetGpuTimers();
+}
+
 static void* tmpData;
 static int tmpSize;
 
@@ -64,6 +355,51 @@ static void* FastAllocTempMem(int size) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------State cache-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Tracks the state last sent to the GL driver, so that redundant GL calls can be skipped */
+/* NOTE: -1/~0 means the state is unknown, and so must always be sent to the driver */
+static struct GLStateCache {
+	GLuint texture, vb, ib;
+	cc_int8 cullFace, blend, depthTest, depthWrite;
+	int colorMask;
+	/* Vertex buffer and format that vertex attributes were last set up for */
+	GLuint attribsVb;
+	int attribsFormat;
+} gl_state;
+
+/* Number of state changing GL calls issued to/skipped over so far in the current frame */
+static int gl_callsIssued, gl_callsSkipped;
+/* Number of state changing GL calls issued to/skipped over in the previous frame */
+static int gl_lastCallsIssued, gl_lastCallsSkipped;
+
+static void GL_ResetStateCache(void) {
+	Mem_Set(&gl_state, 0xFF, sizeof(gl_state));
+}
+
+static void GL_BindTexture(GLuint id) {
+	if (gl_state.texture == id) { gl_callsSkipped++; return; }
+
+	gl_state.texture = id;
+	_glBindTexture(GL_TEXTURE_2D, id);
+	gl_callsIssued++;
+}
+
+static void GL_Toggle(GLenum cap, cc_int8* cur, cc_bool enabled) {
+	if (*cur == enabled) { gl_callsSkipped++; return; }
+
+	*cur = enabled;
+	if (enabled) { glEnable(cap); } else { glDisable(cap); }
+	gl_callsIssued++;
+}
+
+static void GL_EndFrameStats(void) {
+	gl_lastCallsIssued  = gl_callsIssued;  gl_callsIssued  = 0;
+	gl_lastCallsSkipped = gl_callsSkipped; gl_callsSkipped = 0;
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------------Textures--------------------------------------------------------*
 *#########################################################################################################################*/
@@ -118,10 +454,20 @@ static CC_NOINLINE void UpdateTextureSlow(int x, int y, struct Bitmap* part, int
 	if (count > UPDATE_FAST_SIZE) Mem_Free(ptr);
 }
 
+static void UploadCompressedTexture(struct Bitmap* bmp, int rowWidth) {
+	cc_uint32 size;
+	cc_bool alpha;
+	cc_uint8* data = CompressTexture(bmp, rowWidth, &alpha, &size);
+
+	_glCompressedTexImage2D(GL_TEXTURE_2D, 0, alpha ? _GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : _GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+							bmp->width, bmp->height, 0, size, data);
+	Mem_Free(data);
+}
+
 static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags, cc_bool mipmaps) {
 	GfxResourceID texId = NULL;
 	_glGenTextures(1, (GLuint*)&texId);
-	_glBindTexture(GL_TEXTURE_2D, ptr_to_uint(texId));
+	GL_BindTexture(ptr_to_uint(texId));
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (flags & TEXTURE_FLAG_BILINEAR) ? GL_LINEAR : GL_NEAREST);
 
 	if (mipmaps) {
@@ -134,7 +480,9 @@ static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (flags & TEXTURE_FLAG_BILINEAR) ? GL_LINEAR : GL_NEAREST);
 	}
 
-	if (bmp->width == rowWidth) {
+	if (flags & TEXTURE_FLAG_COMPRESSED) {
+		UploadCompressedTexture(bmp, rowWidth);
+	} else if (bmp->width == rowWidth) {
 		_glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bmp->width, bmp->height, 0, PIXEL_FORMAT, TRANSFER_FORMAT, bmp->scan0);
 	} else {
 		UpdateTextureSlow(0, 0, bmp, rowWidth, true);
@@ -145,7 +493,7 @@ static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8
 }
 
 void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) {
-	_glBindTexture(GL_TEXTURE_2D, ptr_to_uint(texId));
+	GL_BindTexture(ptr_to_uint(texId));
 
 	if (part->width == rowWidth) {
 		_glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, part->width, part->height, PIXEL_FORMAT, TRANSFER_FORMAT, part->scan0);
@@ -159,6 +507,8 @@ void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, i
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GLuint id = ptr_to_uint(*texId);
 	if (id) _glDeleteTextures(1, &id);
+	/* Deleting the bound texture reverts the binding to texture 0 */
+	if (id && gl_state.texture == id) gl_state.texture = 0;
 	*texId = 0;
 }
 
@@ -170,8 +520,8 @@ void Gfx_DisableMipmaps(void) { }
 *-----------------------------------------------------State management----------------------------------------------------*
 *#########################################################################################################################*/
 static PackedCol gfx_clearColor;
-void Gfx_SetFaceCulling(cc_bool enabled)   { gl_Toggle(GL_CULL_FACE); }
-static void SetAlphaBlend(cc_bool enabled) { gl_Toggle(GL_BLEND); }
+void Gfx_SetFaceCulling(cc_bool enabled)   { GL_Toggle(GL_CULL_FACE, &gl_state.cullFace, enabled); }
+static void SetAlphaBlend(cc_bool enabled) { GL_Toggle(GL_BLEND,     &gl_state.blend,    enabled); }
 void Gfx_SetAlphaArgBlend(cc_bool enabled) { }
 
 static void GL_ClearColor(PackedCol color) {
@@ -185,11 +535,22 @@ void Gfx_ClearColor(PackedCol color) {
 }
 
 static void SetColorWrite(cc_bool r, cc_bool g, cc_bool b, cc_bool a) {
+	int mask = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+	if (gl_state.colorMask == mask) { gl_callsSkipped++; return; }
+
+	gl_state.colorMask = mask;
 	glColorMask(r, g, b, a);
+	gl_callsIssued++;
 }
 
-void Gfx_SetDepthWrite(cc_bool enabled) { glDepthMask(enabled); }
-void Gfx_SetDepthTest(cc_bool enabled) { gl_Toggle(GL_DEPTH_TEST); }
+void Gfx_SetDepthWrite(cc_bool enabled) {
+	if (gl_state.depthWrite == enabled) { gl_callsSkipped++; return; }
+
+	gl_state.depthWrite = enabled;
+	glDepthMask(enabled);
+	gl_callsIssued++;
+}
+void Gfx_SetDepthTest(cc_bool enabled) { GL_Toggle(GL_DEPTH_TEST, &gl_state.depthTest, enabled); }
 
 
 /*########################################################################################################################*
@@ -236,19 +597,100 @@ static BitmapCol* GL_GetRow(struct Bitmap* bmp, int y, void* ctx) {
 	/* OpenGL stores bitmap in bottom-up order, so flip order when saving */
 	return Bitmap_GetRow(bmp, (bmp->height - 1) - y); 
 }
-cc_result Gfx_TakeScreenshot(struct Stream* output) {
-	struct Bitmap bmp;
-	cc_result res;
+cc_result Gfx_ReadScreenshot(struct Bitmap* bmp) {
 	GLint vp[4];
 	
 	glGetIntegerv(GL_VIEWPORT, vp); /* { x, y, width, height } */
-	bmp.width  = vp[2]; 
-	bmp.height = vp[3];
+	bmp->width  = vp[2]; 
+	bmp->height = vp[3];
+
+	bmp->scan0  = (BitmapCol*)Mem_TryAlloc(bmp->width * bmp->height, BITMAPCOLOR_SIZE);
+	if (!bmp->scan0) return ERR_OUT_OF_MEMORY;
+	glReadPixels(0, 0, bmp->width, bmp->height, PIXEL_FORMAT, TRANSFER_FORMAT, bmp->scan0);
+	return 0;
+}
+
+/* Without fences, assume the GPU has finished copying into the pack buffer after this many frames */
+#define GL_READ_MIN_FRAMES 2
+static GLuint gl_readBuffer;
+static GL_SyncObject gl_readFence;
+static int gl_readWidth, gl_readHeight, gl_readFrames;
+
+static void GL_ForgetScreenshotRead(void) {
+	gl_readBuffer = 0;
+	gl_readFence  = NULL;
+}
+
+static void GL_FreeScreenshotRead(void) {
+	if (gl_readBuffer) gl_pack.DeleteBuffers(1, &gl_readBuffer);
+	if (gl_readFence)  _glDeleteSync(gl_readFence);
+	GL_ForgetScreenshotRead();
+}
+
+cc_bool Gfx_BeginReadScreenshot(void) {
+	GLint vp[4];
+	if (!gl_pack.MapBuffer) return false;
+	GL_FreeScreenshotRead();
+
+	glGetIntegerv(GL_VIEWPORT, vp); /* { x, y, width, height } */
+	gl_readWidth  = vp[2];
+	gl_readHeight = vp[3];
+	gl_readFrames = 0;
+
+	gl_pack.GenBuffers(1, &gl_readBuffer);
+	gl_pack.BindBuffer(_GL_PIXEL_PACK_BUFFER, gl_readBuffer);
+	gl_pack.BufferData(_GL_PIXEL_PACK_BUFFER, (cc_uintptr)gl_readWidth * gl_readHeight * BITMAPCOLOR_SIZE, NULL, _GL_STREAM_READ);
+
+	/* With a pack buffer bound, glReadPixels returns immediately and the GPU copies into the buffer later */
+	glReadPixels(0, 0, gl_readWidth, gl_readHeight, PIXEL_FORMAT, TRANSFER_FORMAT, NULL);
+	gl_pack.BindBuffer(_GL_PIXEL_PACK_BUFFER, 0);
+
+	if (_glFenceSync) gl_readFence = _glFenceSync(_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	return true;
+}
+
+#define _GL_ALREADY_SIGNALED    0x911A
+#define _GL_CONDITION_SATISFIED 0x911C
+
+cc_bool Gfx_IsScreenshotReadDone(void) {
+	GLenum res;
+	if (!gl_readFence) return ++gl_readFrames > GL_READ_MIN_FRAMES;
+
+	res = _glClientWaitSync(gl_readFence, 0, 0);
+	return res == _GL_ALREADY_SIGNALED || res == _GL_CONDITION_SATISFIED;
+}
+
+cc_result Gfx_EndReadScreenshot(struct Bitmap* bmp) {
+	cc_result res = 0;
+	void* src;
+	/* Context was lost while the GPU was still copying */
+	if (!gl_readBuffer) return ERR_NOT_SUPPORTED;
+
+	bmp->width  = gl_readWidth;
+	bmp->height = gl_readHeight;
+	bmp->scan0  = (BitmapCol*)Mem_TryAlloc(bmp->width * bmp->height, BITMAPCOLOR_SIZE);
+	gl_pack.BindBuffer(_GL_PIXEL_PACK_BUFFER, gl_readBuffer);
+
+	if (!bmp->scan0) {
+		res = ERR_OUT_OF_MEMORY;
+	} else if (!(src = gl_pack.MapBuffer(_GL_PIXEL_PACK_BUFFER, _GL_READ_ONLY))) {
+		res = ERR_NOT_SUPPORTED;
+	} else {
+		Mem_Copy(bmp->scan0, src, bmp->width * bmp->height * BITMAPCOLOR_SIZE);
+		gl_pack.UnmapBuffer(_GL_PIXEL_PACK_BUFFER);
+	}
 
-	bmp.scan0  = (BitmapCol*)Mem_TryAlloc(bmp.width * bmp.height, BITMAPCOLOR_SIZE);
-	if (!bmp.scan0) return ERR_OUT_OF_MEMORY;
-	glReadPixels(0, 0, bmp.width, bmp.height, PIXEL_FORMAT, TRANSFER_FORMAT, bmp.scan0);
+	gl_pack.BindBuffer(_GL_PIXEL_PACK_BUFFER, 0);
+	GL_FreeScreenshotRead();
+	if (res) { Mem_Free(bmp->scan0); bmp->scan0 = NULL; }
+	return res;
+}
+
+cc_result Gfx_TakeScreenshot(struct Stream* output) {
+	struct Bitmap bmp;
+	cc_result res;
 
+	if ((res = Gfx_ReadScreenshot(&bmp))) return res;
 	res = Png_Encode(&bmp, output, GL_GetRow, false, NULL);
 	Mem_Free(bmp.scan0);
 	return res;
@@ -258,6 +700,11 @@ static void AppendVRAMStats(cc_string* info) {
 	static const cc_string memExt = String_FromConst("GL_NVX_gpu_memory_info");
 	GLint totalKb, curKb;
 	float total, cur;
+	int loaded = Atlas1D_LoadedCount();
+
+	/* Approximate, since doesn't include mipmaps */
+	cur = (float)Atlas2D.TileSize * Atlas2D.TileSize * Atlas1D.TilesPerAtlas * loaded * 4 / (1024.0f * 1024.0f);
+	String_Format3(info, "Terrain atlases: %i of %i loaded (%f2 MB)\n", &loaded, &Atlas1D.Count, &cur);
 
 	/* NOTE: glGetString returns UTF8, but I just treat it as code page 437 */
 	cc_string exts = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
@@ -287,6 +734,8 @@ void Gfx_GetApiInfo(cc_string* info) {
 	AppendVRAMStats(info);
 	PrintMaxTextureInfo(info);
 	String_Format1(info, "Depth buffer bits: %i\n",      &depthBits);
+	String_Format2(info, "State changes last frame: %i issued, %i skipped\n", &gl_lastCallsIssued, &gl_lastCallsSkipped);
+	if (_glFenceSync) String_Format2(info, "Frames in flight: %i (waited %i us for GPU)\n", &Gfx.MaxFramesInFlight, &gl_gpuWaitTime);
 	GLContext_GetApiInfo(info);
 }
 
@@ -313,8 +762,12 @@ void Gfx_EndFrame(void) {
 	}
 #endif
 	/* TODO always run ?? */
+	GL_EndFrameStats();
+
+	GL_CollectGpuTimers();
 
-	if (!GLContext_SwapBuffers()) Gfx_LoseContext("GLContext lost");
+	if (!GLContext_SwapBuffers()) { Gfx_LoseContext("GLContext lost"); return; }
+	GL_LimitFramesInFlight();
 }
 
 void Gfx_OnWindowResize(void) {
@@ -339,3 +792,61 @@ void Gfx_SetScissor(int x, int y, int w, int h) {
 
 	glScissor(x, Game.Height - h - y, w, h);
 }
+
+/* Texture the scaled 3D scene is copied into, before being stretched across the whole window */
+static GfxResourceID gl_sceneTex;
+static int gl_sceneTexWidth, gl_sceneTexHeight;
+
+static void GL_ForgetSceneTexture(void) {
+	gl_sceneTex = 0;
+	gl_sceneTexWidth  = 0;
+	gl_sceneTexHeight = 0;
+}
+
+static void GL_FreeSceneTexture(void) {
+	Gfx_DeleteTexture(&gl_sceneTex);
+	GL_ForgetSceneTexture();
+}
+
+static void GL_AllocSceneTexture(int width, int height) {
+	width  = Math_NextPowOf2(width);
+	height = Math_NextPowOf2(height);
+	if (gl_sceneTex && width <= gl_sceneTexWidth && height <= gl_sceneTexHeight) return;
+
+	GL_FreeSceneTexture();
+	_glGenTextures(1, (GLuint*)&gl_sceneTex);
+	GL_BindTexture(ptr_to_uint(gl_sceneTex));
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	_glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+	gl_sceneTexWidth  = width;
+	gl_sceneTexHeight = height;
+}
+
+void Gfx_BeginScaledScene(int width, int height) {
+	Gfx_SetViewport(0, 0, width, height);
+}
+
+void Gfx_EndScaledScene(int width, int height) {
+	struct Texture tex;
+	GL_AllocSceneTexture(width, height);
+	/* Copy the bottom left corner of the backbuffer that the scene was rendered into */
+	GL_BindTexture(ptr_to_uint(gl_sceneTex));
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+	Gfx_SetViewport(0, 0, Game.Width, Game.Height);
+
+	tex.ID = gl_sceneTex;
+	tex.x  = 0; tex.width  = Game.Width;
+	tex.y  = 0; tex.height = Game.Height;
+	/* Rows are stored bottom to top, so flip vertically (and inset by half a texel to avoid bleeding) */
+	Tex_SetUV(tex, 0.5f / gl_sceneTexWidth, (height - 0.5f) / gl_sceneTexHeight,
+		(width - 0.5f) / gl_sceneTexWidth, 0.5f / gl_sceneTexHeight);
+
+	Gfx_Begin2D(Game.Width, Game.Height);
+	Gfx_SetAlphaBlending(false);
+	Gfx_BindTexture(tex.ID);
+	Gfx_Draw2DTexture(&tex, PACKEDCOL_WHITE);
+	Gfx_End2D();
+}
@@ -8,14 +8,16 @@
 #include "Block.h"
 #include "Options.h"
 #include "Bitmap.h"
+#include "Stream.h"
 #include "Chat.h"
 #include "Logger.h"
+#include "TexturePack.h"
 
 struct _GfxData Gfx;
 static GfxResourceID Gfx_quadVb, Gfx_texVb;
 const cc_string Gfx_LowPerfMessage = String_FromConst("&eRunning in reduced performance mode (game minimised or hidden)");
 
-static const int strideSizes[] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED };
+static const int strideSizes[] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED, SIZEOF_VERTEX_CHUNK };
 /* Whether mipmaps must be created for all dimensions down to 1x1 or not */
 static cc_bool customMipmapsLevels;
 /* Current format and size of vertices */
@@ -124,20 +126,70 @@ static void RecreateDynamicVb(GfxResourceID* vb, VertexFormat fmt, int maxVertic
 	*vb = Gfx_CreateDynamicVb(fmt, maxVertices);
 }
 
+#ifdef CC_BUILD_STREAMVB
+/* Enough space for GFX_MAX_VERTICES textured vertices */
+#define STREAM_VB_SIZE (2 * 1024 * 1024)
+static GfxResourceID stream_vb;
+static cc_uint32 stream_offset;
+#endif
+
 static void InitDefaultResources(void) {
 	Gfx.DefaultIb = Gfx_CreateIb2(GFX_MAX_INDICES, MakeIndices, NULL);
 
 	RecreateDynamicVb(&Gfx_quadVb, VERTEX_FORMAT_COLOURED, 4);
 	RecreateDynamicVb(&Gfx_texVb,  VERTEX_FORMAT_TEXTURED, 4);
+#ifdef CC_BUILD_STREAMVB
+	RecreateDynamicVb(&stream_vb,  VERTEX_FORMAT_COLOURED, STREAM_VB_SIZE / SIZEOF_VERTEX_COLOURED);
+	stream_offset = 0;
+#endif
 }
 
 static void FreeDefaultResources(void) {
 	Gfx_DeleteDynamicVb(&Gfx_quadVb);
 	Gfx_DeleteDynamicVb(&Gfx_texVb);
+#ifdef CC_BUILD_STREAMVB
+	Gfx_DeleteDynamicVb(&stream_vb);
+#endif
 	Gfx_DeleteIb(&Gfx.DefaultIb);
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------Streaming vertex buffer-------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_STREAMVB
+/* Gives the vertex buffer new storage, so the driver doesn't have to wait for the GPU to finish with the old storage */
+static void Gfx_OrphanDynamicVb(GfxResourceID vb, cc_uint32 size);
+
+/* Vertices that are only drawn once (models, shadows, 2D quads etc) are appended after the previous */
+/*  vertices in a large buffer, instead of overwriting a small buffer that the GPU may still be reading from */
+/* Once the buffer is full, it is orphaned and written from the start again */
+void Gfx_DrawDynamicVb_IndexedTris(GfxResourceID vb, void* vertices, int vCount) {
+	cc_uint32 size  = vCount * gfx_stride;
+	cc_uint32 start = (stream_offset + gfx_stride - 1) / gfx_stride;
+
+	if (!stream_vb || size > STREAM_VB_SIZE) {
+		Gfx_SetDynamicVbData(vb, vertices, vCount);
+		Gfx_DrawVb_IndexedTris(vCount); return;
+	}
+
+	if (start * gfx_stride + size > STREAM_VB_SIZE) {
+		Gfx_OrphanDynamicVb(stream_vb, STREAM_VB_SIZE);
+		start = 0;
+	}
+
+	Gfx_SetDynamicVbRange(stream_vb, gfx_format, start, vertices, vCount);
+	stream_offset = start * gfx_stride + size;
+	Gfx_DrawVb_IndexedTris_Range(vCount, start);
+}
+#else
+void Gfx_DrawDynamicVb_IndexedTris(GfxResourceID vb, void* vertices, int vCount) {
+	Gfx_SetDynamicVbData(vb, vertices, vCount);
+	Gfx_DrawVb_IndexedTris(vCount);
+}
+#endif
+
+
 /*########################################################################################################################*
 *------------------------------------------------------FPS and context----------------------------------------------------*
 *#########################################################################################################################*/
@@ -176,48 +228,50 @@ static CC_INLINE void EndReducedPerformance(void) {
 *#########################################################################################################################*/
 #ifndef CC_BUILD_3DS
 void Gfx_Draw2DFlat(int x, int y, int width, int height, PackedCol color) {
-	struct VertexColoured* v;
-
+	struct VertexColoured vertices[4];
+	struct VertexColoured* v = vertices;
 	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
-	v = (struct VertexColoured*)Gfx_LockDynamicVb(Gfx_quadVb, VERTEX_FORMAT_COLOURED, 4);
 
 	v->x = (float)x;           v->y = (float)y;            v->z = 0; v->Col = color; v++;
 	v->x = (float)(x + width); v->y = (float)y;            v->z = 0; v->Col = color; v++;
 	v->x = (float)(x + width); v->y = (float)(y + height); v->z = 0; v->Col = color; v++;
 	v->x = (float)x;           v->y = (float)(y + height); v->z = 0; v->Col = color; v++;
 
-	Gfx_UnlockDynamicVb(Gfx_quadVb);
-	Gfx_DrawVb_IndexedTris(4);
+	Gfx_DrawDynamicVb_IndexedTris(Gfx_quadVb, vertices, 4);
+	Gfx.Draw2DCalls++;
 }
 
 void Gfx_Draw2DGradient(int x, int y, int width, int height, PackedCol top, PackedCol bottom) {
-	struct VertexColoured* v;
-
+	struct VertexColoured vertices[4];
+	struct VertexColoured* v = vertices;
 	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
-	v = (struct VertexColoured*)Gfx_LockDynamicVb(Gfx_quadVb, VERTEX_FORMAT_COLOURED, 4);
 
 	v->x = (float)x;           v->y = (float)y;            v->z = 0; v->Col = top; v++;
 	v->x = (float)(x + width); v->y = (float)y;            v->z = 0; v->Col = top; v++;
 	v->x = (float)(x + width); v->y = (float)(y + height); v->z = 0; v->Col = bottom; v++;
 	v->x = (float)x;           v->y = (float)(y + height); v->z = 0; v->Col = bottom; v++;
 
-	Gfx_UnlockDynamicVb(Gfx_quadVb);
-	Gfx_DrawVb_IndexedTris(4);
+	Gfx_DrawDynamicVb_IndexedTris(Gfx_quadVb, vertices, 4);
+	Gfx.Draw2DCalls++;
 }
 
 void Gfx_Draw2DTexture(const struct Texture* tex, PackedCol color) {
-	struct VertexTextured* ptr;
-
+	struct VertexTextured vertices[4];
+	struct VertexTextured* ptr = vertices;
 	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
-	ptr = (struct VertexTextured*)Gfx_LockDynamicVb(Gfx_texVb, VERTEX_FORMAT_TEXTURED, 4);
 
 	Gfx_Make2DQuad(tex, color, &ptr);
-
-	Gfx_UnlockDynamicVb(Gfx_texVb);
-	Gfx_DrawVb_IndexedTris(4);
+	Gfx_DrawDynamicVb_IndexedTris(Gfx_texVb, vertices, 4);
+	Gfx.Draw2DCalls++;
 }
 #endif
 
+void Gfx_Draw2DRange(GfxResourceID texId, int verticesCount, int startVertex) {
+	Gfx_BindTexture(texId);
+	Gfx_DrawVb_IndexedTris_Range(verticesCount, startVertex);
+	Gfx.Draw2DCalls++;
+}
+
 void Gfx_Make2DQuad(const struct Texture* tex, PackedCol color, struct VertexTextured** vertices) {
 	float x1 = (float)tex->x, x2 = (float)(tex->x + tex->width);
 	float y1 = (float)tex->y, y2 = (float)(tex->y + tex->height);
@@ -362,6 +416,35 @@ static BitmapCol AverageColor(BitmapCol p1, BitmapCol p2) {
 		aSum >> 1);
 }
 
+/* Averages 4 colours at once, which is faster and more accurate than averaging two averages */
+static BitmapCol AverageColor4(BitmapCol p1, BitmapCol p2, BitmapCol p3, BitmapCol p4) {
+	cc_uint32 a1, a2, a3, a4, aSum;
+	cc_uint32 r, g, b;
+
+	a1 = BitmapCol_A(p1); a2 = BitmapCol_A(p2);
+	a3 = BitmapCol_A(p3); a4 = BitmapCol_A(p4);
+	aSum = a1 + a2 + a3 + a4;
+
+#ifndef BITMAP_16BPP
+	/* Fully opaque is the common case, and premultiplying is unnecessary then */
+	/* The sum of 4 components fits in 10 bits, so two components can be summed at once per 32 bits */
+	if (aSum == 255 * 4) {
+		cc_uint32 lo = (p1 & 0x00FF00FF) + (p2 & 0x00FF00FF) + (p3 & 0x00FF00FF) + (p4 & 0x00FF00FF);
+		cc_uint32 hi = ((p1 >> 8) & 0x00FF00FF) + ((p2 >> 8) & 0x00FF00FF)
+					 + ((p3 >> 8) & 0x00FF00FF) + ((p4 >> 8) & 0x00FF00FF);
+		return ((lo >> 2) & 0x00FF00FF) | (((hi >> 2) & 0x00FF00FF) << 8);
+	}
+#endif
+	/* See AverageColor for why colours are premultiplied */
+	r = BitmapCol_R(p1) * a1 + BitmapCol_R(p2) * a2 + BitmapCol_R(p3) * a3 + BitmapCol_R(p4) * a4;
+	g = BitmapCol_G(p1) * a1 + BitmapCol_G(p2) * a2 + BitmapCol_G(p3) * a3 + BitmapCol_G(p4) * a4;
+	b = BitmapCol_B(p1) * a1 + BitmapCol_B(p2) * a2 + BitmapCol_B(p3) * a3 + BitmapCol_B(p4) * a4;
+
+	a1   = aSum >> 2;
+	aSum = aSum > 0 ? aSum : 1; /* avoid divide by 0 below */
+	return BitmapCol_Make(r / aSum, g / aSum, b / aSum, a1);
+}
+
 /* Generates the next mipmaps level bitmap by downsampling from the given bitmap. */
 static void GenMipmaps(int width, int height, BitmapCol* dst, BitmapCol* src, int srcWidth) {
 	int x, y;
@@ -384,9 +467,7 @@ static void GenMipmaps(int width, int height, BitmapCol* dst, BitmapCol* src, in
 		for (x = 0; x < width; x++) {
 			int srcX = (x << 1);
 			/* 2x2 bilinear filter */
-			BitmapCol ave0 = AverageColor(src0[srcX], src0[srcX + 1]);
-			BitmapCol ave1 = AverageColor(src1[srcX], src1[srcX + 1]);
-			dst[x] = AverageColor(ave0, ave1);
+			dst[x] = AverageColor4(src0[srcX], src0[srcX + 1], src1[srcX], src1[srcX + 1]);
 		}
 		src += (srcWidth << 1);
 		dst += width;
@@ -404,6 +485,163 @@ static CC_NOINLINE int CalcMipmapsLevels(int width, int height) {
 	}
 }
 
+#if CC_GFX_BACKEND_IS_GL() || (CC_GFX_BACKEND == CC_GFX_BACKEND_D3D11)
+/* Textures are compressed into DXT1/DXT5 (aka BC1/BC3) format, which consists of 4x4 pixel blocks */
+/* Colours in each block are approximated by the 4 colours interpolated between the two endpoints */
+/*  of the bounding box of the block's colours (and similiarly for alpha in DXT5, but with 8 values) */
+static cc_uint16 DXT_Pack565(const int* rgb) {
+	return (cc_uint16)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+}
+
+static void DXT_Unpack565(cc_uint16 c, int* rgb) {
+	int r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void DXT_EncodeColors(cc_uint8* dst, const BitmapCol* block) {
+	int minC[3], maxC[3], palette[4][3], rgb[3];
+	int i, j, k, best, dist, bestDist, inset;
+	cc_uint16 c0, c1;
+	cc_uint32 indices = 0;
+
+	minC[0] = 255; minC[1] = 255; minC[2] = 255;
+	maxC[0] = 0;   maxC[1] = 0;   maxC[2] = 0;
+
+	for (i = 0; i < 16; i++) 
+	{
+		/* Colour of fully transparent pixels doesn't matter */
+		if (BitmapCol_A(block[i]) == 0) continue;
+		rgb[0] = BitmapCol_R(block[i]); rgb[1] = BitmapCol_G(block[i]); rgb[2] = BitmapCol_B(block[i]);
+
+		for (j = 0; j < 3; j++) 
+		{
+			minC[j] = min(minC[j], rgb[j]); maxC[j] = max(maxC[j], rgb[j]);
+		}
+	}
+
+	/* Inset the bounding box slightly to reduce the average error */
+	for (j = 0; j < 3; j++) 
+	{
+		if (minC[j] > maxC[j]) { minC[j] = 0; maxC[j] = 0; }
+		inset    = (maxC[j] - minC[j]) >> 4;
+		minC[j] += inset; maxC[j] -= inset;
+	}
+
+	/* c0 > c1 always selects 4 colour mode, and c0 == c1 only when all pixels use c0 anyways */
+	c0 = DXT_Pack565(maxC);
+	c1 = DXT_Pack565(minC);
+	Stream_SetU16_LE(dst + 0, c0);
+	Stream_SetU16_LE(dst + 2, c1);
+
+	DXT_Unpack565(c0, palette[0]);
+	DXT_Unpack565(c1, palette[1]);
+	for (j = 0; j < 3; j++) 
+	{
+		palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+		palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+	}
+
+	/* 2 bit index for each pixel, with the first pixel in the lowest bits */
+	for (i = 15; i >= 0 && c0 != c1; i--) 
+	{
+		rgb[0] = BitmapCol_R(block[i]); rgb[1] = BitmapCol_G(block[i]); rgb[2] = BitmapCol_B(block[i]);
+		best = 0; bestDist = Int32_MaxValue;
+
+		for (k = 0; k < 4; k++) 
+		{
+			dist = (rgb[0] - palette[k][0]) * (rgb[0] - palette[k][0])
+				 + (rgb[1] - palette[k][1]) * (rgb[1] - palette[k][1])
+				 + (rgb[2] - palette[k][2]) * (rgb[2] - palette[k][2]);
+			if (dist < bestDist) { best = k; bestDist = dist; }
+		}
+		indices = (indices << 2) | best;
+	}
+	Stream_SetU32_LE(dst + 4, indices);
+}
+
+static void DXT_EncodeAlpha(cc_uint8* dst, const BitmapCol* block) {
+	int minA = 255, maxA = 0, palette[8];
+	int i, k, a, best, dist, bestDist;
+	cc_uint32 indices;
+
+	for (i = 0; i < 16; i++) 
+	{
+		a    = BitmapCol_A(block[i]);
+		minA = min(minA, a); maxA = max(maxA, a);
+	}
+
+	/* a0 > a1 selects 8 alpha values mode, and a0 == a1 only when all pixels use a0 anyways */
+	palette[0] = maxA; palette[1] = minA;
+	for (k = 1; k < 7; k++) 
+	{
+		palette[k + 1] = ((7 - k) * maxA + k * minA) / 7;
+	}
+	dst[0] = maxA; dst[1] = minA;
+
+	/* 3 bit index for each pixel, with 8 pixels packed into each 24 bits */
+	for (indices = 0, i = 15; i >= 0; i--) 
+	{
+		a    = BitmapCol_A(block[i]);
+		best = 0; bestDist = Int32_MaxValue;
+
+		for (k = 0; k < 8 && minA != maxA; k++) 
+		{
+			dist = Math_AbsI(a - palette[k]);
+			if (dist < bestDist) { best = k; bestDist = dist; }
+		}
+		indices = (indices << 3) | best;
+
+		if (i == 8) {
+			dst[5] = indices; dst[6] = indices >> 8; dst[7] = indices >> 16;
+			indices = 0;
+		}
+	}
+	dst[2] = indices; dst[3] = indices >> 8; dst[4] = indices >> 16;
+}
+
+/* Compresses the given bitmap into DXT1 format if fully opaque, otherwise into DXT5 format */
+/* NOTE: Bitmap must have dimensions that are multiples of 4 */
+static cc_uint8* CompressTexture(struct Bitmap* bmp, int rowWidth, cc_bool* alpha, cc_uint32* size) {
+	BitmapCol block[16];
+	BitmapCol* row;
+	cc_uint8* data;
+	cc_uint8* dst;
+	int x, y, i;
+
+	/* DXT1 is half the size of DXT5, but doesn't support alpha */
+	*alpha = false;
+	for (y = 0; y < bmp->height && !(*alpha); y++) 
+	{
+		row = bmp->scan0 + y * rowWidth;
+		for (x = 0; x < bmp->width; x++) 
+		{
+			if (BitmapCol_A(row[x]) != 255) { *alpha = true; break; }
+		}
+	}
+
+	*size = (bmp->width / 4) * (bmp->height / 4) * (*alpha ? 16 : 8);
+	data  = (cc_uint8*)Mem_Alloc(*size, 1, "compressed texture");
+	dst   = data;
+
+	for (y = 0; y < bmp->height; y += 4) 
+	{
+		for (x = 0; x < bmp->width; x += 4) 
+		{
+			for (i = 0; i < 16; i++) 
+			{
+				block[i] = bmp->scan0[(y + (i >> 2)) * rowWidth + x + (i & 3)];
+			}
+
+			if (*alpha) { DXT_EncodeAlpha(dst, block); dst += 8; }
+			DXT_EncodeColors(dst, block); dst += 8;
+		}
+	}
+	return data;
+}
+#endif
+
 cc_bool Gfx_CheckTextureSize(int width, int height, cc_uint8 flags) {
 	int maxSize;
 	if (width  > Gfx.MaxTexWidth)  return false;
@@ -422,6 +660,14 @@ cc_bool Gfx_CheckTextureSize(int width, int height, cc_uint8 flags) {
 
 static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags, cc_bool mipmaps);
 
+/* Compressed textures consist of 4x4 pixel blocks, and so can't be updated or mipmapped like normal textures */
+static cc_bool CanCompressTexture(struct Bitmap* bmp, cc_uint8 flags, cc_bool mipmaps) {
+	if (!Gfx.SupportsCompressedTextures || !Gfx.CompressTextures) return false;
+	if (mipmaps || (flags & TEXTURE_FLAG_DYNAMIC)) return false;
+
+	return (bmp->width & 3) == 0 && (bmp->height & 3) == 0;
+}
+
 GfxResourceID Gfx_CreateTexture(struct Bitmap* bmp, cc_uint8 flags, cc_bool mipmaps) {
 	return Gfx_CreateTexture2(bmp, bmp->width, flags, mipmaps);
 }
@@ -437,6 +683,8 @@ GfxResourceID Gfx_CreateTexture2(struct Bitmap* bmp, int rowWidth, cc_uint8 flag
 	if (Gfx.LostContext) return 0;
 	if (!Gfx_CheckTextureSize(bmp->width, bmp->height, flags)) return 0;
 
+	if ((flags & TEXTURE_FLAG_COMPRESSED) && !CanCompressTexture(bmp, flags, mipmaps))
+		flags &= ~TEXTURE_FLAG_COMPRESSED;
 	return Gfx_AllocTexture(bmp, rowWidth, flags, mipmaps);
 }
 
@@ -487,6 +735,38 @@ GfxResourceID Gfx_CreateDynamicVb(VertexFormat fmt, int maxVertices) {
 	}
 }
 
+#if CC_GFX_BACKEND == CC_GFX_BACKEND_D3D11
+/* Creating and filling the vertex buffer in one go is defined in the backend */
+#else
+GfxResourceID Gfx_CreateVbFrom(const void* vertices, VertexFormat fmt, int count) {
+	GfxResourceID vb = Gfx_AllocStaticVb(fmt, count);
+	void* data;
+	if (!vb) return 0;
+
+	data = Gfx_LockVb(vb, fmt, count);
+	if (!data) { Gfx_DeleteVb(&vb); return 0; }
+
+	Mem_Copy(data, vertices, count * strideSizes[fmt]);
+	Gfx_UnlockVb(vb);
+	return vb;
+}
+#endif
+
+#if CC_GFX_BACKEND_IS_GL() || (CC_GFX_BACKEND == CC_GFX_BACKEND_D3D11)
+/* GPU timers are implemented using the backend's timer/timestamp queries */
+#else
+void Gfx_BeginGpuTimer(int timer) { }
+void Gfx_EndGpuTimer(void) { }
+int  Gfx_GetGpuTime(int timer) { return -1; }
+#endif
+
+#if CC_GFX_BACKEND_IS_GL() || (CC_GFX_BACKEND == CC_GFX_BACKEND_SOFTGPU)
+/* Scaled scene rendering is implemented by upscaling part of the backbuffer */
+#else
+void Gfx_BeginScaledScene(int width, int height) { }
+void Gfx_EndScaledScene(int width, int height) { }
+#endif
+
 #if CC_GFX_BACKEND_IS_GL() || (CC_GFX_BACKEND == CC_GFX_BACKEND_D3D9)
 /* Slightly more efficient implementations are defined in the backends */
 #else
@@ -509,6 +789,7 @@ static void OnInit(void) {
 	Event_Register_(&GfxEvents.ContextRecreated, NULL, OnContextRecreated);
 
 	Gfx.Mipmaps = Options_GetBool(OPT_MIPMAPS, false);
+	Gfx.CompressTextures = Options_GetBool(OPT_COMPRESS_TEXTURES, false);
 	if (Gfx.LostContext) return;
 	OnContextRecreated(NULL);
 }
@@ -130,6 +130,7 @@ static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const c
 
 	req.id = ++nextReqID;
 	req.requestType = type;
+	req.flags       = flags;
 
 	/* Change http:// to https:// if required */
 	if (httpsOnly) {
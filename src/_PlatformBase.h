@@ -1,8 +1,11 @@
+/* Platform backends implement the untracked memory allocation functions */
+#define CC_MEM_UNTRACKED
 #include "Platform.h"
 #include "String.h"
 #include "Logger.h"
 #include "Constants.h"
 #include "Errors.h"
+#include "Funcs.h"
 
 /*########################################################################################################################*
 *---------------------------------------------------------Memory----------------------------------------------------------*
@@ -54,6 +57,146 @@ static CC_NOINLINE cc_uint32 CalcMemSize(cc_uint32 numElems, cc_uint32 elemsSize
 }
 
 
+#ifdef CC_BUILD_MEMTRACK
+/*########################################################################################################################*
+*----------------------------------------------------Memory tracking------------------------------------------------------*
+*#########################################################################################################################*/
+const char* const Mem_SubsystemNames[MEM_SYS_COUNT] = {
+	"other", "world", "lighting", "chunks", "textures", "skins", "http", "audio", "ui", "gfx"
+};
+
+/* The size and subsystem of each allocation are stored just before the returned pointer */
+/* NOTE: Header is 16 bytes so that the returned pointer has the same alignment as from malloc */
+#define MEM_HEADER_SIZE 16
+struct MemHeader { cc_uint32 size, subsystem; };
+
+/* Last entry is the total across all subsystems */
+static struct MemUsage mem_usage[MEM_SYS_COUNT + 1];
+static void* mem_lock;
+static cc_bool mem_lockCreated;
+
+/* NOTE: The first allocation is always on the main thread before any other threads are started */
+static void MemTrack_Lock(void) {
+	if (!mem_lockCreated) {
+		mem_lock        = Mutex_Create("Memory tracking");
+		mem_lockCreated = true;
+	}
+	Mutex_Lock(mem_lock);
+}
+
+static void MemTrack_Add(int subsystem, cc_uint32 size) {
+	struct MemUsage* sys   = &mem_usage[subsystem];
+	struct MemUsage* total = &mem_usage[MEM_SYS_COUNT];
+
+	sys->live   += size;
+	sys->peak    = max(sys->peak,   sys->live);
+	total->live += size;
+	total->peak  = max(total->peak, total->live);
+}
+
+static void MemTrack_Remove(int subsystem, cc_uint32 size) {
+	mem_usage[subsystem].live     -= size;
+	mem_usage[MEM_SYS_COUNT].live -= size;
+}
+
+static void* MemTrack_Tag(void* raw, cc_uint32 size, int subsystem) {
+	struct MemHeader* header = (struct MemHeader*)raw;
+	if (!raw) return NULL;
+
+	header->size      = size;
+	header->subsystem = subsystem;
+
+	MemTrack_Lock();
+	MemTrack_Add(subsystem, size);
+	Mutex_Unlock(mem_lock);
+	return (cc_uint8*)raw + MEM_HEADER_SIZE;
+}
+
+static cc_uint32 MemTrack_CalcSize(cc_uint32 numElems, cc_uint32 elemsSize) {
+	cc_uint32 size = CalcMemSize(numElems, elemsSize);
+	return size > (cc_uint32)-1 - MEM_HEADER_SIZE ? 0 : size;
+}
+
+void* Mem_TryAllocTagged(cc_uint32 numElems, cc_uint32 elemsSize, int subsystem) {
+	cc_uint32 size = MemTrack_CalcSize(numElems, elemsSize);
+	return size ? MemTrack_Tag(Mem_TryAlloc(1, size + MEM_HEADER_SIZE), size, subsystem) : NULL;
+}
+
+void* Mem_TryAllocClearedTagged(cc_uint32 numElems, cc_uint32 elemsSize, int subsystem) {
+	cc_uint32 size = MemTrack_CalcSize(numElems, elemsSize);
+	return size ? MemTrack_Tag(Mem_TryAllocCleared(1, size + MEM_HEADER_SIZE), size, subsystem) : NULL;
+}
+
+void* Mem_TryReallocTagged(void* mem, cc_uint32 numElems, cc_uint32 elemsSize, int subsystem) {
+	struct MemHeader* header;
+	cc_uint32 size, oldSize, oldSubsystem;
+	void* raw;
+	if (!mem) return Mem_TryAllocTagged(numElems, elemsSize, subsystem);
+
+	size = MemTrack_CalcSize(numElems, elemsSize);
+	if (!size) return NULL;
+	header       = (struct MemHeader*)((cc_uint8*)mem - MEM_HEADER_SIZE);
+	oldSize      = header->size;
+	oldSubsystem = header->subsystem;
+
+	raw = Mem_TryRealloc(header, 1, size + MEM_HEADER_SIZE);
+	if (!raw) return NULL;
+
+	MemTrack_Lock();
+	MemTrack_Remove(oldSubsystem, oldSize);
+	Mutex_Unlock(mem_lock);
+	return MemTrack_Tag(raw, size, subsystem);
+}
+
+void* Mem_AllocTagged(cc_uint32 numElems, cc_uint32 elemsSize, const char* place, int subsystem) {
+	void* ptr = Mem_TryAllocTagged(numElems, elemsSize, subsystem);
+	if (!ptr) AbortOnAllocFailed(place);
+	return ptr;
+}
+
+void* Mem_AllocClearedTagged(cc_uint32 numElems, cc_uint32 elemsSize, const char* place, int subsystem) {
+	void* ptr = Mem_TryAllocClearedTagged(numElems, elemsSize, subsystem);
+	if (!ptr) AbortOnAllocFailed(place);
+	return ptr;
+}
+
+void* Mem_ReallocTagged(void* mem, cc_uint32 numElems, cc_uint32 elemsSize, const char* place, int subsystem) {
+	void* ptr = Mem_TryReallocTagged(mem, numElems, elemsSize, subsystem);
+	if (!ptr) AbortOnAllocFailed(place);
+	return ptr;
+}
+
+void Mem_FreeTagged(void* mem) {
+	struct MemHeader* header;
+	if (!mem) return;
+	header = (struct MemHeader*)((cc_uint8*)mem - MEM_HEADER_SIZE);
+
+	MemTrack_Lock();
+	MemTrack_Remove(header->subsystem, header->size);
+	Mutex_Unlock(mem_lock);
+	Mem_Free(header);
+}
+
+void Mem_Retag(void* mem, int subsystem) {
+	struct MemHeader* header;
+	if (!mem) return;
+	header = (struct MemHeader*)((cc_uint8*)mem - MEM_HEADER_SIZE);
+
+	MemTrack_Lock();
+	MemTrack_Remove(header->subsystem, header->size);
+	MemTrack_Add(subsystem, header->size);
+	header->subsystem = subsystem;
+	Mutex_Unlock(mem_lock);
+}
+
+void Mem_GetUsage(struct MemUsage* usage) {
+	MemTrack_Lock();
+	Mem_Copy(usage, mem_usage, sizeof(mem_usage));
+	Mutex_Unlock(mem_lock);
+}
+#endif
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------Logging----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -353,56 +353,89 @@ mergeInto(LibraryManager.library, {
     // however, as ClassiCube now loads IndexedDB asynchronously itself, this is
     //   no longer necessary, but is kept around for backwards compatibility
   },
-  interop_SaveNode__deps: ['IDBFS_getDB', 'IDBFS_storeRemoteEntry'],
+  interop_SaveNode__deps: ['IDBFS_scheduleIdle', 'IDBFS_saveDirty'],
   interop_SaveNode: function(path) {
-    var callback = function(err) { 
+    // Writes are batched together and then saved in one IndexedDB transaction
+    //  once the browser is idle, instead of one transaction per written file
+    if (!window.IDBFS_dirty) {
+      window.IDBFS_dirty = {};
+      // make sure pending writes still get saved when the page is being closed
+      document.addEventListener('visibilitychange', function() {
+        if (document.visibilityState === 'hidden') _IDBFS_saveDirty();
+      });
+    }
+    
+    IDBFS_dirty[path] = true;
+    if (window.IDBFS_saveQueued) return;
+    
+    window.IDBFS_saveQueued = true;
+    _IDBFS_scheduleIdle(_IDBFS_saveDirty);
+  },
+//########################################################################################################################
+//--------------------------------------------------------IndexedDB-------------------------------------------------------
+//########################################################################################################################
+  IDBFS_loadFS__deps: ['IDBFS_getRemoteSet', 'IDBFS_reconcile'],
+  IDBFS_loadFS: function(callback) {
+    _IDBFS_getRemoteSet(function(err, remote) {
+      if (err) return callback(err);
+      _IDBFS_reconcile(remote, callback);
+    });
+  },
+  IDBFS_scheduleIdle: function(func) {
+    // not supported by all browsers
+    if (window.requestIdleCallback) {
+      window.requestIdleCallback(func, { timeout: 1000 });
+    } else {
+      setTimeout(func, 0);
+    }
+  },
+  IDBFS_saveDirty__deps: ['IDBFS_getDB', 'IDBFS_storeRemoteEntry'],
+  IDBFS_saveDirty: function() {
+    var paths   = Object.keys(window.IDBFS_dirty || {});
+    var entries = [];
+    window.IDBFS_dirty      = {};
+    window.IDBFS_saveQueued = false;
+    if (!paths.length) return;
+    
+    function onSaved(path, err) {
       if (!err) return;
       console.log(err);
       _interop_callStringFunc('Platform_LogError', '&cError saving ' + path);
       _interop_callStringFunc('Platform_LogError', '   &c' + err);
-    }; 
-    
-    var stat, node, entry;
-    try {
-      var lookup = CCFS.lookupPath(path);
-      node = lookup.node;
+    }
     
+    paths.forEach(function(path) {
+      var node = CCFS.entries[CCFS.resolvePath(path)];
+      // file may have been deleted since it was written to
+      if (!node) return;
+      
       // Performance consideration: storing a normal JavaScript array to a IndexedDB is much slower than storing a typed array.
       // Therefore always convert the file contents to a typed array first before writing the data to IndexedDB.
       node.contents = MEMFS.getFileDataAsTypedArray(node);
-      entry = { timestamp: node.timestamp, mode: CCFS.MODE_TYPE_FILE, contents: node.contents };
-    } catch (err) {
-      return callback(err);
-    }
+      entries.push({ path: path, entry: { timestamp: node.timestamp, mode: CCFS.MODE_TYPE_FILE, contents: node.contents } });
+    });
+    if (!entries.length) return;
     
     _IDBFS_getDB(function(err, db) {
-      if (err) return callback(err);
       var transaction, store;
+      if (err) return entries.forEach(function(e) { onSaved(e.path, err); });
       
       // can still throw errors here
       try {
         transaction = db.transaction([IDBFS_DB_STORE_NAME], 'readwrite');
         store = transaction.objectStore(IDBFS_DB_STORE_NAME);
       } catch (err) {
-        return callback(err);
+        return entries.forEach(function(e) { onSaved(e.path, err); });
       }
       
       transaction.onerror = function(e) {
-        callback(this.error);
+        console.log(this.error);
         e.preventDefault();
       };
       
-      _IDBFS_storeRemoteEntry(store, path, entry, callback);
-    });
-  },
-//########################################################################################################################
-//--------------------------------------------------------IndexedDB-------------------------------------------------------
-//########################################################################################################################
-  IDBFS_loadFS__deps: ['IDBFS_getRemoteSet', 'IDBFS_reconcile'],
-  IDBFS_loadFS: function(callback) {
-    _IDBFS_getRemoteSet(function(err, remote) {
-      if (err) return callback(err);
-      _IDBFS_reconcile(remote, callback);
+      entries.forEach(function(e) {
+        _IDBFS_storeRemoteEntry(store, e.path, e.entry, function(err) { onSaved(e.path, err); });
+      });
     });
   },
   IDBFS_getDB: function(callback) {
@@ -514,15 +547,79 @@ mergeInto(LibraryManager.library, {
   
     callback(null);
   },
-  IDBFS_reconcile__deps: ['IDBFS_loadRemoteEntry', 'IDBFS_storeLocalEntry'],
+  IDBFS_isLazyPath: function(path) {
+    // these directories can contain a lot of large files, which would
+    //  noticeably delay startup if they all had to be loaded beforehand
+    if (path.charAt(0) !== '/') return false;
+    return path.indexOf('/maps/') >= 0 || path.indexOf('/texturecache/') >= 0;
+  },
+  IDBFS_loadPending__deps: ['IDBFS_getDB', 'IDBFS_loadRemoteEntry', 'IDBFS_scheduleIdle'],
+  IDBFS_loadPending: function() {
+    var queue = window.IDBFS_pending;
+    if (!queue || !queue.length) return;
+    
+    function unload(path, node) {
+      if (CCFS.entries[path] === node) delete CCFS.entries[path];
+    }
+  
+    _IDBFS_getDB(function(err, db) {
+      var transaction, store, remaining = 0;
+      if (err) return console.log(err);
+      
+      try {
+        transaction = db.transaction([IDBFS_DB_STORE_NAME], 'readonly');
+        store = transaction.objectStore(IDBFS_DB_STORE_NAME);
+      } catch (err) {
+        return console.log(err);
+      }
+      
+      // only load a few files at a time, to avoid stalling the game for too long
+      queue.splice(0, 8).forEach(function(path) {
+        var node = CCFS.entries[path];
+        // file may have been deleted or overwritten in the meantime
+        if (!node || !node.pending) return;
+        remaining++;
+        
+        _IDBFS_loadRemoteEntry(store, path, function(err, entry) {
+          if (!node.pending) {
+            // overwritten while being loaded, so the newer contents must be kept
+          } else if (err || !entry || !CCFS.isFile(entry.mode)) {
+            if (err) console.log(err);
+            unload(path, node);
+          } else {
+            node.contents  = entry.contents;
+            node.usedBytes = entry.contents.length;
+            node.timestamp = entry.timestamp;
+            node.pending   = false;
+          }
+          
+          if (--remaining) return;
+          _IDBFS_scheduleIdle(_IDBFS_loadPending);
+        });
+      });
+      if (!remaining) _IDBFS_scheduleIdle(_IDBFS_loadPending);
+    });
+  },
+  IDBFS_reconcile__deps: ['IDBFS_loadRemoteEntry', 'IDBFS_storeLocalEntry', 'IDBFS_isLazyPath', 'IDBFS_loadPending', 'IDBFS_scheduleIdle'],
   IDBFS_reconcile: function(src, callback) {
     var total  = 0;
     var create = [];
+    window.IDBFS_pending = [];
 
     Object.keys(src.entries).forEach(function (key) {
-      create.push(key);
-      total++;
+      if (_IDBFS_isLazyPath(key)) {
+        // only the file entry is created at startup, and its contents are
+        //  then loaded in the background once the game has started
+        var node = MEMFS.createNode(key);
+        node.timestamp = src.entries[key].timestamp;
+        node.pending   = true;
+        IDBFS_pending.push(key);
+      } else {
+        create.push(key);
+        total++;
+      }
     });
+    _IDBFS_scheduleIdle(_IDBFS_loadPending);
     if (!total) return callback(null);
 
     var errored = false;
@@ -1315,6 +1412,14 @@ mergeInto(LibraryManager.library, {
         if ((flags & 512)) {
           MEMFS.clearFileStorage(node);
           node.timestamp = Date.now();
+          node.pending   = false;
+        }
+        
+        // file contents still being loaded from IndexedDB in the background
+        if (node.pending) {
+          // make sure it gets loaded next
+          IDBFS_pending.unshift(path);
+          throw new CCFS.ErrnoError(6); // EAGAIN
         }
         
         // we've already handled these, don't pass down to the underlying vfs
@@ -114,6 +114,7 @@ static void SetupProgram(int argc, char** argv) {
 	Logger_Hook();
 	Window_PreInit();
 	Platform_Init();
+	Logger_InitTrace();
 	
 	res = Platform_SetDefaultCurrentDirectory(argc, argv);
 	Options_Load();
@@ -159,6 +160,12 @@ static int RunProgram(int argc, char** argv) {
 	//argsCount = String_UNSAFE_Split(&rawArgs, ' ', args, 4);
 #endif
 
+	/* [args] --startup-trace - log how long each step of starting the game took */
+	if (argsCount && String_CaselessEqualsConst(&args[argsCount - 1], DEFAULT_STARTUPTRACE_ARG)) {
+		Game_StartupTrace = true;
+		argsCount--;
+	}
+
 	if (argsCount == 0) {
 #ifdef CC_BUILD_WEB
 		String_AppendConst(&Game_Username, DEFAULT_USERNAME);
@@ -188,6 +195,19 @@ static int RunProgram(int argc, char** argv) {
 		Options_Get(LOPT_USERNAME, &Game_Username, DEFAULT_USERNAME);
 		String_Copy(&SP_AutoloadMap, &args[0]); /* TODO: don't copy args? */
 		RunGame();
+	/* --benchmark [map] [replay] - run singleplayer with auto loaded map, then time replaying the given replay */
+	} else if (argsCount == 3 && String_CaselessEqualsConst(&args[0], DEFAULT_BENCHMARK_ARG)) {
+		if (Game_LoadReplay(&args[2])) return 1;
+
+		Options_Get(LOPT_USERNAME, &Game_Username, DEFAULT_USERNAME);
+		String_Copy(&SP_AutoloadMap, &args[1]);
+		RunGame();
+	/* --perf - run singleplayer, then time each subsystem on fixed inputs */
+	} else if (argsCount == 1 && String_CaselessEqualsConst(&args[0], DEFAULT_PERF_ARG)) {
+		Game_StartPerf();
+
+		Options_Get(LOPT_USERNAME, &Game_Username, DEFAULT_USERNAME);
+		RunGame();
 #endif
 	/* mc://[addr]:[port]/[user]/[mppass] - run multiplayer using direct URL form arguments */
 	} else if (argsCount == 1 && DirectUrl_Claims(&args[0], &host, &r.user, &r.mppass)) {
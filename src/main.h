@@ -8,6 +8,9 @@ CC_BEGIN_HEADER
 
 #define DEFAULT_SINGLEPLAYER_ARG "--singleplayer"
 #define DEFAULT_RESUME_ARG       "--resume"
+#define DEFAULT_BENCHMARK_ARG    "--benchmark"
+#define DEFAULT_PERF_ARG         "--perf"
+#define DEFAULT_STARTUPTRACE_ARG "--startup-trace"
 
 struct ResumeInfo {
 	cc_string user, ip, port, server, mppass;